@@ -1,9 +1,6 @@
 package com.multinstance.fsexperiment
 
-import android.content.ContentValues
-import android.content.Context
 import android.database.sqlite.SQLiteDatabase
-import android.database.sqlite.SQLiteOpenHelper
 import android.util.Log
 import com.facebook.react.bridge.Arguments
 import com.facebook.react.bridge.Callback
@@ -14,14 +11,28 @@ import com.facebook.react.bridge.ReadableArray
 import com.facebook.react.bridge.WritableMap
 import com.facebook.react.module.annotations.ReactModule
 import io.callstack.rnsandbox.SandboxAwareModule
+import io.callstack.rnsandbox.SandboxExecutor
+import io.callstack.rnsandbox.SandboxKeyValueStore
 import org.json.JSONObject
+import java.io.File
+import java.util.concurrent.Executor
 import java.util.concurrent.Executors
+import java.util.concurrent.ScheduledExecutorService
 import java.util.concurrent.TimeUnit
 
 /**
- * Sandboxed AsyncStorage — per-origin SQLite storage that mirrors the original
+ * Sandboxed AsyncStorage — per-origin storage that mirrors the original
  * RNCAsyncStorage API but scopes data to the sandbox origin.
  *
+ * Data is kept in a [SandboxKeyValueStore] log, shared with the iOS module, so each
+ * batch appends its own records. The SQLite database of earlier versions is imported
+ * into it the first time the store is opened.
+ *
+ * Writes are group-committed: the batches of calls arriving within
+ * [COMMIT_WINDOW_MS] of the first, up to [COMMIT_MAX_BYTES], are made durable
+ * with one fsync, and each call's callback gets its own batch's result. Reads
+ * commit the pending writes first, so they always see them.
+ *
  * Uses callbacks (not promises) to match the original AsyncStorageModule interface.
  */
 @ReactModule(name = SandboxedAsyncStorage.MODULE_NAME)
@@ -32,38 +43,56 @@ class SandboxedAsyncStorage(
     companion object {
         const val MODULE_NAME = "SandboxedAsyncStorage"
         private const val TAG = "SandboxedAsyncStorage"
-        private const val TABLE = "kv"
-        private const val COL_KEY = "k"
-        private const val COL_VALUE = "v"
-        private const val DB_VERSION = 1
-        private const val MAX_SQL_KEYS = 999
+        private const val COMMIT_WINDOW_MS = 2L
+        private const val COMMIT_MAX_BYTES = 256 * 1024
+        // The SQLite database of the module's earlier versions, in storeDir
+        private const val LEGACY_DB_NAME = "sandboxed_async_storage.db"
+
+        // Only hands due commits to their module's lane, so one thread serves every instance
+        private val commitTimer: ScheduledExecutorService by lazy {
+            Executors.newSingleThreadScheduledExecutor { task ->
+                Thread(task, "SandboxedAsyncStorage-commit").apply { isDaemon = true }
+            }
+        }
     }
 
-    private val executor = Executors.newSingleThreadExecutor()
-    private var dbHelper: SandboxDBHelper? = null
+    private class PendingWrite(
+        val keys: Array<String>,
+        val values: Array<String?>,
+        val callback: Callback,
+    )
+
+    // This origin's lane on the executor shared by all sandboxes
+    private lateinit var executor: Executor
+    private lateinit var storeDir: File
+    // Opened and closed on the lane
+    private var store: SandboxKeyValueStore? = null
+    // The open commit group, touched only on the lane
+    private val pending = ArrayList<PendingWrite>()
+    private var pendingBytes = 0
+    private var commitScheduled = false
     @Volatile private var configured = false
 
     override fun getName(): String = MODULE_NAME
 
     override fun configureSandbox(origin: String, requestedName: String, resolvedName: String) {
         Log.d(TAG, "Configuring for origin '$origin'")
-        val dbDir = java.io.File(reactContext.filesDir, "Sandboxes/$origin/AsyncStorage")
-        dbDir.mkdirs()
-        val dbName = "sandboxed_async_storage.db"
-        dbHelper = SandboxDBHelper(reactContext, java.io.File(dbDir, dbName).absolutePath)
+        storeDir = File(reactContext.filesDir, "Sandboxes/$origin/AsyncStorage")
+        storeDir.mkdirs()
+        executor = SandboxExecutor.strand(origin, MODULE_NAME)
         configured = true
     }
 
     override fun invalidate() {
-        executor.shutdown()
-        try {
-            executor.awaitTermination(2, TimeUnit.SECONDS)
-        } catch (_: InterruptedException) {
-            executor.shutdownNow()
+        if (configured) {
+            configured = false
+            // Behind the calls already queued on the lane
+            executor.execute {
+                commitPending()
+                store?.close()
+                store = null
+            }
         }
-        dbHelper?.close()
-        dbHelper = null
-        configured = false
         super.invalidate()
     }
 
@@ -73,9 +102,91 @@ class SandboxedAsyncStorage(
         return map
     }
 
-    private fun db(): SQLiteDatabase? = dbHelper?.writableDatabase
+    private fun store(): SandboxKeyValueStore =
+        store ?: SandboxKeyValueStore.open(storeDir).also {
+            store = it
+            importLegacyDatabase(it)
+        }
 
-    private fun readDb(): SQLiteDatabase? = dbHelper?.readableDatabase
+    /**
+     * Moves the rows of the SQLite database the module used before the log into the store. Keys the store already
+     * has were written later and are kept. The database is deleted once the imported batch is durable; until then
+     * every open retries the import. On the lane.
+     */
+    private fun importLegacyDatabase(store: SandboxKeyValueStore) {
+        val dbFile = File(storeDir, LEGACY_DB_NAME)
+        if (!dbFile.exists()) return
+        try {
+            val keys = ArrayList<String>()
+            val values = ArrayList<String?>()
+            SQLiteDatabase.openDatabase(dbFile.path, null, SQLiteDatabase.OPEN_READONLY).use { db ->
+                db.rawQuery("SELECT k, v FROM kv", null).use { cursor ->
+                    while (cursor.moveToNext()) {
+                        keys.add(cursor.getString(0))
+                        values.add(cursor.getString(1))
+                    }
+                }
+            }
+            val current = store.get(keys.toTypedArray())
+            val missing = keys.indices.filter { current[it] == null }
+            // Each write is fsynced before it returns
+            store.write(Array(missing.size) { keys[missing[it]] }, Array(missing.size) { values[missing[it]] })
+            SQLiteDatabase.deleteDatabase(dbFile)
+            Log.i(TAG, "Imported ${missing.size} keys from $LEGACY_DB_NAME")
+        } catch (e: Exception) {
+            Log.e(TAG, "Importing $LEGACY_DB_NAME failed, keeping it for the next open", e)
+        }
+    }
+
+    private fun stringArray(keys: ReadableArray): Array<String> = Array(keys.size()) { keys.getString(it) ?: "" }
+
+    /** Adds a call's batch to the commit group. On the lane. */
+    private fun enqueueWrite(
+        keys: Array<String>,
+        values: Array<String?>,
+        callback: Callback,
+    ) {
+        pending.add(PendingWrite(keys, values, callback))
+        for (i in keys.indices) {
+            pendingBytes += keys[i].length + (values[i]?.length ?: 0)
+        }
+        if (pendingBytes >= COMMIT_MAX_BYTES) {
+            commitPending()
+        } else if (!commitScheduled) {
+            commitScheduled = true
+            val commit = Runnable {
+                commitScheduled = false
+                commitPending()
+            }
+            commitTimer.schedule(Runnable { executor.execute(commit) }, COMMIT_WINDOW_MS, TimeUnit.MILLISECONDS)
+        }
+    }
+
+    /** Writes the commit group with one fsync, then answers each call. On the lane. */
+    private fun commitPending() {
+        if (pending.isEmpty()) return
+        val group = pending.toTypedArray()
+        pending.clear()
+        pendingBytes = 0
+        val errors =
+            try {
+                store().writeGroup(
+                    Array(group.size) { group[it].keys },
+                    Array(group.size) { group[it].values },
+                )
+            } catch (e: Exception) {
+                Log.e(TAG, "Commit failed", e)
+                Array<String?>(group.size) { e.message ?: "Unknown error" }
+            }
+        for (i in group.indices) {
+            val error = errors[i]
+            if (error != null) {
+                group[i].callback.invoke(errorMap(error))
+            } else {
+                group[i].callback.invoke()
+            }
+        }
+    }
 
     @ReactMethod
     fun multiGet(keys: ReadableArray, callback: Callback) {
@@ -85,36 +196,15 @@ class SandboxedAsyncStorage(
         }
         executor.execute {
             try {
-                val db = readDb() ?: run {
-                    callback.invoke(errorMap("Database not available"), null)
-                    return@execute
-                }
+                commitPending()
+                val requested = stringArray(keys)
+                val values = store().get(requested)
                 val data = Arguments.createArray()
-                val keysRemaining = mutableSetOf<String>()
-
-                for (start in 0 until keys.size() step MAX_SQL_KEYS) {
-                    val count = minOf(keys.size() - start, MAX_SQL_KEYS)
-                    keysRemaining.clear()
-                    val placeholders = (0 until count).joinToString(",") { "?" }
-                    val args = Array(count) { keys.getString(start + it) ?: "" }
-                    for (arg in args) keysRemaining.add(arg)
-
-                    db.rawQuery("SELECT $COL_KEY, $COL_VALUE FROM $TABLE WHERE $COL_KEY IN ($placeholders)", args).use { cursor ->
-                        while (cursor.moveToNext()) {
-                            val row = Arguments.createArray()
-                            row.pushString(cursor.getString(0))
-                            row.pushString(cursor.getString(1))
-                            data.pushArray(row)
-                            keysRemaining.remove(cursor.getString(0))
-                        }
-                    }
-
-                    for (key in keysRemaining) {
-                        val row = Arguments.createArray()
-                        row.pushString(key)
-                        row.pushNull()
-                        data.pushArray(row)
-                    }
+                for (i in requested.indices) {
+                    val row = Arguments.createArray()
+                    row.pushString(requested[i])
+                    row.pushString(values[i])
+                    data.pushArray(row)
                 }
                 callback.invoke(null, data)
             } catch (e: Exception) {
@@ -132,28 +222,17 @@ class SandboxedAsyncStorage(
         }
         executor.execute {
             try {
-                val db = db() ?: run {
-                    callback.invoke(errorMap("Database not available"))
-                    return@execute
+                val keys = ArrayList<String>(keyValueArray.size())
+                val values = ArrayList<String?>(keyValueArray.size())
+                for (i in 0 until keyValueArray.size()) {
+                    val pair = keyValueArray.getArray(i) ?: continue
+                    if (pair.size() != 2) continue
+                    val key = pair.getString(0) ?: continue
+                    val value = pair.getString(1) ?: continue
+                    keys.add(key)
+                    values.add(value)
                 }
-                db.beginTransaction()
-                try {
-                    for (i in 0 until keyValueArray.size()) {
-                        val pair = keyValueArray.getArray(i) ?: continue
-                        if (pair.size() != 2) continue
-                        val key = pair.getString(0) ?: continue
-                        val value = pair.getString(1) ?: continue
-
-                        val cv = ContentValues()
-                        cv.put(COL_KEY, key)
-                        cv.put(COL_VALUE, value)
-                        db.insertWithOnConflict(TABLE, null, cv, SQLiteDatabase.CONFLICT_REPLACE)
-                    }
-                    db.setTransactionSuccessful()
-                } finally {
-                    db.endTransaction()
-                }
-                callback.invoke()
+                enqueueWrite(keys.toTypedArray(), values.toTypedArray(), callback)
             } catch (e: Exception) {
                 Log.e(TAG, "multiSet failed", e)
                 callback.invoke(errorMap(e.message ?: "Unknown error"))
@@ -169,23 +248,8 @@ class SandboxedAsyncStorage(
         }
         executor.execute {
             try {
-                val db = db() ?: run {
-                    callback.invoke(errorMap("Database not available"))
-                    return@execute
-                }
-                db.beginTransaction()
-                try {
-                    for (start in 0 until keys.size() step MAX_SQL_KEYS) {
-                        val count = minOf(keys.size() - start, MAX_SQL_KEYS)
-                        val placeholders = (0 until count).joinToString(",") { "?" }
-                        val args = Array(count) { keys.getString(start + it) ?: "" }
-                        db.delete(TABLE, "$COL_KEY IN ($placeholders)", args)
-                    }
-                    db.setTransactionSuccessful()
-                } finally {
-                    db.endTransaction()
-                }
-                callback.invoke()
+                val removed = stringArray(keys)
+                enqueueWrite(removed, arrayOfNulls(removed.size), callback)
             } catch (e: Exception) {
                 Log.e(TAG, "multiRemove failed", e)
                 callback.invoke(errorMap(e.message ?: "Unknown error"))
@@ -201,34 +265,24 @@ class SandboxedAsyncStorage(
         }
         executor.execute {
             try {
-                val db = db() ?: run {
-                    callback.invoke(errorMap("Database not available"))
-                    return@execute
-                }
-                db.beginTransaction()
-                try {
-                    for (i in 0 until keyValueArray.size()) {
-                        val pair = keyValueArray.getArray(i) ?: continue
-                        if (pair.size() != 2) continue
-                        val key = pair.getString(0) ?: continue
-                        val newValue = pair.getString(1) ?: continue
+                commitPending()
+                val store = store()
+                // Values merged earlier in this call, which the store sees only once the batch is written
+                val merged = LinkedHashMap<String, String>()
+                for (i in 0 until keyValueArray.size()) {
+                    val pair = keyValueArray.getArray(i) ?: continue
+                    if (pair.size() != 2) continue
+                    val key = pair.getString(0) ?: continue
+                    val newValue = pair.getString(1) ?: continue
 
-                        val existing = getValueForKey(db, key)
-                        val merged = if (existing != null) {
-                            mergeJsonStrings(existing, newValue) ?: newValue
-                        } else {
-                            newValue
-                        }
-                        val cv = ContentValues()
-                        cv.put(COL_KEY, key)
-                        cv.put(COL_VALUE, merged)
-                        db.insertWithOnConflict(TABLE, null, cv, SQLiteDatabase.CONFLICT_REPLACE)
+                    val existing = merged[key] ?: store.get(arrayOf(key))[0]
+                    merged[key] = if (existing != null) {
+                        mergeJsonStrings(existing, newValue) ?: newValue
+                    } else {
+                        newValue
                     }
-                    db.setTransactionSuccessful()
-                } finally {
-                    db.endTransaction()
                 }
-                callback.invoke()
+                enqueueWrite(merged.keys.toTypedArray(), merged.values.toTypedArray<String?>(), callback)
             } catch (e: Exception) {
                 Log.e(TAG, "multiMerge failed", e)
                 callback.invoke(errorMap(e.message ?: "Unknown error"))
@@ -244,15 +298,10 @@ class SandboxedAsyncStorage(
         }
         executor.execute {
             try {
-                val db = readDb() ?: run {
-                    callback.invoke(errorMap("Database not available"), null)
-                    return@execute
-                }
+                commitPending()
                 val keys = Arguments.createArray()
-                db.rawQuery("SELECT $COL_KEY FROM $TABLE", null).use { cursor ->
-                    while (cursor.moveToNext()) {
-                        keys.pushString(cursor.getString(0))
-                    }
+                for (key in store().keys()) {
+                    keys.pushString(key)
                 }
                 callback.invoke(null, keys)
             } catch (e: Exception) {
@@ -270,11 +319,8 @@ class SandboxedAsyncStorage(
         }
         executor.execute {
             try {
-                val db = db() ?: run {
-                    callback.invoke(errorMap("Database not available"))
-                    return@execute
-                }
-                db.delete(TABLE, null, null)
+                commitPending()
+                store().clear()
                 callback.invoke()
             } catch (e: Exception) {
                 Log.e(TAG, "clear failed", e)
@@ -283,12 +329,6 @@ class SandboxedAsyncStorage(
         }
     }
 
-    private fun getValueForKey(db: SQLiteDatabase, key: String): String? {
-        db.rawQuery("SELECT $COL_VALUE FROM $TABLE WHERE $COL_KEY = ?", arrayOf(key)).use { cursor ->
-            return if (cursor.moveToFirst()) cursor.getString(0) else null
-        }
-    }
-
     /**
      * Deep recursive merge matching the original RNCAsyncStorage behavior:
      * when both sides have a JSONObject at a given key, merge recursively;
@@ -316,17 +356,4 @@ class SandboxedAsyncStorage(
             }
         }
     }
-
-    private class SandboxDBHelper(context: Context, dbPath: String) :
-        SQLiteOpenHelper(context, dbPath, null, DB_VERSION) {
-
-        override fun onCreate(db: SQLiteDatabase) {
-            db.execSQL("CREATE TABLE IF NOT EXISTS $TABLE ($COL_KEY TEXT PRIMARY KEY, $COL_VALUE TEXT NOT NULL)")
-        }
-
-        override fun onUpgrade(db: SQLiteDatabase, oldVersion: Int, newVersion: Int) {
-            db.execSQL("DROP TABLE IF EXISTS $TABLE")
-            onCreate(db)
-        }
-    }
 }
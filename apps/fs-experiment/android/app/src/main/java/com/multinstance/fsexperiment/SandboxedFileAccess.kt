@@ -11,13 +11,13 @@ import com.facebook.react.bridge.ReactMethod
 import com.facebook.react.bridge.ReadableMap
 import com.facebook.react.module.annotations.ReactModule
 import io.callstack.rnsandbox.SandboxAwareModule
+import io.callstack.rnsandbox.SandboxExecutor
 import java.io.File
 import java.io.FileInputStream
 import java.io.FileOutputStream
 import java.io.RandomAccessFile
 import java.security.MessageDigest
-import java.util.concurrent.Executors
-import java.util.concurrent.TimeUnit
+import java.util.concurrent.Executor
 
 /**
  * Sandboxed FileAccess — jails all file paths to a per-origin directory.
@@ -35,7 +35,8 @@ class SandboxedFileAccess(
         private const val TAG = "SandboxedFileAccess"
     }
 
-    private val executor = Executors.newSingleThreadExecutor()
+    // This origin's lane on the executor shared by all sandboxes
+    private lateinit var executor: Executor
 
     private var sandboxRoot: String = ""
     private var documentsDir: String = ""
@@ -52,16 +53,11 @@ class SandboxedFileAccess(
         cachesDir = File(base, "Caches").absolutePath
 
         listOf(documentsDir, cachesDir).forEach { File(it).mkdirs() }
+        executor = SandboxExecutor.strand(origin, MODULE_NAME)
         configured = true
     }
 
     override fun invalidate() {
-        executor.shutdown()
-        try {
-            executor.awaitTermination(2, TimeUnit.SECONDS)
-        } catch (_: InterruptedException) {
-            executor.shutdownNow()
-        }
         configured = false
         super.invalidate()
     }
@@ -7,6 +7,10 @@
  *
  * When the sandbox requests "RNCAsyncStorage", this module can be resolved
  * instead, providing isolated key-value storage per sandbox origin.
+ *
+ * Data is kept in the append-only log of a SandboxKVStore in storageDirectory,
+ * shared with the Android module, so each batch costs the size of the batch
+ * rather than of the whole store.
  */
 
 #import <Foundation/Foundation.h>
@@ -3,6 +3,9 @@
  *
  * Based on the original RNCAsyncStorage from @react-native-async-storage/async-storage.
  * Scopes all storage to a per-origin directory to prevent data leaks between sandboxes.
+ * Values live in a SandboxKVStore log there, so a batch appends its own records instead of
+ * rewriting a manifest of the whole store. A manifest left by earlier versions is imported into the log
+ * the first time the store is opened.
  */
 
 #import "SandboxedRNCAsyncStorage.h"
@@ -11,8 +14,16 @@
 #import <React/RCTLog.h>
 #import <React/RCTUtils.h>
 
-static NSString *const RCTManifestFileName = @"manifest.json";
+#include <React-Sandbox/SandboxKVStore.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
 static const NSUInteger RCTInlineValueThreshold = 1024;
+// The manifest of the module's earlier versions; values above RCTInlineValueThreshold were kept next to it in files
+// named by the MD5 hash of their key
+static NSString *const RCTLegacyManifestFileName = @"manifest.json";
 
 #pragma mark - Static helper functions
 
@@ -51,34 +62,19 @@ static NSArray<NSDictionary *> *RCTMakeErrors(NSArray<id<NSObject>> *results)
     return errors;
 }
 
-static NSString *RCTReadFile(NSString *filePath, NSString *key, NSDictionary **errorOut)
+static std::string RCTStdString(NSString *string)
 {
-    if ([[NSFileManager defaultManager] fileExistsAtPath:filePath]) {
-        NSError *error;
-        NSStringEncoding encoding;
-        NSString *entryString = [NSString stringWithContentsOfFile:filePath
-                                                      usedEncoding:&encoding
-                                                             error:&error];
-        NSDictionary *extraData = @{@"key": RCTNullIfNil(key)};
-
-        if (error) {
-            if (errorOut) {
-                *errorOut = RCTMakeError(@"Failed to read storage file.", error, extraData);
-            }
-            return nil;
-        }
+    return std::string(string.UTF8String, [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+}
 
-        if (encoding != NSUTF8StringEncoding) {
-            if (errorOut) {
-                *errorOut =
-                    RCTMakeError(@"Incorrect encoding of storage file: ", @(encoding), extraData);
-            }
-            return nil;
-        }
-        return entryString;
-    }
+static NSString *RCTNSString(const std::string &string)
+{
+    return [[NSString alloc] initWithBytes:string.data() length:string.size() encoding:NSUTF8StringEncoding];
+}
 
-    return nil;
+static NSDictionary *RCTStoreError(NSString *message, const std::string &error, NSDictionary *extraData)
+{
+    return RCTMakeError(message, RCTNSString(error), extraData);
 }
 
 static BOOL RCTMergeRecursive(NSMutableDictionary *destination, NSDictionary *source)
@@ -109,9 +105,7 @@ static BOOL RCTMergeRecursive(NSMutableDictionary *destination, NSDictionary *so
 }
 
 #define RCTGetStorageDirectory() _storageDirectory
-#define RCTGetManifestFilePath() _manifestFilePath
 #define RCTGetMethodQueue() self.methodQueue
-#define RCTGetCache() self.cache
 
 static NSDictionary *RCTDeleteStorageDirectory(NSString *storageDirectory)
 {
@@ -124,18 +118,10 @@ static NSDictionary *RCTDeleteStorageDirectory(NSString *storageDirectory)
 
 #pragma mark - SandboxedRNCAsyncStorage
 
-@interface SandboxedRNCAsyncStorage ()
-
-@property (nonatomic, copy) NSString *manifestFilePath;
-
-@end
-
 @implementation SandboxedRNCAsyncStorage {
-    BOOL _haveSetup;
     BOOL _configured;
-    NSMutableDictionary<NSString *, NSString *> *_manifest;
-    NSCache *_cache;
-    dispatch_once_t _cacheOnceToken;
+    // Opened on the method queue by _ensureSetup and shared with the other modules on the same directory
+    std::shared_ptr<rnsandbox::SandboxKVStore> _store;
 }
 
 RCT_EXPORT_MODULE(SandboxedAsyncStorage)
@@ -144,7 +130,6 @@ RCT_EXPORT_MODULE(SandboxedAsyncStorage)
 {
     if ((self = [super init])) {
         _storageDirectory = storageDirectory;
-        _manifestFilePath = [_storageDirectory stringByAppendingPathComponent:RCTManifestFileName];
         _configured = YES;
     }
     return self;
@@ -155,27 +140,7 @@ RCT_EXPORT_MODULE(SandboxedAsyncStorage)
 - (void)setStorageDirectory:(NSString *)storageDirectory
 {
     _storageDirectory = [storageDirectory copy];
-    _manifestFilePath = [_storageDirectory stringByAppendingPathComponent:RCTManifestFileName];
-    _haveSetup = NO;
-    [_manifest removeAllObjects];
-    [_cache removeAllObjects];
-}
-
-- (NSCache *)cache
-{
-    dispatch_once(&_cacheOnceToken, ^{
-        _cache = [NSCache new];
-        _cache.totalCostLimit = 2 * 1024 * 1024; // 2MB
-
-        [[NSNotificationCenter defaultCenter]
-            addObserverForName:UIApplicationDidReceiveMemoryWarningNotification
-                       object:nil
-                        queue:nil
-                   usingBlock:^(__unused NSNotification *note) {
-                     [self->_cache removeAllObjects];
-                   }];
-    });
-    return _cache;
+    _store.reset();
 }
 
 + (BOOL)requiresMainQueueSetup
@@ -194,37 +159,44 @@ RCT_EXPORT_MODULE(SandboxedAsyncStorage)
 - (void)clearAllData
 {
     dispatch_async(RCTGetMethodQueue(), ^{
-        [self->_manifest removeAllObjects];
-        [RCTGetCache() removeAllObjects];
+        self->_store.reset();
         RCTDeleteStorageDirectory();
     });
 }
 
 - (void)invalidate
 {
-    if (_clearOnInvalidate) {
-        [RCTGetCache() removeAllObjects];
-        RCTDeleteStorageDirectory();
-    }
+    BOOL clearData = _clearOnInvalidate;
     _clearOnInvalidate = NO;
-    [_manifest removeAllObjects];
-    _haveSetup = NO;
+    dispatch_queue_t methodQueue = RCTGetMethodQueue();
+    if (!methodQueue) {
+        // No request ever ran, so no store was opened
+        if (clearData) {
+            RCTDeleteStorageDirectory();
+        }
+        return;
+    }
+    // A request may be using the store on the method queue right now
+    dispatch_async(methodQueue, ^{
+        self->_store.reset();
+        if (clearData) {
+            RCTDeleteStorageDirectory();
+        }
+    });
 }
 
 - (BOOL)isValid
 {
-    return _haveSetup;
+    return _store != nullptr;
 }
 
 - (void)dealloc
 {
-    [self invalidate];
-}
-
-- (NSString *)_filePathForKey:(NSString *)key
-{
-    NSString *safeFileName = RCTMD5Hash(key);
-    return [RCTGetStorageDirectory() stringByAppendingPathComponent:safeFileName];
+    // Every block queued on the method queue holds the module, so none is left to race with
+    _store.reset();
+    if (_clearOnInvalidate) {
+        RCTDeleteStorageDirectory();
+    }
 }
 
 - (NSDictionary *)_ensureSetup
@@ -245,64 +217,108 @@ RCT_EXPORT_MODULE(SandboxedAsyncStorage)
         return RCTMakeError(@"Failed to create storage directory.", error, nil);
     }
 
-    if (!_haveSetup) {
-        NSDictionary *errorOut = nil;
-        NSString *serialized = RCTReadFile(RCTGetManifestFilePath(), RCTManifestFileName, &errorOut);
-        if (!serialized) {
-            if (errorOut) {
-                RCTLogError(@"Could not open the existing manifest: %@", errorOut);
-                return errorOut;
-            } else {
-                _manifest = [NSMutableDictionary new];
-            }
-        } else {
-            _manifest = RCTJSONParseMutable(serialized, &error);
-            if (!_manifest) {
-                RCTLogError(@"Failed to parse manifest - creating a new one: %@", error);
-                _manifest = [NSMutableDictionary new];
-            }
+    if (!_store) {
+        rnsandbox::KVStoreOptions options;
+        options.inlineValueLimit = RCTInlineValueThreshold;
+        std::string storeError;
+        _store = rnsandbox::SandboxKVStore::openShared(RCTStdString(RCTGetStorageDirectory()), options, &storeError);
+        if (!_store) {
+            NSDictionary *errorOut = RCTStoreError(@"Failed to open storage.", storeError, nil);
+            RCTLogError(@"Could not open the storage log: %@", errorOut);
+            return errorOut;
         }
-        _haveSetup = YES;
+        [self _importLegacyStorage];
     }
 
     return nil;
 }
 
-- (NSDictionary *)_writeManifest:(NSMutableArray<NSDictionary *> *__autoreleasing *)errors
+/**
+ * Moves the manifest and value files the module wrote before the log into the store. Keys the store already has were
+ * written later and are kept. The legacy files are removed once the imported batch is durable; until then every open
+ * retries the import. Failures are logged and leave the store usable.
+ */
+- (void)_importLegacyStorage
 {
-    NSError *error;
-    NSString *serialized = RCTJSONStringify(_manifest, &error);
-    [serialized writeToFile:RCTGetManifestFilePath()
-                 atomically:YES
-                   encoding:NSUTF8StringEncoding
-                      error:&error];
-    NSDictionary *errorOut;
-    if (error) {
-        errorOut = RCTMakeError(@"Failed to write manifest file.", error, nil);
-        RCTAppendError(errorOut, errors);
+    // Other modules may share the directory on their own queues
+    @synchronized([SandboxedRNCAsyncStorage class]) {
+        NSString *manifestPath = [RCTGetStorageDirectory() stringByAppendingPathComponent:RCTLegacyManifestFileName];
+        NSData *data = [NSData dataWithContentsOfFile:manifestPath];
+        if (!data) {
+            return;
+        }
+        NSError *error = nil;
+        NSDictionary *manifest = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+        if (![manifest isKindOfClass:[NSDictionary class]]) {
+            RCTLogWarn(@"Could not parse %@, keeping it: %@", manifestPath, error);
+            return;
+        }
+
+        rnsandbox::KVBatch batch;
+        NSMutableArray<NSString *> *valueFiles = [NSMutableArray new];
+        std::string storeError;
+        for (NSString *key in manifest) {
+            if (![key isKindOfClass:[NSString class]]) {
+                continue;
+            }
+            NSString *filePath = [RCTGetStorageDirectory() stringByAppendingPathComponent:RCTMD5Hash(key)];
+            id value = manifest[key];
+            if (value == (id)kCFNull) {
+                [valueFiles addObject:filePath];
+                value = [NSString stringWithContentsOfFile:filePath encoding:NSUTF8StringEncoding error:&error];
+                if (!value) {
+                    RCTLogWarn(@"Could not read the value of %@, keeping %@: %@", key, manifestPath, error);
+                    return;
+                }
+            }
+            if (![value isKindOfClass:[NSString class]]) {
+                continue;
+            }
+            if (_store->get(RCTStdString(key), &storeError)) {
+                continue;
+            }
+            if (!storeError.empty()) {
+                RCTLogWarn(@"Could not import %@: %s", manifestPath, storeError.c_str());
+                return;
+            }
+            batch.put(RCTStdString(key), RCTStdString(value));
+        }
+
+        // The store fsyncs the batch before write() returns
+        if (!_store->write(batch, &storeError)) {
+            RCTLogWarn(@"Could not import %@: %s", manifestPath, storeError.c_str());
+            return;
+        }
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+        for (NSString *filePath in valueFiles) {
+            [fileManager removeItemAtPath:filePath error:nil];
+        }
+        [fileManager removeItemAtPath:manifestPath error:nil];
+    }
+}
+
+- (void)_writeBatch:(const rnsandbox::KVBatch &)batch errors:(NSMutableArray<NSDictionary *> *__autoreleasing *)errors
+{
+    std::string storeError;
+    if (!_store->write(batch, &storeError)) {
+        RCTAppendError(RCTStoreError(@"Failed to write storage log.", storeError, nil), errors);
     }
-    return errorOut;
 }
 
 - (NSString *)_getValueForKey:(NSString *)key errorOut:(NSDictionary *__autoreleasing *)errorOut
 {
-    NSString *value = _manifest[key];
-    if (value == (id)kCFNull) {
-        value = [RCTGetCache() objectForKey:key];
-        if (!value) {
-            NSString *filePath = [self _filePathForKey:key];
-            value = RCTReadFile(filePath, key, errorOut);
-            if (value) {
-                [RCTGetCache() setObject:value forKey:key cost:value.length];
-            } else {
-                [_manifest removeObjectForKey:key];
-            }
+    std::string storeError;
+    auto value = _store->get(RCTStdString(key), &storeError);
+    if (!value) {
+        if (!storeError.empty() && errorOut) {
+            *errorOut = RCTStoreError(@"Failed to read value.", storeError, @{@"key": key});
         }
+        return nil;
     }
-    return value;
+    return RCTNSString(*value);
 }
 
-- (NSDictionary *)_writeEntry:(NSArray<NSString *> *)entry changedManifest:(BOOL *)changedManifest
+- (NSDictionary *)_writeEntry:(NSArray<NSString *> *)entry toBatch:(rnsandbox::KVBatch &)batch
 {
     if (entry.count != 2) {
         return RCTMakeAndLogError(
@@ -314,26 +330,11 @@ RCT_EXPORT_MODULE(SandboxedAsyncStorage)
         return errorOut;
     }
     NSString *value = entry[1];
-    NSString *filePath = [self _filePathForKey:key];
-    NSError *error;
-    if (value.length <= RCTInlineValueThreshold) {
-        if (_manifest[key] == (id)kCFNull) {
-            [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
-            [RCTGetCache() removeObjectForKey:key];
-        }
-        *changedManifest = YES;
-        _manifest[key] = value;
-        return nil;
-    }
-    [value writeToFile:filePath atomically:YES encoding:NSUTF8StringEncoding error:&error];
-    [RCTGetCache() setObject:value forKey:key cost:value.length];
-    if (error) {
-        errorOut = RCTMakeError(@"Failed to write value.", error, @{@"key": key});
-    } else if (_manifest[key] != (id)kCFNull) {
-        *changedManifest = YES;
-        _manifest[key] = (id)kCFNull;
+    if (![value isKindOfClass:[NSString class]]) {
+        return RCTMakeAndLogError(@"Invalid value - must be a string.  Value: ", value, @{@"key": key});
     }
-    return errorOut;
+    batch.put(RCTStdString(key), RCTStdString(value));
+    return nil;
 }
 
 - (void)_multiGet:(NSArray<NSString *> *)keys
@@ -433,15 +434,13 @@ RCT_EXPORT_METHOD(multiSet:(NSArray<NSArray<NSString *> *> *)kvPairs
         callback(@[@[errorOut]]);
         return;
     }
-    BOOL changedManifest = NO;
+    rnsandbox::KVBatch batch;
     NSMutableArray<NSDictionary *> *errors;
     for (NSArray<NSString *> *entry in kvPairs) {
-        NSDictionary *keyError = [self _writeEntry:entry changedManifest:&changedManifest];
+        NSDictionary *keyError = [self _writeEntry:entry toBatch:batch];
         RCTAppendError(keyError, &errors);
     }
-    if (changedManifest) {
-        [self _writeManifest:&errors];
-    }
+    [self _writeBatch:batch errors:&errors];
     callback(@[RCTNullIfNil(errors)]);
 }
 
@@ -474,11 +473,13 @@ RCT_EXPORT_METHOD(multiMerge:(NSArray<NSArray<NSString *> *> *)kvPairs
         callback(@[@[errorOut]]);
         return;
     }
-    BOOL changedManifest = NO;
+    rnsandbox::KVBatch batch;
+    // Values merged earlier in this call, which the store sees only once the batch is written
+    NSMutableDictionary<NSString *, NSString *> *merged = [NSMutableDictionary new];
     NSMutableArray<NSDictionary *> *errors;
     for (__strong NSArray<NSString *> *entry in kvPairs) {
         NSDictionary *keyError;
-        NSString *value = [self _getValueForKey:entry[0] errorOut:&keyError];
+        NSString *value = merged[entry[0]] ?: [self _getValueForKey:entry[0] errorOut:&keyError];
         if (!keyError) {
             if (value) {
                 NSError *jsonError;
@@ -492,14 +493,15 @@ RCT_EXPORT_METHOD(multiMerge:(NSArray<NSArray<NSString *> *> *)kvPairs
                 }
             }
             if (!keyError) {
-                keyError = [self _writeEntry:entry changedManifest:&changedManifest];
+                keyError = [self _writeEntry:entry toBatch:batch];
+            }
+            if (!keyError) {
+                merged[entry[0]] = entry[1];
             }
         }
         RCTAppendError(keyError, &errors);
     }
-    if (changedManifest) {
-        [self _writeManifest:&errors];
-    }
+    [self _writeBatch:batch errors:&errors];
     callback(@[RCTNullIfNil(errors)]);
 }
 
@@ -525,26 +527,16 @@ RCT_EXPORT_METHOD(multiRemove:(NSArray<NSString *> *)keys
         callback(@[@[errorOut]]);
         return;
     }
+    rnsandbox::KVBatch batch;
     NSMutableArray<NSDictionary *> *errors;
-    BOOL changedManifest = NO;
     for (NSString *key in keys) {
         NSDictionary *keyError = RCTErrorForKey(key);
         if (!keyError) {
-            if (_manifest[key] == (id)kCFNull) {
-                NSString *filePath = [self _filePathForKey:key];
-                [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
-                [RCTGetCache() removeObjectForKey:key];
-            }
-            if (_manifest[key]) {
-                changedManifest = YES;
-                [_manifest removeObjectForKey:key];
-            }
+            batch.remove(RCTStdString(key));
         }
         RCTAppendError(keyError, &errors);
     }
-    if (changedManifest) {
-        [self _writeManifest:&errors];
-    }
+    [self _writeBatch:batch errors:&errors];
     callback(@[RCTNullIfNil(errors)]);
 }
 
@@ -563,9 +555,11 @@ RCT_EXPORT_METHOD(clear:(RCTResponseSenderBlock)callback)
         return;
     }
 
-    [_manifest removeAllObjects];
-    [RCTGetCache() removeAllObjects];
-    NSDictionary *error = RCTDeleteStorageDirectory();
+    NSDictionary *error = [self _ensureSetup];
+    std::string storeError;
+    if (!error && !_store->clear(&storeError)) {
+        error = RCTStoreError(@"Failed to clear storage.", storeError, nil);
+    }
     callback(@[RCTNullIfNil(error)]);
 }
 
@@ -587,7 +581,12 @@ RCT_EXPORT_METHOD(getAllKeys:(RCTResponseSenderBlock)callback)
     if (errorOut) {
         callback(@[errorOut, (id)kCFNull]);
     } else {
-        callback(@[(id)kCFNull, _manifest.allKeys]);
+        std::vector<std::string> keys = _store->keys();
+        NSMutableArray<NSString *> *allKeys = [NSMutableArray arrayWithCapacity:keys.size()];
+        for (const auto &key : keys) {
+            [allKeys addObject:RCTNSString(key)];
+        }
+        callback(@[(id)kCFNull, allKeys]);
     }
 }
 
@@ -28,7 +28,11 @@ RCT_EXPORT_MODULE(SandboxedRNFSManager)
 - (dispatch_queue_t)methodQueue
 {
     if (!_methodQueue) {
-        _methodQueue = dispatch_queue_create("sandbox.rnfs", DISPATCH_QUEUE_SERIAL);
+        // Serial, but without a thread of its own: shares the global queue's
+        // threads with the other sandboxes' modules
+        _methodQueue = dispatch_queue_create_with_target(
+            "sandbox.rnfs", DISPATCH_QUEUE_SERIAL,
+            dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
     }
     return _methodQueue;
 }
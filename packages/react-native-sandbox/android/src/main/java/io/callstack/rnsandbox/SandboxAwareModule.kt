@@ -1,5 +1,23 @@
 package io.callstack.rnsandbox
 
+/**
+ * How many sandboxes share one instance of a substituted module. Mirrors rnsandbox::ModuleSharing; the ordinals
+ * are passed to native code.
+ */
+enum class SandboxModuleSharing {
+    /** An instance per sandbox, configured with its origin. The default. */
+    PER_SANDBOX,
+
+    /** One instance per origin, configured with the first sandbox's names. */
+    PER_ORIGIN,
+
+    /** One instance per group returned by [SandboxAwareModule.sandboxSharingGroup]. */
+    PER_GROUP,
+
+    /** One instance for the process. The module must behave the same for every origin. */
+    PER_PROCESS,
+}
+
 /**
  * Interface for native modules that need sandbox-specific configuration.
  *
@@ -25,4 +43,19 @@ interface SandboxAwareModule {
         requestedName: String,
         resolvedName: String,
     )
+
+    /**
+     * How many sandboxes share an instance of this module. A shared instance is created and configured by the
+     * first sandbox to resolve it, and released with the last sandbox using it. It stays bound to the first
+     * sandbox's React context, so it must not emit events, and it may be invalidated by a host tearing down while
+     * other sandboxes still use it. Read once, from the first instance.
+     */
+    val sandboxModuleSharing: SandboxModuleSharing
+        get() = SandboxModuleSharing.PER_SANDBOX
+
+    /**
+     * The group an origin's sandboxes share an instance in under [SandboxModuleSharing.PER_GROUP]; null shares per
+     * origin.
+     */
+    fun sandboxSharingGroup(origin: String): String? = null
 }
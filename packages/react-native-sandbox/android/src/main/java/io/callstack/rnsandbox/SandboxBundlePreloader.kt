@@ -0,0 +1,192 @@
+package io.callstack.rnsandbox
+
+import android.content.Context
+import android.util.Log
+import java.io.File
+import java.io.IOException
+import java.net.HttpURLConnection
+import java.net.URL
+import java.security.MessageDigest
+
+/**
+ * Loads sandbox bundles in the background before their views exist,
+ * typically from Application.onCreate():
+ * ```
+ * SandboxBundlePreloader.preload(this, listOf("https://cdn.example.com/a.bundle", "b.bundle"))
+ * ```
+ * Remote bundles are downloaded and asset bundles are copied out of the APK
+ * into the cache directory; a sandbox whose jsBundleSource finished preloading
+ * then starts from that file, waiting for a copy still in flight instead of
+ * starting a second one. Loaded from a file, a Hermes bytecode bundle is
+ * mapped, so its pages are shared by every runtime that loads it.
+ *
+ * A remote bundle that is already cached is updated from a binary patch
+ * at `<url>.patches/<SHA-256 of the cached copy>` when the server has one,
+ * and downloaded whole otherwise.
+ *
+ * Loading runs on the native preloader's bounded thread pool, shared with iOS.
+ */
+object SandboxBundlePreloader {
+    private const val TAG = "SandboxBundlePreloader"
+    private const val CACHE_DIRECTORY = "rnsandbox-bundles"
+    private const val CONNECT_TIMEOUT_MS = 15_000
+    private const val READ_TIMEOUT_MS = 60_000
+
+    @Volatile
+    private var appContext: Context? = null
+
+    /**
+     * Starts loading every source that is not loading or loaded yet.
+     *
+     * @param sources jsBundleSource values, as passed to SandboxReactNativeView
+     */
+    @JvmStatic
+    fun preload(
+        context: Context,
+        sources: List<String>,
+    ) {
+        install(context)
+        SandboxJSIInstaller.nativePreloadBundles(sources.toTypedArray())
+    }
+
+    /** How many bundles are loaded at once. Defaults to 4. */
+    @JvmStatic
+    fun setMaxConcurrentLoads(count: Int) {
+        SandboxJSIInstaller.nativeSetPreloadConcurrency(count)
+    }
+
+    /**
+     * Path of the preloaded bundle, waiting up to timeoutMs if it is still
+     * loading. Null if the source was never preloaded or failed.
+     */
+    internal fun awaitPreloaded(
+        source: String,
+        timeoutMs: Long,
+    ): String? = SandboxJSIInstaller.nativeAwaitPreloadedBundle(source, timeoutMs)
+
+    @Synchronized
+    private fun install(context: Context) {
+        if (appContext != null) return
+        appContext = context.applicationContext
+        SandboxJSIInstaller.nativeInstallBundlePreloader(this)
+    }
+
+    /**
+     * Called by the native preloader on its worker threads.
+     *
+     * @return Path of the verified bundle
+     * @throws IOException if it cannot be loaded
+     */
+    fun fetch(source: String): String {
+        val context = appContext ?: throw IllegalStateException("Preloader is not installed")
+        return if (isRemote(source)) download(context, source) else extractAsset(context, source)
+    }
+
+    internal fun isRemote(source: String): Boolean = source.startsWith("http://") || source.startsWith("https://")
+
+    private fun download(
+        context: Context,
+        source: String,
+    ): String {
+        val file = cacheFile(context, source)
+        if (patchCachedBundle(source, file)) return file.path
+
+        val partial = File(file.parentFile, "${file.name}.part")
+        val status = downloadTo(source, partial)
+        if (status !in 200..299) {
+            partial.delete()
+            throw IOException("HTTP $status for $source")
+        }
+        return commit(partial, file, source)
+    }
+
+    /**
+     * Updates a cached copy of source from `<source>.patches/<SHA-256 of the
+     * copy>`, if the server has such a patch. False if the bundle has to be
+     * downloaded whole.
+     */
+    private fun patchCachedBundle(
+        source: String,
+        file: File,
+    ): Boolean {
+        if (!file.exists()) return false
+        val hash = SandboxJSIInstaller.nativeHashBundleFile(file.path) ?: return false
+        val patch = File(file.parentFile, "${file.name}.patch")
+        try {
+            if (downloadTo("$source.patches/$hash", patch) !in 200..299) return false
+            // Streams the patch; the cached copy is replaced only once the result verifies
+            val error = SandboxJSIInstaller.nativeApplyBundlePatch(file.path, patch.path, file.path) ?: return true
+            Log.w(TAG, "Patch for $source failed, downloading it whole: $error")
+            return false
+        } catch (e: IOException) {
+            Log.w(TAG, "Patch for $source failed, downloading it whole: $e")
+            return false
+        } finally {
+            patch.delete()
+        }
+    }
+
+    /** @return HTTP status; the body is only written for a 2xx one */
+    private fun downloadTo(
+        url: String,
+        file: File,
+    ): Int {
+        val connection = URL(url).openConnection() as HttpURLConnection
+        try {
+            connection.connectTimeout = CONNECT_TIMEOUT_MS
+            connection.readTimeout = READ_TIMEOUT_MS
+            val status = connection.responseCode
+            if (status in 200..299) {
+                connection.inputStream.use { input ->
+                    file.outputStream().use { output -> input.copyTo(output) }
+                }
+            }
+            return status
+        } finally {
+            connection.disconnect()
+        }
+    }
+
+    private fun extractAsset(
+        context: Context,
+        source: String,
+    ): String {
+        val file = cacheFile(context, source)
+        val partial = File(file.parentFile, "${file.name}.part")
+        context.assets.open(source).use { input ->
+            partial.outputStream().use { output -> input.copyTo(output) }
+        }
+        return commit(partial, file, source)
+    }
+
+    private fun cacheFile(
+        context: Context,
+        source: String,
+    ): File {
+        val directory = File(context.cacheDir, CACHE_DIRECTORY).apply { mkdirs() }
+        return File(directory, "${hash(source)}.bundle")
+    }
+
+    private fun commit(
+        partial: File,
+        file: File,
+        source: String,
+    ): String {
+        if (partial.length() == 0L) {
+            partial.delete()
+            throw IOException("Empty bundle from $source")
+        }
+        if (!partial.renameTo(file)) {
+            partial.delete()
+            throw IOException("Could not write ${file.path}")
+        }
+        return file.path
+    }
+
+    private fun hash(source: String): String =
+        MessageDigest
+            .getInstance("SHA-256")
+            .digest(source.toByteArray())
+            .take(8)
+            .joinToString("") { "%02x".format(it) }
+}
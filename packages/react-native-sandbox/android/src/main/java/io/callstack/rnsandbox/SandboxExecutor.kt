@@ -0,0 +1,46 @@
+package io.callstack.rnsandbox
+
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.Executor
+
+/**
+ * A bounded thread pool shared by every sandbox, for substituted native modules that would otherwise start an
+ * executor of their own per instance. Each origin and module gets a serial lane on it:
+ * ```
+ * private lateinit var executor: Executor
+ *
+ * override fun configureSandbox(origin: String, requestedName: String, resolvedName: String) {
+ *     executor = SandboxExecutor.strand(origin, MODULE_NAME)
+ * }
+ * ```
+ * Tasks on one lane run one at a time in the order they were posted; lanes share a few pool threads, which start
+ * on demand and exit when idle. The pool lives in native code, shared with iOS, and its per-lane queue metrics are
+ * reported by [SandboxReactNativeDelegate.methodQueueStatsJson].
+ */
+object SandboxExecutor {
+    private class Strand(
+        private val handle: Long,
+    ) : Executor {
+        override fun execute(command: Runnable) {
+            SandboxJSIInstaller.nativePostToStrand(handle, command)
+        }
+    }
+
+    private val strands = ConcurrentHashMap<String, Executor>()
+
+    /** The serial lane of module in origin. Instances of a module in sandboxes of the same origin share it. */
+    @JvmStatic
+    fun strand(
+        origin: String,
+        module: String,
+    ): Executor =
+        strands.getOrPut("$origin/$module") {
+            Strand(SandboxJSIInstaller.nativeGetStrand("$origin/$module"))
+        }
+
+    /** Upper bound of pool threads. Defaults to the core count, clamped to 2..4. */
+    @JvmStatic
+    fun setMaxThreads(threads: Int) {
+        SandboxJSIInstaller.nativeSetExecutorThreads(threads)
+    }
+}
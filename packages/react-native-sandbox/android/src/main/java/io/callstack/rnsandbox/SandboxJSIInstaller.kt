@@ -25,16 +25,18 @@ object SandboxJSIInstaller {
     ): Long
 
     /**
-     * Delivers a JSON message to the sandbox's JS onMessage callback.
-     * Must be called on the JS thread.
+     * Queues a JSON message for the sandbox's JS onMessage callback. Safe to
+     * call from any thread; delivery happens on the JS thread, urgent first.
      *
      * @param stateHandle Handle returned by nativeInstall
      * @param message JSON-serialized message string
+     * @param urgent Deliver through the urgent lane instead of the bulk lane
      */
     @JvmStatic
     external fun nativePostMessage(
         stateHandle: Long,
         message: String,
+        urgent: Boolean,
     )
 
     /**
@@ -53,4 +55,502 @@ object SandboxJSIInstaller {
      */
     @JvmStatic
     external fun nativeInstallErrorHandler(stateHandle: Long)
+
+    /**
+     * Runs work queued by native code for the sandbox JS thread, such as
+     * message port deliveries. Must be called on the JS thread.
+     *
+     * @param stateHandle Handle returned by nativeInstall
+     */
+    @JvmStatic
+    external fun nativeRunScheduledTasks(stateHandle: Long)
+
+    /**
+     * Updates the origins this sandbox may send messages to. Safe to call
+     * from any thread.
+     *
+     * @param stateHandle Handle returned by nativeInstall
+     * @param allowedOrigins Target origins permitted for this sandbox
+     */
+    @JvmStatic
+    external fun nativeSetAllowedOrigins(
+        stateHandle: Long,
+        allowedOrigins: Array<String>,
+    )
+
+    /**
+     * Updates the shared state keys this sandbox may read and write. Entries
+     * are exact keys or prefix patterns ending in `*`. Safe to call from any
+     * thread.
+     *
+     * @param stateHandle Handle returned by nativeInstall
+     * @param readKeys Readable keys
+     * @param writeKeys Writable keys
+     */
+    @JvmStatic
+    external fun nativeSetSharedStateAccess(
+        stateHandle: Long,
+        readKeys: Array<String>,
+        writeKeys: Array<String>,
+    )
+
+    /**
+     * Writes a key of the process-wide shared state store on behalf of the
+     * host app, bypassing the sandboxes' key lists.
+     *
+     * @param key Key to write
+     * @param value JSON-serialized value, or an empty string to delete the key
+     */
+    @JvmStatic
+    external fun nativeSetSharedState(
+        key: String,
+        value: String,
+    )
+
+    /**
+     * Creates the hibernation state of a sandbox view. It outlives the
+     * view's runtimes and is read back by nativeInstall through the
+     * delegate's `hibernationHandle` field.
+     *
+     * @param delegate Receives onHibernated and onHibernationWakeRequest
+     * @return A handle for the other hibernation calls
+     */
+    @JvmStatic
+    external fun nativeCreateHibernation(delegate: SandboxReactNativeDelegate): Long
+
+    /**
+     * Frees the hibernation state, unregistering the sandbox if it is still
+     * hibernated.
+     *
+     * @param hibernationHandle Handle returned by nativeCreateHibernation
+     */
+    @JvmStatic
+    external fun nativeDestroyHibernation(hibernationHandle: Long)
+
+    /**
+     * @param hibernationHandle Handle returned by nativeCreateHibernation
+     * @param policy "queue", "urgent" or "any"
+     */
+    @JvmStatic
+    external fun nativeSetHibernationWakePolicy(
+        hibernationHandle: Long,
+        policy: String,
+    )
+
+    /**
+     * Takes the sandbox's state snapshot on its JS thread and parks its
+     * undelivered messages, then calls the delegate's onHibernated from the
+     * JS thread. The caller releases the runtime there.
+     *
+     * @param stateHandle Handle returned by nativeInstall, or 0 if none
+     * @param hibernationHandle Handle returned by nativeCreateHibernation
+     * @return false if the sandbox is not active
+     */
+    @JvmStatic
+    external fun nativeHibernate(
+        stateHandle: Long,
+        hibernationHandle: Long,
+    ): Boolean
+
+    /**
+     * @param hibernationHandle Handle returned by nativeCreateHibernation
+     * @return true if the caller must now rebuild the runtime
+     */
+    @JvmStatic
+    external fun nativeResume(hibernationHandle: Long): Boolean
+
+    /**
+     * Keeps a host message for the next runtime while the sandbox is
+     * hibernated. Ignored otherwise.
+     *
+     * @param hibernationHandle Handle returned by nativeCreateHibernation
+     * @param message JSON-serialized message string
+     * @param urgent Deliver through the urgent lane instead of the bulk lane
+     */
+    @JvmStatic
+    external fun nativeParkMessage(
+        hibernationHandle: Long,
+        message: String,
+        urgent: Boolean,
+    )
+
+    /**
+     * Starts tracking a sandbox view in the process-wide memory governor.
+     * nativeInstall reads the id back through the delegate's
+     * `memoryGovernorId` field.
+     *
+     * @param delegate Receives onMemoryEviction
+     * @return The sandbox's id in the governor
+     */
+    @JvmStatic
+    external fun nativeAddToMemoryGovernor(delegate: SandboxReactNativeDelegate): Long
+
+    /**
+     * @param memoryGovernorId Id returned by nativeAddToMemoryGovernor
+     */
+    @JvmStatic
+    external fun nativeRemoveFromMemoryGovernor(memoryGovernorId: Long)
+
+    /**
+     * @param memoryGovernorId Id returned by nativeAddToMemoryGovernor
+     * @param bytes Soft JS heap limit, 0 for none
+     */
+    @JvmStatic
+    external fun nativeSetHeapLimit(
+        memoryGovernorId: Long,
+        bytes: Long,
+    )
+
+    /**
+     * @param memoryGovernorId Id returned by nativeAddToMemoryGovernor
+     * @param policy "hibernate" or "never"
+     */
+    @JvmStatic
+    external fun nativeSetEvictionPolicy(
+        memoryGovernorId: Long,
+        policy: String,
+    )
+
+    /**
+     * Forwards OS memory pressure to the governor. Critical pressure evicts
+     * the least recently used sandboxes, any level collects garbage.
+     */
+    @JvmStatic
+    external fun nativeOnMemoryPressure(critical: Boolean)
+
+    /**
+     * @param stateHandle Handle returned by nativeInstall
+     * @param timeoutMs How long one host-dispatched JS task may run before
+     * the watchdog interrupts it, 0 to disable. No effect while the runtime's
+     * watchdog is unarmed, which nativeInstall leaves it on Android.
+     */
+    @JvmStatic
+    external fun nativeSetWatchdogTimeout(
+        stateHandle: Long,
+        timeoutMs: Int,
+    )
+
+    /**
+     * JSON snapshot of JS thread time per origin and category, see
+     * SandboxCpuAccounting.h.
+     */
+    @JvmStatic
+    external fun nativeGetCpuUsageJson(): String
+
+    /**
+     * Creates a startup timeline and records VIEW_CREATED on it. Each phase is
+     * also emitted as a systrace section. nativeInstall reads the handle back
+     * through the delegate's `startupTimelineHandle` field.
+     *
+     * @return Handle for the other startup timeline calls
+     */
+    @JvmStatic
+    external fun nativeCreateStartupTimeline(): Long
+
+    /**
+     * @param timelineHandle Handle returned by nativeCreateStartupTimeline
+     */
+    @JvmStatic
+    external fun nativeDestroyStartupTimeline(timelineHandle: Long)
+
+    /**
+     * Forgets every phase and starts timing again.
+     *
+     * @param timelineHandle Handle returned by nativeCreateStartupTimeline
+     */
+    @JvmStatic
+    external fun nativeRestartStartupTimeline(timelineHandle: Long)
+
+    /**
+     * @param timelineHandle Handle returned by nativeCreateStartupTimeline
+     * @param phase Ordinal of a StartupPhase
+     * @return true if the phase was not recorded before
+     */
+    @JvmStatic
+    external fun nativeMarkStartupPhase(
+        timelineHandle: Long,
+        phase: Int,
+    ): Boolean
+
+    /**
+     * @param timelineHandle Handle returned by nativeCreateStartupTimeline
+     * @return Milliseconds since the start per StartupPhase ordinal, -1 for
+     * phases not reached
+     */
+    @JvmStatic
+    external fun nativeGetStartupTimeline(timelineHandle: Long): DoubleArray
+
+    /**
+     * Installs the fetcher the bundle preloader's worker threads call.
+     *
+     * @param fetcher Object with a `fetch(source: String): String` method
+     * returning the bundle's path, or throwing if it cannot be loaded
+     */
+    @JvmStatic
+    external fun nativeInstallBundlePreloader(fetcher: SandboxBundlePreloader)
+
+    /**
+     * Starts loading every source that is not loading or loaded yet.
+     */
+    @JvmStatic
+    external fun nativePreloadBundles(sources: Array<String>)
+
+    /**
+     * @param threads Most bundles loaded at once, at least 1
+     */
+    @JvmStatic
+    external fun nativeSetPreloadConcurrency(threads: Int)
+
+    /**
+     * Waits up to timeoutMs for a source that is queued or loading.
+     *
+     * @return Path of the preloaded bundle, null if it was never preloaded,
+     * failed or is still loading
+     */
+    @JvmStatic
+    external fun nativeAwaitPreloadedBundle(
+        source: String,
+        timeoutMs: Long,
+    ): String?
+
+    /** Hex SHA-256 of a bundle file, null if it cannot be read. */
+    @JvmStatic
+    external fun nativeHashBundleFile(path: String): String?
+
+    /**
+     * Streams a bundle patch file against basePath and atomically replaces
+     * outputPath (which may be basePath) once the result verifies.
+     *
+     * @return Error message, null on success
+     */
+    @JvmStatic
+    external fun nativeApplyBundlePatch(
+        basePath: String,
+        patchPath: String,
+        outputPath: String,
+    ): String?
+
+    /**
+     * Evaluates bundle files in the sandbox's running runtime, in order, in
+     * place of its current bundle. Must run on the JS thread with the surface
+     * stopped; drops the callbacks the old bundle handed to the sandbox
+     * globals, including onMessage, and closes its message channels.
+     *
+     * @param sourceUrls Source URL of each file, for stack traces
+     * @return Error of the first bundle that failed, null on success. Once a
+     * bundle failed, every later call fails too: the runtime must be reloaded
+     */
+    @JvmStatic
+    external fun nativeEvaluateBundles(
+        stateHandle: Long,
+        paths: Array<String>,
+        sourceUrls: Array<String>,
+    ): String?
+
+    /**
+     * Installs the listener the runtime parking lot calls, from any thread,
+     * once a parked runtime must be torn down.
+     *
+     * @param listener Object with an `onParkedRuntimeReleased(id: Long)` method
+     */
+    @JvmStatic
+    external fun nativeInstallRuntimeParking(listener: SandboxRuntimeParking)
+
+    /**
+     * @param maxRuntimes Parked runtimes kept at once, 0 disables parking
+     * @param maxBytes Sum of the parked runtimes' last heap samples
+     */
+    @JvmStatic
+    external fun nativeSetParkingBudget(
+        maxRuntimes: Int,
+        maxBytes: Long,
+        gracePeriodMs: Long,
+    )
+
+    /**
+     * Parks the runtime of a sandbox, evicting older ones to fit the budget.
+     *
+     * @return Its park id, 0 if it does not fit and must be destroyed
+     */
+    @JvmStatic
+    external fun nativeParkRuntime(
+        key: String,
+        memoryGovernorId: Long,
+    ): Long
+
+    /**
+     * Removes the most recently parked runtime for key from the lot.
+     *
+     * @return Its park id, 0 if there is none
+     */
+    @JvmStatic
+    external fun nativeTakeParkedRuntime(key: String): Long
+
+    @JvmStatic
+    external fun nativeReleaseParkedRuntime(parkId: Long)
+
+    /** Releases the runtimes parked for longer than the grace period. */
+    @JvmStatic
+    external fun nativeExpireParkedRuntimes()
+
+    /**
+     * What a lazy sandbox view does with its runtime at its position.
+     *
+     * @param view x, y, width and height of the view in window pixels
+     * @param viewport The visible part of the window the view is in, null if
+     * none of it is visible
+     * @return 0 for nothing, 1 to start the runtime, 2 to release it
+     */
+    @JvmStatic
+    external fun nativeNextLazyLoadAction(
+        started: Boolean,
+        view: FloatArray,
+        viewport: FloatArray?,
+        loadDistance: Float,
+        releaseDistance: Float,
+    ): Int
+
+    /**
+     * The shared executor's serial lane for label, created on first use and
+     * kept for the life of the process.
+     *
+     * @return A handle for nativePostToStrand
+     */
+    @JvmStatic
+    external fun nativeGetStrand(label: String): Long
+
+    /** Runs task on a pool thread after the tasks posted to strand before it. */
+    @JvmStatic
+    external fun nativePostToStrand(
+        strand: Long,
+        task: Runnable,
+    )
+
+    @JvmStatic
+    external fun nativeSetExecutorThreads(threads: Int)
+
+    /**
+     * JSON snapshot of every lane's queue metrics, keyed by lane label, see
+     * SandboxExecutor.h.
+     */
+    @JvmStatic
+    external fun nativeGetMethodQueueStatsJson(): String
+
+    /**
+     * The key sandboxes share a module instance under, see moduleSharingScope
+     * in SandboxModuleSharing.h. Empty if the module is not shared.
+     *
+     * @param sharing A [SandboxModuleSharing] ordinal
+     */
+    @JvmStatic
+    external fun nativeModuleSharingScope(
+        sharing: Int,
+        origin: String,
+        group: String?,
+    ): String
+
+    /**
+     * The module instance shared under scope, adding candidate if there is
+     * none. Balanced by nativeReleaseSharedModule when it returns an instance.
+     *
+     * @param candidate null to only look up
+     */
+    @JvmStatic
+    external fun nativeAcquireSharedModule(
+        module: String,
+        scope: String,
+        candidate: Any?,
+    ): Any?
+
+    /** @return true if this was the instance's last user */
+    @JvmStatic
+    external fun nativeReleaseSharedModule(
+        module: String,
+        scope: String,
+    ): Boolean
+
+    /**
+     * Runs a realm's bundle in the sandbox runtime under its own origin. Must
+     * be called on the JS thread after the sandbox's bundle has loaded.
+     *
+     * @param stateHandle Handle returned by nativeInstall
+     * @param path Local file of the realm's JavaScript source
+     * @param hostConfiguredModules Host modules configured for the host's
+     * origin, which the realm may not load
+     * @return null on success, otherwise the error
+     */
+    @JvmStatic
+    external fun nativeStartRealm(
+        stateHandle: Long,
+        origin: String,
+        path: String,
+        sourceUrl: String,
+        allowedTurboModules: Array<String>,
+        allowedOrigins: Array<String>,
+        substitutionKeys: Array<String>,
+        substitutionValues: Array<String>,
+        hostConfiguredModules: Array<String>,
+    ): String?
+
+    /**
+     * Stops and unregisters every realm of the sandbox runtime.
+     *
+     * @param stateHandle Handle returned by nativeInstall
+     */
+    @JvmStatic
+    external fun nativeClearRealms(stateHandle: Long)
+
+    /**
+     * Opens or creates a key-value store log in directory, or shares the one
+     * already open there.
+     *
+     * @return A store handle for the nativeKVStore functions
+     * @throws java.io.IOException if the log cannot be opened, or another
+     * process has it open
+     */
+    @JvmStatic
+    external fun nativeOpenKVStore(directory: String): Long
+
+    @JvmStatic
+    external fun nativeCloseKVStore(storeHandle: Long)
+
+    /** @return The value of each key, null where it is absent */
+    @JvmStatic
+    external fun nativeKVStoreGet(
+        storeHandle: Long,
+        keys: Array<String>,
+    ): Array<String?>
+
+    /**
+     * Writes keys[i] = values[i] in order as one batch; a null value removes
+     * the key.
+     *
+     * @return null on success, otherwise the error
+     */
+    @JvmStatic
+    external fun nativeKVStoreWrite(
+        storeHandle: Long,
+        keys: Array<String>,
+        values: Array<String?>,
+    ): String?
+
+    /**
+     * Writes each keys[i], values[i] pair as its own batch, as
+     * nativeKVStoreWrite does, making them all durable with one fsync.
+     *
+     * @return Per batch, null on success, otherwise its error
+     */
+    @JvmStatic
+    external fun nativeKVStoreWriteGroup(
+        storeHandle: Long,
+        keys: Array<Array<String>>,
+        values: Array<Array<String?>>,
+    ): Array<String?>
+
+    @JvmStatic
+    external fun nativeKVStoreKeys(storeHandle: Long): Array<String>
+
+    /** @return null on success, otherwise the error */
+    @JvmStatic
+    external fun nativeKVStoreClear(storeHandle: Long): String?
 }
@@ -0,0 +1,87 @@
+package io.callstack.rnsandbox
+
+import java.io.Closeable
+import java.io.File
+import java.io.IOException
+
+/**
+ * A key-value store kept as an append-only log in one directory, for sandboxed AsyncStorage modules. Each write
+ * appends one batch, so its cost is that of the batch rather than the whole store, and a batch torn by a crash is
+ * dropped whole when the store is reopened. The engine lives in native code, shared with iOS.
+ * ```
+ * store = SandboxKeyValueStore.open(File(context.filesDir, "Sandboxes/$origin/AsyncStorage"))
+ * store.write(arrayOf("theme", "draft"), arrayOf("dark", null)) // sets theme, removes draft
+ * ```
+ * Thread-safe; calls on a closed store throw [IllegalStateException].
+ */
+class SandboxKeyValueStore private constructor(
+    private var handle: Long,
+) : Closeable {
+    companion object {
+        /**
+         * Opens or creates the store in directory, creating the directory itself but not its parents. Stores opened on
+         * the same directory share one log, which stays open until the last of them is closed.
+         */
+        @JvmStatic
+        @Throws(IOException::class)
+        fun open(directory: File): SandboxKeyValueStore =
+            SandboxKeyValueStore(SandboxJSIInstaller.nativeOpenKVStore(directory.path))
+    }
+
+    /** The value of each key, null where it is absent. */
+    @Synchronized
+    fun get(keys: Array<String>): Array<String?> = SandboxJSIInstaller.nativeKVStoreGet(checkOpen(), keys)
+
+    /** Sets keys[i] to values[i] in order as one batch, all or nothing; a null value removes the key. */
+    @Synchronized
+    @Throws(IOException::class)
+    fun write(
+        keys: Array<String>,
+        values: Array<String?>,
+    ) {
+        require(keys.size == values.size) { "Expected as many values as keys" }
+        if (keys.isEmpty()) return
+        SandboxJSIInstaller.nativeKVStoreWrite(checkOpen(), keys, values)?.let { throw IOException(it) }
+    }
+
+    /**
+     * Group commit: writes each keys[i], values[i] pair as its own batch, as [write] does, making them all durable
+     * with one fsync. For modules that coalesce the writes of several calls.
+     *
+     * @return Per batch, null if it was written, otherwise its error
+     */
+    @Synchronized
+    fun writeGroup(
+        keys: Array<Array<String>>,
+        values: Array<Array<String?>>,
+    ): Array<String?> {
+        require(keys.size == values.size) { "Expected as many value arrays as key arrays" }
+        for (i in keys.indices) {
+            require(keys[i].size == values[i].size) { "Expected as many values as keys in batch $i" }
+        }
+        return SandboxJSIInstaller.nativeKVStoreWriteGroup(checkOpen(), keys, values)
+    }
+
+    /** Every key, in no particular order. */
+    @Synchronized
+    fun keys(): Array<String> = SandboxJSIInstaller.nativeKVStoreKeys(checkOpen())
+
+    @Synchronized
+    @Throws(IOException::class)
+    fun clear() {
+        SandboxJSIInstaller.nativeKVStoreClear(checkOpen())?.let { throw IOException(it) }
+    }
+
+    @Synchronized
+    override fun close() {
+        if (handle != 0L) {
+            SandboxJSIInstaller.nativeCloseKVStore(handle)
+            handle = 0L
+        }
+    }
+
+    private fun checkOpen(): Long {
+        check(handle != 0L) { "Key-value store is closed" }
+        return handle
+    }
+}
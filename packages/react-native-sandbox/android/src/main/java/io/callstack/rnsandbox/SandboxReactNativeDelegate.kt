@@ -1,17 +1,22 @@
 package io.callstack.rnsandbox
 
 import android.app.Activity
+import android.content.ComponentCallbacks2
 import android.content.Context
 import android.content.ContextWrapper
+import android.content.res.Configuration
 import android.os.Bundle
 import android.util.Log
 import android.view.View
+import android.view.ViewGroup
+import android.view.ViewTreeObserver
 import com.facebook.react.BaseReactPackage
 import com.facebook.react.ReactHost
 import com.facebook.react.ReactInstanceEventListener
 import com.facebook.react.ReactPackage
 import com.facebook.react.bridge.Arguments
 import com.facebook.react.bridge.JSBundleLoader
+import com.facebook.react.bridge.JSBundleLoaderDelegate
 import com.facebook.react.bridge.NativeModule
 import com.facebook.react.bridge.ReactApplicationContext
 import com.facebook.react.bridge.ReactContext
@@ -27,12 +32,15 @@ import com.facebook.react.runtime.ReactHostImpl
 import com.facebook.react.runtime.hermes.HermesInstance
 import com.facebook.react.shell.MainReactPackage
 import com.facebook.react.uimanager.ViewManager
+import java.util.Locale
+import kotlin.concurrent.thread
 
 class SandboxReactNativeDelegate(
     private val context: Context,
 ) {
     companion object {
         private const val TAG = "SandboxRNDelegate"
+        private const val PRELOAD_WAIT_MS = 60_000L
 
         private val sharedHosts = mutableMapOf<String, SharedReactHost>()
         private val registeredSubstitutionPackages = mutableListOf<ReactPackage>()
@@ -63,9 +71,56 @@ class SandboxReactNativeDelegate(
             registeredHostPackages.addAll(packages)
         }
 
+        /**
+         * JS thread time spent on each origin since its first use, split into
+         * message delivery, serialization, user callbacks and native calls.
+         */
+        @JvmStatic
+        fun cpuUsageJson(): String = SandboxJSIInstaller.nativeGetCpuUsageJson()
+
+        /**
+         * Queue metrics of every lane on the shared executor, keyed by
+         * "<origin>/<module>", see [SandboxExecutor].
+         */
+        @JvmStatic
+        fun methodQueueStatsJson(): String = SandboxJSIInstaller.nativeGetMethodQueueStatsJson()
+
+        private var memoryCallbacksRegistered = false
+
+        /** Forwards OS memory pressure to the native memory governor, once per process. */
+        private fun registerMemoryCallbacks(context: Context) {
+            if (memoryCallbacksRegistered) return
+            memoryCallbacksRegistered = true
+            context.applicationContext.registerComponentCallbacks(
+                object : ComponentCallbacks2 {
+                    @Suppress("DEPRECATION")
+                    override fun onTrimMemory(level: Int) {
+                        when (level) {
+                            ComponentCallbacks2.TRIM_MEMORY_RUNNING_CRITICAL,
+                            ComponentCallbacks2.TRIM_MEMORY_COMPLETE,
+                            -> SandboxJSIInstaller.nativeOnMemoryPressure(true)
+                            ComponentCallbacks2.TRIM_MEMORY_RUNNING_MODERATE,
+                            ComponentCallbacks2.TRIM_MEMORY_RUNNING_LOW,
+                            ComponentCallbacks2.TRIM_MEMORY_BACKGROUND,
+                            ComponentCallbacks2.TRIM_MEMORY_MODERATE,
+                            -> SandboxJSIInstaller.nativeOnMemoryPressure(false)
+                        }
+                    }
+
+                    override fun onConfigurationChanged(newConfig: Configuration) {}
+
+                    @Deprecated("Deprecated in Java")
+                    override fun onLowMemory() {
+                        SandboxJSIInstaller.nativeOnMemoryPressure(true)
+                    }
+                },
+            )
+        }
+
         private data class SharedReactHost(
             val reactHost: ReactHostImpl,
             val sandboxContext: Context,
+            val modules: FilteredReactPackage,
             var refCount: Int,
         )
     }
@@ -73,22 +128,134 @@ class SandboxReactNativeDelegate(
     @JvmField var origin: String = ""
 
     var jsBundleSource: String = ""
+
+    /** Bundle evaluated before jsBundleSource in every runtime, empty for none. */
+    var jsBaseBundleSource: String = ""
+
+    /** Evaluate a changed jsBundleSource in the running runtime; see swapBundleSource. */
+    var hotSwapBundles: Boolean = false
     var allowedTurboModules: Set<String> = emptySet()
     var turboModuleSubstitutions: Map<String, String> = emptyMap()
     var allowedOrigins: Set<String> = emptySet()
+        set(value) {
+            field = value
+            val handle = jsiStateHandle
+            if (handle != 0L) {
+                SandboxJSIInstaller.nativeSetAllowedOrigins(handle, value.toTypedArray())
+            }
+        }
+
+    /**
+     * Origins run as realms in this sandbox's runtime, started after its bundle in every runtime. Setting it while the
+     * runtime runs restarts them.
+     */
+    var realms: List<SandboxRealmConfig> = emptyList()
+        set(value) {
+            if (field == value) return
+            field = value
+            val reactContext = sandboxReactContext ?: return
+            val handle = jsiStateHandle
+            if (handle == 0L) return
+            SandboxBundlePreloader.preload(context, value.map { it.jsBundleSource })
+            reactContext.runOnJSQueueThread { startRealms(handle) }
+        }
+    var sharedStateReadKeys: Set<String> = emptySet()
+        set(value) {
+            field = value
+            applySharedStateAccess()
+        }
+    var sharedStateWriteKeys: Set<String> = emptySet()
+        set(value) {
+            field = value
+            applySharedStateAccess()
+        }
 
     @JvmField var hasOnMessageHandler: Boolean = false
 
     @JvmField var hasOnErrorHandler: Boolean = false
     var sandboxView: SandboxReactNativeView? = null
 
+    /** Read by nativeInstall to hand the hibernation state to each new runtime. */
+    @JvmField var hibernationHandle: Long = SandboxJSIInstaller.nativeCreateHibernation(this)
+
+    var hibernationWakePolicy: String = "queue"
+        set(value) {
+            field = value
+            if (hibernationHandle != 0L) {
+                SandboxJSIInstaller.nativeSetHibernationWakePolicy(hibernationHandle, value)
+            }
+        }
+
+    /** Read by nativeInstall to hand the governor id to each new runtime. */
+    @JvmField var memoryGovernorId: Long = SandboxJSIInstaller.nativeAddToMemoryGovernor(this)
+
+    /** Soft JS heap limit in MiB enforced by the memory governor, 0 for none. */
+    var heapLimitMB: Int = 0
+        set(value) {
+            field = value
+            if (memoryGovernorId != 0L) {
+                SandboxJSIInstaller.nativeSetHeapLimit(memoryGovernorId, value.coerceAtLeast(0) * 1024L * 1024L)
+            }
+        }
+
+    var evictionPolicy: String = "hibernate"
+        set(value) {
+            field = value
+            if (memoryGovernorId != 0L) {
+                SandboxJSIInstaller.nativeSetEvictionPolicy(memoryGovernorId, value)
+            }
+        }
+
+    /**
+     * Read by nativeInstall so each new runtime records its startup phases.
+     * Created by the view manager, destroyed with the delegate.
+     */
+    @JvmField var startupTimelineHandle: Long = 0
+
+    /**
+     * Pushed to each new runtime's watchdog entry; 0 disables the watchdog. Android runtimes cannot be interrupted,
+     * so their watchdog is never armed and this has no effect yet.
+     */
+    var watchdogTimeoutMs: Int = 10000
+        set(value) {
+            field = value
+            val handle = jsiStateHandle
+            if (handle != 0L) {
+                SandboxJSIInstaller.nativeSetWatchdogTimeout(handle, value.coerceAtLeast(0))
+            }
+        }
+
+    init {
+        registerMemoryCallbacks(context)
+    }
+
+    /** Rebuilds the runtime once a hibernated sandbox resumes. Set by the view manager. */
+    var onResume: (() -> Unit)? = null
+
+    /** True from hibernate() until resume(); the view must not load a runtime meanwhile. */
+    var isHibernated: Boolean = false
+        private set
+
+    /** Set while the sandbox waits in SandboxRuntimeParking without a view. */
+    internal var parkId: Long = 0
+
+    /** True while a surface runs in the sandbox's host. */
+    val isRunning: Boolean
+        get() = reactSurface != null
+
     private var reactHost: ReactHostImpl? = null
     private var reactSurface: ReactSurface? = null
     private var jsiStateHandle: Long = 0
     private var sandboxReactContext: ReactContext? = null
     private var ownsReactHost = false
+
+    // The host's module package, which holds its shared module instances
+    private var reactModules: FilteredReactPackage? = null
     private var instanceEventListener: ReactInstanceEventListener? = null
 
+    // Bumped by every hot swap, so an outdated one stops early
+    private var swapGeneration = 0
+
     @OptIn(UnstableReactNativeAPI::class)
     fun loadReactNativeView(
         componentName: String,
@@ -102,6 +269,7 @@ class SandboxReactNativeDelegate(
         val capturedBundleSource = jsBundleSource
         val capturedAllowedModules = allowedTurboModules
 
+        markStartupPhase(StartupPhase.HOST_CREATED)
         try {
             val shared = if (origin.isNotEmpty()) sharedHosts[origin] else null
 
@@ -111,6 +279,7 @@ class SandboxReactNativeDelegate(
             if (shared != null) {
                 host = shared.reactHost
                 sandboxContext = shared.sandboxContext
+                reactModules = shared.modules
                 shared.refCount++
                 ownsReactHost = false
                 Log.d(TAG, "Reusing shared ReactHost for origin '$origin' (refCount=${shared.refCount})")
@@ -122,17 +291,17 @@ class SandboxReactNativeDelegate(
                 val capturedHostPackages = registeredHostPackages.toList()
                 val capturedOrigin = origin
 
-                val packages: List<ReactPackage> =
-                    listOf(
-                        FilteredReactPackage(
-                            MainReactPackage(),
-                            capturedHostPackages,
-                            capturedAllowedModules,
-                            capturedSubstitutions,
-                            capturedSubstitutionPackages,
-                            capturedOrigin,
-                        ),
+                val modules =
+                    FilteredReactPackage(
+                        MainReactPackage(),
+                        capturedHostPackages,
+                        capturedAllowedModules,
+                        capturedSubstitutions,
+                        capturedSubstitutionPackages,
+                        capturedOrigin,
                     )
+                reactModules = modules
+                val packages: List<ReactPackage> = listOf(modules)
 
                 val bundleLoader = createBundleLoader(capturedBundleSource) ?: return null
 
@@ -165,7 +334,7 @@ class SandboxReactNativeDelegate(
                 ownsReactHost = true
 
                 if (origin.isNotEmpty()) {
-                    sharedHosts[origin] = SharedReactHost(host, sandboxContext, refCount = 1)
+                    sharedHosts[origin] = SharedReactHost(host, sandboxContext, modules, refCount = 1)
                     Log.d(TAG, "Created shared ReactHost for origin '$origin'")
                 }
             }
@@ -178,7 +347,12 @@ class SandboxReactNativeDelegate(
                         sandboxReactContext = reactContext
                         if (jsiStateHandle != 0L) {
                             reactContext.runOnJSQueueThread {
+                                // Queued behind the bundle's evaluation
+                                markStartupPhase(StartupPhase.BUNDLE_LOADED)
                                 SandboxJSIInstaller.nativeInstallErrorHandler(jsiStateHandle)
+                                startRealms(jsiStateHandle)
+                                // Flush work scheduled before the context existed
+                                SandboxJSIInstaller.nativeRunScheduledTasks(jsiStateHandle)
                             }
                         }
                     }
@@ -189,6 +363,7 @@ class SandboxReactNativeDelegate(
             val surface = host.createSurface(sandboxContext, componentName, initialProperties)
             reactSurface = surface
 
+            surface.view?.let { observeFirstFrame(it) }
             surface.start()
 
             val activity = getActivity()
@@ -233,6 +408,8 @@ class SandboxReactNativeDelegate(
 
             loaderField.set(delegate, newLoader)
 
+            restartStartupTimeline()
+            markStartupPhase(StartupPhase.HOST_CREATED)
             host.reload("jsBundleSource changed")
             Log.d(TAG, "Reloaded sandbox '$origin' with new bundle source via reflection")
             return true
@@ -242,34 +419,322 @@ class SandboxReactNativeDelegate(
         }
     }
 
+    /**
+     * Replaces the running bundle with jsBundleSource without rebuilding the
+     * host: the bundle files are resolved through the preloader, the surface
+     * is stopped, the files are evaluated in the same runtime on the JS thread
+     * and the surface is started again with the new bundle's component.
+     *
+     * Runs asynchronously. A step that fails falls back to
+     * reloadWithNewBundleSource(), and to onFailed if that is not possible.
+     *
+     * @return false if there is no running runtime to swap into, or it is
+     * shared with another view of the same origin
+     */
+    fun swapBundleSource(onFailed: () -> Unit): Boolean {
+        val surface = reactSurface ?: return false
+        val reactContext = sandboxReactContext ?: return false
+        val handle = jsiStateHandle
+        if (handle == 0L || jsBundleSource.isEmpty()) return false
+        val shared = if (origin.isNotEmpty()) sharedHosts[origin] else null
+        if (shared != null && shared.reactHost === reactHost && shared.refCount > 1) return false
+
+        // The runtime keeps the base bundle it was started with
+        val sources = listOf(jsBundleSource)
+        val generation = ++swapGeneration
+        restartStartupTimeline()
+        markStartupPhase(StartupPhase.BUNDLE_LOAD_STARTED)
+        SandboxBundlePreloader.preload(context, sources)
+
+        fun isCurrent() = generation == swapGeneration && reactSurface === surface && jsiStateHandle == handle
+
+        fun fallBack(reason: String) {
+            UiThreadUtil.runOnUiThread {
+                if (!isCurrent()) return@runOnUiThread
+                Log.w(TAG, "Hot swap of '$origin' failed, reloading: $reason")
+                if (!reloadWithNewBundleSource()) onFailed()
+            }
+        }
+
+        thread(name = "SandboxBundleSwap") {
+            val paths = sources.map { SandboxBundlePreloader.awaitPreloaded(it, PRELOAD_WAIT_MS) }
+            val missing = sources.filterIndexed { i, _ -> paths[i] == null }
+            if (missing.isNotEmpty()) {
+                fallBack("${missing.joinToString()} could not be loaded")
+                return@thread
+            }
+            val sourceUrls = sources.map { if (SandboxBundlePreloader.isRemote(it)) it else "assets://$it" }
+
+            // Runs the old bundle's unmount on the JS thread ahead of the new bundle
+            surface.stop().waitForCompletion()
+            reactContext.runOnJSQueueThread {
+                val error =
+                    SandboxJSIInstaller.nativeEvaluateBundles(
+                        handle,
+                        paths.filterNotNull().toTypedArray(),
+                        sourceUrls.toTypedArray(),
+                    )
+                if (error != null) {
+                    UiThreadUtil.runOnUiThread { sandboxView?.emitOnError("BundleSwapError", error, "", true) }
+                    fallBack(error)
+                    return@runOnJSQueueThread
+                }
+                markStartupPhase(StartupPhase.BUNDLE_LOADED)
+                UiThreadUtil.runOnUiThread {
+                    if (!isCurrent()) return@runOnUiThread
+                    surface.view?.let { observeFirstFrame(it) }
+                    surface.start()
+                }
+            }
+        }
+        return true
+    }
+
+    /** Replaces the realms of the runtime behind handle with [realms]. Runs on the JS thread. */
+    private fun startRealms(handle: Long) {
+        SandboxJSIInstaller.nativeClearRealms(handle)
+        // Substitutes are configured for this sandbox's origin; a realm loading one would act as the host
+        val hostConfiguredModules = (turboModuleSubstitutions.keys + turboModuleSubstitutions.values).toTypedArray()
+        for (realm in realms) {
+            val source = realm.jsBundleSource
+            val path = SandboxBundlePreloader.awaitPreloaded(source, PRELOAD_WAIT_MS)
+            val error =
+                if (path == null) {
+                    "$source could not be loaded"
+                } else {
+                    val subs = realm.turboModuleSubstitutions.entries
+                    SandboxJSIInstaller.nativeStartRealm(
+                        handle,
+                        realm.origin,
+                        path,
+                        if (SandboxBundlePreloader.isRemote(source)) source else "assets://$source",
+                        realm.allowedTurboModules.toTypedArray(),
+                        realm.allowedOrigins.toTypedArray(),
+                        subs.map { it.key }.toTypedArray(),
+                        subs.map { it.value }.toTypedArray(),
+                        hostConfiguredModules,
+                    )
+                }
+            if (error != null) {
+                val message = "Realm '${realm.origin}' failed to start: $error"
+                UiThreadUtil.runOnUiThread { sandboxView?.emitOnError("RealmError", message, "", false) }
+            }
+        }
+    }
+
+    internal fun restartStartupTimeline() {
+        if (startupTimelineHandle != 0L) {
+            SandboxJSIInstaller.nativeRestartStartupTimeline(startupTimelineHandle)
+        }
+    }
+
     private fun createBundleLoader(bundleSource: String): JSBundleLoader? {
         if (bundleSource.isEmpty()) return null
-        return when {
-            bundleSource.startsWith("http://") || bundleSource.startsWith("https://") -> {
-                JSBundleLoader.createFileLoader(bundleSource)
+        val baseBundleSource = jsBaseBundleSource
+        if (baseBundleSource.isNotEmpty()) {
+            // Fetched once and shared by every sandbox naming it
+            SandboxBundlePreloader.preload(context, listOf(baseBundleSource))
+        }
+        if (realms.isNotEmpty()) {
+            // Fetched while the sandbox's own bundle loads; started after it
+            SandboxBundlePreloader.preload(context, realms.map { it.jsBundleSource })
+        }
+        return object : JSBundleLoader() {
+            override fun loadScript(delegate: JSBundleLoaderDelegate): String {
+                markStartupPhase(StartupPhase.BUNDLE_LOAD_STARTED)
+                if (baseBundleSource.isNotEmpty()) {
+                    // Defines the shared modules the sandbox's own bundle requires
+                    loaderFor(baseBundleSource).loadScript(delegate)
+                }
+                return loaderFor(bundleSource).loadScript(delegate)
             }
+        }
+    }
 
-            else -> {
-                JSBundleLoader.createAssetLoader(context, "assets://$bundleSource", true)
-            }
+    /** Loads from the preloaded copy if there is one; blocks, so off the UI thread only. */
+    private fun loaderFor(bundleSource: String): JSBundleLoader {
+        val remote = SandboxBundlePreloader.isRemote(bundleSource)
+        val sourceUrl = if (remote) bundleSource else "assets://$bundleSource"
+        // Joins a preload still in flight
+        val preloadedPath = SandboxBundlePreloader.awaitPreloaded(bundleSource, PRELOAD_WAIT_MS)
+        if (preloadedPath != null) {
+            Log.d(TAG, "Loading preloaded bundle for '$bundleSource' from $preloadedPath")
+            // A file is mapped, so Hermes bytecode pages are shared between runtimes
+            return JSBundleLoader.createFileLoader(preloadedPath, sourceUrl, false)
+        }
+        return if (remote) {
+            JSBundleLoader.createFileLoader(bundleSource)
+        } else {
+            JSBundleLoader.createAssetLoader(context, sourceUrl, true)
         }
     }
 
+    fun markStartupPhase(phase: StartupPhase) {
+        val handle = startupTimelineHandle
+        if (handle == 0L) return
+        if (SandboxJSIInstaller.nativeMarkStartupPhase(handle, phase.ordinal) && phase == StartupPhase.FIRST_FRAME) {
+            reportStartupTimeline(handle)
+        }
+    }
+
+    private fun reportStartupTimeline(handle: Long) {
+        val offsets = SandboxJSIInstaller.nativeGetStartupTimeline(handle)
+        val phases = StartupPhase.values()
+        Log.i(
+            TAG,
+            "Startup of sandbox '$origin': " +
+                phases.indices.joinToString { "${phases[it].eventKey}=${offsets[it]}" },
+        )
+        val timeline =
+            Arguments.createMap().apply {
+                phases.forEachIndexed { i, phase -> putDouble(phase.eventKey, offsets[i]) }
+            }
+        sandboxView?.emitOnStartupTimeline(timeline)
+    }
+
+    /** Marks FIRST_FRAME when the surface draws after its initial mount. */
+    private fun observeFirstFrame(surfaceView: ViewGroup) {
+        surfaceView.setOnHierarchyChangeListener(
+            object : ViewGroup.OnHierarchyChangeListener {
+                override fun onChildViewAdded(
+                    parent: View,
+                    child: View,
+                ) {
+                    surfaceView.setOnHierarchyChangeListener(null)
+                    surfaceView.viewTreeObserver.addOnPreDrawListener(
+                        object : ViewTreeObserver.OnPreDrawListener {
+                            override fun onPreDraw(): Boolean {
+                                surfaceView.viewTreeObserver.removeOnPreDrawListener(this)
+                                markStartupPhase(StartupPhase.FIRST_FRAME)
+                                return true
+                            }
+                        },
+                    )
+                }
+
+                override fun onChildViewRemoved(
+                    parent: View,
+                    child: View,
+                ) {}
+            },
+        )
+    }
+
     fun onJSIBindingsInstalled(stateHandle: Long) {
         jsiStateHandle = stateHandle
+        SandboxJSIInstaller.nativeSetAllowedOrigins(stateHandle, allowedOrigins.toTypedArray())
+        SandboxJSIInstaller.nativeSetWatchdogTimeout(stateHandle, watchdogTimeoutMs.coerceAtLeast(0))
+        applySharedStateAccess()
     }
 
-    fun postMessage(message: String) {
+    private fun applySharedStateAccess() {
+        val handle = jsiStateHandle
+        if (handle == 0L) return
+        SandboxJSIInstaller.nativeSetSharedStateAccess(
+            handle,
+            sharedStateReadKeys.toTypedArray(),
+            sharedStateWriteKeys.toTypedArray(),
+        )
+    }
+
+    /**
+     * Called from native code to run queued JS-thread work (e.g. message port
+     * deliveries). Returns false when there is no React context yet.
+     */
+    @Suppress("unused")
+    fun scheduleJSTasks(): Boolean {
         val reactContext = sandboxReactContext
         val handle = jsiStateHandle
-        Log.d(TAG, "postMessage to '$origin': context=${reactContext != null}, handle=$handle")
-        if (reactContext == null || handle == 0L) return
+        if (reactContext == null || handle == 0L) return false
 
         reactContext.runOnJSQueueThread {
-            SandboxJSIInstaller.nativePostMessage(handle, message)
+            SandboxJSIInstaller.nativeRunScheduledTasks(handle)
+        }
+        return true
+    }
+
+    fun postMessage(
+        message: String,
+        urgent: Boolean = false,
+    ) {
+        val handle = jsiStateHandle
+        Log.d(TAG, "postMessage to '$origin': handle=$handle, urgent=$urgent")
+        if (handle == 0L) {
+            // Kept for the next runtime while hibernated, dropped otherwise
+            SandboxJSIInstaller.nativeParkMessage(hibernationHandle, message, urgent)
+            return
+        }
+
+        // Queued natively; delivered on the JS thread once the context is up
+        SandboxJSIInstaller.nativePostMessage(handle, message, urgent)
+    }
+
+    /**
+     * Snapshots the sandbox and releases its runtime once the snapshot is
+     * taken. A ReactHost shared with another view of the same origin stays
+     * alive, so such sandboxes are not hibernated.
+     */
+    fun hibernate() {
+        val shared = if (origin.isNotEmpty()) sharedHosts[origin] else null
+        if (shared != null && shared.reactHost === reactHost && shared.refCount > 1) {
+            Log.w(TAG, "Not hibernating '$origin': its ReactHost is shared with another view")
+            return
+        }
+        if (SandboxJSIInstaller.nativeHibernate(jsiStateHandle, hibernationHandle)) {
+            isHibernated = true
+        }
+    }
+
+    fun resume() {
+        if (SandboxJSIInstaller.nativeResume(hibernationHandle)) {
+            isHibernated = false
+            restartStartupTimeline()
+            onResume?.invoke()
+        }
+    }
+
+    /** Called from native code on the JS thread once the snapshot is taken. */
+    @Suppress("unused")
+    fun onHibernated(resumeRequested: Boolean) {
+        UiThreadUtil.runOnUiThread {
+            cleanup()
+            sandboxView?.removeAllViews()
+            if (resumeRequested) {
+                resume()
+            }
+        }
+    }
+
+    /** Called from native code when the memory governor evicts the sandbox. */
+    @Suppress("unused")
+    fun onMemoryEviction(
+        reason: String,
+        heapBytes: Long,
+    ) {
+        UiThreadUtil.runOnUiThread {
+            if (isHibernated) return@runOnUiThread
+            // Nobody sees a parked sandbox; it is dropped instead
+            if (parkId != 0L) {
+                SandboxJSIInstaller.nativeReleaseParkedRuntime(parkId)
+                return@runOnUiThread
+            }
+            val heapMB = String.format(Locale.ROOT, "%.1f", heapBytes / (1024.0 * 1024.0))
+            emitOnErrorFromJS(
+                "SandboxEvictedError",
+                "Sandbox '$origin' was evicted to free memory ($heapMB MiB heap, $reason)",
+                "",
+                false,
+            )
+            hibernate()
         }
     }
 
+    /** Called from native code when a parked message wakes the sandbox. */
+    @Suppress("unused")
+    fun onHibernationWakeRequest() {
+        UiThreadUtil.runOnUiThread { resume() }
+    }
+
     @Suppress("unused")
     fun emitOnMessageFromJS(messageJson: String) {
         if (!hasOnMessageHandler) return
@@ -358,19 +823,53 @@ class SandboxReactNativeDelegate(
                         sharedHosts.remove(origin)
                         host.onHostDestroy()
                         host.destroy("sandbox cleanup", null)
+                        shared.modules.releaseSharedModules()
                     }
                 }
             } else if (ownsReactHost) {
                 host.onHostDestroy()
                 host.destroy("sandbox cleanup", null)
+                reactModules?.releaseSharedModules()
             }
         }
         reactHost = null
+        reactModules = null
         ownsReactHost = false
     }
 
+    /** Takes over another delegate's view configuration, e.g. when replacing it in its view. */
+    fun copyConfigurationFrom(other: SandboxReactNativeDelegate) {
+        origin = other.origin
+        jsBundleSource = other.jsBundleSource
+        jsBaseBundleSource = other.jsBaseBundleSource
+        hotSwapBundles = other.hotSwapBundles
+        allowedTurboModules = other.allowedTurboModules
+        turboModuleSubstitutions = other.turboModuleSubstitutions
+        allowedOrigins = other.allowedOrigins
+        sharedStateReadKeys = other.sharedStateReadKeys
+        sharedStateWriteKeys = other.sharedStateWriteKeys
+        hasOnMessageHandler = other.hasOnMessageHandler
+        hasOnErrorHandler = other.hasOnErrorHandler
+        hibernationWakePolicy = other.hibernationWakePolicy
+        heapLimitMB = other.heapLimitMB
+        evictionPolicy = other.evictionPolicy
+        watchdogTimeoutMs = other.watchdogTimeoutMs
+    }
+
     fun destroy() {
         cleanup()
+        if (hibernationHandle != 0L) {
+            SandboxJSIInstaller.nativeDestroyHibernation(hibernationHandle)
+            hibernationHandle = 0
+        }
+        if (memoryGovernorId != 0L) {
+            SandboxJSIInstaller.nativeRemoveFromMemoryGovernor(memoryGovernorId)
+            memoryGovernorId = 0
+        }
+        if (startupTimelineHandle != 0L) {
+            SandboxJSIInstaller.nativeDestroyStartupTimeline(startupTimelineHandle)
+            startupTimelineHandle = 0
+        }
     }
 
     private class SandboxContextWrapper(
@@ -409,6 +908,9 @@ class SandboxReactNativeDelegate(
     ) : BaseReactPackage() {
         private val substitutedInstances = java.util.concurrent.ConcurrentHashMap<String, NativeModule>()
 
+        // (resolved name, scope) of the shared instances this host holds
+        private val sharedModules = java.util.concurrent.ConcurrentLinkedQueue<Pair<String, String>>()
+
         private val effectiveAllowed: Set<String> by lazy {
             allowedModules + substitutions.keys
         }
@@ -421,8 +923,18 @@ class SandboxReactNativeDelegate(
             if (resolvedName != null) {
                 substitutedInstances[name]?.let { return it }
 
+                SharedSandboxModules.knownScope(resolvedName, origin)?.let { scope ->
+                    val shared = SharedSandboxModules.acquire(resolvedName, scope, null)
+                    if (shared != null) {
+                        sharedModules.add(resolvedName to scope)
+                        substitutedInstances[name] = shared
+                        Log.d(TAG, "Substituted '$name' -> '$resolvedName' (shared in '$scope')")
+                        return shared
+                    }
+                }
+
                 for (pkg in substitutionPackages) {
-                    val module =
+                    var module =
                         if (pkg is BaseReactPackage) {
                             pkg.getModule(resolvedName, reactContext)
                         } else {
@@ -431,6 +943,12 @@ class SandboxReactNativeDelegate(
                     if (module != null) {
                         if (module is SandboxAwareModule) {
                             module.configureSandbox(origin, name, resolvedName)
+                            val scope = SharedSandboxModules.scope(resolvedName, module, origin)
+                            if (scope != null) {
+                                // Another host's instance if one was shared meanwhile; this one is then dropped
+                                module = SharedSandboxModules.acquire(resolvedName, scope, module) ?: module
+                                sharedModules.add(resolvedName to scope)
+                            }
                         }
                         substitutedInstances[name] = module
                         Log.d(TAG, "Substituted '$name' -> '$resolvedName' (${module.javaClass.simpleName})")
@@ -490,5 +1008,13 @@ class SandboxReactNativeDelegate(
 
         override fun createViewManagers(reactContext: ReactApplicationContext): List<ViewManager<*, *>> =
             delegate.createViewManagers(reactContext)
+
+        /** Lets go of the shared module instances, once the host is destroyed. */
+        fun releaseSharedModules() {
+            while (true) {
+                val (resolvedName, scope) = sharedModules.poll() ?: break
+                SharedSandboxModules.release(resolvedName, scope)
+            }
+        }
     }
 }
@@ -2,16 +2,27 @@ package io.callstack.rnsandbox
 
 import android.content.Context
 import android.os.Bundle
+import android.view.View
+import android.view.ViewTreeObserver
 import android.widget.FrameLayout
+import android.widget.HorizontalScrollView
+import android.widget.ScrollView
 import com.facebook.react.bridge.Arguments
 import com.facebook.react.bridge.ReactContext
 import com.facebook.react.bridge.WritableMap
+import com.facebook.react.uimanager.PixelUtil
 import com.facebook.react.uimanager.UIManagerHelper
 import com.facebook.react.uimanager.events.Event
 
 class SandboxReactNativeView(
     context: Context,
 ) : FrameLayout(context) {
+    private companion object {
+        // Results of SandboxJSIInstaller.nativeNextLazyLoadAction
+        const val LAZY_START = 1
+        const val LAZY_RELEASE = 2
+    }
+
     var delegate: SandboxReactNativeDelegate? = null
     var pendingComponentName: String? = null
     var pendingInitialProperties: Bundle? = null
@@ -20,13 +31,120 @@ class SandboxReactNativeView(
     internal var needsLoad: Boolean = false
     internal var onAttachLoadCallback: (() -> Unit)? = null
 
+    /** Defers the runtime until the view comes within lazyLoadDistance of the viewport. */
+    internal var lazy: Boolean = false
+        set(value) {
+            field = value
+            lazyStarted = childCount > 0
+            if (value && isAttachedToWindow) startViewportObservation() else stopViewportObservation()
+        }
+
+    /** In pixels. */
+    internal var lazyLoadDistance: Float = PixelUtil.toPixelFromDIP(250f)
+
+    /** In pixels; 0 keeps a started runtime. */
+    internal var lazyReleaseDistance: Float = 0f
+
+    /** Whether a lazy view is near enough to the viewport to run its runtime. */
+    internal var lazyStarted: Boolean = false
+    internal var onLazyStart: (() -> Unit)? = null
+    internal var onLazyRelease: (() -> Unit)? = null
+
+    private var observingViewport = false
+    private val viewportListener = ViewTreeObserver.OnScrollChangedListener { updateViewportProximity() }
+    private val layoutListener = ViewTreeObserver.OnGlobalLayoutListener { updateViewportProximity() }
+    private val location = IntArray(2)
+    private val viewRect = FloatArray(4)
+    private val viewportRect = FloatArray(4)
+
     override fun onAttachedToWindow() {
         super.onAttachedToWindow()
+        if (lazy) {
+            startViewportObservation()
+        }
         if (needsLoad && childCount == 0) {
             onAttachLoadCallback?.invoke()
         }
     }
 
+    override fun onDetachedFromWindow() {
+        stopViewportObservation()
+        super.onDetachedFromWindow()
+    }
+
+    private fun startViewportObservation() {
+        if (!observingViewport) {
+            observingViewport = true
+            viewTreeObserver.addOnScrollChangedListener(viewportListener)
+            viewTreeObserver.addOnGlobalLayoutListener(layoutListener)
+        }
+        updateViewportProximity()
+    }
+
+    private fun stopViewportObservation() {
+        if (!observingViewport) return
+        observingViewport = false
+        viewTreeObserver.removeOnScrollChangedListener(viewportListener)
+        viewTreeObserver.removeOnGlobalLayoutListener(layoutListener)
+    }
+
+    /**
+     * Starts or releases a lazy view's runtime by its distance to the
+     * viewport: the window, clipped by every scroll view the view is in.
+     */
+    internal fun updateViewportProximity() {
+        if (!lazy || !isAttachedToWindow) return
+
+        var visible = true
+        var left = 0f
+        var top = 0f
+        var right = rootView.width.toFloat()
+        var bottom = rootView.height.toFloat()
+        var ancestor = parent
+        while (visible && ancestor is View) {
+            if (ancestor is ScrollView || ancestor is HorizontalScrollView) {
+                ancestor.getLocationInWindow(location)
+                left = maxOf(left, location[0].toFloat())
+                top = maxOf(top, location[1].toFloat())
+                right = minOf(right, (location[0] + ancestor.width).toFloat())
+                bottom = minOf(bottom, (location[1] + ancestor.height).toFloat())
+                visible = left < right && top < bottom
+            }
+            ancestor = ancestor.parent
+        }
+        viewportRect[0] = left
+        viewportRect[1] = top
+        viewportRect[2] = right - left
+        viewportRect[3] = bottom - top
+
+        getLocationInWindow(location)
+        viewRect[0] = location[0].toFloat()
+        viewRect[1] = location[1].toFloat()
+        viewRect[2] = width.toFloat()
+        viewRect[3] = height.toFloat()
+
+        val action =
+            SandboxJSIInstaller.nativeNextLazyLoadAction(
+                lazyStarted,
+                viewRect,
+                if (visible) viewportRect else null,
+                lazyLoadDistance,
+                lazyReleaseDistance,
+            )
+        when (action) {
+            LAZY_START -> {
+                lazyStarted = true
+                emitOnLazyStateChange(true)
+                onLazyStart?.invoke()
+            }
+            LAZY_RELEASE -> {
+                lazyStarted = false
+                emitOnLazyStateChange(false)
+                onLazyRelease?.invoke()
+            }
+        }
+    }
+
     /**
      * Fabric manages our dimensions but not our children's (they come from a
      * separate ReactHost).  Force children to fill the space Fabric gave us.
@@ -83,6 +201,21 @@ class SandboxReactNativeView(
         eventDispatcher?.dispatchEvent(OnErrorEvent(surfaceId, id, payload))
     }
 
+    fun emitOnLazyStateChange(started: Boolean) {
+        val reactContext = context as? ReactContext ?: return
+        val surfaceId = UIManagerHelper.getSurfaceId(reactContext)
+        val eventDispatcher = UIManagerHelper.getEventDispatcherForReactTag(reactContext, id)
+        val payload = Arguments.createMap().apply { putBoolean("started", started) }
+        eventDispatcher?.dispatchEvent(OnLazyStateChangeEvent(surfaceId, id, payload))
+    }
+
+    fun emitOnStartupTimeline(timeline: WritableMap) {
+        val reactContext = context as? ReactContext ?: return
+        val surfaceId = UIManagerHelper.getSurfaceId(reactContext)
+        val eventDispatcher = UIManagerHelper.getEventDispatcherForReactTag(reactContext, id)
+        eventDispatcher?.dispatchEvent(OnStartupTimelineEvent(surfaceId, id, timeline))
+    }
+
     inner class OnMessageEvent(
         surfaceId: Int,
         viewId: Int,
@@ -102,4 +235,24 @@ class SandboxReactNativeView(
 
         override fun getEventData() = payload
     }
+
+    inner class OnLazyStateChangeEvent(
+        surfaceId: Int,
+        viewId: Int,
+        private val payload: WritableMap,
+    ) : Event<OnLazyStateChangeEvent>(surfaceId, viewId) {
+        override fun getEventName() = "topLazyStateChange"
+
+        override fun getEventData() = payload
+    }
+
+    inner class OnStartupTimelineEvent(
+        surfaceId: Int,
+        viewId: Int,
+        private val payload: WritableMap,
+    ) : Event<OnStartupTimelineEvent>(surfaceId, viewId) {
+        override fun getEventName() = "topStartupTimeline"
+
+        override fun getEventData() = payload
+    }
 }
@@ -1,12 +1,14 @@
 package io.callstack.rnsandbox
 
 import android.os.Bundle
+import android.view.View
 import android.widget.FrameLayout
 import com.facebook.react.bridge.Arguments
 import com.facebook.react.bridge.Dynamic
 import com.facebook.react.bridge.ReadableArray
 import com.facebook.react.bridge.ReadableType
 import com.facebook.react.module.annotations.ReactModule
+import com.facebook.react.uimanager.PixelUtil
 import com.facebook.react.uimanager.ThemedReactContext
 import com.facebook.react.uimanager.ViewGroupManager
 import com.facebook.react.uimanager.ViewManagerDelegate
@@ -29,19 +31,37 @@ class SandboxReactNativeViewManager :
     override fun getName(): String = REACT_CLASS
 
     override fun createViewInstance(context: ThemedReactContext): SandboxReactNativeView {
+        // Created first, so that its start is the view's creation
+        val startupTimeline = SandboxJSIInstaller.nativeCreateStartupTimeline()
         val view = SandboxReactNativeView(context)
-        view.delegate =
-            SandboxReactNativeDelegate(context).apply {
-                sandboxView = view
-            }
+        view.delegate = createDelegate(view, startupTimeline)
         view.onAttachLoadCallback = { loadReactNativeView(view) }
+        view.onLazyStart = { startLazyRuntime(view) }
+        view.onLazyRelease = { releaseLazyRuntime(view) }
         return view
     }
 
+    private fun createDelegate(
+        view: SandboxReactNativeView,
+        startupTimeline: Long = SandboxJSIInstaller.nativeCreateStartupTimeline(),
+    ): SandboxReactNativeDelegate =
+        SandboxReactNativeDelegate(view.context).apply {
+            startupTimelineHandle = startupTimeline
+            markStartupPhase(StartupPhase.DELEGATE_CREATED)
+            sandboxView = view
+            onResume = {
+                view.needsLoad = true
+                loadReactNativeView(view)
+            }
+        }
+
     override fun onDropViewInstance(view: SandboxReactNativeView) {
         super.onDropViewInstance(view)
-        view.delegate?.destroy()
+        val delegate = view.delegate
         view.delegate = null
+        if (delegate != null && !SandboxRuntimeParking.park(view, delegate)) {
+            delegate.destroy()
+        }
     }
 
     @ReactProp(name = "origin")
@@ -71,10 +91,64 @@ class SandboxReactNativeViewManager :
         val delegate = view.delegate ?: return
         if (delegate.jsBundleSource == newValue) return
         delegate.jsBundleSource = newValue
+        if (view.childCount > 0) {
+            if (delegate.hotSwapBundles && delegate.swapBundleSource { scheduleLoad(view) }) return
+            if (delegate.reloadWithNewBundleSource()) return
+        }
+        scheduleLoad(view)
+    }
+
+    @ReactProp(name = "jsBaseBundleSource")
+    override fun setJsBaseBundleSource(
+        view: SandboxReactNativeView,
+        value: String?,
+    ) {
+        val newValue = value ?: ""
+        val delegate = view.delegate ?: return
+        if (delegate.jsBaseBundleSource == newValue) return
+        delegate.jsBaseBundleSource = newValue
         if (view.childCount > 0 && delegate.reloadWithNewBundleSource()) return
         scheduleLoad(view)
     }
 
+    @ReactProp(name = "hotSwapBundles", defaultBoolean = false)
+    override fun setHotSwapBundles(
+        view: SandboxReactNativeView,
+        value: Boolean,
+    ) {
+        view.delegate?.hotSwapBundles = value
+    }
+
+    @ReactProp(name = "lazy", defaultBoolean = false)
+    override fun setLazy(
+        view: SandboxReactNativeView,
+        value: Boolean,
+    ) {
+        if (view.lazy == value) return
+        view.lazy = value
+        if (!value && view.childCount == 0) {
+            scheduleLoad(view)
+        }
+    }
+
+    @ReactProp(name = "lazyLoadDistance", defaultInt = 250)
+    override fun setLazyLoadDistance(
+        view: SandboxReactNativeView,
+        value: Int,
+    ) {
+        view.lazyLoadDistance = PixelUtil.toPixelFromDIP(value.toFloat())
+        view.updateViewportProximity()
+    }
+
+    @ReactProp(name = "lazyReleaseDistance", defaultInt = 0)
+    override fun setLazyReleaseDistance(
+        view: SandboxReactNativeView,
+        value: Int,
+    ) {
+        view.lazyReleaseDistance = PixelUtil.toPixelFromDIP(value.toFloat())
+        view.updateViewportProximity()
+    }
+
     @ReactProp(name = "initialProperties")
     override fun setInitialProperties(
         view: SandboxReactNativeView,
@@ -157,6 +231,88 @@ class SandboxReactNativeViewManager :
         view.delegate?.allowedOrigins = origins
     }
 
+    @ReactProp(name = "realms")
+    override fun setRealms(
+        view: SandboxReactNativeView,
+        value: Dynamic,
+    ) {
+        val realms = mutableListOf<SandboxRealmConfig>()
+        if (!value.isNull && value.type == ReadableType.Array) {
+            val array = value.asArray() ?: return
+            for (i in 0 until array.size()) {
+                if (array.getType(i) != ReadableType.Map) continue
+                val map = array.getMap(i) ?: continue
+                // Entries without an origin and a bundle are skipped, as on iOS
+                val origin = if (map.hasKey("origin")) map.getString("origin") else null
+                val source = if (map.hasKey("jsBundleSource")) map.getString("jsBundleSource") else null
+                if (origin == null || source == null) continue
+                val subs = mutableMapOf<String, String>()
+                if (map.hasKey("turboModuleSubstitutions")) {
+                    map.getMap("turboModuleSubstitutions")?.let { subsMap ->
+                        val it = subsMap.keySetIterator()
+                        while (it.hasNextKey()) {
+                            val key = it.nextKey()
+                            subsMap.getString(key)?.let { name -> subs[key] = name }
+                        }
+                    }
+                }
+                fun strings(key: String) = toStringSet(if (map.hasKey(key)) map.getArray(key) else null)
+                realms.add(
+                    SandboxRealmConfig(origin, source, strings("allowedTurboModules"), strings("allowedOrigins"), subs),
+                )
+            }
+        }
+        view.delegate?.realms = realms
+    }
+
+    @ReactProp(name = "sharedStateReadKeys")
+    override fun setSharedStateReadKeys(
+        view: SandboxReactNativeView,
+        value: ReadableArray?,
+    ) {
+        view.delegate?.sharedStateReadKeys = toStringSet(value)
+    }
+
+    @ReactProp(name = "sharedStateWriteKeys")
+    override fun setSharedStateWriteKeys(
+        view: SandboxReactNativeView,
+        value: ReadableArray?,
+    ) {
+        view.delegate?.sharedStateWriteKeys = toStringSet(value)
+    }
+
+    @ReactProp(name = "hibernationWakePolicy")
+    override fun setHibernationWakePolicy(
+        view: SandboxReactNativeView,
+        value: String?,
+    ) {
+        view.delegate?.hibernationWakePolicy = value ?: "queue"
+    }
+
+    @ReactProp(name = "heapLimitMB")
+    override fun setHeapLimitMB(
+        view: SandboxReactNativeView,
+        value: Int,
+    ) {
+        view.delegate?.heapLimitMB = value
+    }
+
+    @ReactProp(name = "evictionPolicy")
+    override fun setEvictionPolicy(
+        view: SandboxReactNativeView,
+        value: String?,
+    ) {
+        view.delegate?.evictionPolicy = value ?: "hibernate"
+    }
+
+    @ReactProp(name = "watchdogTimeoutMs", defaultInt = 10000)
+    override fun setWatchdogTimeoutMs(
+        view: SandboxReactNativeView,
+        value: Int,
+    ) {
+        view.delegate?.watchdogTimeoutMs = value
+    }
+
     @ReactProp(name = "hasOnMessageHandler")
     override fun setHasOnMessageHandler(
         view: SandboxReactNativeView,
@@ -176,8 +332,25 @@ class SandboxReactNativeViewManager :
     override fun postMessage(
         view: SandboxReactNativeView,
         message: String,
+        urgent: Boolean,
+    ) {
+        view.delegate?.postMessage(message, urgent)
+    }
+
+    override fun setSharedState(
+        view: SandboxReactNativeView,
+        key: String,
+        value: String,
     ) {
-        view.delegate?.postMessage(message)
+        SandboxJSIInstaller.nativeSetSharedState(key, value)
+    }
+
+    override fun hibernate(view: SandboxReactNativeView) {
+        view.delegate?.hibernate()
+    }
+
+    override fun resume(view: SandboxReactNativeView) {
+        view.delegate?.resume()
     }
 
     override fun receiveCommand(
@@ -212,16 +385,22 @@ class SandboxReactNativeViewManager :
         if (componentName.isNullOrEmpty() || delegate == null || delegate.jsBundleSource.isEmpty()) {
             return
         }
+        // Prop changes while hibernated are picked up on resume
+        if (delegate.isHibernated) return
+        // A lazy view loads once it nears the viewport
+        if (view.lazy && !view.lazyStarted) return
 
         view.needsLoad = false
         view.removeAllViews()
 
         val rnView =
-            delegate.loadReactNativeView(
-                componentName = componentName,
-                initialProperties = view.pendingInitialProperties,
-                launchOptions = view.pendingLaunchOptions,
-            ) ?: return
+            adoptParkedSandbox(view, delegate, componentName)
+                ?: delegate.loadReactNativeView(
+                    componentName = componentName,
+                    initialProperties = view.pendingInitialProperties,
+                    launchOptions = view.pendingLaunchOptions,
+                )
+                ?: return
 
         view.addView(
             rnView,
@@ -233,6 +412,68 @@ class SandboxReactNativeViewManager :
         view.requestLayout()
     }
 
+    /**
+     * Moves a parked sandbox matching the view's props into the view in place
+     * of its fresh delegate, which takes over the props that may differ.
+     *
+     * @return The parked root view, null if there is no match
+     */
+    private fun adoptParkedSandbox(
+        view: SandboxReactNativeView,
+        delegate: SandboxReactNativeDelegate,
+        componentName: String,
+    ): View? {
+        if (delegate.isRunning) return null
+        val parked = SandboxRuntimeParking.take(delegate, componentName) ?: return null
+        val adopted = parked.delegate
+        if (!bundlesEqual(parked.initialProperties, view.pendingInitialProperties) ||
+            !bundlesEqual(parked.launchOptions, view.pendingLaunchOptions)
+        ) {
+            adopted.destroy()
+            return null
+        }
+
+        adopted.copyConfigurationFrom(delegate)
+        adopted.sandboxView = view
+        adopted.onResume = delegate.onResume
+        delegate.destroy()
+        view.delegate = adopted
+        return parked.rootView
+    }
+
+    private fun startLazyRuntime(view: SandboxReactNativeView) {
+        // The timeline measures the start, not the time spent offscreen
+        view.delegate?.restartStartupTimeline()
+        view.needsLoad = true
+        loadReactNativeView(view)
+    }
+
+    /**
+     * Parks the runtime of a lazy view far offscreen, so that scrolling back
+     * soon reclaims it, or tears it down if it cannot be parked.
+     */
+    private fun releaseLazyRuntime(view: SandboxReactNativeView) {
+        val delegate = view.delegate ?: return
+        view.needsLoad = true
+        if (view.childCount == 0) return
+        if (SandboxRuntimeParking.park(view, delegate)) {
+            view.delegate = createDelegate(view).apply { copyConfigurationFrom(delegate) }
+        } else {
+            delegate.cleanup()
+            view.removeAllViews()
+        }
+    }
+
+    private fun toStringSet(value: ReadableArray?): Set<String> {
+        val result = mutableSetOf<String>()
+        value?.let {
+            for (i in 0 until it.size()) {
+                it.getString(i)?.let { item -> result.add(item) }
+            }
+        }
+        return result
+    }
+
     private fun dynamicToBundle(dynamic: Dynamic): Bundle? {
         if (dynamic.isNull || dynamic.type != ReadableType.Map) return null
         return Arguments.toBundle(dynamic.asMap())
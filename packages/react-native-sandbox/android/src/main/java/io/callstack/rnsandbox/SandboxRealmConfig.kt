@@ -0,0 +1,13 @@
+package io.callstack.rnsandbox
+
+/**
+ * An origin run as a realm in the runtime of a sandbox, in a scope object of its own. Mirrors rnsandbox::RealmConfig
+ * in SandboxRealm.h.
+ */
+data class SandboxRealmConfig(
+    val origin: String,
+    val jsBundleSource: String,
+    val allowedTurboModules: Set<String> = emptySet(),
+    val allowedOrigins: Set<String> = emptySet(),
+    val turboModuleSubstitutions: Map<String, String> = emptyMap(),
+)
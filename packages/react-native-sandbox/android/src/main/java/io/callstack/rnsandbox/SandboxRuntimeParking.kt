@@ -0,0 +1,120 @@
+package io.callstack.rnsandbox
+
+import android.os.Bundle
+import android.os.Handler
+import android.os.Looper
+import android.view.View
+import com.facebook.react.bridge.UiThreadUtil
+
+/**
+ * Keeps the runtimes of dropped sandbox views alive for a grace period, so
+ * that a view mounting soon after with the same origin, bundles, component
+ * name and TurboModule configuration, e.g. when a list scrolls back or the
+ * user navigates back, takes the running runtime over instead of evaluating
+ * its bundle again. Configure it from Application.onCreate():
+ * ```
+ * SandboxRuntimeParking.setBudget(maxRuntimes = 3, maxBytes = 96L * 1024 * 1024, gracePeriodMs = 10_000)
+ * ```
+ * The budget and the eviction order live in the native parking lot, shared
+ * with iOS; this object owns the parked delegates. Sandboxes without an
+ * origin are never parked.
+ */
+object SandboxRuntimeParking {
+    internal class ParkedSandbox(
+        val delegate: SandboxReactNativeDelegate,
+        val rootView: View,
+        val initialProperties: Bundle?,
+        val launchOptions: Bundle?,
+    )
+
+    // UI thread only
+    private val parked = mutableMapOf<Long, ParkedSandbox>()
+    private val handler = Handler(Looper.getMainLooper())
+    private var gracePeriodMs = 5_000L
+    private var installed = false
+
+    /**
+     * @param maxRuntimes Parked runtimes kept at once, 0 disables parking. Defaults to 2.
+     * @param maxBytes Sum of the parked runtimes' last heap samples. Defaults to 64 MiB.
+     * @param gracePeriodMs How long a runtime stays parked. Defaults to 5 seconds.
+     */
+    @JvmStatic
+    fun setBudget(
+        maxRuntimes: Int,
+        maxBytes: Long,
+        gracePeriodMs: Long,
+    ) {
+        install()
+        this.gracePeriodMs = gracePeriodMs
+        SandboxJSIInstaller.nativeSetParkingBudget(maxRuntimes, maxBytes, gracePeriodMs)
+    }
+
+    /**
+     * Parks the running sandbox of a dropped view, detaching its root view.
+     *
+     * @return false if it cannot be parked and must be destroyed
+     */
+    internal fun park(
+        view: SandboxReactNativeView,
+        delegate: SandboxReactNativeDelegate,
+    ): Boolean {
+        val componentName = view.pendingComponentName
+        val rootView = view.getChildAt(0)
+        if (componentName.isNullOrEmpty() || rootView == null || delegate.origin.isEmpty() ||
+            delegate.isHibernated || !delegate.isRunning
+        ) {
+            return false
+        }
+        install()
+        val parkId = SandboxJSIInstaller.nativeParkRuntime(key(delegate, componentName), delegate.memoryGovernorId)
+        if (parkId == 0L) return false
+
+        view.removeAllViews()
+        delegate.sandboxView = null
+        delegate.onResume = null
+        delegate.parkId = parkId
+        parked[parkId] = ParkedSandbox(delegate, rootView, view.pendingInitialProperties, view.pendingLaunchOptions)
+        handler.postDelayed({ SandboxJSIInstaller.nativeExpireParkedRuntimes() }, gracePeriodMs)
+        return true
+    }
+
+    /** Takes the most recently parked sandbox matching the delegate's configuration, if any. */
+    internal fun take(
+        delegate: SandboxReactNativeDelegate,
+        componentName: String,
+    ): ParkedSandbox? {
+        if (delegate.origin.isEmpty() || parked.isEmpty()) return null
+        val parkId = SandboxJSIInstaller.nativeTakeParkedRuntime(key(delegate, componentName))
+        if (parkId == 0L) return null
+        val sandbox = parked.remove(parkId) ?: return null
+        sandbox.delegate.parkId = 0
+        return sandbox
+    }
+
+    /** Called from native code, on any thread, once a parked runtime leaves the lot unclaimed. */
+    @Suppress("unused")
+    fun onParkedRuntimeReleased(parkId: Long) {
+        UiThreadUtil.runOnUiThread {
+            parked.remove(parkId)?.delegate?.destroy()
+        }
+    }
+
+    private fun key(
+        delegate: SandboxReactNativeDelegate,
+        componentName: String,
+    ): String {
+        val parts =
+            listOf(delegate.origin, delegate.jsBundleSource, delegate.jsBaseBundleSource, componentName) +
+                delegate.allowedTurboModules.sorted() +
+                delegate.turboModuleSubstitutions.toSortedMap().map { (name, target) -> "$name=$target" }
+        // Parts are origins, URLs and names, none of which contain NUL
+        return parts.joinToString("\u0000")
+    }
+
+    @Synchronized
+    private fun install() {
+        if (installed) return
+        installed = true
+        SandboxJSIInstaller.nativeInstallRuntimeParking(this)
+    }
+}
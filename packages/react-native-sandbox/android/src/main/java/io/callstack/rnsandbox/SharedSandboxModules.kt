@@ -0,0 +1,56 @@
+package io.callstack.rnsandbox
+
+import com.facebook.react.bridge.NativeModule
+import java.lang.ref.WeakReference
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Substituted modules shared between sandboxes under the [SandboxModuleSharing] they declare, kept in the native
+ * registry shared with iOS. A module's policy is read from an instance, so the first sandbox to resolve it creates
+ * one as usual; later sandboxes look the shared instance up before creating their own.
+ */
+internal object SharedSandboxModules {
+    // An instance of each resolved module, to read its policy from. Weak: once collected, the shared instance is
+    // gone too and the next sandbox creates a new one.
+    private val policies = ConcurrentHashMap<String, WeakReference<SandboxAwareModule>>()
+
+    /** The scope module is shared in for origin, null if it is not shared. */
+    fun scope(
+        resolvedName: String,
+        module: SandboxAwareModule,
+        origin: String,
+    ): String? {
+        policies[resolvedName] = WeakReference(module)
+        val sharing = module.sandboxModuleSharing
+        if (sharing == SandboxModuleSharing.PER_SANDBOX) return null
+        val group = if (sharing == SandboxModuleSharing.PER_GROUP) module.sandboxSharingGroup(origin) else null
+        return SandboxJSIInstaller.nativeModuleSharingScope(sharing.ordinal, origin, group).ifEmpty { null }
+    }
+
+    /** The scope of a module resolved before, null if it is not shared or its policy is not known. */
+    fun knownScope(
+        resolvedName: String,
+        origin: String,
+    ): String? {
+        val module = policies[resolvedName]?.get() ?: return null
+        return scope(resolvedName, module, origin)
+    }
+
+    /**
+     * The instance shared under scope, [candidate] if there is none yet. Each instance returned must be released.
+     *
+     * @param candidate null to only look up
+     */
+    fun acquire(
+        resolvedName: String,
+        scope: String,
+        candidate: NativeModule?,
+    ): NativeModule? = SandboxJSIInstaller.nativeAcquireSharedModule(resolvedName, scope, candidate) as NativeModule?
+
+    fun release(
+        resolvedName: String,
+        scope: String,
+    ) {
+        SandboxJSIInstaller.nativeReleaseSharedModule(resolvedName, scope)
+    }
+}
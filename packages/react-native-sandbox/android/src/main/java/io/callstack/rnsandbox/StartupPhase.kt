@@ -0,0 +1,19 @@
+package io.callstack.rnsandbox
+
+/**
+ * Startup phases of a sandbox instance. Ordinals match rnsandbox::StartupPhase
+ * in SandboxStartupTimeline.h, keys match the onStartupTimeline event.
+ */
+enum class StartupPhase(
+    val eventKey: String,
+) {
+    VIEW_CREATED("viewCreated"),
+    DELEGATE_CREATED("delegateCreated"),
+    HOST_CREATED("hostCreated"),
+    BUNDLE_LOAD_STARTED("bundleLoadStarted"),
+    BUNDLE_LOADED("bundleLoaded"),
+    BINDINGS_INSTALLED("bindingsInstalled"),
+    ERROR_HANDLER_INSTALLED("errorHandlerInstalled"),
+    ON_MESSAGE_REGISTERED("onMessageRegistered"),
+    FIRST_FRAME("firstFrame"),
+}
@@ -1,14 +1,49 @@
 #include "ISandboxDelegate.h"
+#include "MessageChannel.h"
+#include "MessageChannelBindings.h"
 #include "SandboxBindingsInstaller.h"
+#include "SandboxBundleEvaluation.h"
+#include "SandboxBundlePatch.h"
+#include "SandboxBundlePreloader.h"
+#include "SandboxCpuAccounting.h"
+#include "SandboxExecutor.h"
+#include "SandboxHeapProbe.h"
+#include "SandboxHibernation.h"
+#include "SandboxHibernationBindings.h"
+#include "SandboxJSHandlers.h"
+#include "SandboxJSIUtils.h"
+#include "SandboxKVStore.h"
 #include "SandboxLogBox.h"
+#include "SandboxMemoryGovernor.h"
+#include "SandboxMessageQueue.h"
+#include "SandboxMessageQueueBindings.h"
+#include "SandboxModuleSharing.h"
+#include "SandboxPresenceBindings.h"
+#include "SandboxRealmBindings.h"
 #include "SandboxRegistry.h"
+#include "SandboxRpcBindings.h"
+#include "SandboxRuntimeParking.h"
+#include "SandboxStartupTimeline.h"
+#include "SandboxViewportProximity.h"
+#include "SandboxWatchdog.h"
+#include "SharedMemoryBindings.h"
+#include "SharedStateBindings.h"
+#include "SharedStateStore.h"
 
 #include <android/log.h>
+#include <android/trace.h>
 #include <fbjni/fbjni.h>
 #include <jni.h>
 #include <jsi/jsi.h>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -29,10 +64,71 @@ struct SandboxJSIState {
   jobject delegateRef = nullptr;
   std::string origin;
   std::shared_ptr<rnsandbox::ISandboxDelegate> registryDelegate;
+  std::shared_ptr<rnsandbox::SandboxHibernation> hibernation;
+  // Set once the runtime has handed its messages over for hibernation;
+  // later ones are parked for the next runtime instead of the inbox
+  bool parked = false;
+  // Set at install, 0 if the delegate is not tracked by the memory governor
+  rnsandbox::SandboxMemoryGovernor::SandboxId memoryId = 0;
+  // Never armed on Android, see nativeInstall; timing it is a no-op
+  rnsandbox::SandboxWatchdog::SandboxId watchdogId = 0;
+  // Set at install on the JS thread, null without an origin. Accounts are
+  // never freed, so the raw pointer outlives the state.
+  rnsandbox::CpuAccount* cpuAccount = nullptr;
+  // The Kotlin delegate's timeline, null if it has none
+  std::shared_ptr<rnsandbox::StartupTimeline> startupTimeline;
+  // Origins running as realms in this runtime, null without any
+  std::shared_ptr<rnsandbox::SandboxRealmSet> realms;
+
+  // Inbound messages from the host and other sandboxes, delivered on the JS
+  // thread urgent-first in bounded batches
+  std::shared_ptr<rnsandbox::SandboxMessageQueue> inbox =
+      std::make_shared<rnsandbox::SandboxMessageQueue>();
+  // Ports opened by the runtime through this state, closed with it
+  std::shared_ptr<rnsandbox::MessagePortSet> messagePorts =
+      std::make_shared<rnsandbox::MessagePortSet>();
+  // Callbacks the runtime handed to the bindings; JS thread only
+  rnsandbox::SandboxJSHandlers jsHandlers;
+  // Set when a hot swap failed partway; JS thread only
+  bool needsReload = false;
+
+  // Work queued via ISandboxDelegate::scheduleOnJSThread. Guarded by its own
+  // mutex because tasks may be scheduled from inside JS callbacks that run
+  // while `mutex` is held.
+  std::vector<std::function<void(jsi::Runtime&)>> scheduledTasks;
+  bool tasksDispatched = false;
+  std::mutex tasksMutex;
+};
+
+// Hibernation state of one Kotlin delegate; outlives its runtimes
+struct HibernationEntry {
+  std::shared_ptr<rnsandbox::SandboxHibernation> hibernation =
+      std::make_shared<rnsandbox::SandboxHibernation>();
+  jobject delegateRef = nullptr;
+
+  // Stands in for the runtime delegate in SandboxRegistry while hibernated
+  std::shared_ptr<rnsandbox::ISandboxDelegate> parkedDelegate;
+  std::string parkedOrigin;
+  // From hibernation until the next runtime is installed, including the
+  // time between resume() and the install
+  bool awaitingRuntime = false;
+  std::mutex mutex;
+};
+
+// Memory governor hooks of one Kotlin delegate; outlives its runtimes
+struct MemoryEntry {
+  jobject delegateRef = nullptr;
+  std::weak_ptr<SandboxJSIState> state;
+  std::mutex mutex;
 };
 
 static std::mutex gRegistryMutex;
 static std::unordered_map<jlong, std::shared_ptr<SandboxJSIState>> gStates;
+static std::unordered_map<jlong, std::shared_ptr<HibernationEntry>>
+    gHibernations;
+static std::unordered_map<jlong, std::shared_ptr<MemoryEntry>> gMemoryEntries;
+static std::unordered_map<jlong, std::shared_ptr<rnsandbox::StartupTimeline>>
+    gStartupTimelines;
 
 static JNIEnv* getJNIEnv() {
   JNIEnv* env = nullptr;
@@ -45,17 +141,120 @@ static JNIEnv* getJNIEnv() {
   return env;
 }
 
+static void emitDelegateError(
+    jobject delegateRef,
+    const char* name,
+    const char* message,
+    bool isFatal) {
+  JNIEnv* env = getJNIEnv();
+  if (!env || !delegateRef)
+    return;
+  jclass cls = env->GetObjectClass(delegateRef);
+  jmethodID mid = env->GetMethodID(
+      cls,
+      "emitOnErrorFromJS",
+      "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;Z)V");
+  jstring jName = env->NewStringUTF(name);
+  jstring jMsg = env->NewStringUTF(message);
+  jstring jStack = env->NewStringUTF("");
+  env->CallVoidMethod(
+      delegateRef, mid, jName, jMsg, jStack, isFatal ? JNI_TRUE : JNI_FALSE);
+  env->DeleteLocalRef(jName);
+  env->DeleteLocalRef(jMsg);
+  env->DeleteLocalRef(jStack);
+  env->DeleteLocalRef(cls);
+}
+
+// Reports a message origin may not send to target, as the iOS delegate does
+static void reportAccessDenied(
+    jobject delegateRef,
+    const std::string& origin,
+    const std::string& target) {
+  std::string message = "Access denied: Sandbox '" + origin +
+      "' is not permitted to send messages to '" + target + "'";
+  emitDelegateError(delegateRef, "AccessDeniedError", message.c_str(), false);
+}
+
+static void deliverInboxMessage(
+    jsi::Runtime& rt,
+    SandboxJSIState& state,
+    std::string message) {
+  std::shared_ptr<jsi::Function> callback;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.runtime)
+      return;
+    callback = state.onMessageCallback;
+    if (!callback) {
+      state.pendingMessages.push_back(std::move(message));
+      return;
+    }
+  }
+
+  try {
+    jsi::Value parsed;
+    {
+      rnsandbox::CpuScope scope(
+          state.cpuAccount, rnsandbox::CpuCategory::Serialization);
+      parsed = rnsandbox::parseJSON(rt, message);
+    }
+    rnsandbox::CpuScope scope(
+        state.cpuAccount, rnsandbox::CpuCategory::UserCallback);
+    callback->call(rt, std::move(parsed));
+  } catch (const jsi::JSError& e) {
+    LOGE("JSError in postMessage: %s", e.getMessage().c_str());
+  } catch (const std::exception& e) {
+    LOGE("Exception in postMessage: %s", e.what());
+  }
+}
+
+// Runs one inbox batch on the JS thread and re-schedules itself while
+// messages remain, so other JS work (and newly arrived urgent messages) can
+// interleave with a long bulk transfer.
+static void scheduleInboxDrain(
+    rnsandbox::ISandboxDelegate& delegate,
+    std::weak_ptr<SandboxJSIState> weakState) {
+  delegate.scheduleOnJSThread([weakState](jsi::Runtime& rt) {
+    auto state = weakState.lock();
+    if (!state)
+      return;
+
+    rnsandbox::CpuScope scope(
+        state->cpuAccount, rnsandbox::CpuCategory::Delivery);
+    bool more = state->inbox->drain([&rt, &state](std::string&& message) {
+      deliverInboxMessage(rt, *state, std::move(message));
+    });
+    if (!more)
+      return;
+
+    std::shared_ptr<rnsandbox::ISandboxDelegate> delegate;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      delegate = state->registryDelegate;
+    }
+    if (delegate) {
+      scheduleInboxDrain(*delegate, weakState);
+    } else {
+      state->inbox->clear();
+    }
+  });
+}
+
 /**
- * ISandboxDelegate that dispatches postMessage through the Kotlin delegate
- * via JNI. The Kotlin postMessage uses runOnJSQueueThread to safely access
- * the JSI runtime on the correct thread.
+ * ISandboxDelegate backed by a SandboxJSIState. postMessage enqueues into the
+ * state's inbox; JS-thread work is dispatched through the Kotlin delegate's
+ * runOnJSQueueThread via JNI.
  *
  * Holds its own JNI global reference which must be released via invalidate().
  */
 class JNISandboxDelegate : public rnsandbox::ISandboxDelegate {
  public:
-  explicit JNISandboxDelegate(JNIEnv* env, jobject delegateRef)
-      : globalDelegateRef_(env->NewGlobalRef(delegateRef)) {}
+  JNISandboxDelegate(
+      JNIEnv* env,
+      jobject delegateRef,
+      std::weak_ptr<SandboxJSIState> state)
+      : globalDelegateRef_(env->NewGlobalRef(delegateRef)),
+        state_(std::move(state)) {}
 
   ~JNISandboxDelegate() override {
     invalidate();
@@ -72,28 +271,48 @@ class JNISandboxDelegate : public rnsandbox::ISandboxDelegate {
     }
   }
 
-  void postMessage(const std::string& message) override {
-    std::lock_guard<std::mutex> lock(mutex_);
-    JNIEnv* env = getJNIEnv();
-    if (!env || !globalDelegateRef_)
+  void postMessage(
+      const std::string& message,
+      rnsandbox::MessagePriority priority) override {
+    auto state = state_.lock();
+    if (!state)
       return;
-    jclass cls = env->GetObjectClass(globalDelegateRef_);
-    jmethodID mid =
-        env->GetMethodID(cls, "postMessage", "(Ljava/lang/String;)V");
-    jstring jMsg = env->NewStringUTF(message.c_str());
-    env->CallVoidMethod(globalDelegateRef_, mid, jMsg);
-    env->DeleteLocalRef(jMsg);
-    env->DeleteLocalRef(cls);
+    bool needsDrain = false;
+    {
+      // Pushed under the lock so parkRuntime() cannot miss the message
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (state->parked) {
+        state->hibernation->parkMessage(message, priority);
+        return;
+      }
+      needsDrain = state->inbox->push(message, priority);
+    }
+    rnsandbox::SandboxMemoryGovernor::getInstance().touch(state->memoryId);
+    if (needsDrain) {
+      scheduleInboxDrain(*this, state_);
+    }
   }
 
-  bool routeMessage(const std::string& message, const std::string& targetId)
-      override {
+  bool routeMessage(
+      const std::string& message,
+      const std::string& targetId,
+      rnsandbox::MessagePriority priority) override {
+    std::string origin;
+    if (auto state = state_.lock()) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      origin = state->origin;
+    }
     auto& registry = rnsandbox::SandboxRegistry::getInstance();
+    if (!registry.isPermittedFrom(origin, targetId)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      reportAccessDenied(globalDelegateRef_, origin, targetId);
+      return false;
+    }
     auto targets = registry.findAll(targetId);
     if (targets.empty())
       return false;
     for (auto& target : targets) {
-      target->postMessage(message);
+      target->postMessage(message, priority);
     }
     return true;
   }
@@ -102,11 +321,262 @@ class JNISandboxDelegate : public rnsandbox::ISandboxDelegate {
   void setAllowedOrigins(const std::set<std::string>&) override {}
   void setAllowedTurboModules(const std::set<std::string>&) override {}
 
+  bool scheduleOnJSThread(
+      std::function<void(jsi::Runtime&)> work) override {
+    auto state = state_.lock();
+    if (!state) {
+      return false;
+    }
+
+    bool needsDispatch = false;
+    {
+      std::lock_guard<std::mutex> lock(state->tasksMutex);
+      state->scheduledTasks.push_back(std::move(work));
+      needsDispatch = !state->tasksDispatched;
+      state->tasksDispatched = true;
+    }
+
+    // One runOnJSQueueThread hop drains every task queued until it runs
+    if (needsDispatch && !dispatchScheduledTasks()) {
+      // No React context yet; tasks stay queued and are flushed once
+      // onReactContextInitialized fires or the next task is scheduled.
+      std::lock_guard<std::mutex> lock(state->tasksMutex);
+      state->tasksDispatched = false;
+    }
+    return true;
+  }
+
  private:
+  bool dispatchScheduledTasks() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JNIEnv* env = getJNIEnv();
+    if (!env || !globalDelegateRef_)
+      return false;
+    jclass cls = env->GetObjectClass(globalDelegateRef_);
+    jmethodID mid = env->GetMethodID(cls, "scheduleJSTasks", "()Z");
+    jboolean scheduled = env->CallBooleanMethod(globalDelegateRef_, mid);
+    env->DeleteLocalRef(cls);
+    return scheduled;
+  }
+
   jobject globalDelegateRef_;
+  std::weak_ptr<SandboxJSIState> state_;
   std::mutex mutex_;
 };
 
+static std::set<std::string> toStringSet(JNIEnv* env, jobjectArray array) {
+  std::set<std::string> result;
+  jsize length = array ? env->GetArrayLength(array) : 0;
+  for (jsize i = 0; i < length; ++i) {
+    auto jString = (jstring)env->GetObjectArrayElement(array, i);
+    if (!jString)
+      continue;
+    const char* chars = env->GetStringUTFChars(jString, nullptr);
+    result.emplace(chars);
+    env->ReleaseStringUTFChars(jString, chars);
+    env->DeleteLocalRef(jString);
+  }
+  return result;
+}
+
+static std::string toStdString(JNIEnv* env, jstring string) {
+  if (!string)
+    return {};
+  const char* chars = env->GetStringUTFChars(string, nullptr);
+  std::string result(chars);
+  env->ReleaseStringUTFChars(string, chars);
+  return result;
+}
+
+// Preloader and executor workers are native threads that exit once idle; ART
+// aborts the app if one exits while still attached to the VM
+struct WorkerThreadDetacher {
+  ~WorkerThreadDetacher() {
+    if (gJavaVM)
+      gJavaVM->DetachCurrentThread();
+  }
+};
+
+// Runs on a preloader worker. Calls the Kotlin SandboxBundlePreloader's
+// fetch(source), which returns the bundle's path or throws.
+static rnsandbox::PreloadResult fetchBundle(
+    jobject fetcherRef,
+    const std::string& source) {
+  rnsandbox::PreloadResult result;
+  JNIEnv* env = getJNIEnv();
+  if (!env) {
+    result.error = "No JNI environment";
+    return result;
+  }
+  static thread_local WorkerThreadDetacher detacher;
+  (void)detacher;
+
+  jclass cls = env->GetObjectClass(fetcherRef);
+  jmethodID mid =
+      env->GetMethodID(cls, "fetch", "(Ljava/lang/String;)Ljava/lang/String;");
+  jstring jSource = env->NewStringUTF(source.c_str());
+  auto jPath = (jstring)env->CallObjectMethod(fetcherRef, mid, jSource);
+  if (env->ExceptionCheck()) {
+    jthrowable error = env->ExceptionOccurred();
+    env->ExceptionClear();
+    jclass errorCls = env->GetObjectClass(error);
+    jmethodID toStringMid =
+        env->GetMethodID(errorCls, "toString", "()Ljava/lang/String;");
+    auto jMessage = (jstring)env->CallObjectMethod(error, toStringMid);
+    result.error = toStdString(env, jMessage);
+    env->DeleteLocalRef(jMessage);
+    env->DeleteLocalRef(errorCls);
+    env->DeleteLocalRef(error);
+  } else {
+    result.path = toStdString(env, jPath);
+  }
+  env->DeleteLocalRef(jPath);
+  env->DeleteLocalRef(jSource);
+  env->DeleteLocalRef(cls);
+  return result;
+}
+
+// Runs on an executor worker. A Java exception is logged rather than left
+// pending, so the worker can go on with the next task.
+static void runJavaTask(jobject taskRef) {
+  JNIEnv* env = getJNIEnv();
+  if (!env) {
+    return;
+  }
+  static thread_local WorkerThreadDetacher detacher;
+  (void)detacher;
+
+  jclass cls = env->GetObjectClass(taskRef);
+  jmethodID mid = env->GetMethodID(cls, "run", "()V");
+  env->CallVoidMethod(taskRef, mid);
+  if (env->ExceptionCheck()) {
+    LOGE("Uncaught exception in a sandbox executor task");
+    env->ExceptionDescribe();
+    env->ExceptionClear();
+  }
+  env->DeleteLocalRef(cls);
+  env->DeleteGlobalRef(taskRef);
+}
+
+static std::shared_ptr<MemoryEntry> findMemoryEntry(jlong id) {
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  auto it = gMemoryEntries.find(id);
+  return it != gMemoryEntries.end() ? it->second : nullptr;
+}
+
+static std::shared_ptr<rnsandbox::StartupTimeline> findStartupTimeline(
+    jlong handle) {
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  auto it = gStartupTimelines.find(handle);
+  return it != gStartupTimelines.end() ? it->second : nullptr;
+}
+
+static void markStartupPhase(
+    const SandboxJSIState& state,
+    rnsandbox::StartupPhase phase) {
+  if (state.startupTimeline) {
+    state.startupTimeline->mark(phase);
+  }
+}
+
+static std::shared_ptr<HibernationEntry> findHibernation(jlong handle) {
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  auto it = gHibernations.find(handle);
+  return it != gHibernations.end() ? it->second : nullptr;
+}
+
+// Calls a void method of the Kotlin delegate from any thread
+static void
+callDelegate(jobject delegateRef, const char* method, const char* sig, ...) {
+  JNIEnv* env = getJNIEnv();
+  if (!env || !delegateRef)
+    return;
+  jclass cls = env->GetObjectClass(delegateRef);
+  jmethodID mid = env->GetMethodID(cls, method, sig);
+  va_list args;
+  va_start(args, sig);
+  env->CallVoidMethodV(delegateRef, mid, args);
+  va_end(args);
+  env->DeleteLocalRef(cls);
+}
+
+// Runs on the JS thread once the snapshot is taken. Hands everything the
+// runtime has not delivered yet to the hibernation and puts a parked
+// delegate in its registry slot, so the origin stays reachable after
+// nativeDestroy.
+static void parkRuntime(HibernationEntry& entry, SandboxJSIState& state) {
+  std::string origin;
+  std::shared_ptr<rnsandbox::ISandboxDelegate> delegate;
+  std::vector<std::string> pending;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.parked = true;
+    origin = state.origin;
+    delegate = state.registryDelegate;
+    pending.swap(state.pendingMessages);
+  }
+
+  // Lanes are not kept past the inbox, which already serves urgent messages
+  // first, so everything is re-parked as bulk in delivery order
+  for (auto& message : pending) {
+    entry.hibernation->parkMessage(
+        std::move(message), rnsandbox::MessagePriority::Bulk);
+  }
+  while (state.inbox->drain([&entry](std::string&& message) {
+    entry.hibernation->parkMessage(
+        std::move(message), rnsandbox::MessagePriority::Bulk);
+  })) {
+  }
+
+  if (origin.empty() || !delegate)
+    return;
+  auto parked =
+      std::make_shared<rnsandbox::ParkedSandboxDelegate>(entry.hibernation);
+  if (rnsandbox::SandboxRegistry::getInstance().replaceDelegate(
+          origin, delegate, parked)) {
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    entry.parkedDelegate = std::move(parked);
+    entry.parkedOrigin = origin;
+  }
+}
+
+// Moves messages parked during hibernation into a new runtime's delegate
+// and gives it the parked delegate's registry slot.
+static bool unparkInto(
+    HibernationEntry& entry,
+    const std::string& origin,
+    const std::shared_ptr<rnsandbox::ISandboxDelegate>& delegate) {
+  std::shared_ptr<rnsandbox::ISandboxDelegate> parked;
+  std::string parkedOrigin;
+  {
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    parked = std::move(entry.parkedDelegate);
+    parkedOrigin = std::move(entry.parkedOrigin);
+    entry.parkedDelegate.reset();
+    entry.awaitingRuntime = false;
+  }
+
+  auto replay = [&entry, &delegate] {
+    for (auto& [message, priority] : entry.hibernation->takeParkedMessages()) {
+      delegate->postMessage(message, priority);
+    }
+  };
+
+  replay();
+  bool replaced = false;
+  if (parked) {
+    auto& registry = rnsandbox::SandboxRegistry::getInstance();
+    if (parkedOrigin == origin) {
+      replaced = registry.replaceDelegate(origin, parked, delegate);
+    } else {
+      registry.unregisterDelegate(parkedOrigin, parked);
+    }
+  }
+  // Parked between the first replay and the swap
+  replay();
+  return replaced;
+}
+
 static std::string safeGetStringProperty(
     jsi::Runtime& rt,
     const jsi::Object& obj,
@@ -232,19 +702,25 @@ jlong installSandboxJSIBindings(
   jobject globalDelegateRef = env->NewGlobalRef(delegateRef);
   state->delegateRef = globalDelegateRef;
 
+  // The watchdog is never armed here. React Native's Android Hermes runtimes
+  // do not check for async breaks in the source they evaluate, and its build
+  // compiles bytecode without them, so an interrupt would never land; a
+  // watchdog would only add a fatal error next to the still running JS.
+
   auto postMessageFn = jsi::Function::createFromHostFunction(
       runtime,
       jsi::PropNameID::forAscii(runtime, "postMessage"),
-      2,
+      3,
       [stateWeak = std::weak_ptr<SandboxJSIState>(state)](
           jsi::Runtime& rt,
           const jsi::Value&,
           const jsi::Value* args,
           size_t count) -> jsi::Value {
-        if (count < 1 || count > 2) {
+        if (count < 1 || count > 3) {
           throw jsi::JSError(
               rt,
-              "postMessage(message, targetOrigin?): expected 1 or 2 arguments");
+              "postMessage(message, targetOrigin?, options?): expected 1 to 3 "
+              "arguments");
         }
         if (!args[0].isObject()) {
           throw jsi::JSError(
@@ -255,30 +731,52 @@ jlong installSandboxJSIBindings(
         if (!statePtr || !statePtr->delegateRef)
           return jsi::Value::undefined();
 
-        jsi::Object jsonObj = rt.global().getPropertyAsObject(rt, "JSON");
-        jsi::Function stringify =
-            jsonObj.getPropertyAsFunction(rt, "stringify");
-        std::string messageJson =
-            stringify.call(rt, args[0]).getString(rt).utf8(rt);
+        rnsandbox::CpuScope callScope(
+            statePtr->cpuAccount, rnsandbox::CpuCategory::NativeCall);
+        std::string messageJson;
+        {
+          rnsandbox::CpuScope scope(
+              statePtr->cpuAccount, rnsandbox::CpuCategory::Serialization);
+          jsi::Object jsonObj = rt.global().getPropertyAsObject(rt, "JSON");
+          jsi::Function stringify =
+              jsonObj.getPropertyAsFunction(rt, "stringify");
+          messageJson = stringify.call(rt, args[0]).getString(rt).utf8(rt);
+        }
 
         JNIEnv* jniEnv = getJNIEnv();
         if (!jniEnv)
           return jsi::Value::undefined();
 
-        if (count == 2 && !args[1].isNull() && !args[1].isUndefined()) {
+        if (count >= 2 && !args[1].isNull() && !args[1].isUndefined()) {
           if (!args[1].isString()) {
             throw jsi::JSError(
                 rt, "postMessage: targetOrigin must be a string");
           }
           std::string targetOrigin = args[1].getString(rt).utf8(rt);
-
+          jsi::Value noOptions;
+          auto options = rnsandbox::parsePostMessageOptions(
+              rt, count > 2 ? args[2] : noOptions);
+
+          std::string origin;
+          {
+            std::lock_guard<std::mutex> lock(statePtr->mutex);
+            origin = statePtr->origin;
+          }
           auto& registry = rnsandbox::SandboxRegistry::getInstance();
+          if (!registry.isPermittedFrom(origin, targetOrigin)) {
+            reportAccessDenied(statePtr->delegateRef, origin, targetOrigin);
+            return jsi::Value::undefined();
+          }
           auto targets = registry.findAll(targetOrigin);
           if (!targets.empty()) {
             for (auto& target : targets) {
-              target->postMessage(messageJson);
+              target->postMessage(messageJson, options.priority);
             }
-          } else {
+          } else if (!registry.holdMessage(
+                         targetOrigin,
+                         std::move(messageJson),
+                         options.priority,
+                         options.ttl)) {
             LOGW("postMessage: target '%s' not found", targetOrigin.c_str());
           }
         } else {
@@ -322,6 +820,8 @@ jlong installSandboxJSIBindings(
               args[0].asObject(rt).asFunction(rt));
           buffered.swap(statePtr->pendingMessages);
         }
+        markStartupPhase(
+            *statePtr, rnsandbox::StartupPhase::OnMessageRegistered);
 
         for (const auto& msg : buffered) {
           try {
@@ -379,33 +879,112 @@ jlong installSandboxJSIBindings(
 
   rnsandbox::disableFuseboxLogBoxToast(runtime);
 
-  // Register in C++ SandboxRegistry if origin is set
+  try {
+    rnsandbox::installMessageQueueBindings(runtime, state->inbox);
+  } catch (const std::exception& e) {
+    LOGW("Failed to install message queue bindings: %s", e.what());
+  }
+
+  std::shared_ptr<HibernationEntry> hibernationEntry;
+  {
+    jclass cls = env->GetObjectClass(delegateRef);
+    jfieldID handleField = env->GetFieldID(cls, "hibernationHandle", "J");
+    hibernationEntry =
+        findHibernation(env->GetLongField(delegateRef, handleField));
+    env->DeleteLocalRef(cls);
+  }
+  if (hibernationEntry) {
+    state->hibernation = hibernationEntry->hibernation;
+    try {
+      rnsandbox::installHibernationBindings(
+          runtime, state->hibernation, state->jsHandlers);
+    } catch (const std::exception& e) {
+      LOGW("Failed to install hibernation bindings: %s", e.what());
+    }
+  }
+
+  {
+    jclass cls = env->GetObjectClass(delegateRef);
+    jfieldID handleField = env->GetFieldID(cls, "startupTimelineHandle", "J");
+    state->startupTimeline =
+        findStartupTimeline(env->GetLongField(delegateRef, handleField));
+    env->DeleteLocalRef(cls);
+  }
+
+  {
+    jclass cls = env->GetObjectClass(delegateRef);
+    jfieldID idField = env->GetFieldID(cls, "memoryGovernorId", "J");
+    jlong memoryId = env->GetLongField(delegateRef, idField);
+    env->DeleteLocalRef(cls);
+    if (auto memoryEntry = findMemoryEntry(memoryId)) {
+      {
+        std::lock_guard<std::mutex> lock(memoryEntry->mutex);
+        memoryEntry->state = state;
+      }
+      state->memoryId = static_cast<uint64_t>(memoryId);
+      rnsandbox::SandboxMemoryGovernor::getInstance().touch(state->memoryId);
+    }
+  }
+
+  // Register in C++ SandboxRegistry if origin is set. The delegate is
+  // created regardless, as it also carries host messages into the inbox.
   {
     JNIEnv* jniEnv = getJNIEnv();
     if (jniEnv) {
+      auto delegate = std::make_shared<JNISandboxDelegate>(
+          jniEnv, globalDelegateRef, std::weak_ptr<SandboxJSIState>(state));
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->registryDelegate = delegate;
+      }
+
       jclass cls = jniEnv->GetObjectClass(globalDelegateRef);
       jfieldID originField =
           jniEnv->GetFieldID(cls, "origin", "Ljava/lang/String;");
       auto jOrigin =
           (jstring)jniEnv->GetObjectField(globalDelegateRef, originField);
       jniEnv->DeleteLocalRef(cls);
+      std::string origin;
       if (jOrigin) {
         const char* originChars = jniEnv->GetStringUTFChars(jOrigin, nullptr);
-        std::string origin(originChars);
+        origin = originChars;
         jniEnv->ReleaseStringUTFChars(jOrigin, originChars);
         jniEnv->DeleteLocalRef(jOrigin);
-        if (!origin.empty()) {
-          state->origin = origin;
-          auto delegate =
-              std::make_shared<JNISandboxDelegate>(jniEnv, globalDelegateRef);
-          state->registryDelegate = delegate;
+      }
+      // A resumed sandbox takes over the slot its parked delegate held
+      bool registered = hibernationEntry &&
+          unparkInto(*hibernationEntry, origin, delegate);
+      if (!origin.empty()) {
+        state->origin = origin;
+        auto& cpuAccounting = rnsandbox::SandboxCpuAccounting::getInstance();
+        state->cpuAccount = cpuAccounting.account(origin).get();
+        // allowedOrigins are pushed from Kotlin right after install via
+        // nativeSetAllowedOrigins
+        if (!registered) {
           rnsandbox::SandboxRegistry::getInstance().registerSandbox(
               origin, delegate, std::set<std::string>());
         }
+
+        std::weak_ptr<rnsandbox::ISandboxDelegate> weakDelegate = delegate;
+        try {
+          rnsandbox::installMessageChannelBindings(
+              runtime, origin, weakDelegate, state->messagePorts);
+          rnsandbox::installRpcBindings(
+              runtime, origin, weakDelegate, state->jsHandlers);
+          rnsandbox::installPresenceBindings(
+              runtime, origin, weakDelegate, state->jsHandlers);
+          rnsandbox::installSharedStateBindings(
+              runtime, origin, weakDelegate, state->jsHandlers);
+          rnsandbox::installSharedMemoryBindings(
+              runtime, origin, weakDelegate, state->jsHandlers);
+        } catch (const std::exception& e) {
+          LOGW("Failed to install sandbox bindings: %s", e.what());
+        }
       }
     }
   }
 
+  markStartupPhase(*state, rnsandbox::StartupPhase::BindingsInstalled);
   return stateHandle;
 }
 
@@ -437,7 +1016,8 @@ Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativePostMessage(
     JNIEnv* env,
     jclass,
     jlong stateHandle,
-    jstring message) {
+    jstring message,
+    jboolean urgent) {
   std::shared_ptr<SandboxJSIState> state;
   {
     std::lock_guard<std::mutex> lock(gRegistryMutex);
@@ -451,35 +1031,159 @@ Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativePostMessage(
   std::string messageStr(msgChars);
   env->ReleaseStringUTFChars(message, msgChars);
 
-  std::lock_guard<std::mutex> lock(state->mutex);
-  if (!state->runtime)
-    return;
+  std::shared_ptr<rnsandbox::ISandboxDelegate> delegate;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!state->runtime)
+      return;
+    delegate = state->registryDelegate;
+  }
+  if (delegate) {
+    delegate->postMessage(
+        messageStr,
+        urgent ? rnsandbox::MessagePriority::Urgent
+               : rnsandbox::MessagePriority::Bulk);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeRunScheduledTasks(
+    JNIEnv*,
+    jclass,
+    jlong stateHandle) {
+  std::shared_ptr<SandboxJSIState> state;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gStates.find(stateHandle);
+    if (it == gStates.end())
+      return;
+    state = it->second;
+  }
+
+  jsi::Runtime* runtime = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    runtime = state->runtime;
+  }
 
-  if (!state->onMessageCallback) {
-    state->pendingMessages.push_back(std::move(messageStr));
+  std::vector<std::function<void(jsi::Runtime&)>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(state->tasksMutex);
+    tasks.swap(state->scheduledTasks);
+    state->tasksDispatched = false;
+  }
+  if (!runtime || tasks.empty())
     return;
+
+  // Tasks run without holding state->mutex: they may call back into host
+  // functions (e.g. setOnMessage) that take it.
+  auto& watchdog = rnsandbox::SandboxWatchdog::getInstance();
+  for (auto& task : tasks) {
+    try {
+      rnsandbox::SandboxWatchdog::Scope scope(
+          watchdog, state->watchdogId, "scheduled task");
+      rnsandbox::CpuScope cpuScope(
+          state->cpuAccount, rnsandbox::CpuCategory::UserCallback);
+      task(*runtime);
+    } catch (const jsi::JSError& e) {
+      LOGE("JSError in scheduled task: %s", e.getMessage().c_str());
+    } catch (const std::exception& e) {
+      LOGE("Exception in scheduled task: %s", e.what());
+    }
   }
 
   try {
-    jsi::Runtime& rt = *state->runtime;
-    jsi::Value parsed =
-        rt.global()
-            .getPropertyAsObject(rt, "JSON")
-            .getPropertyAsFunction(rt, "parse")
-            .call(rt, jsi::String::createFromUtf8(rt, messageStr));
-    state->onMessageCallback->call(rt, std::move(parsed));
-
-    // runOnJSQueueThread does not drain the microtask queue, so React/Fabric
-    // never sees the state update. Drain explicitly to mirror what the
-    // RuntimeExecutor (and iOS's callFunctionOnBufferedRuntimeExecutor) does.
-    rt.drainMicrotasks();
-  } catch (const jsi::JSError& e) {
-    LOGE("JSError in postMessage: %s", e.getMessage().c_str());
+    runtime->drainMicrotasks();
   } catch (const std::exception& e) {
-    LOGE("Exception in postMessage: %s", e.what());
+    LOGE("Exception draining microtasks: %s", e.what());
+  }
+
+  // A hibernating runtime is about to be released, its heap no longer counts
+  if (state->memoryId != 0 &&
+      (!state->hibernation ||
+       state->hibernation->state() == rnsandbox::HibernationState::Active)) {
+    rnsandbox::sampleHeapUsage(*runtime, state->memoryId);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetAllowedOrigins(
+    JNIEnv* env,
+    jclass,
+    jlong stateHandle,
+    jobjectArray origins) {
+  std::shared_ptr<SandboxJSIState> state;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gStates.find(stateHandle);
+    if (it == gStates.end())
+      return;
+    state = it->second;
+  }
+
+  std::set<std::string> allowedOrigins = toStringSet(env, origins);
+
+  std::string origin;
+  std::shared_ptr<rnsandbox::ISandboxDelegate> delegate;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    origin = state->origin;
+    delegate = state->registryDelegate;
+  }
+  if (!origin.empty() && delegate) {
+    rnsandbox::SandboxRegistry::getInstance().registerSandbox(
+        origin, delegate, allowedOrigins);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetSharedStateAccess(
+    JNIEnv* env,
+    jclass,
+    jlong stateHandle,
+    jobjectArray readKeys,
+    jobjectArray writeKeys) {
+  std::shared_ptr<SandboxJSIState> state;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gStates.find(stateHandle);
+    if (it == gStates.end())
+      return;
+    state = it->second;
+  }
+
+  std::string origin;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    origin = state->origin;
+  }
+  if (!origin.empty()) {
+    rnsandbox::SharedStateStore::getInstance().setAccess(
+        origin, toStringSet(env, readKeys), toStringSet(env, writeKeys));
   }
 }
 
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetSharedState(
+    JNIEnv* env,
+    jclass,
+    jstring key,
+    jstring value) {
+  if (!key)
+    return;
+  const char* keyChars = env->GetStringUTFChars(key, nullptr);
+  std::string keyStr(keyChars);
+  env->ReleaseStringUTFChars(key, keyChars);
+
+  std::optional<std::string> json;
+  if (value && env->GetStringUTFLength(value) > 0) {
+    const char* valueChars = env->GetStringUTFChars(value, nullptr);
+    json = std::string(valueChars);
+    env->ReleaseStringUTFChars(value, valueChars);
+  }
+  rnsandbox::SharedStateStore::getInstance().hostWrite(keyStr, std::move(json));
+}
+
 JNIEXPORT void JNICALL
 Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeInstallErrorHandler(
     JNIEnv*,
@@ -500,6 +1204,7 @@ Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeInstallErrorHandler(
 
   try {
     setupErrorHandler(*state->runtime, std::weak_ptr<SandboxJSIState>(state));
+    markStartupPhase(*state, rnsandbox::StartupPhase::ErrorHandlerInstalled);
   } catch (const std::exception& e) {
     LOGW("Failed to setup error handler post-bundle: %s", e.what());
   }
@@ -521,12 +1226,15 @@ Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeDestroy(
   std::lock_guard<std::mutex> lock(gRegistryMutex);
   auto it = gStates.find(stateHandle);
   if (it != gStates.end()) {
+    rnsandbox::SandboxWatchdog::getInstance().remove(it->second->watchdogId);
     std::string origin;
     std::shared_ptr<rnsandbox::ISandboxDelegate> delegate;
+    std::shared_ptr<rnsandbox::SandboxRealmSet> realms;
     jobject delegateRef = nullptr;
     {
       std::lock_guard<std::mutex> stateLock(it->second->mutex);
       origin = it->second->origin;
+      realms = std::move(it->second->realms);
       delegate = it->second->registryDelegate;
       delegateRef = it->second->delegateRef;
       it->second->onMessageCallback.reset();
@@ -535,7 +1243,16 @@ Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeDestroy(
       it->second->registryDelegate.reset();
       it->second->delegateRef = nullptr;
     }
+    {
+      std::lock_guard<std::mutex> tasksLock(it->second->tasksMutex);
+      it->second->scheduledTasks.clear();
+    }
+    it->second->inbox->clear();
+    it->second->messagePorts->closeAll();
+    // Unregisters the realms' origins
+    realms.reset();
     if (!origin.empty() && delegate) {
+      // Drops the origin's shared state access if this was its last delegate
       rnsandbox::SandboxRegistry::getInstance().unregisterDelegate(
           origin, delegate);
     }
@@ -549,4 +1266,1006 @@ Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeDestroy(
   }
 }
 
+JNIEXPORT jlong JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeCreateHibernation(
+    JNIEnv* env,
+    jclass,
+    jobject delegateRef) {
+  auto entry = std::make_shared<HibernationEntry>();
+  entry->delegateRef = env->NewGlobalRef(delegateRef);
+
+  std::weak_ptr<HibernationEntry> weakEntry = entry;
+  entry->hibernation->setWakeHandler([weakEntry] {
+    if (auto entry = weakEntry.lock()) {
+      callDelegate(entry->delegateRef, "onHibernationWakeRequest", "()V");
+    }
+  });
+
+  jlong handle = reinterpret_cast<jlong>(entry.get());
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  gHibernations[handle] = std::move(entry);
+  return handle;
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeDestroyHibernation(
+    JNIEnv* env,
+    jclass,
+    jlong hibernationHandle) {
+  std::shared_ptr<HibernationEntry> entry;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gHibernations.find(hibernationHandle);
+    if (it == gHibernations.end())
+      return;
+    entry = std::move(it->second);
+    gHibernations.erase(it);
+  }
+
+  entry->hibernation->setWakeHandler(nullptr);
+  std::shared_ptr<rnsandbox::ISandboxDelegate> parked;
+  std::string parkedOrigin;
+  {
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    parked = std::move(entry->parkedDelegate);
+    parkedOrigin = std::move(entry->parkedOrigin);
+  }
+  if (parked) {
+    rnsandbox::SandboxRegistry::getInstance().unregisterDelegate(
+        parkedOrigin, parked);
+  }
+  env->DeleteGlobalRef(entry->delegateRef);
+  entry->delegateRef = nullptr;
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetHibernationWakePolicy(
+    JNIEnv* env,
+    jclass,
+    jlong hibernationHandle,
+    jstring policy) {
+  auto entry = findHibernation(hibernationHandle);
+  if (!entry || !policy)
+    return;
+  const char* policyChars = env->GetStringUTFChars(policy, nullptr);
+  auto wakePolicy = rnsandbox::HibernationWakePolicy::Queue;
+  if (!rnsandbox::parseHibernationWakePolicy(policyChars, wakePolicy)) {
+    LOGW("Unknown hibernationWakePolicy '%s', using 'queue'", policyChars);
+  }
+  env->ReleaseStringUTFChars(policy, policyChars);
+  entry->hibernation->setWakePolicy(wakePolicy);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeHibernate(
+    JNIEnv*,
+    jclass,
+    jlong stateHandle,
+    jlong hibernationHandle) {
+  auto entry = findHibernation(hibernationHandle);
+  if (!entry || !entry->hibernation->beginHibernate())
+    return JNI_FALSE;
+
+  std::shared_ptr<SandboxJSIState> state;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gStates.find(stateHandle);
+    if (it != gStates.end())
+      state = it->second;
+  }
+  std::shared_ptr<rnsandbox::ISandboxDelegate> delegate;
+  if (state) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->runtime)
+      delegate = state->registryDelegate;
+  }
+
+  auto finish = [](HibernationEntry& entry,
+                   std::optional<std::string> stateJson) {
+    {
+      std::lock_guard<std::mutex> lock(entry.mutex);
+      entry.awaitingRuntime = true;
+    }
+    bool resumeRequested =
+        entry.hibernation->completeHibernate(std::move(stateJson));
+    callDelegate(
+        entry.delegateRef,
+        "onHibernated",
+        "(Z)V",
+        static_cast<jboolean>(resumeRequested));
+  };
+
+  std::weak_ptr<HibernationEntry> weakEntry = entry;
+  std::weak_ptr<SandboxJSIState> weakState = state;
+  bool scheduled = delegate &&
+      delegate->scheduleOnJSThread(
+          [weakEntry, weakState, finish](jsi::Runtime& rt) {
+            auto entry = weakEntry.lock();
+            if (!entry)
+              return;
+            std::optional<std::string> stateJson;
+            try {
+              stateJson = entry->hibernation->snapshot(rt);
+            } catch (const jsi::JSError& e) {
+              LOGE("JSError in onHibernate: %s", e.getMessage().c_str());
+              emitDelegateError(
+                  entry->delegateRef,
+                  "HibernationError",
+                  e.getMessage().c_str(),
+                  false);
+            } catch (const std::exception& e) {
+              LOGE("Exception in onHibernate: %s", e.what());
+              emitDelegateError(
+                  entry->delegateRef, "HibernationError", e.what(), false);
+            }
+            if (auto state = weakState.lock()) {
+              parkRuntime(*entry, *state);
+            }
+            finish(*entry, std::move(stateJson));
+          });
+  if (!scheduled) {
+    // Never started, so there is nothing to snapshot
+    finish(*entry, std::nullopt);
+  }
+  return JNI_TRUE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeResume(
+    JNIEnv*,
+    jclass,
+    jlong hibernationHandle) {
+  auto entry = findHibernation(hibernationHandle);
+  return entry && entry->hibernation->resume() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeParkMessage(
+    JNIEnv* env,
+    jclass,
+    jlong hibernationHandle,
+    jstring message,
+    jboolean urgent) {
+  auto entry = findHibernation(hibernationHandle);
+  if (!entry)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (!entry->awaitingRuntime &&
+        entry->hibernation->state() == rnsandbox::HibernationState::Active)
+      return;
+  }
+
+  const char* msgChars = env->GetStringUTFChars(message, nullptr);
+  std::string messageStr(msgChars);
+  env->ReleaseStringUTFChars(message, msgChars);
+  entry->hibernation->parkMessage(
+      std::move(messageStr),
+      urgent ? rnsandbox::MessagePriority::Urgent
+             : rnsandbox::MessagePriority::Bulk);
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeAddToMemoryGovernor(
+    JNIEnv* env,
+    jclass,
+    jobject delegateRef) {
+  auto entry = std::make_shared<MemoryEntry>();
+  entry->delegateRef = env->NewGlobalRef(delegateRef);
+
+  std::weak_ptr<MemoryEntry> weakEntry = entry;
+  rnsandbox::SandboxMemoryGovernor::Hooks hooks;
+  hooks.collectGarbage = [weakEntry] {
+    auto entry = weakEntry.lock();
+    if (!entry)
+      return;
+    std::shared_ptr<SandboxJSIState> state;
+    {
+      std::lock_guard<std::mutex> lock(entry->mutex);
+      state = entry->state.lock();
+    }
+    if (!state)
+      return;
+    std::shared_ptr<rnsandbox::ISandboxDelegate> delegate;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      delegate = state->registryDelegate;
+    }
+    if (delegate) {
+      auto memoryId = state->memoryId;
+      delegate->scheduleOnJSThread([memoryId](jsi::Runtime& rt) {
+        rnsandbox::collectGarbage(rt, memoryId);
+      });
+    }
+  };
+  hooks.evict = [weakEntry](rnsandbox::EvictionReason reason, size_t bytes) {
+    auto entry = weakEntry.lock();
+    JNIEnv* env = getJNIEnv();
+    if (!entry || !env)
+      return;
+    jstring jReason = env->NewStringUTF(rnsandbox::toString(reason));
+    callDelegate(
+        entry->delegateRef,
+        "onMemoryEviction",
+        "(Ljava/lang/String;J)V",
+        jReason,
+        static_cast<jlong>(bytes));
+    env->DeleteLocalRef(jReason);
+  };
+
+  auto id = static_cast<jlong>(
+      rnsandbox::SandboxMemoryGovernor::getInstance().add(std::move(hooks)));
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  gMemoryEntries[id] = std::move(entry);
+  return id;
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeRemoveFromMemoryGovernor(
+    JNIEnv* env,
+    jclass,
+    jlong memoryGovernorId) {
+  std::shared_ptr<MemoryEntry> entry;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gMemoryEntries.find(memoryGovernorId);
+    if (it == gMemoryEntries.end())
+      return;
+    entry = std::move(it->second);
+    gMemoryEntries.erase(it);
+  }
+  rnsandbox::SandboxMemoryGovernor::getInstance().remove(
+      static_cast<uint64_t>(memoryGovernorId));
+  env->DeleteGlobalRef(entry->delegateRef);
+  entry->delegateRef = nullptr;
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetHeapLimit(
+    JNIEnv*,
+    jclass,
+    jlong memoryGovernorId,
+    jlong bytes) {
+  rnsandbox::SandboxMemoryGovernor::getInstance().setHeapLimit(
+      static_cast<uint64_t>(memoryGovernorId),
+      static_cast<size_t>(bytes > 0 ? bytes : 0));
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetEvictionPolicy(
+    JNIEnv* env,
+    jclass,
+    jlong memoryGovernorId,
+    jstring policy) {
+  const char* policyChars = env->GetStringUTFChars(policy, nullptr);
+  auto evictionPolicy = rnsandbox::EvictionPolicy::Hibernate;
+  rnsandbox::parseEvictionPolicy(policyChars, evictionPolicy);
+  env->ReleaseStringUTFChars(policy, policyChars);
+  rnsandbox::SandboxMemoryGovernor::getInstance().setEvictionPolicy(
+      static_cast<uint64_t>(memoryGovernorId), evictionPolicy);
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeOnMemoryPressure(
+    JNIEnv*,
+    jclass,
+    jboolean critical) {
+  if (critical) {
+    rnsandbox::SandboxRuntimeParking::getInstance().releaseAll();
+  }
+  rnsandbox::SandboxMemoryGovernor::getInstance().onMemoryPressure(
+      critical ? rnsandbox::MemoryPressureLevel::Critical
+               : rnsandbox::MemoryPressureLevel::Moderate);
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetWatchdogTimeout(
+    JNIEnv*,
+    jclass,
+    jlong stateHandle,
+    jint timeoutMs) {
+  std::shared_ptr<SandboxJSIState> state;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gStates.find(stateHandle);
+    if (it == gStates.end())
+      return;
+    state = it->second;
+  }
+  rnsandbox::SandboxWatchdog::getInstance().setBudget(
+      state->watchdogId, std::chrono::milliseconds(timeoutMs));
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeCreateStartupTimeline(
+    JNIEnv*,
+    jclass) {
+  auto timeline = std::make_shared<rnsandbox::StartupTimeline>();
+  // Zero-length slices in systrace/Perfetto, one per phase
+  timeline->setTraceHook(
+      [](rnsandbox::StartupPhase phase, std::chrono::nanoseconds offset) {
+        if (!ATrace_isEnabled())
+          return;
+        char name[96];
+        std::snprintf(
+            name,
+            sizeof(name),
+            "RNSandbox startup: %s +%.3fms",
+            rnsandbox::toString(phase),
+            offset.count() / 1e6);
+        ATrace_beginSection(name);
+        ATrace_endSection();
+      });
+  timeline->mark(rnsandbox::StartupPhase::ViewCreated);
+
+  jlong handle = reinterpret_cast<jlong>(timeline.get());
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  gStartupTimelines[handle] = std::move(timeline);
+  return handle;
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeDestroyStartupTimeline(
+    JNIEnv*,
+    jclass,
+    jlong timelineHandle) {
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  gStartupTimelines.erase(timelineHandle);
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeRestartStartupTimeline(
+    JNIEnv*,
+    jclass,
+    jlong timelineHandle) {
+  if (auto timeline = findStartupTimeline(timelineHandle)) {
+    timeline->restart();
+  }
+}
+
+JNIEXPORT jboolean JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeMarkStartupPhase(
+    JNIEnv*,
+    jclass,
+    jlong timelineHandle,
+    jint phase) {
+  auto timeline = findStartupTimeline(timelineHandle);
+  if (!timeline || phase < 0 ||
+      phase >= static_cast<jint>(rnsandbox::kStartupPhaseCount)) {
+    return JNI_FALSE;
+  }
+  return timeline->mark(static_cast<rnsandbox::StartupPhase>(phase))
+      ? JNI_TRUE
+      : JNI_FALSE;
+}
+
+JNIEXPORT jdoubleArray JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeGetStartupTimeline(
+    JNIEnv* env,
+    jclass,
+    jlong timelineHandle) {
+  jdouble values[rnsandbox::kStartupPhaseCount];
+  auto timeline = findStartupTimeline(timelineHandle);
+  auto offsets =
+      timeline ? timeline->offsets() : rnsandbox::StartupTimeline::Offsets{};
+  for (size_t i = 0; i < rnsandbox::kStartupPhaseCount; ++i) {
+    values[i] = offsets[i] ? offsets[i]->count() / 1e6 : -1.0;
+  }
+
+  jdoubleArray result = env->NewDoubleArray(rnsandbox::kStartupPhaseCount);
+  if (result) {
+    env->SetDoubleArrayRegion(
+        result, 0, rnsandbox::kStartupPhaseCount, values);
+  }
+  return result;
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeGetCpuUsageJson(
+    JNIEnv* env,
+    jclass) {
+  auto json = rnsandbox::toJson(
+      rnsandbox::SandboxCpuAccounting::getInstance().snapshot());
+  return env->NewStringUTF(json.c_str());
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeInstallBundlePreloader(
+    JNIEnv* env,
+    jclass,
+    jobject fetcher) {
+  // The Kotlin preloader is a singleton; its reference is never released
+  jobject fetcherRef = env->NewGlobalRef(fetcher);
+  rnsandbox::SandboxBundlePreloader::getInstance().setFetcher(
+      [fetcherRef](const std::string& source) {
+        return fetchBundle(fetcherRef, source);
+      });
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativePreloadBundles(
+    JNIEnv* env,
+    jclass,
+    jobjectArray sources) {
+  std::vector<std::string> sourceList;
+  jsize length = sources ? env->GetArrayLength(sources) : 0;
+  for (jsize i = 0; i < length; ++i) {
+    auto jSource = (jstring)env->GetObjectArrayElement(sources, i);
+    if (!jSource)
+      continue;
+    sourceList.push_back(toStdString(env, jSource));
+    env->DeleteLocalRef(jSource);
+  }
+  rnsandbox::SandboxBundlePreloader::getInstance().preload(sourceList);
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetPreloadConcurrency(
+    JNIEnv*,
+    jclass,
+    jint threads) {
+  rnsandbox::SandboxBundlePreloader::getInstance().setConcurrency(
+      threads > 0 ? static_cast<size_t>(threads) : 1);
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeAwaitPreloadedBundle(
+    JNIEnv* env,
+    jclass,
+    jstring source,
+    jlong timeoutMs) {
+  auto result = rnsandbox::SandboxBundlePreloader::getInstance().wait(
+      toStdString(env, source), std::chrono::milliseconds(timeoutMs));
+  if (!result || !result->ok())
+    return nullptr;
+  return env->NewStringUTF(result->path.c_str());
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeHashBundleFile(
+    JNIEnv* env,
+    jclass,
+    jstring path) {
+  std::string hash = rnsandbox::hashBundleFile(toStdString(env, path));
+  if (hash.empty())
+    return nullptr;
+  return env->NewStringUTF(hash.c_str());
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeApplyBundlePatch(
+    JNIEnv* env,
+    jclass,
+    jstring basePath,
+    jstring patchPath,
+    jstring outputPath) {
+  std::string error;
+  if (rnsandbox::applyBundlePatch(
+          toStdString(env, basePath),
+          toStdString(env, patchPath),
+          toStdString(env, outputPath),
+          &error)) {
+    return nullptr;
+  }
+  return env->NewStringUTF(error.c_str());
+}
+
+// Hot bundle swap, on the JS thread with the surface stopped. Returns the
+// error of the first bundle that failed, null once all are evaluated.
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeEvaluateBundles(
+    JNIEnv* env,
+    jclass,
+    jlong stateHandle,
+    jobjectArray paths,
+    jobjectArray sourceUrls) {
+  std::shared_ptr<SandboxJSIState> state;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gStates.find(stateHandle);
+    if (it == gStates.end())
+      return env->NewStringUTF("Sandbox runtime is gone");
+    state = it->second;
+  }
+
+  jsi::Runtime* runtime = nullptr;
+  std::shared_ptr<jsi::Function> oldCallback;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    runtime = state->runtime;
+    // Messages wait in pendingMessages for the new bundle's setOnMessage
+    oldCallback = std::move(state->onMessageCallback);
+  }
+  if (!runtime)
+    return env->NewStringUTF("Sandbox runtime is gone");
+  // A bundle that threw partway may have left the runtime half replaced
+  if (state->needsReload)
+    return env->NewStringUTF("A previous hot swap failed, reload required");
+  // Released on the JS thread, like every jsi value. Nothing may call into
+  // the old bundle's callbacks; timers it set are not tracked and still fire.
+  oldCallback.reset();
+  state->messagePorts->closeAll();
+  state->jsHandlers.resetAll();
+
+  jsize count = env->GetArrayLength(paths);
+  for (jsize i = 0; i < count; ++i) {
+    auto jPath =
+        static_cast<jstring>(env->GetObjectArrayElement(paths, i));
+    auto jSourceUrl =
+        static_cast<jstring>(env->GetObjectArrayElement(sourceUrls, i));
+    std::string path = toStdString(env, jPath);
+    std::string sourceUrl = toStdString(env, jSourceUrl);
+    env->DeleteLocalRef(jPath);
+    env->DeleteLocalRef(jSourceUrl);
+
+    std::string error;
+    try {
+      rnsandbox::evaluateBundleFile(*runtime, path, sourceUrl);
+    } catch (const jsi::JSError& e) {
+      error = e.getMessage();
+    } catch (const std::exception& e) {
+      error = e.what();
+    }
+    if (!error.empty()) {
+      LOGE("Hot swap to %s failed: %s", sourceUrl.c_str(), error.c_str());
+      state->needsReload = true;
+      return env->NewStringUTF(error.c_str());
+    }
+  }
+  return nullptr;
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeInstallRuntimeParking(
+    JNIEnv* env,
+    jclass,
+    jobject listener) {
+  // The Kotlin parking lot is a singleton; its reference is never released
+  jobject listenerRef = env->NewGlobalRef(listener);
+  rnsandbox::SandboxRuntimeParking::getInstance().setReleaseHook(
+      [listenerRef](rnsandbox::SandboxRuntimeParking::ParkId id) {
+        callDelegate(
+            listenerRef,
+            "onParkedRuntimeReleased",
+            "(J)V",
+            static_cast<jlong>(id));
+      });
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetParkingBudget(
+    JNIEnv*,
+    jclass,
+    jint maxRuntimes,
+    jlong maxBytes,
+    jlong gracePeriodMs) {
+  rnsandbox::ParkingBudget budget;
+  budget.maxRuntimes = maxRuntimes > 0 ? static_cast<size_t>(maxRuntimes) : 0;
+  budget.maxBytes = maxBytes > 0 ? static_cast<size_t>(maxBytes) : 0;
+  budget.gracePeriod =
+      std::chrono::milliseconds(gracePeriodMs > 0 ? gracePeriodMs : 0);
+  rnsandbox::SandboxRuntimeParking::getInstance().setBudget(budget);
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeParkRuntime(
+    JNIEnv* env,
+    jclass,
+    jstring key,
+    jlong memoryGovernorId) {
+  size_t heapBytes = rnsandbox::SandboxMemoryGovernor::getInstance().heapBytes(
+      static_cast<uint64_t>(memoryGovernorId));
+  auto parkId = rnsandbox::SandboxRuntimeParking::getInstance().park(
+      toStdString(env, key), heapBytes);
+  return static_cast<jlong>(parkId);
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeTakeParkedRuntime(
+    JNIEnv* env,
+    jclass,
+    jstring key) {
+  return static_cast<jlong>(
+      rnsandbox::SandboxRuntimeParking::getInstance().take(
+          toStdString(env, key)));
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeReleaseParkedRuntime(
+    JNIEnv*,
+    jclass,
+    jlong parkId) {
+  rnsandbox::SandboxRuntimeParking::getInstance().release(
+      static_cast<rnsandbox::SandboxRuntimeParking::ParkId>(parkId));
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeExpireParkedRuntimes(
+    JNIEnv*,
+    jclass) {
+  rnsandbox::SandboxRuntimeParking::getInstance().expire();
+}
+
+JNIEXPORT jint JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeNextLazyLoadAction(
+    JNIEnv* env,
+    jclass,
+    jboolean started,
+    jfloatArray view,
+    jfloatArray viewport,
+    jfloat loadDistance,
+    jfloat releaseDistance) {
+  double distance = std::numeric_limits<double>::infinity();
+  if (viewport) {
+    jfloat v[4];
+    jfloat p[4];
+    env->GetFloatArrayRegion(view, 0, 4, v);
+    env->GetFloatArrayRegion(viewport, 0, 4, p);
+    distance = rnsandbox::distanceToViewport(
+        {v[0], v[1], v[2], v[3]}, {p[0], p[1], p[2], p[3]});
+  }
+  rnsandbox::LazyLoadDistances distances;
+  distances.load = loadDistance;
+  distances.release = releaseDistance;
+  return static_cast<jint>(
+      rnsandbox::nextLazyLoadAction(started, distance, distances));
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeGetStrand(
+    JNIEnv* env,
+    jclass,
+    jstring label) {
+  // The executor keeps its strands for the life of the process
+  auto strand =
+      rnsandbox::SandboxExecutor::getInstance().strand(toStdString(env, label));
+  return reinterpret_cast<jlong>(strand.get());
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativePostToStrand(
+    JNIEnv* env,
+    jclass,
+    jlong strand,
+    jobject task) {
+  if (!strand || !task)
+    return;
+  jobject taskRef = env->NewGlobalRef(task);
+  reinterpret_cast<rnsandbox::SandboxStrand*>(strand)->post(
+      [taskRef] { runJavaTask(taskRef); });
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeSetExecutorThreads(
+    JNIEnv*,
+    jclass,
+    jint threads) {
+  rnsandbox::SandboxExecutor::getInstance().setMaxThreads(
+      threads > 0 ? static_cast<size_t>(threads) : 1);
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeGetMethodQueueStatsJson(
+    JNIEnv* env,
+    jclass) {
+  auto json =
+      rnsandbox::toJson(rnsandbox::SandboxExecutor::getInstance().laneStats());
+  return env->NewStringUTF(json.c_str());
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeModuleSharingScope(
+    JNIEnv* env,
+    jclass,
+    jint sharing,
+    jstring origin,
+    jstring group) {
+  rnsandbox::SandboxContext context;
+  context.origin = toStdString(env, origin);
+  auto scope = rnsandbox::moduleSharingScope(
+      static_cast<rnsandbox::ModuleSharing>(sharing),
+      context,
+      group ? toStdString(env, group) : "");
+  return env->NewStringUTF(scope.c_str());
+}
+
+JNIEXPORT jobject JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeAcquireSharedModule(
+    JNIEnv* env,
+    jclass,
+    jstring module,
+    jstring scope,
+    jobject candidate) {
+  rnsandbox::SharedModuleRegistry::Factory factory;
+  if (candidate) {
+    factory = [env, candidate]() -> rnsandbox::SharedModuleRegistry::Handle {
+      return {env->NewGlobalRef(candidate), [](void* ref) {
+                getJNIEnv()->DeleteGlobalRef(static_cast<jobject>(ref));
+              }};
+    };
+  }
+  auto instance = rnsandbox::SharedModuleRegistry::getInstance().acquire(
+      toStdString(env, module), toStdString(env, scope), factory);
+  return instance ? env->NewLocalRef(static_cast<jobject>(instance.get()))
+                  : nullptr;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeReleaseSharedModule(
+    JNIEnv* env,
+    jclass,
+    jstring module,
+    jstring scope) {
+  return rnsandbox::SharedModuleRegistry::getInstance().release(
+      toStdString(env, module), toStdString(env, scope));
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeStartRealm(
+    JNIEnv* env,
+    jclass,
+    jlong stateHandle,
+    jstring origin,
+    jstring path,
+    jstring sourceUrl,
+    jobjectArray allowedTurboModules,
+    jobjectArray allowedOrigins,
+    jobjectArray substitutionKeys,
+    jobjectArray substitutionValues,
+    jobjectArray hostConfiguredModules) {
+  std::shared_ptr<SandboxJSIState> state;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gStates.find(stateHandle);
+    if (it == gStates.end())
+      return env->NewStringUTF("Sandbox runtime is gone");
+    state = it->second;
+  }
+
+  rnsandbox::RealmConfig config;
+  config.origin = toStdString(env, origin);
+  config.bundleSource = toStdString(env, sourceUrl);
+  config.allowedTurboModules = toStringSet(env, allowedTurboModules);
+  config.allowedOrigins = toStringSet(env, allowedOrigins);
+  jsize count = env->GetArrayLength(substitutionKeys);
+  for (jsize i = 0; i < count; ++i) {
+    auto jKey =
+        static_cast<jstring>(env->GetObjectArrayElement(substitutionKeys, i));
+    auto jValue = static_cast<jstring>(
+        env->GetObjectArrayElement(substitutionValues, i));
+    config.turboModuleSubstitutions[toStdString(env, jKey)] =
+        toStdString(env, jValue);
+    env->DeleteLocalRef(jKey);
+    env->DeleteLocalRef(jValue);
+  }
+  config.hostConfiguredModules = toStringSet(env, hostConfiguredModules);
+
+  jsi::Runtime* runtime = nullptr;
+  std::shared_ptr<rnsandbox::SandboxRealmSet> realms;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    runtime = state->runtime;
+    if (runtime && !state->realms) {
+      state->realms = std::make_shared<rnsandbox::SandboxRealmSet>(
+          state->registryDelegate);
+      jobject delegateRef = state->delegateRef;
+      state->realms->setErrorHandler(
+          [delegateRef](
+              const std::string& realmOrigin,
+              const std::string& name,
+              const std::string& message,
+              const std::string&) {
+            std::string prefixed = "[" + realmOrigin + "] " + message;
+            emitDelegateError(
+                delegateRef, name.c_str(), prefixed.c_str(), false);
+          });
+    }
+    realms = state->realms;
+  }
+  if (!runtime)
+    return env->NewStringUTF("Sandbox runtime is gone");
+
+  auto realm = realms->add(config);
+  if (!realm) {
+    return env->NewStringUTF("Realm has no origin or a duplicate one");
+  }
+  std::string error;
+  try {
+    rnsandbox::startRealm(
+        *runtime, realm, toStdString(env, path), config.bundleSource);
+  } catch (const jsi::JSError& e) {
+    error = e.getMessage();
+  } catch (const std::exception& e) {
+    error = e.what();
+  }
+  if (!error.empty()) {
+    realms->remove(config.origin);
+    LOGE(
+        "Realm %s failed to start: %s", config.origin.c_str(), error.c_str());
+    return env->NewStringUTF(error.c_str());
+  }
+  return nullptr;
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeClearRealms(
+    JNIEnv*,
+    jclass,
+    jlong stateHandle) {
+  std::shared_ptr<SandboxJSIState> state;
+  {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gStates.find(stateHandle);
+    if (it == gStates.end())
+      return;
+    state = it->second;
+  }
+  std::shared_ptr<rnsandbox::SandboxRealmSet> realms;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    realms = std::move(state->realms);
+  }
+}
+
+// Key-value store handles are owned by SandboxKeyValueStore, which
+// serializes calls and closes each handle once. A handle is a heap-allocated
+// reference to the store shared by every handle on the same directory.
+
+static rnsandbox::SandboxKVStore* kvStore(jlong storeHandle) {
+  return reinterpret_cast<std::shared_ptr<rnsandbox::SandboxKVStore>*>(
+             storeHandle)
+      ->get();
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeOpenKVStore(
+    JNIEnv* env,
+    jclass,
+    jstring directory) {
+  std::string error;
+  auto store = rnsandbox::SandboxKVStore::openShared(
+      toStdString(env, directory), {}, &error);
+  if (!store) {
+    env->ThrowNew(env->FindClass("java/io/IOException"), error.c_str());
+    return 0;
+  }
+  return reinterpret_cast<jlong>(
+      new std::shared_ptr<rnsandbox::SandboxKVStore>(std::move(store)));
+}
+
+JNIEXPORT void JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeCloseKVStore(
+    JNIEnv*,
+    jclass,
+    jlong storeHandle) {
+  delete reinterpret_cast<std::shared_ptr<rnsandbox::SandboxKVStore>*>(
+      storeHandle);
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeKVStoreGet(
+    JNIEnv* env,
+    jclass,
+    jlong storeHandle,
+    jobjectArray keys) {
+  auto* store = kvStore(storeHandle);
+  jsize count = env->GetArrayLength(keys);
+  jobjectArray values =
+      env->NewObjectArray(count, env->FindClass("java/lang/String"), nullptr);
+  for (jsize i = 0; i < count; ++i) {
+    auto jKey = static_cast<jstring>(env->GetObjectArrayElement(keys, i));
+    std::string key = toStdString(env, jKey);
+    env->DeleteLocalRef(jKey);
+    std::string error;
+    auto value = store->get(key, &error);
+    if (!value) {
+      if (!error.empty()) {
+        LOGE("Cannot read value of %s: %s", key.c_str(), error.c_str());
+      }
+      continue;
+    }
+    jstring jValue = env->NewStringUTF(value->c_str());
+    env->SetObjectArrayElement(values, i, jValue);
+    env->DeleteLocalRef(jValue);
+  }
+  return values;
+}
+
+static rnsandbox::KVBatch toKVBatch(
+    JNIEnv* env,
+    jobjectArray keys,
+    jobjectArray values) {
+  rnsandbox::KVBatch batch;
+  jsize count = env->GetArrayLength(keys);
+  for (jsize i = 0; i < count; ++i) {
+    auto jKey = static_cast<jstring>(env->GetObjectArrayElement(keys, i));
+    auto jValue = static_cast<jstring>(env->GetObjectArrayElement(values, i));
+    if (jValue) {
+      batch.put(toStdString(env, jKey), toStdString(env, jValue));
+    } else {
+      batch.remove(toStdString(env, jKey));
+    }
+    env->DeleteLocalRef(jKey);
+    env->DeleteLocalRef(jValue);
+  }
+  return batch;
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeKVStoreWrite(
+    JNIEnv* env,
+    jclass,
+    jlong storeHandle,
+    jobjectArray keys,
+    jobjectArray values) {
+  std::string error;
+  if (kvStore(storeHandle)->write(toKVBatch(env, keys, values), &error)) {
+    return nullptr;
+  }
+  return env->NewStringUTF(error.c_str());
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeKVStoreWriteGroup(
+    JNIEnv* env,
+    jclass,
+    jlong storeHandle,
+    jobjectArray keys,
+    jobjectArray values) {
+  jsize count = env->GetArrayLength(keys);
+  std::vector<rnsandbox::KVBatch> batches;
+  batches.reserve(count);
+  for (jsize i = 0; i < count; ++i) {
+    auto jKeys = static_cast<jobjectArray>(env->GetObjectArrayElement(keys, i));
+    auto jValues =
+        static_cast<jobjectArray>(env->GetObjectArrayElement(values, i));
+    batches.push_back(toKVBatch(env, jKeys, jValues));
+    env->DeleteLocalRef(jKeys);
+    env->DeleteLocalRef(jValues);
+  }
+
+  std::vector<std::string> errors;
+  kvStore(storeHandle)->writeGroup(batches, errors);
+  jobjectArray result =
+      env->NewObjectArray(count, env->FindClass("java/lang/String"), nullptr);
+  for (jsize i = 0; i < count; ++i) {
+    if (errors[i].empty())
+      continue;
+    jstring jError = env->NewStringUTF(errors[i].c_str());
+    env->SetObjectArrayElement(result, i, jError);
+    env->DeleteLocalRef(jError);
+  }
+  return result;
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeKVStoreKeys(
+    JNIEnv* env,
+    jclass,
+    jlong storeHandle) {
+  auto keys = kvStore(storeHandle)->keys();
+  jobjectArray result = env->NewObjectArray(
+      static_cast<jsize>(keys.size()),
+      env->FindClass("java/lang/String"),
+      nullptr);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    jstring jKey = env->NewStringUTF(keys[i].c_str());
+    env->SetObjectArrayElement(result, static_cast<jsize>(i), jKey);
+    env->DeleteLocalRef(jKey);
+  }
+  return result;
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_callstack_rnsandbox_SandboxJSIInstaller_nativeKVStoreClear(
+    JNIEnv* env,
+    jclass,
+    jlong storeHandle) {
+  std::string error;
+  if (kvStore(storeHandle)->clear(&error)) {
+    return nullptr;
+  }
+  return env->NewStringUTF(error.c_str());
+}
+
 } // extern "C"
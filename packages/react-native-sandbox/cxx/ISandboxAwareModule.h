@@ -2,10 +2,27 @@
 
 #ifdef __cplusplus
 
+#include <cstdint>
 #include <string>
 
 namespace rnsandbox {
 
+/**
+ * How many sandboxes share one instance of a substituted module. Declared by
+ * the module; the platforms mirror these values in the same order.
+ */
+enum class ModuleSharing : uint8_t {
+  // An instance per sandbox, configured with its origin. The default.
+  PerSandbox,
+  // One instance per origin, e.g. for storage scoped by origin.
+  PerOrigin,
+  // One instance per group the module names for an origin.
+  PerGroup,
+  // One instance for the process. The module must not keep per-sandbox
+  // state, and reads the calling sandbox from SandboxContextScope.
+  PerProcess,
+};
+
 /**
  * Context information provided to sandbox-aware TurboModules.
  * Contains the sandbox identity and module mapping details needed
@@ -21,6 +38,10 @@ struct SandboxContext {
   /** The actual module name that was resolved via substitution (e.g.
    * "SandboxedAsyncStorage") */
   std::string resolvedModuleName;
+
+  /** Key of the sandboxes sharing the module's state under its declared
+   * ModuleSharing, e.g. "origin:<origin>"; empty if it is not shared */
+  std::string sharingScope;
 };
 
 /**
@@ -57,6 +78,22 @@ class ISandboxAwareModule {
    * info
    */
   virtual void configureSandbox(const SandboxContext& context) = 0;
+
+  /**
+   * How the module's state may be shared between sandboxes. A C++
+   * TurboModule is bound to its runtime's JS invoker, so each sandbox still
+   * gets an instance; it shares its backend instead, e.g. a database handle,
+   * by acquiring it from SharedModuleRegistry under context.sharingScope in
+   * configureSandbox() and releasing it when destroyed.
+   */
+  virtual ModuleSharing moduleSharing() const {
+    return ModuleSharing::PerSandbox;
+  }
+
+  /** The group for ModuleSharing::PerGroup; empty shares per origin. */
+  virtual std::string sharingGroup(const std::string& /*origin*/) const {
+    return "";
+  }
 };
 
 } // namespace rnsandbox
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <functional>
 #include <set>
 #include <string>
+#include "MessagePriority.h"
+
+namespace facebook::jsi {
+class Runtime;
+} // namespace facebook::jsi
 
 namespace rnsandbox {
 
@@ -21,18 +27,23 @@ class ISandboxDelegate {
   /**
    * Posts a message to the JavaScript runtime.
    * @param message JSON-serialized message string
+   * @param priority Lane of the sandbox's inbound queue to deliver through
    */
-  virtual void postMessage(const std::string& message) = 0;
+  virtual void postMessage(
+      const std::string& message,
+      MessagePriority priority) = 0;
 
   /**
    * Routes a message to a specific sandbox delegate.
    * @param message The message to route
    * @param targetId The ID of the target sandbox
+   * @param priority Lane of the target's inbound queue to deliver through
    * @return true if the message was successfully routed, false otherwise
    */
   virtual bool routeMessage(
       const std::string& message,
-      const std::string& targetId) = 0;
+      const std::string& targetId,
+      MessagePriority priority) = 0;
 
   /**
    * Sets the origin identifier for this sandbox.
@@ -53,6 +64,16 @@ class ISandboxDelegate {
    * @param modules Set of allowed TurboModule names
    */
   virtual void setAllowedTurboModules(const std::set<std::string>& modules) = 0;
+
+  /**
+   * Schedules work on the JavaScript thread of this sandbox.
+   * Used by native features (e.g. message ports) that deliver data into the
+   * runtime outside of the regular postMessage path.
+   * @param work Callback invoked on the JS thread with the sandbox runtime
+   * @return true if the work was scheduled, false if no runtime is available
+   */
+  virtual bool scheduleOnJSThread(
+      std::function<void(facebook::jsi::Runtime&)> work) = 0;
 };
 
 } // namespace rnsandbox
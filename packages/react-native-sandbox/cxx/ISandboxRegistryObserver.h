@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+namespace rnsandbox {
+
+/**
+ * Receives SandboxRegistry membership changes, for native features that keep
+ * per-origin state (pending RPC calls, presence) and must react when a
+ * sandbox comes or goes.
+ *
+ * Callbacks run on the thread that changed the registry, after the registry
+ * lock has been released, so they may call back into SandboxRegistry.
+ */
+class ISandboxRegistryObserver {
+ public:
+  virtual ~ISandboxRegistryObserver() = default;
+
+  /**
+   * Called when the first delegate for an origin is registered.
+   * @param origin The origin that became available
+   */
+  virtual void onSandboxRegistered(const std::string& origin) = 0;
+
+  /**
+   * Called when the last delegate for an origin is unregistered.
+   * @param origin The origin that is no longer available
+   */
+  virtual void onSandboxUnregistered(const std::string& origin) = 0;
+};
+
+} // namespace rnsandbox
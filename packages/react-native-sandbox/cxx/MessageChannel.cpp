@@ -0,0 +1,277 @@
+#include "MessageChannel.h"
+#include <algorithm>
+#include <atomic>
+#include "SandboxRegistry.h"
+#include "SpscRingBuffer.h"
+
+namespace rnsandbox {
+
+class MessageChannel {
+ public:
+  struct Endpoint {
+    Endpoint(std::string endpointOrigin, size_t capacity)
+        : origin(std::move(endpointOrigin)), inbox(capacity) {}
+
+    std::string origin;
+    SpscRingBuffer<std::string> inbox;
+    std::atomic<bool> wakeupPending{false};
+    bool attached = false; // guarded by MessageChannelRegistry::mutex_
+    MessagePort::Callback onReadable; // guarded by callbackMutex
+    MessagePort::Callback onClose; // guarded by callbackMutex
+  };
+
+  MessageChannel(
+      MessageChannelRegistry::ChannelKey key,
+      const std::string& first,
+      const std::string& second,
+      size_t capacity)
+      : key(std::move(key)),
+        endpoints{Endpoint(first, capacity), Endpoint(second, capacity)} {}
+
+  void notifyReadable(size_t side) {
+    Endpoint& endpoint = endpoints[side];
+    if (endpoint.wakeupPending.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+    MessagePort::Callback callback;
+    {
+      std::lock_guard<std::mutex> lock(callbackMutex);
+      callback = endpoint.onReadable;
+    }
+    if (callback) {
+      callback();
+    }
+  }
+
+  void close() {
+    if (closed.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+    MessageChannelRegistry::getInstance().remove(key, this);
+
+    MessagePort::Callback callbacks[2];
+    {
+      std::lock_guard<std::mutex> lock(callbackMutex);
+      callbacks[0] = std::move(endpoints[0].onClose);
+      callbacks[1] = std::move(endpoints[1].onClose);
+    }
+    for (auto& callback : callbacks) {
+      if (callback) {
+        callback();
+      }
+    }
+  }
+
+  const MessageChannelRegistry::ChannelKey key;
+  Endpoint endpoints[2];
+  std::atomic<bool> closed{false};
+  std::mutex callbackMutex;
+};
+
+MessagePort::MessagePort(std::shared_ptr<MessageChannel> channel, size_t side)
+    : channel_(std::move(channel)), side_(side) {}
+
+MessagePort::~MessagePort() {
+  close();
+}
+
+const std::string& MessagePort::origin() const {
+  return channel_->endpoints[side_].origin;
+}
+
+const std::string& MessagePort::targetOrigin() const {
+  return channel_->endpoints[1 - side_].origin;
+}
+
+bool MessagePort::postMessage(std::string message) {
+  if (channel_->closed.load(std::memory_order_acquire)) {
+    return false;
+  }
+  const size_t peer = 1 - side_;
+  if (!channel_->endpoints[peer].inbox.tryPush(std::move(message))) {
+    return false;
+  }
+  channel_->notifyReadable(peer);
+  return true;
+}
+
+size_t MessagePort::drain(
+    const std::function<void(std::string&&)>& handler,
+    size_t maxMessages) {
+  auto& endpoint = channel_->endpoints[side_];
+  // Re-arm before popping so a push racing with the drain schedules another
+  // wakeup instead of being missed.
+  endpoint.wakeupPending.store(false, std::memory_order_release);
+
+  size_t delivered = 0;
+  std::string message;
+  while (delivered < maxMessages && endpoint.inbox.tryPop(message)) {
+    ++delivered;
+    handler(std::move(message));
+  }
+  return delivered;
+}
+
+size_t MessagePort::pendingCount() const {
+  return channel_->endpoints[side_].inbox.sizeApprox();
+}
+
+void MessagePort::setOnReadable(Callback callback) {
+  std::lock_guard<std::mutex> lock(channel_->callbackMutex);
+  channel_->endpoints[side_].onReadable = std::move(callback);
+}
+
+void MessagePort::setOnClose(Callback callback) {
+  std::lock_guard<std::mutex> lock(channel_->callbackMutex);
+  channel_->endpoints[side_].onClose = std::move(callback);
+}
+
+void MessagePort::close() {
+  channel_->close();
+}
+
+bool MessagePort::isClosed() const {
+  return channel_->closed.load(std::memory_order_acquire);
+}
+
+void MessagePortSet::add(const std::shared_ptr<MessagePort>& port) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Drop ports that are gone so a long-lived runtime does not accumulate them
+  ports_.erase(
+      std::remove_if(
+          ports_.begin(),
+          ports_.end(),
+          [](const std::weak_ptr<MessagePort>& weak) {
+            auto port = weak.lock();
+            return !port || port->isClosed();
+          }),
+      ports_.end());
+  ports_.push_back(port);
+}
+
+void MessagePortSet::closeAll() {
+  std::vector<std::weak_ptr<MessagePort>> ports;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ports.swap(ports_);
+  }
+  // Closing runs the ports' close callbacks, which must not find mutex_ held
+  for (auto& weak : ports) {
+    if (auto port = weak.lock()) {
+      port->close();
+    }
+  }
+}
+
+MessageChannelRegistry& MessageChannelRegistry::getInstance() {
+  static MessageChannelRegistry instance;
+  return instance;
+}
+
+MessageChannelRegistry::ChannelKey MessageChannelRegistry::makeKey(
+    const std::string& a,
+    const std::string& b) {
+  return a < b ? ChannelKey(a, b) : ChannelKey(b, a);
+}
+
+MessageChannelStatus MessageChannelRegistry::open(
+    const std::string& origin,
+    const std::string& targetOrigin,
+    std::shared_ptr<MessagePort>& port,
+    size_t capacity) {
+  if (origin.empty() || targetOrigin.empty()) {
+    return MessageChannelStatus::InvalidOrigin;
+  }
+  if (origin == targetOrigin) {
+    return MessageChannelStatus::SelfTarget;
+  }
+  if (!SandboxRegistry::getInstance().isPermittedFrom(origin, targetOrigin)) {
+    return MessageChannelStatus::AccessDenied;
+  }
+
+  ChannelKey key = makeKey(origin, targetOrigin);
+  std::shared_ptr<MessagePort> newPort;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::shared_ptr<MessageChannel> channel;
+    auto it = channels_.find(key);
+    if (it != channels_.end()) {
+      channel = it->second.lock();
+    }
+    if (!channel || channel->closed.load(std::memory_order_acquire)) {
+      channel = std::make_shared<MessageChannel>(
+          key, origin, targetOrigin, capacity);
+      channels_[key] = channel;
+    }
+
+    size_t side = channel->endpoints[0].origin == origin ? 0 : 1;
+    if (channel->endpoints[side].attached) {
+      return MessageChannelStatus::AlreadyOpen;
+    }
+    channel->endpoints[side].attached = true;
+    newPort = std::make_shared<MessagePort>(channel, side);
+  }
+  // Assign outside the lock: releasing a previously held port closes its
+  // channel, which calls back into remove().
+  port = std::move(newPort);
+  return MessageChannelStatus::Opened;
+}
+
+void MessageChannelRegistry::closeAll(const std::string& origin) {
+  std::vector<std::shared_ptr<MessageChannel>> toClose;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : channels_) {
+      if (entry.first.first != origin && entry.first.second != origin) {
+        continue;
+      }
+      if (auto channel = entry.second.lock()) {
+        toClose.push_back(std::move(channel));
+      }
+    }
+  }
+  // close() re-enters remove(), so it must run without holding mutex_
+  for (auto& channel : toClose) {
+    channel->close();
+  }
+}
+
+size_t MessageChannelRegistry::channelCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return channels_.size();
+}
+
+void MessageChannelRegistry::remove(
+    const ChannelKey& key,
+    const MessageChannel* channel) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = channels_.find(key);
+  if (it == channels_.end()) {
+    return;
+  }
+  // A newer channel may already occupy the key; only drop our own entry.
+  auto current = it->second.lock();
+  if (!current || current.get() == channel) {
+    channels_.erase(it);
+  }
+}
+
+void MessageChannelRegistry::reset() {
+  std::vector<std::shared_ptr<MessageChannel>> toClose;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : channels_) {
+      if (auto channel = entry.second.lock()) {
+        toClose.push_back(std::move(channel));
+      }
+    }
+  }
+  for (auto& channel : toClose) {
+    channel->close();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  channels_.clear();
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rnsandbox {
+
+class MessageChannel;
+
+enum class MessageChannelStatus {
+  Opened,
+  InvalidOrigin,
+  SelfTarget,
+  AccessDenied,
+  AlreadyOpen,
+};
+
+/**
+ * One end of a dedicated channel between two sandbox origins.
+ *
+ * Messages posted on a port are pushed into the peer's lock-free SPSC ring
+ * buffer; no registry lookup or ACL check happens per message. The owning
+ * sandbox's JS thread is the single producer of its outbound ring and the
+ * single consumer of its inbound ring.
+ *
+ * Destroying a port closes the whole channel.
+ */
+class MessagePort {
+ public:
+  using Callback = std::function<void()>;
+
+  MessagePort(std::shared_ptr<MessageChannel> channel, size_t side);
+  ~MessagePort();
+
+  MessagePort(const MessagePort&) = delete;
+  MessagePort& operator=(const MessagePort&) = delete;
+
+  const std::string& origin() const;
+  const std::string& targetOrigin() const;
+
+  /**
+   * Enqueues a message for the peer port.
+   * @return false if the channel is closed or the peer's buffer is full
+   */
+  bool postMessage(std::string message);
+
+  /**
+   * Pops queued inbound messages and passes each to the handler.
+   * Must be called from the consumer thread only.
+   * @return Number of delivered messages
+   */
+  size_t drain(
+      const std::function<void(std::string&&)>& handler,
+      size_t maxMessages = static_cast<size_t>(-1));
+
+  /** Approximate number of inbound messages waiting to be drained. */
+  size_t pendingCount() const;
+
+  /**
+   * Called when the inbound buffer goes from drained to non-empty. Further
+   * messages do not re-trigger it until drain() runs again, so one wakeup
+   * covers a whole burst.
+   */
+  void setOnReadable(Callback callback);
+
+  /** Called once when either side closes the channel. */
+  void setOnClose(Callback callback);
+
+  void close();
+  bool isClosed() const;
+
+ private:
+  std::shared_ptr<MessageChannel> channel_;
+  size_t side_;
+};
+
+/**
+ * The ports one sandbox runtime opened. Closing the set when that runtime
+ * goes away leaves the ports of other runtimes of the same origin open,
+ * which MessageChannelRegistry::closeAll would not.
+ */
+class MessagePortSet {
+ public:
+  void add(const std::shared_ptr<MessagePort>& port);
+
+  /** Closes every port still open; ports added afterwards are tracked anew. */
+  void closeAll();
+
+ private:
+  std::vector<std::weak_ptr<MessagePort>> ports_;
+  std::mutex mutex_;
+};
+
+/**
+ * Process-wide table of open channels, keyed by the unordered origin pair.
+ *
+ * The first origin to open a channel creates it; the peer origin joins the
+ * same channel by opening it from its side. Messages posted before the peer
+ * joins stay buffered. Access is checked against SandboxRegistry only here,
+ * at port creation.
+ */
+class MessageChannelRegistry {
+ public:
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  static MessageChannelRegistry& getInstance();
+
+  MessageChannelStatus open(
+      const std::string& origin,
+      const std::string& targetOrigin,
+      std::shared_ptr<MessagePort>& port,
+      size_t capacity = kDefaultCapacity);
+
+  /** Closes every channel that has the given origin on either side. */
+  void closeAll(const std::string& origin);
+
+  size_t channelCount() const;
+
+  void reset();
+
+ private:
+  friend class MessageChannel;
+
+  using ChannelKey = std::pair<std::string, std::string>;
+
+  MessageChannelRegistry() = default;
+  MessageChannelRegistry(const MessageChannelRegistry&) = delete;
+  MessageChannelRegistry& operator=(const MessageChannelRegistry&) = delete;
+
+  static ChannelKey makeKey(const std::string& a, const std::string& b);
+
+  void remove(const ChannelKey& key, const MessageChannel* channel);
+
+  std::map<ChannelKey, std::weak_ptr<MessageChannel>> channels_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
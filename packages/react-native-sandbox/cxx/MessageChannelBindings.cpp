@@ -0,0 +1,269 @@
+#include "MessageChannelBindings.h"
+#include "MessageChannel.h"
+#include "SandboxJSIUtils.h"
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+// Per-port state touched only on the owning sandbox's JS thread. Scheduled
+// delivery tasks hold it weakly, so they become no-ops once the port object
+// has been collected.
+struct PortJSState {
+  std::shared_ptr<MessagePort> port;
+  std::shared_ptr<jsi::Function> onMessage;
+  std::shared_ptr<jsi::Function> onClose;
+  bool closeDelivered = false;
+};
+
+void deliverPending(
+    jsi::Runtime& rt,
+    const std::shared_ptr<PortJSState>& state) {
+  if (auto onMessage = state->onMessage) {
+    state->port->drain([&](std::string&& message) {
+      try {
+        onMessage->call(rt, parseJSON(rt, message));
+      } catch (const jsi::JSError& e) {
+        reportJSError(rt, e);
+      }
+    });
+  }
+
+  if (!state->port->isClosed() || state->closeDelivered) {
+    return;
+  }
+  state->closeDelivered = true;
+  state->onMessage.reset();
+  if (auto onClose = std::move(state->onClose)) {
+    try {
+      onClose->call(rt);
+    } catch (const jsi::JSError& e) {
+      reportJSError(rt, e);
+    }
+  }
+}
+
+std::string statusMessage(
+    MessageChannelStatus status,
+    const std::string& origin,
+    const std::string& targetOrigin) {
+  switch (status) {
+    case MessageChannelStatus::InvalidOrigin:
+      return "openMessagePort: both the sandbox origin and targetOrigin "
+             "must be non-empty";
+    case MessageChannelStatus::SelfTarget:
+      return "Cannot open a message port to self (sandbox '" + origin + "')";
+    case MessageChannelStatus::AccessDenied:
+      return "Access denied: Sandbox '" + origin +
+          "' is not permitted to send messages to '" + targetOrigin + "'";
+    case MessageChannelStatus::AlreadyOpen:
+      return "A message port from '" + origin + "' to '" + targetOrigin +
+          "' is already open";
+    case MessageChannelStatus::Opened:
+      break;
+  }
+  return "";
+}
+
+class MessagePortHostObject : public jsi::HostObject {
+ public:
+  explicit MessagePortHostObject(std::shared_ptr<PortJSState> state)
+      : state_(std::move(state)) {}
+
+  ~MessagePortHostObject() override {
+    state_->port->close();
+  }
+
+  jsi::Value get(jsi::Runtime& rt, const jsi::PropNameID& propName) override {
+    std::string name = propName.utf8(rt);
+
+    if (name == "origin") {
+      return jsi::String::createFromUtf8(rt, state_->port->origin());
+    }
+    if (name == "targetOrigin") {
+      return jsi::String::createFromUtf8(rt, state_->port->targetOrigin());
+    }
+    if (name == "closed") {
+      return jsi::Value(state_->port->isClosed());
+    }
+    if (name == "postMessage") {
+      return createPostMessage(rt);
+    }
+    if (name == "setOnMessage") {
+      return createSetOnMessage(rt);
+    }
+    if (name == "setOnClose") {
+      return createSetOnClose(rt);
+    }
+    if (name == "close") {
+      return createClose(rt);
+    }
+    return jsi::Value::undefined();
+  }
+
+  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime& rt) override {
+    std::vector<jsi::PropNameID> names;
+    for (const char* name :
+         {"origin",
+          "targetOrigin",
+          "closed",
+          "postMessage",
+          "setOnMessage",
+          "setOnClose",
+          "close"}) {
+      names.push_back(jsi::PropNameID::forAscii(rt, name));
+    }
+    return names;
+  }
+
+ private:
+  jsi::Value createPostMessage(jsi::Runtime& rt) {
+    return jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "postMessage"),
+        1,
+        [state = state_](
+            jsi::Runtime& rt,
+            const jsi::Value&,
+            const jsi::Value* args,
+            size_t count) -> jsi::Value {
+          if (count != 1) {
+            throw jsi::JSError(
+                rt, "postMessage: expected exactly one argument");
+          }
+          // false signals a closed port or a full peer buffer (back-pressure)
+          return jsi::Value(
+              state->port->postMessage(stringifyJSON(rt, args[0])));
+        });
+  }
+
+  jsi::Value createSetOnMessage(jsi::Runtime& rt) {
+    return jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "setOnMessage"),
+        1,
+        [state = state_](
+            jsi::Runtime& rt,
+            const jsi::Value&,
+            const jsi::Value* args,
+            size_t count) -> jsi::Value {
+          if (count != 1 || !args[0].isObject() ||
+              !args[0].asObject(rt).isFunction(rt)) {
+            throw jsi::JSError(rt, "setOnMessage: argument must be a function");
+          }
+          state->onMessage = std::make_shared<jsi::Function>(
+              args[0].asObject(rt).asFunction(rt));
+          // Flush anything the peer sent before a handler existed
+          deliverPending(rt, state);
+          return jsi::Value::undefined();
+        });
+  }
+
+  jsi::Value createSetOnClose(jsi::Runtime& rt) {
+    return jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "setOnClose"),
+        1,
+        [state = state_](
+            jsi::Runtime& rt,
+            const jsi::Value&,
+            const jsi::Value* args,
+            size_t count) -> jsi::Value {
+          if (count != 1 || !args[0].isObject() ||
+              !args[0].asObject(rt).isFunction(rt)) {
+            throw jsi::JSError(rt, "setOnClose: argument must be a function");
+          }
+          state->onClose = std::make_shared<jsi::Function>(
+              args[0].asObject(rt).asFunction(rt));
+          if (state->port->isClosed()) {
+            deliverPending(rt, state);
+          }
+          return jsi::Value::undefined();
+        });
+  }
+
+  jsi::Value createClose(jsi::Runtime& rt) {
+    return jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "close"),
+        0,
+        [state = state_](
+            jsi::Runtime&, const jsi::Value&, const jsi::Value*, size_t)
+            -> jsi::Value {
+          state->port->close();
+          return jsi::Value::undefined();
+        });
+  }
+
+  std::shared_ptr<PortJSState> state_;
+};
+
+} // namespace
+
+void installMessageChannelBindings(
+    jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    std::shared_ptr<MessagePortSet> ports) {
+  auto openMessagePort = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "openMessagePort"),
+      2,
+      [origin, delegate, ports](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count < 1 || !args[0].isString()) {
+          throw jsi::JSError(
+              rt,
+              "openMessagePort(targetOrigin, options?): targetOrigin must be "
+              "a string");
+        }
+        std::string targetOrigin = args[0].getString(rt).utf8(rt);
+
+        size_t capacity = MessageChannelRegistry::kDefaultCapacity;
+        if (count > 1 && args[1].isObject()) {
+          jsi::Value capacityVal =
+              args[1].asObject(rt).getProperty(rt, "capacity");
+          if (capacityVal.isNumber() && capacityVal.getNumber() >= 1) {
+            capacity = static_cast<size_t>(capacityVal.getNumber());
+          }
+        }
+
+        std::shared_ptr<MessagePort> port;
+        auto status = MessageChannelRegistry::getInstance().open(
+            origin, targetOrigin, port, capacity);
+        if (status != MessageChannelStatus::Opened) {
+          throw jsi::JSError(rt, statusMessage(status, origin, targetOrigin));
+        }
+        ports->add(port);
+
+        auto state = std::make_shared<PortJSState>();
+        state->port = port;
+
+        std::weak_ptr<PortJSState> weakState = state;
+        auto scheduleDelivery = [delegate, weakState]() {
+          auto strongDelegate = delegate.lock();
+          if (!strongDelegate) {
+            return;
+          }
+          strongDelegate->scheduleOnJSThread([weakState](jsi::Runtime& rt) {
+            if (auto state = weakState.lock()) {
+              deliverPending(rt, state);
+            }
+          });
+        };
+        port->setOnReadable(scheduleDelivery);
+        port->setOnClose(scheduleDelivery);
+
+        return jsi::Object::createFromHostObject(
+            rt, std::make_shared<MessagePortHostObject>(std::move(state)));
+      });
+
+  defineSandboxGlobal(runtime, "openMessagePort", std::move(openMessagePort));
+}
+
+} // namespace rnsandbox
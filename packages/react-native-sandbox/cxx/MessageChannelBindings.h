@@ -0,0 +1,30 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include <string>
+#include "ISandboxDelegate.h"
+#include "MessageChannel.h"
+
+namespace rnsandbox {
+
+/**
+ * Installs `openMessagePort(targetOrigin, options?)` into a sandbox runtime.
+ *
+ * The returned port object exposes postMessage(message), setOnMessage(fn),
+ * setOnClose(fn), close() and the origin/targetOrigin/closed properties.
+ * Inbound messages are delivered on the sandbox JS thread via
+ * ISandboxDelegate::scheduleOnJSThread, one scheduled task per burst.
+ *
+ * @param runtime The sandbox runtime, on its JS thread
+ * @param origin Origin of the sandbox owning the runtime
+ * @param delegate Registry delegate used to schedule inbound delivery
+ * @param ports Tracks the opened ports, for closing them with the runtime
+ */
+void installMessageChannelBindings(
+    facebook::jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    std::shared_ptr<MessagePortSet> ports);
+
+} // namespace rnsandbox
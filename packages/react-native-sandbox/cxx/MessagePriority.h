@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+namespace rnsandbox {
+
+/** Delivery lane of a message in the target sandbox's inbound queue. */
+enum class MessagePriority {
+  // User-interaction traffic, serviced ahead of bulk
+  Urgent,
+  // Default lane; plain postMessage calls land here
+  Bulk,
+};
+
+/**
+ * Parses "urgent" / "bulk".
+ * @return false if the name is not a known priority
+ */
+inline bool parseMessagePriority(
+    const std::string& name,
+    MessagePriority& priority) {
+  if (name == "urgent") {
+    priority = MessagePriority::Urgent;
+    return true;
+  }
+  if (name == "bulk") {
+    priority = MessagePriority::Bulk;
+    return true;
+  }
+  return false;
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,119 @@
+#include "OriginMatcher.h"
+#include <cstring>
+#include <map>
+#include <utility>
+
+namespace rnsandbox {
+
+namespace {
+
+struct BuildNode {
+  std::map<char, uint32_t> children;
+  bool exact = false;
+  bool prefix = false;
+};
+
+} // namespace
+
+OriginMatcher::OriginMatcher() : nodes_(1), firstChars_(1, '\0') {}
+
+OriginMatcher::OriginMatcher(const std::set<std::string>& entries)
+    : OriginMatcher() {
+  // Plain character trie first, then compress it into the flat layout
+  std::vector<BuildNode> trie(1);
+  for (const auto& entry : entries) {
+    bool pattern = isPattern(entry);
+    size_t length = pattern ? entry.size() - 1 : entry.size();
+
+    uint32_t node = 0;
+    for (size_t i = 0; i < length; ++i) {
+      auto it = trie[node].children.find(entry[i]);
+      if (it != trie[node].children.end()) {
+        node = it->second;
+        continue;
+      }
+      auto child = static_cast<uint32_t>(trie.size());
+      trie[node].children.emplace(entry[i], child);
+      trie.emplace_back();
+      node = child;
+    }
+    if (pattern) {
+      trie[node].prefix = true;
+    } else {
+      trie[node].exact = true;
+    }
+  }
+
+  // Breadth-first, so the children of every node end up adjacent
+  std::vector<std::pair<uint32_t, uint32_t>> queue{{0, 0}};
+  for (size_t next = 0; next < queue.size(); ++next) {
+    const BuildNode& built = trie[queue[next].first];
+    uint32_t flat = queue[next].second;
+    nodes_[flat].exact = built.exact;
+    nodes_[flat].prefix = built.prefix;
+    if (built.prefix) {
+      continue;
+    }
+    nodes_[flat].firstChild = static_cast<uint32_t>(nodes_.size());
+    nodes_[flat].childCount = static_cast<uint32_t>(built.children.size());
+
+    for (const auto& [c, child] : built.children) {
+      Node node;
+      node.labelOffset = static_cast<uint32_t>(labels_.size());
+      labels_.push_back(c);
+
+      // Fold chains of unflagged single-child nodes into one edge label
+      uint32_t end = child;
+      while (!trie[end].exact && !trie[end].prefix &&
+             trie[end].children.size() == 1) {
+        labels_.push_back(trie[end].children.begin()->first);
+        end = trie[end].children.begin()->second;
+      }
+      node.labelLength =
+          static_cast<uint32_t>(labels_.size()) - node.labelOffset;
+
+      nodes_.push_back(node);
+      firstChars_.push_back(c);
+      queue.emplace_back(end, static_cast<uint32_t>(nodes_.size() - 1));
+    }
+  }
+}
+
+bool OriginMatcher::matches(const std::string& origin) const {
+  const char* remaining = origin.data();
+  size_t remainingLength = origin.size();
+  const Node* node = &nodes_[0];
+
+  while (true) {
+    if (node->prefix) {
+      return true;
+    }
+    if (remainingLength == 0) {
+      return node->exact;
+    }
+
+    const char* siblings = firstChars_.data() + node->firstChild;
+    const void* hit = std::memchr(siblings, *remaining, node->childCount);
+    if (!hit) {
+      return false;
+    }
+    auto index = static_cast<const char*>(hit) - siblings;
+    node = &nodes_[node->firstChild + index];
+
+    if (node->labelLength > remainingLength ||
+        std::memcmp(
+            labels_.data() + node->labelOffset,
+            remaining,
+            node->labelLength) != 0) {
+      return false;
+    }
+    remaining += node->labelLength;
+    remainingLength -= node->labelLength;
+  }
+}
+
+bool OriginMatcher::isPattern(const std::string& entry) {
+  return !entry.empty() && entry.back() == '*';
+}
+
+} // namespace rnsandbox
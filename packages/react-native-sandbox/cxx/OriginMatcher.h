@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace rnsandbox {
+
+/**
+ * Compiled form of an allowedOrigins list.
+ *
+ * Entries are either exact origins or prefix patterns ending in `*`
+ * such as `plugin.*` (or `*` alone for any origin); a `*` anywhere else is
+ * taken literally. All entries are merged at construction into one
+ * path-compressed trie laid out in flat arrays, so matches() costs
+ * O(length of the origin) however long the list is.
+ */
+class OriginMatcher {
+ public:
+  OriginMatcher();
+
+  explicit OriginMatcher(const std::set<std::string>& entries);
+
+  bool matches(const std::string& origin) const;
+
+  /** Whether an allowedOrigins entry is a prefix pattern. */
+  static bool isPattern(const std::string& entry);
+
+ private:
+  struct Node {
+    // Edge label leading to this node, a slice of labels_
+    uint32_t labelOffset = 0;
+    uint32_t labelLength = 0;
+    // Children are stored contiguously in nodes_
+    uint32_t firstChild = 0;
+    uint32_t childCount = 0;
+    // An exact entry ends here
+    bool exact = false;
+    // A pattern ends here; every origin reaching this node matches
+    bool prefix = false;
+  };
+
+  std::vector<Node> nodes_;
+  // First label character of each node, indexed like nodes_, so a child is
+  // found with one memchr over its siblings
+  std::string firstChars_;
+  std::string labels_;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,56 @@
+#include "SandboxBundleEvaluation.h"
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "SandboxBundleFile.h"
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+// Keeps the mapping alive for as long as the runtime runs its bytecode
+class BundleFileBuffer : public jsi::Buffer {
+ public:
+  explicit BundleFileBuffer(std::shared_ptr<const BundleFile> file)
+      : file_(std::move(file)) {}
+
+  size_t size() const override {
+    return file_->size();
+  }
+
+  const uint8_t* data() const override {
+    return file_->data();
+  }
+
+ private:
+  std::shared_ptr<const BundleFile> file_;
+};
+
+} // namespace
+
+void evaluateBundleFile(
+    jsi::Runtime& runtime,
+    const std::string& path,
+    const std::string& sourceURL) {
+  std::string error;
+  auto file = BundleFile::open(path, &error);
+  if (!file) {
+    throw std::runtime_error(error);
+  }
+
+  std::shared_ptr<const jsi::Buffer> buffer;
+  if (file->isHermesBytecode()) {
+    buffer = std::make_shared<BundleFileBuffer>(file);
+  } else {
+    // Null-terminated, as Hermes expects of source text
+    buffer = std::make_shared<jsi::StringBuffer>(std::string(
+        reinterpret_cast<const char*>(file->data()), file->size()));
+  }
+  runtime.evaluateJavaScript(buffer, sourceURL);
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <string>
+
+namespace rnsandbox {
+
+/**
+ * Evaluates the bundle file at path, e.g. a base bundle or a hot-swapped
+ * sandbox bundle. Hermes bytecode runs from a shared read-only mapping of
+ * the file; source text is copied, since it is compiled per runtime anyway.
+ * Call on the runtime's JS thread.
+ *
+ * @throws std::runtime_error if the file cannot be read, jsi::JSError if the
+ * bundle throws
+ */
+void evaluateBundleFile(
+    facebook::jsi::Runtime& runtime,
+    const std::string& path,
+    const std::string& sourceURL);
+
+} // namespace rnsandbox
@@ -0,0 +1,64 @@
+#include "SandboxBundleFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace rnsandbox {
+
+namespace {
+
+// hermes::hbc::MAGIC, stored little-endian at the start of every bytecode file
+constexpr uint8_t kHermesMagic[] = {
+    0xc6, 0x1f, 0xbc, 0x03, 0xc1, 0x03, 0x19, 0x1f};
+
+void setError(std::string* error, const std::string& message) {
+  if (error) {
+    *error = message;
+  }
+}
+
+} // namespace
+
+std::shared_ptr<const BundleFile> BundleFile::open(
+    const std::string& path,
+    std::string* error) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    setError(error, path + ": " + std::strerror(errno));
+    return nullptr;
+  }
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+    setError(error, path + ": empty or unreadable bundle");
+    ::close(fd);
+    return nullptr;
+  }
+
+  auto size = static_cast<size_t>(info.st_size);
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps the file alive on its own
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    setError(error, path + ": " + std::strerror(errno));
+    return nullptr;
+  }
+  return std::shared_ptr<const BundleFile>(
+      new BundleFile(static_cast<const uint8_t*>(data), size));
+}
+
+BundleFile::~BundleFile() {
+  ::munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+bool BundleFile::isHermesBytecode() const {
+  return size_ >= sizeof(kHermesMagic) &&
+      std::memcmp(data_, kHermesMagic, sizeof(kHermesMagic)) == 0;
+}
+
+} // namespace rnsandbox
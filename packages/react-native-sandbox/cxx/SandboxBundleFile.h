@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace rnsandbox {
+
+/**
+ * A bundle file mapped read-only into memory. Every runtime evaluating the
+ * same file shares its pages, which Hermes runs in place for bytecode.
+ */
+class BundleFile {
+ public:
+  /**
+   * Maps the file at path.
+   * @param error Set when nullptr is returned
+   * @return nullptr if the file cannot be read or is empty
+   */
+  static std::shared_ptr<const BundleFile> open(
+      const std::string& path,
+      std::string* error = nullptr);
+
+  ~BundleFile();
+  BundleFile(const BundleFile&) = delete;
+  BundleFile& operator=(const BundleFile&) = delete;
+
+  const uint8_t* data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  /** True if the file starts with the Hermes bytecode magic number. */
+  bool isHermesBytecode() const;
+
+ private:
+  BundleFile(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  const uint8_t* data_;
+  size_t size_;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,312 @@
+#include "SandboxBundlePatch.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace rnsandbox {
+
+namespace {
+
+constexpr size_t kReadChunkSize = 64 * 1024;
+
+uint64_t readUint64(const uint8_t* bytes) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i) {
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+// bsdiff's offtin: magnitude in the low 63 bits, sign in the top one
+int64_t readOffset(const uint8_t* bytes) {
+  uint64_t value = readUint64(bytes);
+  auto magnitude = static_cast<int64_t>(value & ~(uint64_t(1) << 63));
+  return (value >> 63) ? -magnitude : magnitude;
+}
+
+} // namespace
+
+BundlePatcher::BundlePatcher(
+    std::shared_ptr<const BundleFile> base,
+    std::string outputPath)
+    : base_(std::move(base)),
+      outputPath_(std::move(outputPath)),
+      partialPath_(outputPath_ + ".part"),
+      outputBuffer_(kOutputBufferSize) {}
+
+BundlePatcher::~BundlePatcher() {
+  if (output_) {
+    std::fclose(output_);
+  }
+  if (!committed_) {
+    std::remove(partialPath_.c_str());
+  }
+}
+
+bool BundlePatcher::fail(std::string message) {
+  stage_ = Stage::Failed;
+  error_ = std::move(message);
+  if (output_) {
+    std::fclose(output_);
+    output_ = nullptr;
+  }
+  std::remove(partialPath_.c_str());
+  return false;
+}
+
+bool BundlePatcher::write(const uint8_t* data, size_t size) {
+  while (size > 0) {
+    switch (stage_) {
+      case Stage::Failed:
+        return false;
+
+      case Stage::Done:
+        return fail("Trailing data after the patched bundle");
+
+      case Stage::Header:
+      case Stage::RecordHeader: {
+        size_t needed =
+            stage_ == Stage::Header ? kHeaderSize : kRecordHeaderSize;
+        size_t take = std::min(size, needed - pendingSize_);
+        std::memcpy(pending_.data() + pendingSize_, data, take);
+        pendingSize_ += take;
+        data += take;
+        size -= take;
+        if (pendingSize_ < needed) {
+          break;
+        }
+        pendingSize_ = 0;
+        bool parsed =
+            stage_ == Stage::Header ? parseHeader() : parseRecordHeader();
+        if (!parsed) {
+          return false;
+        }
+        break;
+      }
+
+      case Stage::Diff: {
+        size_t take = static_cast<size_t>(
+            std::min<uint64_t>(size, std::min<uint64_t>(diffLeft_, 4096)));
+        uint8_t patched[4096];
+        const uint8_t* baseData = base_->data();
+        auto baseSize = static_cast<int64_t>(base_->size());
+        for (size_t i = 0; i < take; ++i) {
+          int64_t position = baseCursor_ + static_cast<int64_t>(i);
+          // Like bspatch, bytes outside the base count as zero
+          uint8_t baseByte =
+              position >= 0 && position < baseSize ? baseData[position] : 0;
+          patched[i] = static_cast<uint8_t>(baseByte + data[i]);
+        }
+        if (!emit(patched, take)) {
+          return false;
+        }
+        baseCursor_ += static_cast<int64_t>(take);
+        diffLeft_ -= take;
+        data += take;
+        size -= take;
+        if (diffLeft_ == 0) {
+          stage_ = Stage::Extra;
+        }
+        break;
+      }
+
+      case Stage::Extra: {
+        size_t take =
+            static_cast<size_t>(std::min<uint64_t>(size, extraLeft_));
+        if (!emit(data, take)) {
+          return false;
+        }
+        extraLeft_ -= take;
+        data += take;
+        size -= take;
+        break;
+      }
+    }
+
+    // Zero-length blocks end without consuming any input
+    if (stage_ == Stage::Diff && diffLeft_ == 0) {
+      stage_ = Stage::Extra;
+    }
+    if (stage_ == Stage::Extra && extraLeft_ == 0) {
+      baseCursor_ += seek_;
+      stage_ = written_ == outputSize_ ? Stage::Done : Stage::RecordHeader;
+    }
+  }
+  return stage_ != Stage::Failed;
+}
+
+bool BundlePatcher::parseHeader() {
+  if (std::memcmp(pending_.data(), kMagic, 8) != 0) {
+    return fail("Not a bundle patch");
+  }
+  const uint8_t* cursor = pending_.data() + 8;
+  uint64_t baseSize = readUint64(cursor);
+  Sha256::Digest baseHash;
+  std::memcpy(baseHash.data(), cursor + 8, baseHash.size());
+  outputSize_ = readUint64(cursor + 40);
+  std::memcpy(outputHash_.data(), cursor + 48, outputHash_.size());
+
+  if (baseSize != base_->size() ||
+      Sha256::hash(base_->data(), base_->size()) != baseHash) {
+    return fail("Patch was made for a different bundle");
+  }
+  if (outputSize_ == 0) {
+    return fail("Patch produces an empty bundle");
+  }
+  // Keeps twice the cursor limit within int64_t, which bounds every base
+  // position the diff stage computes
+  constexpr auto kMaxCursor =
+      static_cast<uint64_t>(std::numeric_limits<int64_t>::max() / 2);
+  if (outputSize_ > kMaxCursor - baseSize) {
+    return fail("Patch produces an oversized bundle");
+  }
+  cursorLimit_ = static_cast<int64_t>(baseSize + outputSize_);
+
+  output_ = std::fopen(partialPath_.c_str(), "wb");
+  if (!output_) {
+    return fail(partialPath_ + ": " + std::strerror(errno));
+  }
+  stage_ = Stage::RecordHeader;
+  return true;
+}
+
+bool BundlePatcher::parseRecordHeader() {
+  int64_t diffLength = readOffset(pending_.data());
+  int64_t extraLength = readOffset(pending_.data() + 8);
+  seek_ = readOffset(pending_.data() + 16);
+  if (diffLength < 0 || extraLength < 0) {
+    return fail("Corrupt patch record");
+  }
+  uint64_t remaining = outputSize_ - written_;
+  if (static_cast<uint64_t>(diffLength) > remaining ||
+      static_cast<uint64_t>(extraLength) >
+          remaining - static_cast<uint64_t>(diffLength)) {
+    return fail("Patch record runs past the end of the bundle");
+  }
+  // The seek comes from the patch unchecked; an untrusted one must not move
+  // the cursor anywhere its arithmetic could overflow
+  int64_t nextCursor = 0;
+  if (__builtin_add_overflow(baseCursor_, diffLength, &nextCursor) ||
+      __builtin_add_overflow(nextCursor, seek_, &nextCursor) ||
+      nextCursor > cursorLimit_ || nextCursor < -cursorLimit_) {
+    return fail("Patch record seeks out of range");
+  }
+  diffLeft_ = static_cast<uint64_t>(diffLength);
+  extraLeft_ = static_cast<uint64_t>(extraLength);
+  stage_ = Stage::Diff;
+  return true;
+}
+
+bool BundlePatcher::emit(const uint8_t* data, size_t size) {
+  hasher_.update(data, size);
+  written_ += size;
+  while (size > 0) {
+    size_t take = std::min(size, outputBuffer_.size() - outputBuffered_);
+    std::memcpy(outputBuffer_.data() + outputBuffered_, data, take);
+    outputBuffered_ += take;
+    data += take;
+    size -= take;
+    if (outputBuffered_ == outputBuffer_.size() && !flushOutput()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BundlePatcher::flushOutput() {
+  if (outputBuffered_ > 0 &&
+      std::fwrite(outputBuffer_.data(), 1, outputBuffered_, output_) !=
+          outputBuffered_) {
+    return fail(partialPath_ + ": " + std::strerror(errno));
+  }
+  outputBuffered_ = 0;
+  return true;
+}
+
+bool BundlePatcher::commit() {
+  if (stage_ == Stage::Failed) {
+    return false;
+  }
+  if (stage_ != Stage::Done) {
+    return fail("Patch is truncated");
+  }
+  if (!flushOutput()) {
+    return false;
+  }
+  // Durable before the rename makes it visible
+  bool synced = std::fflush(output_) == 0 && ::fsync(::fileno(output_)) == 0;
+  bool closed = std::fclose(output_) == 0;
+  output_ = nullptr;
+  if (!synced || !closed) {
+    return fail(partialPath_ + ": " + std::strerror(errno));
+  }
+  if (hasher_.finish() != outputHash_) {
+    return fail("Patched bundle does not match its checksum");
+  }
+  if (std::rename(partialPath_.c_str(), outputPath_.c_str()) != 0) {
+    return fail(outputPath_ + ": " + std::strerror(errno));
+  }
+  committed_ = true;
+  return true;
+}
+
+bool applyBundlePatch(
+    const std::string& basePath,
+    const std::string& patchPath,
+    const std::string& outputPath,
+    std::string* error) {
+  std::string openError;
+  auto base = BundleFile::open(basePath, &openError);
+  if (!base) {
+    if (error) {
+      *error = openError;
+    }
+    return false;
+  }
+
+  FILE* patch = std::fopen(patchPath.c_str(), "rb");
+  if (!patch) {
+    if (error) {
+      *error = patchPath + ": " + std::strerror(errno);
+    }
+    return false;
+  }
+
+  BundlePatcher patcher(std::move(base), outputPath);
+  std::vector<uint8_t> chunk(kReadChunkSize);
+  bool ok = true;
+  size_t read;
+  while (ok && (read = std::fread(chunk.data(), 1, chunk.size(), patch)) > 0) {
+    ok = patcher.write(chunk.data(), read);
+  }
+  bool readFailed = std::ferror(patch) != 0;
+  std::fclose(patch);
+
+  if (ok && readFailed) {
+    if (error) {
+      *error = patchPath + ": read error";
+    }
+    return false;
+  }
+  ok = ok && patcher.commit();
+  if (!ok && error) {
+    *error = patcher.error();
+  }
+  return ok;
+}
+
+std::string hashBundleFile(const std::string& path) {
+  auto file = BundleFile::open(path);
+  if (!file) {
+    return "";
+  }
+  return Sha256::toHex(Sha256::hash(file->data(), file->size()));
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SandboxBundleFile.h"
+#include "SandboxSha256.h"
+
+namespace rnsandbox {
+
+/**
+ * Applies a bsdiff-style patch to a cached bundle as the patch streams in,
+ * writing the result next to its destination and moving it into place only
+ * once its size and SHA-256 match the patch header. Runtimes that mapped the
+ * previous file keep reading it.
+ *
+ * Unlike BSDIFF40, whose control, diff and extra blocks are separate
+ * bzip2 streams, the blocks are interleaved and uncompressed, so the patch is
+ * consumed front to back in bounded memory. Compress it in transport.
+ *
+ *   "RNSBPAT1"
+ *   base size (uint64 LE), base SHA-256
+ *   output size (uint64 LE), output SHA-256
+ *   until the output is complete, records of
+ *     diff length, extra length, seek (int64, bsdiff sign-magnitude LE)
+ *     diff bytes, each added to the base byte at the base cursor
+ *     extra bytes, copied as is
+ *   after which the base cursor moves by diff length + seek
+ *
+ * A record that would move the cursor further than base size + output size
+ * from zero is rejected as soon as its header arrives.
+ *
+ * Not thread-safe; meant for one background thread.
+ */
+class BundlePatcher {
+ public:
+  static constexpr char kMagic[] = "RNSBPAT1";
+  static constexpr size_t kHeaderSize = 8 + 2 * (8 + 32);
+  static constexpr size_t kRecordHeaderSize = 3 * 8;
+  static constexpr size_t kOutputBufferSize = 64 * 1024;
+
+  /**
+   * @param base Bundle the patch was made against
+   * @param outputPath Replaced by commit(); may be base's own path
+   */
+  BundlePatcher(std::shared_ptr<const BundleFile> base, std::string outputPath);
+
+  /** Removes the partial output unless commit() succeeded. */
+  ~BundlePatcher();
+
+  BundlePatcher(const BundlePatcher&) = delete;
+  BundlePatcher& operator=(const BundlePatcher&) = delete;
+
+  /**
+   * Consumes the next chunk of the patch, of any size.
+   * @return false once the patch is found invalid; see error()
+   */
+  bool write(const uint8_t* data, size_t size);
+
+  /**
+   * Verifies the output and atomically moves it to outputPath.
+   * @return false if the patch was incomplete, invalid or did not verify
+   */
+  bool commit();
+
+  const std::string& error() const {
+    return error_;
+  }
+
+ private:
+  enum class Stage {
+    Header,
+    RecordHeader,
+    Diff,
+    Extra,
+    Done,
+    Failed,
+  };
+
+  bool fail(std::string message);
+  bool parseHeader();
+  bool parseRecordHeader();
+  bool emit(const uint8_t* data, size_t size);
+  bool flushOutput();
+
+  std::shared_ptr<const BundleFile> base_;
+  std::string outputPath_;
+  std::string partialPath_;
+  FILE* output_ = nullptr;
+  Stage stage_ = Stage::Header;
+  bool committed_ = false;
+  std::string error_;
+
+  // Header and record header bytes split across writes
+  std::array<uint8_t, kHeaderSize> pending_;
+  size_t pendingSize_ = 0;
+
+  uint64_t outputSize_ = 0;
+  Sha256::Digest outputHash_;
+  uint64_t written_ = 0;
+  int64_t baseCursor_ = 0;
+  uint64_t diffLeft_ = 0;
+  uint64_t extraLeft_ = 0;
+  int64_t seek_ = 0;
+  // Base size plus output size; the cursor never moves further from zero
+  int64_t cursorLimit_ = 0;
+
+  Sha256 hasher_;
+  std::vector<uint8_t> outputBuffer_;
+  size_t outputBuffered_ = 0;
+};
+
+/**
+ * Streams the patch file at patchPath through a BundlePatcher.
+ * @param error Set when false is returned
+ */
+bool applyBundlePatch(
+    const std::string& basePath,
+    const std::string& patchPath,
+    const std::string& outputPath,
+    std::string* error = nullptr);
+
+/** Hex SHA-256 of a bundle file, empty if it cannot be read. */
+std::string hashBundleFile(const std::string& path);
+
+} // namespace rnsandbox
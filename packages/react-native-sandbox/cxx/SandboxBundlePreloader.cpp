@@ -0,0 +1,158 @@
+#include "SandboxBundlePreloader.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <utility>
+
+namespace rnsandbox {
+
+SandboxBundlePreloader& SandboxBundlePreloader::getInstance() {
+  static SandboxBundlePreloader instance;
+  return instance;
+}
+
+SandboxBundlePreloader::~SandboxBundlePreloader() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopWorkers(lock);
+}
+
+void SandboxBundlePreloader::setFetcher(Fetcher fetcher) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  fetcher_ = std::move(fetcher);
+}
+
+void SandboxBundlePreloader::setConcurrency(size_t threads) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  concurrency_ = std::max<size_t>(threads, 1);
+}
+
+size_t SandboxBundlePreloader::preload(
+    const std::vector<std::string>& sources) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t queued = 0;
+  for (const auto& source : sources) {
+    if (source.empty()) {
+      continue;
+    }
+    auto [it, inserted] = entries_.try_emplace(source);
+    Entry& entry = it->second;
+    if (!inserted && (entry.state != State::Done || entry.result.ok())) {
+      ++stats_.deduplicated;
+      continue;
+    }
+    entry.state = State::Queued;
+    entry.result = PreloadResult();
+    queue_.push_back(source);
+    ++queued;
+  }
+
+  // Workers exit when the queue runs dry, so every running one is busy
+  size_t target = std::min(concurrency_, workers_ + queue_.size());
+  for (; workers_ < target; ++workers_) {
+    std::thread([this] { runWorker(); }).detach();
+  }
+  return queued;
+}
+
+void SandboxBundlePreloader::runWorker() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_ && !queue_.empty()) {
+    std::string source = std::move(queue_.front());
+    queue_.pop_front();
+    auto it = entries_.find(source);
+    if (it == entries_.end() || it->second.state != State::Queued) {
+      continue;
+    }
+    it->second.state = State::Loading;
+    Fetcher fetcher = fetcher_;
+    lock.unlock();
+
+    PreloadResult result;
+    if (!fetcher) {
+      result.error = "No bundle fetcher installed";
+    } else {
+      try {
+        result = fetcher(source);
+      } catch (const std::exception& e) {
+        result = PreloadResult();
+        result.error = e.what();
+      }
+      if (!result.ok() && result.error.empty()) {
+        result.error = "Bundle could not be loaded";
+      }
+    }
+
+    lock.lock();
+    ++stats_.fetches;
+    if (!result.ok()) {
+      ++stats_.failures;
+    }
+    // Forgotten by evict() or reset() meanwhile
+    it = entries_.find(source);
+    if (it != entries_.end() && it->second.state == State::Loading) {
+      it->second.state = State::Done;
+      it->second.result = std::move(result);
+    }
+    changed_.notify_all();
+  }
+  --workers_;
+  // Notified under the lock: the destructor may run as soon as it is released
+  changed_.notify_all();
+}
+
+std::optional<PreloadResult> SandboxBundlePreloader::find(
+    const std::string& source) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(source);
+  if (it == entries_.end() || it->second.state != State::Done) {
+    return std::nullopt;
+  }
+  return it->second.result;
+}
+
+std::optional<PreloadResult> SandboxBundlePreloader::wait(
+    const std::string& source,
+    std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait_for(lock, timeout, [&] {
+    auto it = entries_.find(source);
+    return it == entries_.end() || it->second.state == State::Done;
+  });
+  auto it = entries_.find(source);
+  if (it == entries_.end() || it->second.state != State::Done) {
+    return std::nullopt;
+  }
+  return it->second.result;
+}
+
+void SandboxBundlePreloader::evict(const std::string& source) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(source);
+  if (it != entries_.end() && it->second.state == State::Done) {
+    entries_.erase(it);
+  }
+}
+
+PreloaderStats SandboxBundlePreloader::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void SandboxBundlePreloader::reset() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopWorkers(lock);
+  stopping_ = false;
+  entries_.clear();
+  queue_.clear();
+  fetcher_ = nullptr;
+  concurrency_ = kDefaultConcurrency;
+  stats_ = PreloaderStats();
+}
+
+void SandboxBundlePreloader::stopWorkers(std::unique_lock<std::mutex>& lock) {
+  stopping_ = true;
+  changed_.wait(lock, [this] { return workers_ == 0; });
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace rnsandbox {
+
+struct PreloadResult {
+  // Local file holding the verified bundle; empty on failure
+  std::string path;
+  std::string error;
+
+  bool ok() const {
+    return !path.empty();
+  }
+};
+
+struct PreloaderStats {
+  uint64_t fetches = 0;
+  uint64_t failures = 0;
+  // preload() calls for a source that was already loading or loaded
+  uint64_t deduplicated = 0;
+};
+
+/**
+ * Loads sandbox bundles ahead of the views that use them, so a view mounting
+ * later finds its bundle in a local file instead of fetching it itself.
+ *
+ * Sources are fetched by a platform hook on a bounded pool of worker
+ * threads, started on demand and exiting once the queue is empty. A source
+ * that is already queued, loading or loaded is not fetched again; a failed
+ * one is retried by the next preload().
+ *
+ * Thread-safe. The fetcher runs without locks held and must not call back
+ * into the preloader.
+ */
+class SandboxBundlePreloader {
+ public:
+  /** Fetches and verifies one bundle, e.g. downloads it into a cache file. */
+  using Fetcher = std::function<PreloadResult(const std::string& source)>;
+
+  static constexpr size_t kDefaultConcurrency = 4;
+
+  static SandboxBundlePreloader& getInstance();
+
+  ~SandboxBundlePreloader();
+
+  void setFetcher(Fetcher fetcher);
+
+  /** Upper bound of worker threads, at least 1. */
+  void setConcurrency(size_t threads);
+
+  /**
+   * Queues every source that is neither loading nor loaded.
+   * @return How many sources were queued
+   */
+  size_t preload(const std::vector<std::string>& sources);
+
+  /** The result for source, nullopt while it is loading or never was. */
+  std::optional<PreloadResult> find(const std::string& source) const;
+
+  /**
+   * Like find(), but first waits up to timeout for a source that is queued
+   * or loading.
+   */
+  std::optional<PreloadResult> wait(
+      const std::string& source,
+      std::chrono::milliseconds timeout);
+
+  /** Forgets a loaded source, so the next preload() fetches it again. */
+  void evict(const std::string& source);
+
+  PreloaderStats stats() const;
+
+  /** Waits for running fetches, then forgets everything. For tests. */
+  void reset();
+
+ private:
+  enum class State {
+    Queued,
+    Loading,
+    Done,
+  };
+
+  struct Entry {
+    State state = State::Queued;
+    PreloadResult result;
+  };
+
+  SandboxBundlePreloader() = default;
+  SandboxBundlePreloader(const SandboxBundlePreloader&) = delete;
+  SandboxBundlePreloader& operator=(const SandboxBundlePreloader&) = delete;
+
+  void runWorker();
+  void stopWorkers(std::unique_lock<std::mutex>& lock);
+
+  std::map<std::string, Entry> entries_;
+  std::deque<std::string> queue_;
+  Fetcher fetcher_;
+  size_t concurrency_ = kDefaultConcurrency;
+  size_t workers_ = 0;
+  bool stopping_ = false;
+  PreloaderStats stats_;
+
+  // Signalled when an entry finishes or a worker exits
+  std::condition_variable changed_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
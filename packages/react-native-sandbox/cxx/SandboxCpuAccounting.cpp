@@ -0,0 +1,192 @@
+#include "SandboxCpuAccounting.h"
+#include "SandboxJson.h"
+
+#include <time.h>
+
+#include <cstdio>
+
+namespace rnsandbox {
+
+namespace {
+
+thread_local CpuScope* tCurrentScope = nullptr;
+
+uint64_t wallNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t threadCpuNowNs() {
+  timespec ts{};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+      static_cast<uint64_t>(ts.tv_nsec);
+}
+
+const char* jsonKey(CpuCategory category) {
+  switch (category) {
+    case CpuCategory::Delivery:
+      return "delivery";
+    case CpuCategory::Serialization:
+      return "serialization";
+    case CpuCategory::UserCallback:
+      return "userCallback";
+    case CpuCategory::NativeCall:
+      return "nativeCall";
+  }
+  return "";
+}
+
+void appendTime(std::string& out, const char* key, const CpuTime& time) {
+  out += '"';
+  out += key;
+  out += "\":{\"wallUs\":" + std::to_string(time.wallNs / 1000) +
+      ",\"cpuUs\":" + std::to_string(time.cpuNs / 1000) +
+      ",\"count\":" + std::to_string(time.count) + "}";
+}
+
+} // namespace
+
+const char* toString(CpuCategory category) {
+  switch (category) {
+    case CpuCategory::Delivery:
+      return "delivery";
+    case CpuCategory::Serialization:
+      return "serialization";
+    case CpuCategory::UserCallback:
+      return "user callback";
+    case CpuCategory::NativeCall:
+      return "native call";
+  }
+  return "";
+}
+
+CpuTime SandboxCpuUsage::total() const {
+  CpuTime total;
+  for (const auto& time : categories) {
+    total.wallNs += time.wallNs;
+    total.cpuNs += time.cpuNs;
+    total.count += time.count;
+  }
+  return total;
+}
+
+double SandboxCpuUsage::occupancy() const {
+  return elapsedNs == 0 ? 0.0
+                        : static_cast<double>(total().wallNs) / elapsedNs;
+}
+
+CpuAccount::CpuAccount() : created_(std::chrono::steady_clock::now()) {}
+
+void CpuAccount::add(CpuCategory category, uint64_t wallNs, uint64_t cpuNs) {
+  Slot& slot = slots_[static_cast<size_t>(category)];
+  slot.wallNs.fetch_add(wallNs, std::memory_order_relaxed);
+  slot.cpuNs.fetch_add(cpuNs, std::memory_order_relaxed);
+  slot.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+SandboxCpuUsage CpuAccount::usage() const {
+  SandboxCpuUsage usage;
+  for (size_t i = 0; i < kCpuCategoryCount; ++i) {
+    usage.categories[i].wallNs =
+        slots_[i].wallNs.load(std::memory_order_relaxed);
+    usage.categories[i].cpuNs = slots_[i].cpuNs.load(std::memory_order_relaxed);
+    usage.categories[i].count = slots_[i].count.load(std::memory_order_relaxed);
+  }
+  usage.elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - created_)
+                        .count();
+  return usage;
+}
+
+CpuScope::CpuScope(CpuAccount* account, CpuCategory category)
+    : account_(account), category_(category) {
+  if (!account_) {
+    return;
+  }
+  parent_ = tCurrentScope;
+  tCurrentScope = this;
+  wallStart_ = wallNowNs();
+  cpuStart_ = threadCpuNowNs();
+}
+
+CpuScope::~CpuScope() {
+  if (!account_) {
+    return;
+  }
+  uint64_t cpu = threadCpuNowNs() - cpuStart_;
+  uint64_t wall = wallNowNs() - wallStart_;
+  account_->add(
+      category_,
+      wall > childWallNs_ ? wall - childWallNs_ : 0,
+      cpu > childCpuNs_ ? cpu - childCpuNs_ : 0);
+  if (parent_) {
+    parent_->childWallNs_ += wall;
+    parent_->childCpuNs_ += cpu;
+  }
+  tCurrentScope = parent_;
+}
+
+SandboxCpuAccounting& SandboxCpuAccounting::getInstance() {
+  static SandboxCpuAccounting instance;
+  return instance;
+}
+
+std::shared_ptr<CpuAccount> SandboxCpuAccounting::account(
+    const std::string& origin) {
+  if (origin.empty()) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& account = accounts_[origin];
+  if (!account) {
+    account = std::make_shared<CpuAccount>();
+  }
+  return account;
+}
+
+std::map<std::string, SandboxCpuUsage> SandboxCpuAccounting::snapshot() const {
+  std::map<std::string, SandboxCpuUsage> snapshot;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [origin, account] : accounts_) {
+    snapshot.emplace(origin, account->usage());
+  }
+  return snapshot;
+}
+
+void SandboxCpuAccounting::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  accounts_.clear();
+}
+
+std::string toJson(const std::map<std::string, SandboxCpuUsage>& snapshot) {
+  std::string out = "{";
+  bool first = true;
+  for (const auto& [origin, usage] : snapshot) {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+    out += '"';
+    appendJsonEscaped(out, origin);
+    char occupancy[32];
+    std::snprintf(occupancy, sizeof(occupancy), "%.4f", usage.occupancy());
+    out += "\":{\"occupancy\":";
+    out += occupancy;
+    out += ",\"elapsedUs\":" + std::to_string(usage.elapsedNs / 1000) + ",";
+    appendTime(out, "total", usage.total());
+    for (size_t i = 0; i < kCpuCategoryCount; ++i) {
+      out += ',';
+      appendTime(
+          out, jsonKey(static_cast<CpuCategory>(i)), usage.categories[i]);
+    }
+    out += '}';
+  }
+  out += '}';
+  return out;
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace rnsandbox {
+
+/** Where a sandbox's JS thread time goes. Categories are exclusive. */
+enum class CpuCategory : uint8_t {
+  // Host-side delivery work: inbox draining, buffering, error handling
+  Delivery,
+  // JSON.parse of incoming and JSON.stringify of outgoing messages
+  Serialization,
+  // Sandbox JS run by the host: setOnMessage handlers, scheduled callbacks
+  UserCallback,
+  // Sandbox JS calling into native: postMessage, substituted modules
+  NativeCall,
+};
+
+constexpr size_t kCpuCategoryCount = 4;
+
+const char* toString(CpuCategory category);
+
+struct CpuTime {
+  uint64_t wallNs = 0;
+  // Thread CPU time; below wallNs when the thread was descheduled or blocked
+  uint64_t cpuNs = 0;
+  uint64_t count = 0;
+};
+
+struct SandboxCpuUsage {
+  std::array<CpuTime, kCpuCategoryCount> categories{};
+  // Time since the origin's account was created
+  uint64_t elapsedNs = 0;
+
+  const CpuTime& operator[](CpuCategory category) const {
+    return categories[static_cast<size_t>(category)];
+  }
+
+  CpuTime total() const;
+
+  /** Share of elapsed wall time the JS thread spent on this sandbox. */
+  double occupancy() const;
+};
+
+/**
+ * Accumulated JS thread time of one origin. Updated with relaxed atomics by
+ * CpuScope, so recording never takes a lock.
+ */
+class CpuAccount {
+ public:
+  CpuAccount();
+
+  void add(CpuCategory category, uint64_t wallNs, uint64_t cpuNs);
+  SandboxCpuUsage usage() const;
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> wallNs{0};
+    std::atomic<uint64_t> cpuNs{0};
+    std::atomic<uint64_t> count{0};
+  };
+
+  std::array<Slot, kCpuCategoryCount> slots_;
+  std::chrono::steady_clock::time_point created_;
+};
+
+/**
+ * Charges the time until it goes out of scope to an account, minus the time
+ * of scopes nested inside it on the same thread, so a message handler's
+ * postMessage call is not also counted as handler time. A null account
+ * makes the scope a no-op that reads no clocks.
+ */
+class CpuScope {
+ public:
+  CpuScope(CpuAccount* account, CpuCategory category);
+  ~CpuScope();
+  CpuScope(const CpuScope&) = delete;
+  CpuScope& operator=(const CpuScope&) = delete;
+
+ private:
+  CpuAccount* account_;
+  CpuCategory category_;
+  CpuScope* parent_ = nullptr;
+  uint64_t wallStart_ = 0;
+  uint64_t cpuStart_ = 0;
+  uint64_t childWallNs_ = 0;
+  uint64_t childCpuNs_ = 0;
+};
+
+/**
+ * Process-wide per-origin CPU accounts. Accounts live as long as the
+ * process, so an origin's usage adds up across reloads and hibernation.
+ * Thread-safe.
+ */
+class SandboxCpuAccounting {
+ public:
+  static SandboxCpuAccounting& getInstance();
+
+  /** The origin's account, created on first use; null for no origin. */
+  std::shared_ptr<CpuAccount> account(const std::string& origin);
+
+  std::map<std::string, SandboxCpuUsage> snapshot() const;
+
+  /** Forgets every account. For tests. */
+  void reset();
+
+ private:
+  SandboxCpuAccounting() = default;
+  SandboxCpuAccounting(const SandboxCpuAccounting&) = delete;
+  SandboxCpuAccounting& operator=(const SandboxCpuAccounting&) = delete;
+
+  std::map<std::string, std::shared_ptr<CpuAccount>> accounts_;
+  mutable std::mutex mutex_;
+};
+
+/**
+ * Serializes a snapshot for metrics pipelines, keyed by origin:
+ * {"origin":{"occupancy":0.12,"elapsedUs":..,"total":{"wallUs":..,
+ * "cpuUs":..,"count":..},"delivery":{..},"serialization":{..},
+ * "userCallback":{..},"nativeCall":{..}}}
+ */
+std::string toJson(const std::map<std::string, SandboxCpuUsage>& snapshot);
+
+} // namespace rnsandbox
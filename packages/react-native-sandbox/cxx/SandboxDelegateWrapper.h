@@ -29,12 +29,17 @@ class SandboxDelegateWrapper : public ISandboxDelegate {
     delegate_ = nullptr;
   }
 
-  void postMessage(const std::string& message) override;
-  bool routeMessage(const std::string& message, const std::string& targetId)
+  void postMessage(const std::string& message, MessagePriority priority)
       override;
+  bool routeMessage(
+      const std::string& message,
+      const std::string& targetId,
+      MessagePriority priority) override;
   void setOrigin(const std::string& origin) override;
   void setAllowedOrigins(const std::set<std::string>& origins) override;
   void setAllowedTurboModules(const std::set<std::string>& modules) override;
+  bool scheduleOnJSThread(
+      std::function<void(facebook::jsi::Runtime&)> work) override;
 
  private:
   SandboxReactNativeDelegate* delegate_;
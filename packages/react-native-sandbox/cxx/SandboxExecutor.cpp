@@ -0,0 +1,258 @@
+#include "SandboxExecutor.h"
+#include "SandboxJson.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <utility>
+
+namespace rnsandbox {
+
+namespace {
+
+uint64_t microsBetween(
+    LaneMetrics::Clock::time_point from,
+    LaneMetrics::Clock::time_point to) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+  return us.count() > 0 ? static_cast<uint64_t>(us.count()) : 0;
+}
+
+} // namespace
+
+LaneMetrics::Clock::time_point LaneMetrics::taskPosted() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.posted;
+  ++stats_.pending;
+  stats_.maxPending = std::max(stats_.maxPending, stats_.pending);
+  return Clock::now();
+}
+
+LaneMetrics::Clock::time_point LaneMetrics::taskStarted(
+    Clock::time_point postedAt) {
+  auto now = Clock::now();
+  uint64_t waitUs = microsBetween(postedAt, now);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stats_.pending > 0) {
+    --stats_.pending;
+  }
+  stats_.totalWaitUs += waitUs;
+  stats_.maxWaitUs = std::max(stats_.maxWaitUs, waitUs);
+  return now;
+}
+
+void LaneMetrics::taskFinished(Clock::time_point startedAt) {
+  uint64_t runUs = microsBetween(startedAt, Clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.completed;
+  stats_.totalRunUs += runUs;
+}
+
+LaneStats LaneMetrics::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+BatchedTaskQueue::BatchedTaskQueue(std::shared_ptr<LaneMetrics> metrics)
+    : metrics_(std::move(metrics)) {}
+
+bool BatchedTaskQueue::push(SandboxTask task) {
+  auto postedAt = metrics_->taskPosted();
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.push_back({std::move(task), postedAt});
+  if (scheduled_) {
+    return false;
+  }
+  scheduled_ = true;
+  return true;
+}
+
+bool BatchedTaskQueue::drain(size_t maxTasks) {
+  for (size_t ran = 0; ran < maxTasks; ++ran) {
+    if (next_ == running_.size()) {
+      running_.clear();
+      next_ = 0;
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (pending_.empty()) {
+        scheduled_ = false;
+        return false;
+      }
+      pending_.swap(running_);
+    }
+    Entry& entry = running_[next_++];
+    auto startedAt = metrics_->taskStarted(entry.postedAt);
+    try {
+      entry.task();
+    } catch (const std::exception&) {
+      // Must not take the worker, and the other lanes it serves, down
+    }
+    // Releases what the call captured now rather than at the next swap
+    entry.task.reset();
+    metrics_->taskFinished(startedAt);
+  }
+  if (next_ < running_.size()) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pending_.empty()) {
+    running_.clear();
+    next_ = 0;
+    scheduled_ = false;
+    return false;
+  }
+  return true;
+}
+
+SandboxStrand::SandboxStrand(SandboxExecutor& executor)
+    : executor_(executor), tasks_(std::make_shared<LaneMetrics>()) {}
+
+void SandboxStrand::post(SandboxTask task) {
+  if (tasks_.push(std::move(task))) {
+    executor_.schedule(shared_from_this());
+  }
+}
+
+SandboxExecutor& SandboxExecutor::getInstance() {
+  static SandboxExecutor instance;
+  return instance;
+}
+
+size_t SandboxExecutor::defaultThreads() {
+  return std::clamp<size_t>(std::thread::hardware_concurrency(), 2, 4);
+}
+
+SandboxExecutor::SandboxExecutor(
+    size_t maxThreads,
+    std::chrono::milliseconds keepAlive)
+    : maxThreads_(std::max<size_t>(maxThreads, 1)), keepAlive_(keepAlive) {}
+
+SandboxExecutor::~SandboxExecutor() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopWorkers(lock);
+}
+
+void SandboxExecutor::setMaxThreads(size_t threads) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  maxThreads_ = std::max<size_t>(threads, 1);
+}
+
+std::shared_ptr<SandboxStrand> SandboxExecutor::strand(
+    const std::string& label) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& strand = strands_[label];
+  if (!strand) {
+    strand = std::make_shared<SandboxStrand>(*this);
+  }
+  return strand;
+}
+
+std::shared_ptr<LaneMetrics> SandboxExecutor::laneMetrics(
+    const std::string& label) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& metrics = metrics_[label];
+  if (!metrics) {
+    metrics = std::make_shared<LaneMetrics>();
+  }
+  return metrics;
+}
+
+std::map<std::string, LaneStats> SandboxExecutor::laneStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, LaneStats> lanes;
+  for (const auto& [label, strand] : strands_) {
+    lanes[label] = strand->stats();
+  }
+  for (const auto& [label, metrics] : metrics_) {
+    lanes[label] = metrics->stats();
+  }
+  return lanes;
+}
+
+size_t SandboxExecutor::threadCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return workers_;
+}
+
+void SandboxExecutor::schedule(std::shared_ptr<SandboxStrand> strand) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopping_) {
+    return;
+  }
+  ready_.push_back(std::move(strand));
+  // Idle workers are waiting for exactly this; otherwise add one if allowed
+  if (ready_.size() > idle_ && workers_ < maxThreads_) {
+    ++workers_;
+    std::thread([this] { runWorker(); }).detach();
+  } else {
+    work_.notify_one();
+  }
+}
+
+void SandboxExecutor::runWorker() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (ready_.empty()) {
+      ++idle_;
+      bool woken = work_.wait_for(
+          lock, keepAlive_, [this] { return stopping_ || !ready_.empty(); });
+      --idle_;
+      if (!woken) {
+        break;
+      }
+      continue;
+    }
+    auto strand = std::move(ready_.front());
+    ready_.pop_front();
+    lock.unlock();
+
+    bool more = strand->tasks_.drain(SandboxStrand::kBatchSize);
+
+    lock.lock();
+    if (more) {
+      // Behind the strands that were waiting meanwhile
+      ready_.push_back(std::move(strand));
+    }
+  }
+  --workers_;
+  // Notified under the lock: the destructor may run as soon as it is released
+  changed_.notify_all();
+}
+
+void SandboxExecutor::reset() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopWorkers(lock);
+  stopping_ = false;
+  ready_.clear();
+  strands_.clear();
+  metrics_.clear();
+  maxThreads_ = defaultThreads();
+}
+
+void SandboxExecutor::stopWorkers(std::unique_lock<std::mutex>& lock) {
+  stopping_ = true;
+  work_.notify_all();
+  changed_.wait(lock, [this] { return workers_ == 0; });
+}
+
+std::string toJson(const std::map<std::string, LaneStats>& lanes) {
+  std::string out = "{";
+  bool first = true;
+  for (const auto& [label, stats] : lanes) {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+    out += '"';
+    appendJsonEscaped(out, label);
+    out += "\":{\"posted\":" + std::to_string(stats.posted) +
+        ",\"completed\":" + std::to_string(stats.completed) +
+        ",\"pending\":" + std::to_string(stats.pending) +
+        ",\"maxPending\":" + std::to_string(stats.maxPending) +
+        ",\"totalWaitUs\":" + std::to_string(stats.totalWaitUs) +
+        ",\"maxWaitUs\":" + std::to_string(stats.maxWaitUs) +
+        ",\"totalRunUs\":" + std::to_string(stats.totalRunUs) + "}";
+  }
+  out += '}';
+  return out;
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SandboxTask.h"
+
+namespace rnsandbox {
+
+class SandboxExecutor;
+
+/** Queue metrics of one serial lane. Times are in microseconds. */
+struct LaneStats {
+  uint64_t posted = 0;
+  uint64_t completed = 0;
+  // Posted and not started yet
+  size_t pending = 0;
+  size_t maxPending = 0;
+  // Time from post to start
+  uint64_t totalWaitUs = 0;
+  uint64_t maxWaitUs = 0;
+  uint64_t totalRunUs = 0;
+};
+
+/**
+ * Records the queue metrics of a lane. Used by strands, and directly by
+ * callers whose lane runs elsewhere, e.g. on a module's own dispatch queue.
+ * Thread-safe.
+ */
+class LaneMetrics {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /** @return The post time, to hand to taskStarted() */
+  Clock::time_point taskPosted();
+  /** @return The start time, to hand to taskFinished() */
+  Clock::time_point taskStarted(Clock::time_point postedAt);
+  void taskFinished(Clock::time_point startedAt);
+
+  LaneStats stats() const;
+
+ private:
+  LaneStats stats_;
+  mutable std::mutex mutex_;
+};
+
+/**
+ * The queued tasks of one serial lane, run in batches by whoever drains it:
+ * a strand's pool worker, or a dispatch queue on iOS. The push() that finds
+ * the lane idle tells the caller to schedule a drain; later pushes join the
+ * pending batch without another wakeup. Task slots are reused from batch to
+ * batch, so once warmed up a busy lane queues and runs calls without
+ * allocating.
+ *
+ * Thread-safe, but only one drain() may run at a time, which the scheduling
+ * protocol guarantees.
+ */
+class BatchedTaskQueue {
+ public:
+  explicit BatchedTaskQueue(std::shared_ptr<LaneMetrics> metrics);
+
+  /** @return true if the lane was idle and the caller must schedule drain() */
+  bool push(SandboxTask task);
+
+  /**
+   * Runs up to maxTasks, including tasks pushed meanwhile.
+   * @return true if tasks remain and the caller must schedule drain() again
+   */
+  bool drain(size_t maxTasks);
+
+  LaneStats stats() const {
+    return metrics_->stats();
+  }
+
+ private:
+  struct Entry {
+    SandboxTask task;
+    LaneMetrics::Clock::time_point postedAt;
+  };
+
+  std::shared_ptr<LaneMetrics> metrics_;
+  std::vector<Entry> pending_;
+  // Scheduled for or inside drain()
+  bool scheduled_ = false;
+  std::mutex mutex_;
+
+  // Owned by the running drain(): the batch taken from pending_ and the
+  // next entry to run. Swapped with pending_ when used up, keeping both
+  // buffers' capacity.
+  std::vector<Entry> running_;
+  size_t next_ = 0;
+};
+
+/**
+ * A serial lane on a SandboxExecutor: tasks posted to one strand run one at
+ * a time in post order, on whichever pool thread picks the strand up, while
+ * different strands run in parallel. Thread-safe.
+ */
+class SandboxStrand : public std::enable_shared_from_this<SandboxStrand> {
+ public:
+  /** Tasks a worker runs from one strand before moving on to the next. */
+  static constexpr size_t kBatchSize = 8;
+
+  explicit SandboxStrand(SandboxExecutor& executor);
+
+  void post(SandboxTask task);
+
+  LaneStats stats() const {
+    return tasks_.stats();
+  }
+
+ private:
+  friend class SandboxExecutor;
+
+  SandboxExecutor& executor_;
+  BatchedTaskQueue tasks_;
+};
+
+/**
+ * A bounded pool shared by every sandbox that runs native module methods on
+ * serial lanes, so that dozens of sandboxes with a few substituted modules
+ * each don't need a thread or queue of their own per module.
+ *
+ * Lanes are keyed by label, e.g. "<origin>/<module>", and live as long as
+ * the executor, so their metrics accumulate per origin and module across
+ * sandbox instances. Workers start on demand, up to the thread limit, and
+ * exit after idling for the keep-alive period. A worker takes strands from
+ * one ready queue and requeues a busy strand after each batch, so one
+ * chatty lane cannot starve the others.
+ *
+ * Thread-safe. Tasks run without locks held and may post to any strand.
+ * Tasks still queued when the executor is destroyed are dropped.
+ */
+class SandboxExecutor {
+ public:
+  static constexpr std::chrono::milliseconds kDefaultKeepAlive{2000};
+
+  static SandboxExecutor& getInstance();
+
+  /** The core count, clamped to [2, 4]. */
+  static size_t defaultThreads();
+
+  explicit SandboxExecutor(
+      size_t maxThreads = defaultThreads(),
+      std::chrono::milliseconds keepAlive = kDefaultKeepAlive);
+  ~SandboxExecutor();
+
+  SandboxExecutor(const SandboxExecutor&) = delete;
+  SandboxExecutor& operator=(const SandboxExecutor&) = delete;
+
+  /** Upper bound of worker threads, at least 1. */
+  void setMaxThreads(size_t threads);
+
+  /** The strand for label, created on first use. */
+  std::shared_ptr<SandboxStrand> strand(const std::string& label);
+
+  /**
+   * Metrics for a lane that runs outside the pool, created on first use and
+   * reported by laneStats() next to the strands.
+   */
+  std::shared_ptr<LaneMetrics> laneMetrics(const std::string& label);
+
+  std::map<std::string, LaneStats> laneStats() const;
+
+  size_t threadCount() const;
+
+  /** Waits for running tasks, then forgets every lane. For tests. */
+  void reset();
+
+ private:
+  friend class SandboxStrand;
+
+  void schedule(std::shared_ptr<SandboxStrand> strand);
+  void runWorker();
+  void stopWorkers(std::unique_lock<std::mutex>& lock);
+
+  std::map<std::string, std::shared_ptr<SandboxStrand>> strands_;
+  std::map<std::string, std::shared_ptr<LaneMetrics>> metrics_;
+  std::deque<std::shared_ptr<SandboxStrand>> ready_;
+  size_t maxThreads_;
+  std::chrono::milliseconds keepAlive_;
+  size_t workers_ = 0;
+  size_t idle_ = 0;
+  bool stopping_ = false;
+
+  // Signalled when a strand becomes ready or the executor stops
+  std::condition_variable work_;
+  // Signalled when a worker exits
+  std::condition_variable changed_;
+  mutable std::mutex mutex_;
+};
+
+/**
+ * Serializes lane stats for metrics pipelines, keyed by lane label:
+ * {"origin/module":{"posted":..,"completed":..,"pending":..,
+ * "maxPending":..,"totalWaitUs":..,"maxWaitUs":..,"totalRunUs":..}}
+ */
+std::string toJson(const std::map<std::string, LaneStats>& lanes);
+
+} // namespace rnsandbox
@@ -0,0 +1,47 @@
+#include "SandboxHeapProbe.h"
+
+#include <optional>
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+std::optional<size_t> liveHeapBytes(jsi::Runtime& runtime) {
+  auto info = runtime.instrumentation().getHeapInfo(false);
+  // Hermes keys; runtimes without heap info are not governed
+  auto it = info.find("hermes_allocatedBytes");
+  if (it == info.end()) {
+    it = info.find("hermes_heapSize");
+  }
+  if (it == info.end() || it->second < 0) {
+    return std::nullopt;
+  }
+  return static_cast<size_t>(it->second);
+}
+
+} // namespace
+
+void sampleHeapUsage(
+    jsi::Runtime& runtime,
+    SandboxMemoryGovernor::SandboxId id) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  if (!governor.shouldSample(id)) {
+    return;
+  }
+  if (auto bytes = liveHeapBytes(runtime)) {
+    governor.reportHeapUsage(id, *bytes, false);
+  }
+}
+
+void collectGarbage(
+    jsi::Runtime& runtime,
+    SandboxMemoryGovernor::SandboxId id) {
+  runtime.instrumentation().collectGarbage("sandbox memory governor");
+  if (auto bytes = liveHeapBytes(runtime)) {
+    SandboxMemoryGovernor::getInstance().reportHeapUsage(id, *bytes, true);
+  }
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include "SandboxMemoryGovernor.h"
+
+namespace rnsandbox {
+
+/**
+ * Reports the runtime's live heap to the governor if a sample is due. Call
+ * on the sandbox's JS thread after running its work; cheap when not due.
+ */
+void sampleHeapUsage(
+    facebook::jsi::Runtime& runtime,
+    SandboxMemoryGovernor::SandboxId id);
+
+/**
+ * Forces a full collection and reports the resulting heap to the governor.
+ * Implements SandboxMemoryGovernor::Hooks::collectGarbage on the JS thread.
+ */
+void collectGarbage(
+    facebook::jsi::Runtime& runtime,
+    SandboxMemoryGovernor::SandboxId id);
+
+} // namespace rnsandbox
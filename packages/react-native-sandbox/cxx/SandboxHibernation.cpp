@@ -0,0 +1,178 @@
+#include "SandboxHibernation.h"
+
+namespace rnsandbox {
+
+bool parseHibernationWakePolicy(
+    const std::string& name,
+    HibernationWakePolicy& policy) {
+  if (name == "queue") {
+    policy = HibernationWakePolicy::Queue;
+  } else if (name == "urgent") {
+    policy = HibernationWakePolicy::Urgent;
+  } else if (name == "any") {
+    policy = HibernationWakePolicy::Any;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+HibernationState SandboxHibernation::state() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return state_;
+}
+
+void SandboxHibernation::setWakePolicy(HibernationWakePolicy policy) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  policy_ = policy;
+}
+
+HibernationWakePolicy SandboxHibernation::wakePolicy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return policy_;
+}
+
+void SandboxHibernation::setWakeHandler(WakeHandler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  wakeHandler_ = std::move(handler);
+}
+
+void SandboxHibernation::setSnapshotter(Snapshotter snapshotter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  snapshotter_ = std::move(snapshotter);
+}
+
+bool SandboxHibernation::beginHibernate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (state_ != HibernationState::Active) {
+    return false;
+  }
+  state_ = HibernationState::Hibernating;
+  wakeRequested_ = false;
+  ++stats_.hibernations;
+  return true;
+}
+
+std::optional<std::string> SandboxHibernation::snapshot(
+    facebook::jsi::Runtime& runtime) {
+  Snapshotter snapshotter;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshotter = snapshotter_;
+  }
+  // Runs JS, so it must not hold the lock
+  return snapshotter ? snapshotter(runtime) : std::nullopt;
+}
+
+bool SandboxHibernation::completeHibernate(
+    std::optional<std::string> stateJson) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (state_ != HibernationState::Hibernating) {
+    return false;
+  }
+  state_ = HibernationState::Hibernated;
+  stateJson_ = std::move(stateJson);
+  // Belongs to the runtime that is about to be released
+  snapshotter_ = nullptr;
+  return wakeRequested_;
+}
+
+bool SandboxHibernation::resume() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  switch (state_) {
+    case HibernationState::Hibernating:
+      wakeRequested_ = true;
+      return false;
+    case HibernationState::Hibernated:
+      state_ = HibernationState::Active;
+      wakeRequested_ = false;
+      return true;
+    case HibernationState::Active:
+      break;
+  }
+  return false;
+}
+
+std::optional<std::string> SandboxHibernation::takeRestoredState() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::optional<std::string> stateJson = std::move(stateJson_);
+  stateJson_.reset();
+  return stateJson;
+}
+
+bool SandboxHibernation::noteMessage(MessagePriority priority) {
+  WakeHandler handler;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ == HibernationState::Active || wakeRequested_) {
+      return false;
+    }
+    bool wakes = policy_ == HibernationWakePolicy::Any ||
+        (policy_ == HibernationWakePolicy::Urgent &&
+         priority == MessagePriority::Urgent);
+    if (!wakes) {
+      return false;
+    }
+    wakeRequested_ = true;
+    ++stats_.wakeRequests;
+    // While still hibernating, completeHibernate() reports the request
+    if (state_ == HibernationState::Hibernated) {
+      handler = wakeHandler_;
+    }
+  }
+  if (handler) {
+    handler();
+  }
+  return true;
+}
+
+void SandboxHibernation::parkMessage(
+    std::string message,
+    MessagePriority priority) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (parked_.size() >= kMaxParkedMessages) {
+      ++stats_.droppedMessages;
+    } else {
+      parked_.emplace_back(std::move(message), priority);
+      ++stats_.parkedMessages;
+    }
+  }
+  noteMessage(priority);
+}
+
+std::vector<SandboxHibernation::ParkedMessage>
+SandboxHibernation::takeParkedMessages() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<ParkedMessage> parked;
+  parked.swap(parked_);
+  return parked;
+}
+
+HibernationStats SandboxHibernation::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void ParkedSandboxDelegate::postMessage(
+    const std::string& message,
+    MessagePriority priority) {
+  if (auto hibernation = hibernation_.lock()) {
+    hibernation->parkMessage(message, priority);
+  }
+}
+
+bool ParkedSandboxDelegate::routeMessage(
+    const std::string&,
+    const std::string&,
+    MessagePriority) {
+  // A hibernated sandbox runs no JS that could send anything
+  return false;
+}
+
+bool ParkedSandboxDelegate::scheduleOnJSThread(
+    std::function<void(facebook::jsi::Runtime&)>) {
+  return false;
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ISandboxDelegate.h"
+#include "MessagePriority.h"
+
+namespace rnsandbox {
+
+enum class HibernationState {
+  Active,
+  // Asked the runtime for its state blob; the runtime is still alive
+  Hibernating,
+  // Runtime released; only the state blob and parked messages remain
+  Hibernated,
+};
+
+/** What a message arriving for a hibernated sandbox does. */
+enum class HibernationWakePolicy {
+  // Stays queued until the app resumes the sandbox
+  Queue,
+  // Urgent messages wake the sandbox, bulk ones stay queued
+  Urgent,
+  // Any message wakes the sandbox
+  Any,
+};
+
+/**
+ * Parses "queue", "urgent" or "any".
+ * @return false, leaving policy untouched, for anything else
+ */
+bool parseHibernationWakePolicy(
+    const std::string& name,
+    HibernationWakePolicy& policy);
+
+struct HibernationStats {
+  uint64_t hibernations = 0;
+  uint64_t wakeRequests = 0;
+  uint64_t parkedMessages = 0;
+  uint64_t droppedMessages = 0;
+};
+
+/**
+ * Hibernate/resume state of one sandbox view, shared by the platform view,
+ * its delegate and the runtime bindings.
+ *
+ * Hibernating asks the sandbox for a JSON state blob through the snapshotter
+ * the bindings installed, after which the platform releases the runtime.
+ * The blob is handed to the next runtime on resume. Messages for the
+ * sandbox keep arriving in the meantime: they are parked, and may request a
+ * wake-up depending on the wake policy. At most one wake-up is requested
+ * per hibernation.
+ *
+ * Thread-safe. The snapshotter only runs on the sandbox's JS thread.
+ */
+class SandboxHibernation {
+ public:
+  using Snapshotter =
+      std::function<std::optional<std::string>(facebook::jsi::Runtime&)>;
+  using WakeHandler = std::function<void()>;
+  using ParkedMessage = std::pair<std::string, MessagePriority>;
+
+  static constexpr size_t kMaxParkedMessages = 1024;
+
+  HibernationState state() const;
+
+  void setWakePolicy(HibernationWakePolicy policy);
+  HibernationWakePolicy wakePolicy() const;
+
+  /** Called, without locks held, when a parked message requests a wake. */
+  void setWakeHandler(WakeHandler handler);
+
+  /** Installed by each new runtime; replaces the previous one. */
+  void setSnapshotter(Snapshotter snapshotter);
+
+  /**
+   * Active -> Hibernating.
+   * @return false if the sandbox is not active
+   */
+  bool beginHibernate();
+
+  /**
+   * Runs the snapshotter on the JS thread.
+   * @return The JSON state blob, or std::nullopt if the sandbox keeps none
+   */
+  std::optional<std::string> snapshot(facebook::jsi::Runtime& runtime);
+
+  /**
+   * Hibernating -> Hibernated, keeping the state blob for the next runtime.
+   * @return true if a resume was requested while hibernating, in which case
+   * the caller should resume right after releasing the runtime
+   */
+  bool completeHibernate(std::optional<std::string> stateJson);
+
+  /**
+   * Hibernated -> Active. While still Hibernating, the request is recorded
+   * and reported by completeHibernate() instead.
+   * @return true if the caller must now rebuild the runtime
+   */
+  bool resume();
+
+  /** The state blob saved by the last hibernation, handed out once. */
+  std::optional<std::string> takeRestoredState();
+
+  /**
+   * Records a message for a sandbox that is not active and applies the wake
+   * policy.
+   * @return true if this message requested the wake-up
+   */
+  bool noteMessage(MessagePriority priority);
+
+  /**
+   * Stores a message for a sandbox whose runtime delegate is gone, then
+   * applies noteMessage(). Beyond kMaxParkedMessages messages are dropped.
+   */
+  void parkMessage(std::string message, MessagePriority priority);
+
+  /** Removes and returns the parked messages in arrival order. */
+  std::vector<ParkedMessage> takeParkedMessages();
+
+  HibernationStats stats() const;
+
+ private:
+  HibernationState state_ = HibernationState::Active;
+  HibernationWakePolicy policy_ = HibernationWakePolicy::Queue;
+  bool wakeRequested_ = false;
+  std::optional<std::string> stateJson_;
+  std::vector<ParkedMessage> parked_;
+  HibernationStats stats_;
+  WakeHandler wakeHandler_;
+  Snapshotter snapshotter_;
+  mutable std::mutex mutex_;
+};
+
+/**
+ * Stands in for a hibernated sandbox in SandboxRegistry on platforms whose
+ * registry delegate is tied to the runtime (Android), so the origin stays
+ * registered and messages from the host and other sandboxes are parked
+ * rather than lost. It has no JS thread to schedule work on.
+ */
+class ParkedSandboxDelegate : public ISandboxDelegate {
+ public:
+  explicit ParkedSandboxDelegate(std::weak_ptr<SandboxHibernation> hibernation)
+      : hibernation_(std::move(hibernation)) {}
+
+  void postMessage(const std::string& message, MessagePriority priority)
+      override;
+
+  bool routeMessage(
+      const std::string& message,
+      const std::string& targetId,
+      MessagePriority priority) override;
+
+  void setOrigin(const std::string&) override {}
+  void setAllowedOrigins(const std::set<std::string>&) override {}
+  void setAllowedTurboModules(const std::set<std::string>&) override {}
+
+  bool scheduleOnJSThread(
+      std::function<void(facebook::jsi::Runtime&)> work) override;
+
+ private:
+  std::weak_ptr<SandboxHibernation> hibernation_;
+};
+
+} // namespace rnsandbox
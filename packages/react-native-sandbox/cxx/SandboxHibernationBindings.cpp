@@ -0,0 +1,92 @@
+#include "SandboxHibernationBindings.h"
+#include "SandboxJSIUtils.h"
+
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+// Per-runtime state touched only on the owning sandbox's JS thread. The
+// snapshotter holds it weakly, so a released runtime is never called into.
+struct HibernationJSState {
+  std::shared_ptr<jsi::Function> onHibernate;
+  std::optional<std::string> restoredState;
+};
+
+} // namespace
+
+void installHibernationBindings(
+    jsi::Runtime& runtime,
+    const std::shared_ptr<SandboxHibernation>& hibernation,
+    SandboxJSHandlers& handlers) {
+  auto state = std::make_shared<HibernationJSState>();
+  state->restoredState = hibernation->takeRestoredState();
+  handlers.add([weakState = std::weak_ptr<HibernationJSState>(state)]() {
+    if (auto strongState = weakState.lock()) {
+      strongState->onHibernate.reset();
+    }
+  });
+
+  hibernation->setSnapshotter(
+      [weakState = std::weak_ptr<HibernationJSState>(state)](
+          jsi::Runtime& rt) -> std::optional<std::string> {
+        auto strongState = weakState.lock();
+        if (!strongState || !strongState->onHibernate) {
+          return std::nullopt;
+        }
+        jsi::Value result = strongState->onHibernate->call(rt);
+        if (result.isUndefined()) {
+          return std::nullopt;
+        }
+        return stringifyJSON(rt, result);
+      });
+
+  auto setOnHibernate = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "setOnHibernate"),
+      1,
+      [state](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count != 1) {
+          throw jsi::JSError(
+              rt, "setOnHibernate(handler): expected exactly one argument");
+        }
+        if (args[0].isNull() || args[0].isUndefined()) {
+          state->onHibernate.reset();
+          return jsi::Value::undefined();
+        }
+        if (!args[0].isObject() || !args[0].asObject(rt).isFunction(rt)) {
+          throw jsi::JSError(
+              rt, "setOnHibernate: handler must be a function or null");
+        }
+        state->onHibernate = std::make_shared<jsi::Function>(
+            args[0].asObject(rt).asFunction(rt));
+        return jsi::Value::undefined();
+      });
+
+  auto getRestoredState = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "getRestoredState"),
+      0,
+      [state](jsi::Runtime& rt, const jsi::Value&, const jsi::Value*, size_t)
+          -> jsi::Value {
+        if (!state->restoredState) {
+          return jsi::Value::undefined();
+        }
+        return parseJSON(rt, *state->restoredState);
+      });
+
+  defineSandboxGlobal(runtime, "setOnHibernate", std::move(setOnHibernate));
+  defineSandboxGlobal(
+      runtime, "getRestoredState", std::move(getRestoredState));
+}
+
+} // namespace rnsandbox
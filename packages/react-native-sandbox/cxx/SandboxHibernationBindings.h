@@ -0,0 +1,30 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include "SandboxHibernation.h"
+#include "SandboxJSHandlers.h"
+
+namespace rnsandbox {
+
+/**
+ * Installs the hibernation globals into a sandbox runtime:
+ *
+ *   setOnHibernate(() => state | null)
+ *   getRestoredState() => state | undefined
+ *
+ * The handler runs on the JS thread right before the host releases the
+ * runtime; its JSON-serializable result is what getRestoredState() returns
+ * in the runtime built on resume. Timers and pending work are dropped with
+ * the runtime, so anything worth keeping belongs in the returned state.
+ *
+ * @param runtime The sandbox runtime, on its JS thread
+ * @param hibernation Hibernation state of the view owning the runtime
+ * @param handlers Receives the reset of the setOnHibernate handler
+ */
+void installHibernationBindings(
+    facebook::jsi::Runtime& runtime,
+    const std::shared_ptr<SandboxHibernation>& hibernation,
+    SandboxJSHandlers& handlers);
+
+} // namespace rnsandbox
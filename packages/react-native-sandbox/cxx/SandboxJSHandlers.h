@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace rnsandbox {
+
+/**
+ * Drops the JS callbacks one sandbox runtime handed to its bindings: RPC and
+ * presence handlers, shared state subscribers, unsettled waitAsync promises
+ * and the hibernation hook. A hot bundle swap resets them before evaluating
+ * the new bundle in the same runtime, so nothing calls into the replaced
+ * bundle afterwards. The bindings themselves stay installed and usable.
+ *
+ * Touched only on the runtime's JS thread.
+ */
+class SandboxJSHandlers {
+ public:
+  using Reset = std::function<void()>;
+
+  void add(Reset reset) {
+    resets_.push_back(std::move(reset));
+  }
+
+  void resetAll() const {
+    for (const auto& reset : resets_) {
+      reset();
+    }
+  }
+
+ private:
+  std::vector<Reset> resets_;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include "SandboxLog.h"
+
+namespace rnsandbox {
+
+// Defines a non-writable, non-enumerable, non-configurable property on
+// object, so it cannot be replaced from JS.
+inline void defineSandboxProperty(
+    facebook::jsi::Runtime& runtime,
+    const facebook::jsi::Object& object,
+    const char* name,
+    facebook::jsi::Value&& value) {
+  facebook::jsi::Function defineProperty =
+      runtime.global()
+          .getPropertyAsObject(runtime, "Object")
+          .getPropertyAsFunction(runtime, "defineProperty");
+
+  facebook::jsi::Object desc(runtime);
+  desc.setProperty(runtime, "value", std::move(value));
+  desc.setProperty(runtime, "writable", false);
+  desc.setProperty(runtime, "enumerable", false);
+  desc.setProperty(runtime, "configurable", false);
+
+  defineProperty.call(
+      runtime,
+      object,
+      facebook::jsi::String::createFromAscii(runtime, name),
+      std::move(desc));
+}
+
+// Defines a property on the runtime global the way postMessage/setOnMessage
+// are exposed to sandboxed code.
+inline void defineSandboxGlobal(
+    facebook::jsi::Runtime& runtime,
+    const char* name,
+    facebook::jsi::Value&& value) {
+  defineSandboxProperty(runtime, runtime.global(), name, std::move(value));
+}
+
+// JSON.stringify wrapper that rejects values without a JSON representation
+// (undefined, functions, symbols) instead of crashing on the non-string result.
+inline std::string stringifyJSON(
+    facebook::jsi::Runtime& runtime,
+    const facebook::jsi::Value& value) {
+  facebook::jsi::Value result =
+      runtime.global()
+          .getPropertyAsObject(runtime, "JSON")
+          .getPropertyAsFunction(runtime, "stringify")
+          .call(runtime, value);
+  if (!result.isString()) {
+    throw facebook::jsi::JSError(runtime, "Value is not JSON-serializable");
+  }
+  return result.getString(runtime).utf8(runtime);
+}
+
+inline facebook::jsi::Value parseJSON(
+    facebook::jsi::Runtime& runtime,
+    const std::string& json) {
+  return runtime.global()
+      .getPropertyAsObject(runtime, "JSON")
+      .getPropertyAsFunction(runtime, "parse")
+      .call(runtime, facebook::jsi::String::createFromUtf8(runtime, json));
+}
+
+// Creates a pending Promise and hands out its resolve/reject functions so
+// native code can settle it later on the JS thread.
+inline facebook::jsi::Value createPromise(
+    facebook::jsi::Runtime& runtime,
+    std::shared_ptr<facebook::jsi::Function>& resolve,
+    std::shared_ptr<facebook::jsi::Function>& reject) {
+  auto settlers = std::make_shared<std::pair<
+      std::shared_ptr<facebook::jsi::Function>,
+      std::shared_ptr<facebook::jsi::Function>>>();
+  auto executor = facebook::jsi::Function::createFromHostFunction(
+      runtime,
+      facebook::jsi::PropNameID::forAscii(runtime, "executor"),
+      2,
+      [settlers](
+          facebook::jsi::Runtime& rt,
+          const facebook::jsi::Value&,
+          const facebook::jsi::Value* args,
+          size_t count) -> facebook::jsi::Value {
+        if (count >= 2) {
+          settlers->first = std::make_shared<facebook::jsi::Function>(
+              args[0].asObject(rt).asFunction(rt));
+          settlers->second = std::make_shared<facebook::jsi::Function>(
+              args[1].asObject(rt).asFunction(rt));
+        }
+        return facebook::jsi::Value::undefined();
+      });
+
+  facebook::jsi::Value promise =
+      runtime.global()
+          .getPropertyAsFunction(runtime, "Promise")
+          .callAsConstructor(runtime, executor);
+  resolve = std::move(settlers->first);
+  reject = std::move(settlers->second);
+  return promise;
+}
+
+// Creates an Error instance with an extra `code` property, for rejecting
+// promises returned by native APIs.
+inline facebook::jsi::Value createJSError(
+    facebook::jsi::Runtime& runtime,
+    const std::string& message,
+    const char* code) {
+  facebook::jsi::Object error =
+      runtime.global()
+          .getPropertyAsFunction(runtime, "Error")
+          .callAsConstructor(
+              runtime, facebook::jsi::String::createFromUtf8(runtime, message))
+          .asObject(runtime);
+  error.setProperty(
+      runtime, "code", facebook::jsi::String::createFromAscii(runtime, code));
+  return facebook::jsi::Value(std::move(error));
+}
+
+// Routes an error thrown by sandbox code inside a natively dispatched callback
+// through ErrorUtils, so it reaches the sandbox global error handler (and
+// onError on the host) like any other uncaught JS error.
+inline void reportJSError(
+    facebook::jsi::Runtime& runtime,
+    const facebook::jsi::JSError& error) {
+  facebook::jsi::Value errorUtils =
+      runtime.global().getProperty(runtime, "ErrorUtils");
+  if (errorUtils.isObject()) {
+    facebook::jsi::Value reportError =
+        errorUtils.asObject(runtime).getProperty(runtime, "reportError");
+    if (reportError.isObject() &&
+        reportError.asObject(runtime).isFunction(runtime)) {
+      reportError.asObject(runtime).asFunction(runtime).call(
+          runtime, facebook::jsi::Value(runtime, error.value()));
+      return;
+    }
+  }
+  SANDBOX_LOG_WARN(
+      "Uncaught error in sandbox callback: %s", error.getMessage().c_str());
+}
+
+} // namespace rnsandbox
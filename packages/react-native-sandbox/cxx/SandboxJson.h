@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+namespace rnsandbox {
+
+/** Appends value to out escaped for use inside a JSON string literal. */
+inline void appendJsonEscaped(std::string& out, const std::string& value) {
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[7];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out += escaped;
+        } else {
+          out += c;
+        }
+    }
+  }
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,682 @@
+#include "SandboxKVStore.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <map>
+
+namespace rnsandbox {
+
+namespace {
+
+constexpr uint8_t kPut = 1;
+constexpr uint8_t kRemove = 2;
+// Compaction writes the live records in batches of about this size
+constexpr size_t kCompactBatchBytes = 1024 * 1024;
+constexpr size_t kFrameHeaderSize = 2 * 4;
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> entries{};
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+      }
+      entries[i] = value;
+    }
+    return entries;
+  }();
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+uint32_t readUint32(const uint8_t* bytes) {
+  return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 |
+      uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+void appendUint32(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+uint64_t recordBytes(size_t keySize, size_t valueSize) {
+  return SandboxKVStore::kRecordHeaderSize + keySize + valueSize;
+}
+
+std::string ioError(const std::string& path) {
+  return path + ": " + std::strerror(errno);
+}
+
+bool writeAll(int fd, const char* data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+    offset += static_cast<uint64_t>(written);
+  }
+  return true;
+}
+
+bool readAll(int fd, uint8_t* data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t got = ::pread(fd, data, size, static_cast<off_t>(offset));
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      if (got == 0) {
+        errno = EIO;
+      }
+      return false;
+    }
+    data += got;
+    size -= static_cast<size_t>(got);
+    offset += static_cast<uint64_t>(got);
+  }
+  return true;
+}
+
+// Fills in the header of a frame built after kBatchHeaderSize placeholder
+// bytes
+void sealFrame(std::string& frame, uint32_t count) {
+  std::string header;
+  auto payloadSize = static_cast<uint32_t>(frame.size() - kFrameHeaderSize);
+  for (size_t i = 0; i < 4; ++i) {
+    frame[kFrameHeaderSize + i] = static_cast<char>((count >> (8 * i)) & 0xFF);
+  }
+  appendUint32(header, payloadSize);
+  appendUint32(
+      header,
+      crc32(
+          reinterpret_cast<const uint8_t*>(frame.data()) + kFrameHeaderSize,
+          payloadSize));
+  frame.replace(0, kFrameHeaderSize, header);
+}
+
+void appendRecord(
+    std::string& frame,
+    uint8_t type,
+    const std::string& key,
+    const char* value,
+    size_t size) {
+  frame.push_back(static_cast<char>(type));
+  appendUint32(frame, static_cast<uint32_t>(key.size()));
+  appendUint32(frame, static_cast<uint32_t>(size));
+  frame.append(key);
+  frame.append(value, size);
+}
+
+// A store opened through openShared() and how many handles use it
+struct SharedStore {
+  std::unique_ptr<SandboxKVStore> store;
+  size_t users = 0;
+};
+
+// Guards sharedStores(); a store is destroyed under it, so a reopen never
+// finds the directory still locked by a store on its way out
+std::mutex& sharedStoresMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<std::string, SharedStore>& sharedStores() {
+  static std::map<std::string, SharedStore> stores;
+  return stores;
+}
+
+} // namespace
+
+std::shared_ptr<SandboxKVStore> SandboxKVStore::openShared(
+    const std::string& directory,
+    KVStoreOptions options,
+    std::string* error) {
+  std::lock_guard<std::mutex> lock(sharedStoresMutex());
+  auto& stores = sharedStores();
+  auto it = stores.find(directory);
+  if (it == stores.end()) {
+    auto store = open(directory, options, error);
+    if (!store) {
+      return nullptr;
+    }
+    it = stores.emplace(directory, SharedStore{std::move(store)}).first;
+  }
+  ++it->second.users;
+
+  return std::shared_ptr<SandboxKVStore>(
+      it->second.store.get(), [directory](SandboxKVStore*) {
+        std::lock_guard<std::mutex> lock(sharedStoresMutex());
+        auto& stores = sharedStores();
+        auto it = stores.find(directory);
+        if (it != stores.end() && --it->second.users == 0) {
+          stores.erase(it);
+        }
+      });
+}
+
+std::unique_ptr<SandboxKVStore> SandboxKVStore::open(
+    const std::string& directory,
+    KVStoreOptions options,
+    std::string* error) {
+  if (::mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+    if (error) {
+      *error = ioError(directory);
+    }
+    return nullptr;
+  }
+
+  // Held until the store closes. A second store on the directory would
+  // append to the same log behind this one's index, and could delete its
+  // compaction in progress.
+  std::string lockPath = directory + "/" + kLockName;
+  int lockFd = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (lockFd < 0) {
+    if (error) {
+      *error = ioError(lockPath);
+    }
+    return nullptr;
+  }
+  if (::flock(lockFd, LOCK_EX | LOCK_NB) != 0) {
+    if (error) {
+      *error = errno == EWOULDBLOCK
+          ? directory + ": already open in another store"
+          : ioError(lockPath);
+    }
+    ::close(lockFd);
+    return nullptr;
+  }
+
+  // Left by a compaction that did not finish; the log is still whole
+  std::string compactPath = directory + "/" + kCompactName;
+  ::unlink(compactPath.c_str());
+
+  std::string path = directory + "/" + kLogName;
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    if (error) {
+      *error = ioError(path);
+    }
+    ::close(lockFd);
+    return nullptr;
+  }
+  std::unique_ptr<SandboxKVStore> store(
+      new SandboxKVStore(directory, options, fd, lockFd));
+  if (!store->replay(error)) {
+    return nullptr;
+  }
+  return store;
+}
+
+SandboxKVStore::SandboxKVStore(
+    std::string directory,
+    KVStoreOptions options,
+    int fd,
+    int lockFd)
+    : directory_(std::move(directory)),
+      options_(options),
+      fd_(fd),
+      lockFd_(lockFd) {}
+
+SandboxKVStore::~SandboxKVStore() {
+  ::close(fd_);
+  // Releases the lock
+  ::close(lockFd_);
+}
+
+bool SandboxKVStore::replay(std::string* error) {
+  std::string path = directory_ + "/" + kLogName;
+  struct stat info;
+  if (::fstat(fd_, &info) != 0) {
+    if (error) {
+      *error = ioError(path);
+    }
+    return false;
+  }
+  auto size = static_cast<uint64_t>(info.st_size);
+
+  if (size < kHeaderSize) {
+    // New, or torn while it was being created
+    if (::ftruncate(fd_, 0) != 0 ||
+        !writeAll(fd_, kMagic, kHeaderSize, 0) || ::fsync(fd_) != 0) {
+      if (error) {
+        *error = ioError(path);
+      }
+      return false;
+    }
+    droppedBytes_ = size;
+    logSize_ = kHeaderSize;
+    return true;
+  }
+
+  uint8_t magic[kHeaderSize];
+  if (!readAll(fd_, magic, kHeaderSize, 0)) {
+    if (error) {
+      *error = ioError(path);
+    }
+    return false;
+  }
+  if (std::memcmp(magic, kMagic, kHeaderSize) != 0) {
+    if (error) {
+      *error = path + ": not a key-value store log";
+    }
+    return false;
+  }
+
+  uint64_t position = kHeaderSize;
+  std::vector<uint8_t> payload;
+  while (position + kBatchHeaderSize <= size) {
+    uint8_t header[kFrameHeaderSize];
+    if (!readAll(fd_, header, kFrameHeaderSize, position)) {
+      if (error) {
+        *error = ioError(path);
+      }
+      return false;
+    }
+    uint32_t payloadSize = readUint32(header);
+    uint64_t payloadStart = position + kFrameHeaderSize;
+    if (payloadSize < 4 || payloadSize > size - payloadStart) {
+      break;
+    }
+    payload.resize(payloadSize);
+    if (!readAll(fd_, payload.data(), payloadSize, payloadStart)) {
+      if (error) {
+        *error = ioError(path);
+      }
+      return false;
+    }
+    if (crc32(payload.data(), payloadSize) != readUint32(header + 4)) {
+      break;
+    }
+
+    // Checked whole before any record is applied
+    struct Record {
+      uint8_t type;
+      size_t key;
+      uint32_t keySize;
+      size_t value;
+      uint32_t valueSize;
+    };
+    std::vector<Record> records;
+    uint32_t count = readUint32(payload.data());
+    size_t cursor = 4;
+    bool valid = true;
+    for (uint32_t i = 0; i < count && valid; ++i) {
+      if (payloadSize - cursor < kRecordHeaderSize) {
+        valid = false;
+        break;
+      }
+      Record record;
+      record.type = payload[cursor];
+      record.keySize = readUint32(&payload[cursor + 1]);
+      record.valueSize = readUint32(&payload[cursor + 5]);
+      record.key = cursor + kRecordHeaderSize;
+      uint64_t end =
+          uint64_t(record.key) + record.keySize + record.valueSize;
+      valid = (record.type == kPut || record.type == kRemove) &&
+          end <= payloadSize;
+      record.value = record.key + record.keySize;
+      cursor = static_cast<size_t>(end);
+      records.push_back(record);
+    }
+    if (!valid || cursor != payloadSize) {
+      break;
+    }
+    for (const auto& record : records) {
+      apply(
+          record.type,
+          std::string(
+              reinterpret_cast<const char*>(&payload[record.key]),
+              record.keySize),
+          &payload[record.value],
+          record.valueSize,
+          payloadStart + record.value);
+    }
+    position = payloadStart + payloadSize;
+  }
+
+  if (position < size) {
+    // A batch torn by a crash, and whatever follows it
+    if (::ftruncate(fd_, static_cast<off_t>(position)) != 0 ||
+        ::fsync(fd_) != 0) {
+      if (error) {
+        *error = ioError(path);
+      }
+      return false;
+    }
+    droppedBytes_ = size - position;
+  }
+  logSize_ = position;
+  return true;
+}
+
+void SandboxKVStore::apply(
+    uint8_t type,
+    std::string&& key,
+    const uint8_t* value,
+    uint32_t size,
+    uint64_t offset) {
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    liveBytes_ -= recordBytes(it->first.size(), it->second.size);
+    if (type == kRemove) {
+      index_.erase(it);
+      return;
+    }
+  } else if (type == kRemove) {
+    return;
+  } else {
+    it = index_.emplace(std::move(key), Entry{}).first;
+  }
+  Entry& entry = it->second;
+  entry.offset = offset;
+  entry.size = size;
+  entry.cached = size <= options_.inlineValueLimit;
+  if (entry.cached) {
+    entry.value.assign(reinterpret_cast<const char*>(value), size);
+  } else {
+    entry.value.clear();
+    entry.value.shrink_to_fit();
+  }
+  liveBytes_ += recordBytes(it->first.size(), size);
+}
+
+bool SandboxKVStore::write(const KVBatch& batch, std::string* error) {
+  std::vector<std::string> errors;
+  if (append({&batch}, errors)) {
+    return true;
+  }
+  if (error) {
+    *error = errors.front();
+  }
+  return false;
+}
+
+bool SandboxKVStore::writeGroup(
+    const std::vector<KVBatch>& batches,
+    std::vector<std::string>& errors) {
+  std::vector<const KVBatch*> pointers;
+  pointers.reserve(batches.size());
+  for (const auto& batch : batches) {
+    pointers.push_back(&batch);
+  }
+  return append(pointers, errors);
+}
+
+bool SandboxKVStore::append(
+    const std::vector<const KVBatch*>& batches,
+    std::vector<std::string>& errors) {
+  errors.assign(batches.size(), std::string());
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // One frame per batch, written together
+  std::string group;
+  std::vector<size_t> frames;
+  std::vector<size_t> written;
+  bool encoded = true;
+  for (size_t i = 0; i < batches.size(); ++i) {
+    const KVBatch& batch = *batches[i];
+    if (batch.empty()) {
+      continue;
+    }
+    std::string frame(kBatchHeaderSize, '\0');
+    for (const auto& op : batch.ops) {
+      const std::string* value = op.value ? &*op.value : nullptr;
+      uint64_t size = recordBytes(op.key.size(), value ? value->size() : 0);
+      if (frame.size() + size >
+          std::numeric_limits<uint32_t>::max() - kFrameHeaderSize) {
+        errors[i] = "Batch is too large";
+        break;
+      }
+      appendRecord(
+          frame,
+          value ? kPut : kRemove,
+          op.key,
+          value ? value->data() : "",
+          value ? value->size() : 0);
+    }
+    if (!errors[i].empty()) {
+      encoded = false;
+      continue;
+    }
+    sealFrame(frame, static_cast<uint32_t>(batch.ops.size()));
+    frames.push_back(group.size());
+    written.push_back(i);
+    group += frame;
+  }
+  if (group.empty()) {
+    return encoded;
+  }
+
+  if (!writeAll(fd_, group.data(), group.size(), logSize_) ||
+      (options_.syncWrites && ::fsync(fd_) != 0)) {
+    std::string error = ioError(directory_ + "/" + kLogName);
+    for (size_t i : written) {
+      errors[i] = error;
+    }
+    // Replay would cut a partial batch off anyway
+    ::ftruncate(fd_, static_cast<off_t>(logSize_));
+    return false;
+  }
+  syncs_ += options_.syncWrites ? 1 : 0;
+  batches_ += written.size();
+
+  const auto* bytes = reinterpret_cast<const uint8_t*>(group.data());
+  for (size_t start : frames) {
+    applyFrame(bytes + start, logSize_ + start);
+  }
+  logSize_ += group.size();
+
+  if (compactionDue()) {
+    // The batches are durable either way; a failed compaction is retried
+    // after the next write
+    compactLocked(nullptr);
+  }
+  return encoded;
+}
+
+void SandboxKVStore::applyFrame(const uint8_t* frame, uint64_t offset) {
+  uint32_t count = readUint32(frame + kFrameHeaderSize);
+  size_t cursor = kBatchHeaderSize;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t keySize = readUint32(frame + cursor + 1);
+    uint32_t valueSize = readUint32(frame + cursor + 5);
+    size_t key = cursor + kRecordHeaderSize;
+    size_t value = key + keySize;
+    apply(
+        frame[cursor],
+        std::string(reinterpret_cast<const char*>(frame + key), keySize),
+        frame + value,
+        valueSize,
+        offset + value);
+    cursor = value + valueSize;
+  }
+}
+
+bool SandboxKVStore::readValue(
+    const Entry& entry,
+    std::string& value,
+    std::string* error) const {
+  if (entry.cached) {
+    value = entry.value;
+    return true;
+  }
+  value.resize(entry.size);
+  if (!readAll(
+          fd_,
+          reinterpret_cast<uint8_t*>(&value[0]),
+          entry.size,
+          entry.offset)) {
+    if (error) {
+      *error = ioError(directory_ + "/" + kLogName);
+    }
+    return false;
+  }
+  return true;
+}
+
+std::optional<std::string> SandboxKVStore::get(
+    const std::string& key,
+    std::string* error) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return std::nullopt;
+  }
+  std::string value;
+  if (!readValue(it->second, value, error)) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::vector<std::string> SandboxKVStore::keys() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> result;
+  result.reserve(index_.size());
+  for (const auto& [key, entry] : index_) {
+    result.push_back(key);
+  }
+  return result;
+}
+
+bool SandboxKVStore::clear(std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (::ftruncate(fd_, static_cast<off_t>(kHeaderSize)) != 0 ||
+      (options_.syncWrites && ::fsync(fd_) != 0)) {
+    if (error) {
+      *error = ioError(directory_ + "/" + kLogName);
+    }
+    return false;
+  }
+  index_.clear();
+  liveBytes_ = 0;
+  logSize_ = kHeaderSize;
+  return true;
+}
+
+bool SandboxKVStore::compact(std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return compactLocked(error);
+}
+
+bool SandboxKVStore::compactionDue() const {
+  uint64_t garbage = logSize_ - kHeaderSize - liveBytes_;
+  return garbage >= options_.compactMinBytes &&
+      static_cast<double>(garbage) >
+      static_cast<double>(liveBytes_) * options_.compactGarbageRatio;
+}
+
+bool SandboxKVStore::compactLocked(std::string* error) {
+  std::string path = directory_ + "/" + kLogName;
+  std::string compactPath = directory_ + "/" + kCompactName;
+  int fd =
+      ::open(compactPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    if (error) {
+      *error = ioError(compactPath);
+    }
+    return false;
+  }
+  auto fail = [&](const std::string& message) {
+    if (error) {
+      *error = message;
+    }
+    ::close(fd);
+    ::unlink(compactPath.c_str());
+    return false;
+  };
+
+  // Offsets of the values in the new log, applied once it replaces the old
+  std::vector<std::pair<Entry*, uint64_t>> moved;
+  moved.reserve(index_.size());
+  uint64_t size = kHeaderSize;
+  if (!writeAll(fd, kMagic, kHeaderSize, 0)) {
+    return fail(ioError(compactPath));
+  }
+
+  std::string frame;
+  uint32_t count = 0;
+  auto flush = [&]() {
+    if (count == 0) {
+      return true;
+    }
+    sealFrame(frame, count);
+    if (!writeAll(fd, frame.data(), frame.size(), size)) {
+      return false;
+    }
+    size += frame.size();
+    count = 0;
+    return true;
+  };
+  std::string value;
+  for (auto& [key, entry] : index_) {
+    if (count == 0) {
+      frame.assign(kBatchHeaderSize, '\0');
+    }
+    std::string readError;
+    if (!readValue(entry, value, &readError)) {
+      return fail(readError);
+    }
+    moved.emplace_back(
+        &entry, size + frame.size() + kRecordHeaderSize + key.size());
+    appendRecord(frame, kPut, key, value.data(), value.size());
+    ++count;
+    if (frame.size() >= kCompactBatchBytes && !flush()) {
+      return fail(ioError(compactPath));
+    }
+  }
+  if (!flush() || ::fsync(fd) != 0) {
+    return fail(ioError(compactPath));
+  }
+  if (::rename(compactPath.c_str(), path.c_str()) != 0) {
+    return fail(ioError(path));
+  }
+  // Makes the rename durable; the store is consistent without it
+  int directoryFd = ::open(directory_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (directoryFd >= 0) {
+    ::fsync(directoryFd);
+    ::close(directoryFd);
+  }
+
+  // The new file was opened read-write, so it takes over as the log
+  ::close(fd_);
+  fd_ = fd;
+  for (auto& [entry, offset] : moved) {
+    entry->offset = offset;
+  }
+  logSize_ = size;
+  ++compactions_;
+  return true;
+}
+
+KVStoreStats SandboxKVStore::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  KVStoreStats stats;
+  stats.keys = index_.size();
+  stats.liveBytes = liveBytes_;
+  stats.logBytes = logSize_;
+  stats.compactions = compactions_;
+  stats.batches = batches_;
+  stats.syncs = syncs_;
+  stats.droppedBytes = droppedBytes_;
+  return stats;
+}
+
+} // namespace rnsandbox
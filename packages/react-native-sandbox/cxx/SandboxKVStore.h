@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rnsandbox {
+
+/** Mutations applied to a SandboxKVStore together, in order. */
+struct KVBatch {
+  struct Op {
+    std::string key;
+    // nullopt removes the key
+    std::optional<std::string> value;
+  };
+
+  void put(std::string key, std::string value) {
+    ops.push_back({std::move(key), std::move(value)});
+  }
+
+  void remove(std::string key) {
+    ops.push_back({std::move(key), std::nullopt});
+  }
+
+  bool empty() const {
+    return ops.empty();
+  }
+
+  std::vector<Op> ops;
+};
+
+struct KVStoreOptions {
+  // fsync after each write; otherwise a crash may lose the latest batches,
+  // never tear one
+  bool syncWrites = true;
+  // Values up to this many bytes are kept in memory, larger ones are read
+  // back from the log
+  size_t inlineValueLimit = 1024;
+  // Compaction waits until the log holds this much garbage and at least
+  // compactGarbageRatio times the live data
+  uint64_t compactMinBytes = 1024 * 1024;
+  double compactGarbageRatio = 1.0;
+};
+
+struct KVStoreStats {
+  size_t keys = 0;
+  // Bytes of the records of live keys
+  uint64_t liveBytes = 0;
+  uint64_t logBytes = 0;
+  uint64_t compactions = 0;
+  // Batches written, and the fsyncs that made them durable; a group commit
+  // makes several batches durable with one
+  uint64_t batches = 0;
+  uint64_t syncs = 0;
+  // Torn or corrupt bytes cut off the log's tail when it was opened
+  uint64_t droppedBytes = 0;
+};
+
+/**
+ * A key-value store kept as an append-only log in one directory, for the
+ * sandboxed AsyncStorage modules. A write appends one checksummed batch, so
+ * its cost is that of the batch rather than the whole store; an index of
+ * every key's latest record is held in memory. Once superseded records
+ * outweigh the live ones, the live records are copied into a new log that
+ * replaces the old one.
+ *
+ *   "RNSKVLG1"
+ *   batches of
+ *     payload length (uint32 LE), CRC-32 of the payload (uint32 LE)
+ *     record count (uint32 LE), then per record
+ *       type (uint8, 1 put, 2 remove), key length, value length (uint32 LE)
+ *       key bytes, value bytes
+ *
+ * Opening the log replays it. A batch torn by a crash fails its checksum and
+ * is cut off with everything after it, so a write is all or nothing.
+ *
+ * writeGroup() commits several callers' batches with one write and one fsync,
+ * for modules that coalesce small writes; each batch stays atomic on its own.
+ *
+ * Thread-safe.
+ */
+class SandboxKVStore {
+ public:
+  static constexpr char kMagic[] = "RNSKVLG1";
+  static constexpr size_t kHeaderSize = 8;
+  static constexpr size_t kBatchHeaderSize = 3 * 4;
+  static constexpr size_t kRecordHeaderSize = 1 + 2 * 4;
+  static constexpr const char* kLogName = "data.log";
+  static constexpr const char* kCompactName = "data.log.compact";
+  static constexpr const char* kLockName = "data.lock";
+
+  /**
+   * Opens or creates the store in directory, creating the directory itself
+   * but not its parents. The store holds an exclusive flock() on a lock file
+   * in the directory until it is destroyed.
+   * @param error Set when nullptr is returned
+   * @return nullptr if the log cannot be read or is not a store log, or
+   * another store, in this process or another, has the directory open
+   */
+  static std::unique_ptr<SandboxKVStore> open(
+      const std::string& directory,
+      KVStoreOptions options = {},
+      std::string* error = nullptr);
+
+  /**
+   * Like open(), but every caller in the process that passes the same
+   * directory string gets the same store, which closes with its last handle.
+   * options only apply when the store is not open yet.
+   */
+  static std::shared_ptr<SandboxKVStore> openShared(
+      const std::string& directory,
+      KVStoreOptions options = {},
+      std::string* error = nullptr);
+
+  ~SandboxKVStore();
+  SandboxKVStore(const SandboxKVStore&) = delete;
+  SandboxKVStore& operator=(const SandboxKVStore&) = delete;
+
+  /**
+   * Appends batch and applies it, compacting the log if it is due.
+   * @return false if the batch could not be written; the store is unchanged
+   */
+  bool write(const KVBatch& batch, std::string* error = nullptr);
+
+  /**
+   * Appends and applies batches in order, making them durable together. A
+   * batch that cannot be encoded fails alone; an I/O error fails them all.
+   * @param errors Resized to batches, empty for each batch written
+   * @return false if any batch failed
+   */
+  bool writeGroup(
+      const std::vector<KVBatch>& batches,
+      std::vector<std::string>& errors);
+
+  /** @return nullopt if the key is absent or its value cannot be read */
+  std::optional<std::string> get(
+      const std::string& key,
+      std::string* error = nullptr) const;
+
+  /** Every key, in no particular order. */
+  std::vector<std::string> keys() const;
+
+  /** Removes every key. */
+  bool clear(std::string* error = nullptr);
+
+  /** Rewrites the log with only the live records, whether or not it is due. */
+  bool compact(std::string* error = nullptr);
+
+  KVStoreStats stats() const;
+
+ private:
+  struct Entry {
+    // Position of the value in the log
+    uint64_t offset;
+    uint32_t size;
+    bool cached;
+    std::string value;
+  };
+
+  SandboxKVStore(
+      std::string directory,
+      KVStoreOptions options,
+      int fd,
+      int lockFd);
+
+  bool replay(std::string* error);
+  bool append(
+      const std::vector<const KVBatch*>& batches,
+      std::vector<std::string>& errors);
+  void applyFrame(const uint8_t* frame, uint64_t offset);
+  void apply(
+      uint8_t type,
+      std::string&& key,
+      const uint8_t* value,
+      uint32_t size,
+      uint64_t offset);
+  bool readValue(const Entry& entry, std::string& value, std::string* error)
+      const;
+  bool compactLocked(std::string* error);
+  bool compactionDue() const;
+
+  const std::string directory_;
+  const KVStoreOptions options_;
+  int fd_;
+  const int lockFd_;
+  uint64_t logSize_ = kHeaderSize;
+  uint64_t liveBytes_ = 0;
+  uint64_t compactions_ = 0;
+  uint64_t batches_ = 0;
+  uint64_t syncs_ = 0;
+  uint64_t droppedBytes_ = 0;
+  std::unordered_map<std::string, Entry> index_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,234 @@
+#include "SandboxMemoryGovernor.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace rnsandbox {
+
+bool parseEvictionPolicy(const std::string& name, EvictionPolicy& policy) {
+  if (name == "never") {
+    policy = EvictionPolicy::Never;
+  } else if (name == "hibernate") {
+    policy = EvictionPolicy::Hibernate;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* toString(EvictionReason reason) {
+  switch (reason) {
+    case EvictionReason::HeapLimit:
+      return "heap limit exceeded";
+    case EvictionReason::MemoryPressure:
+      return "memory pressure";
+  }
+  return "";
+}
+
+SandboxMemoryGovernor& SandboxMemoryGovernor::getInstance() {
+  static SandboxMemoryGovernor instance;
+  return instance;
+}
+
+SandboxMemoryGovernor::SandboxId SandboxMemoryGovernor::add(Hooks hooks) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SandboxId id = nextId_++;
+  Entry& entry = entries_[id];
+  entry.hooks = std::move(hooks);
+  entry.lastUsed = ++useClock_;
+  return id;
+}
+
+void SandboxMemoryGovernor::remove(SandboxId id) {
+  Hooks hooks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+      return;
+    }
+    // Destroyed outside the lock, hooks may own platform objects
+    hooks = std::move(it->second.hooks);
+    entries_.erase(it);
+  }
+}
+
+void SandboxMemoryGovernor::setHeapLimit(SandboxId id, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it != entries_.end()) {
+    it->second.heapLimit = bytes;
+    it->second.collectionPending = false;
+  }
+}
+
+void SandboxMemoryGovernor::setEvictionPolicy(
+    SandboxId id,
+    EvictionPolicy policy) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it != entries_.end()) {
+    it->second.policy = policy;
+  }
+}
+
+void SandboxMemoryGovernor::touch(SandboxId id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it != entries_.end()) {
+    it->second.lastUsed = ++useClock_;
+  }
+}
+
+bool SandboxMemoryGovernor::shouldSample(SandboxId id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end()) {
+    return false;
+  }
+  auto now = Clock::now();
+  if (it->second.lastSample != Clock::time_point{} &&
+      now - it->second.lastSample < config_.sampleInterval) {
+    return false;
+  }
+  it->second.lastSample = now;
+  return true;
+}
+
+void SandboxMemoryGovernor::reportHeapUsage(
+    SandboxId id,
+    size_t bytes,
+    bool afterCollection) {
+  std::function<void()> collect;
+  std::function<void(EvictionReason, size_t)> evict;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+      return;
+    }
+    Entry& entry = it->second;
+    entry.heapBytes = bytes;
+    entry.resident = true;
+
+    if (entry.heapLimit == 0 || bytes <= entry.heapLimit) {
+      entry.collectionPending = false;
+    } else if (!entry.collectionPending) {
+      entry.collectionPending = true;
+      collect = entry.hooks.collectGarbage;
+      ++stats_.collections;
+    } else if (afterCollection) {
+      entry.collectionPending = false;
+      if (entry.policy != EvictionPolicy::Never) {
+        entry.resident = false;
+        evict = entry.hooks.evict;
+        ++stats_.evictions;
+      }
+    }
+  }
+
+  if (collect) {
+    collect();
+  }
+  if (evict) {
+    evict(EvictionReason::HeapLimit, bytes);
+  }
+}
+
+void SandboxMemoryGovernor::onMemoryPressure(MemoryPressureLevel level) {
+  std::vector<std::function<void()>> collections;
+  std::vector<std::pair<std::function<void(EvictionReason, size_t)>, size_t>>
+      evictions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.pressureEvents;
+
+    if (level == MemoryPressureLevel::Critical) {
+      std::vector<Entry*> candidates;
+      size_t residentHeap = 0;
+      size_t residentCount = 0;
+      for (auto& [id, entry] : entries_) {
+        if (!entry.resident) {
+          continue;
+        }
+        residentHeap += entry.heapBytes;
+        ++residentCount;
+        if (entry.policy != EvictionPolicy::Never) {
+          candidates.push_back(&entry);
+        }
+      }
+      std::sort(candidates.begin(), candidates.end(), [](auto* a, auto* b) {
+        return a->lastUsed < b->lastUsed;
+      });
+
+      for (Entry* entry : candidates) {
+        if (residentCount <= config_.minResidentSandboxes ||
+            (!evictions.empty() &&
+             residentHeap <= config_.criticalHeapBudget)) {
+          break;
+        }
+        residentHeap -= entry->heapBytes;
+        --residentCount;
+        entry->resident = false;
+        entry->collectionPending = false;
+        evictions.emplace_back(entry->hooks.evict, entry->heapBytes);
+        ++stats_.evictions;
+      }
+    }
+
+    // Sandboxes being evicted are released instead
+    for (auto& [id, entry] : entries_) {
+      if (entry.resident && entry.hooks.collectGarbage) {
+        collections.push_back(entry.hooks.collectGarbage);
+        ++stats_.collections;
+      }
+    }
+  }
+
+  for (auto& collect : collections) {
+    collect();
+  }
+  for (auto& [evict, heapBytes] : evictions) {
+    if (evict) {
+      evict(EvictionReason::MemoryPressure, heapBytes);
+    }
+  }
+}
+
+size_t SandboxMemoryGovernor::heapBytes(SandboxId id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  return it == entries_.end() ? 0 : it->second.heapBytes;
+}
+
+void SandboxMemoryGovernor::setConfig(const MemoryGovernorConfig& config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+}
+
+MemoryGovernorStats SandboxMemoryGovernor::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  MemoryGovernorStats stats = stats_;
+  for (const auto& [id, entry] : entries_) {
+    if (entry.resident) {
+      ++stats.residentSandboxes;
+      stats.residentHeapBytes += entry.heapBytes;
+    }
+  }
+  return stats;
+}
+
+void SandboxMemoryGovernor::reset() {
+  std::map<SandboxId, Entry> entries;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries.swap(entries_);
+    useClock_ = 0;
+    config_ = MemoryGovernorConfig();
+    stats_ = MemoryGovernorStats();
+  }
+}
+
+} // namespace rnsandbox
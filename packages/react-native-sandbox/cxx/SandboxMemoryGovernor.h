@@ -0,0 +1,156 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace rnsandbox {
+
+enum class MemoryPressureLevel {
+  // Android onTrimMemory RUNNING_MODERATE/LOW, BACKGROUND, MODERATE
+  Moderate,
+  // iOS memory warnings, Android RUNNING_CRITICAL, COMPLETE, onLowMemory
+  Critical,
+};
+
+/** What the governor may do to a sandbox to reclaim its heap. */
+enum class EvictionPolicy {
+  // Only garbage collection; the sandbox is never released
+  Never,
+  // Released through hibernation, so it can be resumed later
+  Hibernate,
+};
+
+/**
+ * Parses "never" or "hibernate".
+ * @return false, leaving policy untouched, for anything else
+ */
+bool parseEvictionPolicy(const std::string& name, EvictionPolicy& policy);
+
+enum class EvictionReason {
+  // Still above its heap limit after a forced collection
+  HeapLimit,
+  // Least recently used sandbox under critical memory pressure
+  MemoryPressure,
+};
+
+const char* toString(EvictionReason reason);
+
+struct MemoryGovernorConfig {
+  // Resident heap that critical pressure evicts down to
+  size_t criticalHeapBudget = 128 * 1024 * 1024;
+  // Critical pressure never evicts below this many resident sandboxes
+  size_t minResidentSandboxes = 1;
+  // Minimum time between two heap samples of one sandbox
+  std::chrono::milliseconds sampleInterval{1000};
+};
+
+struct MemoryGovernorStats {
+  size_t residentSandboxes = 0;
+  // Sum of the last sampled heap sizes of resident sandboxes
+  size_t residentHeapBytes = 0;
+  uint64_t pressureEvents = 0;
+  uint64_t collections = 0;
+  uint64_t evictions = 0;
+};
+
+/**
+ * Process-wide view of the sandboxes' JS heaps. Platforms report heap samples
+ * from each sandbox's JS thread and forward OS memory pressure; the governor
+ * decides which sandboxes collect garbage and which are evicted, and calls
+ * back into the platform through each sandbox's hooks.
+ *
+ * A sandbox above its heap limit is asked to collect garbage first and is
+ * evicted only if it is still above the limit afterwards. Under critical
+ * pressure every resident sandbox collects and the least recently used
+ * evictable ones are evicted, by their last sample, until the resident heap
+ * fits criticalHeapBudget. At least one is evicted if any is eligible, as the
+ * OS will not wait for the collections to finish.
+ *
+ * Thread-safe. Hooks are called without the governor's lock held.
+ */
+class SandboxMemoryGovernor {
+ public:
+  using SandboxId = uint64_t;
+
+  struct Hooks {
+    // Forces a collection on the sandbox's JS thread and reports the result
+    // with reportHeapUsage(..., true)
+    std::function<void()> collectGarbage;
+    // Releases the sandbox's runtime according to its eviction policy
+    std::function<void(EvictionReason reason, size_t heapBytes)> evict;
+  };
+
+  static SandboxMemoryGovernor& getInstance();
+
+  /** Starts tracking a sandbox, initially the most recently used one. */
+  SandboxId add(Hooks hooks);
+
+  void remove(SandboxId id);
+
+  /** Soft heap limit enforced from samples; 0 disables it. */
+  void setHeapLimit(SandboxId id, size_t bytes);
+
+  void setEvictionPolicy(SandboxId id, EvictionPolicy policy);
+
+  /** Marks the sandbox as used, e.g. on an incoming message. */
+  void touch(SandboxId id);
+
+  /**
+   * Whether a heap sample is due, i.e. sampleInterval has passed since the
+   * last one. Returns true at most once per interval.
+   */
+  bool shouldSample(SandboxId id);
+
+  /**
+   * Records a heap sample, marking the sandbox resident again if it had been
+   * evicted and its runtime was rebuilt.
+   * @param afterCollection The sample follows a collection the governor asked
+   * for, so a sandbox still above its limit is evicted
+   */
+  void reportHeapUsage(SandboxId id, size_t bytes, bool afterCollection);
+
+  /** The sandbox's last heap sample, 0 if it has none or is unknown. */
+  size_t heapBytes(SandboxId id) const;
+
+  void onMemoryPressure(MemoryPressureLevel level);
+
+  void setConfig(const MemoryGovernorConfig& config);
+  MemoryGovernorStats stats() const;
+
+  /** Forgets every sandbox and restores the default config. For tests. */
+  void reset();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    Hooks hooks;
+    EvictionPolicy policy = EvictionPolicy::Hibernate;
+    size_t heapLimit = 0;
+    size_t heapBytes = 0;
+    bool resident = true;
+    // Over the limit and waiting for the collection it was asked for
+    bool collectionPending = false;
+    uint64_t lastUsed = 0;
+    Clock::time_point lastSample{};
+  };
+
+  SandboxMemoryGovernor() = default;
+  SandboxMemoryGovernor(const SandboxMemoryGovernor&) = delete;
+  SandboxMemoryGovernor& operator=(const SandboxMemoryGovernor&) = delete;
+
+  std::map<SandboxId, Entry> entries_;
+  SandboxId nextId_ = 1;
+  // Logical clock for LRU order, bumped by add() and touch()
+  uint64_t useClock_ = 0;
+  MemoryGovernorConfig config_;
+  MemoryGovernorStats stats_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,82 @@
+#include "SandboxMessageQueue.h"
+#include <algorithm>
+
+namespace rnsandbox {
+
+SandboxMessageQueue::SandboxMessageQueue(
+    size_t batchSize,
+    size_t urgentBurstLimit)
+    : batchSize_(std::max<size_t>(batchSize, 1)),
+      urgentBurstLimit_(std::max<size_t>(urgentBurstLimit, 1)) {}
+
+bool SandboxMessageQueue::push(std::string message, MessagePriority priority) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Lane& lane = priority == MessagePriority::Urgent ? urgent_ : bulk_;
+  lane.messages.push_back(std::move(message));
+  lane.stats.enqueued++;
+  lane.stats.depth = lane.messages.size();
+  lane.stats.maxDepth = std::max(lane.stats.maxDepth, lane.stats.depth);
+
+  if (drainScheduled_) {
+    return false;
+  }
+  drainScheduled_ = true;
+  return true;
+}
+
+bool SandboxMessageQueue::drain(
+    const std::function<void(std::string&&)>& deliver) {
+  std::string message;
+  for (size_t i = 0; i < batchSize_; ++i) {
+    // One pop per lock so an urgent push during delivery is picked next
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!popNext(message)) {
+        break;
+      }
+    }
+    deliver(std::move(message));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (urgent_.messages.empty() && bulk_.messages.empty()) {
+    drainScheduled_ = false;
+    return false;
+  }
+  return true;
+}
+
+bool SandboxMessageQueue::popNext(std::string& message) {
+  bool bulkWaiting = !bulk_.messages.empty();
+  bool takeUrgent = !urgent_.messages.empty() &&
+      (!bulkWaiting || urgentStreak_ < urgentBurstLimit_);
+  if (!takeUrgent && !bulkWaiting) {
+    return false;
+  }
+
+  Lane& lane = takeUrgent ? urgent_ : bulk_;
+  urgentStreak_ = takeUrgent && bulkWaiting ? urgentStreak_ + 1 : 0;
+  message = std::move(lane.messages.front());
+  lane.messages.pop_front();
+  lane.stats.depth = lane.messages.size();
+  lane.stats.delivered++;
+  return true;
+}
+
+MessageQueueStats SandboxMessageQueue::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return {urgent_.stats, bulk_.stats};
+}
+
+void SandboxMessageQueue::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  urgent_.messages.clear();
+  bulk_.messages.clear();
+  urgent_.stats.depth = 0;
+  bulk_.stats.depth = 0;
+  urgentStreak_ = 0;
+  drainScheduled_ = false;
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include "MessagePriority.h"
+
+namespace rnsandbox {
+
+struct MessageLaneStats {
+  size_t depth = 0;
+  size_t maxDepth = 0;
+  uint64_t enqueued = 0;
+  uint64_t delivered = 0;
+};
+
+struct MessageQueueStats {
+  MessageLaneStats urgent;
+  MessageLaneStats bulk;
+};
+
+/**
+ * Inbound message queue of one sandbox with separate urgent and bulk lanes.
+ *
+ * Producers on any thread push(); the sandbox JS thread runs drain() from a
+ * single scheduled task. Each drain delivers at most `batchSize` messages and
+ * then yields the JS thread, so urgent messages that arrive during a long
+ * bulk transfer overtake it at the next batch boundary. To keep bulk from
+ * starving under sustained urgent load, one bulk message is delivered after
+ * every `urgentBurstLimit` consecutive urgent ones while bulk is waiting.
+ */
+class SandboxMessageQueue {
+ public:
+  static constexpr size_t kDefaultBatchSize = 32;
+  static constexpr size_t kDefaultUrgentBurstLimit = 8;
+
+  explicit SandboxMessageQueue(
+      size_t batchSize = kDefaultBatchSize,
+      size_t urgentBurstLimit = kDefaultUrgentBurstLimit);
+
+  /**
+   * Enqueues a message.
+   * @return true if no drain is pending and the caller must schedule one
+   */
+  bool push(std::string message, MessagePriority priority);
+
+  /**
+   * Delivers up to one batch of messages in service order. The handler runs
+   * without the queue lock held and may push() re-entrantly.
+   * @return true if messages remain and another drain must be scheduled
+   */
+  bool drain(const std::function<void(std::string&&)>& deliver);
+
+  MessageQueueStats stats() const;
+
+  /** Drops queued messages, e.g. when scheduling the drain failed. */
+  void clear();
+
+ private:
+  struct Lane {
+    std::deque<std::string> messages;
+    MessageLaneStats stats;
+  };
+
+  bool popNext(std::string& message);
+
+  const size_t batchSize_;
+  const size_t urgentBurstLimit_;
+  Lane urgent_;
+  Lane bulk_;
+  size_t urgentStreak_ = 0;
+  bool drainScheduled_ = false;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
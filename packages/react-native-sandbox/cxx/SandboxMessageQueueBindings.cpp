@@ -0,0 +1,79 @@
+#include "SandboxMessageQueueBindings.h"
+#include "SandboxJSIUtils.h"
+
+#include <algorithm>
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+jsi::Object laneStatsToJS(jsi::Runtime& rt, const MessageLaneStats& stats) {
+  jsi::Object lane(rt);
+  lane.setProperty(rt, "depth", static_cast<double>(stats.depth));
+  lane.setProperty(rt, "maxDepth", static_cast<double>(stats.maxDepth));
+  lane.setProperty(rt, "enqueued", static_cast<double>(stats.enqueued));
+  lane.setProperty(rt, "delivered", static_cast<double>(stats.delivered));
+  return lane;
+}
+
+} // namespace
+
+PostMessageOptions parsePostMessageOptions(
+    jsi::Runtime& runtime,
+    const jsi::Value& options) {
+  PostMessageOptions result;
+  if (options.isUndefined() || options.isNull()) {
+    return result;
+  }
+  if (!options.isObject()) {
+    throw jsi::JSError(runtime, "postMessage: options must be an object");
+  }
+  jsi::Object object = options.asObject(runtime);
+
+  jsi::Value priorityVal = object.getProperty(runtime, "priority");
+  if (!priorityVal.isUndefined() &&
+      (!priorityVal.isString() ||
+       !parseMessagePriority(
+           priorityVal.getString(runtime).utf8(runtime), result.priority))) {
+    throw jsi::JSError(
+        runtime, "postMessage: priority must be 'urgent' or 'bulk'");
+  }
+
+  jsi::Value ttlVal = object.getProperty(runtime, "ttlMs");
+  if (!ttlVal.isUndefined()) {
+    if (!ttlVal.isNumber() || !(ttlVal.getNumber() >= 0)) {
+      throw jsi::JSError(
+          runtime, "postMessage: ttlMs must be a non-negative number");
+    }
+    result.ttl = std::chrono::milliseconds(
+        static_cast<int64_t>(std::min(ttlVal.getNumber(), 1e12)));
+  }
+  return result;
+}
+
+void installMessageQueueBindings(
+    jsi::Runtime& runtime,
+    std::weak_ptr<SandboxMessageQueue> queue) {
+  auto getMessageQueueStats = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "getMessageQueueStats"),
+      0,
+      [queue](jsi::Runtime& rt, const jsi::Value&, const jsi::Value*, size_t)
+          -> jsi::Value {
+        auto strongQueue = queue.lock();
+        MessageQueueStats stats =
+            strongQueue ? strongQueue->stats() : MessageQueueStats();
+
+        jsi::Object result(rt);
+        result.setProperty(rt, "urgent", laneStatsToJS(rt, stats.urgent));
+        result.setProperty(rt, "bulk", laneStatsToJS(rt, stats.bulk));
+        return result;
+      });
+
+  defineSandboxGlobal(
+      runtime, "getMessageQueueStats", std::move(getMessageQueueStats));
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <chrono>
+#include <memory>
+#include "SandboxMessageQueue.h"
+
+namespace rnsandbox {
+
+struct PostMessageOptions {
+  MessagePriority priority = MessagePriority::Bulk;
+  // How long to hold the message if the target origin is not registered
+  // yet. Zero means fail immediately.
+  std::chrono::milliseconds ttl{0};
+};
+
+/**
+ * Reads a postMessage options argument: `{ priority, ttlMs }` where priority
+ * is 'urgent' or 'bulk' (default) and ttlMs a non-negative number. Missing
+ * options select the defaults. Throws a JSError for anything else.
+ */
+PostMessageOptions parsePostMessageOptions(
+    facebook::jsi::Runtime& runtime,
+    const facebook::jsi::Value& options);
+
+/**
+ * Installs `getMessageQueueStats()` into a sandbox runtime. It returns the
+ * per-lane depth, high-water mark and enqueued/delivered counters of the
+ * sandbox's inbound queue: `{ urgent: {...}, bulk: {...} }`.
+ */
+void installMessageQueueBindings(
+    facebook::jsi::Runtime& runtime,
+    std::weak_ptr<SandboxMessageQueue> queue);
+
+} // namespace rnsandbox
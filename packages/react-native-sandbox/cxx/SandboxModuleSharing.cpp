@@ -0,0 +1,146 @@
+#include "SandboxModuleSharing.h"
+
+namespace rnsandbox {
+
+namespace {
+
+thread_local const SandboxContext* currentContext = nullptr;
+
+} // namespace
+
+const char* toString(ModuleSharing sharing) {
+  switch (sharing) {
+    case ModuleSharing::PerSandbox:
+      return "perSandbox";
+    case ModuleSharing::PerOrigin:
+      return "perOrigin";
+    case ModuleSharing::PerGroup:
+      return "perGroup";
+    case ModuleSharing::PerProcess:
+      return "perProcess";
+  }
+  return "perSandbox";
+}
+
+std::string moduleSharingScope(
+    ModuleSharing sharing,
+    const SandboxContext& context,
+    const std::string& group) {
+  switch (sharing) {
+    case ModuleSharing::PerSandbox:
+      return "";
+    case ModuleSharing::PerGroup:
+      if (!group.empty()) {
+        return "group:" + group;
+      }
+      [[fallthrough]];
+    case ModuleSharing::PerOrigin:
+      return context.origin.empty() ? "" : "origin:" + context.origin;
+    case ModuleSharing::PerProcess:
+      return "process";
+  }
+  return "";
+}
+
+SandboxContextScope::SandboxContextScope(const SandboxContext* context)
+    : previous_(currentContext) {
+  currentContext = context;
+}
+
+SandboxContextScope::~SandboxContextScope() {
+  currentContext = previous_;
+}
+
+const SandboxContext* SandboxContextScope::current() {
+  return currentContext;
+}
+
+SharedModuleRegistry& SharedModuleRegistry::getInstance() {
+  static SharedModuleRegistry instance;
+  return instance;
+}
+
+SharedModuleRegistry::Handle SharedModuleRegistry::acquire(
+    const std::string& module,
+    const std::string& scope,
+    const Factory& factory) {
+  if (scope.empty()) {
+    return factory ? factory() : nullptr;
+  }
+  Key key{module, scope};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      ++it->second.users;
+      ++reused_;
+      return it->second.instance;
+    }
+  }
+  if (!factory) {
+    return nullptr;
+  }
+  // Created unlocked: a module's initializer may take a while, or resolve
+  // other modules
+  Handle created = factory();
+  if (!created) {
+    return nullptr;
+  }
+  // Declared before the lock, so a losing instance is dropped after it
+  Handle discarded;
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entries_[key];
+  if (entry.instance) {
+    ++reused_;
+    discarded = std::move(created);
+  } else {
+    entry.instance = std::move(created);
+  }
+  ++entry.users;
+  return entry.instance;
+}
+
+bool SharedModuleRegistry::release(
+    const std::string& module,
+    const std::string& scope) {
+  Handle dropped;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find({module, scope});
+  if (it == entries_.end()) {
+    return false;
+  }
+  if (--it->second.users > 0) {
+    return false;
+  }
+  dropped = std::move(it->second.instance);
+  entries_.erase(it);
+  return true;
+}
+
+size_t SharedModuleRegistry::users(
+    const std::string& module,
+    const std::string& scope) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find({module, scope});
+  return it == entries_.end() ? 0 : it->second.users;
+}
+
+ModuleSharingStats SharedModuleRegistry::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ModuleSharingStats stats;
+  stats.instances = entries_.size();
+  for (const auto& [key, entry] : entries_) {
+    stats.users += entry.users;
+  }
+  stats.reused = reused_;
+  return stats;
+}
+
+void SharedModuleRegistry::reset() {
+  std::map<Key, Entry> dropped;
+  std::lock_guard<std::mutex> lock(mutex_);
+  dropped.swap(entries_);
+  reused_ = 0;
+}
+
+} // namespace rnsandbox
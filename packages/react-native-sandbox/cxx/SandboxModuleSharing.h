@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "ISandboxAwareModule.h"
+
+namespace rnsandbox {
+
+const char* toString(ModuleSharing sharing);
+
+/**
+ * The key under which sandboxes share an instance, e.g. "origin:<origin>".
+ * Empty for PerSandbox, and for PerOrigin without an origin: sandboxes
+ * without one are unrelated. PerGroup without a group shares per origin.
+ */
+std::string moduleSharingScope(
+    ModuleSharing sharing,
+    const SandboxContext& context,
+    const std::string& group = "");
+
+/**
+ * Marks the sandbox a shared module's method runs for, for the duration of
+ * the call. Scopes nest and are per thread.
+ */
+class SandboxContextScope {
+ public:
+  explicit SandboxContextScope(const SandboxContext* context);
+  ~SandboxContextScope();
+
+  SandboxContextScope(const SandboxContextScope&) = delete;
+  SandboxContextScope& operator=(const SandboxContextScope&) = delete;
+
+  /** The innermost context on this thread, nullptr outside of any call. */
+  static const SandboxContext* current();
+
+ private:
+  const SandboxContext* previous_;
+};
+
+struct ModuleSharingStats {
+  // Shared instances alive
+  size_t instances = 0;
+  // Sandboxes holding them
+  size_t users = 0;
+  // Acquisitions served by an existing instance
+  uint64_t reused = 0;
+};
+
+/**
+ * Instances of substituted modules shared between sandboxes, keyed by the
+ * resolved module name and a scope from moduleSharingScope(). Each sandbox
+ * acquires the instance when it resolves the module and releases it when it
+ * tears down; the instance is dropped with its last user.
+ *
+ * Instances are type-erased so that each platform stores its own objects.
+ * Thread-safe. Factories run and instances are dropped without the lock
+ * held.
+ */
+class SharedModuleRegistry {
+ public:
+  using Handle = std::shared_ptr<void>;
+  using Factory = std::function<Handle()>;
+
+  static SharedModuleRegistry& getInstance();
+
+  /**
+   * The instance shared under scope, created by factory if there is none.
+   * If two sandboxes create one at once, the first stored wins and the
+   * other's is discarded. Every acquisition that returns an instance must be
+   * balanced by release(). An empty scope returns factory()'s instance
+   * without sharing it.
+   *
+   * @param factory May be empty, or return nullptr, to only look up
+   * @return The instance, nullptr if there is none and none was created
+   */
+  Handle acquire(
+      const std::string& module,
+      const std::string& scope,
+      const Factory& factory);
+
+  /** acquire() for C++ modules sharing state of type T. */
+  template <typename T>
+  std::shared_ptr<T> acquireAs(
+      const std::string& module,
+      const std::string& scope,
+      const std::function<std::shared_ptr<T>()>& factory) {
+    return std::static_pointer_cast<T>(
+        acquire(module, scope, [&factory]() -> Handle { return factory(); }));
+  }
+
+  /** @return true if this was the last user and the instance was dropped */
+  bool release(const std::string& module, const std::string& scope);
+
+  /** Sandboxes holding the instance under scope. */
+  size_t users(const std::string& module, const std::string& scope) const;
+
+  ModuleSharingStats stats() const;
+
+  /** Drops every instance. For tests. */
+  void reset();
+
+ private:
+  using Key = std::pair<std::string, std::string>;
+
+  struct Entry {
+    Handle instance;
+    size_t users = 0;
+  };
+
+  std::map<Key, Entry> entries_;
+  uint64_t reused_ = 0;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,53 @@
+#include "SandboxPresence.h"
+#include "SandboxRegistry.h"
+
+namespace rnsandbox {
+
+const char* presenceStatusName(PresenceStatus status) {
+  return status == PresenceStatus::Online ? "online" : "offline";
+}
+
+SandboxPresenceObserver::SandboxPresenceObserver(
+    std::string origin,
+    Listener listener)
+    : origin_(std::move(origin)), listener_(std::move(listener)) {}
+
+void SandboxPresenceObserver::setEnabled(bool enabled) {
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool SandboxPresenceObserver::isEnabled() const {
+  return enabled_.load(std::memory_order_relaxed);
+}
+
+std::vector<std::string> SandboxPresenceObserver::onlinePeers() const {
+  auto& registry = SandboxRegistry::getInstance();
+  std::vector<std::string> peers;
+  for (auto& origin : registry.registeredOrigins()) {
+    if (origin != origin_ && registry.isPermittedFrom(origin_, origin)) {
+      peers.push_back(std::move(origin));
+    }
+  }
+  return peers;
+}
+
+void SandboxPresenceObserver::onSandboxRegistered(const std::string& origin) {
+  notify(origin, PresenceStatus::Online);
+}
+
+void SandboxPresenceObserver::onSandboxUnregistered(
+    const std::string& origin) {
+  notify(origin, PresenceStatus::Offline);
+}
+
+void SandboxPresenceObserver::notify(
+    const std::string& peer,
+    PresenceStatus status) {
+  if (!isEnabled() || peer == origin_ ||
+      !SandboxRegistry::getInstance().isPermittedFrom(origin_, peer)) {
+    return;
+  }
+  listener_(peer, status);
+}
+
+} // namespace rnsandbox
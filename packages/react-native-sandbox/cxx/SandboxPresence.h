@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ISandboxRegistryObserver.h"
+
+namespace rnsandbox {
+
+enum class PresenceStatus { Online, Offline };
+
+/** 'online' or 'offline', as exposed to JS. */
+const char* presenceStatusName(PresenceStatus status);
+
+/**
+ * Registry observer owned by one sandbox. It forwards online/offline changes
+ * of the origins that sandbox may message (its allowedOrigins) and ignores
+ * everything else, including the sandbox's own registration.
+ *
+ * Disabled until setEnabled(true), so sandboxes that never subscribe cost
+ * nothing beyond the registry's observer walk. The listener runs on the
+ * thread that changed the registry.
+ */
+class SandboxPresenceObserver : public ISandboxRegistryObserver {
+ public:
+  using Listener =
+      std::function<void(const std::string& origin, PresenceStatus status)>;
+
+  SandboxPresenceObserver(std::string origin, Listener listener);
+
+  void setEnabled(bool enabled);
+
+  bool isEnabled() const;
+
+  /** Registered origins this sandbox may message, excluding itself. */
+  std::vector<std::string> onlinePeers() const;
+
+  void onSandboxRegistered(const std::string& origin) override;
+
+  void onSandboxUnregistered(const std::string& origin) override;
+
+ private:
+  void notify(const std::string& peer, PresenceStatus status);
+
+  const std::string origin_;
+  const Listener listener_;
+  std::atomic<bool> enabled_{false};
+};
+
+} // namespace rnsandbox
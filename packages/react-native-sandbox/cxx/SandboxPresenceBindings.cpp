@@ -0,0 +1,127 @@
+#include "SandboxPresenceBindings.h"
+#include "SandboxJSIUtils.h"
+#include "SandboxPresence.h"
+#include "SandboxRegistry.h"
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+// Per-runtime state touched only on the owning sandbox's JS thread, except
+// for the observer which is thread-safe. Owned by the installed host
+// functions, so it lives exactly as long as the runtime.
+struct PresenceJSState {
+  std::shared_ptr<jsi::Function> handler;
+  std::shared_ptr<SandboxPresenceObserver> observer;
+
+  ~PresenceJSState() {
+    SandboxRegistry::getInstance().removeObserver(observer);
+  }
+};
+
+void deliverPresence(
+    jsi::Runtime& rt,
+    PresenceJSState& state,
+    const std::string& origin,
+    PresenceStatus status) {
+  if (!state.handler) {
+    return;
+  }
+  jsi::Object event(rt);
+  event.setProperty(rt, "origin", jsi::String::createFromUtf8(rt, origin));
+  event.setProperty(
+      rt,
+      "status",
+      jsi::String::createFromAscii(rt, presenceStatusName(status)));
+  try {
+    state.handler->call(rt, event);
+  } catch (const jsi::JSError& e) {
+    reportJSError(rt, e);
+  }
+}
+
+} // namespace
+
+void installPresenceBindings(
+    jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    SandboxJSHandlers& handlers) {
+  auto state = std::make_shared<PresenceJSState>();
+  std::weak_ptr<PresenceJSState> weakState = state;
+  state->observer = std::make_shared<SandboxPresenceObserver>(
+      origin,
+      [weakState, delegate = std::move(delegate)](
+          const std::string& peer, PresenceStatus status) {
+        auto strongDelegate = delegate.lock();
+        if (!strongDelegate) {
+          return;
+        }
+        strongDelegate->scheduleOnJSThread(
+            [weakState, peer, status](jsi::Runtime& rt) {
+              if (auto strongState = weakState.lock()) {
+                deliverPresence(rt, *strongState, peer, status);
+              }
+            });
+      });
+  SandboxRegistry::getInstance().addObserver(state->observer);
+  handlers.add([weakState]() {
+    if (auto strongState = weakState.lock()) {
+      strongState->handler.reset();
+      strongState->observer->setEnabled(false);
+    }
+  });
+
+  auto setPresenceHandler = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "setPresenceHandler"),
+      1,
+      [state](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count != 1) {
+          throw jsi::JSError(
+              rt,
+              "setPresenceHandler(handler): expected exactly one argument");
+        }
+        if (args[0].isNull() || args[0].isUndefined()) {
+          state->handler.reset();
+          state->observer->setEnabled(false);
+          return jsi::Value::undefined();
+        }
+        if (!args[0].isObject() || !args[0].asObject(rt).isFunction(rt)) {
+          throw jsi::JSError(
+              rt, "setPresenceHandler: handler must be a function or null");
+        }
+        state->handler = std::make_shared<jsi::Function>(
+            args[0].asObject(rt).asFunction(rt));
+        state->observer->setEnabled(true);
+        return jsi::Value::undefined();
+      });
+
+  auto getOnlineSandboxes = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "getOnlineSandboxes"),
+      0,
+      [state](jsi::Runtime& rt, const jsi::Value&, const jsi::Value*, size_t)
+          -> jsi::Value {
+        auto peers = state->observer->onlinePeers();
+        jsi::Array result(rt, peers.size());
+        for (size_t i = 0; i < peers.size(); ++i) {
+          result.setValueAtIndex(
+              rt, i, jsi::String::createFromUtf8(rt, peers[i]));
+        }
+        return result;
+      });
+
+  defineSandboxGlobal(
+      runtime, "setPresenceHandler", std::move(setPresenceHandler));
+  defineSandboxGlobal(
+      runtime, "getOnlineSandboxes", std::move(getOnlineSandboxes));
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include <string>
+#include "ISandboxDelegate.h"
+#include "SandboxJSHandlers.h"
+
+namespace rnsandbox {
+
+/**
+ * Installs the presence globals into a sandbox runtime:
+ *
+ *   setPresenceHandler(({ origin, status }) => void | null)
+ *   getOnlineSandboxes() => string[]
+ *
+ * status is 'online' or 'offline'. Only origins listed in the sandbox's
+ * allowedOrigins are reported, and events are pushed from SandboxRegistry
+ * only while a handler is set.
+ *
+ * @param runtime The sandbox runtime, on its JS thread
+ * @param origin Origin of the sandbox owning the runtime
+ * @param delegate Registry delegate used to schedule work on the JS thread
+ * @param handlers Receives the reset of the presence handler
+ */
+void installPresenceBindings(
+    facebook::jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    SandboxJSHandlers& handlers);
+
+} // namespace rnsandbox
@@ -0,0 +1,273 @@
+#include "SandboxRealm.h"
+
+#include <utility>
+
+#include "SandboxRegistry.h"
+
+namespace rnsandbox {
+
+SandboxRealm::SandboxRealm(
+    RealmConfig config,
+    std::weak_ptr<ISandboxDelegate> host)
+    : config_(std::move(config)), host_(std::move(host)) {}
+
+std::string SandboxRealm::origin() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return config_.origin;
+}
+
+RealmConfig SandboxRealm::config() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return config_;
+}
+
+std::string SandboxRealm::resolveModule(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string resolved;
+  auto substitution = config_.turboModuleSubstitutions.find(name);
+  if (substitution != config_.turboModuleSubstitutions.end()) {
+    resolved = substitution->second;
+  } else if (config_.allowedTurboModules.count(name)) {
+    resolved = name;
+  }
+  return config_.hostConfiguredModules.count(resolved) ? "" : resolved;
+}
+
+RealmRouteResult SandboxRealm::route(
+    const std::string& message,
+    const std::string& targetOrigin,
+    MessagePriority priority,
+    std::chrono::milliseconds ttl) {
+  std::string source = origin();
+  if (targetOrigin == source) {
+    return RealmRouteResult::SelfTarget;
+  }
+  auto& registry = SandboxRegistry::getInstance();
+  auto targets = registry.findAll(targetOrigin);
+  if (targets.empty()) {
+    // Held for a target that has not mounted yet, as for a sandbox view
+    if (ttl.count() > 0 && registry.isPermittedFrom(source, targetOrigin) &&
+        registry.holdMessage(targetOrigin, message, priority, ttl)) {
+      return RealmRouteResult::Held;
+    }
+    return RealmRouteResult::NotFound;
+  }
+  if (!registry.isPermittedFrom(source, targetOrigin)) {
+    return RealmRouteResult::Denied;
+  }
+  for (const auto& target : targets) {
+    target->postMessage(message, priority);
+  }
+  return RealmRouteResult::Delivered;
+}
+
+bool SandboxRealm::postToHost(
+    const std::string& message,
+    MessagePriority priority) {
+  auto host = host_.lock();
+  if (!host) {
+    return false;
+  }
+  host->postMessage(message, priority);
+  return true;
+}
+
+void SandboxRealm::attach(Deliver deliver) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deliver_ = std::make_shared<Deliver>(std::move(deliver));
+  }
+  // Delivers what arrived while the realm was starting
+  scheduleDrain();
+}
+
+void SandboxRealm::detach() {
+  std::shared_ptr<Deliver> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dropped = std::move(deliver_);
+  }
+  inbox_.clear();
+}
+
+void SandboxRealm::setErrorHandler(ErrorHandler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  errorHandler_ =
+      handler ? std::make_shared<ErrorHandler>(std::move(handler)) : nullptr;
+}
+
+bool SandboxRealm::reportError(
+    const std::string& name,
+    const std::string& message,
+    const std::string& stack) {
+  std::shared_ptr<ErrorHandler> handler;
+  std::string source;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    handler = errorHandler_;
+    source = config_.origin;
+  }
+  if (!handler) {
+    return false;
+  }
+  (*handler)(source, name, message, stack);
+  return true;
+}
+
+void SandboxRealm::postMessage(
+    const std::string& message,
+    MessagePriority priority) {
+  bool needsDrain = inbox_.push(message, priority);
+  bool attached;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    attached = deliver_ != nullptr;
+  }
+  // Before attach() the messages wait for the drain it schedules
+  if (needsDrain && attached) {
+    scheduleDrain();
+  }
+}
+
+bool SandboxRealm::routeMessage(
+    const std::string& message,
+    const std::string& targetId,
+    MessagePriority priority) {
+  return route(message, targetId, priority) == RealmRouteResult::Delivered;
+}
+
+void SandboxRealm::setOrigin(const std::string&) {
+  // Fixed: the realm set and the registry know the realm by its origin
+}
+
+void SandboxRealm::setAllowedOrigins(const std::set<std::string>& origins) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_.allowedOrigins = origins;
+}
+
+void SandboxRealm::setAllowedTurboModules(
+    const std::set<std::string>& modules) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_.allowedTurboModules = modules;
+}
+
+bool SandboxRealm::scheduleOnJSThread(
+    std::function<void(facebook::jsi::Runtime&)> work) {
+  auto host = host_.lock();
+  return host && host->scheduleOnJSThread(std::move(work));
+}
+
+void SandboxRealm::scheduleDrain() {
+  std::weak_ptr<SandboxRealm> weakSelf = weak_from_this();
+  bool scheduled =
+      scheduleOnJSThread([weakSelf](facebook::jsi::Runtime& runtime) {
+        if (auto self = weakSelf.lock()) {
+          self->drain(runtime);
+        }
+      });
+  if (!scheduled) {
+    inbox_.clear();
+  }
+}
+
+void SandboxRealm::drain(facebook::jsi::Runtime& runtime) {
+  std::shared_ptr<Deliver> deliver;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deliver = deliver_;
+  }
+  if (!deliver) {
+    return;
+  }
+  bool more = inbox_.drain([&](std::string&& message) {
+    (*deliver)(runtime, std::move(message));
+  });
+  if (more) {
+    scheduleDrain();
+  }
+}
+
+SandboxRealmSet::SandboxRealmSet(std::weak_ptr<ISandboxDelegate> host)
+    : host_(std::move(host)) {}
+
+SandboxRealmSet::~SandboxRealmSet() {
+  clear();
+}
+
+std::shared_ptr<SandboxRealm> SandboxRealmSet::add(RealmConfig config) {
+  if (config.origin.empty()) {
+    return nullptr;
+  }
+  std::shared_ptr<SandboxRealm> realm;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = realms_[config.origin];
+    if (slot) {
+      return nullptr;
+    }
+    slot = std::make_shared<SandboxRealm>(config, host_);
+    realm = slot;
+    if (errorHandler_) {
+      realm->setErrorHandler(errorHandler_);
+    }
+  }
+  SandboxRegistry::getInstance().registerSandbox(
+      config.origin, realm, config.allowedOrigins);
+  return realm;
+}
+
+bool SandboxRealmSet::remove(const std::string& origin) {
+  std::shared_ptr<SandboxRealm> realm;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = realms_.find(origin);
+    if (it == realms_.end()) {
+      return false;
+    }
+    realm = std::move(it->second);
+    realms_.erase(it);
+  }
+  SandboxRegistry::getInstance().unregisterDelegate(origin, realm);
+  realm->detach();
+  return true;
+}
+
+std::shared_ptr<SandboxRealm> SandboxRealmSet::find(
+    const std::string& origin) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = realms_.find(origin);
+  return it == realms_.end() ? nullptr : it->second;
+}
+
+std::vector<std::string> SandboxRealmSet::origins() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> result;
+  result.reserve(realms_.size());
+  for (const auto& [origin, realm] : realms_) {
+    result.push_back(origin);
+  }
+  return result;
+}
+
+void SandboxRealmSet::setErrorHandler(SandboxRealm::ErrorHandler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  errorHandler_ = std::move(handler);
+  for (const auto& [origin, realm] : realms_) {
+    realm->setErrorHandler(errorHandler_);
+  }
+}
+
+void SandboxRealmSet::clear() {
+  std::map<std::string, std::shared_ptr<SandboxRealm>> realms;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    realms.swap(realms_);
+  }
+  auto& registry = SandboxRegistry::getInstance();
+  for (const auto& [origin, realm] : realms) {
+    registry.unregisterDelegate(origin, realm);
+    realm->detach();
+  }
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "ISandboxDelegate.h"
+#include "SandboxMessageQueue.h"
+
+namespace rnsandbox {
+
+/** An origin to run as a realm in another sandbox's runtime. */
+struct RealmConfig {
+  std::string origin;
+  // Path or URL of the realm's JavaScript source, resolved by the platform
+  std::string bundleSource;
+  // Origins the realm may exchange messages with, as for a sandbox view
+  std::set<std::string> allowedOrigins;
+  // Modules the realm's code may load. A realm narrows its host's modules:
+  // each must also be available in the host runtime.
+  std::set<std::string> allowedTurboModules;
+  // Module names the realm requests, to the names loaded in their place
+  std::map<std::string, std::string> turboModuleSubstitutions;
+  // Host modules configured for the host's origin, such as its sandbox-aware
+  // substitutes. Filled in by the platform, not by props: the realm may not
+  // load them, since they would act with the host's origin.
+  std::set<std::string> hostConfiguredModules;
+};
+
+enum class RealmRouteResult {
+  Delivered,
+  // Held in the registry mailbox until the target registers
+  Held,
+  NotFound,
+  Denied,
+  SelfTarget,
+};
+
+/**
+ * One origin running in the runtime of another sandbox, its host, in a global
+ * scope object of its own instead of a runtime of its own. Registered in
+ * SandboxRegistry like a sandbox view, so messages and access checks treat it
+ * as a separate origin; it runs its JS on the host's JS thread.
+ *
+ * Realms trade isolation for density: they share the host's heap, builtins
+ * and native module instances, so only trusted code should run in them. The
+ * realm's policy shapes the bindings it gets but is advisory: its code can
+ * reach the host's global, and with it the host's bindings and policy.
+ *
+ * Thread-safe. Messages are queued until the bindings attach() a handler.
+ */
+class SandboxRealm : public ISandboxDelegate,
+                     public std::enable_shared_from_this<SandboxRealm> {
+ public:
+  // Delivers one inbound message to the realm's JS, on the host's JS thread
+  using Deliver = std::function<void(facebook::jsi::Runtime&, std::string&&)>;
+  using ErrorHandler = std::function<void(
+      const std::string& origin,
+      const std::string& name,
+      const std::string& message,
+      const std::string& stack)>;
+
+  SandboxRealm(RealmConfig config, std::weak_ptr<ISandboxDelegate> host);
+
+  std::string origin() const;
+  RealmConfig config() const;
+
+  /**
+   * The name to load from the host runtime for a module the realm requests.
+   * @return Empty if the realm may not load it, or if the name the request
+   * resolves to is one of the host's configured modules
+   */
+  std::string resolveModule(const std::string& name) const;
+
+  /** Sends a message from the realm to targetOrigin, as routeMessage(). */
+  RealmRouteResult route(
+      const std::string& message,
+      const std::string& targetOrigin,
+      MessagePriority priority,
+      std::chrono::milliseconds ttl = std::chrono::milliseconds::zero());
+
+  /**
+   * Sends a message to the host sandbox's own JS, the realm's parent.
+   * @return false if the host is gone
+   */
+  bool postToHost(const std::string& message, MessagePriority priority);
+
+  /** Starts delivering queued and future messages through deliver. */
+  void attach(Deliver deliver);
+
+  /**
+   * Stops delivery and drops queued messages, e.g. before the host runtime
+   * is torn down. Releases whatever deliver captured.
+   */
+  void detach();
+
+  void setErrorHandler(ErrorHandler handler);
+
+  /**
+   * Reports an error of the realm's JS to the error handler.
+   * @return false if there is no handler, for the caller to throw instead
+   */
+  bool reportError(
+      const std::string& name,
+      const std::string& message,
+      const std::string& stack);
+
+  MessageQueueStats inboxStats() const {
+    return inbox_.stats();
+  }
+
+  // ISandboxDelegate
+  void postMessage(const std::string& message, MessagePriority priority)
+      override;
+  bool routeMessage(
+      const std::string& message,
+      const std::string& targetId,
+      MessagePriority priority) override;
+  void setOrigin(const std::string& origin) override;
+  void setAllowedOrigins(const std::set<std::string>& origins) override;
+  void setAllowedTurboModules(const std::set<std::string>& modules) override;
+  bool scheduleOnJSThread(
+      std::function<void(facebook::jsi::Runtime&)> work) override;
+
+ private:
+  void scheduleDrain();
+  void drain(facebook::jsi::Runtime& runtime);
+
+  RealmConfig config_;
+  std::weak_ptr<ISandboxDelegate> host_;
+  std::shared_ptr<Deliver> deliver_;
+  std::shared_ptr<ErrorHandler> errorHandler_;
+  SandboxMessageQueue inbox_;
+  mutable std::mutex mutex_;
+};
+
+/**
+ * The realms of one host sandbox. Each is registered in SandboxRegistry under
+ * its origin while in the set; destroying the set unregisters them all.
+ * Thread-safe.
+ */
+class SandboxRealmSet {
+ public:
+  explicit SandboxRealmSet(std::weak_ptr<ISandboxDelegate> host);
+  ~SandboxRealmSet();
+
+  SandboxRealmSet(const SandboxRealmSet&) = delete;
+  SandboxRealmSet& operator=(const SandboxRealmSet&) = delete;
+
+  /**
+   * Creates and registers a realm.
+   * @return nullptr if the origin is empty or already has a realm in the set
+   */
+  std::shared_ptr<SandboxRealm> add(RealmConfig config);
+
+  /** Unregisters and detaches the realm. @return false if there is none */
+  bool remove(const std::string& origin);
+
+  std::shared_ptr<SandboxRealm> find(const std::string& origin) const;
+
+  /** Origins of the realms in the set, in sorted order. */
+  std::vector<std::string> origins() const;
+
+  /** Handler for errors of every realm, including ones added later. */
+  void setErrorHandler(SandboxRealm::ErrorHandler handler);
+
+  /** Unregisters and detaches every realm. */
+  void clear();
+
+ private:
+  std::weak_ptr<ISandboxDelegate> host_;
+  std::map<std::string, std::shared_ptr<SandboxRealm>> realms_;
+  SandboxRealm::ErrorHandler errorHandler_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
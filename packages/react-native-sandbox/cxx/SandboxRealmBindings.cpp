@@ -0,0 +1,319 @@
+#include "SandboxRealmBindings.h"
+#include "SandboxJSIUtils.h"
+#include "SandboxMessageQueueBindings.h"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "SandboxBundleFile.h"
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+// Host globals acting for the host sandbox, hidden from realm code
+const char* const kShadowedGlobals[] = {
+    "callSandbox",
+    "setRpcHandler",
+    "openMessagePort",
+    "createSharedMemory",
+    "attachSharedMemory",
+    "sharedState",
+    "subscribeSharedState",
+    "setPresenceHandler",
+    "getOnlineSandboxes",
+    "setOnHibernate",
+    "getRestoredState",
+    "getMessageQueueStats",
+};
+
+// Names the scope answers to, the first parameters of the bundle function
+const char* const kScopeAliases[] = {"globalThis", "global", "window", "self"};
+
+// Per-realm JS state touched only on the host's JS thread
+struct RealmJSState {
+  std::shared_ptr<jsi::Function> onMessage;
+  // Delivered before the realm called setOnMessage
+  std::vector<std::string> pending;
+};
+
+void deliverToRealm(
+    jsi::Runtime& rt,
+    SandboxRealm& realm,
+    RealmJSState& state,
+    std::string&& message) {
+  if (!state.onMessage) {
+    state.pending.push_back(std::move(message));
+    return;
+  }
+  try {
+    state.onMessage->call(rt, parseJSON(rt, message));
+  } catch (const jsi::JSError& e) {
+    realm.reportError("JSError", e.getMessage(), e.getStack());
+  } catch (const std::exception& e) {
+    realm.reportError("RuntimeError", e.what(), "");
+  }
+}
+
+// Reports a failed postMessage, or throws it if nobody listens
+void reportRouteError(
+    jsi::Runtime& rt,
+    SandboxRealm& realm,
+    const char* name,
+    const std::string& message) {
+  if (!realm.reportError(name, message, "")) {
+    throw jsi::JSError(rt, message);
+  }
+}
+
+jsi::Function createPostMessage(
+    jsi::Runtime& runtime,
+    std::weak_ptr<SandboxRealm> weakRealm) {
+  return jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "postMessage"),
+      3, // message, targetOrigin?, options?
+      [weakRealm](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        auto realm = weakRealm.lock();
+        if (!realm) {
+          return jsi::Value::undefined();
+        }
+        if (count < 1 || count > 3) {
+          throw jsi::JSError(
+              rt,
+              "Expected 1 to 3 arguments: "
+              "postMessage(message, targetOrigin?, options?)");
+        }
+        if (!args[0].isObject()) {
+          throw jsi::JSError(rt, "Expected an object as the first argument");
+        }
+        jsi::Value noOptions;
+        auto options =
+            parsePostMessageOptions(rt, count > 2 ? args[2] : noOptions);
+        std::string message = stringifyJSON(rt, args[0]);
+
+        if (count < 2 || args[1].isNull() || args[1].isUndefined()) {
+          // Untargeted messages go to the host sandbox's JS
+          realm->postToHost(message, options.priority);
+          return jsi::Value::undefined();
+        }
+        if (!args[1].isString()) {
+          throw jsi::JSError(
+              rt, "Expected a string as the second argument (targetOrigin)");
+        }
+        std::string target = args[1].getString(rt).utf8(rt);
+        std::string origin = realm->origin();
+        switch (realm->route(message, target, options.priority, options.ttl)) {
+          case RealmRouteResult::Delivered:
+          case RealmRouteResult::Held:
+            break;
+          case RealmRouteResult::SelfTarget:
+            reportRouteError(
+                rt,
+                *realm,
+                "SelfTargetingError",
+                "Cannot send message to self (sandbox '" + target + "')");
+            break;
+          case RealmRouteResult::NotFound:
+            reportRouteError(
+                rt,
+                *realm,
+                "SandboxRoutingError",
+                "Target sandbox '" + target + "' not found");
+            break;
+          case RealmRouteResult::Denied:
+            reportRouteError(
+                rt,
+                *realm,
+                "AccessDeniedError",
+                "Access denied: Sandbox '" + origin +
+                    "' is not permitted to send messages to '" + target +
+                    "'");
+            break;
+        }
+        return jsi::Value::undefined();
+      });
+}
+
+jsi::Function createSetOnMessage(
+    jsi::Runtime& runtime,
+    std::weak_ptr<SandboxRealm> weakRealm,
+    std::shared_ptr<RealmJSState> state) {
+  return jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "setOnMessage"),
+      1,
+      [weakRealm, state](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count != 1) {
+          throw jsi::JSError(rt, "Expected exactly one argument");
+        }
+        if (!args[0].isObject() || !args[0].asObject(rt).isFunction(rt)) {
+          throw jsi::JSError(rt, "Expected a function as the first argument");
+        }
+        state->onMessage = std::make_shared<jsi::Function>(
+            args[0].asObject(rt).asFunction(rt));
+
+        std::vector<std::string> buffered;
+        buffered.swap(state->pending);
+        if (auto realm = weakRealm.lock()) {
+          for (auto& message : buffered) {
+            deliverToRealm(rt, *realm, *state, std::move(message));
+          }
+        }
+        return jsi::Value::undefined();
+      });
+}
+
+// Looks modules up in the host's proxy under the realm's policy. The host
+// proxy is read on each call, since the host may install it late.
+jsi::Function createTurboModuleProxy(
+    jsi::Runtime& runtime,
+    std::weak_ptr<SandboxRealm> weakRealm) {
+  return jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "__turboModuleProxy"),
+      1,
+      [weakRealm](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        auto realm = weakRealm.lock();
+        if (!realm || count < 1 || !args[0].isString()) {
+          return jsi::Value::null();
+        }
+        std::string name =
+            realm->resolveModule(args[0].getString(rt).utf8(rt));
+        jsi::Value hostProxy =
+            rt.global().getProperty(rt, "__turboModuleProxy");
+        if (name.empty() || !hostProxy.isObject() ||
+            !hostProxy.asObject(rt).isFunction(rt)) {
+          return jsi::Value::null();
+        }
+        return hostProxy.asObject(rt).asFunction(rt).call(
+            rt, jsi::String::createFromUtf8(rt, name));
+      });
+}
+
+class RealmNativeModuleProxy : public jsi::HostObject {
+ public:
+  explicit RealmNativeModuleProxy(std::weak_ptr<SandboxRealm> realm)
+      : realm_(std::move(realm)) {}
+
+  jsi::Value get(jsi::Runtime& rt, const jsi::PropNameID& prop) override {
+    auto realm = realm_.lock();
+    if (!realm) {
+      return jsi::Value::undefined();
+    }
+    std::string name = realm->resolveModule(prop.utf8(rt));
+    jsi::Value hostProxy = rt.global().getProperty(rt, "nativeModuleProxy");
+    if (name.empty() || !hostProxy.isObject()) {
+      return jsi::Value::undefined();
+    }
+    return hostProxy.asObject(rt).getProperty(rt, name.c_str());
+  }
+
+  void set(jsi::Runtime& rt, const jsi::PropNameID&, const jsi::Value&)
+      override {
+    throw jsi::JSError(rt, "nativeModuleProxy is read-only");
+  }
+
+  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime&) override {
+    return {};
+  }
+
+ private:
+  std::weak_ptr<SandboxRealm> realm_;
+};
+
+} // namespace
+
+void startRealm(
+    jsi::Runtime& runtime,
+    const std::shared_ptr<SandboxRealm>& realm,
+    const std::string& path,
+    const std::string& sourceURL) {
+  std::string error;
+  auto file = BundleFile::open(path, &error);
+  if (!file) {
+    throw std::runtime_error(error);
+  }
+  if (file->isHermesBytecode()) {
+    throw std::runtime_error(
+        "Realm bundle '" + path + "' is bytecode; realms need source");
+  }
+
+  std::weak_ptr<SandboxRealm> weakRealm = realm;
+  auto state = std::make_shared<RealmJSState>();
+
+  jsi::Object global = runtime.global();
+  jsi::Object scope = global.getPropertyAsObject(runtime, "Object")
+                          .getPropertyAsFunction(runtime, "create")
+                          .call(runtime, global)
+                          .asObject(runtime);
+
+  // Bound both on the scope and as parameters of the bundle function: bare
+  // names in the bundle resolve lexically, not through the scope
+  std::vector<std::pair<const char*, jsi::Value>> bindings;
+  bindings.emplace_back("postMessage", createPostMessage(runtime, weakRealm));
+  bindings.emplace_back(
+      "setOnMessage", createSetOnMessage(runtime, weakRealm, state));
+  bindings.emplace_back(
+      "__turboModuleProxy", createTurboModuleProxy(runtime, weakRealm));
+  bindings.emplace_back(
+      "nativeModuleProxy",
+      jsi::Object::createFromHostObject(
+          runtime, std::make_shared<RealmNativeModuleProxy>(weakRealm)));
+  for (const char* name : kShadowedGlobals) {
+    bindings.emplace_back(name, jsi::Value::undefined());
+  }
+
+  std::string params;
+  std::vector<jsi::Value> args;
+  for (const char* alias : kScopeAliases) {
+    params += params.empty() ? "" : ", ";
+    params += alias;
+    args.emplace_back(runtime, scope);
+    defineSandboxProperty(runtime, scope, alias, jsi::Value(runtime, scope));
+  }
+  for (auto& [name, value] : bindings) {
+    params += ", ";
+    params += name;
+    args.emplace_back(runtime, value);
+    defineSandboxProperty(runtime, scope, name, std::move(value));
+  }
+
+  // The prefix shares the bundle's first line, so line numbers in stacks
+  // still match the file
+  std::string source = "(function (" + params + ") {";
+  source.append(reinterpret_cast<const char*>(file->data()), file->size());
+  source += "\n})";
+  jsi::Function body =
+      runtime
+          .evaluateJavaScript(
+              std::make_shared<jsi::StringBuffer>(std::move(source)),
+              sourceURL)
+          .asObject(runtime)
+          .asFunction(runtime);
+  body.callWithThis(
+      runtime, scope, static_cast<const jsi::Value*>(args.data()), args.size());
+
+  realm->attach([weakRealm, state](jsi::Runtime& rt, std::string&& message) {
+    if (auto strongRealm = weakRealm.lock()) {
+      deliverToRealm(rt, *strongRealm, *state, std::move(message));
+    }
+  });
+}
+
+} // namespace rnsandbox
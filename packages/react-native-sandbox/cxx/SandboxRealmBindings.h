@@ -0,0 +1,41 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include <string>
+#include "SandboxRealm.h"
+
+namespace rnsandbox {
+
+/**
+ * Runs a realm's bundle in the host runtime, in a fresh scope object that
+ * inherits from the host's global. The bundle sees the scope as globalThis,
+ * global, window and self, and gets its own bindings:
+ *
+ *   postMessage(message, targetOrigin?, options?)
+ *   setOnMessage(handler)
+ *   __turboModuleProxy(name), nativeModuleProxy
+ *
+ * The module proxies only hand out the realm's allowed modules, under their
+ * substituted names, and never the modules the host configured for its own
+ * origin (RealmConfig::hostConfiguredModules). The host's other sandbox
+ * globals (callSandbox, sharedState, ...) are shadowed with undefined: they
+ * would act for the host. None of this contains the bundle, which can still
+ * reach the host's global through the scope's prototype or the Function
+ * constructor; realm policies are advisory.
+ *
+ * The bundle must be JavaScript source, run as one function body; names it
+ * does not declare resolve to the host's globals, so globals it defines must
+ * be read back through globalThis. Attaches the realm for delivery once the
+ * bundle returns. Call on the host's JS thread.
+ *
+ * @throws std::runtime_error if the file cannot be read or is bytecode,
+ * jsi::JSError if the bundle throws
+ */
+void startRealm(
+    facebook::jsi::Runtime& runtime,
+    const std::shared_ptr<SandboxRealm>& realm,
+    const std::string& path,
+    const std::string& sourceURL);
+
+} // namespace rnsandbox
@@ -1,5 +1,6 @@
 #include "SandboxRegistry.h"
 #include <algorithm>
+#include <iterator>
 
 namespace rnsandbox {
 
@@ -16,17 +17,30 @@ void SandboxRegistry::registerSandbox(
     return;
   }
 
-  std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+  bool added = false;
+  {
+    std::lock_guard<std::recursive_mutex> lock(registryMutex_);
 
-  auto& delegates = sandboxRegistry_[origin];
-  // Avoid duplicate registration of the same delegate
-  for (const auto& d : delegates) {
-    if (d == delegate) {
-      return;
+    auto& delegates = sandboxRegistry_[origin];
+    added = delegates.empty();
+    // Avoid duplicate registration of the same delegate, but still apply the
+    // new allowedOrigins so re-registering updates the ACL at run-time
+    if (std::find(delegates.begin(), delegates.end(), delegate) ==
+        delegates.end()) {
+      delegates.push_back(delegate);
+    }
+    allowedOrigins_[origin] = {OriginMatcher(allowedOrigins), {}};
+
+    // Still under the lock, so held messages reach the delegate before any
+    // sender can find() it and post directly
+    if (added) {
+      flushMailbox(origin, *delegate);
     }
   }
-  delegates.push_back(delegate);
-  allowedOrigins_[origin] = allowedOrigins;
+
+  if (added) {
+    notifyObservers(Change::Registered, origin);
+  }
 }
 
 void SandboxRegistry::unregisterDelegate(
@@ -36,22 +50,55 @@ void SandboxRegistry::unregisterDelegate(
     return;
   }
 
+  {
+    std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+
+    auto it = sandboxRegistry_.find(origin);
+    if (it == sandboxRegistry_.end()) {
+      return;
+    }
+
+    auto& delegates = it->second;
+    delegates.erase(
+        std::remove(delegates.begin(), delegates.end(), delegate),
+        delegates.end());
+
+    if (!delegates.empty()) {
+      return;
+    }
+    sandboxRegistry_.erase(it);
+    allowedOrigins_.erase(origin);
+  }
+
+  notifyObservers(Change::Unregistered, origin);
+}
+
+bool SandboxRegistry::replaceDelegate(
+    const std::string& origin,
+    const std::shared_ptr<ISandboxDelegate>& previous,
+    std::shared_ptr<ISandboxDelegate> delegate) {
+  if (origin.empty() || !previous || !delegate) {
+    return false;
+  }
+
   std::lock_guard<std::recursive_mutex> lock(registryMutex_);
 
   auto it = sandboxRegistry_.find(origin);
   if (it == sandboxRegistry_.end()) {
-    return;
+    return false;
   }
-
   auto& delegates = it->second;
-  delegates.erase(
-      std::remove(delegates.begin(), delegates.end(), delegate),
-      delegates.end());
-
-  if (delegates.empty()) {
-    sandboxRegistry_.erase(it);
-    allowedOrigins_.erase(origin);
+  auto slot = std::find(delegates.begin(), delegates.end(), previous);
+  if (slot == delegates.end()) {
+    return false;
   }
+  if (std::find(delegates.begin(), delegates.end(), delegate) !=
+      delegates.end()) {
+    delegates.erase(slot);
+  } else {
+    *slot = std::move(delegate);
+  }
+  return true;
 }
 
 void SandboxRegistry::unregister(const std::string& origin) {
@@ -59,9 +106,16 @@ void SandboxRegistry::unregister(const std::string& origin) {
     return;
   }
 
-  std::lock_guard<std::recursive_mutex> lock(registryMutex_);
-  sandboxRegistry_.erase(origin);
-  allowedOrigins_.erase(origin);
+  bool removed = false;
+  {
+    std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+    removed = sandboxRegistry_.erase(origin) > 0;
+    allowedOrigins_.erase(origin);
+  }
+
+  if (removed) {
+    notifyObservers(Change::Unregistered, origin);
+  }
 }
 
 std::shared_ptr<ISandboxDelegate> SandboxRegistry::find(
@@ -96,6 +150,19 @@ std::vector<std::shared_ptr<ISandboxDelegate>> SandboxRegistry::findAll(
   return {};
 }
 
+std::vector<std::string> SandboxRegistry::registeredOrigins() {
+  std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+
+  std::vector<std::string> origins;
+  origins.reserve(sandboxRegistry_.size());
+  for (const auto& entry : sandboxRegistry_) {
+    if (!entry.second.empty()) {
+      origins.push_back(entry.first);
+    }
+  }
+  return origins;
+}
+
 bool SandboxRegistry::isPermittedFrom(
     const std::string& sourceOrigin,
     const std::string& targetOrigin) {
@@ -105,18 +172,174 @@ bool SandboxRegistry::isPermittedFrom(
 
   std::lock_guard<std::recursive_mutex> lock(registryMutex_);
 
-  auto originsIt = allowedOrigins_.find(sourceOrigin);
-  if (originsIt == allowedOrigins_.end()) {
+  auto aclIt = allowedOrigins_.find(sourceOrigin);
+  if (aclIt == allowedOrigins_.end()) {
     return false;
   }
 
-  return originsIt->second.find(targetOrigin) != originsIt->second.end();
+  auto& acl = aclIt->second;
+  auto cached = acl.decisions.find(targetOrigin);
+  if (cached != acl.decisions.end()) {
+    return cached->second;
+  }
+
+  bool permitted = acl.matcher.matches(targetOrigin);
+  if (acl.decisions.size() >= kMaxCachedDecisions) {
+    acl.decisions.clear();
+  }
+  acl.decisions.emplace(targetOrigin, permitted);
+  return permitted;
+}
+
+void SandboxRegistry::addObserver(
+    const std::shared_ptr<ISandboxRegistryObserver>& observer) {
+  if (!observer) {
+    return;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+  observers_.push_back(observer);
+}
+
+void SandboxRegistry::removeObserver(
+    const std::shared_ptr<ISandboxRegistryObserver>& observer) {
+  std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+  observers_.erase(
+      std::remove_if(
+          observers_.begin(),
+          observers_.end(),
+          [&observer](const std::weak_ptr<ISandboxRegistryObserver>& weak) {
+            auto strong = weak.lock();
+            return !strong || strong == observer;
+          }),
+      observers_.end());
+}
+
+void SandboxRegistry::notifyObservers(
+    Change change,
+    const std::string& origin) {
+  std::vector<std::shared_ptr<ISandboxRegistryObserver>> observers;
+  {
+    std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+    for (const auto& weak : observers_) {
+      if (auto observer = weak.lock()) {
+        observers.push_back(std::move(observer));
+      }
+    }
+  }
+
+  for (const auto& observer : observers) {
+    if (change == Change::Registered) {
+      observer->onSandboxRegistered(origin);
+    } else {
+      observer->onSandboxUnregistered(origin);
+    }
+  }
+}
+
+bool SandboxRegistry::holdMessage(
+    const std::string& targetOrigin,
+    std::string message,
+    MessagePriority priority,
+    std::chrono::milliseconds ttl) {
+  if (targetOrigin.empty() || ttl.count() <= 0) {
+    return false;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+
+  // The target may have registered since the caller looked it up
+  auto registered = sandboxRegistry_.find(targetOrigin);
+  if (registered != sandboxRegistry_.end() && !registered->second.empty()) {
+    for (const auto& delegate : registered->second) {
+      delegate->postMessage(message, priority);
+    }
+    return true;
+  }
+
+  auto now = Clock::now();
+  expireHeldMessages(now);
+
+  auto& mailbox = mailboxes_[targetOrigin];
+  if (mailbox.size() >= mailboxConfig_.maxMessagesPerOrigin ||
+      mailboxStats_.heldBytes + message.size() >
+          mailboxConfig_.maxTotalBytes) {
+    if (mailbox.empty()) {
+      mailboxes_.erase(targetOrigin);
+    }
+    ++mailboxStats_.rejected;
+    return false;
+  }
+
+  mailboxStats_.heldBytes += message.size();
+  ++mailboxStats_.heldMessages;
+  ++mailboxStats_.accepted;
+  mailbox.push_back(
+      {std::move(message),
+       priority,
+       now + std::min(ttl, mailboxConfig_.maxTtl)});
+  return true;
+}
+
+void SandboxRegistry::setMailboxConfig(const MailboxConfig& config) {
+  std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+  mailboxConfig_ = config;
+}
+
+MailboxStats SandboxRegistry::mailboxStats() {
+  std::lock_guard<std::recursive_mutex> lock(registryMutex_);
+  expireHeldMessages(Clock::now());
+  return mailboxStats_;
+}
+
+void SandboxRegistry::flushMailbox(
+    const std::string& origin,
+    ISandboxDelegate& delegate) {
+  auto it = mailboxes_.find(origin);
+  if (it == mailboxes_.end()) {
+    return;
+  }
+  std::deque<HeldMessage> mailbox = std::move(it->second);
+  mailboxes_.erase(it);
+
+  auto now = Clock::now();
+  for (auto& held : mailbox) {
+    mailboxStats_.heldBytes -= held.message.size();
+    --mailboxStats_.heldMessages;
+    if (held.deadline <= now) {
+      ++mailboxStats_.expired;
+      continue;
+    }
+    ++mailboxStats_.delivered;
+    delegate.postMessage(held.message, held.priority);
+  }
+}
+
+void SandboxRegistry::expireHeldMessages(Clock::time_point now) {
+  for (auto it = mailboxes_.begin(); it != mailboxes_.end();) {
+    auto& mailbox = it->second;
+    // Partition rather than remove_if so the expired tail stays readable
+    auto expired = std::stable_partition(
+        mailbox.begin(), mailbox.end(), [now](const HeldMessage& held) {
+          return held.deadline > now;
+        });
+    for (auto held = expired; held != mailbox.end(); ++held) {
+      mailboxStats_.heldBytes -= held->message.size();
+      --mailboxStats_.heldMessages;
+      ++mailboxStats_.expired;
+    }
+    mailbox.erase(expired, mailbox.end());
+    it = mailbox.empty() ? mailboxes_.erase(it) : std::next(it);
+  }
 }
 
 void SandboxRegistry::reset() {
   std::lock_guard<std::recursive_mutex> lock(registryMutex_);
   sandboxRegistry_.clear();
   allowedOrigins_.clear();
+  mailboxes_.clear();
+  mailboxConfig_ = MailboxConfig();
+  mailboxStats_ = MailboxStats();
 }
 
 } // namespace rnsandbox
@@ -1,15 +1,40 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "ISandboxDelegate.h"
+#include "ISandboxRegistryObserver.h"
+#include "OriginMatcher.h"
 
 namespace rnsandbox {
 
+struct MailboxConfig {
+  // Upper bound applied to the TTL requested by senders
+  std::chrono::milliseconds maxTtl{30000};
+  size_t maxMessagesPerOrigin = 256;
+  // Payload bytes held across all mailboxes
+  size_t maxTotalBytes = 1024 * 1024;
+};
+
+struct MailboxStats {
+  size_t heldMessages = 0;
+  size_t heldBytes = 0;
+  uint64_t accepted = 0;
+  uint64_t delivered = 0;
+  uint64_t expired = 0;
+  // Refused because a cap was reached
+  uint64_t rejected = 0;
+};
+
 class SandboxRegistry {
  public:
   static SandboxRegistry& getInstance();
@@ -23,6 +48,17 @@ class SandboxRegistry {
       const std::string& origin,
       const std::shared_ptr<ISandboxDelegate>& delegate);
 
+  /**
+   * Swaps `previous` for `delegate` in one step, keeping origin's
+   * allowedOrigins, so the origin never looks unregistered to observers and
+   * no message is posted to both.
+   * @return false, changing nothing, if `previous` is not registered
+   */
+  bool replaceDelegate(
+      const std::string& origin,
+      const std::shared_ptr<ISandboxDelegate>& previous,
+      std::shared_ptr<ISandboxDelegate> delegate);
+
   void unregister(const std::string& origin);
 
   std::shared_ptr<ISandboxDelegate> find(const std::string& origin);
@@ -30,20 +66,84 @@ class SandboxRegistry {
   std::vector<std::shared_ptr<ISandboxDelegate>> findAll(
       const std::string& origin);
 
+  /** Origins with at least one registered delegate, in sorted order. */
+  std::vector<std::string> registeredOrigins();
+
+  /**
+   * Whether sourceOrigin's allowedOrigins admit targetOrigin. Entries may be
+   * exact origins or prefix patterns such as `plugin.*` (see OriginMatcher).
+   * Decisions are cached per (source, target) until source re-registers.
+   */
   bool isPermittedFrom(
       const std::string& sourceOrigin,
       const std::string& targetOrigin);
 
+  /**
+   * Subscribes to registration changes. Observers are held weakly and are
+   * dropped automatically once destroyed. reset() does not remove them.
+   */
+  void addObserver(const std::shared_ptr<ISandboxRegistryObserver>& observer);
+
+  void removeObserver(
+      const std::shared_ptr<ISandboxRegistryObserver>& observer);
+
+  /**
+   * Store-and-forward for origins that have not registered yet. The message
+   * is kept for at most `ttl` (capped by MailboxConfig::maxTtl) and flushed,
+   * in arrival order, to the first delegate that registers for targetOrigin,
+   * before that registration becomes visible to find(). If targetOrigin is
+   * already registered the message is delivered right away.
+   * @return false if the message was dropped: ttl is not positive or a
+   *         mailbox cap was reached
+   */
+  bool holdMessage(
+      const std::string& targetOrigin,
+      std::string message,
+      MessagePriority priority,
+      std::chrono::milliseconds ttl);
+
+  void setMailboxConfig(const MailboxConfig& config);
+
+  /** Expires overdue messages and returns the mailbox counters. */
+  MailboxStats mailboxStats();
+
   void reset();
 
  private:
+  using Clock = std::chrono::steady_clock;
+
+  struct OriginAcl {
+    OriginMatcher matcher;
+    std::unordered_map<std::string, bool> decisions;
+  };
+
+  // Bounds the per-source decision cache; it is cleared once full
+  static constexpr size_t kMaxCachedDecisions = 1024;
+
+  struct HeldMessage {
+    std::string message;
+    MessagePriority priority;
+    Clock::time_point deadline;
+  };
+
   SandboxRegistry() = default;
   SandboxRegistry(const SandboxRegistry&) = delete;
   SandboxRegistry& operator=(const SandboxRegistry&) = delete;
 
+  enum class Change { Registered, Unregistered };
+  void notifyObservers(Change change, const std::string& origin);
+
+  // Both require registryMutex_ to be held
+  void flushMailbox(const std::string& origin, ISandboxDelegate& delegate);
+  void expireHeldMessages(Clock::time_point now);
+
   std::map<std::string, std::vector<std::shared_ptr<ISandboxDelegate>>>
       sandboxRegistry_;
-  std::map<std::string, std::set<std::string>> allowedOrigins_;
+  std::map<std::string, OriginAcl> allowedOrigins_;
+  std::vector<std::weak_ptr<ISandboxRegistryObserver>> observers_;
+  std::map<std::string, std::deque<HeldMessage>> mailboxes_;
+  MailboxConfig mailboxConfig_;
+  MailboxStats mailboxStats_;
   mutable std::recursive_mutex registryMutex_;
 };
 
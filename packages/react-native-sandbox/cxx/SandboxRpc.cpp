@@ -0,0 +1,274 @@
+#include "SandboxRpc.h"
+#include <algorithm>
+#include "SandboxRegistry.h"
+
+namespace rnsandbox {
+
+const char* rpcStatusName(RpcStatus status) {
+  switch (status) {
+    case RpcStatus::Ok:
+      return "Ok";
+    case RpcStatus::InvalidOrigin:
+      return "InvalidOrigin";
+    case RpcStatus::SelfTarget:
+      return "SelfTarget";
+    case RpcStatus::AccessDenied:
+      return "AccessDenied";
+    case RpcStatus::TargetNotFound:
+      return "TargetNotFound";
+    case RpcStatus::TargetUnregistered:
+      return "TargetUnregistered";
+    case RpcStatus::MethodNotFound:
+      return "MethodNotFound";
+    case RpcStatus::HandlerError:
+      return "HandlerError";
+    case RpcStatus::Timeout:
+      return "Timeout";
+  }
+  return "Unknown";
+}
+
+class RpcRouter::RegistryObserver : public ISandboxRegistryObserver {
+ public:
+  explicit RegistryObserver(RpcRouter& router) : router_(router) {}
+
+  void onSandboxRegistered(const std::string&) override {}
+
+  void onSandboxUnregistered(const std::string& origin) override {
+    router_.onSandboxUnregistered(origin);
+  }
+
+ private:
+  RpcRouter& router_;
+};
+
+RpcRouter& RpcRouter::getInstance() {
+  static RpcRouter instance;
+  return instance;
+}
+
+RpcRouter::RpcRouter()
+    : registryObserver_(std::make_shared<RegistryObserver>(*this)) {
+  SandboxRegistry::getInstance().addObserver(registryObserver_);
+}
+
+RpcRouter::~RpcRouter() {
+  SandboxRegistry::getInstance().removeObserver(registryObserver_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  timerCondition_.notify_all();
+  if (timer_.joinable()) {
+    timer_.join();
+  }
+}
+
+void RpcRouter::registerEndpoint(
+    const std::string& origin,
+    std::shared_ptr<IRpcEndpoint> endpoint) {
+  if (origin.empty() || !endpoint) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& endpoints = endpoints_[origin];
+  if (std::find(endpoints.begin(), endpoints.end(), endpoint) ==
+      endpoints.end()) {
+    endpoints.push_back(std::move(endpoint));
+  }
+}
+
+void RpcRouter::unregisterEndpoint(
+    const std::string& origin,
+    const std::shared_ptr<IRpcEndpoint>& endpoint) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = endpoints_.find(origin);
+    if (it == endpoints_.end()) {
+      return;
+    }
+    auto& endpoints = it->second;
+    auto slot = std::find(endpoints.begin(), endpoints.end(), endpoint);
+    if (slot == endpoints.end()) {
+      return;
+    }
+    endpoints.erase(slot);
+    if (endpoints.empty()) {
+      endpoints_.erase(it);
+    }
+  }
+
+  // Calls routed to this runtime can never be answered; those routed to
+  // other runtimes of the origin still can
+  rejectCalls(
+      [target = endpoint.get()](const PendingCall& call) {
+        return call.target == target;
+      },
+      "Target sandbox '" + origin + "' was unregistered");
+}
+
+RpcStatus RpcRouter::call(
+    const std::shared_ptr<IRpcEndpoint>& caller,
+    const std::string& sourceOrigin,
+    const std::string& targetOrigin,
+    const std::string& method,
+    std::string argsJson,
+    std::chrono::milliseconds timeout,
+    uint64_t& callId) {
+  if (sourceOrigin.empty() || targetOrigin.empty() || method.empty()) {
+    return RpcStatus::InvalidOrigin;
+  }
+  if (sourceOrigin == targetOrigin) {
+    return RpcStatus::SelfTarget;
+  }
+  // Checked before taking mutex_: the registry notifies us under its own
+  // locking and we must not invert the order
+  if (!SandboxRegistry::getInstance().isPermittedFrom(
+          sourceOrigin, targetOrigin)) {
+    return RpcStatus::AccessDenied;
+  }
+
+  std::shared_ptr<IRpcEndpoint> target;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto callerIt = endpoints_.find(sourceOrigin);
+    if (callerIt == endpoints_.end() ||
+        std::find(callerIt->second.begin(), callerIt->second.end(), caller) ==
+            callerIt->second.end()) {
+      return RpcStatus::InvalidOrigin;
+    }
+    auto targetIt = endpoints_.find(targetOrigin);
+    if (targetIt == endpoints_.end()) {
+      return RpcStatus::TargetNotFound;
+    }
+    // The newest runtime of the origin, e.g. the one a reload started
+    target = targetIt->second.back();
+
+    callId = nextCallId_++;
+    pending_.emplace(
+        callId,
+        PendingCall{sourceOrigin, targetOrigin, method, caller, target.get()});
+
+    if (timeout.count() > 0) {
+      deadlines_.emplace(Clock::now() + timeout, callId);
+      if (!timer_.joinable()) {
+        timer_ = std::thread([this]() { runTimer(); });
+      } else if (deadlines_.top().second == callId) {
+        timerCondition_.notify_one();
+      }
+    }
+  }
+
+  target->onRequest(callId, sourceOrigin, method, std::move(argsJson));
+  return RpcStatus::Ok;
+}
+
+bool RpcRouter::respond(
+    const std::string& responderOrigin,
+    uint64_t callId,
+    RpcResponse response) {
+  std::shared_ptr<IRpcEndpoint> caller;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(callId);
+    if (it == pending_.end() || it->second.targetOrigin != responderOrigin) {
+      return false;
+    }
+    caller = it->second.caller.lock();
+    pending_.erase(it);
+  }
+
+  if (caller) {
+    caller->onResponse(callId, std::move(response));
+  }
+  return true;
+}
+
+size_t RpcRouter::pendingCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.size();
+}
+
+void RpcRouter::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  endpoints_.clear();
+  pending_.clear();
+  deadlines_ = decltype(deadlines_)();
+}
+
+void RpcRouter::rejectCalls(
+    const std::function<bool(const PendingCall&)>& matches,
+    const std::string& why) {
+  std::vector<std::pair<uint64_t, std::shared_ptr<IRpcEndpoint>>> rejected;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = pending_.begin(); it != pending_.end();) {
+      if (!matches(it->second)) {
+        ++it;
+        continue;
+      }
+      if (auto caller = it->second.caller.lock()) {
+        rejected.emplace_back(it->first, std::move(caller));
+      }
+      it = pending_.erase(it);
+    }
+  }
+
+  for (auto& [callId, caller] : rejected) {
+    caller->onResponse(callId, {RpcStatus::TargetUnregistered, why});
+  }
+}
+
+void RpcRouter::onSandboxUnregistered(const std::string& origin) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    endpoints_.erase(origin);
+    // Nobody is left to receive the outcome of calls the origin made
+    for (auto it = pending_.begin(); it != pending_.end();) {
+      it = it->second.sourceOrigin == origin ? pending_.erase(it)
+                                             : std::next(it);
+    }
+  }
+
+  rejectCalls(
+      [&origin](const PendingCall& call) {
+        return call.targetOrigin == origin;
+      },
+      "Target sandbox '" + origin + "' was unregistered");
+}
+
+void RpcRouter::runTimer() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (deadlines_.empty()) {
+      timerCondition_.wait(lock);
+      continue;
+    }
+
+    auto [deadline, callId] = deadlines_.top();
+    if (Clock::now() < deadline) {
+      timerCondition_.wait_until(lock, deadline);
+      continue;
+    }
+    deadlines_.pop();
+
+    // Entries of calls that already completed are skipped lazily
+    auto it = pending_.find(callId);
+    if (it == pending_.end()) {
+      continue;
+    }
+    auto caller = it->second.caller.lock();
+    std::string message = "RPC call '" + it->second.method + "' to '" +
+        it->second.targetOrigin + "' timed out";
+    pending_.erase(it);
+
+    lock.unlock();
+    if (caller) {
+      caller->onResponse(callId, {RpcStatus::Timeout, std::move(message)});
+    }
+    lock.lock();
+  }
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ISandboxRegistryObserver.h"
+
+namespace rnsandbox {
+
+enum class RpcStatus {
+  Ok,
+  InvalidOrigin,
+  SelfTarget,
+  AccessDenied,
+  TargetNotFound,
+  TargetUnregistered,
+  MethodNotFound,
+  HandlerError,
+  Timeout,
+};
+
+/** Human-readable name of a status, used as the `code` of JS RPC errors. */
+const char* rpcStatusName(RpcStatus status);
+
+struct RpcResponse {
+  RpcStatus status = RpcStatus::Ok;
+  // JSON-serialized result when status is Ok, an error message otherwise
+  std::string payload;
+};
+
+/**
+ * Per-sandbox side of the RPC layer. Both callbacks may be invoked from any
+ * thread; implementations hop to their JS thread themselves.
+ */
+class IRpcEndpoint {
+ public:
+  virtual ~IRpcEndpoint() = default;
+
+  /**
+   * An incoming call for this sandbox. Must eventually be answered with
+   * RpcRouter::respond(), unless it times out first.
+   */
+  virtual void onRequest(
+      uint64_t callId,
+      const std::string& sourceOrigin,
+      const std::string& method,
+      std::string argsJson) = 0;
+
+  /** The outcome of a call this sandbox made. Delivered exactly once. */
+  virtual void onResponse(uint64_t callId, RpcResponse response) = 0;
+};
+
+/**
+ * Process-wide request/response router between sandbox origins.
+ *
+ * Correlation ids, deadlines and the pending-call table live here rather than
+ * in JS. Access is checked against SandboxRegistry when the call is made.
+ *
+ * An origin may have several endpoints, one per runtime running it (views
+ * sharing a host, or a runtime and the one replacing it on reload). A call
+ * goes to the most recently registered one and is answered to the endpoint
+ * that made it. Pending calls are rejected with TargetUnregistered as soon as
+ * the endpoint they went to is unregistered or the target origin leaves
+ * SandboxRegistry, and with Timeout by a single timer thread once their
+ * deadline passes.
+ */
+class RpcRouter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::chrono::milliseconds kDefaultTimeout{10000};
+
+  static RpcRouter& getInstance();
+
+  ~RpcRouter();
+
+  /** Adds an endpoint for origin, next to those it already has. */
+  void registerEndpoint(
+      const std::string& origin,
+      std::shared_ptr<IRpcEndpoint> endpoint);
+
+  /** Removes the endpoint, rejecting the calls routed to it. */
+  void unregisterEndpoint(
+      const std::string& origin,
+      const std::shared_ptr<IRpcEndpoint>& endpoint);
+
+  /**
+   * Starts a call. On Ok, callId identifies the call and the target endpoint
+   * has received onRequest; any other status means nothing was sent.
+   * @param caller Endpoint of sourceOrigin that receives the response
+   * @param timeout Zero or negative disables the deadline
+   */
+  RpcStatus call(
+      const std::shared_ptr<IRpcEndpoint>& caller,
+      const std::string& sourceOrigin,
+      const std::string& targetOrigin,
+      const std::string& method,
+      std::string argsJson,
+      std::chrono::milliseconds timeout,
+      uint64_t& callId);
+
+  /**
+   * Completes a call received by responderOrigin.
+   * @return false if the call already completed, timed out or was rejected
+   */
+  bool respond(
+      const std::string& responderOrigin,
+      uint64_t callId,
+      RpcResponse response);
+
+  size_t pendingCount() const;
+
+  void reset();
+
+ private:
+  class RegistryObserver;
+
+  struct PendingCall {
+    std::string sourceOrigin;
+    std::string targetOrigin;
+    std::string method;
+    std::weak_ptr<IRpcEndpoint> caller;
+    // Identity only, for rejecting the calls of an unregistered endpoint
+    const IRpcEndpoint* target;
+  };
+
+  using Deadline = std::pair<Clock::time_point, uint64_t>;
+
+  RpcRouter();
+  RpcRouter(const RpcRouter&) = delete;
+  RpcRouter& operator=(const RpcRouter&) = delete;
+
+  void rejectCalls(
+      const std::function<bool(const PendingCall&)>& matches,
+      const std::string& why);
+  void onSandboxUnregistered(const std::string& origin);
+  void runTimer();
+
+  // Per origin, in registration order
+  std::map<std::string, std::vector<std::shared_ptr<IRpcEndpoint>>>
+      endpoints_;
+  std::unordered_map<uint64_t, PendingCall> pending_;
+  std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>>
+      deadlines_;
+  uint64_t nextCallId_ = 1;
+
+  std::shared_ptr<RegistryObserver> registryObserver_;
+  std::thread timer_;
+  std::condition_variable timerCondition_;
+  bool stopping_ = false;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
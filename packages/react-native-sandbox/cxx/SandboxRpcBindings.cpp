@@ -0,0 +1,377 @@
+#include "SandboxRpcBindings.h"
+#include "SandboxJSIUtils.h"
+#include "SandboxRpc.h"
+
+#include <cmath>
+#include <unordered_map>
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+struct Settlers {
+  std::shared_ptr<jsi::Function> resolve;
+  std::shared_ptr<jsi::Function> reject;
+};
+
+// Per-runtime state touched only on the owning sandbox's JS thread. Owned by
+// the installed host functions, so it lives exactly as long as the runtime.
+struct RpcJSState {
+  std::string origin;
+  std::weak_ptr<IRpcEndpoint> endpoint;
+  std::unordered_map<std::string, std::shared_ptr<jsi::Function>> handlers;
+  std::unordered_map<uint64_t, Settlers> pending;
+
+  ~RpcJSState() {
+    if (auto strongEndpoint = endpoint.lock()) {
+      RpcRouter::getInstance().unregisterEndpoint(origin, strongEndpoint);
+    }
+  }
+};
+
+std::string errorMessage(jsi::Runtime& rt, const jsi::Value& error) {
+  if (error.isObject()) {
+    jsi::Value message = error.asObject(rt).getProperty(rt, "message");
+    if (message.isString()) {
+      return message.getString(rt).utf8(rt);
+    }
+  }
+  return rt.global()
+      .getPropertyAsFunction(rt, "String")
+      .call(rt, error)
+      .getString(rt)
+      .utf8(rt);
+}
+
+void respondWithValue(
+    jsi::Runtime& rt,
+    const std::string& origin,
+    uint64_t callId,
+    const jsi::Value& value) {
+  RpcResponse response;
+  try {
+    response.payload = value.isUndefined() ? "null" : stringifyJSON(rt, value);
+  } catch (const jsi::JSError& e) {
+    response = {RpcStatus::HandlerError, e.getMessage()};
+  }
+  RpcRouter::getInstance().respond(origin, callId, std::move(response));
+}
+
+void respondWithError(
+    const std::string& origin,
+    uint64_t callId,
+    RpcStatus status,
+    std::string message) {
+  RpcRouter::getInstance().respond(
+      origin, callId, {status, std::move(message)});
+}
+
+bool isThenable(jsi::Runtime& rt, const jsi::Value& value) {
+  if (!value.isObject()) {
+    return false;
+  }
+  jsi::Value then = value.asObject(rt).getProperty(rt, "then");
+  return then.isObject() && then.asObject(rt).isFunction(rt);
+}
+
+void dispatchRequest(
+    jsi::Runtime& rt,
+    RpcJSState& state,
+    uint64_t callId,
+    const std::string& sourceOrigin,
+    const std::string& method,
+    const std::string& argsJson) {
+  const std::string& origin = state.origin;
+  auto it = state.handlers.find(method);
+  if (it == state.handlers.end()) {
+    respondWithError(
+        origin,
+        callId,
+        RpcStatus::MethodNotFound,
+        "No RPC handler for '" + method + "' in sandbox '" + origin + "'");
+    return;
+  }
+  auto handler = it->second;
+
+  try {
+    jsi::Value result = handler->call(
+        rt,
+        parseJSON(rt, argsJson),
+        jsi::String::createFromUtf8(rt, sourceOrigin));
+    if (!isThenable(rt, result)) {
+      respondWithValue(rt, origin, callId, result);
+      return;
+    }
+
+    auto onFulfilled = jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "onFulfilled"),
+        1,
+        [origin, callId](
+            jsi::Runtime& rt,
+            const jsi::Value&,
+            const jsi::Value* args,
+            size_t count) -> jsi::Value {
+          respondWithValue(
+              rt,
+              origin,
+              callId,
+              count > 0 ? jsi::Value(rt, args[0]) : jsi::Value());
+          return jsi::Value::undefined();
+        });
+    auto onRejected = jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "onRejected"),
+        1,
+        [origin, callId](
+            jsi::Runtime& rt,
+            const jsi::Value&,
+            const jsi::Value* args,
+            size_t count) -> jsi::Value {
+          respondWithError(
+              origin,
+              callId,
+              RpcStatus::HandlerError,
+              errorMessage(
+                  rt, count > 0 ? jsi::Value(rt, args[0]) : jsi::Value()));
+          return jsi::Value::undefined();
+        });
+
+    jsi::Object promise = result.asObject(rt);
+    promise.getPropertyAsFunction(rt, "then")
+        .callWithThis(rt, promise, onFulfilled, onRejected);
+  } catch (const jsi::JSError& e) {
+    respondWithError(origin, callId, RpcStatus::HandlerError, e.getMessage());
+  }
+}
+
+void settleCall(
+    jsi::Runtime& rt,
+    RpcJSState& state,
+    uint64_t callId,
+    const RpcResponse& response) {
+  auto it = state.pending.find(callId);
+  if (it == state.pending.end()) {
+    return;
+  }
+  Settlers settlers = std::move(it->second);
+  state.pending.erase(it);
+
+  try {
+    if (response.status == RpcStatus::Ok) {
+      settlers.resolve->call(rt, parseJSON(rt, response.payload));
+    } else {
+      settlers.reject->call(
+          rt,
+          createJSError(rt, response.payload, rpcStatusName(response.status)));
+    }
+  } catch (const jsi::JSError& e) {
+    reportJSError(rt, e);
+  }
+}
+
+class JSRpcEndpoint : public IRpcEndpoint {
+ public:
+  JSRpcEndpoint(
+      std::string origin,
+      std::weak_ptr<RpcJSState> state,
+      std::weak_ptr<ISandboxDelegate> delegate)
+      : origin_(std::move(origin)),
+        state_(std::move(state)),
+        delegate_(std::move(delegate)) {}
+
+  void onRequest(
+      uint64_t callId,
+      const std::string& sourceOrigin,
+      const std::string& method,
+      std::string argsJson) override {
+    bool scheduled = schedule(
+        [callId, sourceOrigin, method, argsJson = std::move(argsJson)](
+            jsi::Runtime& rt, RpcJSState& state) {
+          dispatchRequest(rt, state, callId, sourceOrigin, method, argsJson);
+        });
+    if (!scheduled) {
+      respondWithError(
+          origin_,
+          callId,
+          RpcStatus::TargetNotFound,
+          "Target sandbox '" + origin_ + "' is not running");
+    }
+  }
+
+  void onResponse(uint64_t callId, RpcResponse response) override {
+    schedule([callId, response = std::move(response)](
+                 jsi::Runtime& rt, RpcJSState& state) {
+      settleCall(rt, state, callId, response);
+    });
+  }
+
+ private:
+  template <typename Work>
+  bool schedule(Work&& work) {
+    auto delegate = delegate_.lock();
+    if (!delegate) {
+      return false;
+    }
+    return delegate->scheduleOnJSThread(
+        [state = state_, work = std::forward<Work>(work)](jsi::Runtime& rt) {
+          if (auto strongState = state.lock()) {
+            work(rt, *strongState);
+          }
+        });
+  }
+
+  std::string origin_;
+  std::weak_ptr<RpcJSState> state_;
+  std::weak_ptr<ISandboxDelegate> delegate_;
+};
+
+// Zero, negative values and Infinity disable the deadline, as do values past
+// kMaxTimeoutMs, which Clock::now() + timeout could not represent. NaN and
+// non-numbers keep the default.
+std::chrono::milliseconds callTimeout(
+    const jsi::Value& value,
+    std::chrono::milliseconds defaultTimeout) {
+  constexpr double kMaxTimeoutMs = 365.0 * 24 * 60 * 60 * 1000;
+  if (!value.isNumber() || std::isnan(value.getNumber())) {
+    return defaultTimeout;
+  }
+  double timeout = value.getNumber();
+  if (timeout <= 0 || timeout > kMaxTimeoutMs) {
+    return std::chrono::milliseconds(0);
+  }
+  return std::chrono::milliseconds(static_cast<int64_t>(timeout));
+}
+
+std::string callStatusMessage(
+    RpcStatus status,
+    const std::string& origin,
+    const std::string& targetOrigin) {
+  switch (status) {
+    case RpcStatus::InvalidOrigin:
+      return "callSandbox: both the sandbox origin and targetOrigin must be "
+             "non-empty, and method must be a non-empty string";
+    case RpcStatus::SelfTarget:
+      return "Cannot call own RPC handlers (sandbox '" + origin + "')";
+    case RpcStatus::AccessDenied:
+      return "Access denied: Sandbox '" + origin +
+          "' is not permitted to send messages to '" + targetOrigin + "'";
+    case RpcStatus::TargetNotFound:
+      return "Target sandbox '" + targetOrigin + "' not found";
+    default:
+      return std::string("RPC call failed: ") + rpcStatusName(status);
+  }
+}
+
+} // namespace
+
+void installRpcBindings(
+    jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    SandboxJSHandlers& handlers) {
+  auto state = std::make_shared<RpcJSState>();
+  state->origin = origin;
+  auto endpoint =
+      std::make_shared<JSRpcEndpoint>(origin, state, std::move(delegate));
+  state->endpoint = endpoint;
+  RpcRouter::getInstance().registerEndpoint(origin, endpoint);
+  // Responses to dropped calls find no settlers and are ignored
+  handlers.add([weakState = std::weak_ptr<RpcJSState>(state)]() {
+    if (auto strongState = weakState.lock()) {
+      strongState->handlers.clear();
+      strongState->pending.clear();
+    }
+  });
+
+  auto callSandbox = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "callSandbox"),
+      4,
+      [state](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count < 2 || !args[0].isString() || !args[1].isString()) {
+          throw jsi::JSError(
+              rt,
+              "callSandbox(targetOrigin, method, args?, options?): "
+              "targetOrigin and method must be strings");
+        }
+        std::string targetOrigin = args[0].getString(rt).utf8(rt);
+        std::string method = args[1].getString(rt).utf8(rt);
+        std::string argsJson = count > 2 && !args[2].isUndefined()
+            ? stringifyJSON(rt, args[2])
+            : "null";
+
+        auto timeout = RpcRouter::kDefaultTimeout;
+        if (count > 3 && args[3].isObject()) {
+          timeout = callTimeout(
+              args[3].asObject(rt).getProperty(rt, "timeoutMs"), timeout);
+        }
+
+        std::shared_ptr<jsi::Function> resolve;
+        std::shared_ptr<jsi::Function> reject;
+        jsi::Value promise = createPromise(rt, resolve, reject);
+
+        uint64_t callId = 0;
+        auto status = RpcRouter::getInstance().call(
+            state->endpoint.lock(),
+            state->origin,
+            targetOrigin,
+            method,
+            std::move(argsJson),
+            timeout,
+            callId);
+        if (status != RpcStatus::Ok) {
+          reject->call(
+              rt,
+              createJSError(
+                  rt,
+                  callStatusMessage(status, state->origin, targetOrigin),
+                  rpcStatusName(status)));
+          return promise;
+        }
+
+        // The response is always delivered through a later JS-thread task,
+        // so registering the settlers after the call is race-free
+        state->pending[callId] = {std::move(resolve), std::move(reject)};
+        return promise;
+      });
+
+  auto setRpcHandler = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "setRpcHandler"),
+      2,
+      [state](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count != 2 || !args[0].isString()) {
+          throw jsi::JSError(
+              rt, "setRpcHandler(method, handler): method must be a string");
+        }
+        std::string method = args[0].getString(rt).utf8(rt);
+
+        if (args[1].isNull() || args[1].isUndefined()) {
+          state->handlers.erase(method);
+          return jsi::Value::undefined();
+        }
+        if (!args[1].isObject() || !args[1].asObject(rt).isFunction(rt)) {
+          throw jsi::JSError(
+              rt, "setRpcHandler: handler must be a function or null");
+        }
+        state->handlers[method] = std::make_shared<jsi::Function>(
+            args[1].asObject(rt).asFunction(rt));
+        return jsi::Value::undefined();
+      });
+
+  defineSandboxGlobal(runtime, "callSandbox", std::move(callSandbox));
+  defineSandboxGlobal(runtime, "setRpcHandler", std::move(setRpcHandler));
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include <string>
+#include "ISandboxDelegate.h"
+#include "SandboxJSHandlers.h"
+
+namespace rnsandbox {
+
+/**
+ * Installs the native RPC globals into a sandbox runtime:
+ *
+ *   callSandbox(targetOrigin, method, args?, { timeoutMs }?) => Promise
+ *   setRpcHandler(method, (args, sourceOrigin) => result | Promise | null)
+ *
+ * Correlation and timeouts are handled by RpcRouter; JS only keeps the
+ * handler functions and the resolvers of its own in-flight calls.
+ *
+ * @param runtime The sandbox runtime, on its JS thread
+ * @param origin Origin of the sandbox owning the runtime
+ * @param delegate Registry delegate used to schedule work on the JS thread
+ * @param handlers Receives the reset of the RPC handlers and call resolvers
+ */
+void installRpcBindings(
+    facebook::jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    SandboxJSHandlers& handlers);
+
+} // namespace rnsandbox
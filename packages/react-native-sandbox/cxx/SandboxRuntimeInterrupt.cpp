@@ -0,0 +1,41 @@
+#include "SandboxRuntimeInterrupt.h"
+
+#include <utility>
+
+#if __has_include(<hermes/hermes.h>)
+#include <hermes/hermes.h>
+#define RNSANDBOX_CAN_INTERRUPT 1
+#else
+#define RNSANDBOX_CAN_INTERRUPT 0
+#endif
+
+namespace rnsandbox {
+
+bool RuntimeInterrupter::attach(facebook::jsi::Runtime& runtime) {
+  std::function<void()> trigger;
+#if RNSANDBOX_CAN_INTERRUPT
+  if (auto* hermes = dynamic_cast<facebook::hermes::HermesRuntime*>(&runtime)) {
+    trigger = [hermes] { hermes->asyncTriggerTimeout(); };
+  }
+#else
+  (void)runtime;
+#endif
+  std::lock_guard<std::mutex> lock(mutex_);
+  trigger_ = std::move(trigger);
+  return static_cast<bool>(trigger_);
+}
+
+void RuntimeInterrupter::detach() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  trigger_ = nullptr;
+}
+
+void RuntimeInterrupter::interrupt() {
+  // Held while triggering so detach() cannot return mid-call
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (trigger_) {
+    trigger_();
+  }
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <functional>
+#include <mutex>
+
+namespace rnsandbox {
+
+/**
+ * Aborts the JS running in whichever runtime is attached, from any thread.
+ * Backs SandboxWatchdog::Hooks::interrupt. Only Hermes runtimes can be
+ * interrupted, and only at the async break checks Hermes compiles into
+ * loops and calls; the abort surfaces on the JS thread as a JSError thrown
+ * out of the running call.
+ */
+class RuntimeInterrupter {
+ public:
+  /**
+   * Call on the runtime's JS thread, replacing any attached runtime.
+   * @return false if the runtime cannot be interrupted
+   */
+  bool attach(facebook::jsi::Runtime& runtime);
+
+  /** Call before the attached runtime is destroyed. */
+  void detach();
+
+  void interrupt();
+
+ private:
+  std::function<void()> trigger_;
+  std::mutex mutex_;
+};
+
+} // namespace rnsandbox
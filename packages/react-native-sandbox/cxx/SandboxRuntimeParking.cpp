@@ -0,0 +1,187 @@
+#include "SandboxRuntimeParking.h"
+
+#include <iterator>
+#include <utility>
+
+namespace rnsandbox {
+
+namespace {
+
+void callReleaseHook(
+    const std::vector<SandboxRuntimeParking::ParkId>& ids,
+    const SandboxRuntimeParking::ReleaseHook& hook) {
+  if (!hook) {
+    return;
+  }
+  for (auto id : ids) {
+    hook(id);
+  }
+}
+
+} // namespace
+
+SandboxRuntimeParking& SandboxRuntimeParking::getInstance() {
+  static SandboxRuntimeParking instance;
+  return instance;
+}
+
+std::string SandboxRuntimeParking::makeKey(
+    const std::vector<std::string>& parts) {
+  std::string key;
+  for (const auto& part : parts) {
+    // Parts are origins, URLs and names, none of which contain NUL
+    key += part;
+    key.push_back('\0');
+  }
+  return key;
+}
+
+void SandboxRuntimeParking::setReleaseHook(ReleaseHook hook) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  releaseHook_ = std::move(hook);
+}
+
+void SandboxRuntimeParking::setBudget(const ParkingBudget& budget) {
+  std::vector<ParkId> released;
+  ReleaseHook hook;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = budget;
+    while (!entries_.empty() &&
+           (entries_.size() > budget_.maxRuntimes ||
+            parkedBytes_ > budget_.maxBytes)) {
+      released.push_back(popOldest());
+      ++stats_.evicted;
+    }
+    hook = releaseHook_;
+  }
+  callReleaseHook(released, hook);
+}
+
+ParkingBudget SandboxRuntimeParking::budget() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_;
+}
+
+SandboxRuntimeParking::ParkId SandboxRuntimeParking::park(
+    const std::string& key,
+    size_t heapBytes,
+    Clock::time_point now) {
+  std::vector<ParkId> released;
+  ReleaseHook hook;
+  ParkId id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (budget_.maxRuntimes == 0 || heapBytes > budget_.maxBytes) {
+      return 0;
+    }
+    while (!entries_.empty() &&
+           (entries_.size() + 1 > budget_.maxRuntimes ||
+            parkedBytes_ + heapBytes > budget_.maxBytes)) {
+      released.push_back(popOldest());
+      ++stats_.evicted;
+    }
+    id = nextId_++;
+    entries_.push_back({id, key, heapBytes, now});
+    parkedBytes_ += heapBytes;
+    hook = releaseHook_;
+  }
+  callReleaseHook(released, hook);
+  return id;
+}
+
+SandboxRuntimeParking::ParkId SandboxRuntimeParking::take(
+    const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+    if (it->key == key) {
+      ParkId id = it->id;
+      parkedBytes_ -= it->heapBytes;
+      entries_.erase(std::next(it).base());
+      ++stats_.reattached;
+      return id;
+    }
+  }
+  return 0;
+}
+
+bool SandboxRuntimeParking::release(ParkId id) {
+  ReleaseHook hook;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.begin();
+    while (it != entries_.end() && it->id != id) {
+      ++it;
+    }
+    if (it == entries_.end()) {
+      return false;
+    }
+    parkedBytes_ -= it->heapBytes;
+    entries_.erase(it);
+    ++stats_.evicted;
+    hook = releaseHook_;
+  }
+  callReleaseHook({id}, hook);
+  return true;
+}
+
+size_t SandboxRuntimeParking::expire(Clock::time_point now) {
+  std::vector<ParkId> released;
+  ReleaseHook hook;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Parked in order, so the expired ones are at the front
+    while (!entries_.empty() &&
+           now - entries_.front().parkedAt >= budget_.gracePeriod) {
+      released.push_back(popOldest());
+      ++stats_.expired;
+    }
+    hook = releaseHook_;
+  }
+  callReleaseHook(released, hook);
+  return released.size();
+}
+
+size_t SandboxRuntimeParking::releaseAll() {
+  std::vector<ParkId> released;
+  ReleaseHook hook;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : entries_) {
+      released.push_back(entry.id);
+    }
+    stats_.evicted += entries_.size();
+    entries_.clear();
+    parkedBytes_ = 0;
+    hook = releaseHook_;
+  }
+  callReleaseHook(released, hook);
+  return released.size();
+}
+
+SandboxRuntimeParking::ParkId SandboxRuntimeParking::popOldest() {
+  ParkId id = entries_.front().id;
+  parkedBytes_ -= entries_.front().heapBytes;
+  entries_.pop_front();
+  return id;
+}
+
+ParkingStats SandboxRuntimeParking::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ParkingStats stats = stats_;
+  stats.parked = entries_.size();
+  stats.parkedBytes = parkedBytes_;
+  return stats;
+}
+
+void SandboxRuntimeParking::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  nextId_ = 1;
+  parkedBytes_ = 0;
+  budget_ = ParkingBudget();
+  stats_ = ParkingStats();
+  releaseHook_ = nullptr;
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rnsandbox {
+
+struct ParkingBudget {
+  // Parked runtimes kept at once; 0 disables parking
+  size_t maxRuntimes = 2;
+  // Sum of the parked runtimes' last heap samples
+  size_t maxBytes = 64 * 1024 * 1024;
+  // How long a runtime stays parked before it is released
+  std::chrono::milliseconds gracePeriod{5000};
+};
+
+struct ParkingStats {
+  size_t parked = 0;
+  size_t parkedBytes = 0;
+  // Runtimes handed to a new view by take()
+  uint64_t reattached = 0;
+  // Released to make room for a newer one, by memory pressure or release()
+  uint64_t evicted = 0;
+  // Released after the grace period
+  uint64_t expired = 0;
+};
+
+/**
+ * Keeps the runtimes of unmounted sandbox views alive for a grace period, so
+ * that a view mounting with the same origin and bundle soon after, e.g. when
+ * a list scrolls back or the user navigates back, takes the running runtime
+ * over instead of evaluating its bundle again.
+ *
+ * The platform owns the parked objects and refers to them by ParkId. Once a
+ * runtime leaves the lot without being taken it is handed to the release
+ * hook, which must tear it down. The oldest runtimes are released first when
+ * a new one would exceed the budget; one that alone exceeds it is not parked.
+ *
+ * Thread-safe. The release hook is called without the lock held.
+ */
+class SandboxRuntimeParking {
+ public:
+  using ParkId = uint64_t;
+  using Clock = std::chrono::steady_clock;
+  using ReleaseHook = std::function<void(ParkId id)>;
+
+  static SandboxRuntimeParking& getInstance();
+
+  /**
+   * Joins the parts that must match for a runtime to be reattached, e.g.
+   * origin, bundle sources and component name.
+   */
+  static std::string makeKey(const std::vector<std::string>& parts);
+
+  void setReleaseHook(ReleaseHook hook);
+
+  void setBudget(const ParkingBudget& budget);
+  ParkingBudget budget() const;
+
+  /**
+   * Parks a runtime of heapBytes under key.
+   * @return Its id, 0 if it does not fit the budget and must be released
+   * by the caller
+   */
+  ParkId park(
+      const std::string& key,
+      size_t heapBytes,
+      Clock::time_point now = Clock::now());
+
+  /**
+   * Removes the most recently parked runtime for key from the lot.
+   * @return Its id, 0 if there is none
+   */
+  ParkId take(const std::string& key);
+
+  /** Releases a parked runtime ahead of time, e.g. evicted for memory. */
+  bool release(ParkId id);
+
+  /** Releases every runtime parked for longer than the grace period. */
+  size_t expire(Clock::time_point now = Clock::now());
+
+  /** Releases every parked runtime, e.g. under critical memory pressure. */
+  size_t releaseAll();
+
+  ParkingStats stats() const;
+
+  /** Forgets every parked runtime without releasing it. For tests. */
+  void reset();
+
+ private:
+  struct Entry {
+    ParkId id;
+    std::string key;
+    size_t heapBytes;
+    Clock::time_point parkedAt;
+  };
+
+  SandboxRuntimeParking() = default;
+  SandboxRuntimeParking(const SandboxRuntimeParking&) = delete;
+  SandboxRuntimeParking& operator=(const SandboxRuntimeParking&) = delete;
+
+  // Requires the lock and a non-empty lot
+  ParkId popOldest();
+
+  // Oldest first
+  std::list<Entry> entries_;
+  ParkId nextId_ = 1;
+  size_t parkedBytes_ = 0;
+  ParkingBudget budget_;
+  ParkingStats stats_;
+  ReleaseHook releaseHook_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rnsandbox {
+
+/**
+ * Incremental SHA-256 (FIPS 180-4), used to verify bundle files without
+ * holding them in memory. Not thread-safe.
+ */
+class Sha256 {
+ public:
+  using Digest = std::array<uint8_t, 32>;
+
+  Sha256();
+
+  void update(const uint8_t* data, size_t size);
+
+  /** Pads and returns the digest; the hasher must not be updated after. */
+  Digest finish();
+
+  static Digest hash(const uint8_t* data, size_t size);
+
+  /** Lowercase hexadecimal form of a digest. */
+  static std::string toHex(const Digest& digest);
+
+ private:
+  void compress(const uint8_t* block);
+
+  std::array<uint32_t, 8> state_;
+  std::array<uint8_t, 64> buffer_;
+  size_t buffered_ = 0;
+  uint64_t length_ = 0;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,94 @@
+#include "SandboxStartupTimeline.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+namespace rnsandbox {
+
+const char* toString(StartupPhase phase) {
+  switch (phase) {
+    case StartupPhase::ViewCreated:
+      return "viewCreated";
+    case StartupPhase::DelegateCreated:
+      return "delegateCreated";
+    case StartupPhase::HostCreated:
+      return "hostCreated";
+    case StartupPhase::BundleLoadStarted:
+      return "bundleLoadStarted";
+    case StartupPhase::BundleLoaded:
+      return "bundleLoaded";
+    case StartupPhase::BindingsInstalled:
+      return "bindingsInstalled";
+    case StartupPhase::ErrorHandlerInstalled:
+      return "errorHandlerInstalled";
+    case StartupPhase::OnMessageRegistered:
+      return "onMessageRegistered";
+    case StartupPhase::FirstFrame:
+      return "firstFrame";
+  }
+  return "";
+}
+
+StartupTimeline::StartupTimeline() : start_(Clock::now()) {}
+
+void StartupTimeline::setTraceHook(TraceHook hook) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  traceHook_ = std::move(hook);
+}
+
+void StartupTimeline::restart(Clock::time_point start) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  start_ = start;
+  offsets_ = Offsets{};
+}
+
+bool StartupTimeline::mark(StartupPhase phase, Clock::time_point at) {
+  TraceHook hook;
+  std::chrono::nanoseconds offset;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = offsets_[static_cast<size_t>(phase)];
+    if (slot) {
+      return false;
+    }
+    offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::max(at, start_) - start_);
+    slot = offset;
+    hook = traceHook_;
+  }
+
+  if (hook) {
+    hook(phase, offset);
+  }
+  return true;
+}
+
+StartupTimeline::Offsets StartupTimeline::offsets() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return offsets_;
+}
+
+std::string StartupTimeline::toJson() const {
+  Offsets offsets = this->offsets();
+  std::string json = "{";
+  for (size_t i = 0; i < kStartupPhaseCount; ++i) {
+    if (i > 0) {
+      json += ',';
+    }
+    json += '"';
+    json += toString(static_cast<StartupPhase>(i));
+    json += "\":";
+    if (offsets[i]) {
+      char value[32];
+      std::snprintf(value, sizeof(value), "%.3f", offsets[i]->count() / 1e6);
+      json += value;
+    } else {
+      json += "null";
+    }
+  }
+  json += '}';
+  return json;
+}
+
+} // namespace rnsandbox
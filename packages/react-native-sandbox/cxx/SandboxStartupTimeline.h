@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace rnsandbox {
+
+/** Cold start phases of a sandbox, in the order they usually complete. */
+enum class StartupPhase : uint8_t {
+  // The platform view was created; the timeline starts here
+  ViewCreated,
+  // The sandbox delegate was set up
+  DelegateCreated,
+  // The React host (and its factory) is being created
+  HostCreated,
+  // The host asked for the bundle
+  BundleLoadStarted,
+  // The bundle was evaluated
+  BundleLoaded,
+  // postMessage, setOnMessage and the sandbox bindings were installed
+  BindingsInstalled,
+  // The post-bundle error handler was installed
+  ErrorHandlerInstalled,
+  // Sandbox JS called setOnMessage for the first time
+  OnMessageRegistered,
+  // The root component's first frame was mounted
+  FirstFrame,
+};
+
+constexpr size_t kStartupPhaseCount = 9;
+
+/** camelCase name, as used in the onStartupTimeline event. */
+const char* toString(StartupPhase phase);
+
+/**
+ * Timestamps of one sandbox instance's startup phases, shared by the
+ * platform view, its delegate and the runtime bindings. Each phase keeps
+ * its first occurrence since the timeline (re)started.
+ *
+ * Thread-safe. The trace hook runs without locks held, on the thread that
+ * marked the phase.
+ */
+class StartupTimeline {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Offsets =
+      std::array<std::optional<std::chrono::nanoseconds>, kStartupPhaseCount>;
+  using TraceHook =
+      std::function<void(StartupPhase, std::chrono::nanoseconds offset)>;
+
+  StartupTimeline();
+
+  /** Called for every newly recorded phase, e.g. to emit a trace event. */
+  void setTraceHook(TraceHook hook);
+
+  /**
+   * Forgets every phase and starts timing again, e.g. when a hibernated
+   * sandbox rebuilds its runtime.
+   */
+  void restart(Clock::time_point start = Clock::now());
+
+  /**
+   * Records the phase unless it was already recorded since the start.
+   * @param at When the phase completed, for phases marked after the fact
+   * @return true if the phase was recorded now
+   */
+  bool mark(StartupPhase phase, Clock::time_point at = Clock::now());
+
+  /** Offsets from the start; nullopt for phases not reached yet. */
+  Offsets offsets() const;
+
+  /** {"viewCreated":0.012,...,"firstFrame":null}, in milliseconds. */
+  std::string toJson() const;
+
+ private:
+  Clock::time_point start_;
+  Offsets offsets_{};
+  TraceHook traceHook_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
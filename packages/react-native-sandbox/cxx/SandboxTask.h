@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rnsandbox {
+
+/**
+ * A move-only void() callable for queued native work. Callables of up to
+ * kInlineSize bytes that are nothrow movable, e.g. a lambda capturing a few
+ * pointers or a whole std::function, are stored inline, so wrapping and
+ * queueing them does not allocate. Larger ones are moved to the heap.
+ */
+class SandboxTask {
+ public:
+  static constexpr size_t kInlineSize = 48;
+
+  template <typename F>
+  static constexpr bool storedInline() {
+    return sizeof(F) <= kInlineSize &&
+        alignof(F) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible<F>::value;
+  }
+
+  SandboxTask() noexcept = default;
+
+  template <
+      typename F,
+      typename = std::enable_if_t<
+          !std::is_same<std::decay_t<F>, SandboxTask>::value>>
+  SandboxTask(F&& callable) {
+    using Callable = std::decay_t<F>;
+    if constexpr (storedInline<Callable>()) {
+      new (storage_) Callable(std::forward<F>(callable));
+      ops_ = &kInlineOps<Callable>;
+    } else {
+      *reinterpret_cast<Callable**>(storage_) =
+          new Callable(std::forward<F>(callable));
+      ops_ = &kHeapOps<Callable>;
+    }
+  }
+
+  SandboxTask(SandboxTask&& other) noexcept {
+    moveFrom(other);
+  }
+
+  SandboxTask& operator=(SandboxTask&& other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  SandboxTask(const SandboxTask&) = delete;
+  SandboxTask& operator=(const SandboxTask&) = delete;
+
+  ~SandboxTask() {
+    reset();
+  }
+
+  explicit operator bool() const noexcept {
+    return ops_ != nullptr;
+  }
+
+  void operator()() {
+    ops_->invoke(storage_);
+  }
+
+  /** Destroys the callable, releasing what it captured. */
+  void reset() noexcept {
+    if (ops_) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void* storage);
+    // Moves the callable in from into the empty to, leaving from empty
+    void (*move)(void* from, void* to) noexcept;
+    void (*destroy)(void* storage) noexcept;
+  };
+
+  template <typename Callable>
+  static constexpr Ops kInlineOps = {
+      [](void* storage) { (*static_cast<Callable*>(storage))(); },
+      [](void* from, void* to) noexcept {
+        auto* callable = static_cast<Callable*>(from);
+        new (to) Callable(std::move(*callable));
+        callable->~Callable();
+      },
+      [](void* storage) noexcept {
+        static_cast<Callable*>(storage)->~Callable();
+      },
+  };
+
+  template <typename Callable>
+  static constexpr Ops kHeapOps = {
+      [](void* storage) { (**static_cast<Callable**>(storage))(); },
+      [](void* from, void* to) noexcept {
+        *static_cast<Callable**>(to) = *static_cast<Callable**>(from);
+      },
+      [](void* storage) noexcept { delete *static_cast<Callable**>(storage); },
+  };
+
+  void moveFrom(SandboxTask& other) noexcept {
+    if (other.ops_) {
+      other.ops_->move(other.storage_, storage_);
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  const Ops* ops_ = nullptr;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,36 @@
+#include "SandboxViewportProximity.h"
+
+#include <algorithm>
+
+namespace rnsandbox {
+
+double distanceToViewport(
+    const ViewportRect& view,
+    const ViewportRect& viewport) {
+  double dx = std::max(
+      {viewport.x - (view.x + view.width),
+       view.x - (viewport.x + viewport.width),
+       0.0});
+  double dy = std::max(
+      {viewport.y - (view.y + view.height),
+       view.y - (viewport.y + viewport.height),
+       0.0});
+  return std::max(dx, dy);
+}
+
+LazyLoadAction nextLazyLoadAction(
+    bool started,
+    double distance,
+    const LazyLoadDistances& distances) {
+  double load = std::max(distances.load, 0.0);
+  if (!started) {
+    return distance <= load ? LazyLoadAction::Start : LazyLoadAction::None;
+  }
+  if (distances.release <= 0) {
+    return LazyLoadAction::None;
+  }
+  return distance > std::max(distances.release, load) ? LazyLoadAction::Release
+                                                      : LazyLoadAction::None;
+}
+
+} // namespace rnsandbox
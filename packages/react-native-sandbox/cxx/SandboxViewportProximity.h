@@ -0,0 +1,45 @@
+#pragma once
+
+namespace rnsandbox {
+
+/** A rectangle in the coordinate space of the window. */
+struct ViewportRect {
+  double x = 0;
+  double y = 0;
+  double width = 0;
+  double height = 0;
+};
+
+/**
+ * How far view lies outside viewport, along the axis where it is farthest;
+ * 0 if they overlap. A view is within distance d of the viewport when it
+ * overlaps the viewport grown by d on every side.
+ */
+double distanceToViewport(
+    const ViewportRect& view,
+    const ViewportRect& viewport);
+
+struct LazyLoadDistances {
+  // Start the runtime once the view comes this close to the viewport
+  double load = 250;
+  // Release it again once the view is farther away than this; 0 never
+  // releases. Never below load, so a view cannot flap at the boundary.
+  double release = 0;
+};
+
+enum class LazyLoadAction {
+  None,
+  Start,
+  Release,
+};
+
+/**
+ * What a lazy sandbox view at distance from the viewport does with its
+ * runtime, given whether it is started.
+ */
+LazyLoadAction nextLazyLoadAction(
+    bool started,
+    double distance,
+    const LazyLoadDistances& distances);
+
+} // namespace rnsandbox
@@ -0,0 +1,174 @@
+#include "SandboxWatchdog.h"
+
+#include <utility>
+#include <vector>
+
+namespace rnsandbox {
+
+SandboxWatchdog& SandboxWatchdog::getInstance() {
+  static SandboxWatchdog instance;
+  return instance;
+}
+
+SandboxWatchdog::~SandboxWatchdog() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  timerCondition_.notify_all();
+  if (timer_.joinable()) {
+    timer_.join();
+  }
+}
+
+SandboxWatchdog::SandboxId SandboxWatchdog::add(Hooks hooks) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SandboxId id = nextId_++;
+  entries_[id].hooks = std::move(hooks);
+  return id;
+}
+
+void SandboxWatchdog::remove(SandboxId id) {
+  Hooks hooks;
+  {
+    std::lock_guard<std::mutex> dispatch(dispatchMutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+      return;
+    }
+    hooks = std::move(it->second.hooks);
+    entries_.erase(it);
+  }
+}
+
+void SandboxWatchdog::setBudget(
+    SandboxId id,
+    std::chrono::milliseconds budget) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it != entries_.end()) {
+    it->second.budget = budget;
+  }
+}
+
+void SandboxWatchdog::beginTask(SandboxId id, const char* task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end()) {
+    return;
+  }
+  Entry& entry = it->second;
+  if (entry.depth++ > 0) {
+    return;
+  }
+  ++entry.generation;
+  ++stats_.tasks;
+  entry.task = task;
+  entry.started = Clock::now();
+  entry.timedOut = false;
+  if (entry.budget.count() <= 0) {
+    entry.deadline = Clock::time_point::max();
+    return;
+  }
+  entry.deadline = entry.started + entry.budget;
+
+  if (!timer_.joinable()) {
+    timer_ = std::thread([this]() { runTimer(); });
+  } else if (entry.deadline < nextWake_) {
+    timerCondition_.notify_one();
+  }
+}
+
+bool SandboxWatchdog::endTask(SandboxId id) {
+  std::lock_guard<std::mutex> dispatch(dispatchMutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end() || it->second.depth == 0) {
+    return false;
+  }
+  Entry& entry = it->second;
+  if (--entry.depth > 0) {
+    return false;
+  }
+  entry.deadline = Clock::time_point::max();
+  return entry.timedOut;
+}
+
+WatchdogStats SandboxWatchdog::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void SandboxWatchdog::reset() {
+  std::map<SandboxId, Entry> entries;
+  {
+    std::lock_guard<std::mutex> dispatch(dispatchMutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries.swap(entries_);
+    stats_ = WatchdogStats();
+  }
+}
+
+void SandboxWatchdog::runTimer() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    auto now = Clock::now();
+    nextWake_ = Clock::time_point::max();
+    std::vector<std::pair<SandboxId, uint64_t>> expired;
+    for (auto& [id, entry] : entries_) {
+      if (entry.depth == 0 || entry.timedOut) {
+        continue;
+      }
+      if (entry.deadline <= now) {
+        expired.emplace_back(id, entry.generation);
+      } else if (entry.deadline < nextWake_) {
+        nextWake_ = entry.deadline;
+      }
+    }
+
+    if (expired.empty()) {
+      if (nextWake_ == Clock::time_point::max()) {
+        timerCondition_.wait(lock);
+      } else {
+        timerCondition_.wait_until(lock, nextWake_);
+      }
+      continue;
+    }
+
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> dispatch(dispatchMutex_);
+      for (auto [id, generation] : expired) {
+        Hooks hooks;
+        std::string task;
+        std::chrono::milliseconds elapsed{};
+        {
+          // The task may have ended since the scan
+          std::lock_guard<std::mutex> relock(mutex_);
+          auto it = entries_.find(id);
+          if (it == entries_.end() || it->second.depth == 0 ||
+              it->second.generation != generation) {
+            continue;
+          }
+          Entry& entry = it->second;
+          entry.timedOut = true;
+          ++stats_.timeouts;
+          hooks = entry.hooks;
+          task = entry.task;
+          elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+              Clock::now() - entry.started);
+        }
+        if (hooks.onTimeout) {
+          hooks.onTimeout(task, elapsed);
+        }
+        if (hooks.interrupt) {
+          hooks.interrupt();
+        }
+      }
+    }
+    lock.lock();
+  }
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace rnsandbox {
+
+struct WatchdogStats {
+  uint64_t tasks = 0;
+  uint64_t timeouts = 0;
+};
+
+/**
+ * Times the tasks the host dispatches onto each sandbox's JS thread (message
+ * delivery, scheduled callbacks) and interrupts the runtime when one runs
+ * past its sandbox's budget, so a runaway loop cannot hold the JS thread, or
+ * a shared host's thread, forever.
+ *
+ * A single timer thread, started with the first task, sleeps until the
+ * earliest deadline of a running task. On a timeout it calls the sandbox's
+ * onTimeout hook and then its interrupt hook, once per task. Both run on the
+ * timer thread and only while the task is still running, so they may use the
+ * runtime's thread-safe interrupt API; after remove() returns neither is
+ * called again.
+ *
+ * Thread-safe. Hooks must not call back into the watchdog.
+ */
+class SandboxWatchdog {
+ public:
+  using SandboxId = uint64_t;
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::chrono::milliseconds kDefaultBudget{10000};
+
+  struct Hooks {
+    // Reports the timeout, e.g. as a fatal error event
+    std::function<void(const std::string& task, std::chrono::milliseconds)>
+        onTimeout;
+    // Asks the runtime to abort the JS it is running; any thread
+    std::function<void()> interrupt;
+  };
+
+  /**
+   * Times one task for as long as it is in scope. Nested scopes of the same
+   * sandbox are part of the outermost one.
+   */
+  class Scope {
+   public:
+    Scope(SandboxWatchdog& watchdog, SandboxId id, const char* task)
+        : watchdog_(watchdog), id_(id) {
+      watchdog_.beginTask(id_, task);
+    }
+    ~Scope() {
+      watchdog_.endTask(id_);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    SandboxWatchdog& watchdog_;
+    SandboxId id_;
+  };
+
+  static SandboxWatchdog& getInstance();
+
+  ~SandboxWatchdog();
+
+  /** Starts watching a sandbox with kDefaultBudget. */
+  SandboxId add(Hooks hooks);
+
+  /** Stops watching; waits for a hook call in progress to return. */
+  void remove(SandboxId id);
+
+  /** Applies from the next task. Zero disables the watchdog. */
+  void setBudget(SandboxId id, std::chrono::milliseconds budget);
+
+  /** Call on the sandbox's JS thread; prefer Scope. Unknown ids are ignored. */
+  void beginTask(SandboxId id, const char* task);
+
+  /**
+   * Ends the task begun by the matching beginTask.
+   * @return true if the outermost task ran past its budget
+   */
+  bool endTask(SandboxId id);
+
+  WatchdogStats stats() const;
+
+  /** Forgets every sandbox. For tests. */
+  void reset();
+
+ private:
+  struct Entry {
+    Hooks hooks;
+    std::chrono::milliseconds budget = kDefaultBudget;
+    // Nesting depth of the running task, 0 when idle
+    int depth = 0;
+    // Tells a task apart from the next one of the same sandbox
+    uint64_t generation = 0;
+    std::string task;
+    Clock::time_point started{};
+    // time_point::max() while idle or without a budget
+    Clock::time_point deadline = Clock::time_point::max();
+    bool timedOut = false;
+  };
+
+  SandboxWatchdog() = default;
+  SandboxWatchdog(const SandboxWatchdog&) = delete;
+  SandboxWatchdog& operator=(const SandboxWatchdog&) = delete;
+
+  void runTimer();
+
+  std::map<SandboxId, Entry> entries_;
+  SandboxId nextId_ = 1;
+  WatchdogStats stats_;
+
+  std::thread timer_;
+  std::condition_variable timerCondition_;
+  // When the timer thread wakes up next; earlier deadlines must notify it
+  Clock::time_point nextWake_ = Clock::time_point::max();
+  bool stopping_ = false;
+  // Held around hook calls, taken before mutex_, so that endTask() and
+  // remove() never return while a hook for their sandbox is running
+  std::mutex dispatchMutex_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
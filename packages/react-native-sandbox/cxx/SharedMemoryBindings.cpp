@@ -0,0 +1,505 @@
+#include "SharedMemoryBindings.h"
+#include "SandboxJSIUtils.h"
+#include "SharedMemoryRegion.h"
+
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+struct PendingWait {
+  std::shared_ptr<jsi::Function> resolve;
+  std::shared_ptr<SharedMemoryRegion> region;
+  uint64_t waiterId = 0;
+};
+
+// Per-runtime state touched only on the owning sandbox's JS thread. Owned by
+// the installed host functions and region objects; native wake-ups hold it
+// weakly and only carry the token of the Promise to settle.
+struct SharedMemoryJSState {
+  std::string origin;
+  std::weak_ptr<ISandboxDelegate> delegate;
+  std::unordered_map<uint64_t, PendingWait> pending;
+  uint64_t nextToken = 1;
+
+  ~SharedMemoryJSState() {
+    cancelWaits();
+  }
+
+  // Dequeues the waiters so the regions do not keep them until the next
+  // notify; their Promises are never settled
+  void cancelWaits() {
+    for (auto& entry : pending) {
+      entry.second.region->cancelWait(entry.second.waiterId);
+    }
+    pending.clear();
+  }
+};
+
+void settleWait(
+    jsi::Runtime& rt,
+    SharedMemoryJSState& state,
+    uint64_t token,
+    SharedMemoryWaitResult result) {
+  auto it = state.pending.find(token);
+  if (it == state.pending.end()) {
+    return;
+  }
+  auto resolve = std::move(it->second.resolve);
+  state.pending.erase(it);
+  try {
+    resolve->call(
+        rt,
+        jsi::String::createFromAscii(rt, sharedMemoryWaitResultName(result)));
+  } catch (const jsi::JSError& e) {
+    reportJSError(rt, e);
+  }
+}
+
+// JS ToInt32: wraps modulo 2^32, NaN and infinities become 0
+int32_t toInt32(jsi::Runtime& rt, const jsi::Value& value, const char* fn) {
+  if (!value.isNumber()) {
+    throw jsi::JSError(rt, std::string(fn) + ": value must be a number");
+  }
+  double number = value.getNumber();
+  if (!std::isfinite(number)) {
+    return 0;
+  }
+  double wrapped = std::fmod(std::trunc(number), 4294967296.0);
+  if (wrapped < 0) {
+    wrapped += 4294967296.0;
+  }
+  return static_cast<int32_t>(static_cast<uint32_t>(wrapped));
+}
+
+size_t wordIndex(
+    jsi::Runtime& rt,
+    const SharedMemoryRegion& region,
+    const jsi::Value& value,
+    const char* fn) {
+  double index = value.isNumber() ? value.getNumber() : -1;
+  if (index < 0 || index != std::floor(index) ||
+      index >= static_cast<double>(region.wordCount())) {
+    throw jsi::JSError(
+        rt,
+        std::string(fn) + ": index must be an integer below " +
+            std::to_string(region.wordCount()));
+  }
+  return static_cast<size_t>(index);
+}
+
+// The longest delay setTimeout honours
+constexpr double kMaxWaitTimeoutMs = 2147483647.0;
+
+// undefined, Infinity and anything setTimeout cannot express wait
+// indefinitely. Checked before the integer cast, which would overflow.
+std::chrono::milliseconds
+waitTimeout(jsi::Runtime& rt, const jsi::Value* args, size_t count) {
+  if (count < 3 || args[2].isUndefined()) {
+    return std::chrono::milliseconds(-1);
+  }
+  if (!args[2].isNumber()) {
+    throw jsi::JSError(rt, "waitAsync: timeoutMs must be a number");
+  }
+  double timeout = args[2].getNumber();
+  if (timeout > kMaxWaitTimeoutMs) {
+    return std::chrono::milliseconds(-1);
+  }
+  return std::chrono::milliseconds(
+      static_cast<int64_t>(std::isnan(timeout) ? 0 : std::max(timeout, 0.0)));
+}
+
+std::string statusMessage(
+    SharedMemoryStatus status,
+    const std::string& origin,
+    const std::string& owner,
+    const std::string& name) {
+  switch (status) {
+    case SharedMemoryStatus::InvalidName:
+      return "Shared memory: the sandbox origin, owner and region name must "
+             "be non-empty";
+    case SharedMemoryStatus::InvalidSize:
+      return "createSharedMemory: byteLength must be between 1 and " +
+          std::to_string(SharedMemoryRegistry::kMaxRegionSize);
+    case SharedMemoryStatus::AlreadyExists:
+      return "createSharedMemory: region '" + name +
+          "' already exists with a different size";
+    case SharedMemoryStatus::NotFound:
+      return "attachSharedMemory: sandbox '" + owner + "' has no region '" +
+          name + "'";
+    case SharedMemoryStatus::AccessDenied:
+      return "Access denied: sandboxes '" + origin + "' and '" + owner +
+          "' must both list each other in allowedOrigins";
+    case SharedMemoryStatus::Ok:
+      break;
+  }
+  return "";
+}
+
+// Exposes the region's bytes to JS without copying. Keeps the region alive
+// for as long as the runtime holds the ArrayBuffer.
+class RegionBuffer : public jsi::MutableBuffer {
+ public:
+  explicit RegionBuffer(std::shared_ptr<SharedMemoryRegion> region)
+      : region_(std::move(region)) {}
+
+  size_t size() const override {
+    return region_->byteLength();
+  }
+
+  uint8_t* data() override {
+    return region_->data();
+  }
+
+ private:
+  std::shared_ptr<SharedMemoryRegion> region_;
+};
+
+class SharedMemoryHostObject : public jsi::HostObject {
+ public:
+  SharedMemoryHostObject(
+      std::shared_ptr<SharedMemoryJSState> state,
+      std::shared_ptr<SharedMemoryRegion> region)
+      : state_(std::move(state)), region_(std::move(region)) {}
+
+  ~SharedMemoryHostObject() override {
+    // An owner's region outlives its JS object; it is closed explicitly or
+    // when the owner unregisters. Attachments end with their object.
+    if (!*released_) {
+      SharedMemoryRegistry::getInstance().detach(state_->origin, region_);
+    }
+  }
+
+  jsi::Value get(jsi::Runtime& rt, const jsi::PropNameID& propName) override {
+    std::string name = propName.utf8(rt);
+
+    if (name == "buffer") {
+      if (!buffer_) {
+        buffer_ = std::make_shared<jsi::Value>(jsi::ArrayBuffer(
+            rt, std::make_shared<RegionBuffer>(region_)));
+      }
+      return jsi::Value(rt, *buffer_);
+    }
+    if (name == "name") {
+      return jsi::String::createFromUtf8(rt, region_->name());
+    }
+    if (name == "owner") {
+      return jsi::String::createFromUtf8(rt, region_->owner());
+    }
+    if (name == "byteLength") {
+      return jsi::Value(static_cast<double>(region_->byteLength()));
+    }
+    if (name == "closed") {
+      return jsi::Value(region_->isClosed());
+    }
+    if (name == "load") {
+      return method(rt, "load", 1, [](auto& rt, auto& region, auto* args) {
+        return jsi::Value(region.load(wordIndex(rt, region, args[0], "load")));
+      });
+    }
+    if (name == "store") {
+      return method(rt, "store", 2, [](auto& rt, auto& region, auto* args) {
+        int32_t value = toInt32(rt, args[1], "store");
+        region.store(wordIndex(rt, region, args[0], "store"), value);
+        return jsi::Value(value);
+      });
+    }
+    if (name == "add") {
+      return method(rt, "add", 2, [](auto& rt, auto& region, auto* args) {
+        int32_t delta = toInt32(rt, args[1], "add");
+        return jsi::Value(
+            region.add(wordIndex(rt, region, args[0], "add"), delta));
+      });
+    }
+    if (name == "exchange") {
+      return method(rt, "exchange", 2, [](auto& rt, auto& region, auto* args) {
+        int32_t value = toInt32(rt, args[1], "exchange");
+        return jsi::Value(region.exchange(
+            wordIndex(rt, region, args[0], "exchange"), value));
+      });
+    }
+    if (name == "compareExchange") {
+      return method(
+          rt, "compareExchange", 3, [](auto& rt, auto& region, auto* args) {
+            int32_t expected = toInt32(rt, args[1], "compareExchange");
+            int32_t desired = toInt32(rt, args[2], "compareExchange");
+            return jsi::Value(region.compareExchange(
+                wordIndex(rt, region, args[0], "compareExchange"),
+                expected,
+                desired));
+          });
+    }
+    if (name == "waitAsync") {
+      return createWaitAsync(rt);
+    }
+    if (name == "notify") {
+      return createNotify(rt);
+    }
+    if (name == "close") {
+      return createClose(rt);
+    }
+    return jsi::Value::undefined();
+  }
+
+  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime& rt) override {
+    std::vector<jsi::PropNameID> names;
+    for (const char* name :
+         {"buffer",
+          "name",
+          "owner",
+          "byteLength",
+          "closed",
+          "load",
+          "store",
+          "add",
+          "exchange",
+          "compareExchange",
+          "waitAsync",
+          "notify",
+          "close"}) {
+      names.push_back(jsi::PropNameID::forAscii(rt, name));
+    }
+    return names;
+  }
+
+ private:
+  // Word operations take a fixed number of arguments and never block
+  template <typename Op>
+  jsi::Value method(jsi::Runtime& rt, const char* name, size_t arity, Op op) {
+    return jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, name),
+        static_cast<unsigned int>(arity),
+        [region = region_, name = std::string(name), arity, op](
+            jsi::Runtime& rt,
+            const jsi::Value&,
+            const jsi::Value* args,
+            size_t count) -> jsi::Value {
+          if (count < arity) {
+            throw jsi::JSError(
+                rt,
+                name + ": expected " + std::to_string(arity) + " arguments");
+          }
+          return op(rt, *region, args);
+        });
+  }
+
+  jsi::Value createWaitAsync(jsi::Runtime& rt) {
+    return jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "waitAsync"),
+        3,
+        [state = state_, region = region_](
+            jsi::Runtime& rt,
+            const jsi::Value&,
+            const jsi::Value* args,
+            size_t count) -> jsi::Value {
+          if (count < 2) {
+            throw jsi::JSError(
+                rt,
+                "waitAsync(index, expected, timeoutMs?): expected 2 "
+                "arguments");
+          }
+          size_t index = wordIndex(rt, *region, args[0], "waitAsync");
+          int32_t expected = toInt32(rt, args[1], "waitAsync");
+          auto timeout = waitTimeout(rt, args, count);
+
+          std::shared_ptr<jsi::Function> resolve;
+          std::shared_ptr<jsi::Function> reject;
+          jsi::Value promise = createPromise(rt, resolve, reject);
+
+          uint64_t token = state->nextToken++;
+          auto onWake = [weakState = std::weak_ptr<SharedMemoryJSState>(state),
+                         delegate = state->delegate,
+                         token](SharedMemoryWaitResult result) {
+            auto strongDelegate = delegate.lock();
+            if (!strongDelegate) {
+              return;
+            }
+            strongDelegate->scheduleOnJSThread(
+                [weakState, token, result](jsi::Runtime& rt) {
+                  if (auto strongState = weakState.lock()) {
+                    settleWait(rt, *strongState, token, result);
+                  }
+                });
+          };
+
+          uint64_t waiterId = 0;
+          auto status =
+              region->waitAsync(index, expected, std::move(onWake), waiterId);
+          if (status != SharedMemoryWaitResult::Ok) {
+            resolve->call(
+                rt,
+                jsi::String::createFromAscii(
+                    rt, sharedMemoryWaitResultName(status)));
+            return promise;
+          }
+
+          // Wake-ups always settle through a later JS-thread task, so
+          // registering the resolver after queueing the waiter is race-free
+          state->pending[token] = {std::move(resolve), region, waiterId};
+
+          if (timeout.count() >= 0) {
+            auto onTimeout = jsi::Function::createFromHostFunction(
+                rt,
+                jsi::PropNameID::forAscii(rt, "onTimeout"),
+                0,
+                [region, waiterId](
+                    jsi::Runtime&,
+                    const jsi::Value&,
+                    const jsi::Value*,
+                    size_t) -> jsi::Value {
+                  region->cancelWait(waiterId);
+                  return jsi::Value::undefined();
+                });
+            rt.global().getPropertyAsFunction(rt, "setTimeout").call(
+                rt, onTimeout, static_cast<double>(timeout.count()));
+          }
+          return promise;
+        });
+  }
+
+  jsi::Value createNotify(jsi::Runtime& rt) {
+    return jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "notify"),
+        2,
+        [region = region_](
+            jsi::Runtime& rt,
+            const jsi::Value&,
+            const jsi::Value* args,
+            size_t count) -> jsi::Value {
+          if (count < 1) {
+            throw jsi::JSError(rt, "notify(index, count?): expected an index");
+          }
+          size_t index = wordIndex(rt, *region, args[0], "notify");
+          size_t wakeCount = static_cast<size_t>(-1);
+          if (count > 1 && args[1].isNumber() &&
+              std::isfinite(args[1].getNumber())) {
+            wakeCount = static_cast<size_t>(std::max(args[1].getNumber(), 0.0));
+          }
+          size_t woken = region->notify(index, wakeCount);
+          return jsi::Value(static_cast<double>(woken));
+        });
+  }
+
+  jsi::Value createClose(jsi::Runtime& rt) {
+    return jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "close"),
+        0,
+        [state = state_, region = region_, released = released_](
+            jsi::Runtime&,
+            const jsi::Value&,
+            const jsi::Value*,
+            size_t) -> jsi::Value {
+          if (!*released) {
+            *released = true;
+            SharedMemoryRegistry::getInstance().release(state->origin, region);
+          }
+          return jsi::Value::undefined();
+        });
+  }
+
+  std::shared_ptr<SharedMemoryJSState> state_;
+  std::shared_ptr<SharedMemoryRegion> region_;
+  std::shared_ptr<jsi::Value> buffer_;
+  // Shared with close(), which may outlive this object
+  std::shared_ptr<bool> released_ = std::make_shared<bool>(false);
+};
+
+} // namespace
+
+void installSharedMemoryBindings(
+    jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    SandboxJSHandlers& handlers) {
+  auto state = std::make_shared<SharedMemoryJSState>();
+  state->origin = origin;
+  state->delegate = std::move(delegate);
+  handlers.add([weakState = std::weak_ptr<SharedMemoryJSState>(state)]() {
+    if (auto strongState = weakState.lock()) {
+      strongState->cancelWaits();
+    }
+  });
+
+  auto createSharedMemory = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "createSharedMemory"),
+      2,
+      [state](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count != 2 || !args[0].isString() || !args[1].isNumber()) {
+          throw jsi::JSError(
+              rt,
+              "createSharedMemory(name, byteLength): name must be a string "
+              "and byteLength a number");
+        }
+        std::string name = args[0].getString(rt).utf8(rt);
+        double byteLength = args[1].getNumber();
+        if (!(byteLength >= 0) || byteLength != std::floor(byteLength)) {
+          byteLength = 0;
+        }
+
+        std::shared_ptr<SharedMemoryRegion> region;
+        auto status = SharedMemoryRegistry::getInstance().create(
+            state->origin,
+            name,
+            byteLength > SharedMemoryRegistry::kMaxRegionSize
+                ? 0
+                : static_cast<size_t>(byteLength),
+            region);
+        if (status != SharedMemoryStatus::Ok) {
+          throw jsi::JSError(
+              rt, statusMessage(status, state->origin, state->origin, name));
+        }
+        return jsi::Object::createFromHostObject(
+            rt, std::make_shared<SharedMemoryHostObject>(state, region));
+      });
+
+  auto attachSharedMemory = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "attachSharedMemory"),
+      2,
+      [state](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count != 2 || !args[0].isString() || !args[1].isString()) {
+          throw jsi::JSError(
+              rt,
+              "attachSharedMemory(ownerOrigin, name): both arguments must be "
+              "strings");
+        }
+        std::string owner = args[0].getString(rt).utf8(rt);
+        std::string name = args[1].getString(rt).utf8(rt);
+
+        std::shared_ptr<SharedMemoryRegion> region;
+        auto status = SharedMemoryRegistry::getInstance().attach(
+            state->origin, owner, name, region);
+        if (status != SharedMemoryStatus::Ok) {
+          throw jsi::JSError(
+              rt, statusMessage(status, state->origin, owner, name));
+        }
+        return jsi::Object::createFromHostObject(
+            rt, std::make_shared<SharedMemoryHostObject>(state, region));
+      });
+
+  defineSandboxGlobal(
+      runtime, "createSharedMemory", std::move(createSharedMemory));
+  defineSandboxGlobal(
+      runtime, "attachSharedMemory", std::move(attachSharedMemory));
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include <string>
+#include "ISandboxDelegate.h"
+#include "SandboxJSHandlers.h"
+
+namespace rnsandbox {
+
+/**
+ * Installs the SharedMemoryRegistry globals into a sandbox runtime:
+ *
+ *   createSharedMemory(name, byteLength) => region
+ *   attachSharedMemory(ownerOrigin, name) => region
+ *
+ * A region exposes `buffer`, an ArrayBuffer over the shared bytes (no copy),
+ * plus Atomics-like operations on its 32-bit words: load, store, add,
+ * exchange, compareExchange, notify(index, count?) and the Promise-based
+ * waitAsync(index, expected, timeoutMs?), which resolves to 'ok',
+ * 'not-equal', 'timed-out' or 'closed'. There is no blocking wait: it would
+ * hold the JS thread that teardown, hibernation and the watchdog need.
+ * close() on the owner's last open handle closes the region for everyone;
+ * any other close() only gives up that handle.
+ *
+ * @param runtime The sandbox runtime, on its JS thread
+ * @param origin Origin of the sandbox owning the runtime
+ * @param delegate Registry delegate used to settle waitAsync on the JS thread
+ * @param handlers Receives the reset of the unsettled waitAsync promises
+ */
+void installSharedMemoryBindings(
+    facebook::jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    SandboxJSHandlers& handlers);
+
+} // namespace rnsandbox
@@ -0,0 +1,383 @@
+#include "SharedMemoryRegion.h"
+#include "SandboxRegistry.h"
+
+#include <algorithm>
+
+namespace rnsandbox {
+
+// The words double as the raw bytes handed to JS, so the atomics must be
+// plain, lock-free 32-bit integers.
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t));
+static_assert(std::atomic<int32_t>::is_always_lock_free);
+
+const char* sharedMemoryWaitResultName(SharedMemoryWaitResult result) {
+  switch (result) {
+    case SharedMemoryWaitResult::Ok:
+      return "ok";
+    case SharedMemoryWaitResult::NotEqual:
+      return "not-equal";
+    case SharedMemoryWaitResult::TimedOut:
+      return "timed-out";
+    case SharedMemoryWaitResult::Closed:
+      return "closed";
+  }
+  return "unknown";
+}
+
+SharedMemoryRegion::SharedMemoryRegion(
+    std::string owner,
+    std::string name,
+    size_t byteLength)
+    : owner_(std::move(owner)),
+      name_(std::move(name)),
+      byteLength_(byteLength),
+      wordCount_(std::max<size_t>(1, (byteLength + 3) / 4)),
+      words_(new std::atomic<int32_t>[wordCount_]) {
+  for (size_t i = 0; i < wordCount_; ++i) {
+    words_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+int32_t SharedMemoryRegion::load(size_t index) const {
+  return word(index).load();
+}
+
+void SharedMemoryRegion::store(size_t index, int32_t value) {
+  word(index).store(value);
+}
+
+int32_t SharedMemoryRegion::add(size_t index, int32_t delta) {
+  return word(index).fetch_add(delta);
+}
+
+int32_t SharedMemoryRegion::exchange(size_t index, int32_t value) {
+  return word(index).exchange(value);
+}
+
+int32_t SharedMemoryRegion::compareExchange(
+    size_t index,
+    int32_t expected,
+    int32_t desired) {
+  word(index).compare_exchange_strong(expected, desired);
+  return expected;
+}
+
+SharedMemoryWaitResult SharedMemoryRegion::wait(
+    size_t index,
+    int32_t expected,
+    std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(waitMutex_);
+  if (closed_) {
+    return SharedMemoryWaitResult::Closed;
+  }
+  if (word(index).load() != expected) {
+    return SharedMemoryWaitResult::NotEqual;
+  }
+
+  auto waiter = std::make_shared<Waiter>();
+  waiter->id = nextWaiterId_++;
+  waiter->index = index;
+  waiters_.push_back(waiter);
+
+  auto woken = [&waiter] { return waiter->woken; };
+  if (timeout.count() < 0) {
+    waitCondition_.wait(lock, woken);
+  } else if (!waitCondition_.wait_for(lock, timeout, woken)) {
+    waiters_.remove(waiter);
+    return SharedMemoryWaitResult::TimedOut;
+  }
+  return waiter->result;
+}
+
+SharedMemoryWaitResult SharedMemoryRegion::waitAsync(
+    size_t index,
+    int32_t expected,
+    WaitCallback callback,
+    uint64_t& waiterId) {
+  waiterId = 0;
+  std::lock_guard<std::mutex> lock(waitMutex_);
+  if (closed_) {
+    return SharedMemoryWaitResult::Closed;
+  }
+  if (word(index).load() != expected) {
+    return SharedMemoryWaitResult::NotEqual;
+  }
+
+  auto waiter = std::make_shared<Waiter>();
+  waiter->id = nextWaiterId_++;
+  waiter->index = index;
+  waiter->callback = std::move(callback);
+  waiters_.push_back(waiter);
+  waiterId = waiter->id;
+  return SharedMemoryWaitResult::Ok;
+}
+
+bool SharedMemoryRegion::cancelWait(uint64_t waiterId) {
+  std::shared_ptr<Waiter> cancelled;
+  {
+    std::lock_guard<std::mutex> lock(waitMutex_);
+    auto it = std::find_if(
+        waiters_.begin(), waiters_.end(), [waiterId](const auto& waiter) {
+          return waiter->id == waiterId && waiter->callback;
+        });
+    if (it == waiters_.end()) {
+      return false;
+    }
+    cancelled = std::move(*it);
+    waiters_.erase(it);
+  }
+  cancelled->callback(SharedMemoryWaitResult::TimedOut);
+  return true;
+}
+
+size_t SharedMemoryRegion::notify(size_t index, size_t count) {
+  std::vector<std::shared_ptr<Waiter>> asyncWaiters;
+  size_t wokenCount = 0;
+  {
+    std::lock_guard<std::mutex> lock(waitMutex_);
+    for (auto it = waiters_.begin();
+         it != waiters_.end() && wokenCount < count;) {
+      auto& waiter = *it;
+      if (waiter->index != index) {
+        ++it;
+        continue;
+      }
+      waiter->woken = true;
+      waiter->result = SharedMemoryWaitResult::Ok;
+      if (waiter->callback) {
+        asyncWaiters.push_back(waiter);
+      }
+      it = waiters_.erase(it);
+      ++wokenCount;
+    }
+  }
+
+  if (wokenCount > asyncWaiters.size()) {
+    waitCondition_.notify_all();
+  }
+  for (auto& waiter : asyncWaiters) {
+    waiter->callback(SharedMemoryWaitResult::Ok);
+  }
+  return wokenCount;
+}
+
+void SharedMemoryRegion::close() {
+  std::vector<std::shared_ptr<Waiter>> asyncWaiters;
+  {
+    std::lock_guard<std::mutex> lock(waitMutex_);
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    for (auto& waiter : waiters_) {
+      waiter->woken = true;
+      waiter->result = SharedMemoryWaitResult::Closed;
+      if (waiter->callback) {
+        asyncWaiters.push_back(waiter);
+      }
+    }
+    waiters_.clear();
+  }
+
+  waitCondition_.notify_all();
+  for (auto& waiter : asyncWaiters) {
+    waiter->callback(SharedMemoryWaitResult::Closed);
+  }
+}
+
+bool SharedMemoryRegion::isClosed() const {
+  std::lock_guard<std::mutex> lock(waitMutex_);
+  return closed_;
+}
+
+size_t SharedMemoryRegion::waiterCount() const {
+  std::lock_guard<std::mutex> lock(waitMutex_);
+  return waiters_.size();
+}
+
+class SharedMemoryRegistry::RegistryObserver
+    : public ISandboxRegistryObserver {
+ public:
+  explicit RegistryObserver(SharedMemoryRegistry& registry)
+      : registry_(registry) {}
+
+  void onSandboxRegistered(const std::string&) override {}
+
+  void onSandboxUnregistered(const std::string& origin) override {
+    registry_.releaseAll(origin);
+  }
+
+ private:
+  SharedMemoryRegistry& registry_;
+};
+
+SharedMemoryRegistry& SharedMemoryRegistry::getInstance() {
+  static SharedMemoryRegistry instance;
+  return instance;
+}
+
+SharedMemoryRegistry::SharedMemoryRegistry()
+    : registryObserver_(std::make_shared<RegistryObserver>(*this)) {
+  SandboxRegistry::getInstance().addObserver(registryObserver_);
+}
+
+SharedMemoryRegistry::~SharedMemoryRegistry() {
+  SandboxRegistry::getInstance().removeObserver(registryObserver_);
+}
+
+SharedMemoryStatus SharedMemoryRegistry::create(
+    const std::string& origin,
+    const std::string& name,
+    size_t byteLength,
+    std::shared_ptr<SharedMemoryRegion>& region) {
+  if (origin.empty() || name.empty()) {
+    return SharedMemoryStatus::InvalidName;
+  }
+  if (byteLength == 0 || byteLength > kMaxRegionSize) {
+    return SharedMemoryStatus::InvalidSize;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& entry = regions_[RegionKey(origin, name)];
+  if (entry.region) {
+    if (entry.region->byteLength() != byteLength) {
+      return SharedMemoryStatus::AlreadyExists;
+    }
+  } else {
+    entry.region =
+        std::make_shared<SharedMemoryRegion>(origin, name, byteLength);
+  }
+  ++entry.owners;
+  region = entry.region;
+  return SharedMemoryStatus::Ok;
+}
+
+SharedMemoryStatus SharedMemoryRegistry::attach(
+    const std::string& origin,
+    const std::string& owner,
+    const std::string& name,
+    std::shared_ptr<SharedMemoryRegion>& region) {
+  if (origin.empty() || owner.empty() || name.empty()) {
+    return SharedMemoryStatus::InvalidName;
+  }
+  // Checked before taking mutex_: the registry notifies us under its own
+  // locking and we must not invert the order
+  if (origin != owner) {
+    auto& sandboxRegistry = SandboxRegistry::getInstance();
+    if (!sandboxRegistry.isPermittedFrom(origin, owner) ||
+        !sandboxRegistry.isPermittedFrom(owner, origin)) {
+      return SharedMemoryStatus::AccessDenied;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = regions_.find(RegionKey(owner, name));
+  if (it == regions_.end()) {
+    return SharedMemoryStatus::NotFound;
+  }
+  if (origin != owner) {
+    ++it->second.attached[origin];
+  } else {
+    ++it->second.owners;
+  }
+  region = it->second.region;
+  return SharedMemoryStatus::Ok;
+}
+
+void SharedMemoryRegistry::release(
+    const std::string& origin,
+    const std::shared_ptr<SharedMemoryRegion>& region) {
+  if (dropHandle(origin, region, true)) {
+    region->close();
+  }
+}
+
+void SharedMemoryRegistry::detach(
+    const std::string& origin,
+    const std::shared_ptr<SharedMemoryRegion>& region) {
+  dropHandle(origin, region, false);
+}
+
+bool SharedMemoryRegistry::dropHandle(
+    const std::string& origin,
+    const std::shared_ptr<SharedMemoryRegion>& region,
+    bool closeOnLast) {
+  if (!region) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = regions_.find(RegionKey(region->owner(), region->name()));
+  if (it == regions_.end() || it->second.region != region) {
+    return false;
+  }
+  if (origin != region->owner()) {
+    auto& attached = it->second.attached;
+    auto count = attached.find(origin);
+    if (count != attached.end() && --count->second == 0) {
+      attached.erase(count);
+    }
+    return false;
+  }
+  auto& owners = it->second.owners;
+  if (owners > 0) {
+    --owners;
+  }
+  // Other instances of the owner still use the region
+  if (owners > 0 || !closeOnLast) {
+    return false;
+  }
+  regions_.erase(it);
+  return true;
+}
+
+void SharedMemoryRegistry::releaseAll(const std::string& origin) {
+  std::vector<std::shared_ptr<SharedMemoryRegion>> toClose;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = regions_.begin(); it != regions_.end();) {
+      if (it->first.first == origin) {
+        toClose.push_back(std::move(it->second.region));
+        it = regions_.erase(it);
+      } else {
+        it->second.attached.erase(origin);
+        ++it;
+      }
+    }
+  }
+  for (auto& region : toClose) {
+    region->close();
+  }
+}
+
+size_t SharedMemoryRegistry::regionCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return regions_.size();
+}
+
+std::set<std::string> SharedMemoryRegistry::attachedOrigins(
+    const std::string& owner,
+    const std::string& name) const {
+  std::set<std::string> origins;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = regions_.find(RegionKey(owner, name));
+  if (it != regions_.end()) {
+    for (const auto& attached : it->second.attached) {
+      origins.insert(attached.first);
+    }
+  }
+  return origins;
+}
+
+void SharedMemoryRegistry::reset() {
+  std::map<RegionKey, Entry> regions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions.swap(regions_);
+  }
+  for (auto& entry : regions) {
+    entry.second.region->close();
+  }
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ISandboxRegistryObserver.h"
+
+namespace rnsandbox {
+
+enum class SharedMemoryStatus {
+  Ok,
+  InvalidName,
+  InvalidSize,
+  AlreadyExists,
+  NotFound,
+  AccessDenied,
+};
+
+/** Outcome of a wait, named after the results of JS Atomics.wait. */
+enum class SharedMemoryWaitResult {
+  Ok,
+  NotEqual,
+  TimedOut,
+  Closed,
+};
+
+/** Human-readable name of a wait result, as returned to JS. */
+const char* sharedMemoryWaitResultName(SharedMemoryWaitResult result);
+
+/**
+ * A fixed-size block of memory mapped into every sandbox that attached it.
+ *
+ * The block is viewed as 32-bit words for the atomic operations, which are
+ * sequentially consistent like JS Atomics on an Int32Array. wait()/notify()
+ * park and wake threads per word index, futex-style: a waiter checks the
+ * word and enqueues itself under the same lock notify() takes, so a store
+ * followed by notify() can never be missed.
+ *
+ * Closing a region wakes every waiter with Closed. The memory itself stays
+ * valid until the last reference (including JS ArrayBuffers) is dropped.
+ *
+ * Word indexes must be below wordCount(); callers validate them.
+ */
+class SharedMemoryRegion {
+ public:
+  using WaitCallback = std::function<void(SharedMemoryWaitResult)>;
+
+  SharedMemoryRegion(std::string owner, std::string name, size_t byteLength);
+
+  SharedMemoryRegion(const SharedMemoryRegion&) = delete;
+  SharedMemoryRegion& operator=(const SharedMemoryRegion&) = delete;
+
+  const std::string& owner() const {
+    return owner_;
+  }
+  const std::string& name() const {
+    return name_;
+  }
+  size_t byteLength() const {
+    return byteLength_;
+  }
+  size_t wordCount() const {
+    return wordCount_;
+  }
+  uint8_t* data() {
+    return reinterpret_cast<uint8_t*>(words_.get());
+  }
+
+  int32_t load(size_t index) const;
+  void store(size_t index, int32_t value);
+  /** @return The previous value */
+  int32_t add(size_t index, int32_t delta);
+  /** @return The previous value */
+  int32_t exchange(size_t index, int32_t value);
+  /** @return The previous value; the swap happened if it equals expected */
+  int32_t compareExchange(size_t index, int32_t expected, int32_t desired);
+
+  /**
+   * Blocks until notified, if the word still holds expected.
+   * @param timeout Negative waits indefinitely
+   */
+  SharedMemoryWaitResult
+  wait(size_t index, int32_t expected, std::chrono::milliseconds timeout);
+
+  /**
+   * Non-blocking wait. If the word holds expected, the callback is queued
+   * and invoked exactly once, on the notifying or closing thread (or inside
+   * cancelWait()); otherwise it is never invoked.
+   * @param waiterId Set to an id for cancelWait(), or 0 if not queued
+   * @return Ok if queued, NotEqual or Closed otherwise
+   */
+  SharedMemoryWaitResult waitAsync(
+      size_t index,
+      int32_t expected,
+      WaitCallback callback,
+      uint64_t& waiterId);
+
+  /**
+   * Dequeues an async waiter and completes it with TimedOut.
+   * @return false if it was already woken
+   */
+  bool cancelWait(uint64_t waiterId);
+
+  /**
+   * Wakes up to count waiters on index, oldest first.
+   * @return Number of woken waiters
+   */
+  size_t notify(size_t index, size_t count = static_cast<size_t>(-1));
+
+  /** Wakes every waiter with Closed and makes further waits fail. */
+  void close();
+
+  bool isClosed() const;
+
+  size_t waiterCount() const;
+
+ private:
+  struct Waiter {
+    uint64_t id = 0;
+    size_t index = 0;
+    bool woken = false;
+    SharedMemoryWaitResult result = SharedMemoryWaitResult::Ok;
+    // Set for async waiters only
+    WaitCallback callback;
+  };
+
+  std::atomic<int32_t>& word(size_t index) const {
+    return words_[index];
+  }
+
+  const std::string owner_;
+  const std::string name_;
+  const size_t byteLength_;
+  const size_t wordCount_;
+  std::unique_ptr<std::atomic<int32_t>[]> words_;
+
+  std::list<std::shared_ptr<Waiter>> waiters_;
+  std::condition_variable waitCondition_;
+  uint64_t nextWaiterId_ = 1;
+  bool closed_ = false;
+  mutable std::mutex waitMutex_;
+};
+
+/**
+ * Process-wide table of named shared memory regions.
+ *
+ * Regions are named per owner origin, so origins cannot collide or squat on
+ * each other's names. Another origin may attach a region only if the
+ * allowedOrigins of both sides admit each other in SandboxRegistry, since
+ * the memory is readable and writable in both directions.
+ *
+ * Regions owned by an origin are closed as soon as it leaves
+ * SandboxRegistry; attachments of an unregistered origin are dropped.
+ */
+class SharedMemoryRegistry {
+ public:
+  static constexpr size_t kMaxRegionSize = 64 * 1024 * 1024;
+
+  static SharedMemoryRegistry& getInstance();
+
+  ~SharedMemoryRegistry();
+
+  /**
+   * Creates a zero-filled region owned by origin. Creating a name the
+   * origin already owns with the same size returns the existing region, so
+   * a reloaded sandbox or another instance of the origin gets the same
+   * memory. Each call returns one owner handle.
+   */
+  SharedMemoryStatus create(
+      const std::string& origin,
+      const std::string& name,
+      size_t byteLength,
+      std::shared_ptr<SharedMemoryRegion>& region);
+
+  /**
+   * Attaches origin to a region created by owner. The owner attaching its
+   * own region gets an owner handle.
+   */
+  SharedMemoryStatus attach(
+      const std::string& origin,
+      const std::string& owner,
+      const std::string& name,
+      std::shared_ptr<SharedMemoryRegion>& region);
+
+  /**
+   * Gives up one handle of a region by origin. The owner's last handle
+   * closes and removes it; any other origin drops one attachment.
+   */
+  void release(
+      const std::string& origin,
+      const std::shared_ptr<SharedMemoryRegion>& region);
+
+  /**
+   * As release(), but an owner's region stays open after its last handle,
+   * until the owner closes a new handle or unregisters. For handles that
+   * go away without being closed, e.g. with a reloaded runtime.
+   */
+  void detach(
+      const std::string& origin,
+      const std::shared_ptr<SharedMemoryRegion>& region);
+
+  /** Closes the regions origin owns and drops its attachments. */
+  void releaseAll(const std::string& origin);
+
+  size_t regionCount() const;
+
+  /** Origins currently attached to a region, excluding its owner. */
+  std::set<std::string> attachedOrigins(
+      const std::string& owner,
+      const std::string& name) const;
+
+  void reset();
+
+ private:
+  class RegistryObserver;
+
+  using RegionKey = std::pair<std::string, std::string>;
+
+  struct Entry {
+    std::shared_ptr<SharedMemoryRegion> region;
+    // Owner handles; each JS region object of an owner instance holds one
+    size_t owners = 0;
+    // Attach count per origin; each JS region object holds one
+    std::map<std::string, size_t> attached;
+  };
+
+  SharedMemoryRegistry();
+  SharedMemoryRegistry(const SharedMemoryRegistry&) = delete;
+  SharedMemoryRegistry& operator=(const SharedMemoryRegistry&) = delete;
+
+  // Drops one handle; true if it was the owner's last and closing is due
+  bool dropHandle(
+      const std::string& origin,
+      const std::shared_ptr<SharedMemoryRegion>& region,
+      bool closeOnLast);
+
+  std::map<RegionKey, Entry> regions_;
+  std::shared_ptr<RegistryObserver> registryObserver_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace rnsandbox
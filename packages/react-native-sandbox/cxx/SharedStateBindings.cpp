@@ -0,0 +1,282 @@
+#include "SharedStateBindings.h"
+#include "SandboxJSIUtils.h"
+#include "SharedStateStore.h"
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace jsi = facebook::jsi;
+
+namespace rnsandbox {
+
+namespace {
+
+const char* statusMessage(SharedStateStatus status) {
+  switch (status) {
+    case SharedStateStatus::InvalidKey:
+      return "sharedState: key must be a non-empty string";
+    case SharedStateStatus::AccessDenied:
+      return "sharedState: this sandbox may not write that key";
+    default:
+      return "sharedState: write failed";
+  }
+}
+
+/**
+ * Collects changed keys from any writer thread and hands them to the
+ * sandbox's subscribers once per frame. Only the mutex-guarded members are
+ * touched off the JS thread.
+ */
+class SharedStateSubscription
+    : public ISharedStateListener,
+      public std::enable_shared_from_this<SharedStateSubscription> {
+ public:
+  explicit SharedStateSubscription(std::weak_ptr<ISandboxDelegate> delegate)
+      : delegate_(std::move(delegate)) {}
+
+  void onSharedStateChanged(const std::string& key) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!active_) {
+        return;
+      }
+      pendingKeys_.insert(key);
+      if (flushScheduled_) {
+        return;
+      }
+      flushScheduled_ = true;
+    }
+
+    auto delegate = delegate_.lock();
+    bool scheduled = delegate &&
+        delegate->scheduleOnJSThread(
+            [weakSelf = weak_from_this()](jsi::Runtime& rt) {
+              if (auto self = weakSelf.lock()) {
+                self->flushOnNextFrame(rt);
+              }
+            });
+    if (!scheduled) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pendingKeys_.clear();
+      flushScheduled_ = false;
+    }
+  }
+
+  // JS thread only
+  uint64_t subscribe(std::shared_ptr<jsi::Function> callback) {
+    uint64_t id = nextSubscriberId_++;
+    subscribers_.emplace_back(id, std::move(callback));
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_ = true;
+    return id;
+  }
+
+  // JS thread only
+  void unsubscribe(uint64_t id) {
+    subscribers_.erase(
+        std::remove_if(
+            subscribers_.begin(),
+            subscribers_.end(),
+            [id](const auto& entry) { return entry.first == id; }),
+        subscribers_.end());
+    if (subscribers_.empty()) {
+      deactivate();
+    }
+  }
+
+  // JS thread only
+  void unsubscribeAll() {
+    subscribers_.clear();
+    deactivate();
+  }
+
+ private:
+  void deactivate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_ = false;
+    pendingKeys_.clear();
+  }
+
+  void flushOnNextFrame(jsi::Runtime& rt) {
+    jsi::Value raf = rt.global().getProperty(rt, "requestAnimationFrame");
+    if (!raf.isObject() || !raf.asObject(rt).isFunction(rt)) {
+      deliver(rt);
+      return;
+    }
+    auto flush = jsi::Function::createFromHostFunction(
+        rt,
+        jsi::PropNameID::forAscii(rt, "flushSharedState"),
+        0,
+        [weakSelf = weak_from_this()](
+            jsi::Runtime& rt, const jsi::Value&, const jsi::Value*, size_t)
+            -> jsi::Value {
+          if (auto self = weakSelf.lock()) {
+            self->deliver(rt);
+          }
+          return jsi::Value::undefined();
+        });
+    raf.asObject(rt).asFunction(rt).call(rt, flush);
+  }
+
+  void deliver(jsi::Runtime& rt) {
+    std::set<std::string> keys;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      keys.swap(pendingKeys_);
+      flushScheduled_ = false;
+    }
+    if (keys.empty()) {
+      return;
+    }
+
+    jsi::Array changed(rt, keys.size());
+    size_t index = 0;
+    for (const auto& key : keys) {
+      changed.setValueAtIndex(
+          rt, index++, jsi::String::createFromUtf8(rt, key));
+    }
+    auto version = static_cast<double>(
+        SharedStateStore::getInstance().snapshot()->version);
+
+    // Callbacks may unsubscribe while we iterate
+    auto subscribers = subscribers_;
+    for (const auto& entry : subscribers) {
+      try {
+        entry.second->call(rt, changed, version);
+      } catch (const jsi::JSError& e) {
+        reportJSError(rt, e);
+      }
+    }
+  }
+
+  std::weak_ptr<ISandboxDelegate> delegate_;
+
+  std::mutex mutex_;
+  std::set<std::string> pendingKeys_;
+  bool flushScheduled_ = false;
+  bool active_ = false;
+
+  std::vector<std::pair<uint64_t, std::shared_ptr<jsi::Function>>>
+      subscribers_;
+  uint64_t nextSubscriberId_ = 1;
+};
+
+class SharedStateHostObject : public jsi::HostObject {
+ public:
+  SharedStateHostObject(
+      std::string origin,
+      std::shared_ptr<SharedStateSubscription> subscription)
+      : origin_(std::move(origin)), subscription_(std::move(subscription)) {}
+
+  ~SharedStateHostObject() override {
+    SharedStateStore::getInstance().removeListener(subscription_);
+  }
+
+  jsi::Value get(jsi::Runtime& rt, const jsi::PropNameID& name) override {
+    std::shared_ptr<const std::string> value;
+    SharedStateStore::getInstance().read(origin_, name.utf8(rt), value);
+    return value ? parseJSON(rt, *value) : jsi::Value::undefined();
+  }
+
+  void set(
+      jsi::Runtime& rt,
+      const jsi::PropNameID& name,
+      const jsi::Value& value) override {
+    std::optional<std::string> json;
+    if (!value.isUndefined()) {
+      json = stringifyJSON(rt, value);
+    }
+    auto status = SharedStateStore::getInstance().write(
+        origin_, name.utf8(rt), std::move(json));
+    if (status != SharedStateStatus::Ok) {
+      throw jsi::JSError(rt, statusMessage(status));
+    }
+  }
+
+  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime& rt) override {
+    auto& store = SharedStateStore::getInstance();
+    std::vector<jsi::PropNameID> names;
+    for (const auto& entry : store.snapshot()->values) {
+      if (store.canRead(origin_, entry.first)) {
+        names.push_back(jsi::PropNameID::forUtf8(rt, entry.first));
+      }
+    }
+    return names;
+  }
+
+  const std::shared_ptr<SharedStateSubscription>& subscription() const {
+    return subscription_;
+  }
+
+ private:
+  std::string origin_;
+  std::shared_ptr<SharedStateSubscription> subscription_;
+};
+
+} // namespace
+
+void installSharedStateBindings(
+    jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    SandboxJSHandlers& handlers) {
+  auto subscription =
+      std::make_shared<SharedStateSubscription>(std::move(delegate));
+  SharedStateStore::getInstance().addListener(origin, subscription);
+  handlers.add(
+      [weakSubscription =
+           std::weak_ptr<SharedStateSubscription>(subscription)]() {
+        if (auto strongSubscription = weakSubscription.lock()) {
+          strongSubscription->unsubscribeAll();
+        }
+      });
+  auto hostObject =
+      std::make_shared<SharedStateHostObject>(origin, subscription);
+
+  auto subscribeSharedState = jsi::Function::createFromHostFunction(
+      runtime,
+      jsi::PropNameID::forAscii(runtime, "subscribeSharedState"),
+      1,
+      [hostObject](
+          jsi::Runtime& rt,
+          const jsi::Value&,
+          const jsi::Value* args,
+          size_t count) -> jsi::Value {
+        if (count != 1 || !args[0].isObject() ||
+            !args[0].asObject(rt).isFunction(rt)) {
+          throw jsi::JSError(
+              rt, "subscribeSharedState(listener): expected a function");
+        }
+        std::weak_ptr<SharedStateSubscription> subscription =
+            hostObject->subscription();
+        uint64_t id = hostObject->subscription()->subscribe(
+            std::make_shared<jsi::Function>(
+                args[0].asObject(rt).asFunction(rt)));
+
+        return jsi::Function::createFromHostFunction(
+            rt,
+            jsi::PropNameID::forAscii(rt, "unsubscribe"),
+            0,
+            [subscription, id](
+                jsi::Runtime&, const jsi::Value&, const jsi::Value*, size_t)
+                -> jsi::Value {
+              if (auto strong = subscription.lock()) {
+                strong->unsubscribe(id);
+              }
+              return jsi::Value::undefined();
+            });
+      });
+
+  defineSandboxGlobal(
+      runtime,
+      "sharedState",
+      jsi::Object::createFromHostObject(runtime, hostObject));
+  defineSandboxGlobal(
+      runtime, "subscribeSharedState", std::move(subscribeSharedState));
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include <string>
+#include "ISandboxDelegate.h"
+#include "SandboxJSHandlers.h"
+
+namespace rnsandbox {
+
+/**
+ * Installs the SharedStateStore globals into a sandbox runtime:
+ *
+ *   sharedState[key]            synchronous read of a JSON value
+ *   sharedState[key] = value    write (undefined deletes)
+ *   Object.keys(sharedState)    keys this sandbox may read
+ *   subscribeSharedState((changedKeys, version) => void) => unsubscribe
+ *
+ * Reads of keys outside the sandbox's read list look unset; writes outside
+ * its write list throw. Change notifications are coalesced: all keys changed
+ * before the next animation frame arrive in a single call.
+ *
+ * @param runtime The sandbox runtime, on its JS thread
+ * @param origin Origin of the sandbox owning the runtime
+ * @param delegate Registry delegate used to schedule work on the JS thread
+ * @param handlers Receives the reset of the subscribeSharedState listeners
+ */
+void installSharedStateBindings(
+    facebook::jsi::Runtime& runtime,
+    const std::string& origin,
+    std::weak_ptr<ISandboxDelegate> delegate,
+    SandboxJSHandlers& handlers);
+
+} // namespace rnsandbox
@@ -0,0 +1,208 @@
+#include "SharedStateStore.h"
+#include <algorithm>
+#include "SandboxRegistry.h"
+
+namespace rnsandbox {
+
+class SharedStateStore::RegistryObserver : public ISandboxRegistryObserver {
+ public:
+  explicit RegistryObserver(SharedStateStore& store) : store_(store) {}
+
+  void onSandboxRegistered(const std::string&) override {}
+
+  // Only once the last sandbox of the origin is gone; other instances of it
+  // keep reading and writing
+  void onSandboxUnregistered(const std::string& origin) override {
+    store_.removeAccess(origin);
+  }
+
+ private:
+  SharedStateStore& store_;
+};
+
+SharedStateStore& SharedStateStore::getInstance() {
+  static SharedStateStore instance;
+  return instance;
+}
+
+SharedStateStore::SharedStateStore()
+    : snapshot_(std::make_shared<const SharedStateSnapshot>()),
+      registryObserver_(std::make_shared<RegistryObserver>(*this)) {
+  SandboxRegistry::getInstance().addObserver(registryObserver_);
+}
+
+SharedStateStore::~SharedStateStore() {
+  SandboxRegistry::getInstance().removeObserver(registryObserver_);
+}
+
+void SharedStateStore::setAccess(
+    const std::string& origin,
+    const std::set<std::string>& readKeys,
+    const std::set<std::string>& writeKeys) {
+  if (origin.empty()) {
+    return;
+  }
+
+  Access access{OriginMatcher(readKeys), OriginMatcher(writeKeys)};
+  std::unique_lock<std::shared_mutex> lock(accessMutex_);
+  access_[origin] = std::move(access);
+}
+
+void SharedStateStore::removeAccess(const std::string& origin) {
+  std::unique_lock<std::shared_mutex> lock(accessMutex_);
+  access_.erase(origin);
+}
+
+bool SharedStateStore::canRead(
+    const std::string& origin,
+    const std::string& key) const {
+  std::shared_lock<std::shared_mutex> lock(accessMutex_);
+  auto it = access_.find(origin);
+  return it != access_.end() && it->second.read.matches(key);
+}
+
+bool SharedStateStore::canWrite(
+    const std::string& origin,
+    const std::string& key) const {
+  std::shared_lock<std::shared_mutex> lock(accessMutex_);
+  auto it = access_.find(origin);
+  return it != access_.end() && it->second.write.matches(key);
+}
+
+std::shared_ptr<const SharedStateSnapshot> SharedStateStore::snapshot() const {
+  return std::atomic_load(&snapshot_);
+}
+
+SharedStateStatus SharedStateStore::read(
+    const std::string& origin,
+    const std::string& key,
+    std::shared_ptr<const std::string>& value) const {
+  value.reset();
+  if (key.empty()) {
+    return SharedStateStatus::InvalidKey;
+  }
+  if (!canRead(origin, key)) {
+    return SharedStateStatus::AccessDenied;
+  }
+
+  auto current = snapshot();
+  auto it = current->values.find(key);
+  if (it != current->values.end()) {
+    value = it->second;
+  }
+  return SharedStateStatus::Ok;
+}
+
+SharedStateStatus SharedStateStore::write(
+    const std::string& origin,
+    const std::string& key,
+    std::optional<std::string> json) {
+  if (key.empty()) {
+    return SharedStateStatus::InvalidKey;
+  }
+  if (!canWrite(origin, key)) {
+    return SharedStateStatus::AccessDenied;
+  }
+  return commit(key, std::move(json));
+}
+
+SharedStateStatus SharedStateStore::hostWrite(
+    const std::string& key,
+    std::optional<std::string> json) {
+  if (key.empty()) {
+    return SharedStateStatus::InvalidKey;
+  }
+  return commit(key, std::move(json));
+}
+
+SharedStateStatus SharedStateStore::commit(
+    const std::string& key,
+    std::optional<std::string> json) {
+  {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    auto current = std::atomic_load(&snapshot_);
+
+    auto existing = current->values.find(key);
+    bool present = existing != current->values.end();
+    if (json ? present && *existing->second == *json : !present) {
+      return SharedStateStatus::Ok;
+    }
+
+    auto next = std::make_shared<SharedStateSnapshot>(*current);
+    next->version = current->version + 1;
+    if (json) {
+      next->values[key] =
+          std::make_shared<const std::string>(std::move(*json));
+    } else {
+      next->values.erase(key);
+    }
+    std::atomic_store(
+        &snapshot_, std::shared_ptr<const SharedStateSnapshot>(next));
+  }
+
+  notifyListeners(key);
+  return SharedStateStatus::Ok;
+}
+
+void SharedStateStore::addListener(
+    const std::string& origin,
+    const std::shared_ptr<ISharedStateListener>& listener) {
+  if (origin.empty() || !listener) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(listenersMutex_);
+  listeners_.emplace_back(origin, listener);
+}
+
+void SharedStateStore::removeListener(
+    const std::shared_ptr<ISharedStateListener>& listener) {
+  std::lock_guard<std::mutex> lock(listenersMutex_);
+  listeners_.erase(
+      std::remove_if(
+          listeners_.begin(),
+          listeners_.end(),
+          [&listener](const auto& entry) {
+            auto strong = entry.second.lock();
+            return !strong || strong == listener;
+          }),
+      listeners_.end());
+}
+
+void SharedStateStore::notifyListeners(const std::string& key) {
+  std::vector<std::pair<std::string, std::shared_ptr<ISharedStateListener>>>
+      listeners;
+  {
+    std::lock_guard<std::mutex> lock(listenersMutex_);
+    for (auto it = listeners_.begin(); it != listeners_.end();) {
+      if (auto strong = it->second.lock()) {
+        listeners.emplace_back(it->first, std::move(strong));
+        ++it;
+      } else {
+        it = listeners_.erase(it);
+      }
+    }
+  }
+
+  for (const auto& [origin, listener] : listeners) {
+    if (canRead(origin, key)) {
+      listener->onSharedStateChanged(key);
+    }
+  }
+}
+
+void SharedStateStore::reset() {
+  {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::atomic_store(
+        &snapshot_,
+        std::shared_ptr<const SharedStateSnapshot>(
+            std::make_shared<const SharedStateSnapshot>()));
+  }
+  {
+    std::unique_lock<std::shared_mutex> lock(accessMutex_);
+    access_.clear();
+  }
+}
+
+} // namespace rnsandbox
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "OriginMatcher.h"
+
+namespace rnsandbox {
+
+enum class SharedStateStatus {
+  Ok,
+  InvalidKey,
+  AccessDenied,
+};
+
+/** Immutable view of the whole store at one version. */
+struct SharedStateSnapshot {
+  uint64_t version = 0;
+  // JSON-serialized values
+  std::map<std::string, std::shared_ptr<const std::string>> values;
+};
+
+/** Told about every key its origin may read, right after it changes. */
+class ISharedStateListener {
+ public:
+  virtual ~ISharedStateListener() = default;
+
+  /** Runs on the writing thread, without store locks held. */
+  virtual void onSharedStateChanged(const std::string& key) = 0;
+};
+
+/**
+ * Process-wide versioned key/value store shared by all sandboxes.
+ *
+ * Values are JSON strings. Every write publishes a new copy-on-write
+ * snapshot, so readers grab the current one without locking and never wait
+ * for a writer; writers copy the key table (values are shared), which suits
+ * slowly-changing config and session state rather than hot counters.
+ *
+ * Each origin may read and write only the keys matched by its access lists,
+ * which use the same exact/`prefix*` syntax as allowedOrigins. Origins
+ * without access lists can do neither. The host app writes through
+ * hostWrite(), which is not subject to the lists. An origin's lists are
+ * dropped once its last sandbox unregisters from SandboxRegistry.
+ */
+class SharedStateStore {
+ public:
+  static SharedStateStore& getInstance();
+
+  void setAccess(
+      const std::string& origin,
+      const std::set<std::string>& readKeys,
+      const std::set<std::string>& writeKeys);
+
+  void removeAccess(const std::string& origin);
+
+  bool canRead(const std::string& origin, const std::string& key) const;
+
+  bool canWrite(const std::string& origin, const std::string& key) const;
+
+  std::shared_ptr<const SharedStateSnapshot> snapshot() const;
+
+  /**
+   * Reads one key as origin.
+   * @param value Set to the JSON value, or nullptr if the key is unset
+   */
+  SharedStateStatus read(
+      const std::string& origin,
+      const std::string& key,
+      std::shared_ptr<const std::string>& value) const;
+
+  /**
+   * Writes one key as origin. std::nullopt deletes the key. Writing the
+   * current value again is a no-op and does not notify listeners.
+   */
+  SharedStateStatus write(
+      const std::string& origin,
+      const std::string& key,
+      std::optional<std::string> json);
+
+  /** Writes one key on behalf of the host app, bypassing access lists. */
+  SharedStateStatus hostWrite(
+      const std::string& key,
+      std::optional<std::string> json);
+
+  /**
+   * Subscribes a listener to changes of the keys origin may read. Held
+   * weakly; expired listeners are dropped on the next write.
+   */
+  void addListener(
+      const std::string& origin,
+      const std::shared_ptr<ISharedStateListener>& listener);
+
+  void removeListener(const std::shared_ptr<ISharedStateListener>& listener);
+
+  void reset();
+
+ private:
+  class RegistryObserver;
+
+  struct Access {
+    OriginMatcher read;
+    OriginMatcher write;
+  };
+
+  SharedStateStore();
+  ~SharedStateStore();
+  SharedStateStore(const SharedStateStore&) = delete;
+  SharedStateStore& operator=(const SharedStateStore&) = delete;
+
+  SharedStateStatus commit(
+      const std::string& key,
+      std::optional<std::string> json);
+  void notifyListeners(const std::string& key);
+
+  std::shared_ptr<const SharedStateSnapshot> snapshot_;
+  // Serializes writers; readers only load snapshot_
+  std::mutex writeMutex_;
+
+  std::map<std::string, Access> access_;
+  mutable std::shared_mutex accessMutex_;
+
+  std::vector<std::pair<std::string, std::weak_ptr<ISharedStateListener>>>
+      listeners_;
+  std::mutex listenersMutex_;
+
+  std::shared_ptr<RegistryObserver> registryObserver_;
+};
+
+} // namespace rnsandbox
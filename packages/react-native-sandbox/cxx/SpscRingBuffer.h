@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace rnsandbox {
+
+/**
+ * Bounded lock-free single-producer/single-consumer ring buffer.
+ *
+ * Exactly one thread may call tryPush() and exactly one (possibly different)
+ * thread may call tryPop() at any time. Capacity is rounded up to the next
+ * power of two so that slot indexing is a mask instead of a modulo.
+ *
+ * Head and tail counters grow monotonically and live on separate cache lines
+ * so the producer and consumer do not false-share.
+ */
+template <typename T>
+class SpscRingBuffer {
+ public:
+  explicit SpscRingBuffer(size_t capacity)
+      : capacity_(roundUpToPowerOfTwo(capacity)),
+        mask_(capacity_ - 1),
+        slots_(new T[capacity_]) {}
+
+  SpscRingBuffer(const SpscRingBuffer&) = delete;
+  SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+  /**
+   * Producer side. Moves the value into the buffer.
+   * @return false if the buffer is full (the value is left untouched)
+   */
+  bool tryPush(T&& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cachedHead_ == capacity_) {
+      cachedHead_ = head_.load(std::memory_order_acquire);
+      if (tail - cachedHead_ == capacity_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side. Moves the oldest value out of the buffer.
+   * @return false if the buffer is empty
+   */
+  bool tryPop(T& out) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cachedTail_) {
+      cachedTail_ = tail_.load(std::memory_order_acquire);
+      if (head == cachedTail_) {
+        return false;
+      }
+    }
+    out = std::move(slots_[head & mask_]);
+    slots_[head & mask_] = T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  /** Approximate number of queued elements; exact when both sides are idle. */
+  size_t sizeApprox() const {
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    const size_t head = head_.load(std::memory_order_acquire);
+    return tail - head;
+  }
+
+  bool empty() const {
+    return sizeApprox() == 0;
+  }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  static size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<T[]> slots_;
+
+  // Consumer-owned
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t cachedTail_{0};
+
+  // Producer-owned
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t cachedHead_{0};
+};
+
+} // namespace rnsandbox
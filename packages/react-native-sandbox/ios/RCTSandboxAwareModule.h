@@ -2,6 +2,29 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ * How many sandboxes share one instance of a substituted module. Mirrors rnsandbox::ModuleSharing.
+ */
+typedef NS_ENUM(NSInteger, RCTSandboxModuleSharing) {
+  /** An instance per sandbox, configured with its origin. The default. */
+  RCTSandboxModuleSharingPerSandbox = 0,
+  /** One instance per origin, configured with the first sandbox's names. */
+  RCTSandboxModuleSharingPerOrigin,
+  /** One instance per group returned by sandboxSharingGroupForOrigin:. */
+  RCTSandboxModuleSharingPerGroup,
+  /**
+   * One instance for the process. The module keeps no per-sandbox state and reads the calling sandbox's origin
+   * from RCTSandboxCurrentOrigin() in its methods.
+   */
+  RCTSandboxModuleSharingPerProcess,
+};
+
+/**
+ * The origin of the sandbox whose method call is running on this thread, nil outside of a call to a substituted
+ * module. Calls a module dispatches onward itself run without it.
+ */
+FOUNDATION_EXPORT NSString *_Nullable RCTSandboxCurrentOrigin(void);
+
 /**
  * ObjC protocol equivalent of ISandboxAwareModule for ObjC TurboModules.
  *
@@ -36,6 +59,22 @@ NS_ASSUME_NONNULL_BEGIN
                      requestedName:(NSString *)requestedName
                       resolvedName:(NSString *)resolvedName;
 
+@optional
+
+/**
+ * How many sandboxes share an instance of this module, RCTSandboxModuleSharingPerSandbox if not implemented.
+ * A shared instance is created and configured once, by the first sandbox to resolve it, and released with the last
+ * sandbox using it; it must not keep state of any single sandbox beyond its sharing scope. Release resources in
+ * dealloc: a host tearing down may invalidate the instance while other sandboxes still use it.
+ */
++ (RCTSandboxModuleSharing)sandboxModuleSharing;
+
+/**
+ * The group an origin's sandboxes share an instance in under RCTSandboxModuleSharingPerGroup. Returning nil shares
+ * per origin.
+ */
++ (nullable NSString *)sandboxSharingGroupForOrigin:(NSString *)origin;
+
 @end
 
 NS_ASSUME_NONNULL_END
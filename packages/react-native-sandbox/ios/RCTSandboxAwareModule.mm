@@ -0,0 +1,17 @@
+//
+//  RCTSandboxAwareModule.mm
+//  react-native-sandbox
+//
+
+#import "RCTSandboxAwareModule.h"
+
+#include "SandboxModuleSharing.h"
+
+NSString *_Nullable RCTSandboxCurrentOrigin(void)
+{
+  const rnsandbox::SandboxContext *context = rnsandbox::SandboxContextScope::current();
+  if (!context) {
+    return nil;
+  }
+  return [NSString stringWithUTF8String:context->origin.c_str()];
+}
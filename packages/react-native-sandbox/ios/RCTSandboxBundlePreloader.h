@@ -0,0 +1,49 @@
+//
+//  RCTSandboxBundlePreloader.h
+//  react-native-sandbox
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Loads sandbox bundles in the background before their views exist, typically from the app delegate at launch.
+ * Remote bundles are downloaded into the caches directory and verified; a sandbox whose jsBundleSource finished
+ * preloading then starts from that file. Bundles served by the Metro packager are not preloaded.
+ */
+@interface RCTSandboxBundlePreloader : NSObject
+
+/**
+ * Starts loading every source that is not loading or loaded yet, on a bounded pool of background threads.
+ * @param sources jsBundleSource values, as passed to SandboxReactNativeView
+ */
++ (void)preload:(NSArray<NSString *> *)sources;
+
+/**
+ * How many bundles are loaded at once. Defaults to 4.
+ */
++ (void)setMaxConcurrentLoads:(NSUInteger)count;
+
+/**
+ * The local file a source was preloaded into, or nil while it is loading, failed or was never preloaded.
+ */
++ (nullable NSURL *)preloadedURLForSource:(NSString *)source;
+
+/**
+ * Preloads source unless it is loading or loaded already, then waits for it. Blocks, so call it off the main thread.
+ * @return The local file holding the bundle, or nil if it failed or did not finish within the timeout
+ */
++ (nullable NSURL *)awaitPreloadedURLForSource:(NSString *)source
+                                       timeout:(NSTimeInterval)timeout
+                                         error:(NSError *_Nullable *_Nullable)error;
+
+/**
+ * Resolves a jsBundleSource to the URL React Native loads it from: a URL as is, a .jsbundle from the main bundle,
+ * anything else as a bundle root on the packager.
+ */
++ (nullable NSURL *)URLForBundleSource:(NSString *)source;
+
+@end
+
+NS_ASSUME_NONNULL_END
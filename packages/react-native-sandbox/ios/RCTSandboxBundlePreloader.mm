@@ -0,0 +1,245 @@
+//
+//  RCTSandboxBundlePreloader.mm
+//  react-native-sandbox
+//
+
+#import "RCTSandboxBundlePreloader.h"
+
+#import <React/RCTBundleURLProvider.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include "SandboxBundlePatch.h"
+#include "SandboxBundlePreloader.h"
+
+namespace {
+
+NSString *const kCacheDirectoryName = @"RNSandboxBundles";
+NSString *const kErrorDomain = @"RNSandboxBundlePreloader";
+
+// Bundle roots resolve to the packager, whose bundles must stay live for Fast Refresh
+bool isPackagerSource(NSString *source)
+{
+  NSURL *url = [NSURL URLWithString:source];
+  return !(url && url.scheme) && ![source hasSuffix:@".jsbundle"];
+}
+
+NSURL *cacheFileURL(const std::string &source)
+{
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSURL *caches = [fileManager URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask].firstObject;
+  NSURL *directory = [caches URLByAppendingPathComponent:kCacheDirectoryName isDirectory:YES];
+  [fileManager createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:nil];
+  auto name = fmt::format("{:016x}.jsbundle", std::hash<std::string>{}(source));
+  return [directory URLByAppendingPathComponent:[NSString stringWithUTF8String:name.c_str()]];
+}
+
+rnsandbox::PreloadResult failure(NSString *message)
+{
+  rnsandbox::PreloadResult result;
+  result.error = message.UTF8String ?: "";
+  return result;
+}
+
+// Blocks until url is downloaded to file; the status is 0 if the request failed
+NSInteger downloadToFile(NSURL *url, NSURL *file, NSError **error)
+{
+  __block NSInteger status = 0;
+  __block NSError *taskError = nil;
+  dispatch_semaphore_t done = dispatch_semaphore_create(0);
+  NSURLSessionDownloadTask *task = [[NSURLSession sharedSession]
+      downloadTaskWithURL:url
+        completionHandler:^(NSURL *location, NSURLResponse *response, NSError *downloadError) {
+          taskError = downloadError;
+          if (location) {
+            // location is deleted once the handler returns
+            [[NSFileManager defaultManager] removeItemAtURL:file error:nil];
+            NSError *moveError = nil;
+            if ([[NSFileManager defaultManager] moveItemAtURL:location toURL:file error:&moveError]) {
+              status = [response isKindOfClass:[NSHTTPURLResponse class]] ? ((NSHTTPURLResponse *)response).statusCode
+                                                                          : 200;
+            } else {
+              taskError = moveError;
+            }
+          }
+          dispatch_semaphore_signal(done);
+        }];
+  [task resume];
+  dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+  if (error) {
+    *error = taskError;
+  }
+  return status;
+}
+
+// Updates a cached copy of url from <url>.patches/<SHA-256 of the copy>, if the server has such a patch
+bool patchCachedBundle(NSURL *url, NSURL *file)
+{
+  std::string hash = rnsandbox::hashBundleFile(file.path.UTF8String);
+  if (hash.empty()) {
+    return false;
+  }
+  NSString *patchURLString = [NSString stringWithFormat:@"%@.patches/%s", url.absoluteString, hash.c_str()];
+  NSURL *patchURL = [NSURL URLWithString:patchURLString];
+  NSURL *patchFile = [file URLByAppendingPathExtension:@"patch"];
+  NSError *error = nil;
+  NSInteger status = downloadToFile(patchURL, patchFile, &error);
+
+  bool patched = false;
+  if (status >= 200 && status < 300) {
+    // Streams the patch from disk; the cached copy is replaced only once the result verifies
+    std::string patchError;
+    std::string path = file.path.UTF8String;
+    patched = rnsandbox::applyBundlePatch(path, patchFile.path.UTF8String, path, &patchError);
+    if (!patched) {
+      NSLog(@"[RCTSandboxBundlePreloader] Patch for %@ failed, downloading it whole: %s", url, patchError.c_str());
+    }
+  }
+  [[NSFileManager defaultManager] removeItemAtURL:patchFile error:nil];
+  return patched;
+}
+
+// Runs on a preloader worker thread, which may block
+rnsandbox::PreloadResult fetchBundle(const std::string &source)
+{
+  @autoreleasepool {
+    NSString *sourceNS = [NSString stringWithUTF8String:source.c_str()];
+    if (isPackagerSource(sourceNS)) {
+      return failure(@"Packager bundles are not preloaded");
+    }
+    NSURL *url = [RCTSandboxBundlePreloader URLForBundleSource:sourceNS];
+    if (!url) {
+      return failure([NSString stringWithFormat:@"Bundle not found: %@", sourceNS]);
+    }
+
+    if (url.isFileURL) {
+      // Reading verifies the file and warms the page cache for the real load
+      NSError *error = nil;
+      NSData *data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:&error];
+      if (data.length == 0) {
+        return failure(error.localizedDescription ?: @"Bundle is empty");
+      }
+      rnsandbox::PreloadResult result;
+      result.path = url.path.UTF8String;
+      return result;
+    }
+
+    NSURL *file = cacheFileURL(source);
+    if (patchCachedBundle(url, file)) {
+      rnsandbox::PreloadResult result;
+      result.path = file.path.UTF8String;
+      return result;
+    }
+
+    __block NSData *data = nil;
+    __block NSURLResponse *response = nil;
+    __block NSError *error = nil;
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    NSURLSessionDataTask *task = [[NSURLSession sharedSession]
+          dataTaskWithURL:url
+        completionHandler:^(NSData *taskData, NSURLResponse *taskResponse, NSError *taskError) {
+          data = taskData;
+          response = taskResponse;
+          error = taskError;
+          dispatch_semaphore_signal(done);
+        }];
+    [task resume];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+
+    if (error) {
+      return failure(error.localizedDescription);
+    }
+    NSInteger status = [response isKindOfClass:[NSHTTPURLResponse class]] ? ((NSHTTPURLResponse *)response).statusCode
+                                                                          : 200;
+    if (status < 200 || status >= 300) {
+      return failure([NSString stringWithFormat:@"HTTP %ld for %@", (long)status, url]);
+    }
+    if (data.length == 0) {
+      return failure([NSString stringWithFormat:@"Empty bundle from %@", url]);
+    }
+
+    if (![data writeToURL:file options:NSDataWritingAtomic error:&error]) {
+      return failure(error.localizedDescription);
+    }
+    rnsandbox::PreloadResult result;
+    result.path = file.path.UTF8String;
+    return result;
+  }
+}
+
+rnsandbox::SandboxBundlePreloader &preloader()
+{
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    rnsandbox::SandboxBundlePreloader::getInstance().setFetcher(fetchBundle);
+  });
+  return rnsandbox::SandboxBundlePreloader::getInstance();
+}
+
+} // namespace
+
+@implementation RCTSandboxBundlePreloader
+
++ (void)preload:(NSArray<NSString *> *)sources
+{
+  std::vector<std::string> sourceList;
+  sourceList.reserve(sources.count);
+  for (NSString *source in sources) {
+    sourceList.emplace_back(source.UTF8String ?: "");
+  }
+  preloader().preload(sourceList);
+}
+
++ (void)setMaxConcurrentLoads:(NSUInteger)count
+{
+  preloader().setConcurrency(count);
+}
+
++ (nullable NSURL *)preloadedURLForSource:(NSString *)source
+{
+  auto result = preloader().find(source.UTF8String ?: "");
+  if (!result || !result->ok()) {
+    return nil;
+  }
+  return [NSURL fileURLWithPath:[NSString stringWithUTF8String:result->path.c_str()]];
+}
+
++ (nullable NSURL *)awaitPreloadedURLForSource:(NSString *)source
+                                       timeout:(NSTimeInterval)timeout
+                                         error:(NSError *_Nullable *_Nullable)error
+{
+  std::string sourceString = source.UTF8String ?: "";
+  auto &bundlePreloader = preloader();
+  bundlePreloader.preload({sourceString});
+  auto result = bundlePreloader.wait(sourceString, std::chrono::milliseconds(static_cast<int64_t>(timeout * 1000)));
+  if (result && result->ok()) {
+    return [NSURL fileURLWithPath:[NSString stringWithUTF8String:result->path.c_str()]];
+  }
+  if (error) {
+    NSString *message = result ? [NSString stringWithUTF8String:result->error.c_str()]
+                               : [NSString stringWithFormat:@"Timed out loading %@", source];
+    *error = [NSError errorWithDomain:kErrorDomain code:0 userInfo:@{NSLocalizedDescriptionKey : message}];
+  }
+  return nil;
+}
+
++ (nullable NSURL *)URLForBundleSource:(NSString *)source
+{
+  NSURL *url = [NSURL URLWithString:source];
+  if (url && url.scheme) {
+    return url;
+  }
+
+  if ([source hasSuffix:@".jsbundle"]) {
+    return [[NSBundle mainBundle] URLForResource:source withExtension:nil];
+  }
+
+  NSString *bundleName = [source hasSuffix:@".bundle"] ? [source stringByDeletingPathExtension] : source;
+  return [[RCTBundleURLProvider sharedSettings] jsBundleURLForBundleRoot:bundleName];
+}
+
+@end
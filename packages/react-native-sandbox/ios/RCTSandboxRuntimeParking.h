@@ -0,0 +1,27 @@
+//
+//  RCTSandboxRuntimeParking.h
+//  react-native-sandbox
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Keeps the runtime of an unmounted sandbox view alive for a grace period, so that a view mounting soon after with the
+ * same origin, bundles and component name, e.g. when a list scrolls back, takes the running runtime over instead of
+ * loading its bundle again. Parked runtimes are budgeted by count and by their last sampled JS heap, oldest released
+ * first, and are all released on a memory warning.
+ */
+@interface RCTSandboxRuntimeParking : NSObject
+
+/**
+ * @param count Runtimes parked at once, 2 by default; 0 disables parking
+ * @param bytes Sum of their JS heaps, 64 MiB by default
+ * @param gracePeriod Seconds a runtime stays parked, 5 by default
+ */
++ (void)setMaxParkedRuntimes:(NSUInteger)count maxBytes:(NSUInteger)bytes gracePeriod:(NSTimeInterval)gracePeriod;
+
+@end
+
+NS_ASSUME_NONNULL_END
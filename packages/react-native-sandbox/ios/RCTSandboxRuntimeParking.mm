@@ -0,0 +1,24 @@
+//
+//  RCTSandboxRuntimeParking.mm
+//  react-native-sandbox
+//
+
+#import "RCTSandboxRuntimeParking.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "SandboxRuntimeParking.h"
+
+@implementation RCTSandboxRuntimeParking
+
++ (void)setMaxParkedRuntimes:(NSUInteger)count maxBytes:(NSUInteger)bytes gracePeriod:(NSTimeInterval)gracePeriod
+{
+  rnsandbox::ParkingBudget budget;
+  budget.maxRuntimes = count;
+  budget.maxBytes = bytes;
+  budget.gracePeriod = std::chrono::milliseconds(static_cast<int64_t>(std::max(gracePeriod, 0.0) * 1000));
+  rnsandbox::SandboxRuntimeParking::getInstance().setBudget(budget);
+}
+
+@end
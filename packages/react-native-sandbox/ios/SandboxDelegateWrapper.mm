@@ -11,18 +11,21 @@ SandboxDelegateWrapper::SandboxDelegateWrapper(SandboxReactNativeDelegate *deleg
   }
 }
 
-void SandboxDelegateWrapper::postMessage(const std::string &message)
+void SandboxDelegateWrapper::postMessage(const std::string &message, MessagePriority priority)
 {
   if (!delegate_)
     return;
-  [delegate_ postMessage:message];
+  [delegate_ postMessage:message priority:priority];
 }
 
-bool SandboxDelegateWrapper::routeMessage(const std::string &message, const std::string &targetId)
+bool SandboxDelegateWrapper::routeMessage(
+    const std::string &message,
+    const std::string &targetId,
+    MessagePriority priority)
 {
   if (!delegate_)
     return false;
-  return [delegate_ routeMessage:message toSandbox:targetId];
+  return [delegate_ routeMessage:message toSandbox:targetId priority:priority];
 }
 
 void SandboxDelegateWrapper::setOrigin(const std::string &origin)
@@ -46,4 +49,11 @@ void SandboxDelegateWrapper::setAllowedTurboModules(const std::set<std::string>
   [delegate_ setAllowedTurboModules:modules];
 }
 
+bool SandboxDelegateWrapper::scheduleOnJSThread(std::function<void(facebook::jsi::Runtime &)> work)
+{
+  if (!delegate_)
+    return false;
+  return [delegate_ scheduleOnJSThread:std::move(work)];
+}
+
 } // namespace rnsandbox
\ No newline at end of file
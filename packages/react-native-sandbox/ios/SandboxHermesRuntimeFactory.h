@@ -0,0 +1,38 @@
+#pragma once
+
+#include <react/runtime/JSRuntimeFactory.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#if __has_include(<hermes/hermes.h>)
+#define RNSANDBOX_HAS_HERMES 1
+#else
+#define RNSANDBOX_HAS_HERMES 0
+#endif
+
+namespace rnsandbox {
+
+/**
+ * Creates Hermes runtimes that check for async breaks in the source they
+ * evaluate, so the watchdog can interrupt them, and whose GC heap may be
+ * capped. Mirrors the GC and runtime configuration of React Native's
+ * HermesInstance otherwise. Runtimes are wrapped in a plain
+ * JSIRuntimeHolder, so they do not show up as separate Fusebox debugger
+ * targets.
+ */
+class SandboxHermesRuntimeFactory : public facebook::react::JSRuntimeFactory {
+ public:
+  /** @param maxHeapBytes 0 keeps Hermes' default heap size */
+  SandboxHermesRuntimeFactory(std::string name, size_t maxHeapBytes);
+
+  std::unique_ptr<facebook::react::JSRuntime> createJSRuntime(
+      std::shared_ptr<facebook::react::MessageQueueThread> msgQueueThread) noexcept override;
+
+ private:
+  std::string name_;
+  size_t maxHeapBytes_;
+};
+
+} // namespace rnsandbox
@@ -0,0 +1,48 @@
+#include "SandboxHermesRuntimeFactory.h"
+
+#if RNSANDBOX_HAS_HERMES
+
+#include <hermes/hermes.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace rnsandbox {
+
+SandboxHermesRuntimeFactory::SandboxHermesRuntimeFactory(std::string name, size_t maxHeapBytes)
+    : name_(std::move(name)), maxHeapBytes_(maxHeapBytes)
+{
+}
+
+std::unique_ptr<facebook::react::JSRuntime> SandboxHermesRuntimeFactory::createJSRuntime(
+    std::shared_ptr<facebook::react::MessageQueueThread>) noexcept
+{
+  // Hermes sizes its heap in 32 bits
+  auto maxHeap = static_cast<::hermes::vm::gcheapsize_t>(
+      std::min<size_t>(maxHeapBytes_, std::numeric_limits<::hermes::vm::gcheapsize_t>::max()));
+
+  auto gcConfigBuilder = ::hermes::vm::GCConfig::Builder()
+                             .withName(name_)
+                             // Same as HermesInstance: old-gen allocation until TTI
+                             .withAllocInYoung(false)
+                             .withRevertToYGAtTTI(true);
+  if (maxHeap > 0) {
+    gcConfigBuilder.withMaxHeapSize(maxHeap);
+  }
+  auto gcConfig = gcConfigBuilder.build();
+  auto runtimeConfig = ::hermes::vm::RuntimeConfig::Builder()
+                           .withGCConfig(gcConfig)
+                           .withEnableSampleProfiling(true)
+                           .withMicrotaskQueue(true)
+                           // Lets the watchdog interrupt loops in bundles
+                           // evaluated from source, e.g. served by Metro
+                           .withAsyncBreakCheckInEval(true)
+                           .build();
+
+  return std::make_unique<facebook::react::JSIRuntimeHolder>(facebook::hermes::makeHermesRuntime(runtimeConfig));
+}
+
+} // namespace rnsandbox
+
+#endif // RNSANDBOX_HAS_HERMES
@@ -11,10 +11,28 @@
 #import <React/RCTComponent.h>
 #import <react/renderer/components/RNSandboxSpec/EventEmitters.h>
 
+#include <chrono>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "MessagePriority.h"
+#include "SandboxCpuAccounting.h"
+#include "SandboxHibernation.h"
+#include "SandboxMemoryGovernor.h"
+#include "SandboxRealm.h"
+#include "SandboxStartupTimeline.h"
+#include "SandboxWatchdog.h"
+
+@class RCTHost;
+@class RCTReactNativeFactory;
+
+namespace facebook::jsi {
+class Runtime;
+}
+
 NS_ASSUME_NONNULL_BEGIN
 
 /**
@@ -33,6 +51,12 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, readwrite) std::string origin;
 @property (nonatomic, readwrite) std::string jsBundleSource;
 
+/**
+ * Bundle evaluated in every runtime of this sandbox before jsBundleSource, e.g. React and shared libraries that
+ * jsBundleSource then only references. Resolved like jsBundleSource but never from the packager. Empty for none.
+ */
+@property (nonatomic, readwrite) std::string jsBaseBundleSource;
+
 /**
  * Sets the list of allowed TurboModules for this sandbox instance.
  * Only modules in this list will be accessible to the JavaScript runtime.
@@ -45,6 +69,12 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, readwrite) std::set<std::string> allowedOrigins;
 
+/**
+ * Shared state keys (exact or `prefix*`) this sandbox may read and write through `sharedState`.
+ */
+@property (nonatomic, readwrite) std::set<std::string> sharedStateReadKeys;
+@property (nonatomic, readwrite) std::set<std::string> sharedStateWriteKeys;
+
 /**
  * Sets the TurboModule substitution map for this sandbox instance.
  * Keys are module names that sandbox JS code requests, values are the actual
@@ -57,6 +87,54 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, readwrite) std::map<std::string, std::string> turboModuleSubstitutions;
 
+/**
+ * Origins run as realms in this sandbox's runtime: each in a scope object of its own, registered as a separate
+ * origin. Started after the sandbox's bundle in every runtime; restarted when set while the runtime runs.
+ */
+@property (nonatomic, readwrite) std::vector<rnsandbox::RealmConfig> realms;
+
+/**
+ * Hibernate/resume state of this sandbox, created with the delegate and kept across runtimes.
+ */
+@property (nonatomic, readonly) std::shared_ptr<rnsandbox::SandboxHibernation> hibernation;
+
+/**
+ * Startup phase timestamps of this sandbox, created with the delegate and restarted on resume. Each phase is also
+ * emitted as an os_signpost event of the "Startup" category.
+ */
+@property (nonatomic, readonly) std::shared_ptr<rnsandbox::StartupTimeline> startupTimeline;
+
+/**
+ * Called on the main queue when a message for the hibernated sandbox requests a wake-up under its wake policy.
+ */
+@property (nonatomic, copy, nullable) void (^onWakeRequest)(void);
+
+/**
+ * Soft JS heap limit enforced by the memory governor, 0 for none. When set before the host is created, the Hermes
+ * heap is also hard-capped at twice this size.
+ */
+@property (nonatomic, readwrite) size_t heapLimitBytes;
+
+/**
+ * Whether the memory governor may evict this sandbox.
+ */
+@property (nonatomic, readwrite) rnsandbox::EvictionPolicy evictionPolicy;
+
+/**
+ * Called on the main queue, after onError reported it, when the memory governor evicts this sandbox.
+ */
+@property (nonatomic, copy, nullable) void (^onMemoryEviction)(void);
+
+/**
+ * The runtime's last heap sample reported to the memory governor, 0 before the first one.
+ */
+@property (nonatomic, readonly) size_t sampledHeapBytes;
+
+/**
+ * How long one host-dispatched JS task may run before the watchdog interrupts it, 0 to disable.
+ */
+@property (nonatomic, readwrite) std::chrono::milliseconds watchdogTimeout;
+
 /**
  * Initializes the delegate.
  * @return Initialized delegate instance with filtered module access
@@ -64,18 +142,95 @@ NS_ASSUME_NONNULL_BEGIN
 - (instancetype)init;
 
 /**
- * Posts a message to the JavaScript runtime.
+ * Creates and starts the host of a factory built with this delegate, wired like RCTRootViewFactory wires its own.
+ * Unlike that host, this one has the delegate as its runtime delegate before it starts, which jsBaseBundleSource needs.
+ */
+- (RCTHost *)startReactHostForFactory:(RCTReactNativeFactory *)factory
+                        launchOptions:(nullable NSDictionary *)launchOptions;
+
+/**
+ * Posts a message to the JavaScript runtime through the sandbox's inbound queue.
  * @param message C++ string containing the JSON.stringified message
+ * @param priority Queue lane; urgent messages are delivered ahead of bulk
  */
-- (void)postMessage:(const std::string &)message;
+- (void)postMessage:(const std::string &)message priority:(rnsandbox::MessagePriority)priority;
 
 /**
  * Routes a message to a specific sandbox delegate.
  * @param message The message to route
  * @param targetId The ID of the target sandbox
+ * @param priority Queue lane in the target sandbox
  * @return true if the message was successfully routed, false otherwise
  */
-- (bool)routeMessage:(const std::string &)message toSandbox:(const std::string &)targetId;
+- (bool)routeMessage:(const std::string &)message
+           toSandbox:(const std::string &)targetId
+            priority:(rnsandbox::MessagePriority)priority;
+
+/**
+ * Routes a message to a specific sandbox delegate, holding it in the registry mailbox
+ * if the target has not registered yet.
+ * @param message The message to route
+ * @param targetId The ID of the target sandbox
+ * @param priority Queue lane in the target sandbox
+ * @param ttl How long an unregistered target may take to register; zero fails immediately
+ * @return true if the message was routed or held, false otherwise
+ */
+- (bool)routeMessage:(const std::string &)message
+           toSandbox:(const std::string &)targetId
+            priority:(rnsandbox::MessagePriority)priority
+                 ttl:(std::chrono::milliseconds)ttl;
+
+/**
+ * Schedules work on the sandbox's JS thread via the buffered runtime executor.
+ * @param work Callback receiving the sandbox runtime
+ * @return true if the work was scheduled, false if there is no running instance
+ */
+- (bool)scheduleOnJSThread:(std::function<void(facebook::jsi::Runtime &)>)work;
+
+/**
+ * JS thread time spent on this sandbox's origin since its first use, by category.
+ */
+- (rnsandbox::SandboxCpuUsage)cpuUsage;
+
+/**
+ * JSON snapshot of every origin's CPU usage, for metrics pipelines.
+ */
++ (NSString *)cpuUsageJSON;
+
+/**
+ * JSON snapshot of the queue metrics of every substituted module's method lane, keyed by "<origin>/<module>".
+ */
++ (NSString *)methodQueueStatsJSON;
+
+/**
+ * Records a startup phase. The first frame completes the timeline, which is then sent to onStartupTimeline and logged.
+ */
+- (void)markStartupPhase:(rnsandbox::StartupPhase)phase;
+
+/**
+ * First step of a hot bundle swap: resolves jsBundleSource to local files through the bundle preloader, off the main
+ * thread. jsBaseBundleSource is not among them: the runtime keeps the base it was started with.
+ * @param completion Called on the main queue; files is nil if a bundle is not available as a file, e.g. one served
+ * by the packager, and the sandbox has to be reloaded instead
+ */
+- (void)resolveBundleFiles:(void (^)(NSArray<NSURL *> *_Nullable files))completion;
+
+/**
+ * Evaluates the files in the running runtime in place of its current bundle. The host, the registry registration and
+ * the sandbox globals stay; the callbacks the old bundle handed to them are dropped, its message ports are closed and
+ * messages wait for its successor's setOnMessage. Stop the surface before and start it again after a successful swap.
+ * @param completion Called on the main queue; NO if the runtime is unusable and must be reloaded, which stays so for
+ * every later swap into the same runtime
+ */
+- (void)swapInBundleFiles:(NSArray<NSURL *> *)files completion:(void (^)(BOOL swapped))completion;
+
+/**
+ * Takes the sandbox's state snapshot on its JS thread, then drops every reference to the runtime while
+ * keeping queued messages for the next one. The owner must release the host in the completion.
+ * @param completion Called on the main queue; resumeRequested is YES if a resume arrived meanwhile
+ * @return NO if the sandbox is not active
+ */
+- (BOOL)hibernateWithCompletion:(void (^)(BOOL resumeRequested))completion;
 
 @end
 
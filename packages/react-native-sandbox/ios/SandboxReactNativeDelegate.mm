@@ -9,55 +9,156 @@
 
 #include <jsi/JSIDynamic.h>
 #include <jsi/decorator.h>
+#include <react/runtime/JSRuntimeFactoryCAPI.h>
 #include <react/utils/jsi-utils.h>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 
 #import <React/RCTBridge+Private.h>
 #import <React/RCTBridge.h>
-#import <React/RCTBundleURLProvider.h>
 #import <React/RCTFollyConvert.h>
 #import <ReactAppDependencyProvider/RCTAppDependencyProvider.h>
+#import <ReactCommon/RCTHost.h>
 #import <ReactCommon/RCTInteropTurboModule.h>
 #import <ReactCommon/RCTTurboModule.h>
 
+#import <UIKit/UIKit.h>
 #import <objc/runtime.h>
+#import <os/signpost.h>
 
 #include <fmt/format.h>
 #include "ISandboxAwareModule.h"
+#include "MessageChannel.h"
+#include "MessageChannelBindings.h"
 #import "RCTSandboxAwareModule.h"
+#import "RCTSandboxBundlePreloader.h"
+#include "SandboxBundleEvaluation.h"
+#include "SandboxBundleFile.h"
+#include "SandboxCpuAccounting.h"
 #include "SandboxDelegateWrapper.h"
+#include "SandboxExecutor.h"
+#include "SandboxHeapProbe.h"
+#import "SandboxHermesRuntimeFactory.h"
+#include "SandboxHibernationBindings.h"
+#include "SandboxJSHandlers.h"
 #include "SandboxLogBox.h"
+#include "SandboxMessageQueue.h"
+#include "SandboxMessageQueueBindings.h"
+#include "SandboxModuleSharing.h"
+#include "SandboxPresenceBindings.h"
+#include "SandboxRealmBindings.h"
 #include "SandboxRegistry.h"
+#include "SandboxRpcBindings.h"
+#include "SandboxRuntimeInterrupt.h"
+#include "SandboxRuntimeParking.h"
+#include "SharedMemoryBindings.h"
+#include "SharedStateBindings.h"
+#include "SharedStateStore.h"
 #import "StubTurboModuleCxx.h"
 
 namespace jsi = facebook::jsi;
 namespace TurboModuleConvertUtils = facebook::react::TurboModuleConvertUtils;
 using namespace facebook::react;
 
+// A module's method calls queued for its dispatch queue. One dispatch wakes the queue for all the calls posted until
+// the drain gets to them, instead of a block allocated per call; only the wakeup allocates, for its lane reference.
+struct SandboxDispatchLane {
+  SandboxDispatchLane(dispatch_queue_t queue, std::shared_ptr<rnsandbox::LaneMetrics> metrics)
+      : queue(queue), tasks(std::move(metrics))
+  {
+  }
+
+  dispatch_queue_t queue;
+  rnsandbox::BatchedTaskQueue tasks;
+};
+
+// Calls run per wakeup before the rest is dispatched again, letting the module's own blocks on the queue interleave
+static constexpr size_t kDispatchLaneBatchSize = 16;
+
+static void drainDispatchLane(void *context)
+{
+  // The reference taken when the drain was scheduled, kept while it reschedules itself
+  auto *lane = static_cast<std::shared_ptr<SandboxDispatchLane> *>(context);
+  if ((*lane)->tasks.drain(kDispatchLaneBatchSize)) {
+    dispatch_async_f((*lane)->queue, lane, drainDispatchLane);
+    return;
+  }
+  delete lane;
+}
+
+// Runs a substituted module's async methods on its lane: the shared executor's strand for modules that don't
+// need a dispatch queue, otherwise batches on the module's queue. Either way a call is queued without allocating.
+// Each call runs in its sandbox's SandboxContextScope, which is how a module shared between sandboxes tells them
+// apart.
 class SandboxNativeMethodCallInvoker : public NativeMethodCallInvoker {
   dispatch_queue_t methodQueue_;
+  std::shared_ptr<rnsandbox::SandboxStrand> strand_;
+  std::shared_ptr<SandboxDispatchLane> dispatchLane_;
+  std::shared_ptr<const rnsandbox::SandboxContext> context_;
+  // Charged for methods that run on the JS thread
+  rnsandbox::CpuAccount *cpuAccount_;
 
  public:
-  explicit SandboxNativeMethodCallInvoker(dispatch_queue_t methodQueue) : methodQueue_(methodQueue) {}
+  SandboxNativeMethodCallInvoker(
+      dispatch_queue_t methodQueue,
+      std::shared_ptr<rnsandbox::LaneMetrics> metrics,
+      std::shared_ptr<const rnsandbox::SandboxContext> context,
+      rnsandbox::CpuAccount *cpuAccount)
+      : methodQueue_(methodQueue), context_(std::move(context)), cpuAccount_(cpuAccount)
+  {
+    if (methodQueue != RCTJSThread) {
+      dispatchLane_ = std::make_shared<SandboxDispatchLane>(methodQueue, std::move(metrics));
+    }
+  }
+
+  SandboxNativeMethodCallInvoker(
+      std::shared_ptr<rnsandbox::SandboxStrand> strand,
+      std::shared_ptr<const rnsandbox::SandboxContext> context,
+      rnsandbox::CpuAccount *cpuAccount)
+      : methodQueue_(nil), strand_(std::move(strand)), context_(std::move(context)), cpuAccount_(cpuAccount)
+  {
+  }
 
   void invokeAsync(const std::string &, std::function<void()> &&work) noexcept override
   {
     if (methodQueue_ == RCTJSThread) {
+      rnsandbox::SandboxContextScope contextScope(context_.get());
+      rnsandbox::CpuScope scope(cpuAccount_, rnsandbox::CpuCategory::NativeCall);
       work();
       return;
     }
-    __block auto retainedWork = std::move(work);
-    dispatch_async(methodQueue_, ^{
-      retainedWork();
-    });
+    // The context and the call fill SandboxTask's inline storage exactly
+    auto call = [context = context_, work = std::move(work)]() mutable {
+      rnsandbox::SandboxContextScope contextScope(context.get());
+      work();
+    };
+    if (strand_) {
+      strand_->post(std::move(call));
+      return;
+    }
+    if (dispatchLane_->tasks.push(std::move(call))) {
+      dispatch_async_f(methodQueue_, new std::shared_ptr<SandboxDispatchLane>(dispatchLane_), drainDispatchLane);
+    }
   }
 
   void invokeSync(const std::string &, std::function<void()> &&work) override
   {
+    rnsandbox::SandboxContextScope contextScope(context_.get());
+    rnsandbox::CpuScope scope(cpuAccount_, rnsandbox::CpuCategory::NativeCall);
     work();
   }
+
+  // Queue metrics of this module's lane; empty for modules that run on the JS thread
+  rnsandbox::LaneStats stats() const
+  {
+    if (strand_) {
+      return strand_->stats();
+    }
+    return dispatchLane_ ? dispatchLane_->tasks.stats() : rnsandbox::LaneStats{};
+  }
 };
 
 static void stubJsiFunction(jsi::Runtime &runtime, jsi::Object &object, const char *name)
@@ -80,19 +181,75 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
   return value.isString() ? value.getString(rt).utf8(rt) : "";
 }
 
-@interface SandboxReactNativeDelegate () {
+// Seconds a runtime waits for a bundle that is still downloading
+static const NSTimeInterval kBundleFileTimeout = 60;
+
+// Hermes only checks for async breaks in bytecode hermesc compiled them into, which React Native's build does not
+static bool isHermesBytecodeFile(const std::string &path)
+{
+  auto file = rnsandbox::BundleFile::open(path);
+  return file && file->isHermesBytecode();
+}
+
+static os_log_t startupLog()
+{
+  static os_log_t log = os_log_create("io.callstack.rnsandbox", "Startup");
+  return log;
+}
+
+@interface SandboxReactNativeDelegate () <RCTHostRuntimeDelegate> {
   RCTInstance *_rctInstance;
   std::shared_ptr<jsi::Function> _onMessageSandbox;
   std::shared_ptr<rnsandbox::SandboxDelegateWrapper> _delegateWrapper;
+  std::shared_ptr<rnsandbox::SandboxMessageQueue> _inbox;
+  // Ports opened by the current runtime, closed with it
+  std::shared_ptr<rnsandbox::MessagePortSet> _messagePorts;
+  // Callbacks the current runtime handed to the bindings; JS thread only
+  std::shared_ptr<rnsandbox::SandboxJSHandlers> _jsHandlers;
+  // Set when a hot swap failed partway, which only a new runtime clears; JS thread only
+  BOOL _needsReload;
+  rnsandbox::SandboxMemoryGovernor::SandboxId _memoryId;
+  rnsandbox::SandboxWatchdog::SandboxId _watchdogId;
+  std::shared_ptr<rnsandbox::RuntimeInterrupter> _interrupter;
+  // Whether the current runtime factory has Hermes check for async breaks in the source it evaluates
+  BOOL _runtimeChecksBreaksInEval;
+  // Whether the watchdog's interrupts can land in the current runtime; it only gets a budget then
+  std::atomic<bool> _watchdogArmed;
+  // The origin's account in SandboxCpuAccounting, which never frees it
+  std::atomic<rnsandbox::CpuAccount *> _cpuAccount;
+  // Delivered before the sandbox called setOnMessage; JS thread only
+  std::vector<std::string> _pendingMessages;
   std::set<std::string> _allowedTurboModules;
   std::set<std::string> _allowedOrigins;
+  std::set<std::string> _sharedStateReadKeys;
+  std::set<std::string> _sharedStateWriteKeys;
   std::map<std::string, std::string> _turboModuleSubstitutions;
   std::string _origin;
   std::string _jsBundleSource;
   NSMutableDictionary<NSString *, id<RCTBridgeModule>> *_substitutedModuleInstances;
+  // (resolved module name, sharing scope) of the shared module instances this sandbox holds
+  std::vector<std::pair<std::string, std::string>> _sharedModuleUsers;
+  std::vector<rnsandbox::RealmConfig> _realms;
+  // Host of the realms, kept apart from _delegateWrapper, which changes with the origin
+  std::shared_ptr<rnsandbox::SandboxDelegateWrapper> _realmHost;
+  std::shared_ptr<rnsandbox::SandboxRealmSet> _realmSet;
 }
 
 - (void)cleanupResources;
+- (void)applySharedStateAccess;
+- (void)scheduleInboxDrain;
+- (void)finishHibernateWithState:(std::optional<std::string>)stateJson completion:(void (^)(BOOL))completion;
+- (void)evictForReason:(rnsandbox::EvictionReason)reason heapBytes:(size_t)heapBytes;
+- (void)reportWatchdogTimeoutForTask:(const std::string &)task elapsed:(std::chrono::milliseconds)elapsed;
+- (void)evaluateBaseBundle:(jsi::Runtime &)runtime;
+- (void)reportBundleError:(const std::string &)message name:(const std::string &)name;
+- (void)startRealms:(jsi::Runtime &)runtime;
+- (void)stopRealms;
+- (bool)scheduleOnJSThread:(std::function<void(facebook::jsi::Runtime &)>)work
+                      task:(const char *)task
+                  category:(rnsandbox::CpuCategory)category;
+- (void)deliverMessage:(const std::string &)message runtime:(jsi::Runtime &)runtime;
+- (void)reportStartupTimeline;
 
 - (jsi::Function)createPostMessageFunction:(jsi::Runtime &)runtime;
 - (jsi::Function)createSetOnMessageFunction:(jsi::Runtime &)runtime;
@@ -107,12 +264,75 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
 
 #pragma mark - Instance Methods
 
++ (void)initialize
+{
+  if (self != [SandboxReactNativeDelegate class]) {
+    return;
+  }
+  [[NSNotificationCenter defaultCenter] addObserverForName:UIApplicationDidReceiveMemoryWarningNotification
+                                                    object:nil
+                                                     queue:nil
+                                                usingBlock:^(NSNotification *) {
+                                                  // Parked runtimes have no view to show and go first
+                                                  rnsandbox::SandboxRuntimeParking::getInstance().releaseAll();
+                                                  rnsandbox::SandboxMemoryGovernor::getInstance().onMemoryPressure(
+                                                      rnsandbox::MemoryPressureLevel::Critical);
+                                                }];
+}
+
 - (instancetype)init
 {
   if (self = [super init]) {
     _hasOnMessageHandler = NO;
     _hasOnErrorHandler = NO;
     _substitutedModuleInstances = [NSMutableDictionary new];
+    _inbox = std::make_shared<rnsandbox::SandboxMessageQueue>();
+    _messagePorts = std::make_shared<rnsandbox::MessagePortSet>();
+    _hibernation = std::make_shared<rnsandbox::SandboxHibernation>();
+    _startupTimeline = std::make_shared<rnsandbox::StartupTimeline>();
+    _startupTimeline->setTraceHook(
+        [signpostId = os_signpost_id_make_with_pointer(startupLog(), _startupTimeline.get())](
+            rnsandbox::StartupPhase phase, std::chrono::nanoseconds offset) {
+          os_signpost_event_emit(
+              startupLog(), signpostId, "SandboxStartup", "%{public}s +%.3fms", rnsandbox::toString(phase),
+              offset.count() / 1e6);
+        });
+    __weak SandboxReactNativeDelegate *weakSelf = self;
+    _hibernation->setWakeHandler([weakSelf]() {
+      dispatch_async(dispatch_get_main_queue(), ^{
+        SandboxReactNativeDelegate *strongSelf = weakSelf;
+        if (strongSelf.onWakeRequest) {
+          strongSelf.onWakeRequest();
+        }
+      });
+    });
+    _evictionPolicy = rnsandbox::EvictionPolicy::Hibernate;
+    _memoryId = rnsandbox::SandboxMemoryGovernor::getInstance().add({
+        [weakSelf]() {
+          SandboxReactNativeDelegate *strongSelf = weakSelf;
+          if (!strongSelf) {
+            return;
+          }
+          auto memoryId = strongSelf->_memoryId;
+          [strongSelf scheduleOnJSThread:[memoryId](jsi::Runtime &runtime) {
+            rnsandbox::collectGarbage(runtime, memoryId);
+          }];
+        },
+        [weakSelf](rnsandbox::EvictionReason reason, size_t heapBytes) {
+          dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf evictForReason:reason heapBytes:heapBytes];
+          });
+        }});
+    _cpuAccount = nullptr;
+    _watchdogTimeout = rnsandbox::SandboxWatchdog::kDefaultBudget;
+    _interrupter = std::make_shared<rnsandbox::RuntimeInterrupter>();
+    auto interrupter = _interrupter;
+    _watchdogId = rnsandbox::SandboxWatchdog::getInstance().add(
+        {[weakSelf](const std::string &task, std::chrono::milliseconds elapsed) {
+           [weakSelf reportWatchdogTimeoutForTask:task elapsed:elapsed];
+         },
+         [interrupter]() { interrupter->interrupt(); }});
+    [self applyWatchdogBudget];
     self.dependencyProvider = [[RCTAppDependencyProvider alloc] init];
   }
   return self;
@@ -122,14 +342,25 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
 {
   _onMessageSandbox.reset();
   _rctInstance = nil;
+  _inbox->clear();
+  _pendingMessages.clear();
   _allowedTurboModules.clear();
   _allowedOrigins.clear();
+  _sharedStateReadKeys.clear();
+  _sharedStateWriteKeys.clear();
   _turboModuleSubstitutions.clear();
   [_substitutedModuleInstances removeAllObjects];
+  auto &sharedModules = rnsandbox::SharedModuleRegistry::getInstance();
+  for (const auto &[module, scope] : _sharedModuleUsers) {
+    sharedModules.release(module, scope);
+  }
+  _sharedModuleUsers.clear();
+  [self stopRealms];
   if (_delegateWrapper) {
     _delegateWrapper->invalidate();
     _delegateWrapper.reset();
   }
+  _messagePorts->closeAll();
 }
 
 #pragma mark - C++ Property Getters
@@ -160,9 +391,11 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
     return;
   }
 
-  if (!_origin.empty()) {
-    auto &registry = rnsandbox::SandboxRegistry::getInstance();
-    registry.unregister(_origin);
+  _messagePorts->closeAll();
+  // Other sandboxes of the old origin stay registered; its shared state
+  // access goes once the last of them is gone
+  if (!_origin.empty() && _delegateWrapper) {
+    rnsandbox::SandboxRegistry::getInstance().unregisterDelegate(_origin, _delegateWrapper);
   }
   if (_delegateWrapper) {
     _delegateWrapper->invalidate();
@@ -170,12 +403,14 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
   }
 
   _origin = origin;
+  _cpuAccount = rnsandbox::SandboxCpuAccounting::getInstance().account(_origin).get();
 
   if (!_origin.empty()) {
     auto &registry = rnsandbox::SandboxRegistry::getInstance();
     _delegateWrapper = std::make_shared<rnsandbox::SandboxDelegateWrapper>(self);
     registry.registerSandbox(_origin, _delegateWrapper, _allowedOrigins);
   }
+  [self applySharedStateAccess];
 }
 
 - (void)setJsBundleSource:(std::string)jsBundleSource
@@ -196,6 +431,39 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
   }
 }
 
+- (std::vector<rnsandbox::RealmConfig>)realms
+{
+  return _realms;
+}
+
+- (void)setRealms:(std::vector<rnsandbox::RealmConfig>)realms
+{
+  _realms = realms;
+  if (!_rctInstance) {
+    return;
+  }
+  [_rctInstance callFunctionOnBufferedRuntimeExecutor:[=](jsi::Runtime &runtime) { [self startRealms:runtime]; }];
+}
+
+- (void)setSharedStateReadKeys:(std::set<std::string>)sharedStateReadKeys
+{
+  _sharedStateReadKeys = sharedStateReadKeys;
+  [self applySharedStateAccess];
+}
+
+- (void)setSharedStateWriteKeys:(std::set<std::string>)sharedStateWriteKeys
+{
+  _sharedStateWriteKeys = sharedStateWriteKeys;
+  [self applySharedStateAccess];
+}
+
+- (void)applySharedStateAccess
+{
+  if (!_origin.empty()) {
+    rnsandbox::SharedStateStore::getInstance().setAccess(_origin, _sharedStateReadKeys, _sharedStateWriteKeys);
+  }
+}
+
 - (void)setAllowedTurboModules:(std::set<std::string>)allowedTurboModules
 {
   _allowedTurboModules = allowedTurboModules;
@@ -211,16 +479,58 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
   _turboModuleSubstitutions = turboModuleSubstitutions;
 }
 
+- (void)setHeapLimitBytes:(size_t)heapLimitBytes
+{
+  _heapLimitBytes = heapLimitBytes;
+  rnsandbox::SandboxMemoryGovernor::getInstance().setHeapLimit(_memoryId, heapLimitBytes);
+}
+
+- (void)setEvictionPolicy:(rnsandbox::EvictionPolicy)evictionPolicy
+{
+  _evictionPolicy = evictionPolicy;
+  rnsandbox::SandboxMemoryGovernor::getInstance().setEvictionPolicy(_memoryId, evictionPolicy);
+}
+
+- (size_t)sampledHeapBytes
+{
+  return rnsandbox::SandboxMemoryGovernor::getInstance().heapBytes(_memoryId);
+}
+
+- (void)setWatchdogTimeout:(std::chrono::milliseconds)watchdogTimeout
+{
+  _watchdogTimeout = watchdogTimeout;
+  [self applyWatchdogBudget];
+}
+
+// A watchdog that reports timeouts without ending the runaway JS only adds a fatal error, so it stays unarmed
+- (void)applyWatchdogBudget
+{
+  rnsandbox::SandboxWatchdog::getInstance().setBudget(
+      _watchdogId, _watchdogArmed ? _watchdogTimeout : std::chrono::milliseconds::zero());
+}
+
+- (BOOL)isBundleHermesBytecode
+{
+  NSString *source = [NSString stringWithUTF8String:_jsBundleSource.c_str()];
+  NSURL *url = [RCTSandboxBundlePreloader preloadedURLForSource:source]
+      ?: [RCTSandboxBundlePreloader URLForBundleSource:source];
+  // Packagers serve source
+  return url.isFileURL && isHermesBytecodeFile(url.path.UTF8String);
+}
+
 - (void)dealloc
 {
+  rnsandbox::SandboxMemoryGovernor::getInstance().remove(_memoryId);
+  rnsandbox::SandboxWatchdog::getInstance().remove(_watchdogId);
+  if (!_origin.empty() && _delegateWrapper) {
+    rnsandbox::SandboxRegistry::getInstance().unregisterDelegate(_origin, _delegateWrapper);
+  }
   if (_delegateWrapper) {
     _delegateWrapper->invalidate();
     _delegateWrapper.reset();
   }
-  if (!_origin.empty()) {
-    auto &registry = rnsandbox::SandboxRegistry::getInstance();
-    registry.unregister(_origin);
-  } else {
+  _messagePorts->closeAll();
+  if (_origin.empty()) {
     [self cleanupResources];
   }
 }
@@ -235,68 +545,160 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
   if (_jsBundleSource.empty()) {
     return nil;
   }
+  [self markStartupPhase:rnsandbox::StartupPhase::BundleLoadStarted];
 
   NSString *jsBundleSourceNS = [NSString stringWithUTF8String:_jsBundleSource.c_str()];
-  NSURL *url = [NSURL URLWithString:jsBundleSourceNS];
-  if (url && url.scheme) {
-    return url;
+  NSURL *preloadedURL = [RCTSandboxBundlePreloader preloadedURLForSource:jsBundleSourceNS];
+  if (preloadedURL) {
+    return preloadedURL;
   }
+  return [RCTSandboxBundlePreloader URLForBundleSource:jsBundleSourceNS];
+}
 
-  if ([jsBundleSourceNS hasSuffix:@".jsbundle"]) {
-    return [[NSBundle mainBundle] URLForResource:jsBundleSourceNS withExtension:nil];
+- (JSRuntimeFactoryRef)createJSRuntimeFactory
+{
+#if RNSANDBOX_HAS_HERMES
+  // Also needed by the watchdog, whose interrupts only land where Hermes checks for async breaks
+  if (_heapLimitBytes > 0 || _watchdogTimeout.count() > 0) {
+    // Hermes aborts the process when its heap cap is hit, so the cap sits well
+    // above the governor's limit, which evicts the sandbox first
+    auto *factory =
+        new rnsandbox::SandboxHermesRuntimeFactory(fmt::format("RNSandbox:{}", _origin), _heapLimitBytes * 2);
+    _runtimeChecksBreaksInEval = YES;
+    return reinterpret_cast<JSRuntimeFactoryRef>(static_cast<facebook::react::JSRuntimeFactory *>(factory));
   }
+#endif
+  _runtimeChecksBreaksInEval = NO;
+  return [super createJSRuntimeFactory];
+}
 
-  NSString *bundleName =
-      [jsBundleSourceNS hasSuffix:@".bundle"] ? [jsBundleSourceNS stringByDeletingPathExtension] : jsBundleSourceNS;
-  return [[RCTBundleURLProvider sharedSettings] jsBundleURLForBundleRoot:bundleName];
+- (RCTHost *)startReactHostForFactory:(RCTReactNativeFactory *)factory launchOptions:(NSDictionary *)launchOptions
+{
+  __weak __typeof(self) weakSelf = self;
+  // Module lookups go through the factory, which falls back to RN's defaults for modules this delegate leaves out
+  id<RCTTurboModuleManagerDelegate> turboModuleManagerDelegate = (id<RCTTurboModuleManagerDelegate>)factory;
+  RCTHostBundleURLProvider bundleURLProvider = ^NSURL * {
+    return [weakSelf bundleURL];
+  };
+  RCTHostJSEngineProvider jsEngineProvider = ^std::shared_ptr<facebook::react::JSRuntimeFactory>() {
+    auto *runtimeFactory = reinterpret_cast<facebook::react::JSRuntimeFactory *>([weakSelf createJSRuntimeFactory]);
+    return std::shared_ptr<facebook::react::JSRuntimeFactory>(runtimeFactory, &js_runtime_factory_destroy);
+  };
+  RCTHost *host = [[RCTHost alloc] initWithBundleURLProvider:bundleURLProvider
+                                                hostDelegate:self
+                                  turboModuleManagerDelegate:turboModuleManagerDelegate
+                                            jsEngineProvider:jsEngineProvider
+                                               launchOptions:launchOptions];
+  if ([factory.rootViewFactory conformsToProtocol:@protocol(RCTContextContainerHandling)]) {
+    [host setContextContainerHandler:(id<RCTContextContainerHandling>)factory.rootViewFactory];
+  }
+  // start hands the instance to the JS thread, which reads the runtime delegate from then on
+  host.runtimeDelegate = self;
+  [host start];
+  return host;
 }
 
-- (void)postMessage:(const std::string &)message
+- (void)postMessage:(const std::string &)message priority:(rnsandbox::MessagePriority)priority
 {
-  if (!_onMessageSandbox || !_rctInstance) {
+  // Messages that arrive before the runtime starts stay queued; hostDidStart
+  // schedules the first drain
+  bool needsDrain = _inbox->push(message, priority);
+  rnsandbox::SandboxMemoryGovernor::getInstance().touch(_memoryId);
+  if (_hibernation->state() != rnsandbox::HibernationState::Active) {
+    // Kept for the next runtime
+    _hibernation->noteMessage(priority);
     return;
   }
+  if (needsDrain && _rctInstance) {
+    [self scheduleInboxDrain];
+  }
+}
 
-  [_rctInstance callFunctionOnBufferedRuntimeExecutor:[=](jsi::Runtime &runtime) {
-    try {
-      // Validate runtime before any JSI operations
-      runtime.global(); // Test if runtime is accessible
-
-      // Double-check the JSI function is still valid
-      if (!_onMessageSandbox) {
-        return;
+// Delivers one inbox batch per buffered-executor task and re-schedules while
+// messages remain, so urgent messages overtake a long bulk transfer.
+- (void)scheduleInboxDrain
+{
+  auto inbox = _inbox;
+  auto hibernation = _hibernation;
+  auto memoryId = _memoryId;
+  bool scheduled = [self
+      scheduleOnJSThread:[=](jsi::Runtime &runtime) {
+        // Leave the rest to the runtime that replaces a hibernating one
+        if (hibernation->state() != rnsandbox::HibernationState::Active) {
+          return;
+        }
+        rnsandbox::sampleHeapUsage(runtime, memoryId);
+        bool more = inbox->drain([&](std::string &&message) { [self deliverMessage:message runtime:runtime]; });
+        if (more) {
+          [self scheduleInboxDrain];
+        }
       }
+                    task:"message delivery"
+                category:rnsandbox::CpuCategory::Delivery];
+  if (!scheduled) {
+    inbox->clear();
+  }
+}
 
-      jsi::Value parsedValue = runtime.global()
-                                   .getPropertyAsObject(runtime, "JSON")
-                                   .getPropertyAsFunction(runtime, "parse")
-                                   .call(runtime, jsi::String::createFromUtf8(runtime, message));
+- (void)deliverMessage:(const std::string &)message runtime:(jsi::Runtime &)runtime
+{
+  try {
+    // Validate runtime before any JSI operations
+    runtime.global(); // Test if runtime is accessible
 
-      _onMessageSandbox->call(runtime, {std::move(parsedValue)});
-    } catch (const jsi::JSError &e) {
-      if (self.eventEmitter && self.hasOnErrorHandler) {
-        SandboxReactNativeViewEventEmitter::OnError errorEvent = {
-            .isFatal = false, .name = "JSError", .message = e.getMessage(), .stack = e.getStack()};
-        self.eventEmitter->onError(errorEvent);
-      }
-    } catch (const std::exception &e) {
-      if (self.eventEmitter && self.hasOnErrorHandler) {
-        SandboxReactNativeViewEventEmitter::OnError errorEvent = {
-            .isFatal = false, .name = "RuntimeError", .message = e.what(), .stack = ""};
-        self.eventEmitter->onError(errorEvent);
-      }
-    } catch (...) {
-      NSLog(@"[SandboxReactNativeDelegate] Runtime invalid during postMessage for sandbox %s", _origin.c_str());
+    // Keep the message until the sandbox registers its handler
+    if (!_onMessageSandbox) {
+      _pendingMessages.push_back(message);
+      return;
     }
-  }];
+
+    auto *cpuAccount = _cpuAccount.load();
+    jsi::Value parsedValue;
+    {
+      rnsandbox::CpuScope scope(cpuAccount, rnsandbox::CpuCategory::Serialization);
+      parsedValue = runtime.global()
+                        .getPropertyAsObject(runtime, "JSON")
+                        .getPropertyAsFunction(runtime, "parse")
+                        .call(runtime, jsi::String::createFromUtf8(runtime, message));
+    }
+
+    rnsandbox::CpuScope scope(cpuAccount, rnsandbox::CpuCategory::UserCallback);
+    _onMessageSandbox->call(runtime, {std::move(parsedValue)});
+  } catch (const jsi::JSError &e) {
+    if (self.eventEmitter && self.hasOnErrorHandler) {
+      SandboxReactNativeViewEventEmitter::OnError errorEvent = {
+          .isFatal = false, .name = "JSError", .message = e.getMessage(), .stack = e.getStack()};
+      self.eventEmitter->onError(errorEvent);
+    }
+  } catch (const std::exception &e) {
+    if (self.eventEmitter && self.hasOnErrorHandler) {
+      SandboxReactNativeViewEventEmitter::OnError errorEvent = {
+          .isFatal = false, .name = "RuntimeError", .message = e.what(), .stack = ""};
+      self.eventEmitter->onError(errorEvent);
+    }
+  } catch (...) {
+    NSLog(@"[SandboxReactNativeDelegate] Runtime invalid during postMessage for sandbox %s", _origin.c_str());
+  }
 }
 
-- (bool)routeMessage:(const std::string &)message toSandbox:(const std::string &)targetId
+- (bool)routeMessage:(const std::string &)message
+           toSandbox:(const std::string &)targetId
+            priority:(rnsandbox::MessagePriority)priority
+{
+  return [self routeMessage:message toSandbox:targetId priority:priority ttl:std::chrono::milliseconds::zero()];
+}
+
+- (bool)routeMessage:(const std::string &)message
+           toSandbox:(const std::string &)targetId
+            priority:(rnsandbox::MessagePriority)priority
+                 ttl:(std::chrono::milliseconds)ttl
 {
   auto &registry = rnsandbox::SandboxRegistry::getInstance();
   auto target = registry.find(targetId);
   if (!target) {
-    return false;
+    // Hold for a target that has not mounted yet; the ACL only depends on this sandbox's allowedOrigins
+    return ttl.count() > 0 && registry.isPermittedFrom(_origin, targetId) &&
+        registry.holdMessage(targetId, message, priority, ttl);
   }
 
   // Check if the current sandbox is permitted to send messages to the target
@@ -311,10 +713,172 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
     return false;
   }
 
-  target->postMessage(message);
+  target->postMessage(message, priority);
   return true;
 }
 
+- (bool)scheduleOnJSThread:(std::function<void(facebook::jsi::Runtime &)>)work
+{
+  return [self scheduleOnJSThread:std::move(work)
+                             task:"scheduled task"
+                         category:rnsandbox::CpuCategory::UserCallback];
+}
+
+- (bool)scheduleOnJSThread:(std::function<void(facebook::jsi::Runtime &)>)work
+                      task:(const char *)task
+                  category:(rnsandbox::CpuCategory)category
+{
+  if (!_rctInstance) {
+    return false;
+  }
+
+  auto watchdogId = _watchdogId;
+  auto *cpuAccount = _cpuAccount.load();
+  auto timedWork = [watchdogId, task, cpuAccount, category, work = std::move(work)](jsi::Runtime &runtime) {
+    rnsandbox::SandboxWatchdog::Scope scope(rnsandbox::SandboxWatchdog::getInstance(), watchdogId, task);
+    rnsandbox::CpuScope cpuScope(cpuAccount, category);
+    work(runtime);
+  };
+  [_rctInstance callFunctionOnBufferedRuntimeExecutor:std::move(timedWork)];
+  return true;
+}
+
+- (rnsandbox::SandboxCpuUsage)cpuUsage
+{
+  auto *cpuAccount = _cpuAccount.load();
+  return cpuAccount ? cpuAccount->usage() : rnsandbox::SandboxCpuUsage{};
+}
+
++ (NSString *)cpuUsageJSON
+{
+  auto json = rnsandbox::toJson(rnsandbox::SandboxCpuAccounting::getInstance().snapshot());
+  return [NSString stringWithUTF8String:json.c_str()];
+}
+
++ (NSString *)methodQueueStatsJSON
+{
+  auto json = rnsandbox::toJson(rnsandbox::SandboxExecutor::getInstance().laneStats());
+  return [NSString stringWithUTF8String:json.c_str()];
+}
+
+- (void)markStartupPhase:(rnsandbox::StartupPhase)phase
+{
+  if (_startupTimeline->mark(phase) && phase == rnsandbox::StartupPhase::FirstFrame) {
+    [self reportStartupTimeline];
+  }
+}
+
+- (void)reportStartupTimeline
+{
+  // Debug level, which is not kept unless someone streams the log
+  os_log_debug(
+      startupLog(), "Startup of sandbox %{public}s: %{public}s", _origin.c_str(), _startupTimeline->toJson().c_str());
+  if (!self.eventEmitter) {
+    return;
+  }
+
+  auto offsets = _startupTimeline->offsets();
+  auto ms = [&offsets](rnsandbox::StartupPhase phase) {
+    const auto &offset = offsets[static_cast<size_t>(phase)];
+    return offset ? offset->count() / 1e6 : -1.0;
+  };
+  using Phase = rnsandbox::StartupPhase;
+  self.eventEmitter->onStartupTimeline({
+      .viewCreated = ms(Phase::ViewCreated),
+      .delegateCreated = ms(Phase::DelegateCreated),
+      .hostCreated = ms(Phase::HostCreated),
+      .bundleLoadStarted = ms(Phase::BundleLoadStarted),
+      .bundleLoaded = ms(Phase::BundleLoaded),
+      .bindingsInstalled = ms(Phase::BindingsInstalled),
+      .errorHandlerInstalled = ms(Phase::ErrorHandlerInstalled),
+      .onMessageRegistered = ms(Phase::OnMessageRegistered),
+      .firstFrame = ms(Phase::FirstFrame),
+  });
+}
+
+- (BOOL)hibernateWithCompletion:(void (^)(BOOL resumeRequested))completion
+{
+  if (!_hibernation->beginHibernate()) {
+    return NO;
+  }
+
+  auto hibernation = _hibernation;
+  bool scheduled = [self scheduleOnJSThread:[=](jsi::Runtime &runtime) {
+    std::optional<std::string> stateJson;
+    try {
+      stateJson = hibernation->snapshot(runtime);
+    } catch (const jsi::JSError &e) {
+      if (self.eventEmitter && self.hasOnErrorHandler) {
+        SandboxReactNativeViewEventEmitter::OnError errorEvent = {
+            .isFatal = false, .name = "JSError", .message = e.getMessage(), .stack = e.getStack()};
+        self.eventEmitter->onError(errorEvent);
+      }
+    } catch (const std::exception &e) {
+      if (self.eventEmitter && self.hasOnErrorHandler) {
+        SandboxReactNativeViewEventEmitter::OnError errorEvent = {
+            .isFatal = false, .name = "HibernationError", .message = e.what(), .stack = ""};
+        self.eventEmitter->onError(errorEvent);
+      }
+    }
+    [self finishHibernateWithState:std::move(stateJson) completion:completion];
+  }];
+  if (!scheduled) {
+    // Never started, so there is nothing to snapshot
+    [self finishHibernateWithState:std::nullopt completion:completion];
+  }
+  return YES;
+}
+
+- (void)finishHibernateWithState:(std::optional<std::string>)stateJson completion:(void (^)(BOOL))completion
+{
+  BOOL resumeRequested = _hibernation->completeHibernate(std::move(stateJson));
+  dispatch_async(dispatch_get_main_queue(), ^{
+    // Unlike a reload, the inbox and pending messages are kept: hostDidStart
+    // only drops them while a previous instance is still set
+    _onMessageSandbox.reset();
+    _interrupter->detach();
+    _rctInstance = nil;
+    _messagePorts->closeAll();
+    completion(resumeRequested);
+  });
+}
+
+- (void)reportWatchdogTimeoutForTask:(const std::string &)task elapsed:(std::chrono::milliseconds)elapsed
+{
+  // Called on the watchdog thread while the JS thread is still busy
+  if (self.eventEmitter && self.hasOnErrorHandler) {
+    std::string errorMessage = fmt::format(
+        "Sandbox '{}' ran a {} for {} ms, over its {} ms budget; its JS was interrupted",
+        _origin,
+        task,
+        elapsed.count(),
+        _watchdogTimeout.count());
+    SandboxReactNativeViewEventEmitter::OnError errorEvent = {
+        .isFatal = true, .name = "WatchdogTimeout", .message = errorMessage, .stack = ""};
+    self.eventEmitter->onError(errorEvent);
+  }
+}
+
+- (void)evictForReason:(rnsandbox::EvictionReason)reason heapBytes:(size_t)heapBytes
+{
+  if (_hibernation->state() != rnsandbox::HibernationState::Active) {
+    return;
+  }
+  if (self.eventEmitter && self.hasOnErrorHandler) {
+    std::string errorMessage = fmt::format(
+        "Sandbox '{}' was evicted to free memory ({:.1f} MiB heap, {})",
+        _origin,
+        heapBytes / (1024.0 * 1024.0),
+        rnsandbox::toString(reason));
+    SandboxReactNativeViewEventEmitter::OnError errorEvent = {
+        .isFatal = false, .name = "SandboxEvictedError", .message = errorMessage, .stack = ""};
+    self.eventEmitter->onError(errorEvent);
+  }
+  if (self.onMemoryEviction) {
+    self.onMemoryEviction();
+  }
+}
+
 - (void)hostDidStart:(RCTHost *)host
 {
   if (!host) {
@@ -326,20 +890,53 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
   _onMessageSandbox.reset();
   _onMessageSandbox = nullptr;
 
-  // Clear old instance reference before setting new one
+  // Clear old instance reference before setting new one. Messages queued for a
+  // previous runtime are dropped, those sent before the first start are kept.
+  if (_rctInstance) {
+    _inbox->clear();
+    _pendingMessages.clear();
+  }
   _rctInstance = nil;
 
+  // Ports opened by the previous runtime cannot outlive it
+  _messagePorts->closeAll();
+  [self stopRealms];
+
   Ivar ivar = class_getInstanceVariable([host class], "_instance");
   _rctInstance = object_getIvar(host, ivar);
 
   if (!_rctInstance) {
     return;
   }
+  rnsandbox::SandboxMemoryGovernor::getInstance().touch(_memoryId);
 
+  // The buffered executor flushes once the bundle has been evaluated
   [_rctInstance callFunctionOnBufferedRuntimeExecutor:[=](jsi::Runtime &runtime) {
+    [self markStartupPhase:rnsandbox::StartupPhase::BundleLoaded];
+    _jsHandlers = std::make_shared<rnsandbox::SandboxJSHandlers>();
+    _needsReload = NO;
     facebook::react::defineReadOnlyGlobal(runtime, "postMessage", [self createPostMessageFunction:runtime]);
     facebook::react::defineReadOnlyGlobal(runtime, "setOnMessage", [self createSetOnMessageFunction:runtime]);
     [self setupErrorHandler:runtime];
+    [self markStartupPhase:rnsandbox::StartupPhase::ErrorHandlerInstalled];
+    rnsandbox::installMessageQueueBindings(runtime, _inbox);
+    rnsandbox::installHibernationBindings(runtime, _hibernation, *_jsHandlers);
+    rnsandbox::sampleHeapUsage(runtime, _memoryId);
+    _watchdogArmed = _interrupter->attach(runtime) && _runtimeChecksBreaksInEval && ![self isBundleHermesBytecode];
+    if (!_watchdogArmed && _watchdogTimeout.count() > 0) {
+      NSLog(@"[SandboxReactNativeDelegate] Watchdog cannot interrupt the runtime of sandbox %s", _origin.c_str());
+    }
+    [self applyWatchdogBudget];
+    if (!_origin.empty()) {
+      std::weak_ptr<rnsandbox::ISandboxDelegate> delegate = _delegateWrapper;
+      rnsandbox::installMessageChannelBindings(runtime, _origin, delegate, _messagePorts);
+      rnsandbox::installRpcBindings(runtime, _origin, delegate, *_jsHandlers);
+      rnsandbox::installPresenceBindings(runtime, _origin, delegate, *_jsHandlers);
+      rnsandbox::installSharedStateBindings(runtime, _origin, delegate, *_jsHandlers);
+      rnsandbox::installSharedMemoryBindings(runtime, _origin, delegate, *_jsHandlers);
+    }
+    [self markStartupPhase:rnsandbox::StartupPhase::BindingsInstalled];
+    [self startRealms:runtime];
     // Must run post-bundle (in the buffered executor) because:
     // 1. installConsoleHandler sets __FUSEBOX = true during runtime init
     // 2. didInitializeRuntime: fires BEFORE installConsoleHandler finishes
@@ -350,6 +947,217 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
     // LogBox.ignoreAllLogs() or LogBox.uninstall() to prevent the toast.
     rnsandbox::disableFuseboxLogBoxToast(runtime);
   }];
+  [self scheduleInboxDrain];
+}
+
+#pragma mark - RCTHostRuntimeDelegate
+
+// The base bundle goes in between runtime setup and the sandbox's own bundle
+- (void)host:(RCTHost *)host didInitializeRuntime:(jsi::Runtime &)runtime
+{
+  [self evaluateBaseBundle:runtime];
+}
+
+// Runs on the JS thread before the sandbox's own bundle is loaded
+- (void)evaluateBaseBundle:(jsi::Runtime &)runtime
+{
+  std::string source = self.jsBaseBundleSource;
+  if (source.empty()) {
+    return;
+  }
+
+  NSError *error = nil;
+  NSURL *url = [RCTSandboxBundlePreloader awaitPreloadedURLForSource:[NSString stringWithUTF8String:source.c_str()]
+                                                             timeout:kBundleFileTimeout
+                                                               error:&error];
+  std::string errorMessage;
+  if (!url) {
+    errorMessage = error.localizedDescription.UTF8String ?: "Base bundle not found";
+  } else {
+    try {
+      rnsandbox::evaluateBundleFile(runtime, url.path.UTF8String, url.absoluteString.UTF8String);
+      return;
+    } catch (const jsi::JSError &e) {
+      errorMessage = e.getMessage();
+    } catch (const std::exception &e) {
+      errorMessage = e.what();
+    }
+  }
+  [self reportBundleError:fmt::format("Base bundle {} failed: {}", source, errorMessage) name:"BaseBundleError"];
+}
+
+- (void)reportBundleError:(const std::string &)message name:(const std::string &)name
+{
+  NSLog(@"[SandboxReactNativeDelegate] Sandbox %s: %s", _origin.c_str(), message.c_str());
+  if (self.eventEmitter && self.hasOnErrorHandler) {
+    SandboxReactNativeViewEventEmitter::OnError errorEvent = {
+        .isFatal = true, .name = name, .message = message, .stack = ""};
+    self.eventEmitter->onError(errorEvent);
+  }
+}
+
+#pragma mark - Realms
+
+// Runs on the JS thread once the sandbox's bundle and bindings are in place
+- (void)startRealms:(jsi::Runtime &)runtime
+{
+  [self stopRealms];
+  if (_realms.empty()) {
+    return;
+  }
+
+  _realmHost = std::make_shared<rnsandbox::SandboxDelegateWrapper>(self);
+  _realmSet = std::make_shared<rnsandbox::SandboxRealmSet>(_realmHost);
+  __weak SandboxReactNativeDelegate *weakSelf = self;
+  _realmSet->setErrorHandler([weakSelf](
+                                 const std::string &origin,
+                                 const std::string &name,
+                                 const std::string &message,
+                                 const std::string &stack) {
+    SandboxReactNativeDelegate *strongSelf = weakSelf;
+    if (strongSelf.eventEmitter && strongSelf.hasOnErrorHandler) {
+      SandboxReactNativeViewEventEmitter::OnError errorEvent = {
+          .isFatal = false, .name = name, .message = fmt::format("[{}] {}", origin, message), .stack = stack};
+      strongSelf.eventEmitter->onError(errorEvent);
+    }
+  });
+
+  // Substitutes are configured for this sandbox's origin; a realm loading one would act as the host
+  std::set<std::string> hostConfiguredModules;
+  for (const auto &pair : _turboModuleSubstitutions) {
+    hostConfiguredModules.insert(pair.first);
+    hostConfiguredModules.insert(pair.second);
+  }
+
+  for (auto config : _realms) {
+    config.hostConfiguredModules = hostConfiguredModules;
+    auto realm = _realmSet->add(config);
+    if (!realm) {
+      [self reportBundleError:fmt::format("Realm '{}' has no origin or a duplicate one", config.origin)
+                         name:"RealmError"];
+      continue;
+    }
+
+    NSError *error = nil;
+    NSString *source = [NSString stringWithUTF8String:config.bundleSource.c_str()];
+    NSURL *url = [RCTSandboxBundlePreloader awaitPreloadedURLForSource:source timeout:kBundleFileTimeout error:&error];
+    std::string errorMessage;
+    if (!url) {
+      errorMessage = error.localizedDescription.UTF8String ?: "Bundle not found";
+    } else {
+      try {
+        rnsandbox::startRealm(runtime, realm, url.path.UTF8String, url.absoluteString.UTF8String);
+        continue;
+      } catch (const jsi::JSError &e) {
+        errorMessage = e.getMessage();
+      } catch (const std::exception &e) {
+        errorMessage = e.what();
+      }
+    }
+    _realmSet->remove(config.origin);
+    [self reportBundleError:fmt::format("Realm '{}' failed to start: {}", config.origin, errorMessage)
+                       name:"RealmError"];
+  }
+}
+
+- (void)stopRealms
+{
+  _realmSet.reset();
+  if (_realmHost) {
+    _realmHost->invalidate();
+    _realmHost.reset();
+  }
+}
+
+#pragma mark - Hot Bundle Swap
+
+- (void)resolveBundleFiles:(void (^)(NSArray<NSURL *> *_Nullable files))completion
+{
+  // The base bundle is already loaded in the runtime and stays; changing it reloads the sandbox instead
+  NSMutableArray<NSString *> *sources = [NSMutableArray array];
+  if (!_jsBundleSource.empty()) {
+    [sources addObject:[NSString stringWithUTF8String:_jsBundleSource.c_str()]];
+  }
+
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+    NSMutableArray<NSURL *> *files = [NSMutableArray array];
+    for (NSString *source in sources) {
+      NSError *error = nil;
+      NSURL *file = [RCTSandboxBundlePreloader awaitPreloadedURLForSource:source
+                                                                  timeout:kBundleFileTimeout
+                                                                    error:&error];
+      if (!file) {
+        NSLog(@"[SandboxReactNativeDelegate] Cannot hot swap to %@: %@", source, error.localizedDescription);
+        files = nil;
+        break;
+      }
+      [files addObject:file];
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+      completion(files.count > 0 ? files : nil);
+    });
+  });
+}
+
+- (void)swapInBundleFiles:(NSArray<NSURL *> *)files completion:(void (^)(BOOL swapped))completion
+{
+  if (!_rctInstance || files.count == 0) {
+    completion(NO);
+    return;
+  }
+  [self markStartupPhase:rnsandbox::StartupPhase::BundleLoadStarted];
+
+  std::vector<std::pair<std::string, std::string>> bundles;
+  for (NSURL *file in files) {
+    bundles.emplace_back(file.path.UTF8String, file.absoluteString.UTF8String);
+  }
+  // Not through scheduleOnJSThread: evaluating a bundle may outlast the watchdog's budget
+  [_rctInstance callFunctionOnBufferedRuntimeExecutor:[=](jsi::Runtime &runtime) {
+    // A bundle that threw partway may have left the runtime half replaced
+    if (_needsReload) {
+      dispatch_async(dispatch_get_main_queue(), ^{
+        completion(NO);
+      });
+      return;
+    }
+
+    // Like a fresh runtime in hostDidStart:, minus the bindings, which stay installed: nothing may call into the
+    // old bundle's callbacks. Timers it set are not tracked and still fire. Messages wait in _pendingMessages until
+    // the new bundle calls setOnMessage.
+    _onMessageSandbox.reset();
+    _messagePorts->closeAll();
+    if (_jsHandlers) {
+      _jsHandlers->resetAll();
+    }
+
+    BOOL swapped = YES;
+    for (const auto &[path, sourceURL] : bundles) {
+      if (_watchdogArmed && isHermesBytecodeFile(path)) {
+        _watchdogArmed = false;
+        [self applyWatchdogBudget];
+      }
+      try {
+        rnsandbox::evaluateBundleFile(runtime, path, sourceURL);
+      } catch (const jsi::JSError &e) {
+        [self reportBundleError:fmt::format("Hot swap to {} failed: {}", sourceURL, e.getMessage())
+                           name:"BundleSwapError"];
+        swapped = NO;
+        break;
+      } catch (const std::exception &e) {
+        [self reportBundleError:fmt::format("Hot swap to {} failed: {}", sourceURL, e.what()) name:"BundleSwapError"];
+        swapped = NO;
+        break;
+      }
+    }
+    if (swapped) {
+      [self markStartupPhase:rnsandbox::StartupPhase::BundleLoaded];
+    } else {
+      _needsReload = YES;
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+      completion(swapped);
+    });
+  }];
 }
 
 /**
@@ -391,11 +1199,16 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
     auto cxxModule = [super getTurboModule:resolvedName jsInvoker:jsInvoker];
     if (cxxModule) {
       if (auto sandboxAware = std::dynamic_pointer_cast<rnsandbox::ISandboxAwareModule>(cxxModule)) {
-        sandboxAware->configureSandbox({
+        rnsandbox::SandboxContext context{
             .origin = _origin,
             .requestedModuleName = name,
             .resolvedModuleName = resolvedName,
-        });
+            .sharingScope = "",
+        };
+        // Bound to this runtime's invoker, so the module itself is not shared; it shares its state by this scope
+        context.sharingScope = rnsandbox::moduleSharingScope(
+            sandboxAware->moduleSharing(), context, sandboxAware->sharingGroup(_origin));
+        sandboxAware->configureSandbox(context);
       }
       return cxxModule;
     }
@@ -457,14 +1270,11 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
     return nullptr;
   }
 
-  id<RCTBridgeModule> module = [moduleClass new];
-
-  if ([(id)module conformsToProtocol:@protocol(RCTSandboxAwareModule)]) {
-    NSString *originNS = [NSString stringWithUTF8String:_origin.c_str()];
-    NSString *requestedNameNS = [NSString stringWithUTF8String:requestedName.c_str()];
-    [(id<RCTSandboxAwareModule>)module configureSandboxWithOrigin:originNS
-                                                    requestedName:requestedNameNS
-                                                     resolvedName:moduleName];
+  id<RCTBridgeModule> module = [self _instantiateSubstitutedModule:moduleClass
+                                                     requestedName:requestedName
+                                                      resolvedName:moduleNameStr];
+  if (!module) {
+    return nullptr;
   }
 
   _substitutedModuleInstances[moduleName] = module;
@@ -488,10 +1298,18 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
     // Try the dependency provider first (for Codegen TurboModules)
     id<RCTModuleProvider> provider = [super getModuleProvider:it->second.c_str()];
 
-    if (!provider) {
+    if (provider) {
+      if ([(id)provider conformsToProtocol:@protocol(RCTSandboxAwareModule)]) {
+        NSString *originNS = [NSString stringWithUTF8String:_origin.c_str()];
+        NSString *requestedNameNS = [NSString stringWithUTF8String:nameStr.c_str()];
+        [(id<RCTSandboxAwareModule>)provider configureSandboxWithOrigin:originNS
+                                                          requestedName:requestedNameNS
+                                                           resolvedName:resolvedName];
+      }
+    } else {
       for (Class moduleClass in RCTGetModuleClasses()) {
         if ([[moduleClass moduleName] isEqualToString:resolvedName]) {
-          provider = [moduleClass new];
+          provider = [self _instantiateSubstitutedModule:moduleClass requestedName:nameStr resolvedName:it->second];
           break;
         }
       }
@@ -501,14 +1319,6 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
       return nullptr;
     }
 
-    if ([(id)provider conformsToProtocol:@protocol(RCTSandboxAwareModule)]) {
-      NSString *originNS = [NSString stringWithUTF8String:_origin.c_str()];
-      NSString *requestedNameNS = [NSString stringWithUTF8String:nameStr.c_str()];
-      [(id<RCTSandboxAwareModule>)provider configureSandboxWithOrigin:originNS
-                                                        requestedName:requestedNameNS
-                                                         resolvedName:resolvedName];
-    }
-
     if ([(id)provider conformsToProtocol:@protocol(RCTBridgeModule)]) {
       _substitutedModuleInstances[resolvedName] = (id<RCTBridgeModule>)provider;
     }
@@ -543,14 +1353,11 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
     return nullptr;
   }
 
-  id<RCTBridgeModule> instance = [moduleClass new];
-
-  if ([(id)instance conformsToProtocol:@protocol(RCTSandboxAwareModule)]) {
-    NSString *originNS = [NSString stringWithUTF8String:_origin.c_str()];
-    NSString *requestedNameNS = [NSString stringWithUTF8String:requestedName.c_str()];
-    [(id<RCTSandboxAwareModule>)instance configureSandboxWithOrigin:originNS
-                                                      requestedName:requestedNameNS
-                                                       resolvedName:resolvedNameNS];
+  id<RCTBridgeModule> instance = [self _instantiateSubstitutedModule:moduleClass
+                                                       requestedName:requestedName
+                                                        resolvedName:resolvedName];
+  if (!instance) {
+    return nullptr;
   }
 
   _substitutedModuleInstances[resolvedNameNS] = instance;
@@ -562,6 +1369,59 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
   return [self _wrapObjCModule:instance moduleName:requestedName jsInvoker:jsInvoker];
 }
 
+// A new configured instance of a substituted module class, or the one shared under the scope its
+// sandboxModuleSharing declares, which this sandbox then holds until it cleans up
+- (id<RCTBridgeModule>)_instantiateSubstitutedModule:(Class)moduleClass
+                                       requestedName:(const std::string &)requestedName
+                                        resolvedName:(const std::string &)resolvedName
+{
+  NSString *originNS = [NSString stringWithUTF8String:_origin.c_str()];
+  auto create = [&]() -> id<RCTBridgeModule> {
+    id<RCTBridgeModule> module = [moduleClass new];
+    if ([(id)module conformsToProtocol:@protocol(RCTSandboxAwareModule)]) {
+      [(id<RCTSandboxAwareModule>)module configureSandboxWithOrigin:originNS
+                                                      requestedName:@(requestedName.c_str())
+                                                       resolvedName:@(resolvedName.c_str())];
+    }
+    return module;
+  };
+
+  auto sharing = rnsandbox::ModuleSharing::PerSandbox;
+  if ([moduleClass respondsToSelector:@selector(sandboxModuleSharing)]) {
+    sharing = static_cast<rnsandbox::ModuleSharing>([moduleClass sandboxModuleSharing]);
+  }
+  std::string group;
+  if (sharing == rnsandbox::ModuleSharing::PerGroup &&
+      [moduleClass respondsToSelector:@selector(sandboxSharingGroupForOrigin:)]) {
+    NSString *groupNS = [moduleClass sandboxSharingGroupForOrigin:originNS];
+    group = groupNS ? groupNS.UTF8String : "";
+  }
+  rnsandbox::SandboxContext context{
+      .origin = _origin,
+      .requestedModuleName = requestedName,
+      .resolvedModuleName = resolvedName,
+      .sharingScope = "",
+  };
+  std::string scope = rnsandbox::moduleSharingScope(sharing, context, group);
+  if (scope.empty()) {
+    return create();
+  }
+
+  auto instance = rnsandbox::SharedModuleRegistry::getInstance().acquire(
+      resolvedName, scope, [&]() -> rnsandbox::SharedModuleRegistry::Handle {
+        id<RCTBridgeModule> module = create();
+        if (!module) {
+          return nullptr;
+        }
+        return {(__bridge_retained void *)module, [](void *retained) { CFBridgingRelease(retained); }};
+      });
+  if (!instance) {
+    return nil;
+  }
+  _sharedModuleUsers.emplace_back(resolvedName, scope);
+  return (__bridge id<RCTBridgeModule>)instance.get();
+}
+
 - (std::shared_ptr<facebook::react::TurboModule>)_wrapObjCModule:(id<RCTBridgeModule>)instance
                                                       moduleName:(const std::string &)moduleName
                                                        jsInvoker:
@@ -573,21 +1433,38 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
     methodQueue = [instance methodQueue];
   }
 
-  if (!methodQueue) {
-    NSString *label = [NSString stringWithFormat:@"com.sandbox.%s", moduleName.c_str()];
-    methodQueue = dispatch_queue_create(label.UTF8String, DISPATCH_QUEUE_SERIAL);
-
-    if (hasMethodQueueGetter) {
+  auto &executor = rnsandbox::SandboxExecutor::getInstance();
+  std::string lane = _origin + "/" + moduleName;
+  auto substitution = _turboModuleSubstitutions.find(moduleName);
+  auto context = std::make_shared<const rnsandbox::SandboxContext>(rnsandbox::SandboxContext{
+      .origin = _origin,
+      .requestedModuleName = moduleName,
+      .resolvedModuleName = substitution != _turboModuleSubstitutions.end() ? substitution->second : moduleName,
+      .sharingScope = "",
+  });
+  std::shared_ptr<SandboxNativeMethodCallInvoker> nativeInvoker;
+  if (!methodQueue && !hasMethodQueueGetter) {
+    // Nothing but the invoker dispatches for this module, so it shares the executor's bounded pool
+    nativeInvoker =
+        std::make_shared<SandboxNativeMethodCallInvoker>(executor.strand(lane), context, _cpuAccount.load());
+  } else {
+    if (!methodQueue) {
+      // The module dispatches to its methodQueue itself. Targeting a global queue keeps it a serial queue
+      // without a thread of its own.
+      NSString *label = [NSString stringWithFormat:@"com.sandbox.%s", moduleName.c_str()];
+      methodQueue = dispatch_queue_create_with_target(
+          label.UTF8String, DISPATCH_QUEUE_SERIAL, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
       @try {
         [(id)instance setValue:methodQueue forKey:@"methodQueue"];
       } @catch (NSException *exception) {
         RCTLogError(@"[Sandbox] Failed to set methodQueue on module '%s': %@", moduleName.c_str(), exception.reason);
       }
     }
+    auto metrics = methodQueue == RCTJSThread ? nullptr : executor.laneMetrics(lane);
+    nativeInvoker =
+        std::make_shared<SandboxNativeMethodCallInvoker>(methodQueue, metrics, context, _cpuAccount.load());
   }
 
-  auto nativeInvoker = std::make_shared<SandboxNativeMethodCallInvoker>(methodQueue);
-
   facebook::react::ObjCTurboModule::InitParams params = {
       .moduleName = moduleName,
       .instance = instance,
@@ -604,7 +1481,7 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
   return jsi::Function::createFromHostFunction(
       runtime,
       jsi::PropNameID::forAscii(runtime, "postMessage"),
-      2, // Updated to accept up to 2 arguments
+      3, // message, targetOrigin?, options?
       [=](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args, size_t count) {
         // Validate runtime before any JSI operations
         try {
@@ -613,23 +1490,28 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
           return jsi::Value::undefined();
         }
 
-        if (count < 1 || count > 2) {
-          throw jsi::JSError(rt, "Expected 1 or 2 arguments: postMessage(message, targetOrigin?)");
+        if (count < 1 || count > 3) {
+          throw jsi::JSError(rt, "Expected 1 to 3 arguments: postMessage(message, targetOrigin?, options?)");
         }
 
+        auto *cpuAccount = _cpuAccount.load();
+        rnsandbox::CpuScope callScope(cpuAccount, rnsandbox::CpuCategory::NativeCall);
+
         const jsi::Value &messageArg = args[0];
         if (!messageArg.isObject()) {
           throw jsi::JSError(rt, "Expected an object as the first argument");
         }
 
         // Check if targetOrigin is provided
-        if (count == 2 && !args[1].isNull() && !args[1].isUndefined()) {
+        if (count >= 2 && !args[1].isNull() && !args[1].isUndefined()) {
           const jsi::Value &targetOriginArg = args[1];
           if (!targetOriginArg.isString()) {
             throw jsi::JSError(rt, "Expected a string as the second argument (targetOrigin)");
           }
 
           std::string targetOrigin = targetOriginArg.getString(rt).utf8(rt);
+          jsi::Value noOptions;
+          auto options = rnsandbox::parsePostMessageOptions(rt, count > 2 ? args[2] : noOptions);
 
           // Prevent self-targeting
           if (_origin == targetOrigin) {
@@ -646,13 +1528,20 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
           }
 
           // Convert message to JSON string
-          jsi::Object jsonObject = rt.global().getPropertyAsObject(rt, "JSON");
-          jsi::Function jsonStringify = jsonObject.getPropertyAsFunction(rt, "stringify");
-          jsi::Value jsonResult = jsonStringify.call(rt, messageArg);
-          std::string messageJson = jsonResult.getString(rt).utf8(rt);
+          std::string messageJson;
+          {
+            rnsandbox::CpuScope scope(cpuAccount, rnsandbox::CpuCategory::Serialization);
+            jsi::Object jsonObject = rt.global().getPropertyAsObject(rt, "JSON");
+            jsi::Function jsonStringify = jsonObject.getPropertyAsFunction(rt, "stringify");
+            jsi::Value jsonResult = jsonStringify.call(rt, messageArg);
+            messageJson = jsonResult.getString(rt).utf8(rt);
+          }
 
           // Route message to specific sandbox
-          BOOL success = [self routeMessage:messageJson toSandbox:targetOrigin];
+          BOOL success = [self routeMessage:messageJson
+                                 toSandbox:targetOrigin
+                                  priority:options.priority
+                                       ttl:options.ttl];
           if (!success) {
             // Target sandbox doesn't exist - trigger error event
             if (self.eventEmitter && self.hasOnErrorHandler) {
@@ -669,7 +1558,12 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
         } else {
           // targetOrigin is undefined/null - route to host (backward compatibility)
           if (self.eventEmitter && self.hasOnMessageHandler) {
-            SandboxReactNativeViewEventEmitter::OnMessage messageEvent = {.data = jsi::dynamicFromValue(rt, args[0])};
+            folly::dynamic data;
+            {
+              rnsandbox::CpuScope scope(cpuAccount, rnsandbox::CpuCategory::Serialization);
+              data = jsi::dynamicFromValue(rt, args[0]);
+            }
+            SandboxReactNativeViewEventEmitter::OnMessage messageEvent = {.data = std::move(data)};
             self.eventEmitter->onMessage(messageEvent);
           }
         }
@@ -700,6 +1594,13 @@ static std::string safeGetStringProperty(jsi::Runtime &rt, const jsi::Object &ob
         // This prevents crash if old function is tied to invalid runtime
         _onMessageSandbox.reset();
         _onMessageSandbox = std::make_shared<jsi::Function>(std::move(fn));
+        [self markStartupPhase:rnsandbox::StartupPhase::OnMessageRegistered];
+
+        std::vector<std::string> buffered;
+        buffered.swap(_pendingMessages);
+        for (const auto &message : buffered) {
+          [self deliverMessage:message runtime:rt];
+        }
 
         return jsi::Value::undefined();
       });
@@ -9,19 +9,135 @@
 #import <React/RCTConversions.h>
 #import <React/RCTFabricComponentsPlugins.h>
 #import <React/RCTFollyConvert.h>
+#import <React/RCTRootView.h>
+#import <React/RCTSurfaceHostingProxyRootView.h>
+#import <React/RCTSurfaceProtocol.h>
 #import <ReactCommon/RCTHost+Internal.h>
 #import <ReactCommon/RCTHost.h>
 
 #import "SandboxReactNativeDelegate.h"
 
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+#include "SandboxRuntimeParking.h"
+#include "SandboxViewportProximity.h"
+#include "SharedStateStore.h"
+
 using namespace facebook::react;
 
 @interface SandboxReactNativeViewComponentView () <RCTSandboxReactNativeViewViewProtocol>
 @property (nonatomic, strong) RCTReactNativeFactory *reactNativeFactory;
 @property (nonatomic, strong, nullable) SandboxReactNativeDelegate *reactNativeDelegate;
 @property (nonatomic, assign) BOOL didScheduleLoad;
+@property (nonatomic, strong, nullable) id contentAppearedObserver;
+// Bumped by every bundle change, so an outdated hot swap stops early
+@property (nonatomic, assign) NSUInteger bundleGeneration;
+// Whether a lazy view is near enough to the viewport to run its runtime
+@property (nonatomic, assign) BOOL lazyStarted;
+// Ancestors whose scrolling moves a lazy view relative to the viewport
+@property (nonatomic, copy, nullable) NSArray<UIScrollView *> *observedScrollViews;
+@end
+
+/**
+ * The runtime of an unmounted view, waiting in SandboxRuntimeParking for the next view with the same key.
+ */
+@interface SandboxParkedRuntime : NSObject
+@property (nonatomic, strong) SandboxReactNativeDelegate *delegate;
+@property (nonatomic, strong) RCTReactNativeFactory *factory;
+@property (nonatomic, strong) UIView *rootView;
+@property (nonatomic, assign) std::shared_ptr<const SandboxReactNativeViewProps> props;
+@end
+
+@implementation SandboxParkedRuntime
 @end
 
+namespace {
+
+const std::shared_ptr<const SandboxReactNativeViewProps> &defaultViewProps()
+{
+  static const auto defaultProps = std::make_shared<const SandboxReactNativeViewProps>();
+  return defaultProps;
+}
+
+std::string parkingKey(const SandboxReactNativeViewProps &props)
+{
+  return rnsandbox::SandboxRuntimeParking::makeKey(
+      {props.origin, props.jsBundleSource, props.jsBaseBundleSource, props.componentName});
+}
+
+// Main thread only. Runtimes released by the parking lot are dropped from here, which tears them down.
+NSMutableDictionary<NSNumber *, SandboxParkedRuntime *> *parkedRuntimes()
+{
+  static NSMutableDictionary<NSNumber *, SandboxParkedRuntime *> *runtimes;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    runtimes = [NSMutableDictionary new];
+    rnsandbox::SandboxRuntimeParking::getInstance().setReleaseHook([](rnsandbox::SandboxRuntimeParking::ParkId id) {
+      dispatch_async(dispatch_get_main_queue(), ^{
+        [runtimes removeObjectForKey:@(id)];
+      });
+    });
+  });
+  return runtimes;
+}
+
+void *kViewportObservationContext = &kViewportObservationContext;
+
+std::set<std::string> stringSet(const folly::dynamic &value)
+{
+  std::set<std::string> result;
+  if (value.isArray()) {
+    for (const auto &item : value) {
+      if (item.isString()) {
+        result.insert(item.getString());
+      }
+    }
+  }
+  return result;
+}
+
+// Entries without a string origin and jsBundleSource are skipped
+std::vector<rnsandbox::RealmConfig> realmConfigs(const folly::dynamic &value)
+{
+  std::vector<rnsandbox::RealmConfig> realms;
+  if (!value.isArray()) {
+    return realms;
+  }
+  for (const auto &item : value) {
+    if (!item.isObject()) {
+      continue;
+    }
+    const auto *origin = item.get_ptr("origin");
+    const auto *source = item.get_ptr("jsBundleSource");
+    if (!origin || !origin->isString() || !source || !source->isString()) {
+      continue;
+    }
+    rnsandbox::RealmConfig config;
+    config.origin = origin->getString();
+    config.bundleSource = source->getString();
+    if (const auto *modules = item.get_ptr("allowedTurboModules")) {
+      config.allowedTurboModules = stringSet(*modules);
+    }
+    if (const auto *origins = item.get_ptr("allowedOrigins")) {
+      config.allowedOrigins = stringSet(*origins);
+    }
+    const auto *subs = item.get_ptr("turboModuleSubstitutions");
+    if (subs && subs->isObject()) {
+      for (const auto &pair : subs->items()) {
+        if (pair.first.isString() && pair.second.isString()) {
+          config.turboModuleSubstitutions[pair.first.getString()] = pair.second.getString();
+        }
+      }
+    }
+    realms.push_back(std::move(config));
+  }
+  return realms;
+}
+
+} // namespace
+
 @implementation SandboxReactNativeViewComponentView {
   SandboxReactNativeViewShadowNode::ConcreteState::Shared _state;
 }
@@ -34,16 +150,36 @@ using namespace facebook::react;
 - (instancetype)initWithFrame:(CGRect)frame
 {
   if (self = [super initWithFrame:frame]) {
-    static const auto defaultProps = std::make_shared<const SandboxReactNativeViewProps>();
-    _props = defaultProps;
-
-    // Create delegate once during initialization
-    self.reactNativeDelegate = [[SandboxReactNativeDelegate alloc] init];
+    _props = defaultViewProps();
+    [self attachNewDelegate];
   }
 
   return self;
 }
 
+// Created once per view, and again after the view's runtime was parked
+- (void)attachNewDelegate
+{
+  auto viewCreated = rnsandbox::StartupTimeline::Clock::now();
+  SandboxReactNativeDelegate *delegate = [[SandboxReactNativeDelegate alloc] init];
+  delegate.startupTimeline->restart(viewCreated);
+  delegate.startupTimeline->mark(rnsandbox::StartupPhase::ViewCreated, viewCreated);
+  [delegate markStartupPhase:rnsandbox::StartupPhase::DelegateCreated];
+  [self attachDelegate:delegate];
+}
+
+- (void)attachDelegate:(SandboxReactNativeDelegate *)delegate
+{
+  self.reactNativeDelegate = delegate;
+  __weak SandboxReactNativeViewComponentView *weakSelf = self;
+  delegate.onWakeRequest = ^{
+    [weakSelf resume];
+  };
+  delegate.onMemoryEviction = ^{
+    [weakSelf hibernate];
+  };
+}
+
 - (void)updateEventEmitter:(const facebook::react::EventEmitter::Shared &)eventEmitter
 {
   [super updateEventEmitter:eventEmitter];
@@ -63,11 +199,24 @@ using namespace facebook::react;
 
 - (void)updateProps:(const Props::Shared &)props oldProps:(const Props::Shared &)oldProps
 {
-  const auto &oldViewProps = *std::static_pointer_cast<const SandboxReactNativeViewProps>(_props);
   const auto &newViewProps = *std::static_pointer_cast<const SandboxReactNativeViewProps>(props);
+  auto previousProps = std::static_pointer_cast<const SandboxReactNativeViewProps>(_props);
+  // Only the changes since the parked runtime's last props are applied to it. A lazy view claims one once it starts.
+  if (!newViewProps.lazy || self.lazyStarted) {
+    if (auto parkedProps = [self adoptParkedRuntimeForProps:newViewProps]) {
+      previousProps = parkedProps;
+    }
+  }
+  const auto &oldViewProps = *previousProps;
 
   [super updateProps:props oldProps:oldProps];
 
+  [self applyViewProps:newViewProps oldViewProps:oldViewProps];
+}
+
+- (void)applyViewProps:(const SandboxReactNativeViewProps &)newViewProps
+          oldViewProps:(const SandboxReactNativeViewProps &)oldViewProps
+{
   if (self.reactNativeDelegate) {
     if (oldViewProps.origin != newViewProps.origin) {
       [self.reactNativeDelegate setOrigin:newViewProps.origin];
@@ -75,12 +224,20 @@ using namespace facebook::react;
 
     if (oldViewProps.jsBundleSource != newViewProps.jsBundleSource) {
       [self.reactNativeDelegate setJsBundleSource:newViewProps.jsBundleSource];
-      RCTHost *host = self.reactNativeFactory.rootViewFactory.reactHost;
-      if (host) {
-        [host reload];
+      self.bundleGeneration++;
+      if (newViewProps.hotSwapBundles && [self surfaceForHotSwap]) {
+        [self hotSwapBundle];
+      } else {
+        [self reloadHost];
       }
     }
 
+    if (oldViewProps.jsBaseBundleSource != newViewProps.jsBaseBundleSource) {
+      self.reactNativeDelegate.jsBaseBundleSource = newViewProps.jsBaseBundleSource;
+      self.bundleGeneration++;
+      [self reloadHost];
+    }
+
     if (oldViewProps.allowedTurboModules != newViewProps.allowedTurboModules) {
       // Convert std::vector to std::set
       std::set<std::string> allowedModules(
@@ -94,6 +251,16 @@ using namespace facebook::react;
       [self.reactNativeDelegate setAllowedOrigins:allowedOrigins];
     }
 
+    if (oldViewProps.sharedStateReadKeys != newViewProps.sharedStateReadKeys) {
+      std::set<std::string> readKeys(newViewProps.sharedStateReadKeys.begin(), newViewProps.sharedStateReadKeys.end());
+      [self.reactNativeDelegate setSharedStateReadKeys:readKeys];
+    }
+
+    if (oldViewProps.sharedStateWriteKeys != newViewProps.sharedStateWriteKeys) {
+      std::set<std::string> writeKeys(newViewProps.sharedStateWriteKeys.begin(), newViewProps.sharedStateWriteKeys.end());
+      [self.reactNativeDelegate setSharedStateWriteKeys:writeKeys];
+    }
+
     if (oldViewProps.turboModuleSubstitutions != newViewProps.turboModuleSubstitutions) {
       std::map<std::string, std::string> subs;
       if (newViewProps.turboModuleSubstitutions.isObject()) {
@@ -106,6 +273,32 @@ using namespace facebook::react;
       [self.reactNativeDelegate setTurboModuleSubstitutions:subs];
     }
 
+    if (oldViewProps.realms != newViewProps.realms) {
+      self.reactNativeDelegate.realms = realmConfigs(newViewProps.realms);
+    }
+
+    if (oldViewProps.hibernationWakePolicy != newViewProps.hibernationWakePolicy) {
+      auto policy = rnsandbox::HibernationWakePolicy::Queue;
+      rnsandbox::parseHibernationWakePolicy(newViewProps.hibernationWakePolicy, policy);
+      self.reactNativeDelegate.hibernation->setWakePolicy(policy);
+    }
+
+    if (oldViewProps.heapLimitMB != newViewProps.heapLimitMB) {
+      // Takes full effect, including the runtime's heap cap, on the next host
+      size_t heapLimitMB = static_cast<size_t>(std::max(newViewProps.heapLimitMB, 0));
+      self.reactNativeDelegate.heapLimitBytes = heapLimitMB * 1024 * 1024;
+    }
+
+    if (oldViewProps.evictionPolicy != newViewProps.evictionPolicy) {
+      auto policy = rnsandbox::EvictionPolicy::Hibernate;
+      rnsandbox::parseEvictionPolicy(newViewProps.evictionPolicy, policy);
+      self.reactNativeDelegate.evictionPolicy = policy;
+    }
+
+    if (oldViewProps.watchdogTimeoutMs != newViewProps.watchdogTimeoutMs) {
+      self.reactNativeDelegate.watchdogTimeout = std::chrono::milliseconds(std::max(newViewProps.watchdogTimeoutMs, 0));
+    }
+
     self.reactNativeDelegate.hasOnMessageHandler = newViewProps.hasOnMessageHandler;
     self.reactNativeDelegate.hasOnErrorHandler = newViewProps.hasOnErrorHandler;
 
@@ -125,6 +318,39 @@ using namespace facebook::react;
       oldViewProps.launchOptions != newViewProps.launchOptions) {
     [self scheduleReactViewLoad];
   }
+
+  if (oldViewProps.lazy != newViewProps.lazy) {
+    self.lazyStarted = self.reactNativeRootView != nil;
+    if (newViewProps.lazy) {
+      [self startViewportObservation];
+    } else {
+      [self stopViewportObservation];
+      if (!self.reactNativeRootView) {
+        [self scheduleReactViewLoad];
+      }
+    }
+  } else if (oldViewProps.lazyLoadDistance != newViewProps.lazyLoadDistance ||
+             oldViewProps.lazyReleaseDistance != newViewProps.lazyReleaseDistance) {
+    [self updateViewportProximity];
+  }
+}
+
+- (void)updateLayoutMetrics:(const LayoutMetrics &)layoutMetrics
+           oldLayoutMetrics:(const LayoutMetrics &)oldLayoutMetrics
+{
+  [super updateLayoutMetrics:layoutMetrics oldLayoutMetrics:oldLayoutMetrics];
+  [self updateViewportProximity];
+}
+
+- (void)didMoveToWindow
+{
+  [super didMoveToWindow];
+  const auto &props = *std::static_pointer_cast<const SandboxReactNativeViewProps>(_props);
+  if (self.window && props.lazy) {
+    [self startViewportObservation];
+  } else {
+    [self stopViewportObservation];
+  }
 }
 
 - (void)updateEventEmitterIfNeeded
@@ -141,10 +367,46 @@ using namespace facebook::react;
   RCTSandboxReactNativeViewHandleCommand(self, commandName, args);
 }
 
-- (void)postMessage:(NSString *)message
+- (void)postMessage:(NSString *)message urgent:(BOOL)urgent
 {
   std::string messageStr = [message UTF8String];
-  [self.reactNativeDelegate postMessage:messageStr];
+  [self.reactNativeDelegate postMessage:messageStr
+                               priority:urgent ? rnsandbox::MessagePriority::Urgent : rnsandbox::MessagePriority::Bulk];
+}
+
+- (void)setSharedState:(NSString *)key value:(NSString *)value
+{
+  std::optional<std::string> json;
+  if (value.length > 0) {
+    json = std::string([value UTF8String]);
+  }
+  rnsandbox::SharedStateStore::getInstance().hostWrite([key UTF8String], std::move(json));
+}
+
+- (void)hibernate
+{
+  __weak SandboxReactNativeViewComponentView *weakSelf = self;
+  [self.reactNativeDelegate hibernateWithCompletion:^(BOOL resumeRequested) {
+    SandboxReactNativeViewComponentView *strongSelf = weakSelf;
+    if (!strongSelf) {
+      return;
+    }
+    [strongSelf.reactNativeRootView removeFromSuperview];
+    strongSelf.reactNativeRootView = nil;
+    // Releases the host and with it the runtime
+    strongSelf.reactNativeFactory = nil;
+    if (resumeRequested) {
+      [strongSelf resume];
+    }
+  }];
+}
+
+- (void)resume
+{
+  if (self.reactNativeDelegate.hibernation->resume()) {
+    self.reactNativeDelegate.startupTimeline->restart();
+    [self scheduleReactViewLoad];
+  }
 }
 
 - (void)scheduleReactViewLoad
@@ -170,6 +432,16 @@ using namespace facebook::react;
     return;
   }
 
+  // Prop changes while hibernated are picked up on resume
+  if (self.reactNativeDelegate.hibernation->state() != rnsandbox::HibernationState::Active) {
+    return;
+  }
+
+  // A lazy view loads once it nears the viewport
+  if (props.lazy && !self.lazyStarted) {
+    return;
+  }
+
   // Convert props to Objective-C types
   NSDictionary *initialProperties = @{};
   if (!props.initialProperties.isNull()) {
@@ -182,11 +454,18 @@ using namespace facebook::react;
   }
 
   if (!self.reactNativeFactory) {
+    [self.reactNativeDelegate markStartupPhase:rnsandbox::StartupPhase::HostCreated];
     self.reactNativeFactory = [[RCTReactNativeFactory alloc] initWithDelegate:self.reactNativeDelegate];
   }
+  if (!self.reactNativeFactory.rootViewFactory.reactHost) {
+    // Started here rather than lazily by the root view factory, so the runtime delegate is set before the host starts
+    self.reactNativeFactory.rootViewFactory.reactHost =
+        [self.reactNativeDelegate startReactHostForFactory:self.reactNativeFactory launchOptions:launchOptions];
+  }
   UIView *rnView = [self.reactNativeFactory.rootViewFactory viewWithModuleName:moduleName
                                                              initialProperties:initialProperties
                                                                  launchOptions:launchOptions];
+  [self observeFirstFrameOfView:rnView];
 
   [self.reactNativeRootView removeFromSuperview];
   self.reactNativeRootView = rnView;
@@ -198,16 +477,308 @@ using namespace facebook::react;
   [self updateEventEmitterIfNeeded];
 }
 
+- (void)reloadHost
+{
+  RCTHost *host = self.reactNativeFactory.rootViewFactory.reactHost;
+  if (host) {
+    self.reactNativeDelegate.startupTimeline->restart();
+    [self.reactNativeDelegate markStartupPhase:rnsandbox::StartupPhase::HostCreated];
+    [host reload];
+  }
+}
+
+- (nullable id<RCTSurfaceProtocol>)surfaceForHotSwap
+{
+  if (![self.reactNativeRootView isKindOfClass:[RCTSurfaceHostingProxyRootView class]]) {
+    return nil;
+  }
+  return ((RCTSurfaceHostingProxyRootView *)self.reactNativeRootView).surface;
+}
+
+/**
+ * Replaces the running bundle with jsBundleSource in the same runtime: the surface is stopped, the new bundle is
+ * evaluated on the JS thread and the surface is started again, running the new bundle's component. Falls back to a
+ * host reload whenever a step fails.
+ */
+- (void)hotSwapBundle
+{
+  NSUInteger generation = self.bundleGeneration;
+  self.reactNativeDelegate.startupTimeline->restart();
+
+  __weak SandboxReactNativeViewComponentView *weakSelf = self;
+  [self.reactNativeDelegate resolveBundleFiles:^(NSArray<NSURL *> *_Nullable files) {
+    SandboxReactNativeViewComponentView *strongSelf = weakSelf;
+    if (!strongSelf || strongSelf.bundleGeneration != generation) {
+      return;
+    }
+    id<RCTSurfaceProtocol> surface = [strongSelf surfaceForHotSwap];
+    if (!files || !surface) {
+      [strongSelf reloadHost];
+      return;
+    }
+
+    // Queues the old bundle's unmount on the JS thread ahead of the new bundle
+    [surface stop];
+    [strongSelf.reactNativeDelegate swapInBundleFiles:files
+                                           completion:^(BOOL swapped) {
+                                             SandboxReactNativeViewComponentView *view = weakSelf;
+                                             if (!view) {
+                                               return;
+                                             }
+                                             if (!swapped) {
+                                               [view reloadHost];
+                                               return;
+                                             }
+                                             [view observeFirstFrameOfView:view.reactNativeRootView];
+                                             [surface start];
+                                           }];
+  }];
+}
+
+- (void)observeFirstFrameOfView:(UIView *)rnView
+{
+  NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+  if (self.contentAppearedObserver) {
+    [center removeObserver:self.contentAppearedObserver];
+  }
+  // Posted by the surface's root view once its initial mounting is done
+  __weak SandboxReactNativeDelegate *weakDelegate = self.reactNativeDelegate;
+  void (^onContentAppeared)(NSNotification *) = ^(NSNotification *) {
+    [weakDelegate markStartupPhase:rnsandbox::StartupPhase::FirstFrame];
+  };
+  self.contentAppearedObserver = [center addObserverForName:RCTContentDidAppearNotification
+                                                     object:rnView
+                                                      queue:[NSOperationQueue mainQueue]
+                                                 usingBlock:onContentAppeared];
+}
+
+- (void)dealloc
+{
+  [self stopViewportObservation];
+  if (self.contentAppearedObserver) {
+    [[NSNotificationCenter defaultCenter] removeObserver:self.contentAppearedObserver];
+  }
+}
+
 - (void)prepareForRecycle
 {
   [super prepareForRecycle];
 
+  [self stopViewportObservation];
+  self.lazyStarted = NO;
+
+  if ([self parkRuntime]) {
+    _props = defaultViewProps();
+    return;
+  }
+
   [self.reactNativeRootView removeFromSuperview];
   self.reactNativeRootView = nil;
 
   // Keep the delegate for reuse - it holds configuration and is designed to be persistent
 }
 
+#pragma mark - Runtime Parking
+
+/**
+ * Hands the running runtime to SandboxRuntimeParking, so that the next view mounting with the same origin, bundles and
+ * component name takes it over. This view starts over with a new delegate.
+ * @return NO if the runtime cannot be parked and stays with this view
+ */
+- (BOOL)parkRuntime
+{
+  SandboxReactNativeDelegate *delegate = self.reactNativeDelegate;
+  auto props = std::static_pointer_cast<const SandboxReactNativeViewProps>(_props);
+  if (!delegate || !self.reactNativeFactory || !self.reactNativeRootView || props->origin.empty() ||
+      delegate.hibernation->state() != rnsandbox::HibernationState::Active) {
+    return NO;
+  }
+
+  auto &parking = rnsandbox::SandboxRuntimeParking::getInstance();
+  NSMutableDictionary<NSNumber *, SandboxParkedRuntime *> *runtimes = parkedRuntimes();
+  auto parkId = parking.park(parkingKey(*props), delegate.sampledHeapBytes);
+  if (parkId == 0) {
+    return NO;
+  }
+
+  SandboxParkedRuntime *parked = [SandboxParkedRuntime new];
+  parked.delegate = delegate;
+  parked.factory = self.reactNativeFactory;
+  parked.rootView = self.reactNativeRootView;
+  parked.props = props;
+  runtimes[@(parkId)] = parked;
+
+  [self.reactNativeRootView removeFromSuperview];
+  // Events of the unmounted view go nowhere; eviction releases the parked runtime instead of hibernating it
+  delegate.eventEmitter = nullptr;
+  delegate.onWakeRequest = nil;
+  delegate.onMemoryEviction = ^{
+    rnsandbox::SandboxRuntimeParking::getInstance().release(parkId);
+  };
+
+  self.reactNativeRootView = nil;
+  self.reactNativeFactory = nil;
+  [self attachNewDelegate];
+
+  auto gracePeriod = std::chrono::duration_cast<std::chrono::nanoseconds>(parking.budget().gracePeriod);
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, gracePeriod.count()), dispatch_get_main_queue(), ^{
+    rnsandbox::SandboxRuntimeParking::getInstance().expire();
+  });
+  return YES;
+}
+
+/**
+ * Takes over a parked runtime matching props if this view has none running.
+ * @return The parked runtime's props, nullptr if none was adopted
+ */
+- (std::shared_ptr<const SandboxReactNativeViewProps>)adoptParkedRuntimeForProps:
+    (const SandboxReactNativeViewProps &)props
+{
+  if (self.reactNativeFactory || props.origin.empty()) {
+    return nullptr;
+  }
+  auto parkId = rnsandbox::SandboxRuntimeParking::getInstance().take(parkingKey(props));
+  if (parkId == 0) {
+    return nullptr;
+  }
+  NSMutableDictionary<NSNumber *, SandboxParkedRuntime *> *runtimes = parkedRuntimes();
+  SandboxParkedRuntime *parked = runtimes[@(parkId)];
+  [runtimes removeObjectForKey:@(parkId)];
+  if (!parked) {
+    return nullptr;
+  }
+
+  [self attachDelegate:parked.delegate];
+  self.reactNativeFactory = parked.factory;
+  [self.reactNativeRootView removeFromSuperview];
+  self.reactNativeRootView = parked.rootView;
+  [self addSubview:parked.rootView];
+  parked.rootView.frame = self.bounds;
+  [self updateEventEmitterIfNeeded];
+  return parked.props;
+}
+
+#pragma mark - Lazy Loading
+
+- (void)startViewportObservation
+{
+  [self stopViewportObservation];
+  NSMutableArray<UIScrollView *> *scrollViews = [NSMutableArray new];
+  for (UIView *view = self.superview; view; view = view.superview) {
+    if ([view isKindOfClass:[UIScrollView class]]) {
+      [view addObserver:self forKeyPath:@"contentOffset" options:0 context:kViewportObservationContext];
+      [scrollViews addObject:(UIScrollView *)view];
+    }
+  }
+  self.observedScrollViews = scrollViews;
+  [self updateViewportProximity];
+}
+
+- (void)stopViewportObservation
+{
+  for (UIScrollView *scrollView in self.observedScrollViews) {
+    [scrollView removeObserver:self forKeyPath:@"contentOffset" context:kViewportObservationContext];
+  }
+  self.observedScrollViews = nil;
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath
+                      ofObject:(id)object
+                        change:(NSDictionary<NSKeyValueChangeKey, id> *)change
+                       context:(void *)context
+{
+  if (context == kViewportObservationContext) {
+    [self updateViewportProximity];
+  } else {
+    [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+  }
+}
+
+/**
+ * Starts or releases a lazy view's runtime by its distance to the viewport: the window, clipped by every scroll view
+ * the view is in.
+ */
+- (void)updateViewportProximity
+{
+  const auto &props = *std::static_pointer_cast<const SandboxReactNativeViewProps>(_props);
+  UIWindow *window = self.window;
+  if (!props.lazy || !window) {
+    return;
+  }
+
+  CGRect viewport = window.bounds;
+  for (UIScrollView *scrollView in self.observedScrollViews) {
+    viewport = CGRectIntersection(viewport, [scrollView convertRect:scrollView.bounds toView:nil]);
+  }
+  double distance = std::numeric_limits<double>::infinity();
+  if (!CGRectIsNull(viewport)) {
+    CGRect frame = [self convertRect:self.bounds toView:nil];
+    distance = rnsandbox::distanceToViewport(
+        {frame.origin.x, frame.origin.y, frame.size.width, frame.size.height},
+        {viewport.origin.x, viewport.origin.y, viewport.size.width, viewport.size.height});
+  }
+
+  rnsandbox::LazyLoadDistances distances;
+  distances.load = props.lazyLoadDistance;
+  distances.release = props.lazyReleaseDistance;
+  switch (rnsandbox::nextLazyLoadAction(self.lazyStarted, distance, distances)) {
+    case rnsandbox::LazyLoadAction::Start:
+      [self startLazyRuntime];
+      break;
+    case rnsandbox::LazyLoadAction::Release:
+      [self releaseLazyRuntime];
+      break;
+    case rnsandbox::LazyLoadAction::None:
+      break;
+  }
+}
+
+- (void)startLazyRuntime
+{
+  self.lazyStarted = YES;
+  [self emitLazyStateChange];
+
+  auto props = std::static_pointer_cast<const SandboxReactNativeViewProps>(_props);
+  if (auto parkedProps = [self adoptParkedRuntimeForProps:*props]) {
+    [self applyViewProps:*props oldViewProps:*parkedProps];
+    return;
+  }
+  // The timeline measures the start, not the time spent offscreen
+  self.reactNativeDelegate.startupTimeline->restart();
+  [self scheduleReactViewLoad];
+}
+
+/**
+ * Parks the runtime of a lazy view far offscreen, so that scrolling back soon reclaims it, or tears it down if it
+ * cannot be parked.
+ */
+- (void)releaseLazyRuntime
+{
+  self.lazyStarted = NO;
+  [self emitLazyStateChange];
+  if (!self.reactNativeRootView) {
+    return;
+  }
+
+  auto props = std::static_pointer_cast<const SandboxReactNativeViewProps>(_props);
+  if ([self parkRuntime]) {
+    // The new delegate gets this view's configuration; its load waits for the view to come back
+    [self applyViewProps:*props oldViewProps:*defaultViewProps()];
+    return;
+  }
+  [self.reactNativeRootView removeFromSuperview];
+  self.reactNativeRootView = nil;
+  // Releases the host and with it the runtime
+  self.reactNativeFactory = nil;
+}
+
+- (void)emitLazyStateChange
+{
+  if (auto eventEmitter = std::static_pointer_cast<const SandboxReactNativeViewEventEmitter>(_eventEmitter)) {
+    eventEmitter->onLazyStateChange({.started = static_cast<bool>(self.lazyStarted)});
+  }
+}
+
 Class<RCTComponentViewProtocol> SandboxReactNativeViewCls(void)
 {
   return SandboxReactNativeViewComponentView.class;
@@ -33,6 +33,31 @@ export interface MessageEvent {
   data: CodegenTypes.UnsafeMixed
 }
 
+/**
+ * Startup phase timestamps of one sandbox instance, in milliseconds since its
+ * view was created (or since it resumed from hibernation). Phases not reached
+ * by the first frame are -1.
+ */
+export interface StartupTimelineEvent {
+  viewCreated: CodegenTypes.Double
+  delegateCreated: CodegenTypes.Double
+  /** Creation of the React host and its factory began */
+  hostCreated: CodegenTypes.Double
+  bundleLoadStarted: CodegenTypes.Double
+  bundleLoaded: CodegenTypes.Double
+  /** postMessage, setOnMessage and the sandbox bindings were installed */
+  bindingsInstalled: CodegenTypes.Double
+  errorHandlerInstalled: CodegenTypes.Double
+  /** Sandbox JS called setOnMessage */
+  onMessageRegistered: CodegenTypes.Double
+  firstFrame: CodegenTypes.Double
+}
+
+/** Sent when a lazy sandbox starts its runtime or releases it again. */
+export interface LazyStateChangeEvent {
+  started: boolean
+}
+
 /**
  * Native props interface for the SandboxReactNativeView component.
  * Extends ViewProps and defines all properties that can be passed to the native view.
@@ -50,6 +75,30 @@ export interface NativeProps extends ViewProps {
   /** Name on file storage or URL to the JavaScript bundle to load */
   jsBundleSource: string
 
+  /**
+   * Name on file storage or URL to a bundle evaluated before jsBundleSource,
+   * shared by every sandbox that names it
+   */
+  jsBaseBundleSource?: string
+
+  /**
+   * Evaluate a changed jsBundleSource in the running runtime instead of
+   * rebuilding the host
+   */
+  hotSwapBundles?: CodegenTypes.WithDefault<boolean, false>
+
+  /** Defer starting the runtime until the view nears the viewport */
+  lazy?: CodegenTypes.WithDefault<boolean, false>
+
+  /** Distance from the viewport, in points, at which a lazy view starts */
+  lazyLoadDistance?: CodegenTypes.WithDefault<CodegenTypes.Int32, 250>
+
+  /**
+   * Distance from the viewport, in points, beyond which a started lazy view
+   * releases its runtime, 0 to keep it
+   */
+  lazyReleaseDistance?: CodegenTypes.WithDefault<CodegenTypes.Int32, 0>
+
   /** Initial properties to pass to the sandboxed app's root component */
   initialProperties?: CodegenTypes.UnsafeMixed
 
@@ -69,6 +118,40 @@ export interface NativeProps extends ViewProps {
   /** Array of sandbox origins that are allowed to send messages to this sandbox */
   allowedOrigins?: readonly string[]
 
+  /**
+   * Origins to run as realms in this sandbox's runtime: array of
+   * `{origin, jsBundleSource, allowedTurboModules?, allowedOrigins?,
+   * turboModuleSubstitutions?}`
+   */
+  realms?: CodegenTypes.UnsafeMixed
+
+  /** Shared state keys (exact or `prefix*`) this sandbox may read */
+  sharedStateReadKeys?: readonly string[]
+
+  /** Shared state keys (exact or `prefix*`) this sandbox may write */
+  sharedStateWriteKeys?: readonly string[]
+
+  /**
+   * What a message for a hibernated sandbox does: 'queue' (default),
+   * 'urgent' or 'any'
+   */
+  hibernationWakePolicy?: string
+
+  /** Soft JS heap limit in MiB, 0 for none */
+  heapLimitMB?: CodegenTypes.Int32
+
+  /**
+   * What the memory governor may do to reclaim the sandbox's heap:
+   * 'hibernate' (default) or 'never'
+   */
+  evictionPolicy?: string
+
+  /**
+   * Milliseconds one host-dispatched JS task may run before the watchdog
+   * interrupts it, 0 to disable
+   */
+  watchdogTimeoutMs?: CodegenTypes.WithDefault<CodegenTypes.Int32, 10000>
+
   /** Internal flag indicating if onMessage handler is provided */
   hasOnMessageHandler?: boolean
 
@@ -80,6 +163,12 @@ export interface NativeProps extends ViewProps {
 
   /** Handler for errors that occur in the sandbox */
   onError?: CodegenTypes.DirectEventHandler<ErrorEvent>
+
+  /** Handler for the startup phase timeline, sent once per cold start */
+  onStartupTimeline?: CodegenTypes.DirectEventHandler<StartupTimelineEvent>
+
+  /** Handler for a lazy sandbox starting or releasing its runtime */
+  onLazyStateChange?: CodegenTypes.DirectEventHandler<LazyStateChangeEvent>
 }
 
 export type NativeSandboxReactNativeViewComponentType =
@@ -91,15 +180,49 @@ interface NativeCommands {
    *
    * @param viewRef - Reference to the native view component
    * @param message - JSON-serialized message to send to the sandbox
+   * @param urgent - Deliver through the sandbox's urgent lane, ahead of bulk
    */
   postMessage: (
     viewRef: React.ElementRef<NativeSandboxReactNativeViewComponentType>,
-    message: string
+    message: string,
+    urgent: boolean
+  ) => void
+
+  /**
+   * Write a key of the process-wide shared state store as the host app.
+   *
+   * @param viewRef - Reference to the native view component
+   * @param key - Key to write
+   * @param value - JSON-serialized value, or an empty string to delete the key
+   */
+  setSharedState: (
+    viewRef: React.ElementRef<NativeSandboxReactNativeViewComponentType>,
+    key: string,
+    value: string
+  ) => void
+
+  /**
+   * Snapshot the sandbox through its `setOnHibernate` handler and release
+   * its runtime. Messages keep queueing until it is resumed.
+   *
+   * @param viewRef - Reference to the native view component
+   */
+  hibernate: (
+    viewRef: React.ElementRef<NativeSandboxReactNativeViewComponentType>
+  ) => void
+
+  /**
+   * Rebuild the runtime of a hibernated sandbox and hand it the snapshot.
+   *
+   * @param viewRef - Reference to the native view component
+   */
+  resume: (
+    viewRef: React.ElementRef<NativeSandboxReactNativeViewComponentType>
   ) => void
 }
 
 export const Commands: NativeCommands = codegenNativeCommands<NativeCommands>({
-  supportedCommands: ['postMessage'],
+  supportedCommands: ['postMessage', 'setSharedState', 'hibernate', 'resume'],
 })
 
 /**
@@ -5,6 +5,7 @@ import {
   useImperativeHandle,
   useMemo,
   useRef,
+  useState,
 } from 'react'
 import type {NativeSyntheticEvent} from 'react-native'
 import {StyleProp, StyleSheet, View, ViewProps, ViewStyle} from 'react-native'
@@ -13,8 +14,12 @@ import type {NativeSandboxReactNativeViewComponentType} from '../specs/NativeSan
 import NativeSandboxReactNativeView, {
   Commands,
   ErrorEvent,
+  LazyStateChangeEvent,
+  StartupTimelineEvent,
 } from '../specs/NativeSandboxReactNativeView'
 
+export type {StartupTimelineEvent}
+
 const SANDBOX_TURBOMODULES_WHITELIST = [
   'NativeDOMCxx',
   'NativeMicrotasksCxx',
@@ -56,6 +61,75 @@ type GenericProps = {
   [key: string]: any
 }
 
+/**
+ * Delivery lane for a message in the receiving sandbox. Urgent messages are
+ * delivered ahead of queued bulk messages; `'bulk'` is the default.
+ */
+export type MessagePriority = 'urgent' | 'bulk'
+
+/**
+ * What a message for a hibernated sandbox does: `queue` keeps it until the
+ * app calls `resume()`, `urgent` resumes the sandbox for urgent messages
+ * and `any` for every message.
+ */
+export type HibernationWakePolicy = 'queue' | 'urgent' | 'any'
+
+/**
+ * What the memory governor may do when the sandbox stays above its heap limit
+ * or the OS runs low on memory: `hibernate` releases its runtime like
+ * `hibernate()`, `never` only lets it collect garbage.
+ */
+export type EvictionPolicy = 'hibernate' | 'never'
+
+/**
+ * Options accepted by `postMessage`.
+ */
+export interface PostMessageOptions {
+  priority?: MessagePriority
+}
+
+/**
+ * Options accepted by a sandbox's global
+ * `postMessage(message, targetOrigin, options)`.
+ */
+export interface SandboxPostMessageOptions extends PostMessageOptions {
+  /**
+   * If the target origin has not registered yet, hold the message for up to
+   * this many milliseconds and deliver it once it does. Defaults to 0, which
+   * fails immediately with a `SandboxRoutingError`.
+   */
+  ttlMs?: number
+}
+
+/**
+ * An origin run as a realm in the runtime of a sandbox view, see `realms`.
+ * Its policy fields shape the bindings the realm gets but are advisory: realm
+ * code can reach the host's global and act as the host.
+ */
+export interface SandboxRealmConfig {
+  /** Origin of the realm, registered like a sandbox view's */
+  origin: string
+
+  /**
+   * The realm's JavaScript source, resolved like `jsBundleSource`. Must be
+   * source, not Hermes bytecode, and self-contained: a plain script such as
+   * an IIFE build rather than a Metro bundle.
+   */
+  jsBundleSource: string
+
+  /**
+   * Modules the realm may load. They must also be available to the sandbox
+   * the realm runs in.
+   */
+  allowedTurboModules?: string[]
+
+  /** Origins allowed to exchange messages with the realm */
+  allowedOrigins?: string[]
+
+  /** Module substitutions of the realm, as `turboModuleSubstitutions` */
+  turboModuleSubstitutions?: Record<string, string>
+}
+
 let sandboxCounter = 0
 const generateSandboxId = (): string => {
   return `sandbox:${++sandboxCounter}`
@@ -84,6 +158,56 @@ export interface SandboxReactNativeViewProps extends ViewProps {
    */
   jsBundleSource?: string
 
+  /**
+   * Optional path or URL to a base bundle evaluated before `jsBundleSource`
+   * in the same runtime, e.g. React, the renderer and shared libraries.
+   * `jsBundleSource` then only needs the sandbox's own modules. Sandboxes
+   * naming the same base download it once, and a Hermes bytecode base is
+   * mapped read-only and shared between their runtimes.
+   */
+  jsBaseBundleSource?: string
+
+  /**
+   * When `jsBundleSource` changes, evaluate the new bundle in the running
+   * runtime and restart the surface instead of rebuilding the whole host.
+   * The new bundle must not depend on module-level state of the old one, and
+   * callable modules registered by the first bundle (e.g. event emitters)
+   * stay in place. Bundles served by the Metro packager, and any failed
+   * swap, fall back to a full reload.
+   * @default false
+   */
+  hotSwapBundles?: boolean
+
+  /**
+   * Defer starting the sandbox's runtime until the view comes within
+   * `lazyLoadDistance` of the viewport, e.g. for sandboxes in a long scroll
+   * view. A runtime parked by another view with the same origin and bundle
+   * is claimed instead of starting a new one.
+   * @default false
+   */
+  lazy?: boolean
+
+  /**
+   * How close to the viewport, in points, a lazy view has to come before its
+   * runtime starts. `0` starts it once the view is on screen.
+   * @default 250
+   */
+  lazyLoadDistance?: number
+
+  /**
+   * How far from the viewport, in points, a started lazy view has to move
+   * before its runtime is released again; it starts again once it comes back
+   * within `lazyLoadDistance`. Never less than `lazyLoadDistance`. `0` keeps
+   * the runtime once started.
+   * @default 0
+   */
+  lazyReleaseDistance?: number
+
+  /**
+   * Rendered in place of a lazy sandbox while its runtime is not started.
+   */
+  lazyPlaceholder?: React.ReactNode
+
   /**
    * Initial properties to pass to the sandboxed React Native app.
    * These will be available as props in the root component of the sandbox.
@@ -115,9 +239,66 @@ export interface SandboxReactNativeViewProps extends ViewProps {
    * Array of sandbox origins that are allowed to send messages to this sandbox.
    * If not provided or empty, no other sandboxes will be allowed to send messages.
    * Re-registering with new allowedOrigins will override previous settings.
+   * An entry ending in `*` is a prefix pattern (e.g. `'plugin.*'`).
    */
   allowedOrigins?: string[]
 
+  /**
+   * Lightweight origins to run in this sandbox's runtime instead of runtimes
+   * of their own. Each realm runs in a global scope object of its own, with
+   * its own `postMessage`/`setOnMessage` and module policy, and other
+   * sandboxes address it by its origin. Realms share the sandbox's heap and
+   * JS thread, so they suit many small trusted widgets rather than untrusted
+   * code. A realm's `postMessage` without a target origin reaches this
+   * sandbox's `setOnMessage` handler.
+   */
+  realms?: SandboxRealmConfig[]
+
+  /**
+   * Keys of the process-wide shared state store this sandbox may read
+   * through `globalThis.sharedState`. Entries are exact keys or prefix
+   * patterns ending in `*`. If not provided, the sandbox reads nothing.
+   */
+  sharedStateReadKeys?: string[]
+
+  /**
+   * Keys of the shared state store this sandbox may write, in the same
+   * format as `sharedStateReadKeys`. If not provided, the sandbox writes
+   * nothing.
+   */
+  sharedStateWriteKeys?: string[]
+
+  /**
+   * Whether messages that arrive while the sandbox is hibernated resume it.
+   * Defaults to `queue`, which leaves resuming to the app.
+   */
+  hibernationWakePolicy?: HibernationWakePolicy
+
+  /**
+   * Soft limit of the sandbox's JS heap in MiB. A sandbox still above it
+   * after a forced garbage collection is evicted according to
+   * `evictionPolicy`. On iOS the heap is also hard-capped at twice this
+   * size. Defaults to no limit.
+   */
+  heapLimitMB?: number
+
+  /**
+   * Whether the sandbox may be evicted to free memory. Defaults to
+   * `hibernate`. Evictions are reported through `onError` as a non-fatal
+   * `SandboxEvictedError`.
+   */
+  evictionPolicy?: EvictionPolicy
+
+  /**
+   * How long, in milliseconds, one task the host runs on the sandbox's JS
+   * thread (message delivery, RPC and channel callbacks) may take. A task
+   * that runs longer, such as an infinite loop, is interrupted and reported
+   * through `onError` as a fatal `WatchdogTimeout`. `0` disables the
+   * watchdog. Defaults to 10000. iOS only: Android runtimes cannot be
+   * interrupted, so their watchdog stays unarmed.
+   */
+  watchdogTimeoutMs?: number
+
   /**
    * Callback function called when the sandbox sends a message to the parent.
    * Use this for bidirectional communication between parent and sandbox.
@@ -132,6 +313,16 @@ export interface SandboxReactNativeViewProps extends ViewProps {
    * @param error - Error details including name, message, stack trace, and fatality
    */
   onError?: (error: ErrorEvent) => void
+
+  /**
+   * Callback function called once the sandbox's first frame is mounted, with
+   * the time each startup phase completed. Sent again after every resume from
+   * hibernation.
+   *
+   * @param timeline - Milliseconds per phase since the view was created or
+   *   resumed, -1 for phases not reached
+   */
+  onStartupTimeline?: (timeline: StartupTimelineEvent) => void
 }
 
 /**
@@ -155,8 +346,32 @@ export interface SandboxReactNativeViewRef {
    * The message will be serialized to JSON before transmission.
    *
    * @param message - Any serializable data to send to the sandbox
+   * @param options - Optional delivery options such as `priority`
+   */
+  postMessage: (message: unknown, options?: PostMessageOptions) => void
+
+  /**
+   * Write a key of the process-wide shared state store, which every sandbox
+   * with read access sees synchronously. The host is not subject to the
+   * sandboxes' key lists.
+   *
+   * @param key - Key to write
+   * @param value - Any JSON-serializable value; `undefined` deletes the key
+   */
+  setSharedState: (key: string, value: unknown) => void
+
+  /**
+   * Release the sandbox's runtime while it is offscreen. The sandbox's
+   * `setOnHibernate` handler may return a JSON-serializable state blob,
+   * which the next runtime reads with `getRestoredState()`. Messages sent
+   * meanwhile are queued and delivered after `resume()`.
+   */
+  hibernate: () => void
+
+  /**
+   * Rebuild the runtime of a hibernated sandbox from `jsBundleSource`.
    */
-  postMessage: (message: unknown) => void
+  resume: () => void
 }
 
 /**
@@ -230,6 +445,9 @@ const SandboxReactNativeView = forwardRef<
       moduleName,
       onMessage,
       onError,
+      onStartupTimeline,
+      lazy,
+      lazyPlaceholder,
       ...rest
     },
     ref
@@ -242,9 +460,38 @@ const SandboxReactNativeView = forwardRef<
     // Use provided origin or assign a unique ID
     const sandboxOrigin = useMemo(() => origin || generateSandboxId(), [origin])
 
-    const postMessage = useCallback((message: any) => {
+    const postMessage = useCallback(
+      (message: any, options?: PostMessageOptions) => {
+        if (nativeRef.current) {
+          Commands.postMessage(
+            nativeRef.current,
+            JSON.stringify(message),
+            options?.priority === 'urgent'
+          )
+        }
+      },
+      []
+    )
+
+    const setSharedState = useCallback((key: string, value: unknown) => {
+      if (nativeRef.current) {
+        Commands.setSharedState(
+          nativeRef.current,
+          key,
+          value === undefined ? '' : JSON.stringify(value)
+        )
+      }
+    }, [])
+
+    const hibernate = useCallback(() => {
+      if (nativeRef.current) {
+        Commands.hibernate(nativeRef.current)
+      }
+    }, [])
+
+    const resume = useCallback(() => {
       if (nativeRef.current) {
-        Commands.postMessage(nativeRef.current, JSON.stringify(message))
+        Commands.resume(nativeRef.current)
       }
     }, [])
 
@@ -256,6 +503,22 @@ const SandboxReactNativeView = forwardRef<
       [onError]
     )
 
+    const _onStartupTimeline = useCallback(
+      (e: NativeSyntheticEvent<StartupTimelineEvent>) => {
+        onStartupTimeline?.(e.nativeEvent)
+      },
+      [onStartupTimeline]
+    )
+
+    const [lazyStarted, setLazyStarted] = useState(false)
+
+    const _onLazyStateChange = useCallback(
+      (e: NativeSyntheticEvent<LazyStateChangeEvent>) => {
+        setLazyStarted(e.nativeEvent.started)
+      },
+      []
+    )
+
     const _onMessage = useCallback(
       (e: NativeSyntheticEvent<MessageEvent>) => {
         // @ts-ignore
@@ -268,14 +531,24 @@ const SandboxReactNativeView = forwardRef<
       ref,
       () => ({
         postMessage,
+        setSharedState,
+        hibernate,
+        resume,
       }),
-      [postMessage]
+      [postMessage, setSharedState, hibernate, resume]
     )
 
     const _renderOverlay = useCallback(() => {
       // TODO implement some loading/error/handling screen
+      if (lazy && !lazyStarted && lazyPlaceholder) {
+        return (
+          <View style={StyleSheet.absoluteFill} pointerEvents="none">
+            {lazyPlaceholder}
+          </View>
+        )
+      }
       return null
-    }, [])
+    }, [lazy, lazyStarted, lazyPlaceholder])
 
     const _style: StyleProp<ViewStyle> = useMemo(
       () => ({
@@ -336,6 +609,11 @@ const SandboxReactNativeView = forwardRef<
           hasOnErrorHandler={!!onError}
           onError={onError ? _onError : undefined}
           onMessage={onMessage ? _onMessage : undefined}
+          onStartupTimeline={
+            onStartupTimeline ? _onStartupTimeline : undefined
+          }
+          lazy={lazy}
+          onLazyStateChange={lazy ? _onLazyStateChange : undefined}
           allowedTurboModules={_allowedTurboModules}
           style={_style}
           {...rest}
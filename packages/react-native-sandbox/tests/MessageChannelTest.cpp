@@ -0,0 +1,246 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <MessageChannel.h>
+#include <SandboxRegistry.h>
+
+#include "MockSandboxDelegate.h"
+
+using namespace rnsandbox;
+using ::testing::StrictMock;
+
+class MessageChannelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxRegistry::getInstance().reset();
+    MessageChannelRegistry::getInstance().reset();
+
+    delegateA_ = std::make_shared<StrictMock<MockSandboxDelegate>>();
+    delegateB_ = std::make_shared<StrictMock<MockSandboxDelegate>>();
+    SandboxRegistry::getInstance().registerSandbox("A", delegateA_, {"B"});
+    SandboxRegistry::getInstance().registerSandbox("B", delegateB_, {"A"});
+  }
+
+  void TearDown() override {
+    MessageChannelRegistry::getInstance().reset();
+    SandboxRegistry::getInstance().reset();
+  }
+
+  std::shared_ptr<MessagePort> open(
+      const std::string& origin,
+      const std::string& target,
+      size_t capacity = MessageChannelRegistry::kDefaultCapacity) {
+    std::shared_ptr<MessagePort> port;
+    EXPECT_EQ(
+        MessageChannelRegistry::getInstance().open(
+            origin, target, port, capacity),
+        MessageChannelStatus::Opened);
+    return port;
+  }
+
+  static std::vector<std::string> drainAll(MessagePort& port) {
+    std::vector<std::string> messages;
+    port.drain([&](std::string&& m) { messages.push_back(std::move(m)); });
+    return messages;
+  }
+
+  std::shared_ptr<MockSandboxDelegate> delegateA_;
+  std::shared_ptr<MockSandboxDelegate> delegateB_;
+};
+
+TEST_F(MessageChannelTest, OpenChecksAccessOnce) {
+  auto& channels = MessageChannelRegistry::getInstance();
+  std::shared_ptr<MessagePort> port;
+
+  EXPECT_EQ(
+      channels.open("A", "C", port), MessageChannelStatus::AccessDenied);
+  EXPECT_EQ(channels.open("A", "A", port), MessageChannelStatus::SelfTarget);
+  EXPECT_EQ(channels.open("", "B", port), MessageChannelStatus::InvalidOrigin);
+  EXPECT_EQ(port, nullptr);
+
+  EXPECT_EQ(channels.open("A", "B", port), MessageChannelStatus::Opened);
+  ASSERT_NE(port, nullptr);
+  EXPECT_EQ(port->origin(), "A");
+  EXPECT_EQ(port->targetOrigin(), "B");
+
+  // Revoking access afterwards does not affect the established channel
+  SandboxRegistry::getInstance().registerSandbox("A", delegateA_, {});
+  EXPECT_TRUE(port->postMessage("{}"));
+}
+
+TEST_F(MessageChannelTest, PeersJoinTheSameChannel) {
+  auto portA = open("A", "B");
+  auto portB = open("B", "A");
+
+  EXPECT_EQ(MessageChannelRegistry::getInstance().channelCount(), 1u);
+
+  EXPECT_TRUE(portA->postMessage("{\"n\":1}"));
+  EXPECT_TRUE(portA->postMessage("{\"n\":2}"));
+  EXPECT_TRUE(portB->postMessage("{\"n\":3}"));
+
+  EXPECT_THAT(
+      drainAll(*portB), ::testing::ElementsAre("{\"n\":1}", "{\"n\":2}"));
+  EXPECT_THAT(drainAll(*portA), ::testing::ElementsAre("{\"n\":3}"));
+}
+
+TEST_F(MessageChannelTest, MessagesBufferedBeforePeerJoins) {
+  auto portA = open("A", "B");
+  EXPECT_TRUE(portA->postMessage("early"));
+
+  auto portB = open("B", "A");
+  EXPECT_EQ(portB->pendingCount(), 1u);
+  EXPECT_THAT(drainAll(*portB), ::testing::ElementsAre("early"));
+}
+
+TEST_F(MessageChannelTest, SecondOpenFromSameSideIsRejected) {
+  auto portA = open("A", "B");
+
+  std::shared_ptr<MessagePort> another;
+  EXPECT_EQ(
+      MessageChannelRegistry::getInstance().open("A", "B", another),
+      MessageChannelStatus::AlreadyOpen);
+  EXPECT_EQ(another, nullptr);
+}
+
+TEST_F(MessageChannelTest, ReadableCallbackFiresOncePerBurst) {
+  auto portA = open("A", "B");
+  auto portB = open("B", "A");
+
+  int wakeups = 0;
+  portB->setOnReadable([&wakeups]() { ++wakeups; });
+
+  portA->postMessage("1");
+  portA->postMessage("2");
+  portA->postMessage("3");
+  EXPECT_EQ(wakeups, 1);
+
+  EXPECT_EQ(drainAll(*portB).size(), 3u);
+
+  portA->postMessage("4");
+  EXPECT_EQ(wakeups, 2);
+}
+
+TEST_F(MessageChannelTest, PostFailsWhenPeerBufferIsFull) {
+  auto portA = open("A", "B", 2);
+  auto portB = open("B", "A");
+
+  EXPECT_TRUE(portA->postMessage("1"));
+  EXPECT_TRUE(portA->postMessage("2"));
+  EXPECT_FALSE(portA->postMessage("3"));
+
+  drainAll(*portB);
+  EXPECT_TRUE(portA->postMessage("3"));
+}
+
+TEST_F(MessageChannelTest, CloseNotifiesBothSidesAndStopsTraffic) {
+  auto portA = open("A", "B");
+  auto portB = open("B", "A");
+
+  int closedA = 0;
+  int closedB = 0;
+  portA->setOnClose([&closedA]() { ++closedA; });
+  portB->setOnClose([&closedB]() { ++closedB; });
+
+  portA->postMessage("last");
+  portA->close();
+
+  EXPECT_TRUE(portA->isClosed());
+  EXPECT_TRUE(portB->isClosed());
+  EXPECT_EQ(closedA, 1);
+  EXPECT_EQ(closedB, 1);
+  EXPECT_FALSE(portA->postMessage("after"));
+  EXPECT_FALSE(portB->postMessage("after"));
+  EXPECT_EQ(MessageChannelRegistry::getInstance().channelCount(), 0u);
+
+  // Messages sent before close can still be drained
+  EXPECT_THAT(drainAll(*portB), ::testing::ElementsAre("last"));
+
+  portB->close();
+  EXPECT_EQ(closedB, 1);
+}
+
+TEST_F(MessageChannelTest, DestroyingPortClosesChannel) {
+  auto portA = open("A", "B");
+  auto portB = open("B", "A");
+
+  portA.reset();
+
+  EXPECT_TRUE(portB->isClosed());
+  EXPECT_EQ(MessageChannelRegistry::getInstance().channelCount(), 0u);
+
+  // A fresh channel can be opened afterwards
+  auto reopened = open("A", "B");
+  EXPECT_FALSE(reopened->isClosed());
+}
+
+TEST_F(MessageChannelTest, CloseAllTearsDownChannelsOfOrigin) {
+  auto delegateC = std::make_shared<StrictMock<MockSandboxDelegate>>();
+  SandboxRegistry::getInstance().registerSandbox("A", delegateA_, {"B", "C"});
+  SandboxRegistry::getInstance().registerSandbox("C", delegateC, {"B"});
+
+  auto portAB = open("A", "B");
+  auto portAC = open("A", "C");
+  auto portCB = open("C", "B");
+
+  MessageChannelRegistry::getInstance().closeAll("A");
+
+  EXPECT_TRUE(portAB->isClosed());
+  EXPECT_TRUE(portAC->isClosed());
+  EXPECT_FALSE(portCB->isClosed());
+  EXPECT_EQ(MessageChannelRegistry::getInstance().channelCount(), 1u);
+}
+
+TEST_F(MessageChannelTest, PortSetClosesOnlyItsOwnPorts) {
+  auto delegateC = std::make_shared<StrictMock<MockSandboxDelegate>>();
+  SandboxRegistry::getInstance().registerSandbox("A", delegateA_, {"B", "C"});
+  SandboxRegistry::getInstance().registerSandbox("C", delegateC, {"A"});
+
+  // Two runtimes of origin A, each with its own set
+  MessagePortSet first;
+  MessagePortSet second;
+  auto portAB = open("A", "B");
+  auto portAC = open("A", "C");
+  first.add(portAB);
+  second.add(portAC);
+
+  first.closeAll();
+
+  EXPECT_TRUE(portAB->isClosed());
+  EXPECT_FALSE(portAC->isClosed());
+
+  // The set keeps tracking ports added after it was closed
+  auto reopened = open("A", "B");
+  first.add(reopened);
+  first.closeAll();
+  EXPECT_TRUE(reopened->isClosed());
+  EXPECT_FALSE(portAC->isClosed());
+}
+
+TEST_F(MessageChannelTest, ConcurrentDeliveryKeepsOrder) {
+  auto portA = open("A", "B", 64);
+  auto portB = open("B", "A");
+  const int count = 20000;
+
+  std::thread producer([&portA]() {
+    for (int i = 0; i < count; ++i) {
+      while (!portA->postMessage(std::to_string(i))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  while (expected < count) {
+    portB->drain([&expected](std::string&& m) {
+      EXPECT_EQ(m, std::to_string(expected));
+      ++expected;
+    });
+    std::this_thread::yield();
+  }
+
+  producer.join();
+}
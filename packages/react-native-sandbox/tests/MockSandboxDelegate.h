@@ -10,11 +10,17 @@ namespace rnsandbox {
 
 class MockSandboxDelegate : public ISandboxDelegate {
  public:
-  MOCK_METHOD(void, postMessage, (const std::string& message), (override));
+  MOCK_METHOD(
+      void,
+      postMessage,
+      (const std::string& message, MessagePriority priority),
+      (override));
   MOCK_METHOD(
       bool,
       routeMessage,
-      (const std::string& message, const std::string& targetId),
+      (const std::string& message,
+       const std::string& targetId,
+       MessagePriority priority),
       (override));
   MOCK_METHOD(void, setOrigin, (const std::string& origin), (override));
   MOCK_METHOD(
@@ -27,6 +33,11 @@ class MockSandboxDelegate : public ISandboxDelegate {
       setAllowedTurboModules,
       (const std::set<std::string>& modules),
       (override));
+  MOCK_METHOD(
+      bool,
+      scheduleOnJSThread,
+      (std::function<void(facebook::jsi::Runtime&)> work),
+      (override));
 };
 
 } // namespace rnsandbox
\ No newline at end of file
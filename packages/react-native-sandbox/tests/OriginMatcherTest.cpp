@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include <OriginMatcher.h>
+#include <SandboxRegistry.h>
+
+#include "MockSandboxDelegate.h"
+
+using namespace rnsandbox;
+
+TEST(OriginMatcherTest, EmptyListMatchesNothing) {
+  OriginMatcher matcher;
+  EXPECT_FALSE(matcher.matches("anything"));
+  EXPECT_FALSE(matcher.matches(""));
+}
+
+TEST(OriginMatcherTest, ExactEntriesMatchWholeOriginsOnly) {
+  OriginMatcher matcher({"plugin", "plugin.a"});
+
+  EXPECT_TRUE(matcher.matches("plugin"));
+  EXPECT_TRUE(matcher.matches("plugin.a"));
+  EXPECT_FALSE(matcher.matches("plugin."));
+  EXPECT_FALSE(matcher.matches("plugin.ab"));
+  EXPECT_FALSE(matcher.matches("plug"));
+}
+
+TEST(OriginMatcherTest, TrailingStarMatchesAnySuffix) {
+  OriginMatcher matcher({"plugin.*", "team-a/*"});
+
+  EXPECT_TRUE(matcher.matches("plugin."));
+  EXPECT_TRUE(matcher.matches("plugin.maps"));
+  EXPECT_TRUE(matcher.matches("plugin.maps.v2"));
+  EXPECT_TRUE(matcher.matches("team-a/chat"));
+  EXPECT_FALSE(matcher.matches("plugin"));
+  EXPECT_FALSE(matcher.matches("pluginx"));
+  EXPECT_FALSE(matcher.matches("team-b/chat"));
+}
+
+TEST(OriginMatcherTest, LoneStarMatchesEverything) {
+  OriginMatcher matcher({"*"});
+  EXPECT_TRUE(matcher.matches("a"));
+  EXPECT_TRUE(matcher.matches("team-a/chat"));
+}
+
+TEST(OriginMatcherTest, InnerStarIsLiteral) {
+  OriginMatcher matcher({"a*b"});
+  EXPECT_TRUE(matcher.matches("a*b"));
+  EXPECT_FALSE(matcher.matches("axb"));
+}
+
+TEST(OriginMatcherTest, ExactAndPatternEntriesShareThePrefix) {
+  OriginMatcher matcher({"team", "team/*", "teammate"});
+
+  EXPECT_TRUE(matcher.matches("team"));
+  EXPECT_TRUE(matcher.matches("team/x"));
+  EXPECT_TRUE(matcher.matches("teammate"));
+  EXPECT_FALSE(matcher.matches("teamm"));
+}
+
+TEST(OriginMatcherTest, IsPattern) {
+  EXPECT_TRUE(OriginMatcher::isPattern("plugin.*"));
+  EXPECT_TRUE(OriginMatcher::isPattern("*"));
+  EXPECT_FALSE(OriginMatcher::isPattern("plugin"));
+  EXPECT_FALSE(OriginMatcher::isPattern(""));
+}
+
+TEST(OriginMatcherTest, RegistryAppliesPatterns) {
+  auto& registry = SandboxRegistry::getInstance();
+  registry.reset();
+  auto delegate = std::make_shared<MockSandboxDelegate>();
+
+  registry.registerSandbox("host", delegate, {"plugin.*"});
+  EXPECT_TRUE(registry.isPermittedFrom("host", "plugin.maps"));
+  EXPECT_TRUE(registry.isPermittedFrom("host", "plugin.maps"));
+  EXPECT_FALSE(registry.isPermittedFrom("host", "other"));
+
+  // Re-registering replaces the compiled list and its cached decisions
+  registry.registerSandbox("host", delegate, {"other"});
+  EXPECT_FALSE(registry.isPermittedFrom("host", "plugin.maps"));
+  EXPECT_TRUE(registry.isPermittedFrom("host", "other"));
+
+  registry.reset();
+}
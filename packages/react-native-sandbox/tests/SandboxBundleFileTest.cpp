@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <SandboxBundleFile.h>
+
+using namespace rnsandbox;
+
+class BundleFileTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    for (const auto& path : paths_) {
+      std::remove(path.c_str());
+    }
+  }
+
+  std::string writeFile(const std::string& contents) {
+    std::string path = ::testing::TempDir() + "bundle-file-test-" +
+        std::to_string(paths_.size()) + ".bundle";
+    std::ofstream(path, std::ios::binary) << contents;
+    paths_.push_back(path);
+    return path;
+  }
+
+  std::vector<std::string> paths_;
+};
+
+TEST_F(BundleFileTest, MapsFileContents) {
+  std::string source = "var answer = 42;";
+  auto file = BundleFile::open(writeFile(source));
+
+  ASSERT_TRUE(file);
+  ASSERT_EQ(file->size(), source.size());
+  EXPECT_EQ(
+      std::string(reinterpret_cast<const char*>(file->data()), file->size()),
+      source);
+  EXPECT_FALSE(file->isHermesBytecode());
+}
+
+TEST_F(BundleFileTest, DetectsHermesBytecode) {
+  std::string bytecode("\xc6\x1f\xbc\x03\xc1\x03\x19\x1f", 8);
+  bytecode += std::string(32, '\0');
+  auto file = BundleFile::open(writeFile(bytecode));
+
+  ASSERT_TRUE(file);
+  EXPECT_TRUE(file->isHermesBytecode());
+
+  auto truncated = BundleFile::open(writeFile(bytecode.substr(0, 4)));
+  ASSERT_TRUE(truncated);
+  EXPECT_FALSE(truncated->isHermesBytecode());
+}
+
+TEST_F(BundleFileTest, RejectsMissingAndEmptyFiles) {
+  std::string error;
+  auto missing = ::testing::TempDir() + "missing.bundle";
+  EXPECT_FALSE(BundleFile::open(missing, &error));
+  EXPECT_NE(error.find("missing.bundle"), std::string::npos);
+
+  error.clear();
+  EXPECT_FALSE(BundleFile::open(writeFile(""), &error));
+  EXPECT_FALSE(error.empty());
+}
@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <SandboxBundlePatch.h>
+#include <SandboxSha256.h>
+
+using namespace rnsandbox;
+
+namespace {
+
+struct PatchRecord {
+  std::string diff;
+  std::string extra;
+  int64_t seek = 0;
+};
+
+void appendUint64(std::string& out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    out.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+void appendOffset(std::string& out, int64_t value) {
+  uint64_t magnitude = value < 0 ? uint64_t(-value) : uint64_t(value);
+  appendUint64(out, value < 0 ? magnitude | (uint64_t(1) << 63) : magnitude);
+}
+
+std::string digestOf(const std::string& data) {
+  auto digest = Sha256::hash(
+      reinterpret_cast<const uint8_t*>(data.data()), data.size());
+  return std::string(digest.begin(), digest.end());
+}
+
+std::string makePatch(
+    const std::string& base,
+    const std::string& output,
+    const std::vector<PatchRecord>& records) {
+  std::string patch = BundlePatcher::kMagic;
+  appendUint64(patch, base.size());
+  patch += digestOf(base);
+  appendUint64(patch, output.size());
+  patch += digestOf(output);
+  for (const auto& record : records) {
+    appendOffset(patch, static_cast<int64_t>(record.diff.size()));
+    appendOffset(patch, static_cast<int64_t>(record.extra.size()));
+    appendOffset(patch, record.seek);
+    patch += record.diff + record.extra;
+  }
+  return patch;
+}
+
+// Diff bytes that turn base[offset, offset + size) into target
+std::string diffBytes(
+    const std::string& base,
+    size_t offset,
+    const std::string& target) {
+  std::string diff;
+  for (size_t i = 0; i < target.size(); ++i) {
+    diff.push_back(static_cast<char>(
+        static_cast<uint8_t>(target[i]) -
+        static_cast<uint8_t>(base[offset + i])));
+  }
+  return diff;
+}
+
+const std::string kBase = "function greet() { return 'hello'; }\ngreet();\n";
+const std::string kUpdated =
+    "function greet() { return 'howdy'; }\n// v2\ngreet();\n";
+
+// Rewrites the first 37 bytes in place, inserts a comment, keeps the tail
+std::string makeUpdatePatch() {
+  return makePatch(
+      kBase,
+      kUpdated,
+      {{diffBytes(kBase, 0, kUpdated.substr(0, 37)), "// v2\n", 0},
+       {diffBytes(kBase, 37, kUpdated.substr(43)), "", 0}});
+}
+
+} // namespace
+
+class BundlePatchTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    for (const auto& path : paths_) {
+      std::remove(path.c_str());
+      std::remove((path + ".part").c_str());
+    }
+  }
+
+  std::string writeFile(const std::string& contents) {
+    std::string path = ::testing::TempDir() + "bundle-patch-test-" +
+        std::to_string(paths_.size());
+    std::ofstream(path, std::ios::binary) << contents;
+    paths_.push_back(path);
+    return path;
+  }
+
+  std::string newPath() {
+    return writeFile("") + ".out";
+  }
+
+  static std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+  }
+
+  static bool exists(const std::string& path) {
+    return std::ifstream(path).good();
+  }
+
+  std::vector<std::string> paths_;
+};
+
+TEST(Sha256Test, MatchesKnownDigests) {
+  EXPECT_EQ(
+      Sha256::toHex(Sha256::hash(nullptr, 0)),
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+  std::string message =
+      "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  Sha256 hasher;
+  for (char c : message) {
+    hasher.update(reinterpret_cast<const uint8_t*>(&c), 1);
+  }
+  EXPECT_EQ(
+      Sha256::toHex(hasher.finish()),
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST_F(BundlePatchTest, AppliesPatchStreamedInSmallChunks) {
+  auto base = BundleFile::open(writeFile(kBase));
+  ASSERT_TRUE(base);
+  std::string output = newPath();
+  std::string patch = makeUpdatePatch();
+
+  BundlePatcher patcher(base, output);
+  for (size_t offset = 0; offset < patch.size(); offset += 5) {
+    size_t size = std::min<size_t>(5, patch.size() - offset);
+    ASSERT_TRUE(patcher.write(
+        reinterpret_cast<const uint8_t*>(patch.data() + offset), size))
+        << patcher.error();
+  }
+  ASSERT_TRUE(patcher.commit()) << patcher.error();
+
+  EXPECT_EQ(readFile(output), kUpdated);
+  EXPECT_FALSE(exists(output + ".part"));
+  paths_.push_back(output);
+}
+
+TEST_F(BundlePatchTest, ReplacesCachedBundleWhileItIsMapped) {
+  std::string cached = writeFile(kBase);
+  std::string patchPath = writeFile(makeUpdatePatch());
+  auto mapped = BundleFile::open(cached);
+  ASSERT_TRUE(mapped);
+
+  std::string error;
+  ASSERT_TRUE(applyBundlePatch(cached, patchPath, cached, &error)) << error;
+
+  EXPECT_EQ(readFile(cached), kUpdated);
+  EXPECT_EQ(hashBundleFile(cached), Sha256::toHex(Sha256::hash(
+      reinterpret_cast<const uint8_t*>(kUpdated.data()), kUpdated.size())));
+  // A runtime still running the old bundle keeps its pages
+  EXPECT_EQ(
+      std::string(
+          reinterpret_cast<const char*>(mapped->data()), mapped->size()),
+      kBase);
+}
+
+TEST_F(BundlePatchTest, RejectsPatchForAnotherBundle) {
+  std::string cached = writeFile("var unrelated = true;\n");
+  std::string patchPath = writeFile(makeUpdatePatch());
+
+  std::string error;
+  EXPECT_FALSE(applyBundlePatch(cached, patchPath, cached, &error));
+  EXPECT_NE(error.find("different bundle"), std::string::npos);
+  EXPECT_EQ(readFile(cached), "var unrelated = true;\n");
+}
+
+TEST_F(BundlePatchTest, KeepsCachedBundleWhenPatchDoesNotVerify) {
+  std::string cached = writeFile(kBase);
+  std::string error;
+
+  // Produces the right size but the wrong bytes
+  std::string corrupt = makeUpdatePatch();
+  corrupt[corrupt.size() - 1] ^= 0x01;
+  EXPECT_FALSE(
+      applyBundlePatch(cached, writeFile(corrupt), cached, &error));
+  EXPECT_NE(error.find("checksum"), std::string::npos);
+
+  std::string truncated = makeUpdatePatch();
+  truncated.resize(truncated.size() - 3);
+  EXPECT_FALSE(
+      applyBundlePatch(cached, writeFile(truncated), cached, &error));
+  EXPECT_NE(error.find("truncated"), std::string::npos);
+
+  std::string trailing = makeUpdatePatch() + "x";
+  EXPECT_FALSE(
+      applyBundlePatch(cached, writeFile(trailing), cached, &error));
+  EXPECT_NE(error.find("Trailing"), std::string::npos);
+
+  EXPECT_EQ(readFile(cached), kBase);
+  EXPECT_FALSE(exists(cached + ".part"));
+}
+
+TEST_F(BundlePatchTest, RejectsRecordsPastTheOutputSize) {
+  auto base = BundleFile::open(writeFile(kBase));
+  ASSERT_TRUE(base);
+  std::string patch = makePatch(kBase, "short", {{"", "much too long", 0}});
+
+  BundlePatcher patcher(base, newPath());
+  EXPECT_FALSE(patcher.write(
+      reinterpret_cast<const uint8_t*>(patch.data()), patch.size()));
+  EXPECT_NE(patcher.error().find("past the end"), std::string::npos);
+  EXPECT_FALSE(patcher.commit());
+}
+
+TEST_F(BundlePatchTest, RejectsRecordsSeekingOutOfRange) {
+  auto base = BundleFile::open(writeFile(kBase));
+  ASSERT_TRUE(base);
+  const int64_t limit = static_cast<int64_t>(kBase.size() + 5);
+  for (int64_t seek :
+       {std::numeric_limits<int64_t>::max(),
+        -std::numeric_limits<int64_t>::max(),
+        limit + 1,
+        -limit - 1}) {
+    std::string patch = makePatch(kBase, "short", {{"", "sh", seek}});
+
+    BundlePatcher patcher(base, newPath());
+    EXPECT_FALSE(patcher.write(
+        reinterpret_cast<const uint8_t*>(patch.data()), patch.size()))
+        << seek;
+    EXPECT_NE(patcher.error().find("out of range"), std::string::npos);
+  }
+
+  // A seek to the edge of the range is fine
+  std::string patch = makePatch(
+      kBase, "short", {{"", "sh", limit}, {"", "ort", -2 * limit}});
+  BundlePatcher patcher(base, newPath());
+  EXPECT_TRUE(patcher.write(
+      reinterpret_cast<const uint8_t*>(patch.data()), patch.size()));
+  EXPECT_TRUE(patcher.commit());
+}
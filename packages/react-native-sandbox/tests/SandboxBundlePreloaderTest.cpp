@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <SandboxBundlePreloader.h>
+
+using namespace rnsandbox;
+using namespace std::chrono_literals;
+
+class SandboxBundlePreloaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxBundlePreloader::getInstance().reset();
+  }
+
+  void TearDown() override {
+    release();
+    SandboxBundlePreloader::getInstance().reset();
+  }
+
+  // Fetcher that blocks until release() and tracks how many run at once
+  void installGatedFetcher() {
+    SandboxBundlePreloader::getInstance().setFetcher(
+        [this](const std::string& source) {
+          {
+            std::unique_lock<std::mutex> lock(gateMutex_);
+            peak_ = std::max(peak_.load(), ++running_);
+            gate_.wait(lock, [this] { return open_; });
+          }
+          --running_;
+          PreloadResult result;
+          result.path = "/cache/" + source;
+          return result;
+        });
+  }
+
+  void release() {
+    {
+      std::lock_guard<std::mutex> lock(gateMutex_);
+      open_ = true;
+    }
+    gate_.notify_all();
+  }
+
+  std::atomic<int> running_{0};
+  std::atomic<int> peak_{0};
+  std::mutex gateMutex_;
+  std::condition_variable gate_;
+  bool open_ = false;
+};
+
+TEST_F(SandboxBundlePreloaderTest, LoadsSourcesInParallelUpToTheLimit) {
+  auto& preloader = SandboxBundlePreloader::getInstance();
+  preloader.setConcurrency(2);
+  installGatedFetcher();
+
+  EXPECT_EQ(preloader.preload({"a.js", "b.js", "c.js", "d.js"}), 4u);
+  auto deadline = std::chrono::steady_clock::now() + 2s;
+  while (running_ < 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  EXPECT_EQ(running_.load(), 2);
+  EXPECT_FALSE(preloader.find("a.js"));
+
+  release();
+  for (const char* source : {"a.js", "b.js", "c.js", "d.js"}) {
+    auto result = preloader.wait(source, 2s);
+    ASSERT_TRUE(result) << source;
+    EXPECT_TRUE(result->ok());
+    EXPECT_EQ(result->path, std::string("/cache/") + source);
+  }
+  EXPECT_EQ(peak_.load(), 2);
+  EXPECT_EQ(preloader.stats().fetches, 4u);
+}
+
+TEST_F(SandboxBundlePreloaderTest, DeduplicatesInFlightAndLoadedSources) {
+  auto& preloader = SandboxBundlePreloader::getInstance();
+  installGatedFetcher();
+
+  EXPECT_EQ(preloader.preload({"a.js", "a.js"}), 1u);
+  EXPECT_EQ(preloader.preload({"a.js"}), 0u);
+  release();
+  ASSERT_TRUE(preloader.wait("a.js", 2s));
+  EXPECT_EQ(preloader.preload({"a.js"}), 0u);
+
+  auto stats = preloader.stats();
+  EXPECT_EQ(stats.fetches, 1u);
+  EXPECT_EQ(stats.deduplicated, 3u);
+}
+
+TEST_F(SandboxBundlePreloaderTest, RetriesFailedSources) {
+  auto& preloader = SandboxBundlePreloader::getInstance();
+  std::atomic<int> calls{0};
+  preloader.setFetcher([&calls](const std::string& source) -> PreloadResult {
+    if (++calls == 1) {
+      throw std::runtime_error("HTTP 503");
+    }
+    PreloadResult result;
+    result.path = "/cache/" + source;
+    return result;
+  });
+
+  preloader.preload({"a.js"});
+  auto failed = preloader.wait("a.js", 2s);
+  ASSERT_TRUE(failed);
+  EXPECT_FALSE(failed->ok());
+  EXPECT_EQ(failed->error, "HTTP 503");
+
+  EXPECT_EQ(preloader.preload({"a.js"}), 1u);
+  auto retried = preloader.wait("a.js", 2s);
+  ASSERT_TRUE(retried);
+  EXPECT_TRUE(retried->ok());
+  EXPECT_EQ(preloader.stats().failures, 1u);
+}
+
+TEST_F(SandboxBundlePreloaderTest, FailsWithoutFetcher) {
+  auto& preloader = SandboxBundlePreloader::getInstance();
+  preloader.preload({"a.js"});
+  auto result = preloader.wait("a.js", 2s);
+  ASSERT_TRUE(result);
+  EXPECT_FALSE(result->ok());
+  EXPECT_FALSE(result->error.empty());
+}
+
+TEST_F(SandboxBundlePreloaderTest, WaitTimesOutWhileLoading) {
+  auto& preloader = SandboxBundlePreloader::getInstance();
+  installGatedFetcher();
+  preloader.preload({"a.js"});
+
+  EXPECT_FALSE(preloader.wait("a.js", 10ms));
+  EXPECT_FALSE(preloader.wait("unknown.js", 1s));
+}
+
+TEST_F(SandboxBundlePreloaderTest, EvictedSourcesAreFetchedAgain) {
+  auto& preloader = SandboxBundlePreloader::getInstance();
+  installGatedFetcher();
+  release();
+  preloader.preload({"a.js"});
+  ASSERT_TRUE(preloader.wait("a.js", 2s));
+
+  preloader.evict("a.js");
+  EXPECT_FALSE(preloader.find("a.js"));
+  EXPECT_EQ(preloader.preload({"a.js"}), 1u);
+  ASSERT_TRUE(preloader.wait("a.js", 2s));
+  EXPECT_EQ(preloader.stats().fetches, 2u);
+}
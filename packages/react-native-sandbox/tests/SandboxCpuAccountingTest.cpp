@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <SandboxCpuAccounting.h>
+
+using namespace rnsandbox;
+using namespace std::chrono_literals;
+
+namespace {
+
+void spinFor(std::chrono::milliseconds duration) {
+  auto end = std::chrono::steady_clock::now() + duration;
+  volatile uint64_t sink = 0;
+  while (std::chrono::steady_clock::now() < end) {
+    sink = sink + 1;
+  }
+}
+
+constexpr uint64_t kMs = 1000 * 1000;
+
+} // namespace
+
+class SandboxCpuAccountingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxCpuAccounting::getInstance().reset();
+  }
+
+  void TearDown() override {
+    SandboxCpuAccounting::getInstance().reset();
+  }
+};
+
+TEST_F(SandboxCpuAccountingTest, ChargesScopeToItsCategory) {
+  auto account = SandboxCpuAccounting::getInstance().account("plugin");
+  {
+    CpuScope scope(account.get(), CpuCategory::UserCallback);
+    spinFor(20ms);
+  }
+
+  auto usage = account->usage();
+  const CpuTime& callback = usage[CpuCategory::UserCallback];
+  EXPECT_EQ(callback.count, 1u);
+  EXPECT_GE(callback.wallNs, 20 * kMs);
+  EXPECT_GT(callback.cpuNs, 0u);
+  EXPECT_EQ(usage[CpuCategory::Delivery].count, 0u);
+}
+
+TEST_F(SandboxCpuAccountingTest, NestedScopesAreExclusive) {
+  auto account = SandboxCpuAccounting::getInstance().account("plugin");
+  auto start = std::chrono::steady_clock::now();
+  {
+    CpuScope delivery(account.get(), CpuCategory::Delivery);
+    {
+      CpuScope callback(account.get(), CpuCategory::UserCallback);
+      spinFor(30ms);
+      {
+        CpuScope call(account.get(), CpuCategory::NativeCall);
+        spinFor(20ms);
+      }
+    }
+  }
+
+  auto outerNs = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+
+  auto usage = account->usage();
+  uint64_t nativeNs = usage[CpuCategory::NativeCall].wallNs;
+  EXPECT_GE(nativeNs, 20 * kMs);
+  EXPECT_GE(usage[CpuCategory::UserCallback].wallNs, 30 * kMs);
+  // The nested call is not charged to the callback as well
+  EXPECT_LE(usage[CpuCategory::UserCallback].wallNs, outerNs - nativeNs);
+  EXPECT_EQ(usage.total().count, 3u);
+  EXPECT_GE(usage.total().wallNs, 50 * kMs);
+  EXPECT_LE(usage.total().wallNs, outerNs);
+}
+
+TEST_F(SandboxCpuAccountingTest, SleepCountsAsWallButNotCpuTime) {
+  auto account = SandboxCpuAccounting::getInstance().account("plugin");
+  {
+    CpuScope scope(account.get(), CpuCategory::NativeCall);
+    std::this_thread::sleep_for(30ms);
+  }
+
+  const CpuTime& call = account->usage()[CpuCategory::NativeCall];
+  EXPECT_GE(call.wallNs, 30 * kMs);
+  EXPECT_LT(call.cpuNs, 15 * kMs);
+}
+
+TEST_F(SandboxCpuAccountingTest, NullAccountIsANoOp) {
+  auto account = SandboxCpuAccounting::getInstance().account("plugin");
+  {
+    CpuScope outer(account.get(), CpuCategory::UserCallback);
+    CpuScope untracked(nullptr, CpuCategory::NativeCall);
+    spinFor(10ms);
+  }
+
+  // Time of the untracked scope stays with its parent
+  EXPECT_GE(account->usage()[CpuCategory::UserCallback].wallNs, 10 * kMs);
+  EXPECT_EQ(SandboxCpuAccounting::getInstance().account(""), nullptr);
+}
+
+TEST_F(SandboxCpuAccountingTest, AccountsArePerOriginAndSurviveLookups) {
+  auto& accounting = SandboxCpuAccounting::getInstance();
+  auto a = accounting.account("a");
+  EXPECT_EQ(accounting.account("a"), a);
+  { CpuScope scope(a.get(), CpuCategory::Serialization); }
+  accounting.account("b");
+
+  auto snapshot = accounting.snapshot();
+  ASSERT_EQ(snapshot.size(), 2u);
+  EXPECT_EQ(snapshot["a"][CpuCategory::Serialization].count, 1u);
+  EXPECT_EQ(snapshot["b"].total().count, 0u);
+  EXPECT_GT(snapshot["a"].elapsedNs, 0u);
+}
+
+TEST_F(SandboxCpuAccountingTest, SerializesSnapshotAsJson) {
+  SandboxCpuUsage usage;
+  usage.elapsedNs = 10 * kMs;
+  usage.categories[static_cast<size_t>(CpuCategory::UserCallback)] = {
+      2 * kMs, kMs, 3};
+  std::map<std::string, SandboxCpuUsage> snapshot{{"we\"ird", usage}};
+
+  EXPECT_EQ(
+      toJson(snapshot),
+      "{\"we\\\"ird\":{\"occupancy\":0.2000,\"elapsedUs\":10000,"
+      "\"total\":{\"wallUs\":2000,\"cpuUs\":1000,\"count\":3},"
+      "\"delivery\":{\"wallUs\":0,\"cpuUs\":0,\"count\":0},"
+      "\"serialization\":{\"wallUs\":0,\"cpuUs\":0,\"count\":0},"
+      "\"userCallback\":{\"wallUs\":2000,\"cpuUs\":1000,\"count\":3},"
+      "\"nativeCall\":{\"wallUs\":0,\"cpuUs\":0,\"count\":0}}}");
+  EXPECT_EQ(toJson({}), "{}");
+}
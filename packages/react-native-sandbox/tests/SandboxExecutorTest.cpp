@@ -0,0 +1,258 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SandboxExecutor.h>
+
+using namespace rnsandbox;
+using ::testing::HasSubstr;
+
+namespace {
+
+constexpr std::chrono::seconds kTimeout{5};
+
+// Counts down as tasks finish, so tests can wait for them
+class Latch {
+ public:
+  explicit Latch(size_t count) : count_(count) {}
+
+  void countDown() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ > 0 && --count_ == 0) {
+      done_.notify_all();
+    }
+  }
+
+  bool wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return done_.wait_for(lock, kTimeout, [this] { return count_ == 0; });
+  }
+
+ private:
+  size_t count_;
+  std::condition_variable done_;
+  std::mutex mutex_;
+};
+
+} // namespace
+
+TEST(SandboxExecutorTest, RunsEachStrandInPostOrder) {
+  SandboxExecutor executor(4);
+  auto chat = executor.strand("chat/AsyncStorage");
+  auto feed = executor.strand("feed/AsyncStorage");
+  EXPECT_EQ(executor.strand("chat/AsyncStorage"), chat);
+
+  std::mutex mutex;
+  std::vector<int> chatOrder;
+  std::vector<int> feedOrder;
+  Latch latch(200);
+  for (int i = 0; i < 100; ++i) {
+    chat->post([&, i] {
+      std::lock_guard<std::mutex> lock(mutex);
+      chatOrder.push_back(i);
+      latch.countDown();
+    });
+    feed->post([&, i] {
+      std::lock_guard<std::mutex> lock(mutex);
+      feedOrder.push_back(i);
+      latch.countDown();
+    });
+  }
+  ASSERT_TRUE(latch.wait());
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(chatOrder.size(), 100u);
+  EXPECT_TRUE(std::is_sorted(chatOrder.begin(), chatOrder.end()));
+  EXPECT_EQ(feedOrder.size(), 100u);
+  EXPECT_TRUE(std::is_sorted(feedOrder.begin(), feedOrder.end()));
+}
+
+TEST(SandboxExecutorTest, NeverRunsOneStrandConcurrently) {
+  SandboxExecutor executor(4);
+  auto strand = executor.strand("chat/AsyncStorage");
+  std::atomic<int> running{0};
+  std::atomic<bool> overlapped{false};
+  Latch latch(50);
+  for (int i = 0; i < 50; ++i) {
+    strand->post([&] {
+      if (running.fetch_add(1) != 0) {
+        overlapped = true;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      running.fetch_sub(1);
+      latch.countDown();
+    });
+  }
+  ASSERT_TRUE(latch.wait());
+  EXPECT_FALSE(overlapped);
+}
+
+TEST(SandboxExecutorTest, MultiplexesManyLanesOnBoundedPool) {
+  SandboxExecutor executor(2);
+  std::atomic<int> running{0};
+  std::atomic<int> peak{0};
+  Latch latch(30 * 4);
+  for (int lane = 0; lane < 30; ++lane) {
+    auto strand = executor.strand("origin" + std::to_string(lane) + "/Fs");
+    for (int i = 0; i < 4; ++i) {
+      strand->post([&] {
+        int now = running.fetch_add(1) + 1;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        running.fetch_sub(1);
+        latch.countDown();
+      });
+    }
+  }
+  ASSERT_TRUE(latch.wait());
+  EXPECT_LE(peak.load(), 2);
+  EXPECT_LE(executor.threadCount(), 2u);
+  EXPECT_EQ(executor.laneStats().size(), 30u);
+}
+
+TEST(SandboxExecutorTest, IdleWorkersExitAfterKeepAlive) {
+  SandboxExecutor executor(2, std::chrono::milliseconds(20));
+  Latch latch(1);
+  executor.strand("chat/Fs")->post([&] { latch.countDown(); });
+  ASSERT_TRUE(latch.wait());
+
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (executor.threadCount() > 0 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(executor.threadCount(), 0u);
+
+  // Starts a worker again for new work
+  Latch again(1);
+  executor.strand("chat/Fs")->post([&] { again.countDown(); });
+  EXPECT_TRUE(again.wait());
+}
+
+TEST(SandboxExecutorTest, SurvivesThrowingTask) {
+  SandboxExecutor executor(1);
+  auto strand = executor.strand("chat/Fs");
+  Latch latch(1);
+  strand->post([] { throw std::runtime_error("module failed"); });
+  strand->post([&] { latch.countDown(); });
+  EXPECT_TRUE(latch.wait());
+}
+
+TEST(SandboxExecutorTest, ReportsPerLaneQueueMetrics) {
+  SandboxExecutor executor(1);
+  auto strand = executor.strand("chat/AsyncStorage");
+
+  std::mutex gate;
+  std::unique_lock<std::mutex> held(gate);
+  Latch latch(3);
+  for (int i = 0; i < 3; ++i) {
+    strand->post([&] {
+      std::lock_guard<std::mutex> lock(gate);
+      latch.countDown();
+    });
+  }
+  auto blocked = strand->stats();
+  EXPECT_EQ(blocked.posted, 3u);
+  EXPECT_GE(blocked.maxPending, 2u);
+  held.unlock();
+  ASSERT_TRUE(latch.wait());
+
+  // Lanes run elsewhere report alongside the strands
+  auto external = executor.laneMetrics("chat/RNFSManager");
+  auto startedAt = external->taskStarted(external->taskPosted());
+  external->taskFinished(startedAt);
+
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (strand->stats().completed < 3 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto lanes = executor.laneStats();
+  ASSERT_EQ(lanes.size(), 2u);
+  EXPECT_EQ(lanes["chat/AsyncStorage"].completed, 3u);
+  EXPECT_EQ(lanes["chat/AsyncStorage"].pending, 0u);
+  EXPECT_EQ(lanes["chat/RNFSManager"].posted, 1u);
+  EXPECT_EQ(lanes["chat/RNFSManager"].completed, 1u);
+
+  std::string json = toJson(lanes);
+  EXPECT_THAT(json, HasSubstr("\"chat/AsyncStorage\":{\"posted\":3,"));
+  EXPECT_THAT(json, HasSubstr("\"completed\":1,\"pending\":0,"));
+}
+
+TEST(SandboxTaskTest, StoresSmallCallablesInline) {
+  static_assert(SandboxTask::storedInline<std::function<void()>>());
+  struct Large {
+    char bytes[SandboxTask::kInlineSize + 1];
+    void operator()() const {}
+  };
+  static_assert(!SandboxTask::storedInline<Large>());
+
+  auto captured = std::make_shared<int>(0);
+  SandboxTask small([captured] { ++*captured; });
+  std::function<void()> function = [captured] { ++*captured; };
+  SandboxTask wrapped(std::move(function));
+  std::array<char, 64> padding{};
+  SandboxTask large([captured, padding] { *captured += 1 + padding[0]; });
+
+  SandboxTask moved(std::move(small));
+  EXPECT_FALSE(small);
+  moved();
+  wrapped();
+  large();
+  EXPECT_EQ(*captured, 3);
+
+  EXPECT_EQ(captured.use_count(), 4);
+  moved.reset();
+  large = SandboxTask();
+  EXPECT_EQ(captured.use_count(), 2);
+}
+
+TEST(BatchedTaskQueueTest, RunsCallsPostedMeanwhileInSameWakeup) {
+  BatchedTaskQueue queue(std::make_shared<LaneMetrics>());
+  std::vector<int> order;
+
+  EXPECT_TRUE(queue.push([&] { order.push_back(1); }));
+  EXPECT_FALSE(queue.push([&] {
+    order.push_back(2);
+    // Already scheduled: joins the running drain
+    EXPECT_FALSE(queue.push([&] { order.push_back(3); }));
+  }));
+
+  EXPECT_FALSE(queue.drain(16));
+  EXPECT_THAT(order, ::testing::ElementsAre(1, 2, 3));
+  EXPECT_EQ(queue.stats().completed, 3u);
+
+  // Idle again: the next call schedules a new drain
+  EXPECT_TRUE(queue.push([&] { order.push_back(4); }));
+  EXPECT_FALSE(queue.drain(16));
+  EXPECT_EQ(order.size(), 4u);
+}
+
+TEST(BatchedTaskQueueTest, YieldsAfterBatchLimitInPostOrder) {
+  BatchedTaskQueue queue(std::make_shared<LaneMetrics>());
+  std::vector<int> order;
+  for (int i = 0; i < 5; ++i) {
+    queue.push([&, i] { order.push_back(i); });
+  }
+
+  EXPECT_TRUE(queue.drain(2));
+  EXPECT_TRUE(queue.drain(2));
+  EXPECT_FALSE(queue.push([&] { order.push_back(5); }));
+  // The rest of the batch, then the call posted meanwhile
+  EXPECT_FALSE(queue.drain(2));
+  EXPECT_THAT(order, ::testing::ElementsAre(0, 1, 2, 3, 4, 5));
+  EXPECT_EQ(queue.stats().pending, 0u);
+}
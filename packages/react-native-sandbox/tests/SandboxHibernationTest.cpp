@@ -0,0 +1,150 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <SandboxHibernation.h>
+#include <SandboxRegistry.h>
+
+#include "MockSandboxDelegate.h"
+
+using namespace rnsandbox;
+using ::testing::ElementsAre;
+using ::testing::NiceMock;
+using ::testing::Pair;
+
+class SandboxHibernationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxRegistry::getInstance().reset();
+    hibernation_ = std::make_shared<SandboxHibernation>();
+    hibernation_->setWakeHandler([this] { ++wakeCalls_; });
+  }
+
+  void TearDown() override {
+    SandboxRegistry::getInstance().reset();
+  }
+
+  void hibernate(std::optional<std::string> stateJson = std::nullopt) {
+    ASSERT_TRUE(hibernation_->beginHibernate());
+    EXPECT_FALSE(hibernation_->completeHibernate(std::move(stateJson)));
+    ASSERT_EQ(hibernation_->state(), HibernationState::Hibernated);
+  }
+
+  std::shared_ptr<SandboxHibernation> hibernation_;
+  int wakeCalls_ = 0;
+};
+
+TEST_F(SandboxHibernationTest, ParsesWakePolicies) {
+  HibernationWakePolicy policy = HibernationWakePolicy::Queue;
+  EXPECT_TRUE(parseHibernationWakePolicy("any", policy));
+  EXPECT_EQ(policy, HibernationWakePolicy::Any);
+  EXPECT_TRUE(parseHibernationWakePolicy("urgent", policy));
+  EXPECT_EQ(policy, HibernationWakePolicy::Urgent);
+  EXPECT_FALSE(parseHibernationWakePolicy("sometimes", policy));
+  EXPECT_EQ(policy, HibernationWakePolicy::Urgent);
+  EXPECT_TRUE(parseHibernationWakePolicy("queue", policy));
+  EXPECT_EQ(policy, HibernationWakePolicy::Queue);
+}
+
+TEST_F(SandboxHibernationTest, StateBlobSurvivesUntilTheNextRuntimeTakesIt) {
+  EXPECT_FALSE(hibernation_->resume());
+  hibernate(std::string(R"({"tab":3})"));
+  EXPECT_FALSE(hibernation_->beginHibernate());
+
+  EXPECT_TRUE(hibernation_->resume());
+  EXPECT_EQ(hibernation_->state(), HibernationState::Active);
+  EXPECT_EQ(hibernation_->takeRestoredState(), R"({"tab":3})");
+  EXPECT_EQ(hibernation_->takeRestoredState(), std::nullopt);
+  EXPECT_EQ(hibernation_->stats().hibernations, 1u);
+}
+
+TEST_F(SandboxHibernationTest, QueuePolicyNeverWakes) {
+  hibernate();
+  EXPECT_FALSE(hibernation_->noteMessage(MessagePriority::Urgent));
+  EXPECT_FALSE(hibernation_->noteMessage(MessagePriority::Bulk));
+  EXPECT_EQ(wakeCalls_, 0);
+}
+
+TEST_F(SandboxHibernationTest, UrgentPolicyWakesOnceOnUrgentMessages) {
+  hibernation_->setWakePolicy(HibernationWakePolicy::Urgent);
+  hibernate();
+
+  EXPECT_FALSE(hibernation_->noteMessage(MessagePriority::Bulk));
+  EXPECT_TRUE(hibernation_->noteMessage(MessagePriority::Urgent));
+  EXPECT_FALSE(hibernation_->noteMessage(MessagePriority::Urgent));
+  EXPECT_EQ(wakeCalls_, 1);
+  EXPECT_EQ(hibernation_->stats().wakeRequests, 1u);
+
+  // A new hibernation may request a new wake-up
+  EXPECT_TRUE(hibernation_->resume());
+  hibernate();
+  EXPECT_TRUE(hibernation_->noteMessage(MessagePriority::Urgent));
+  EXPECT_EQ(wakeCalls_, 2);
+}
+
+TEST_F(SandboxHibernationTest, ActiveSandboxesIgnoreMessages) {
+  hibernation_->setWakePolicy(HibernationWakePolicy::Any);
+  EXPECT_FALSE(hibernation_->noteMessage(MessagePriority::Urgent));
+  EXPECT_EQ(wakeCalls_, 0);
+}
+
+TEST_F(SandboxHibernationTest, WakeDuringSnapshotIsReportedOnCompletion) {
+  hibernation_->setWakePolicy(HibernationWakePolicy::Any);
+  ASSERT_TRUE(hibernation_->beginHibernate());
+
+  EXPECT_TRUE(hibernation_->noteMessage(MessagePriority::Bulk));
+  EXPECT_EQ(wakeCalls_, 0);
+  EXPECT_TRUE(hibernation_->completeHibernate(std::nullopt));
+  EXPECT_TRUE(hibernation_->resume());
+}
+
+TEST_F(SandboxHibernationTest, ExplicitResumeDuringSnapshotIsDeferred) {
+  ASSERT_TRUE(hibernation_->beginHibernate());
+  EXPECT_FALSE(hibernation_->resume());
+  EXPECT_EQ(hibernation_->state(), HibernationState::Hibernating);
+  EXPECT_TRUE(hibernation_->completeHibernate(std::string("{}")));
+  EXPECT_TRUE(hibernation_->resume());
+}
+
+TEST_F(SandboxHibernationTest, ParkedMessagesAreBoundedAndKeepOrder) {
+  hibernate();
+  for (size_t i = 0; i < SandboxHibernation::kMaxParkedMessages + 2; ++i) {
+    hibernation_->parkMessage(
+        std::to_string(i),
+        i % 2 ? MessagePriority::Urgent : MessagePriority::Bulk);
+  }
+
+  auto parked = hibernation_->takeParkedMessages();
+  ASSERT_EQ(parked.size(), SandboxHibernation::kMaxParkedMessages);
+  EXPECT_THAT(parked[0], Pair("0", MessagePriority::Bulk));
+  EXPECT_THAT(parked[1], Pair("1", MessagePriority::Urgent));
+  EXPECT_EQ(hibernation_->stats().droppedMessages, 2u);
+  EXPECT_TRUE(hibernation_->takeParkedMessages().empty());
+}
+
+TEST_F(SandboxHibernationTest, ParkedDelegateKeepsTheOriginReachable) {
+  hibernation_->setWakePolicy(HibernationWakePolicy::Any);
+  hibernate();
+
+  auto& registry = SandboxRegistry::getInstance();
+  auto sender = std::make_shared<NiceMock<MockSandboxDelegate>>();
+  auto parked = std::make_shared<ParkedSandboxDelegate>(hibernation_);
+  registry.registerSandbox("tab", parked, {});
+  registry.registerSandbox("host", sender, {"tab"});
+
+  auto target = registry.find("tab");
+  ASSERT_NE(target, nullptr);
+  target->postMessage(R"({"n":1})", MessagePriority::Bulk);
+  target->postMessage(R"({"n":2})", MessagePriority::Urgent);
+
+  EXPECT_EQ(wakeCalls_, 1);
+  EXPECT_FALSE(parked->scheduleOnJSThread([](facebook::jsi::Runtime&) {}));
+  EXPECT_FALSE(parked->routeMessage("{}", "host", MessagePriority::Bulk));
+  EXPECT_THAT(
+      hibernation_->takeParkedMessages(),
+      ElementsAre(
+          Pair(R"({"n":1})", MessagePriority::Bulk),
+          Pair(R"({"n":2})", MessagePriority::Urgent)));
+}
@@ -0,0 +1,288 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <SandboxKVStore.h>
+
+using namespace rnsandbox;
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+class SandboxKVStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = ::testing::TempDir() + "kv-store-test-" +
+        ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    removeStore();
+  }
+
+  void TearDown() override {
+    removeStore();
+  }
+
+  void removeStore() {
+    std::remove(logPath().c_str());
+    std::remove((directory_ + "/" + SandboxKVStore::kCompactName).c_str());
+    std::remove((directory_ + "/" + SandboxKVStore::kLockName).c_str());
+    ::rmdir(directory_.c_str());
+  }
+
+  std::unique_ptr<SandboxKVStore> open(KVStoreOptions options = {}) {
+    std::string error;
+    auto store = SandboxKVStore::open(directory_, options, &error);
+    EXPECT_TRUE(store) << error;
+    return store;
+  }
+
+  std::string logPath() const {
+    return directory_ + "/" + SandboxKVStore::kLogName;
+  }
+
+  std::string readLog() const {
+    std::ifstream in(logPath(), std::ios::binary);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+  }
+
+  void writeLog(const std::string& contents) const {
+    std::ofstream(logPath(), std::ios::binary | std::ios::trunc) << contents;
+  }
+
+  std::string directory_;
+};
+
+TEST_F(SandboxKVStoreTest, PutsGetsAndRemoves) {
+  auto store = open();
+  KVBatch batch;
+  batch.put("a", "1");
+  batch.put("b", "2");
+  batch.put("a", "3");
+  ASSERT_TRUE(store->write(batch));
+
+  EXPECT_EQ(store->get("a"), "3");
+  EXPECT_EQ(store->get("b"), "2");
+  EXPECT_EQ(store->get("c"), std::nullopt);
+  EXPECT_THAT(store->keys(), UnorderedElementsAre("a", "b"));
+
+  KVBatch removal;
+  removal.remove("a");
+  removal.remove("missing");
+  ASSERT_TRUE(store->write(removal));
+  EXPECT_EQ(store->get("a"), std::nullopt);
+  EXPECT_THAT(store->keys(), UnorderedElementsAre("b"));
+}
+
+TEST_F(SandboxKVStoreTest, ReadsLargeValuesBackFromTheLog) {
+  KVStoreOptions options;
+  options.inlineValueLimit = 4;
+  auto store = open(options);
+  std::string large(10000, 'x');
+  KVBatch batch;
+  batch.put("large", large);
+  batch.put("small", "ok");
+  ASSERT_TRUE(store->write(batch));
+
+  EXPECT_EQ(store->get("large"), large);
+  EXPECT_EQ(store->get("small"), "ok");
+}
+
+TEST_F(SandboxKVStoreTest, ReplaysTheLogWhenReopened) {
+  {
+    auto store = open();
+    KVBatch first;
+    first.put("a", "1");
+    first.put("b", std::string(4096, 'b'));
+    ASSERT_TRUE(store->write(first));
+    KVBatch second;
+    second.remove("a");
+    second.put("c", "3");
+    ASSERT_TRUE(store->write(second));
+  }
+
+  auto store = open();
+  EXPECT_THAT(store->keys(), UnorderedElementsAre("b", "c"));
+  EXPECT_EQ(store->get("b"), std::string(4096, 'b'));
+  EXPECT_EQ(store->get("c"), "3");
+  EXPECT_EQ(store->stats().droppedBytes, 0u);
+}
+
+TEST_F(SandboxKVStoreTest, OpensADirectoryInOneStoreAtATime) {
+  auto store = open();
+  std::string error;
+  EXPECT_EQ(SandboxKVStore::open(directory_, {}, &error), nullptr);
+  EXPECT_NE(error.find("already open"), std::string::npos);
+
+  store.reset();
+  EXPECT_TRUE(open());
+}
+
+TEST_F(SandboxKVStoreTest, SharesOneStorePerDirectory) {
+  auto first = SandboxKVStore::openShared(directory_);
+  auto second = SandboxKVStore::openShared(directory_);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(first.get(), second.get());
+
+  KVBatch batch;
+  batch.put("a", "1");
+  ASSERT_TRUE(first->write(batch));
+  first.reset();
+  EXPECT_EQ(second->get("a"), "1");
+
+  second.reset();
+  auto store = open();
+  EXPECT_EQ(store->get("a"), "1");
+}
+
+TEST_F(SandboxKVStoreTest, CutsOffATornBatch) {
+  size_t intact;
+  {
+    auto store = open();
+    KVBatch first;
+    first.put("a", "1");
+    ASSERT_TRUE(store->write(first));
+    intact = store->stats().logBytes;
+    KVBatch second;
+    second.put("b", "2");
+    second.put("c", "3");
+    ASSERT_TRUE(store->write(second));
+  }
+  std::string log = readLog();
+  writeLog(log.substr(0, log.size() - 3));
+
+  auto store = open();
+  EXPECT_THAT(store->keys(), UnorderedElementsAre("a"));
+  EXPECT_EQ(store->stats().droppedBytes, log.size() - 3 - intact);
+  EXPECT_EQ(readLog().size(), intact);
+
+  // Appends after the cut
+  KVBatch third;
+  third.put("d", "4");
+  ASSERT_TRUE(store->write(third));
+  store.reset();
+  EXPECT_THAT(open()->keys(), UnorderedElementsAre("a", "d"));
+}
+
+TEST_F(SandboxKVStoreTest, CutsOffACorruptBatch) {
+  {
+    auto store = open();
+    KVBatch batch;
+    batch.put("a", "1");
+    ASSERT_TRUE(store->write(batch));
+  }
+  std::string log = readLog();
+  log[log.size() - 1] ^= 0x01;
+  writeLog(log);
+
+  auto store = open();
+  EXPECT_TRUE(store->keys().empty());
+  EXPECT_EQ(store->stats().logBytes, SandboxKVStore::kHeaderSize);
+}
+
+TEST_F(SandboxKVStoreTest, CommitsAGroupWithOneSync) {
+  auto store = open();
+  std::vector<KVBatch> group(4);
+  group[0].put("a", "1");
+  group[0].put("b", "1");
+  group[1].remove("a");
+  group[3].put("b", "2");
+  std::vector<std::string> errors;
+  ASSERT_TRUE(store->writeGroup(group, errors));
+
+  EXPECT_THAT(errors, ElementsAre("", "", "", ""));
+  EXPECT_THAT(store->keys(), UnorderedElementsAre("b"));
+  EXPECT_EQ(store->get("b"), "2");
+  auto stats = store->stats();
+  EXPECT_EQ(stats.batches, 3u);
+  EXPECT_EQ(stats.syncs, 1u);
+}
+
+TEST_F(SandboxKVStoreTest, KeepsEachBatchOfAGroupAtomic) {
+  {
+    auto store = open();
+    std::vector<KVBatch> group(2);
+    group[0].put("a", "1");
+    group[1].put("b", "2");
+    group[1].put("c", "3");
+    std::vector<std::string> errors;
+    ASSERT_TRUE(store->writeGroup(group, errors));
+  }
+  std::string log = readLog();
+  writeLog(log.substr(0, log.size() - 1));
+
+  // The crash tore the second batch, not the first
+  auto store = open();
+  EXPECT_THAT(store->keys(), UnorderedElementsAre("a"));
+}
+
+TEST_F(SandboxKVStoreTest, RejectsFilesThatAreNotALog) {
+  ::mkdir(directory_.c_str(), 0700);
+  writeLog("{\"manifest\":true}");
+  std::string error;
+  EXPECT_EQ(SandboxKVStore::open(directory_, {}, &error), nullptr);
+  EXPECT_NE(error.find("not a key-value store log"), std::string::npos);
+}
+
+TEST_F(SandboxKVStoreTest, CompactsOnceGarbageOutweighsLiveData) {
+  KVStoreOptions options;
+  options.compactMinBytes = 4096;
+  options.inlineValueLimit = 16;
+  auto store = open(options);
+  std::string value(100, 'v');
+  for (int i = 0; i < 200; ++i) {
+    KVBatch batch;
+    batch.put("key" + std::to_string(i % 10), value + std::to_string(i));
+    ASSERT_TRUE(store->write(batch));
+  }
+
+  auto stats = store->stats();
+  EXPECT_GT(stats.compactions, 0u);
+  EXPECT_EQ(stats.keys, 10u);
+  EXPECT_LT(stats.logBytes, 2 * stats.liveBytes + options.compactMinBytes);
+  EXPECT_EQ(store->get("key9"), value + "199");
+
+  store.reset();
+  store = open(options);
+  EXPECT_EQ(store->stats().keys, 10u);
+  EXPECT_EQ(store->get("key0"), value + "190");
+}
+
+TEST_F(SandboxKVStoreTest, CompactsOnRequest) {
+  auto store = open();
+  KVBatch batch;
+  batch.put("a", std::string(2000, 'a'));
+  batch.put("b", "2");
+  ASSERT_TRUE(store->write(batch));
+  KVBatch removal;
+  removal.remove("b");
+  ASSERT_TRUE(store->write(removal));
+
+  ASSERT_TRUE(store->compact());
+  auto stats = store->stats();
+  EXPECT_EQ(stats.compactions, 1u);
+  EXPECT_EQ(
+      stats.logBytes,
+      SandboxKVStore::kHeaderSize + SandboxKVStore::kBatchHeaderSize +
+          stats.liveBytes);
+  EXPECT_EQ(store->get("a"), std::string(2000, 'a'));
+  EXPECT_FALSE(std::ifstream(directory_ + "/" + SandboxKVStore::kCompactName)
+                   .good());
+}
+
+TEST_F(SandboxKVStoreTest, ClearsEveryKey) {
+  auto store = open();
+  KVBatch batch;
+  batch.put("a", "1");
+  ASSERT_TRUE(store->write(batch));
+  ASSERT_TRUE(store->clear());
+  EXPECT_TRUE(store->keys().empty());
+  EXPECT_EQ(store->stats().liveBytes, 0u);
+
+  store.reset();
+  EXPECT_TRUE(open()->keys().empty());
+}
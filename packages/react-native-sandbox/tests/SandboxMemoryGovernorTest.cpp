@@ -0,0 +1,202 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SandboxMemoryGovernor.h>
+
+using namespace rnsandbox;
+using ::testing::ElementsAre;
+
+namespace {
+
+constexpr size_t kMiB = 1024 * 1024;
+
+} // namespace
+
+class SandboxMemoryGovernorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxMemoryGovernor::getInstance().reset();
+  }
+
+  void TearDown() override {
+    SandboxMemoryGovernor::getInstance().reset();
+  }
+
+  SandboxMemoryGovernor::SandboxId add(const std::string& name) {
+    return SandboxMemoryGovernor::getInstance().add(
+        {[this, name] { events.push_back("gc:" + name); },
+         [this, name](EvictionReason reason, size_t) {
+           events.push_back(
+               std::string(
+                   reason == EvictionReason::HeapLimit ? "limit:"
+                                                       : "evict:") +
+               name);
+         }});
+  }
+
+  std::vector<std::string> events;
+};
+
+TEST_F(SandboxMemoryGovernorTest, ParsesEvictionPolicies) {
+  EvictionPolicy policy = EvictionPolicy::Hibernate;
+  EXPECT_TRUE(parseEvictionPolicy("never", policy));
+  EXPECT_EQ(policy, EvictionPolicy::Never);
+  EXPECT_FALSE(parseEvictionPolicy("destroy", policy));
+  EXPECT_EQ(policy, EvictionPolicy::Never);
+  EXPECT_TRUE(parseEvictionPolicy("hibernate", policy));
+  EXPECT_EQ(policy, EvictionPolicy::Hibernate);
+}
+
+TEST_F(SandboxMemoryGovernorTest, HeapLimitCollectsBeforeEvicting) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  auto leaky = add("leaky");
+  governor.setHeapLimit(leaky, 10 * kMiB);
+
+  governor.reportHeapUsage(leaky, 8 * kMiB, false);
+  EXPECT_TRUE(events.empty());
+  EXPECT_EQ(governor.heapBytes(leaky), 8 * kMiB);
+
+  governor.reportHeapUsage(leaky, 12 * kMiB, false);
+  EXPECT_THAT(events, ElementsAre("gc:leaky"));
+
+  // Periodic samples taken before the collection ran do not count
+  governor.reportHeapUsage(leaky, 12 * kMiB, false);
+  EXPECT_THAT(events, ElementsAre("gc:leaky"));
+
+  governor.reportHeapUsage(leaky, 11 * kMiB, true);
+  EXPECT_THAT(events, ElementsAre("gc:leaky", "limit:leaky"));
+  EXPECT_EQ(governor.stats().residentSandboxes, 0u);
+  EXPECT_EQ(governor.stats().evictions, 1u);
+}
+
+TEST_F(SandboxMemoryGovernorTest, CollectionThatFreesEnoughKeepsTheSandbox) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  auto sandbox = add("a");
+  governor.setHeapLimit(sandbox, 10 * kMiB);
+
+  governor.reportHeapUsage(sandbox, 12 * kMiB, false);
+  governor.reportHeapUsage(sandbox, 6 * kMiB, true);
+  governor.reportHeapUsage(sandbox, 12 * kMiB, false);
+
+  EXPECT_THAT(events, ElementsAre("gc:a", "gc:a"));
+  EXPECT_EQ(governor.stats().residentSandboxes, 1u);
+}
+
+TEST_F(SandboxMemoryGovernorTest, NeverPolicyOnlyCollects) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  auto pinned = add("pinned");
+  governor.setHeapLimit(pinned, 10 * kMiB);
+  governor.setEvictionPolicy(pinned, EvictionPolicy::Never);
+
+  governor.reportHeapUsage(pinned, 12 * kMiB, false);
+  governor.reportHeapUsage(pinned, 12 * kMiB, true);
+  governor.reportHeapUsage(pinned, 12 * kMiB, false);
+
+  EXPECT_THAT(events, ElementsAre("gc:pinned", "gc:pinned"));
+}
+
+TEST_F(SandboxMemoryGovernorTest, ModeratePressureOnlyCollects) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  add("a");
+  add("b");
+
+  governor.onMemoryPressure(MemoryPressureLevel::Moderate);
+
+  EXPECT_THAT(events, ElementsAre("gc:a", "gc:b"));
+  EXPECT_EQ(governor.stats().pressureEvents, 1u);
+}
+
+TEST_F(SandboxMemoryGovernorTest, CriticalPressureEvictsLeastRecentlyUsed) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  MemoryGovernorConfig config;
+  config.criticalHeapBudget = 50 * kMiB;
+  governor.setConfig(config);
+
+  auto a = add("a");
+  auto b = add("b");
+  auto c = add("c");
+  auto d = add("d");
+  governor.reportHeapUsage(a, 30 * kMiB, false);
+  governor.reportHeapUsage(b, 30 * kMiB, false);
+  governor.reportHeapUsage(c, 30 * kMiB, false);
+  governor.reportHeapUsage(d, 10 * kMiB, false);
+  governor.touch(a);
+  governor.setEvictionPolicy(c, EvictionPolicy::Never);
+
+  // LRU order is b, c, d, a; c is pinned. Evicting b and d leaves 60 MiB,
+  // evicting a as well gets below the budget
+  governor.onMemoryPressure(MemoryPressureLevel::Critical);
+
+  EXPECT_THAT(
+      events, ElementsAre("gc:c", "evict:b", "evict:d", "evict:a"));
+  EXPECT_EQ(governor.stats().residentSandboxes, 1u);
+  EXPECT_EQ(governor.stats().residentHeapBytes, 30 * kMiB);
+}
+
+TEST_F(SandboxMemoryGovernorTest, CriticalPressureEvictsAtLeastOne) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  auto a = add("a");
+  auto b = add("b");
+  governor.reportHeapUsage(a, kMiB, false);
+  governor.reportHeapUsage(b, kMiB, false);
+
+  governor.onMemoryPressure(MemoryPressureLevel::Critical);
+
+  EXPECT_THAT(events, ElementsAre("gc:b", "evict:a"));
+}
+
+TEST_F(SandboxMemoryGovernorTest, CriticalPressureKeepsMinimumResident) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  auto only = add("only");
+  governor.reportHeapUsage(only, 500 * kMiB, false);
+
+  governor.onMemoryPressure(MemoryPressureLevel::Critical);
+
+  EXPECT_THAT(events, ElementsAre("gc:only"));
+}
+
+TEST_F(SandboxMemoryGovernorTest, EvictedSandboxIsResidentAgainOnNextSample) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  auto a = add("a");
+  add("b");
+  governor.onMemoryPressure(MemoryPressureLevel::Critical);
+  ASSERT_THAT(events, ElementsAre("gc:b", "evict:a"));
+
+  events.clear();
+  governor.onMemoryPressure(MemoryPressureLevel::Critical);
+  EXPECT_THAT(events, ElementsAre("gc:b"));
+
+  governor.reportHeapUsage(a, kMiB, false);
+  EXPECT_EQ(governor.stats().residentSandboxes, 2u);
+}
+
+TEST_F(SandboxMemoryGovernorTest, SamplesAreRateLimited) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  MemoryGovernorConfig config;
+  config.sampleInterval = std::chrono::milliseconds(20);
+  governor.setConfig(config);
+  auto a = add("a");
+
+  EXPECT_TRUE(governor.shouldSample(a));
+  EXPECT_FALSE(governor.shouldSample(a));
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  EXPECT_TRUE(governor.shouldSample(a));
+  EXPECT_FALSE(governor.shouldSample(12345));
+}
+
+TEST_F(SandboxMemoryGovernorTest, RemovedSandboxesAreIgnored) {
+  auto& governor = SandboxMemoryGovernor::getInstance();
+  auto a = add("a");
+  governor.setHeapLimit(a, kMiB);
+  governor.remove(a);
+
+  governor.reportHeapUsage(a, 10 * kMiB, false);
+  governor.onMemoryPressure(MemoryPressureLevel::Critical);
+
+  EXPECT_TRUE(events.empty());
+  EXPECT_EQ(governor.stats().residentSandboxes, 0u);
+}
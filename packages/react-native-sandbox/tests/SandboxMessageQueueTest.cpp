@@ -0,0 +1,148 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SandboxMessageQueue.h>
+
+using namespace rnsandbox;
+using ::testing::ElementsAre;
+
+namespace {
+
+std::vector<std::string> drainOnce(SandboxMessageQueue& queue, bool* more) {
+  std::vector<std::string> delivered;
+  bool remaining = queue.drain(
+      [&delivered](std::string&& m) { delivered.push_back(std::move(m)); });
+  if (more) {
+    *more = remaining;
+  }
+  return delivered;
+}
+
+} // namespace
+
+TEST(SandboxMessageQueueTest, ParsesPriorityNames) {
+  MessagePriority priority = MessagePriority::Bulk;
+  EXPECT_TRUE(parseMessagePriority("urgent", priority));
+  EXPECT_EQ(priority, MessagePriority::Urgent);
+  EXPECT_TRUE(parseMessagePriority("bulk", priority));
+  EXPECT_EQ(priority, MessagePriority::Bulk);
+  EXPECT_FALSE(parseMessagePriority("high", priority));
+}
+
+TEST(SandboxMessageQueueTest, OnlyFirstPushRequestsDrain) {
+  SandboxMessageQueue queue;
+
+  EXPECT_TRUE(queue.push("1", MessagePriority::Bulk));
+  EXPECT_FALSE(queue.push("2", MessagePriority::Urgent));
+
+  bool more = true;
+  drainOnce(queue, &more);
+  EXPECT_FALSE(more);
+  EXPECT_TRUE(queue.push("3", MessagePriority::Bulk));
+}
+
+TEST(SandboxMessageQueueTest, UrgentIsServicedFirst) {
+  SandboxMessageQueue queue;
+  queue.push("b1", MessagePriority::Bulk);
+  queue.push("b2", MessagePriority::Bulk);
+  queue.push("u1", MessagePriority::Urgent);
+  queue.push("u2", MessagePriority::Urgent);
+
+  EXPECT_THAT(drainOnce(queue, nullptr), ElementsAre("u1", "u2", "b1", "b2"));
+}
+
+TEST(SandboxMessageQueueTest, DrainYieldsAfterBatch) {
+  SandboxMessageQueue queue(2);
+  for (int i = 0; i < 5; ++i) {
+    queue.push(std::to_string(i), MessagePriority::Bulk);
+  }
+
+  bool more = false;
+  EXPECT_THAT(drainOnce(queue, &more), ElementsAre("0", "1"));
+  EXPECT_TRUE(more);
+
+  // An urgent message arriving mid-transfer overtakes the remaining bulk
+  EXPECT_FALSE(queue.push("u", MessagePriority::Urgent));
+  EXPECT_THAT(drainOnce(queue, &more), ElementsAre("u", "2"));
+  EXPECT_THAT(drainOnce(queue, &more), ElementsAre("3", "4"));
+  EXPECT_FALSE(more);
+}
+
+TEST(SandboxMessageQueueTest, BulkIsNotStarvedByUrgent) {
+  SandboxMessageQueue queue(100, 3);
+  queue.push("b1", MessagePriority::Bulk);
+  queue.push("b2", MessagePriority::Bulk);
+  for (int i = 1; i <= 7; ++i) {
+    queue.push("u" + std::to_string(i), MessagePriority::Urgent);
+  }
+
+  EXPECT_THAT(
+      drainOnce(queue, nullptr),
+      ElementsAre("u1", "u2", "u3", "b1", "u4", "u5", "u6", "b2", "u7"));
+}
+
+TEST(SandboxMessageQueueTest, ReportsPerLaneDepth) {
+  SandboxMessageQueue queue(1);
+  queue.push("u1", MessagePriority::Urgent);
+  queue.push("b1", MessagePriority::Bulk);
+  queue.push("b2", MessagePriority::Bulk);
+
+  auto stats = queue.stats();
+  EXPECT_EQ(stats.urgent.depth, 1u);
+  EXPECT_EQ(stats.bulk.depth, 2u);
+  EXPECT_EQ(stats.bulk.maxDepth, 2u);
+
+  drainOnce(queue, nullptr);
+  drainOnce(queue, nullptr);
+
+  stats = queue.stats();
+  EXPECT_EQ(stats.urgent.depth, 0u);
+  EXPECT_EQ(stats.urgent.delivered, 1u);
+  EXPECT_EQ(stats.bulk.depth, 1u);
+  EXPECT_EQ(stats.bulk.maxDepth, 2u);
+  EXPECT_EQ(stats.bulk.enqueued, 2u);
+  EXPECT_EQ(stats.bulk.delivered, 1u);
+}
+
+TEST(SandboxMessageQueueTest, ClearDropsMessagesAndRearms) {
+  SandboxMessageQueue queue;
+  queue.push("1", MessagePriority::Bulk);
+  queue.clear();
+
+  EXPECT_EQ(queue.stats().bulk.depth, 0u);
+  EXPECT_TRUE(drainOnce(queue, nullptr).empty());
+  EXPECT_TRUE(queue.push("2", MessagePriority::Bulk));
+}
+
+TEST(SandboxMessageQueueTest, ConcurrentProducersKeepPerLaneOrder) {
+  SandboxMessageQueue queue(16);
+  const int count = 5000;
+
+  auto produce = [&queue](MessagePriority priority, const char* prefix) {
+    for (int i = 0; i < count; ++i) {
+      queue.push(prefix + std::to_string(i), priority);
+    }
+  };
+  std::thread urgentProducer(produce, MessagePriority::Urgent, "u");
+  std::thread bulkProducer(produce, MessagePriority::Bulk, "b");
+
+  int nextUrgent = 0;
+  int nextBulk = 0;
+  auto deliver = [&](std::string&& m) {
+    int& next = m[0] == 'u' ? nextUrgent : nextBulk;
+    EXPECT_EQ(std::stoi(m.substr(1)), next);
+    ++next;
+  };
+  while (nextUrgent < count || nextBulk < count) {
+    queue.drain(deliver);
+    std::this_thread::yield();
+  }
+
+  urgentProducer.join();
+  bulkProducer.join();
+  EXPECT_EQ(queue.stats().urgent.delivered, static_cast<uint64_t>(count));
+  EXPECT_EQ(queue.stats().bulk.delivered, static_cast<uint64_t>(count));
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SandboxModuleSharing.h>
+
+using namespace rnsandbox;
+
+namespace {
+
+struct StorageBackend {
+  explicit StorageBackend(int* destroyed) : destroyed(destroyed) {}
+  ~StorageBackend() {
+    ++*destroyed;
+  }
+
+  int* destroyed;
+};
+
+SandboxContext contextFor(const std::string& origin) {
+  return {origin, "RNCAsyncStorage", "SandboxedAsyncStorage", ""};
+}
+
+} // namespace
+
+class SharedModuleRegistryTest : public ::testing::Test {
+ protected:
+  SharedModuleRegistry registry;
+};
+
+TEST(ModuleSharingScopeTest, KeysScopesByPolicy) {
+  auto context = contextFor("app.a");
+  EXPECT_EQ(moduleSharingScope(ModuleSharing::PerSandbox, context), "");
+  EXPECT_EQ(
+      moduleSharingScope(ModuleSharing::PerOrigin, context), "origin:app.a");
+  EXPECT_EQ(
+      moduleSharingScope(ModuleSharing::PerGroup, context, "widgets"),
+      "group:widgets");
+  EXPECT_EQ(moduleSharingScope(ModuleSharing::PerProcess, context), "process");
+}
+
+TEST(ModuleSharingScopeTest, FallsBackToNotSharingWithoutAnOrigin) {
+  auto context = contextFor("");
+  EXPECT_EQ(moduleSharingScope(ModuleSharing::PerOrigin, context), "");
+  EXPECT_EQ(moduleSharingScope(ModuleSharing::PerGroup, context), "");
+  EXPECT_EQ(
+      moduleSharingScope(ModuleSharing::PerGroup, contextFor("app.a")),
+      "origin:app.a");
+}
+
+TEST(SandboxContextScopeTest, NestsPerThread) {
+  auto outer = contextFor("app.a");
+  auto inner = contextFor("app.b");
+  EXPECT_EQ(SandboxContextScope::current(), nullptr);
+  {
+    SandboxContextScope outerScope(&outer);
+    {
+      SandboxContextScope innerScope(&inner);
+      EXPECT_EQ(SandboxContextScope::current(), &inner);
+      std::thread([] {
+        EXPECT_EQ(SandboxContextScope::current(), nullptr);
+      }).join();
+    }
+    EXPECT_EQ(SandboxContextScope::current(), &outer);
+  }
+  EXPECT_EQ(SandboxContextScope::current(), nullptr);
+}
+
+TEST_F(SharedModuleRegistryTest, SharesOneInstancePerScope) {
+  int created = 0;
+  int destroyed = 0;
+  auto factory = [&]() -> SharedModuleRegistry::Handle {
+    ++created;
+    return std::make_shared<StorageBackend>(&destroyed);
+  };
+
+  auto first = registry.acquire("Storage", "origin:app.a", factory);
+  auto second = registry.acquire("Storage", "origin:app.a", factory);
+  auto other = registry.acquire("Storage", "origin:app.b", factory);
+  EXPECT_EQ(first, second);
+  EXPECT_NE(first, other);
+  EXPECT_EQ(created, 2);
+  EXPECT_EQ(registry.users("Storage", "origin:app.a"), 2u);
+
+  auto stats = registry.stats();
+  EXPECT_EQ(stats.instances, 2u);
+  EXPECT_EQ(stats.users, 3u);
+  EXPECT_EQ(stats.reused, 1u);
+}
+
+TEST_F(SharedModuleRegistryTest, DropsTheInstanceWithItsLastUser) {
+  int destroyed = 0;
+  auto factory = [&]() -> SharedModuleRegistry::Handle {
+    return std::make_shared<StorageBackend>(&destroyed);
+  };
+  registry.acquire("Storage", "process", factory);
+  registry.acquire("Storage", "process", factory);
+
+  EXPECT_FALSE(registry.release("Storage", "process"));
+  EXPECT_EQ(destroyed, 0);
+  EXPECT_TRUE(registry.release("Storage", "process"));
+  EXPECT_EQ(destroyed, 1);
+  EXPECT_FALSE(registry.release("Storage", "process"));
+  EXPECT_EQ(registry.stats().instances, 0u);
+}
+
+TEST_F(SharedModuleRegistryTest, LooksUpWithoutAFactory) {
+  EXPECT_EQ(registry.acquire("Storage", "process", nullptr), nullptr);
+  EXPECT_EQ(
+      registry.acquire("Storage", "process", [] { return nullptr; }), nullptr);
+  EXPECT_EQ(registry.users("Storage", "process"), 0u);
+
+  int destroyed = 0;
+  auto backend = registry.acquireAs<StorageBackend>(
+      "Storage", "process", [&] {
+        return std::make_shared<StorageBackend>(&destroyed);
+      });
+  EXPECT_EQ(
+      registry.acquire("Storage", "process", nullptr).get(), backend.get());
+  EXPECT_EQ(registry.users("Storage", "process"), 2u);
+}
+
+TEST_F(SharedModuleRegistryTest, DoesNotShareWithoutAScope) {
+  int created = 0;
+  auto factory = [&]() -> SharedModuleRegistry::Handle {
+    ++created;
+    return std::make_shared<int>(created);
+  };
+  auto first = registry.acquire("Storage", "", factory);
+  auto second = registry.acquire("Storage", "", factory);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(registry.stats().instances, 0u);
+}
+
+TEST_F(SharedModuleRegistryTest, KeepsOneInstanceWhenSandboxesRace) {
+  constexpr int kThreads = 8;
+  std::atomic<int> created{0};
+  std::atomic<int> destroyed{0};
+  std::vector<SharedModuleRegistry::Handle> acquired(kThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      acquired[i] = registry.acquire("Storage", "process", [&] {
+        ++created;
+        return SharedModuleRegistry::Handle(
+            new int(0), [&](void* p) {
+              delete static_cast<int*>(p);
+              ++destroyed;
+            });
+      });
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& instance : acquired) {
+    EXPECT_EQ(instance, acquired[0]);
+  }
+  EXPECT_EQ(registry.users("Storage", "process"), size_t(kThreads));
+  EXPECT_EQ(registry.stats().reused, uint64_t(kThreads - 1));
+
+  acquired.clear();
+  for (int i = 0; i < kThreads; ++i) {
+    registry.release("Storage", "process");
+  }
+  EXPECT_EQ(registry.stats().instances, 0u);
+  // The losers' instances and finally the winner's
+  EXPECT_EQ(destroyed.load(), created.load());
+}
@@ -0,0 +1,125 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SandboxPresence.h>
+#include <SandboxRegistry.h>
+
+#include "MockSandboxDelegate.h"
+
+using namespace rnsandbox;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::NiceMock;
+
+namespace {
+
+using Event = std::pair<std::string, PresenceStatus>;
+
+class SandboxPresenceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxRegistry::getInstance().reset();
+    observer_ = std::make_shared<SandboxPresenceObserver>(
+        "self", [this](const std::string& origin, PresenceStatus status) {
+          events_.emplace_back(origin, status);
+        });
+    SandboxRegistry::getInstance().addObserver(observer_);
+  }
+
+  void TearDown() override {
+    SandboxRegistry::getInstance().removeObserver(observer_);
+    SandboxRegistry::getInstance().reset();
+  }
+
+  std::shared_ptr<MockSandboxDelegate> registerSandbox(
+      const std::string& origin,
+      const std::set<std::string>& allowedOrigins = {}) {
+    auto delegate = std::make_shared<NiceMock<MockSandboxDelegate>>();
+    SandboxRegistry::getInstance().registerSandbox(
+        origin, delegate, allowedOrigins);
+    return delegate;
+  }
+
+  std::shared_ptr<SandboxPresenceObserver> observer_;
+  std::vector<Event> events_;
+};
+
+} // namespace
+
+TEST_F(SandboxPresenceTest, ReportsAllowedPeersComingAndGoing) {
+  auto self = registerSandbox("self", {"peer"});
+  observer_->setEnabled(true);
+
+  auto peer = registerSandbox("peer");
+  SandboxRegistry::getInstance().unregisterDelegate("peer", peer);
+
+  EXPECT_THAT(
+      events_,
+      ElementsAre(
+          Event("peer", PresenceStatus::Online),
+          Event("peer", PresenceStatus::Offline)));
+}
+
+TEST_F(SandboxPresenceTest, IgnoresOriginsOutsideAllowedOrigins) {
+  auto self = registerSandbox("self", {"peer"});
+  observer_->setEnabled(true);
+
+  registerSandbox("stranger");
+  SandboxRegistry::getInstance().unregister("stranger");
+
+  EXPECT_THAT(events_, IsEmpty());
+}
+
+TEST_F(SandboxPresenceTest, IgnoresOwnRegistration) {
+  observer_->setEnabled(true);
+  auto self = registerSandbox("self", {"self"});
+  SandboxRegistry::getInstance().unregister("self");
+
+  EXPECT_THAT(events_, IsEmpty());
+}
+
+TEST_F(SandboxPresenceTest, SilentUntilEnabled) {
+  auto self = registerSandbox("self", {"peer"});
+
+  registerSandbox("peer");
+  EXPECT_THAT(events_, IsEmpty());
+
+  observer_->setEnabled(true);
+  SandboxRegistry::getInstance().unregister("peer");
+  observer_->setEnabled(false);
+  registerSandbox("peer");
+
+  EXPECT_THAT(events_, ElementsAre(Event("peer", PresenceStatus::Offline)));
+}
+
+TEST_F(SandboxPresenceTest, OnlyFirstAndLastDelegateChangePresence) {
+  auto self = registerSandbox("self", {"peer"});
+  observer_->setEnabled(true);
+
+  auto first = registerSandbox("peer");
+  auto second = registerSandbox("peer");
+  SandboxRegistry::getInstance().unregisterDelegate("peer", first);
+  SandboxRegistry::getInstance().unregisterDelegate("peer", second);
+
+  EXPECT_THAT(
+      events_,
+      ElementsAre(
+          Event("peer", PresenceStatus::Online),
+          Event("peer", PresenceStatus::Offline)));
+}
+
+TEST_F(SandboxPresenceTest, OnlinePeersListsRegisteredAllowedOrigins) {
+  auto self = registerSandbox("self", {"a", "b", "self"});
+  registerSandbox("a");
+  registerSandbox("c");
+
+  EXPECT_THAT(observer_->onlinePeers(), ElementsAre("a"));
+}
+
+TEST(SandboxPresenceStatusTest, StatusNames) {
+  EXPECT_STREQ(presenceStatusName(PresenceStatus::Online), "online");
+  EXPECT_STREQ(presenceStatusName(PresenceStatus::Offline), "offline");
+}
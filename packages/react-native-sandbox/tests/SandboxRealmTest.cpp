@@ -0,0 +1,235 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SandboxRealm.h>
+#include <SandboxRegistry.h>
+
+#include "MockSandboxDelegate.h"
+
+using namespace rnsandbox;
+using ::testing::ElementsAre;
+using ::testing::NiceMock;
+
+namespace {
+
+// A host sandbox whose JS thread is run by hand
+class FakeHost : public ISandboxDelegate {
+ public:
+  void postMessage(const std::string& message, MessagePriority) override {
+    received.push_back(message);
+  }
+  bool routeMessage(const std::string&, const std::string&, MessagePriority)
+      override {
+    return false;
+  }
+  void setOrigin(const std::string&) override {}
+  void setAllowedOrigins(const std::set<std::string>&) override {}
+  void setAllowedTurboModules(const std::set<std::string>&) override {}
+  bool scheduleOnJSThread(
+      std::function<void(facebook::jsi::Runtime&)> work) override {
+    if (!running) {
+      return false;
+    }
+    tasks.push_back(std::move(work));
+    return true;
+  }
+
+  // Runs scheduled work, including work scheduled meanwhile
+  void runJSThread() {
+    // Never dereferenced: realms only hand it through to their bindings
+    alignas(std::max_align_t) static unsigned char storage[64];
+    auto& runtime = *reinterpret_cast<facebook::jsi::Runtime*>(storage);
+    while (!tasks.empty()) {
+      auto task = std::move(tasks.front());
+      tasks.erase(tasks.begin());
+      task(runtime);
+    }
+  }
+
+  bool running = true;
+  std::vector<std::string> received;
+  std::vector<std::function<void(facebook::jsi::Runtime&)>> tasks;
+};
+
+RealmConfig realmConfig(
+    const std::string& origin,
+    std::set<std::string> allowedOrigins = {}) {
+  return {
+      origin,
+      "/bundles/" + origin + ".js",
+      std::move(allowedOrigins),
+      {"Clipboard", "RNCAsyncStorage"},
+      {{"RNCAsyncStorage", "SandboxedAsyncStorage"}},
+      {}};
+}
+
+} // namespace
+
+class SandboxRealmTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxRegistry::getInstance().reset();
+  }
+
+  void TearDown() override {
+    realms.reset();
+    SandboxRegistry::getInstance().reset();
+  }
+
+  // Records what the realm's bindings would deliver to its JS
+  void attach(const std::shared_ptr<SandboxRealm>& realm) {
+    realm->attach([this](facebook::jsi::Runtime&, std::string&& message) {
+      delivered.push_back(std::move(message));
+    });
+  }
+
+  std::shared_ptr<FakeHost> host = std::make_shared<FakeHost>();
+  std::unique_ptr<SandboxRealmSet> realms =
+      std::make_unique<SandboxRealmSet>(host);
+  std::vector<std::string> delivered;
+};
+
+TEST_F(SandboxRealmTest, NarrowsModulesToTheRealmPolicy) {
+  auto realm = realms->add(realmConfig("widget.a"));
+  EXPECT_EQ(realm->resolveModule("Clipboard"), "Clipboard");
+  EXPECT_EQ(realm->resolveModule("RNCAsyncStorage"), "SandboxedAsyncStorage");
+  EXPECT_EQ(realm->resolveModule("Camera"), "");
+}
+
+TEST_F(SandboxRealmTest, RefusesModulesConfiguredForTheHost) {
+  auto config = realmConfig("widget.a");
+  config.hostConfiguredModules = {"Clipboard", "SandboxedAsyncStorage"};
+  auto realm = realms->add(config);
+  EXPECT_EQ(realm->resolveModule("Clipboard"), "");
+  EXPECT_EQ(realm->resolveModule("RNCAsyncStorage"), "");
+}
+
+TEST_F(SandboxRealmTest, RegistersEachRealmAsItsOwnOrigin) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto first = realms->add(realmConfig("widget.a"));
+  auto second = realms->add(realmConfig("widget.b"));
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(realms->add(realmConfig("widget.a")), nullptr);
+  EXPECT_EQ(realms->add(realmConfig("")), nullptr);
+
+  EXPECT_EQ(registry.find("widget.a"), first);
+  EXPECT_EQ(registry.find("widget.b"), second);
+  EXPECT_THAT(realms->origins(), ElementsAre("widget.a", "widget.b"));
+
+  EXPECT_TRUE(realms->remove("widget.a"));
+  EXPECT_FALSE(realms->remove("widget.a"));
+  EXPECT_EQ(registry.find("widget.a"), nullptr);
+
+  realms.reset();
+  EXPECT_EQ(registry.find("widget.b"), nullptr);
+}
+
+TEST_F(SandboxRealmTest, RoutesBetweenRealmsUnderTheirAcls) {
+  auto sender = realms->add(realmConfig("widget.a", {"widget.b"}));
+  auto receiver = realms->add(realmConfig("widget.b"));
+  attach(receiver);
+
+  EXPECT_EQ(
+      sender->route("{\"n\":1}", "widget.b", MessagePriority::Bulk),
+      RealmRouteResult::Delivered);
+  EXPECT_EQ(
+      receiver->route("{\"n\":2}", "widget.a", MessagePriority::Bulk),
+      RealmRouteResult::Denied);
+  EXPECT_EQ(
+      sender->route("{}", "widget.a", MessagePriority::Bulk),
+      RealmRouteResult::SelfTarget);
+  EXPECT_EQ(
+      sender->route("{}", "widget.c", MessagePriority::Bulk),
+      RealmRouteResult::NotFound);
+
+  host->runJSThread();
+  EXPECT_THAT(delivered, ElementsAre("{\"n\":1}"));
+}
+
+TEST_F(SandboxRealmTest, HoldsMessagesForARealmNotAddedYet) {
+  auto sender = realms->add(realmConfig("widget.a", {"widget.b"}));
+  EXPECT_EQ(
+      sender->route(
+          "{\"early\":true}",
+          "widget.b",
+          MessagePriority::Bulk,
+          std::chrono::seconds(5)),
+      RealmRouteResult::Held);
+
+  auto receiver = realms->add(realmConfig("widget.b"));
+  attach(receiver);
+  host->runJSThread();
+  EXPECT_THAT(delivered, ElementsAre("{\"early\":true}"));
+}
+
+TEST_F(SandboxRealmTest, QueuesMessagesUntilAttached) {
+  auto realm = realms->add(realmConfig("widget.a"));
+  realm->postMessage("{\"n\":1}", MessagePriority::Bulk);
+  realm->postMessage("{\"n\":2}", MessagePriority::Bulk);
+  EXPECT_TRUE(host->tasks.empty());
+
+  attach(realm);
+  realm->postMessage("{\"n\":3}", MessagePriority::Bulk);
+  host->runJSThread();
+  EXPECT_THAT(delivered, ElementsAre("{\"n\":1}", "{\"n\":2}", "{\"n\":3}"));
+}
+
+TEST_F(SandboxRealmTest, DropsMessagesWhenDetachedOrTheHostStops) {
+  auto realm = realms->add(realmConfig("widget.a"));
+  attach(realm);
+  realm->postMessage("{}", MessagePriority::Bulk);
+  realm->detach();
+  host->runJSThread();
+  EXPECT_TRUE(delivered.empty());
+  EXPECT_EQ(realm->inboxStats().bulk.depth, 0u);
+
+  host->running = false;
+  attach(realm);
+  realm->postMessage("{}", MessagePriority::Bulk);
+  EXPECT_EQ(realm->inboxStats().bulk.depth, 0u);
+}
+
+TEST_F(SandboxRealmTest, PostsUntargetedMessagesToTheHost) {
+  auto realm = realms->add(realmConfig("widget.a"));
+  EXPECT_TRUE(realm->postToHost("{\"ready\":true}", MessagePriority::Urgent));
+  EXPECT_THAT(host->received, ElementsAre("{\"ready\":true}"));
+
+  host.reset();
+  EXPECT_FALSE(realm->postToHost("{}", MessagePriority::Bulk));
+}
+
+TEST_F(SandboxRealmTest, ReportsErrorsWithTheRealmOrigin) {
+  std::vector<std::string> reported;
+  realms->setErrorHandler([&](
+                              const std::string& origin,
+                              const std::string& name,
+                              const std::string& message,
+                              const std::string&) {
+    reported.push_back(origin + " " + name + ": " + message);
+  });
+  auto realm = realms->add(realmConfig("widget.a"));
+  EXPECT_TRUE(realm->reportError("JSError", "boom", ""));
+  EXPECT_THAT(reported, ElementsAre("widget.a JSError: boom"));
+
+  realm->setErrorHandler(nullptr);
+  EXPECT_FALSE(realm->reportError("JSError", "boom", ""));
+}
+
+TEST_F(SandboxRealmTest, ForwardsMessagesFromSandboxViewsToRealms) {
+  auto view = std::make_shared<NiceMock<MockSandboxDelegate>>();
+  SandboxRegistry::getInstance().registerSandbox("app", view, {"widget.a"});
+  auto realm = realms->add(realmConfig("widget.a"));
+  attach(realm);
+
+  auto target = SandboxRegistry::getInstance().find("widget.a");
+  ASSERT_NE(target, nullptr);
+  target->postMessage("{\"from\":\"app\"}", MessagePriority::Bulk);
+  host->runJSThread();
+  EXPECT_THAT(delivered, ElementsAre("{\"from\":\"app\"}"));
+}
@@ -143,6 +143,18 @@ TEST_F(SandboxRegistryTest, DuplicateRegistrationIgnored) {
   EXPECT_EQ(all.size(), 1u);
 }
 
+TEST_F(SandboxRegistryTest, DuplicateRegistrationUpdatesAllowedOrigins) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  registry.registerSandbox("dup", delegate, {"first"});
+  registry.registerSandbox("dup", delegate, {"second"});
+
+  EXPECT_EQ(registry.findAll("dup").size(), 1u);
+  EXPECT_FALSE(registry.isPermittedFrom("dup", "first"));
+  EXPECT_TRUE(registry.isPermittedFrom("dup", "second"));
+}
+
 TEST_F(SandboxRegistryTest, EmptyOriginHandling) {
   auto& registry = SandboxRegistry::getInstance();
   auto mockDelegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
@@ -292,3 +304,229 @@ TEST_F(SandboxRegistryTest, ThreadSafety) {
         << "Thread safety test timed out after 5 seconds";
   }
 }
+
+namespace {
+
+class RecordingObserver : public ISandboxRegistryObserver {
+ public:
+  void onSandboxRegistered(const std::string& origin) override {
+    events.push_back("+" + origin);
+  }
+
+  void onSandboxUnregistered(const std::string& origin) override {
+    events.push_back("-" + origin);
+  }
+
+  std::vector<std::string> events;
+};
+
+} // namespace
+
+TEST_F(SandboxRegistryTest, ObserverSeesFirstRegistrationAndLastRemoval) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto observer = std::make_shared<RecordingObserver>();
+  registry.addObserver(observer);
+
+  auto delegate1 = std::make_shared<StrictMock<MockSandboxDelegate>>();
+  auto delegate2 = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  registry.registerSandbox("origin", delegate1, {});
+  registry.registerSandbox("origin", delegate2, {});
+  registry.registerSandbox("origin", delegate1, {"other"});
+  registry.unregisterDelegate("origin", delegate1);
+  registry.unregisterDelegate("origin", delegate2);
+  registry.registerSandbox("origin", delegate1, {});
+  registry.unregister("origin");
+  registry.unregister("origin");
+
+  EXPECT_THAT(
+      observer->events,
+      ::testing::ElementsAre("+origin", "-origin", "+origin", "-origin"));
+  registry.removeObserver(observer);
+}
+
+TEST_F(SandboxRegistryTest, ReplaceDelegateSwapsInPlaceSilently) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto observer = std::make_shared<RecordingObserver>();
+  auto first = std::make_shared<StrictMock<MockSandboxDelegate>>();
+  auto second = std::make_shared<StrictMock<MockSandboxDelegate>>();
+  auto stranger = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  registry.registerSandbox("origin", first, {"other"});
+  registry.addObserver(observer);
+
+  EXPECT_FALSE(registry.replaceDelegate("origin", stranger, second));
+  EXPECT_FALSE(registry.replaceDelegate("missing", first, second));
+  EXPECT_TRUE(registry.replaceDelegate("origin", first, second));
+
+  EXPECT_THAT(registry.findAll("origin"), ::testing::ElementsAre(second));
+  EXPECT_TRUE(registry.isPermittedFrom("origin", "other"));
+  EXPECT_TRUE(observer->events.empty());
+  registry.removeObserver(observer);
+}
+
+TEST_F(SandboxRegistryTest, ObserverMayCallBackIntoRegistry) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  class ReentrantObserver : public ISandboxRegistryObserver {
+   public:
+    void onSandboxRegistered(const std::string& origin) override {
+      found = SandboxRegistry::getInstance().find(origin) != nullptr;
+    }
+    void onSandboxUnregistered(const std::string&) override {}
+    bool found = false;
+  };
+
+  auto observer = std::make_shared<ReentrantObserver>();
+  registry.addObserver(observer);
+  registry.registerSandbox("origin", delegate, {});
+
+  EXPECT_TRUE(observer->found);
+  registry.removeObserver(observer);
+}
+
+TEST_F(SandboxRegistryTest, ExpiredObserversAreSkipped) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  auto observer = std::make_shared<RecordingObserver>();
+  registry.addObserver(observer);
+  observer.reset();
+
+  registry.registerSandbox("origin", delegate, {});
+  EXPECT_NE(registry.find("origin"), nullptr);
+}
+
+TEST_F(SandboxRegistryTest, RegisteredOriginsAreSorted) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  registry.registerSandbox("b", delegate, {});
+  registry.registerSandbox("a", delegate, {});
+  registry.registerSandbox("c", delegate, {});
+  registry.unregister("c");
+
+  EXPECT_THAT(registry.registeredOrigins(), ::testing::ElementsAre("a", "b"));
+}
+
+TEST_F(SandboxRegistryTest, HeldMessagesFlushInOrderOnRegistration) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  EXPECT_TRUE(registry.holdMessage(
+      "late", "first", MessagePriority::Bulk, std::chrono::seconds(5)));
+  EXPECT_TRUE(registry.holdMessage(
+      "late", "second", MessagePriority::Urgent, std::chrono::seconds(5)));
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(*delegate, postMessage("first", MessagePriority::Bulk));
+    EXPECT_CALL(*delegate, postMessage("second", MessagePriority::Urgent));
+  }
+  registry.registerSandbox("late", delegate, {});
+
+  auto stats = registry.mailboxStats();
+  EXPECT_EQ(stats.accepted, 2u);
+  EXPECT_EQ(stats.delivered, 2u);
+  EXPECT_EQ(stats.heldMessages, 0u);
+  EXPECT_EQ(stats.heldBytes, 0u);
+}
+
+TEST_F(SandboxRegistryTest, HoldDeliversImmediatelyToRegisteredOrigin) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
+  registry.registerSandbox("target", delegate, {});
+
+  EXPECT_CALL(*delegate, postMessage("now", MessagePriority::Bulk));
+  EXPECT_TRUE(registry.holdMessage(
+      "target", "now", MessagePriority::Bulk, std::chrono::seconds(1)));
+  EXPECT_EQ(registry.mailboxStats().accepted, 0u);
+}
+
+TEST_F(SandboxRegistryTest, HoldRequiresPositiveTtl) {
+  auto& registry = SandboxRegistry::getInstance();
+
+  EXPECT_FALSE(registry.holdMessage(
+      "late", "msg", MessagePriority::Bulk, std::chrono::milliseconds(0)));
+  EXPECT_FALSE(registry.holdMessage(
+      "", "msg", MessagePriority::Bulk, std::chrono::seconds(1)));
+  EXPECT_EQ(registry.mailboxStats().heldMessages, 0u);
+}
+
+TEST_F(SandboxRegistryTest, ExpiredHeldMessagesAreNotDelivered) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  EXPECT_TRUE(registry.holdMessage(
+      "late", "stale", MessagePriority::Bulk, std::chrono::milliseconds(1)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  registry.registerSandbox("late", delegate, {});
+
+  auto stats = registry.mailboxStats();
+  EXPECT_EQ(stats.expired, 1u);
+  EXPECT_EQ(stats.delivered, 0u);
+  EXPECT_EQ(stats.heldBytes, 0u);
+}
+
+TEST_F(SandboxRegistryTest, StatsExpireMessagesForOriginsThatNeverRegister) {
+  auto& registry = SandboxRegistry::getInstance();
+
+  EXPECT_TRUE(registry.holdMessage(
+      "never", "a", MessagePriority::Bulk, std::chrono::milliseconds(1)));
+  EXPECT_TRUE(registry.holdMessage(
+      "never", "b", MessagePriority::Bulk, std::chrono::seconds(5)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  auto stats = registry.mailboxStats();
+  EXPECT_EQ(stats.expired, 1u);
+  EXPECT_EQ(stats.heldMessages, 1u);
+  EXPECT_EQ(stats.heldBytes, 1u);
+}
+
+TEST_F(SandboxRegistryTest, MailboxCapsRejectMessages) {
+  auto& registry = SandboxRegistry::getInstance();
+  MailboxConfig config;
+  config.maxMessagesPerOrigin = 2;
+  config.maxTotalBytes = 8;
+  registry.setMailboxConfig(config);
+
+  auto ttl = std::chrono::seconds(5);
+  EXPECT_TRUE(registry.holdMessage("a", "1", MessagePriority::Bulk, ttl));
+  EXPECT_TRUE(registry.holdMessage("a", "2", MessagePriority::Bulk, ttl));
+  EXPECT_FALSE(registry.holdMessage("a", "3", MessagePriority::Bulk, ttl));
+
+  EXPECT_TRUE(registry.holdMessage("b", "12345", MessagePriority::Bulk, ttl));
+  EXPECT_FALSE(registry.holdMessage("c", "123", MessagePriority::Bulk, ttl));
+
+  auto stats = registry.mailboxStats();
+  EXPECT_EQ(stats.accepted, 3u);
+  EXPECT_EQ(stats.rejected, 2u);
+  EXPECT_EQ(stats.heldBytes, 7u);
+}
+
+TEST_F(SandboxRegistryTest, TtlIsCappedByConfig) {
+  auto& registry = SandboxRegistry::getInstance();
+  MailboxConfig config;
+  config.maxTtl = std::chrono::milliseconds(1);
+  registry.setMailboxConfig(config);
+
+  EXPECT_TRUE(registry.holdMessage(
+      "late", "msg", MessagePriority::Bulk, std::chrono::hours(1)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  EXPECT_EQ(registry.mailboxStats().expired, 1u);
+}
+
+TEST_F(SandboxRegistryTest, ResetDropsHeldMessages) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<StrictMock<MockSandboxDelegate>>();
+
+  EXPECT_TRUE(registry.holdMessage(
+      "late", "msg", MessagePriority::Bulk, std::chrono::seconds(5)));
+  registry.reset();
+
+  registry.registerSandbox("late", delegate, {});
+  EXPECT_EQ(registry.mailboxStats().heldMessages, 0u);
+}
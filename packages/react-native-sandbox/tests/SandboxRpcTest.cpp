@@ -0,0 +1,282 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <SandboxRegistry.h>
+#include <SandboxRpc.h>
+
+#include "MockSandboxDelegate.h"
+
+using namespace rnsandbox;
+using ::testing::StrictMock;
+
+namespace {
+
+// Records traffic synchronously; the real endpoint hops to the JS thread.
+class RecordingEndpoint : public IRpcEndpoint {
+ public:
+  struct Request {
+    uint64_t callId;
+    std::string sourceOrigin;
+    std::string method;
+    std::string argsJson;
+  };
+
+  void onRequest(
+      uint64_t callId,
+      const std::string& sourceOrigin,
+      const std::string& method,
+      std::string argsJson) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests.push_back({callId, sourceOrigin, method, std::move(argsJson)});
+  }
+
+  void onResponse(uint64_t callId, RpcResponse response) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      responses.emplace_back(callId, std::move(response));
+    }
+    condition_.notify_all();
+  }
+
+  bool waitForResponses(size_t count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return condition_.wait_for(
+        lock, timeout, [&]() { return responses.size() >= count; });
+  }
+
+  std::vector<Request> requests;
+  std::vector<std::pair<uint64_t, RpcResponse>> responses;
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+constexpr std::chrono::milliseconds kNoTimeout{0};
+
+} // namespace
+
+class SandboxRpcTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxRegistry::getInstance().reset();
+    RpcRouter::getInstance().reset();
+
+    delegateA_ = std::make_shared<StrictMock<MockSandboxDelegate>>();
+    delegateB_ = std::make_shared<StrictMock<MockSandboxDelegate>>();
+    SandboxRegistry::getInstance().registerSandbox("A", delegateA_, {"B"});
+    SandboxRegistry::getInstance().registerSandbox("B", delegateB_, {"A"});
+
+    endpointA_ = std::make_shared<RecordingEndpoint>();
+    endpointB_ = std::make_shared<RecordingEndpoint>();
+    RpcRouter::getInstance().registerEndpoint("A", endpointA_);
+    RpcRouter::getInstance().registerEndpoint("B", endpointB_);
+  }
+
+  void TearDown() override {
+    RpcRouter::getInstance().reset();
+    SandboxRegistry::getInstance().reset();
+  }
+
+  std::shared_ptr<MockSandboxDelegate> delegateA_;
+  std::shared_ptr<MockSandboxDelegate> delegateB_;
+  std::shared_ptr<RecordingEndpoint> endpointA_;
+  std::shared_ptr<RecordingEndpoint> endpointB_;
+};
+
+TEST_F(SandboxRpcTest, RequestAndResponseAreCorrelated) {
+  auto& router = RpcRouter::getInstance();
+  uint64_t first = 0;
+  uint64_t second = 0;
+
+  ASSERT_EQ(
+      router.call(endpointA_, "A", "B", "add", "[1,2]", kNoTimeout, first),
+      RpcStatus::Ok);
+  ASSERT_EQ(
+      router.call(endpointA_, "A", "B", "add", "[3,4]", kNoTimeout, second),
+      RpcStatus::Ok);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(router.pendingCount(), 2u);
+
+  ASSERT_EQ(endpointB_->requests.size(), 2u);
+  EXPECT_EQ(endpointB_->requests[0].sourceOrigin, "A");
+  EXPECT_EQ(endpointB_->requests[0].method, "add");
+  EXPECT_EQ(endpointB_->requests[1].argsJson, "[3,4]");
+
+  EXPECT_TRUE(router.respond("B", second, {RpcStatus::Ok, "7"}));
+  EXPECT_TRUE(router.respond("B", first, {RpcStatus::Ok, "3"}));
+  EXPECT_FALSE(router.respond("B", first, {RpcStatus::Ok, "3"}));
+
+  ASSERT_EQ(endpointA_->responses.size(), 2u);
+  EXPECT_EQ(endpointA_->responses[0].first, second);
+  EXPECT_EQ(endpointA_->responses[0].second.payload, "7");
+  EXPECT_EQ(endpointA_->responses[1].first, first);
+  EXPECT_EQ(router.pendingCount(), 0u);
+}
+
+TEST_F(SandboxRpcTest, CallIsRejectedSynchronouslyWhenNotRoutable) {
+  auto& router = RpcRouter::getInstance();
+  uint64_t callId = 0;
+
+  EXPECT_EQ(
+      router.call(endpointA_, "A", "C", "m", "null", kNoTimeout, callId),
+      RpcStatus::AccessDenied);
+  EXPECT_EQ(
+      router.call(endpointA_, "A", "A", "m", "null", kNoTimeout, callId),
+      RpcStatus::SelfTarget);
+  EXPECT_EQ(
+      router.call(endpointA_, "A", "B", "", "null", kNoTimeout, callId),
+      RpcStatus::InvalidOrigin);
+
+  RpcRouter::getInstance().unregisterEndpoint("B", endpointB_);
+  EXPECT_EQ(
+      router.call(endpointA_, "A", "B", "m", "null", kNoTimeout, callId),
+      RpcStatus::TargetNotFound);
+
+  EXPECT_TRUE(endpointB_->requests.empty());
+  EXPECT_EQ(router.pendingCount(), 0u);
+}
+
+TEST_F(SandboxRpcTest, OnlyTheTargetMayRespond) {
+  auto& router = RpcRouter::getInstance();
+  uint64_t callId = 0;
+  ASSERT_EQ(
+      router.call(endpointA_, "A", "B", "m", "null", kNoTimeout, callId),
+      RpcStatus::Ok);
+
+  EXPECT_FALSE(router.respond("A", callId, {RpcStatus::Ok, "1"}));
+  EXPECT_TRUE(endpointA_->responses.empty());
+  EXPECT_TRUE(router.respond("B", callId, {RpcStatus::Ok, "1"}));
+}
+
+TEST_F(SandboxRpcTest, TargetUnregisterRejectsPendingCallsImmediately) {
+  auto& router = RpcRouter::getInstance();
+  uint64_t callId = 0;
+  ASSERT_EQ(
+      router.call(
+          endpointA_,
+          "A",
+          "B",
+          "slow",
+          "null",
+          std::chrono::seconds(60),
+          callId),
+      RpcStatus::Ok);
+
+  SandboxRegistry::getInstance().unregister("B");
+
+  ASSERT_EQ(endpointA_->responses.size(), 1u);
+  EXPECT_EQ(endpointA_->responses[0].first, callId);
+  EXPECT_EQ(
+      endpointA_->responses[0].second.status, RpcStatus::TargetUnregistered);
+  EXPECT_EQ(router.pendingCount(), 0u);
+
+  // The endpoint went away with the sandbox
+  EXPECT_FALSE(router.respond("B", callId, {RpcStatus::Ok, "1"}));
+}
+
+TEST_F(SandboxRpcTest, CallerUnregisterDropsItsPendingCalls) {
+  auto& router = RpcRouter::getInstance();
+  uint64_t callId = 0;
+  ASSERT_EQ(
+      router.call(endpointA_, "A", "B", "m", "null", kNoTimeout, callId),
+      RpcStatus::Ok);
+
+  SandboxRegistry::getInstance().unregisterDelegate("A", delegateA_);
+
+  EXPECT_EQ(router.pendingCount(), 0u);
+  EXPECT_FALSE(router.respond("B", callId, {RpcStatus::Ok, "1"}));
+  EXPECT_TRUE(endpointA_->responses.empty());
+}
+
+TEST_F(SandboxRpcTest, EachEndpointOfAnOriginKeepsItsOwnCalls) {
+  auto& router = RpcRouter::getInstance();
+  uint64_t first = 0;
+  ASSERT_EQ(
+      router.call(endpointA_, "A", "B", "m", "null", kNoTimeout, first),
+      RpcStatus::Ok);
+
+  // A second runtime of B, e.g. another view of the origin, takes new calls
+  auto secondB = std::make_shared<RecordingEndpoint>();
+  router.registerEndpoint("B", secondB);
+  EXPECT_TRUE(endpointA_->responses.empty());
+  uint64_t second = 0;
+  ASSERT_EQ(
+      router.call(endpointA_, "A", "B", "m", "null", kNoTimeout, second),
+      RpcStatus::Ok);
+  EXPECT_EQ(endpointB_->requests.size(), 1u);
+  EXPECT_EQ(secondB->requests.size(), 1u);
+
+  // Unregistering one endpoint rejects only the calls it received
+  router.unregisterEndpoint("B", secondB);
+  ASSERT_EQ(endpointA_->responses.size(), 1u);
+  EXPECT_EQ(endpointA_->responses[0].first, second);
+  EXPECT_EQ(
+      endpointA_->responses[0].second.status, RpcStatus::TargetUnregistered);
+  EXPECT_TRUE(router.respond("B", first, {RpcStatus::Ok, "1"}));
+  ASSERT_EQ(endpointA_->responses.size(), 2u);
+  EXPECT_EQ(endpointA_->responses[1].second.status, RpcStatus::Ok);
+}
+
+TEST_F(SandboxRpcTest, ResponsesGoToTheCallingEndpoint) {
+  auto& router = RpcRouter::getInstance();
+  auto secondA = std::make_shared<RecordingEndpoint>();
+  router.registerEndpoint("A", secondA);
+  uint64_t callId = 0;
+  ASSERT_EQ(
+      router.call(secondA, "A", "B", "m", "null", kNoTimeout, callId),
+      RpcStatus::Ok);
+
+  EXPECT_TRUE(router.respond("B", callId, {RpcStatus::Ok, "1"}));
+  EXPECT_TRUE(endpointA_->responses.empty());
+  ASSERT_EQ(secondA->responses.size(), 1u);
+
+  // An endpoint that is not registered for the origin cannot call
+  auto stranger = std::make_shared<RecordingEndpoint>();
+  EXPECT_EQ(
+      router.call(stranger, "A", "B", "m", "null", kNoTimeout, callId),
+      RpcStatus::InvalidOrigin);
+}
+
+TEST_F(SandboxRpcTest, PendingCallTimesOut) {
+  auto& router = RpcRouter::getInstance();
+  uint64_t slow = 0;
+  uint64_t fast = 0;
+  ASSERT_EQ(
+      router.call(
+          endpointA_,
+          "A",
+          "B",
+          "slow",
+          "null",
+          std::chrono::milliseconds(200),
+          slow),
+      RpcStatus::Ok);
+  ASSERT_EQ(
+      router.call(
+          endpointA_,
+          "A",
+          "B",
+          "fast",
+          "null",
+          std::chrono::milliseconds(20),
+          fast),
+      RpcStatus::Ok);
+
+  ASSERT_TRUE(endpointA_->waitForResponses(1, std::chrono::seconds(5)));
+  EXPECT_EQ(endpointA_->responses[0].first, fast);
+  EXPECT_EQ(endpointA_->responses[0].second.status, RpcStatus::Timeout);
+  EXPECT_THAT(
+      endpointA_->responses[0].second.payload,
+      ::testing::HasSubstr("'fast'"));
+
+  EXPECT_TRUE(router.respond("B", slow, {RpcStatus::Ok, "1"}));
+  EXPECT_FALSE(router.respond("B", fast, {RpcStatus::Ok, "1"}));
+  ASSERT_EQ(endpointA_->responses.size(), 2u);
+  EXPECT_EQ(endpointA_->responses[1].second.status, RpcStatus::Ok);
+}
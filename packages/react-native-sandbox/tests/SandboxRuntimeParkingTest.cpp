@@ -0,0 +1,124 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <SandboxRuntimeParking.h>
+
+using namespace rnsandbox;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace {
+
+constexpr size_t kMiB = 1024 * 1024;
+
+} // namespace
+
+class SandboxRuntimeParkingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto& parking = SandboxRuntimeParking::getInstance();
+    parking.reset();
+    parking.setReleaseHook(
+        [this](SandboxRuntimeParking::ParkId id) { released.push_back(id); });
+  }
+
+  void TearDown() override {
+    SandboxRuntimeParking::getInstance().reset();
+  }
+
+  static std::string key(const std::string& origin) {
+    return SandboxRuntimeParking::makeKey({origin, "app.bundle", "App"});
+  }
+
+  std::vector<SandboxRuntimeParking::ParkId> released;
+};
+
+TEST_F(SandboxRuntimeParkingTest, ReattachesRuntimeWithMatchingKey) {
+  auto& parking = SandboxRuntimeParking::getInstance();
+  auto chat = parking.park(key("chat"), 4 * kMiB);
+  auto feed = parking.park(key("feed"), 4 * kMiB);
+  ASSERT_NE(chat, 0u);
+  ASSERT_NE(feed, 0u);
+
+  EXPECT_EQ(parking.take(SandboxRuntimeParking::makeKey({"chat"})), 0u);
+  EXPECT_EQ(parking.take(key("chat")), chat);
+  EXPECT_EQ(parking.take(key("chat")), 0u);
+
+  auto stats = parking.stats();
+  EXPECT_EQ(stats.parked, 1u);
+  EXPECT_EQ(stats.parkedBytes, 4 * kMiB);
+  EXPECT_EQ(stats.reattached, 1u);
+  EXPECT_THAT(released, IsEmpty());
+}
+
+TEST_F(SandboxRuntimeParkingTest, TakesMostRecentlyParkedFirst) {
+  auto& parking = SandboxRuntimeParking::getInstance();
+  auto older = parking.park(key("chat"), kMiB);
+  auto newer = parking.park(key("chat"), kMiB);
+
+  EXPECT_EQ(parking.take(key("chat")), newer);
+  EXPECT_EQ(parking.take(key("chat")), older);
+}
+
+TEST_F(SandboxRuntimeParkingTest, EvictsOldestToStayWithinBudget) {
+  auto& parking = SandboxRuntimeParking::getInstance();
+  parking.setBudget({2, 10 * kMiB, std::chrono::seconds(5)});
+
+  auto a = parking.park(key("a"), 2 * kMiB);
+  auto b = parking.park(key("b"), 2 * kMiB);
+  auto c = parking.park(key("c"), 2 * kMiB);
+  EXPECT_THAT(released, ElementsAre(a));
+
+  // Evicting b frees a slot, but c has to go as well to fit the bytes
+  auto d = parking.park(key("d"), 9 * kMiB);
+  EXPECT_THAT(released, ElementsAre(a, b, c));
+  EXPECT_EQ(parking.stats().parked, 1u);
+
+  // Alone too big: not parked, nothing else is evicted for it
+  EXPECT_EQ(parking.park(key("e"), 11 * kMiB), 0u);
+  EXPECT_THAT(released, ElementsAre(a, b, c));
+  EXPECT_EQ(parking.take(key("d")), d);
+  EXPECT_EQ(parking.stats().evicted, 3u);
+}
+
+TEST_F(SandboxRuntimeParkingTest, ZeroRuntimesDisablesParking) {
+  auto& parking = SandboxRuntimeParking::getInstance();
+  auto parked = parking.park(key("a"), kMiB);
+  parking.setBudget({0, 10 * kMiB, std::chrono::seconds(5)});
+
+  EXPECT_THAT(released, ElementsAre(parked));
+  EXPECT_EQ(parking.park(key("a"), kMiB), 0u);
+}
+
+TEST_F(SandboxRuntimeParkingTest, ExpiresAfterGracePeriod) {
+  auto& parking = SandboxRuntimeParking::getInstance();
+  parking.setBudget({4, 64 * kMiB, std::chrono::seconds(5)});
+  auto start = SandboxRuntimeParking::Clock::now();
+
+  auto first = parking.park(key("a"), kMiB, start);
+  auto second = parking.park(key("b"), kMiB, start + std::chrono::seconds(3));
+
+  EXPECT_EQ(parking.expire(start + std::chrono::seconds(4)), 0u);
+  EXPECT_EQ(parking.expire(start + std::chrono::seconds(6)), 1u);
+  EXPECT_THAT(released, ElementsAre(first));
+  EXPECT_EQ(parking.expire(start + std::chrono::seconds(8)), 1u);
+  EXPECT_THAT(released, ElementsAre(first, second));
+  EXPECT_EQ(parking.stats().expired, 2u);
+}
+
+TEST_F(SandboxRuntimeParkingTest, ReleasesEarlyOnRequest) {
+  auto& parking = SandboxRuntimeParking::getInstance();
+  auto a = parking.park(key("a"), kMiB);
+  auto b = parking.park(key("b"), kMiB);
+
+  EXPECT_TRUE(parking.release(a));
+  EXPECT_FALSE(parking.release(a));
+  EXPECT_EQ(parking.take(key("a")), 0u);
+
+  EXPECT_EQ(parking.releaseAll(), 1u);
+  EXPECT_THAT(released, ElementsAre(a, b));
+  EXPECT_EQ(parking.stats().parkedBytes, 0u);
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <SandboxStartupTimeline.h>
+
+using namespace rnsandbox;
+
+class StartupTimelineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    timeline_.setTraceHook(
+        [this](StartupPhase phase, std::chrono::nanoseconds offset) {
+          traced_.emplace_back(phase, offset);
+        });
+  }
+
+  StartupTimeline timeline_;
+  std::vector<std::pair<StartupPhase, std::chrono::nanoseconds>> traced_;
+};
+
+TEST_F(StartupTimelineTest, RecordsFirstOccurrenceOfEachPhase) {
+  EXPECT_TRUE(timeline_.mark(StartupPhase::ViewCreated));
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  EXPECT_TRUE(timeline_.mark(StartupPhase::BundleLoaded));
+  auto first = timeline_.offsets()[static_cast<size_t>(
+      StartupPhase::BundleLoaded)];
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  EXPECT_FALSE(timeline_.mark(StartupPhase::BundleLoaded));
+
+  auto offsets = timeline_.offsets();
+  ASSERT_TRUE(offsets[static_cast<size_t>(StartupPhase::ViewCreated)]);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(offsets[static_cast<size_t>(StartupPhase::BundleLoaded)], first);
+  EXPECT_GE(*first, std::chrono::milliseconds(2));
+  EXPECT_LE(
+      *offsets[static_cast<size_t>(StartupPhase::ViewCreated)], *first);
+  EXPECT_FALSE(offsets[static_cast<size_t>(StartupPhase::FirstFrame)]);
+}
+
+TEST_F(StartupTimelineTest, PhasesMarkedAfterTheFactKeepTheirTime) {
+  auto viewCreated = StartupTimeline::Clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  timeline_.mark(StartupPhase::DelegateCreated);
+  timeline_.mark(StartupPhase::ViewCreated, viewCreated);
+  timeline_.mark(
+      StartupPhase::HostCreated,
+      viewCreated - std::chrono::milliseconds(10));
+
+  auto offsets = timeline_.offsets();
+  EXPECT_LT(
+      *offsets[static_cast<size_t>(StartupPhase::ViewCreated)],
+      *offsets[static_cast<size_t>(StartupPhase::DelegateCreated)]);
+  // Never before the start
+  EXPECT_EQ(
+      *offsets[static_cast<size_t>(StartupPhase::HostCreated)],
+      std::chrono::nanoseconds(0));
+}
+
+TEST_F(StartupTimelineTest, TracesNewlyRecordedPhasesOnly) {
+  timeline_.mark(StartupPhase::HostCreated);
+  timeline_.mark(StartupPhase::HostCreated);
+  timeline_.mark(StartupPhase::FirstFrame);
+
+  ASSERT_EQ(traced_.size(), 2u);
+  EXPECT_EQ(traced_[0].first, StartupPhase::HostCreated);
+  EXPECT_EQ(traced_[1].first, StartupPhase::FirstFrame);
+  EXPECT_EQ(
+      traced_[1].second,
+      *timeline_.offsets()[static_cast<size_t>(StartupPhase::FirstFrame)]);
+}
+
+TEST_F(StartupTimelineTest, RestartForgetsPhases) {
+  timeline_.mark(StartupPhase::ViewCreated);
+  timeline_.mark(StartupPhase::FirstFrame);
+
+  timeline_.restart();
+  for (const auto& offset : timeline_.offsets()) {
+    EXPECT_FALSE(offset);
+  }
+
+  EXPECT_TRUE(timeline_.mark(StartupPhase::FirstFrame));
+  EXPECT_EQ(traced_.size(), 3u);
+}
+
+TEST_F(StartupTimelineTest, SerializesAllPhasesInOrder) {
+  timeline_.mark(StartupPhase::ViewCreated);
+  std::string json = timeline_.toJson();
+
+  EXPECT_EQ(json.find("{\"viewCreated\":"), 0u);
+  EXPECT_NE(json.find("\"bundleLoaded\":null"), std::string::npos);
+  EXPECT_NE(json.find(",\"firstFrame\":null}"), std::string::npos);
+  EXPECT_EQ(json.find("\"viewCreated\":null"), std::string::npos);
+
+  size_t previous = 0;
+  for (size_t i = 0; i < kStartupPhaseCount; ++i) {
+    std::string key = std::string("\"") +
+        toString(static_cast<StartupPhase>(i)) + "\":";
+    size_t position = json.find(key);
+    ASSERT_NE(position, std::string::npos) << key;
+    EXPECT_GE(position, previous);
+    previous = position;
+  }
+}
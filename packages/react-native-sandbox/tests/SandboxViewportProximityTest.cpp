@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <limits>
+
+#include <SandboxViewportProximity.h>
+
+using namespace rnsandbox;
+
+namespace {
+
+const ViewportRect kViewport{0, 0, 400, 800};
+
+} // namespace
+
+TEST(SandboxViewportProximityTest, MeasuresDistanceAlongFarthestAxis) {
+  EXPECT_EQ(distanceToViewport({100, 100, 200, 200}, kViewport), 0);
+  // Partly visible
+  EXPECT_EQ(distanceToViewport({300, 700, 200, 200}, kViewport), 0);
+  // Below the fold, in a vertical list
+  EXPECT_EQ(distanceToViewport({0, 1100, 400, 300}, kViewport), 300);
+  // Above, after scrolling past it
+  EXPECT_EQ(distanceToViewport({0, -500, 400, 300}, kViewport), 200);
+  // Off to the right in a horizontal list, slightly below as well
+  EXPECT_EQ(distanceToViewport({650, 820, 100, 100}, kViewport), 250);
+  // Touching the edge counts as in view
+  EXPECT_EQ(distanceToViewport({400, 0, 100, 100}, kViewport), 0);
+}
+
+TEST(SandboxViewportProximityTest, StartsWithinLoadDistance) {
+  LazyLoadDistances distances{250, 0};
+  EXPECT_EQ(
+      nextLazyLoadAction(false, 300, distances), LazyLoadAction::None);
+  EXPECT_EQ(
+      nextLazyLoadAction(false, 250, distances), LazyLoadAction::Start);
+  EXPECT_EQ(nextLazyLoadAction(false, 0, distances), LazyLoadAction::Start);
+  // Without a release distance a started view keeps its runtime
+  EXPECT_EQ(
+      nextLazyLoadAction(
+          true, std::numeric_limits<double>::infinity(), distances),
+      LazyLoadAction::None);
+}
+
+TEST(SandboxViewportProximityTest, ReleasesPastReleaseDistanceOnly) {
+  LazyLoadDistances distances{250, 1000};
+  EXPECT_EQ(nextLazyLoadAction(true, 600, distances), LazyLoadAction::None);
+  EXPECT_EQ(nextLazyLoadAction(true, 1000, distances), LazyLoadAction::None);
+  EXPECT_EQ(
+      nextLazyLoadAction(true, 1001, distances), LazyLoadAction::Release);
+  // Between the two distances a released view stays released
+  EXPECT_EQ(
+      nextLazyLoadAction(false, 600, distances), LazyLoadAction::None);
+}
+
+TEST(SandboxViewportProximityTest, ReleaseDistanceNeverBelowLoadDistance) {
+  LazyLoadDistances distances{500, 100};
+  EXPECT_EQ(nextLazyLoadAction(true, 400, distances), LazyLoadAction::None);
+  EXPECT_EQ(
+      nextLazyLoadAction(true, 501, distances), LazyLoadAction::Release);
+  EXPECT_EQ(nextLazyLoadAction(false, 400, distances), LazyLoadAction::Start);
+}
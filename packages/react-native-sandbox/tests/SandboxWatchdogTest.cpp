@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SandboxWatchdog.h>
+
+using namespace rnsandbox;
+using namespace std::chrono_literals;
+
+class SandboxWatchdogTest : public ::testing::Test {
+ protected:
+  struct Sandbox {
+    std::atomic<bool> interrupted{false};
+    std::atomic<int> timeouts{0};
+    std::mutex mutex;
+    std::string task;
+    std::chrono::milliseconds elapsed{};
+  };
+
+  void SetUp() override {
+    SandboxWatchdog::getInstance().reset();
+  }
+
+  void TearDown() override {
+    SandboxWatchdog::getInstance().reset();
+  }
+
+  SandboxWatchdog::SandboxId add(Sandbox& sandbox) {
+    return SandboxWatchdog::getInstance().add(
+        {[&sandbox](const std::string& task, std::chrono::milliseconds ms) {
+           std::lock_guard<std::mutex> lock(sandbox.mutex);
+           sandbox.task = task;
+           sandbox.elapsed = ms;
+           ++sandbox.timeouts;
+         },
+         [&sandbox] { sandbox.interrupted = true; }});
+  }
+
+  // Stands in for a runaway loop that only an interrupt can stop
+  static bool spinUntilInterrupted(
+      Sandbox& sandbox,
+      std::chrono::milliseconds limit = 5000ms) {
+    auto giveUp = std::chrono::steady_clock::now() + limit;
+    while (!sandbox.interrupted) {
+      if (std::chrono::steady_clock::now() > giveUp) {
+        return false;
+      }
+      std::this_thread::yield();
+    }
+    return true;
+  }
+};
+
+TEST_F(SandboxWatchdogTest, InterruptsTaskPastItsBudget) {
+  auto& watchdog = SandboxWatchdog::getInstance();
+  Sandbox sandbox;
+  auto id = add(sandbox);
+  watchdog.setBudget(id, 20ms);
+
+  watchdog.beginTask(id, "message");
+  ASSERT_TRUE(spinUntilInterrupted(sandbox));
+  EXPECT_TRUE(watchdog.endTask(id));
+
+  std::lock_guard<std::mutex> lock(sandbox.mutex);
+  EXPECT_EQ(sandbox.timeouts, 1);
+  EXPECT_EQ(sandbox.task, "message");
+  EXPECT_GE(sandbox.elapsed, 20ms);
+  EXPECT_EQ(watchdog.stats().timeouts, 1u);
+}
+
+TEST_F(SandboxWatchdogTest, TaskWithinBudgetIsNotInterrupted) {
+  auto& watchdog = SandboxWatchdog::getInstance();
+  Sandbox sandbox;
+  auto id = add(sandbox);
+  watchdog.setBudget(id, 30ms);
+
+  {
+    SandboxWatchdog::Scope scope(watchdog, id, "quick");
+  }
+  std::this_thread::sleep_for(60ms);
+
+  EXPECT_FALSE(sandbox.interrupted);
+  EXPECT_EQ(sandbox.timeouts, 0);
+  EXPECT_EQ(watchdog.stats().tasks, 1u);
+}
+
+TEST_F(SandboxWatchdogTest, NestedTasksAreTimedAsTheOutermostOne) {
+  auto& watchdog = SandboxWatchdog::getInstance();
+  Sandbox sandbox;
+  auto id = add(sandbox);
+  watchdog.setBudget(id, 20ms);
+
+  watchdog.beginTask(id, "drain");
+  watchdog.beginTask(id, "message");
+  EXPECT_FALSE(watchdog.endTask(id));
+  ASSERT_TRUE(spinUntilInterrupted(sandbox));
+  EXPECT_TRUE(watchdog.endTask(id));
+
+  std::lock_guard<std::mutex> lock(sandbox.mutex);
+  EXPECT_EQ(sandbox.task, "drain");
+  EXPECT_EQ(watchdog.stats().tasks, 1u);
+}
+
+TEST_F(SandboxWatchdogTest, ZeroBudgetDisablesTheWatchdog) {
+  auto& watchdog = SandboxWatchdog::getInstance();
+  Sandbox sandbox;
+  auto id = add(sandbox);
+  watchdog.setBudget(id, 0ms);
+
+  watchdog.beginTask(id, "long");
+  std::this_thread::sleep_for(50ms);
+  EXPECT_FALSE(watchdog.endTask(id));
+  EXPECT_FALSE(sandbox.interrupted);
+}
+
+TEST_F(SandboxWatchdogTest, FiresOncePerTask) {
+  auto& watchdog = SandboxWatchdog::getInstance();
+  Sandbox sandbox;
+  auto id = add(sandbox);
+  watchdog.setBudget(id, 10ms);
+
+  watchdog.beginTask(id, "first");
+  ASSERT_TRUE(spinUntilInterrupted(sandbox));
+  // The runtime ignores the interrupt for a while
+  std::this_thread::sleep_for(50ms);
+  EXPECT_TRUE(watchdog.endTask(id));
+  EXPECT_EQ(sandbox.timeouts, 1);
+
+  sandbox.interrupted = false;
+  watchdog.beginTask(id, "second");
+  ASSERT_TRUE(spinUntilInterrupted(sandbox));
+  EXPECT_TRUE(watchdog.endTask(id));
+  EXPECT_EQ(sandbox.timeouts, 2);
+}
+
+TEST_F(SandboxWatchdogTest, EarlierDeadlineWakesTheTimer) {
+  auto& watchdog = SandboxWatchdog::getInstance();
+  Sandbox slow;
+  Sandbox runaway;
+  auto slowId = add(slow);
+  auto runawayId = add(runaway);
+  watchdog.setBudget(slowId, 10s);
+  watchdog.setBudget(runawayId, 20ms);
+
+  watchdog.beginTask(slowId, "slow");
+  std::thread thread([&] {
+    watchdog.beginTask(runawayId, "loop");
+    spinUntilInterrupted(runaway);
+    watchdog.endTask(runawayId);
+  });
+  EXPECT_TRUE(spinUntilInterrupted(runaway, 1000ms));
+  thread.join();
+
+  EXPECT_FALSE(watchdog.endTask(slowId));
+  EXPECT_FALSE(slow.interrupted);
+}
+
+TEST_F(SandboxWatchdogTest, RemovedSandboxIsNoLongerWatched) {
+  auto& watchdog = SandboxWatchdog::getInstance();
+  Sandbox sandbox;
+  auto id = add(sandbox);
+  watchdog.setBudget(id, 10ms);
+  watchdog.remove(id);
+
+  watchdog.beginTask(id, "message");
+  std::this_thread::sleep_for(40ms);
+  EXPECT_FALSE(watchdog.endTask(id));
+  EXPECT_FALSE(sandbox.interrupted);
+  EXPECT_EQ(watchdog.stats().tasks, 0u);
+}
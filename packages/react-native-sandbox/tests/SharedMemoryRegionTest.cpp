@@ -0,0 +1,369 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SandboxRegistry.h>
+#include <SharedMemoryRegion.h>
+
+#include "MockSandboxDelegate.h"
+
+using namespace rnsandbox;
+using ::testing::NiceMock;
+using namespace std::chrono_literals;
+
+class SharedMemoryRegionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SandboxRegistry::getInstance().reset();
+    SharedMemoryRegistry::getInstance().reset();
+
+    delegateA_ = std::make_shared<NiceMock<MockSandboxDelegate>>();
+    delegateB_ = std::make_shared<NiceMock<MockSandboxDelegate>>();
+    delegateC_ = std::make_shared<NiceMock<MockSandboxDelegate>>();
+    SandboxRegistry::getInstance().registerSandbox("A", delegateA_, {"B"});
+    SandboxRegistry::getInstance().registerSandbox("B", delegateB_, {"A"});
+    // C lists A, but A does not list C
+    SandboxRegistry::getInstance().registerSandbox("C", delegateC_, {"A"});
+  }
+
+  void TearDown() override {
+    SharedMemoryRegistry::getInstance().reset();
+    SandboxRegistry::getInstance().reset();
+  }
+
+  std::shared_ptr<SharedMemoryRegion> create(
+      const std::string& origin,
+      const std::string& name,
+      size_t byteLength) {
+    std::shared_ptr<SharedMemoryRegion> region;
+    EXPECT_EQ(
+        SharedMemoryRegistry::getInstance().create(
+            origin, name, byteLength, region),
+        SharedMemoryStatus::Ok);
+    return region;
+  }
+
+  std::shared_ptr<MockSandboxDelegate> delegateA_;
+  std::shared_ptr<MockSandboxDelegate> delegateB_;
+  std::shared_ptr<MockSandboxDelegate> delegateC_;
+};
+
+TEST_F(SharedMemoryRegionTest, AttachedRegionsShareTheSameBytes) {
+  auto owned = create("A", "frames", 1024);
+  ASSERT_NE(owned, nullptr);
+  EXPECT_EQ(owned->byteLength(), 1024u);
+  EXPECT_EQ(owned->wordCount(), 256u);
+
+  std::shared_ptr<SharedMemoryRegion> attached;
+  ASSERT_EQ(
+      SharedMemoryRegistry::getInstance().attach("B", "A", "frames", attached),
+      SharedMemoryStatus::Ok);
+  EXPECT_EQ(attached, owned);
+
+  std::memcpy(owned->data() + 16, "pixels", 6);
+  EXPECT_EQ(std::memcmp(attached->data() + 16, "pixels", 6), 0);
+  EXPECT_THAT(
+      SharedMemoryRegistry::getInstance().attachedOrigins("A", "frames"),
+      ::testing::ElementsAre("B"));
+}
+
+TEST_F(SharedMemoryRegionTest, NewRegionsAreZeroFilled) {
+  auto region = create("A", "zeros", 10);
+  EXPECT_EQ(region->wordCount(), 3u);
+  for (size_t i = 0; i < region->byteLength(); ++i) {
+    EXPECT_EQ(region->data()[i], 0);
+  }
+}
+
+TEST_F(SharedMemoryRegionTest, AttachRequiresPermissionInBothDirections) {
+  create("A", "table", 64);
+  create("C", "table", 64);
+
+  std::shared_ptr<SharedMemoryRegion> region;
+  auto& registry = SharedMemoryRegistry::getInstance();
+  EXPECT_EQ(
+      registry.attach("C", "A", "table", region),
+      SharedMemoryStatus::AccessDenied);
+  EXPECT_EQ(
+      registry.attach("A", "C", "table", region),
+      SharedMemoryStatus::AccessDenied);
+  EXPECT_EQ(region, nullptr);
+}
+
+TEST_F(SharedMemoryRegionTest, ValidatesNamesAndSizes) {
+  std::shared_ptr<SharedMemoryRegion> region;
+  auto& registry = SharedMemoryRegistry::getInstance();
+  EXPECT_EQ(
+      registry.create("A", "", 16, region), SharedMemoryStatus::InvalidName);
+  EXPECT_EQ(
+      registry.create("", "x", 16, region), SharedMemoryStatus::InvalidName);
+  EXPECT_EQ(
+      registry.create("A", "x", 0, region), SharedMemoryStatus::InvalidSize);
+  EXPECT_EQ(
+      registry.create(
+          "A", "x", SharedMemoryRegistry::kMaxRegionSize + 1, region),
+      SharedMemoryStatus::InvalidSize);
+  EXPECT_EQ(
+      registry.attach("B", "A", "missing", region),
+      SharedMemoryStatus::NotFound);
+}
+
+TEST_F(SharedMemoryRegionTest, RecreatingReturnsTheExistingRegion) {
+  auto first = create("A", "state", 32);
+  first->store(0, 42);
+
+  auto second = create("A", "state", 32);
+  EXPECT_EQ(second, first);
+  EXPECT_EQ(second->load(0), 42);
+
+  std::shared_ptr<SharedMemoryRegion> resized;
+  EXPECT_EQ(
+      SharedMemoryRegistry::getInstance().create("A", "state", 64, resized),
+      SharedMemoryStatus::AlreadyExists);
+
+  // Names are per owner
+  auto other = create("B", "state", 64);
+  EXPECT_NE(other, first);
+}
+
+TEST_F(SharedMemoryRegionTest, AtomicOperationsReturnPreviousValues) {
+  auto region = create("A", "atomics", 16);
+  region->store(1, 5);
+  EXPECT_EQ(region->add(1, 3), 5);
+  EXPECT_EQ(region->add(1, -10), 8);
+  EXPECT_EQ(region->load(1), -2);
+  EXPECT_EQ(region->exchange(1, 7), -2);
+  EXPECT_EQ(region->compareExchange(1, 0, 9), 7);
+  EXPECT_EQ(region->load(1), 7);
+  EXPECT_EQ(region->compareExchange(1, 7, 9), 7);
+  EXPECT_EQ(region->load(1), 9);
+}
+
+TEST_F(SharedMemoryRegionTest, ConcurrentAddsAreNotLost) {
+  auto region = create("A", "counter", 4);
+  constexpr int kThreads = 8;
+  constexpr int kIncrements = 20000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kIncrements; ++i) {
+        region->add(0, 1);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(region->load(0), kThreads * kIncrements);
+}
+
+TEST_F(SharedMemoryRegionTest, WaitReturnsNotEqualOrTimesOut) {
+  auto region = create("A", "wait", 8);
+  region->store(0, 1);
+  EXPECT_EQ(region->wait(0, 0, 0ms), SharedMemoryWaitResult::NotEqual);
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(region->wait(0, 1, 20ms), SharedMemoryWaitResult::TimedOut);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+  EXPECT_EQ(region->waiterCount(), 0u);
+}
+
+TEST_F(SharedMemoryRegionTest, NotifyWakesOnlyWaitersOnThatIndex) {
+  auto region = create("A", "notify", 8);
+  std::atomic<int> wokenOnZero{0};
+
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < 3; ++i) {
+    waiters.emplace_back([&] {
+      if (region->wait(0, 0, -1ms) == SharedMemoryWaitResult::Ok) {
+        wokenOnZero.fetch_add(1);
+      }
+    });
+  }
+  std::thread otherIndex([&] {
+    EXPECT_EQ(region->wait(1, 0, 200ms), SharedMemoryWaitResult::TimedOut);
+  });
+
+  while (region->waiterCount() < 4) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(region->notify(0, 2), 2u);
+  while (wokenOnZero.load() < 2) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(region->notify(0), 1u);
+
+  for (auto& waiter : waiters) {
+    waiter.join();
+  }
+  otherIndex.join();
+  EXPECT_EQ(wokenOnZero.load(), 3);
+}
+
+// Two sandboxes hand a token back and forth through one word, the way a
+// producer/consumer pair would share a frame buffer.
+TEST_F(SharedMemoryRegionTest, PingPongBetweenSandboxThreads) {
+  auto owned = create("A", "pingpong", 4);
+  std::shared_ptr<SharedMemoryRegion> attached;
+  ASSERT_EQ(
+      SharedMemoryRegistry::getInstance().attach(
+          "B", "A", "pingpong", attached),
+      SharedMemoryStatus::Ok);
+
+  constexpr int kRounds = 1000;
+  auto play = [](SharedMemoryRegion& region, int32_t mine, int32_t theirs) {
+    for (int i = 0; i < kRounds; ++i) {
+      while (region.load(0) != mine) {
+        region.wait(0, theirs, -1ms);
+      }
+      region.store(0, theirs);
+      region.notify(0);
+    }
+  };
+
+  std::thread ping([&] { play(*owned, 0, 1); });
+  std::thread pong([&] { play(*attached, 1, 0); });
+  ping.join();
+  pong.join();
+  EXPECT_EQ(owned->load(0), 0);
+}
+
+TEST_F(SharedMemoryRegionTest, AsyncWaitersAreWokenCancelledAndClosed) {
+  auto region = create("A", "async", 8);
+  std::vector<SharedMemoryWaitResult> results;
+  auto record = [&](SharedMemoryWaitResult result) {
+    results.push_back(result);
+  };
+
+  uint64_t first = 0;
+  uint64_t second = 0;
+  uint64_t third = 0;
+  ASSERT_EQ(
+      region->waitAsync(0, 0, record, first), SharedMemoryWaitResult::Ok);
+  ASSERT_EQ(
+      region->waitAsync(0, 0, record, second), SharedMemoryWaitResult::Ok);
+  ASSERT_EQ(
+      region->waitAsync(1, 0, record, third), SharedMemoryWaitResult::Ok);
+
+  region->store(1, 1);
+  uint64_t unqueued = 0;
+  EXPECT_EQ(
+      region->waitAsync(1, 0, record, unqueued),
+      SharedMemoryWaitResult::NotEqual);
+  EXPECT_EQ(unqueued, 0u);
+
+  EXPECT_EQ(region->notify(0, 1), 1u);
+  EXPECT_TRUE(region->cancelWait(second));
+  EXPECT_FALSE(region->cancelWait(first));
+  region->close();
+
+  EXPECT_THAT(
+      results,
+      ::testing::ElementsAre(
+          SharedMemoryWaitResult::Ok,
+          SharedMemoryWaitResult::TimedOut,
+          SharedMemoryWaitResult::Closed));
+  EXPECT_EQ(
+      region->waitAsync(0, 0, record, unqueued),
+      SharedMemoryWaitResult::Closed);
+}
+
+TEST_F(SharedMemoryRegionTest, ReleaseClosesOwnedAndDetachesAttached) {
+  auto owned = create("A", "shared", 16);
+  auto& registry = SharedMemoryRegistry::getInstance();
+  std::shared_ptr<SharedMemoryRegion> first;
+  std::shared_ptr<SharedMemoryRegion> second;
+  ASSERT_EQ(
+      registry.attach("B", "A", "shared", first), SharedMemoryStatus::Ok);
+  ASSERT_EQ(
+      registry.attach("B", "A", "shared", second), SharedMemoryStatus::Ok);
+
+  // B stays attached until both of its handles are released
+  registry.release("B", first);
+  EXPECT_EQ(registry.attachedOrigins("A", "shared").size(), 1u);
+  registry.release("B", second);
+  EXPECT_TRUE(registry.attachedOrigins("A", "shared").empty());
+  EXPECT_FALSE(owned->isClosed());
+
+  registry.release("A", owned);
+  EXPECT_TRUE(owned->isClosed());
+  EXPECT_EQ(registry.regionCount(), 0u);
+}
+
+TEST_F(SharedMemoryRegionTest, OwnerInstancesCloseWithTheLastHandle) {
+  auto& registry = SharedMemoryRegistry::getInstance();
+  auto first = create("A", "shared", 16);
+  auto second = create("A", "shared", 16);
+  ASSERT_EQ(first, second);
+  std::shared_ptr<SharedMemoryRegion> attached;
+  ASSERT_EQ(
+      registry.attach("B", "A", "shared", attached), SharedMemoryStatus::Ok);
+
+  // The other instance of A and the attached peer keep using it
+  registry.release("A", first);
+  EXPECT_FALSE(first->isClosed());
+  EXPECT_EQ(registry.regionCount(), 1u);
+
+  registry.release("A", second);
+  EXPECT_TRUE(first->isClosed());
+  EXPECT_EQ(registry.regionCount(), 0u);
+}
+
+TEST_F(SharedMemoryRegionTest, DetachedOwnerHandlesKeepTheRegionOpen) {
+  auto& registry = SharedMemoryRegistry::getInstance();
+  auto reloaded = create("A", "shared", 16);
+  reloaded->store(0, 7);
+  registry.detach("A", reloaded);
+  EXPECT_FALSE(reloaded->isClosed());
+
+  auto current = create("A", "shared", 16);
+  EXPECT_EQ(current->load(0), 7);
+  registry.release("A", current);
+  EXPECT_TRUE(current->isClosed());
+}
+
+TEST_F(SharedMemoryRegionTest, UnregisteringTheOwnerClosesItsRegions) {
+  auto owned = create("A", "frames", 64);
+  std::shared_ptr<SharedMemoryRegion> attached;
+  ASSERT_EQ(
+      SharedMemoryRegistry::getInstance().attach("B", "A", "frames", attached),
+      SharedMemoryStatus::Ok);
+
+  std::thread waiter([&] {
+    EXPECT_EQ(attached->wait(0, 0, -1ms), SharedMemoryWaitResult::Closed);
+  });
+  while (owned->waiterCount() == 0) {
+    std::this_thread::yield();
+  }
+
+  SandboxRegistry::getInstance().unregister("A");
+  waiter.join();
+
+  EXPECT_TRUE(owned->isClosed());
+  EXPECT_EQ(SharedMemoryRegistry::getInstance().regionCount(), 0u);
+  // The memory stays usable for holders of the region
+  attached->store(0, 3);
+  EXPECT_EQ(attached->load(0), 3);
+}
+
+TEST_F(SharedMemoryRegionTest, UnregisteringAnAttacherDropsItsAttachments) {
+  create("A", "frames", 64);
+  std::shared_ptr<SharedMemoryRegion> attached;
+  ASSERT_EQ(
+      SharedMemoryRegistry::getInstance().attach("B", "A", "frames", attached),
+      SharedMemoryStatus::Ok);
+
+  SandboxRegistry::getInstance().unregister("B");
+
+  auto& registry = SharedMemoryRegistry::getInstance();
+  EXPECT_TRUE(registry.attachedOrigins("A", "frames").empty());
+  EXPECT_FALSE(attached->isClosed());
+  EXPECT_EQ(registry.regionCount(), 1u);
+}
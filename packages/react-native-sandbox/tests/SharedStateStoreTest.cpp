@@ -0,0 +1,203 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SandboxRegistry.h>
+#include <SharedStateStore.h>
+
+#include "MockSandboxDelegate.h"
+
+using namespace rnsandbox;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace {
+
+class RecordingListener : public ISharedStateListener {
+ public:
+  void onSharedStateChanged(const std::string& key) override {
+    keys.push_back(key);
+  }
+
+  std::vector<std::string> keys;
+};
+
+class SharedStateStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SharedStateStore::getInstance().reset();
+  }
+
+  void TearDown() override {
+    SharedStateStore::getInstance().reset();
+  }
+
+  std::string readAs(const std::string& origin, const std::string& key) {
+    std::shared_ptr<const std::string> value;
+    SharedStateStore::getInstance().read(origin, key, value);
+    return value ? *value : "<unset>";
+  }
+};
+
+} // namespace
+
+TEST_F(SharedStateStoreTest, WriteThenReadWithinAccessLists) {
+  auto& store = SharedStateStore::getInstance();
+  store.setAccess("a", {"config.*"}, {"config.*"});
+
+  EXPECT_EQ(
+      store.write("a", "config.theme", std::string("\"dark\"")),
+      SharedStateStatus::Ok);
+  EXPECT_EQ(readAs("a", "config.theme"), "\"dark\"");
+  EXPECT_EQ(readAs("a", "config.missing"), "<unset>");
+}
+
+TEST_F(SharedStateStoreTest, AccessListsAreEnforced) {
+  auto& store = SharedStateStore::getInstance();
+  store.setAccess("reader", {"config.*"}, {});
+  store.setAccess("writer", {}, {"config.*"});
+
+  EXPECT_EQ(
+      store.write("reader", "config.theme", std::string("1")),
+      SharedStateStatus::AccessDenied);
+  EXPECT_EQ(
+      store.write("writer", "session.id", std::string("1")),
+      SharedStateStatus::AccessDenied);
+  EXPECT_EQ(
+      store.write("stranger", "config.theme", std::string("1")),
+      SharedStateStatus::AccessDenied);
+  EXPECT_EQ(
+      store.write("writer", "config.theme", std::string("1")),
+      SharedStateStatus::Ok);
+
+  std::shared_ptr<const std::string> value;
+  EXPECT_EQ(
+      store.read("writer", "config.theme", value),
+      SharedStateStatus::AccessDenied);
+  EXPECT_EQ(readAs("reader", "config.theme"), "1");
+}
+
+TEST_F(SharedStateStoreTest, HostWriteBypassesAccessLists) {
+  auto& store = SharedStateStore::getInstance();
+  store.setAccess("a", {"*"}, {});
+
+  EXPECT_EQ(
+      store.hostWrite("session.user", std::string("{\"id\":1}")),
+      SharedStateStatus::Ok);
+  EXPECT_EQ(readAs("a", "session.user"), "{\"id\":1}");
+  EXPECT_EQ(
+      store.hostWrite("", std::string("1")), SharedStateStatus::InvalidKey);
+}
+
+TEST_F(SharedStateStoreTest, SnapshotsAreImmutable) {
+  auto& store = SharedStateStore::getInstance();
+  store.hostWrite("k", std::string("1"));
+  auto before = store.snapshot();
+
+  store.hostWrite("k", std::string("2"));
+  store.hostWrite("other", std::string("3"));
+  auto after = store.snapshot();
+
+  EXPECT_EQ(*before->values.at("k"), "1");
+  EXPECT_EQ(before->values.count("other"), 0u);
+  EXPECT_EQ(*after->values.at("k"), "2");
+  EXPECT_EQ(after->version, before->version + 2);
+}
+
+TEST_F(SharedStateStoreTest, NoOpWritesKeepTheVersion) {
+  auto& store = SharedStateStore::getInstance();
+  store.hostWrite("k", std::string("1"));
+  uint64_t version = store.snapshot()->version;
+
+  store.hostWrite("k", std::string("1"));
+  EXPECT_EQ(store.snapshot()->version, version);
+
+  store.hostWrite("k", std::nullopt);
+  EXPECT_EQ(store.snapshot()->version, version + 1);
+  EXPECT_EQ(store.snapshot()->values.count("k"), 0u);
+
+  store.hostWrite("k", std::nullopt);
+  EXPECT_EQ(store.snapshot()->version, version + 1);
+}
+
+TEST_F(SharedStateStoreTest, ListenersSeeOnlyReadableChanges) {
+  auto& store = SharedStateStore::getInstance();
+  store.setAccess("a", {"config.*"}, {});
+  auto listener = std::make_shared<RecordingListener>();
+  store.addListener("a", listener);
+
+  store.hostWrite("config.theme", std::string("1"));
+  store.hostWrite("secret", std::string("1"));
+  store.hostWrite("config.theme", std::string("1"));
+  store.hostWrite("config.theme", std::nullopt);
+
+  EXPECT_THAT(listener->keys, ElementsAre("config.theme", "config.theme"));
+  store.removeListener(listener);
+}
+
+TEST_F(SharedStateStoreTest, ExpiredListenersAreDropped) {
+  auto& store = SharedStateStore::getInstance();
+  store.setAccess("a", {"*"}, {});
+  auto listener = std::make_shared<RecordingListener>();
+  store.addListener("a", listener);
+  listener.reset();
+
+  EXPECT_EQ(store.hostWrite("k", std::string("1")), SharedStateStatus::Ok);
+}
+
+TEST_F(SharedStateStoreTest, RemovedAccessDeniesEverything) {
+  auto& store = SharedStateStore::getInstance();
+  store.setAccess("a", {"*"}, {"*"});
+  store.removeAccess("a");
+
+  EXPECT_FALSE(store.canRead("a", "k"));
+  EXPECT_FALSE(store.canWrite("a", "k"));
+}
+
+TEST_F(SharedStateStoreTest, AccessEndsWithTheOriginsLastSandbox) {
+  auto& store = SharedStateStore::getInstance();
+  auto& registry = SandboxRegistry::getInstance();
+  registry.reset();
+  auto first = std::make_shared<MockSandboxDelegate>();
+  auto second = std::make_shared<MockSandboxDelegate>();
+  registry.registerSandbox("a", first, {});
+  registry.registerSandbox("a", second, {});
+  store.setAccess("a", {"*"}, {"*"});
+
+  registry.unregisterDelegate("a", first);
+  EXPECT_TRUE(store.canRead("a", "k"));
+  EXPECT_TRUE(store.canWrite("a", "k"));
+
+  registry.unregisterDelegate("a", second);
+  EXPECT_FALSE(store.canRead("a", "k"));
+  EXPECT_FALSE(store.canWrite("a", "k"));
+  registry.reset();
+}
+
+TEST_F(SharedStateStoreTest, ReadersNeverSeeTornState) {
+  auto& store = SharedStateStore::getInstance();
+  store.hostWrite("a", std::string("0"));
+  store.hostWrite("b", std::string("0"));
+
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    for (int i = 1; i <= 2000; ++i) {
+      store.hostWrite("a", std::to_string(i));
+    }
+    done = true;
+  });
+
+  uint64_t lastVersion = 0;
+  while (!done) {
+    auto snapshot = store.snapshot();
+    EXPECT_GE(snapshot->version, lastVersion);
+    lastVersion = snapshot->version;
+    EXPECT_EQ(snapshot->values.size(), 2u);
+  }
+  writer.join();
+
+  EXPECT_EQ(*store.snapshot()->values.at("a"), "2000");
+}
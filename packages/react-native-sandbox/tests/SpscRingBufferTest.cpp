@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+#include <SpscRingBuffer.h>
+
+using namespace rnsandbox;
+
+TEST(SpscRingBufferTest, CapacityRoundsUpToPowerOfTwo) {
+  EXPECT_EQ(SpscRingBuffer<int>(1).capacity(), 2u);
+  EXPECT_EQ(SpscRingBuffer<int>(5).capacity(), 8u);
+  EXPECT_EQ(SpscRingBuffer<int>(64).capacity(), 64u);
+}
+
+TEST(SpscRingBufferTest, PushPopPreservesOrder) {
+  SpscRingBuffer<std::string> ring(4);
+
+  EXPECT_TRUE(ring.tryPush("a"));
+  EXPECT_TRUE(ring.tryPush("b"));
+  EXPECT_EQ(ring.sizeApprox(), 2u);
+
+  std::string out;
+  EXPECT_TRUE(ring.tryPop(out));
+  EXPECT_EQ(out, "a");
+  EXPECT_TRUE(ring.tryPop(out));
+  EXPECT_EQ(out, "b");
+  EXPECT_FALSE(ring.tryPop(out));
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingBufferTest, PushFailsWhenFull) {
+  SpscRingBuffer<int> ring(2);
+
+  EXPECT_TRUE(ring.tryPush(1));
+  EXPECT_TRUE(ring.tryPush(2));
+  EXPECT_FALSE(ring.tryPush(3));
+
+  int out = 0;
+  EXPECT_TRUE(ring.tryPop(out));
+  EXPECT_EQ(out, 1);
+  EXPECT_TRUE(ring.tryPush(3));
+}
+
+TEST(SpscRingBufferTest, WrapsAroundManyTimes) {
+  SpscRingBuffer<int> ring(4);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(ring.tryPush(std::move(i)));
+    int out = -1;
+    ASSERT_TRUE(ring.tryPop(out));
+    EXPECT_EQ(out, i);
+  }
+}
+
+TEST(SpscRingBufferTest, ConcurrentProducerConsumer) {
+  SpscRingBuffer<int> ring(64);
+  const int count = 100000;
+
+  std::thread producer([&ring]() {
+    for (int i = 0; i < count; ++i) {
+      int value = i;
+      while (!ring.tryPush(std::move(value))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  while (expected < count) {
+    int out = -1;
+    if (ring.tryPop(out)) {
+      ASSERT_EQ(out, expected);
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  producer.join();
+  EXPECT_TRUE(ring.empty());
+}
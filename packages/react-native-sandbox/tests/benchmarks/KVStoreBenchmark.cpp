@@ -0,0 +1,244 @@
+// Cost of one AsyncStorage setItem against the number of keys in the store.
+//
+// Compares the manifest layout the sandboxed iOS module used to keep, which
+// serializes every inline value into manifest.json and rewrites it on each
+// batch, spilling values over 1024 bytes into files of their own, with
+// SandboxKVStore appending the batch to its log. The manifest is written like
+// NSString's atomic writeToFile, to a temporary file renamed into place and
+// without fsync, so the log is measured both with and without fsync. One in
+// twenty writes stores a 4 KiB value.
+//
+// The second table shows fsynced writes committed in groups, as a module
+// coalescing setItem calls would, each call still its own batch.
+//
+// Usage: KVStoreBenchmark [writesPerSize]
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SandboxKVStore.h>
+
+using namespace rnsandbox;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kInlineValueLimit = 1024;
+
+class ManifestStore {
+ public:
+  explicit ManifestStore(std::string directory)
+      : directory_(std::move(directory)) {
+    ::mkdir(directory_.c_str(), 0700);
+  }
+
+  ~ManifestStore() {
+    for (const auto& [key, value] : manifest_) {
+      if (!value) {
+        std::remove(spillPath(key).c_str());
+      }
+    }
+    std::remove((directory_ + "/manifest.json").c_str());
+    ::rmdir(directory_.c_str());
+  }
+
+  // Fills the store with one manifest write
+  void load(const std::vector<std::pair<std::string, std::string>>& items) {
+    for (const auto& [key, value] : items) {
+      store(key, value);
+    }
+    writeManifest();
+  }
+
+  void setItem(const std::string& key, const std::string& value) {
+    store(key, value);
+    writeManifest();
+  }
+
+ private:
+  void store(const std::string& key, const std::string& value) {
+    if (value.size() <= kInlineValueLimit) {
+      auto it = manifest_.find(key);
+      if (it != manifest_.end() && !it->second) {
+        std::remove(spillPath(key).c_str());
+      }
+      manifest_[key] = std::make_unique<std::string>(value);
+    } else {
+      writeAtomically(spillPath(key), value);
+      manifest_[key] = nullptr;
+    }
+  }
+
+  std::string spillPath(const std::string& key) const {
+    return directory_ + "/" + std::to_string(std::hash<std::string>()(key));
+  }
+
+  void writeManifest() {
+    std::string json = "{";
+    for (const auto& [key, value] : manifest_) {
+      if (json.size() > 1) {
+        json += ",";
+      }
+      json += "\"" + key + "\":";
+      json += value ? "\"" + *value + "\"" : "null";
+    }
+    json += "}";
+    writeAtomically(directory_ + "/manifest.json", json);
+  }
+
+  static void writeAtomically(
+      const std::string& path,
+      const std::string& contents) {
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+      std::perror(temporary.c_str());
+      std::exit(1);
+    }
+    std::fwrite(contents.data(), 1, contents.size(), file);
+    std::fclose(file);
+    std::rename(temporary.c_str(), path.c_str());
+  }
+
+  std::string directory_;
+  // nullptr for values spilled into files
+  std::map<std::string, std::unique_ptr<std::string>> manifest_;
+};
+
+std::string valueFor(size_t i) {
+  return i % 20 == 0 ? std::string(4096, 'L')
+                     : "{\"id\":" + std::to_string(i) +
+          ",\"title\":\"item\",\"done\":false,\"tags\":[\"a\",\"b\"]}";
+}
+
+using Items = std::vector<std::pair<std::string, std::string>>;
+
+Items initialItems(size_t keys) {
+  Items items;
+  for (size_t i = 0; i < keys; ++i) {
+    items.emplace_back("key" + std::to_string(i), valueFor(i + 1));
+  }
+  return items;
+}
+
+double usPerWrite(
+    size_t keys,
+    size_t writes,
+    const std::function<void(const std::string&, const std::string&)>& set) {
+  auto start = Clock::now();
+  for (size_t i = 0; i < writes; ++i) {
+    set("key" + std::to_string((i * 7919) % keys), valueFor(i));
+  }
+  auto elapsed =
+      std::chrono::duration<double, std::micro>(Clock::now() - start);
+  return elapsed.count() / writes;
+}
+
+double logUsPerWrite(
+    const std::string& directory,
+    size_t keys,
+    size_t writes,
+    bool sync) {
+  KVStoreOptions options;
+  options.syncWrites = sync;
+  options.inlineValueLimit = kInlineValueLimit;
+  std::string error;
+  auto store = SandboxKVStore::open(directory, options, &error);
+  if (!store) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    std::exit(1);
+  }
+  KVBatch load;
+  for (auto& [key, value] : initialItems(keys)) {
+    load.put(std::move(key), std::move(value));
+  }
+  store->write(load);
+  double us = usPerWrite(
+      keys, writes, [&](const std::string& key, const std::string& value) {
+        KVBatch batch;
+        batch.put(key, value);
+        store->write(batch);
+      });
+  store->clear();
+  store.reset();
+  std::remove((directory + "/" + SandboxKVStore::kLogName).c_str());
+  ::rmdir(directory.c_str());
+  return us;
+}
+
+double groupUsPerWrite(
+    const std::string& directory,
+    size_t writes,
+    size_t size) {
+  std::string error;
+  auto store = SandboxKVStore::open(directory, {}, &error);
+  if (!store) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    std::exit(1);
+  }
+  std::vector<KVBatch> group(size);
+  std::vector<std::string> errors;
+  auto start = Clock::now();
+  for (size_t i = 0; i < writes; i += size) {
+    for (size_t j = 0; j < size; ++j) {
+      group[j].ops.clear();
+      group[j].put("key" + std::to_string((i + j) % 1000), valueFor(i + j));
+    }
+    store->writeGroup(group, errors);
+  }
+  auto elapsed =
+      std::chrono::duration<double, std::micro>(Clock::now() - start);
+  store->clear();
+  store.reset();
+  std::remove((directory + "/" + SandboxKVStore::kLogName).c_str());
+  ::rmdir(directory.c_str());
+  return elapsed.count() / writes;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t writes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500;
+  std::string base = "/tmp/kv-store-benchmark-" + std::to_string(::getpid());
+
+  std::printf(
+      "%10s %16s %16s %16s\n",
+      "keys",
+      "manifest us",
+      "log us",
+      "log+fsync us");
+  for (size_t keys : {100, 1000, 10000}) {
+    double manifestUs;
+    {
+      ManifestStore manifest(base + "-manifest");
+      manifest.load(initialItems(keys));
+      manifestUs = usPerWrite(
+          keys,
+          writes,
+          [&](const std::string& key, const std::string& value) {
+            manifest.setItem(key, value);
+          });
+    }
+    double logUs = logUsPerWrite(base + "-log", keys, writes, false);
+    double syncedUs = logUsPerWrite(base + "-log", keys, writes, true);
+    std::printf(
+        "%10zu %16.1f %16.1f %16.1f\n", keys, manifestUs, logUs, syncedUs);
+  }
+
+  std::printf("\n%10s %16s\n", "group", "log+fsync us");
+  for (size_t size : {1, 4, 16, 64}) {
+    std::printf(
+        "%10zu %16.1f\n", size, groupUsPerWrite(base + "-group", writes, size));
+  }
+  return 0;
+}
@@ -0,0 +1,251 @@
+// Throughput and latency of sandbox-to-sandbox delivery: the registry path
+// used by postMessage(message, targetOrigin) versus a dedicated MessagePort.
+//
+// Both paths hand messages to a consumer thread standing in for the target
+// sandbox's JS thread. The registry path pays the ACL check, the registry
+// lookup and a locked queue hand-off per message, as the platform delegates
+// do; the port path pays one SPSC push and at most one wakeup per burst.
+//
+// Usage: MessageChannelBenchmark [messageCount]
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ISandboxDelegate.h>
+#include <MessageChannel.h>
+#include <SandboxRegistry.h>
+
+using namespace rnsandbox;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kPayloadSize = 128;
+constexpr int kBystanderOrigins = 64;
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+std::string makeMessage() {
+  std::string message = std::to_string(nowNs());
+  message.resize(kPayloadSize, ' ');
+  return message;
+}
+
+// Consumer-side bookkeeping shared by both paths.
+struct Receiver {
+  std::vector<int64_t> latenciesNs;
+
+  void onMessage(const std::string& message) {
+    latenciesNs.push_back(nowNs() - std::strtoll(message.c_str(), nullptr, 10));
+  }
+};
+
+// Stand-in for a platform delegate: postMessage queues the message for the
+// target JS thread behind a mutex, like runOnJSQueueThread on Android or the
+// buffered runtime executor on iOS.
+class QueueingDelegate : public ISandboxDelegate {
+ public:
+  void postMessage(const std::string& message, MessagePriority) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(message);
+    }
+    cv_.notify_one();
+  }
+
+  bool routeMessage(
+      const std::string&,
+      const std::string&,
+      MessagePriority) override {
+    return false;
+  }
+  void setOrigin(const std::string&) override {}
+  void setAllowedOrigins(const std::set<std::string>&) override {}
+  void setAllowedTurboModules(const std::set<std::string>&) override {}
+  bool scheduleOnJSThread(
+      std::function<void(facebook::jsi::Runtime&)>) override {
+    return false;
+  }
+
+  void consume(Receiver& receiver, size_t expected) {
+    std::deque<std::string> batch;
+    while (receiver.latenciesNs.size() < expected) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return !queue_.empty(); });
+        batch.swap(queue_);
+      }
+      for (const auto& message : batch) {
+        receiver.onMessage(message);
+      }
+      batch.clear();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::string> queue_;
+};
+
+struct Result {
+  double seconds;
+  std::vector<int64_t> latenciesNs;
+};
+
+// Sends `count` messages from the calling thread. A non-zero interval paces
+// the sender, which isolates delivery latency from queueing delay.
+template <typename Send>
+void sendAll(size_t count, std::chrono::nanoseconds interval, Send&& send) {
+  auto next = Clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    if (interval.count() > 0) {
+      while (Clock::now() < next) {
+      }
+      next += interval;
+    }
+    send(makeMessage());
+  }
+}
+
+Result runRegistryPath(size_t count, std::chrono::nanoseconds interval) {
+  auto& registry = SandboxRegistry::getInstance();
+  registry.reset();
+  for (int i = 0; i < kBystanderOrigins; ++i) {
+    registry.registerSandbox(
+        "bystander-" + std::to_string(i),
+        std::make_shared<QueueingDelegate>(),
+        {"renderer"});
+  }
+  auto source = std::make_shared<QueueingDelegate>();
+  auto target = std::make_shared<QueueingDelegate>();
+  registry.registerSandbox("renderer", source, {"data"});
+  registry.registerSandbox("data", target, {"renderer"});
+
+  Receiver receiver;
+  receiver.latenciesNs.reserve(count);
+  auto start = Clock::now();
+  std::thread consumer([&]() { target->consume(receiver, count); });
+
+  sendAll(count, interval, [&registry](std::string&& message) {
+    if (!registry.isPermittedFrom("renderer", "data")) {
+      return;
+    }
+    for (auto& delegate : registry.findAll("data")) {
+      delegate->postMessage(message, MessagePriority::Bulk);
+    }
+  });
+
+  consumer.join();
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  registry.reset();
+  return {seconds, std::move(receiver.latenciesNs)};
+}
+
+Result runPortPath(size_t count, std::chrono::nanoseconds interval) {
+  auto& registry = SandboxRegistry::getInstance();
+  auto& channels = MessageChannelRegistry::getInstance();
+  registry.reset();
+  channels.reset();
+  registry.registerSandbox(
+      "renderer", std::make_shared<QueueingDelegate>(), {"data"});
+  registry.registerSandbox(
+      "data", std::make_shared<QueueingDelegate>(), {"renderer"});
+
+  std::shared_ptr<MessagePort> sender;
+  std::shared_ptr<MessagePort> receiverPort;
+  channels.open("renderer", "data", sender);
+  channels.open("data", "renderer", receiverPort);
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool readable = false;
+  receiverPort->setOnReadable([&]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      readable = true;
+    }
+    cv.notify_one();
+  });
+
+  Receiver receiver;
+  receiver.latenciesNs.reserve(count);
+  auto start = Clock::now();
+  std::thread consumer([&]() {
+    while (receiver.latenciesNs.size() < count) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&readable]() { return readable; });
+        readable = false;
+      }
+      receiverPort->drain(
+          [&receiver](std::string&& message) { receiver.onMessage(message); });
+    }
+  });
+
+  sendAll(count, interval, [&sender](std::string&& message) {
+    while (!sender->postMessage(message)) {
+      std::this_thread::yield();
+    }
+  });
+
+  consumer.join();
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  sender.reset();
+  receiverPort.reset();
+  registry.reset();
+  return {seconds, std::move(receiver.latenciesNs)};
+}
+
+double percentileUs(std::vector<int64_t> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t index = static_cast<size_t>(p * (values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index] / 1000.0;
+}
+
+void report(const char* name, size_t count, const Result& result) {
+  std::printf(
+      "%-22s %12.0f msg/s   p50 %8.2f us   p99 %8.2f us   max %9.2f us\n",
+      name,
+      count / result.seconds,
+      percentileUs(result.latenciesNs, 0.50),
+      percentileUs(result.latenciesNs, 0.99),
+      percentileUs(result.latenciesNs, 1.0));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  size_t pacedCount = std::min<size_t>(count, 20000);
+  auto pacedInterval = std::chrono::microseconds(20);
+
+  std::printf("Burst: %zu messages of %zu bytes\n", count, kPayloadSize);
+  report("registry", count, runRegistryPath(count, {}));
+  report("message port", count, runPortPath(count, {}));
+
+  std::printf(
+      "\nPaced: %zu messages, one every %lld us\n",
+      pacedCount,
+      static_cast<long long>(pacedInterval.count()));
+  report("registry", pacedCount, runRegistryPath(pacedCount, pacedInterval));
+  report("message port", pacedCount, runPortPath(pacedCount, pacedInterval));
+  return 0;
+}
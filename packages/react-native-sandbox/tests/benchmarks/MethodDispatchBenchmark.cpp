@@ -0,0 +1,236 @@
+// Cost of queueing async native module calls, as a chatty module such as
+// AsyncStorage sees them: bursts of small calls from the JS thread to the
+// module's serial lane.
+//
+// "block per call" models the former iOS invoker, which moved each call's
+// std::function into a __block variable and dispatched a block: two heap
+// copies and one queue wakeup per call. "batched lane" is BatchedTaskQueue
+// drained by a thread standing in for the module's dispatch queue, and
+// "strand" the same queue on the shared SandboxExecutor. Allocations are
+// counted by replacing the global operator new.
+//
+// Usage: MethodDispatchBenchmark [callCount]
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include <SandboxExecutor.h>
+
+using namespace rnsandbox;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::atomic<uint64_t> gAllocations{0};
+
+constexpr size_t kBurstSize = 8;
+constexpr size_t kDrainBatch = 16;
+
+struct Result {
+  double seconds;
+  uint64_t allocations;
+  uint64_t wakeups;
+};
+
+// Stand-in for a serial dispatch queue's thread: sleeps until woken, then
+// runs whatever it is handed.
+class SerialThread {
+ public:
+  explicit SerialThread(std::function<bool()> runOnce)
+      : runOnce_(std::move(runOnce)), thread_([this] { run(); }) {}
+
+  ~SerialThread() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  void wake() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++signals_;
+    }
+    cv_.notify_one();
+    ++wakeups;
+  }
+
+  uint64_t wakeups = 0;
+
+ private:
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return stopping_ || signals_ > 0; });
+      if (signals_ == 0) {
+        return;
+      }
+      --signals_;
+      lock.unlock();
+      while (runOnce_()) {
+      }
+      lock.lock();
+    }
+  }
+
+  std::function<bool()> runOnce_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  size_t signals_ = 0;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+// Calls until count completions arrive, in bursts like a screen's worth of
+// AsyncStorage reads, then waits for the lane to catch up.
+template <typename Post>
+double issueCalls(size_t count, std::atomic<size_t>& done, Post&& post) {
+  auto start = Clock::now();
+  for (size_t sent = 0; sent < count;) {
+    for (size_t i = 0; i < kBurstSize && sent < count; ++i, ++sent) {
+      // Two pointers: fits std::function's inline storage, so the call
+      // itself does not allocate and only the dispatch path is counted
+      std::atomic<size_t>* counter = &done;
+      size_t* unused = nullptr;
+      post(std::function<void()>([counter, unused] {
+        (void)unused;
+        counter->fetch_add(1, std::memory_order_relaxed);
+      }));
+    }
+    std::this_thread::yield();
+  }
+  while (done.load() < count) {
+    std::this_thread::yield();
+  }
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+Result runBlockPerCall(size_t count) {
+  std::mutex mutex;
+  std::deque<std::function<void()>*> blocks;
+  SerialThread queue([&] {
+    std::function<void()>* block;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (blocks.empty()) {
+        return false;
+      }
+      block = blocks.front();
+      blocks.pop_front();
+    }
+    (*block)();
+    delete block;
+    return true;
+  });
+
+  std::atomic<size_t> done{0};
+  uint64_t allocationsBefore = gAllocations.load();
+  double seconds = issueCalls(count, done, [&](std::function<void()>&& work) {
+    // The __block copy of the call, then the block that captures it
+    auto* retained = new std::function<void()>(std::move(work));
+    auto* block = new std::function<void()>([retained] {
+      (*retained)();
+      delete retained;
+    });
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      blocks.push_back(block);
+    }
+    queue.wake();
+  });
+  return {seconds, gAllocations.load() - allocationsBefore, queue.wakeups};
+}
+
+Result runBatchedLane(size_t count) {
+  BatchedTaskQueue tasks(std::make_shared<LaneMetrics>());
+  SerialThread queue([&] { return tasks.drain(kDrainBatch); });
+
+  std::atomic<size_t> done{0};
+  // Warms up the lane's buffers, as a module's first calls would
+  issueCalls(kBurstSize * 4, done, [&](std::function<void()>&& work) {
+    if (tasks.push(std::move(work))) {
+      queue.wake();
+    }
+  });
+  done = 0;
+  uint64_t wakeupsBefore = queue.wakeups;
+  uint64_t allocationsBefore = gAllocations.load();
+  double seconds = issueCalls(count, done, [&](std::function<void()>&& work) {
+    if (tasks.push(std::move(work))) {
+      queue.wake();
+    }
+  });
+  return {
+      seconds,
+      gAllocations.load() - allocationsBefore,
+      queue.wakeups - wakeupsBefore};
+}
+
+Result runStrand(size_t count) {
+  SandboxExecutor executor(2);
+  auto strand = executor.strand("bench/AsyncStorage");
+
+  std::atomic<size_t> done{0};
+  issueCalls(kBurstSize * 4, done, [&](std::function<void()>&& work) {
+    strand->post(std::move(work));
+  });
+  done = 0;
+  uint64_t allocationsBefore = gAllocations.load();
+  double seconds = issueCalls(count, done, [&](std::function<void()>&& work) {
+    strand->post(std::move(work));
+  });
+  // Wakeups go through the executor's ready queue and are not counted here
+  return {seconds, gAllocations.load() - allocationsBefore, 0};
+}
+
+void report(const char* name, size_t count, const Result& result) {
+  std::printf(
+      "%-16s %12.0f calls/s   %6.3f allocs/call",
+      name,
+      count / result.seconds,
+      static_cast<double>(result.allocations) / count);
+  if (result.wakeups > 0) {
+    std::printf(
+        "   %6.3f wakeups/call",
+        static_cast<double>(result.wakeups) / count);
+  }
+  std::printf("\n");
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+  gAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+
+  std::printf("%zu calls in bursts of %zu\n", count, kBurstSize);
+  report("block per call", count, runBlockPerCall(count));
+  report("batched lane", count, runBatchedLane(count));
+  report("strand", count, runStrand(count));
+  return 0;
+}
@@ -0,0 +1,128 @@
+// Cost of one allowedOrigins check against the size of the allow-list.
+//
+// Compares a lookup in the std::set the registry used to keep, the compiled
+// OriginMatcher trie, and SandboxRegistry::isPermittedFrom, which adds the
+// registry lock and the per-(source, target) decision cache on top of the
+// trie. Targets alternate between allowed and denied origins, and half of the
+// allow-list is written as prefix patterns for the matcher paths.
+//
+// Usage: OriginMatcherBenchmark [checksPerSize]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <ISandboxDelegate.h>
+#include <OriginMatcher.h>
+#include <SandboxRegistry.h>
+
+using namespace rnsandbox;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+class NullDelegate : public ISandboxDelegate {
+ public:
+  void postMessage(const std::string&, MessagePriority) override {}
+  bool routeMessage(
+      const std::string&,
+      const std::string&,
+      MessagePriority) override {
+    return false;
+  }
+  void setOrigin(const std::string&) override {}
+  void setAllowedOrigins(const std::set<std::string>&) override {}
+  void setAllowedTurboModules(const std::set<std::string>&) override {}
+  bool scheduleOnJSThread(
+      std::function<void(facebook::jsi::Runtime&)>) override {
+    return false;
+  }
+};
+
+std::string pluginOrigin(size_t i) {
+  return "com.example.plugins.team-" + std::to_string(i % 16) + ".plugin-" +
+      std::to_string(i);
+}
+
+// Half of the targets are allowed, half differ from an allowed origin only
+// in their last characters, which is the worst case for both structures.
+std::vector<std::string> makeTargets(size_t listSize) {
+  std::vector<std::string> targets;
+  for (size_t i = 0; i < 64; ++i) {
+    std::string origin = pluginOrigin((i * 7919) % listSize);
+    targets.push_back(i % 2 == 0 ? origin : origin + "-denied");
+  }
+  return targets;
+}
+
+template <typename Check>
+double nsPerCheck(
+    size_t checks,
+    const std::vector<std::string>& targets,
+    Check&& check) {
+  size_t permitted = 0;
+  auto start = Clock::now();
+  for (size_t i = 0; i < checks; ++i) {
+    permitted += check(targets[i % targets.size()]) ? 1 : 0;
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+  // Keep the loop observable so it is not optimized away
+  if (permitted == checks + 1) {
+    std::printf("unreachable\n");
+  }
+  return elapsed.count() / checks;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t checks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+  auto& registry = SandboxRegistry::getInstance();
+  auto delegate = std::make_shared<NullDelegate>();
+
+  std::printf(
+      "%10s %14s %14s %14s\n",
+      "list size",
+      "std::set ns",
+      "matcher ns",
+      "registry ns");
+  for (size_t listSize : {10, 100, 1000, 10000}) {
+    std::set<std::string> exact;
+    std::set<std::string> mixed;
+    for (size_t i = 0; i < listSize; ++i) {
+      exact.insert(pluginOrigin(i));
+      mixed.insert(i % 2 == 0 ? pluginOrigin(i) : pluginOrigin(i) + "*");
+    }
+    auto targets = makeTargets(listSize);
+
+    OriginMatcher matcher(mixed);
+    registry.reset();
+    registry.registerSandbox("source", delegate, mixed);
+
+    double setNs = nsPerCheck(checks, targets, [&exact](const auto& target) {
+      return exact.count(target) > 0;
+    });
+    double matcherNs =
+        nsPerCheck(checks, targets, [&matcher](const auto& target) {
+          return matcher.matches(target);
+        });
+    double registryNs =
+        nsPerCheck(checks, targets, [&registry](const auto& target) {
+          return registry.isPermittedFrom("source", target);
+        });
+
+    std::printf(
+        "%10zu %14.1f %14.1f %14.1f\n",
+        listSize,
+        setNs,
+        matcherNs,
+        registryNs);
+  }
+
+  registry.reset();
+  return 0;
+}